@@ -17,6 +17,9 @@
 #include "task.h"
 #include "semphr.h"
 #include <plib.h>
+#include "trcSnapshotContext.h"
+#include "trcSnapshotLatency.h"
+#include "trcSnapshotTrigger.h"
 
 /* Hardware specific includes. */
 #include "CerebotMX7cK.h"
@@ -49,6 +52,12 @@ xQueueHandle QBTN1Status;
 #if ( configUSE_TRACE_FACILITY == 1 )
     traceString str;
 #endif
+#if ( configUSE_TRACE_FACILITY == 1 ) && ( TRC_CFG_LATENCY_HISTOGRAMS == 1 )
+    TaskHandle_t LEDCHandler_Handle;
+    traceString latencyStr;
+    traceLatency ledcLatency;
+    #define LATENCY_MARK_LEDC_GIVE 1 // vLEDC_ISR_Handler gives LEDC_Semaphore
+#endif
 /* ----- End: Define for Tracalyzer ----- */
 
 int main(void) {
@@ -83,8 +92,22 @@ int main(void) {
             vTracePrint(str, "ToggleLEDB_Task Created!");
         #endif
 
-        xTaskCreate(LEDCHandler_Task, "LEDCHandler_Task", configMINIMAL_STACK_SIZE,
-                NULL, tskIDLE_PRIORITY + 1, NULL);
+        #if ( configUSE_TRACE_FACILITY == 1 ) && ( TRC_CFG_LATENCY_HISTOGRAMS == 1 )
+            xTaskCreate(LEDCHandler_Task, "LEDCHandler_Task", configMINIMAL_STACK_SIZE,
+                    NULL, tskIDLE_PRIORITY + 1, &LEDCHandler_Handle);
+            // time from the ISR giving the semaphore to LEDCHandler_Task running
+            ledcLatency = xTraceLatencyPair("LEDC ISR to task",
+                    TRC_LATENCY_MARK, LATENCY_MARK_LEDC_GIVE,
+                    TRC_LATENCY_TASK_SWITCH_IN, prvTraceGetTaskNumberLow16(LEDCHandler_Handle));
+            #if ( TRC_CFG_TRIGGERED_CAPTURE == 1 )
+                // keep the trace around presses where the task ran over 1 ms late
+                xTraceTriggerOnLatency(ledcLatency, (TRC_HWTC_FREQ_HZ / TRC_HWTC_DIVISOR) / 1000);
+            #endif
+            latencyStr = xTraceRegisterString("Latency");
+        #else
+            xTaskCreate(LEDCHandler_Task, "LEDCHandler_Task", configMINIMAL_STACK_SIZE,
+                    NULL, tskIDLE_PRIORITY + 1, NULL);
+        #endif
         #if ( configUSE_TRACE_FACILITY == 1 )
             vTracePrint(str, "LEDCHandler_Task Created!");
         #endif
@@ -162,6 +185,9 @@ static void LEDCHandler_Task(void *pvParameters) {
         #if ( configUSE_TRACE_FACILITY == 1 )
             vTracePrint(str, "LEDC Toggled");
         #endif
+        #if ( configUSE_TRACE_FACILITY == 1 ) && ( TRC_CFG_LATENCY_HISTOGRAMS == 1 )
+            vTraceLatencyReport(latencyStr); // min/percentiles/max so far
+        #endif
     }
 } /* End of LEDCHandler_Task */
 
@@ -191,6 +217,9 @@ void vLEDC_ISR_Handler(void) {
     hw_msDelay(20); // 20 ms button debounce
     xHigherPriorityTaskWoken = pdFALSE;
     /* Let's give a semaphore to unblock LEDCHandler_Task*/
+    #if ( configUSE_TRACE_FACILITY == 1 ) && ( TRC_CFG_LATENCY_HISTOGRAMS == 1 )
+        vTraceLatencyMark(LATENCY_MARK_LEDC_GIVE);
+    #endif
     xSemaphoreGiveFromISR(LEDC_Semaphore, &xHigherPriorityTaskWoken);
 
     mCNClearIntFlag(); // Macro function to clear CNI flag
@@ -299,7 +328,10 @@ void vApplicationIdleHook(void) {
     {
         RValue = 0;
     }
-    
+
+    #if ( configUSE_TRACE_FACILITY == 1 ) && ( TRC_CFG_CONTEXT_BUFFERS == 1 )
+        vTraceFlushContextBuffers(); // store the events captured since the last idle time
+    #endif
 }
 
 /*-----------------------------------------------------------*/
@@ -0,0 +1,119 @@
+/*
+ * The file-backed persistent trace region of trcFlash.h.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "trcRecorder.h"
+#include "trcFlash.h"
+
+#define REGION_SIZE ((uint32_t)(TRC_CFG_PERSIST_PAGES) * (TRC_CFG_PERSIST_PAGE_SIZE))
+
+static uint8_t region[REGION_SIZE];
+static const char* regionPath;
+
+unsigned long host_flash_errors;
+
+/* Offset of address in the region, or -1 if the bytes are not all in it */
+static int32_t prvOffset(uint32_t address, uint32_t length)
+{
+	if (address < (uint32_t)(TRC_CFG_PERSIST_BASE) ||
+		address - (uint32_t)(TRC_CFG_PERSIST_BASE) > REGION_SIZE - length || length > REGION_SIZE)
+	{
+		return -1;
+	}
+	return (int32_t)(address - (uint32_t)(TRC_CFG_PERSIST_BASE));
+}
+
+int host_flash_open(const char* path)
+{
+	FILE* f;
+
+	regionPath = path;
+	(void)memset(region, 0xFF, sizeof(region));
+	f = fopen(path, "rb");
+	if (f == NULL)
+	{
+		return 0;
+	}
+	if (fread(region, 1, sizeof(region), f) != sizeof(region))
+	{
+		/* Not an image of this region */
+		(void)memset(region, 0xFF, sizeof(region));
+	}
+	return fclose(f);
+}
+
+int host_flash_close(void)
+{
+	FILE* f = fopen(regionPath, "wb");
+
+	if (f == NULL || fwrite(region, 1, sizeof(region), f) != sizeof(region))
+	{
+		if (f != NULL)
+		{
+			(void)fclose(f);
+		}
+		return -1;
+	}
+	return fclose(f);
+}
+
+int host_flash_read(uint32_t address, void* data, uint32_t length)
+{
+	int32_t offset = prvOffset(address, length);
+
+	if (offset < 0)
+	{
+		return -1;
+	}
+	(void)memcpy(data, &region[offset], length);
+	return 0;
+}
+
+int host_flash_write(uint32_t address, const void* data, uint32_t length)
+{
+	const uint8_t* bytes = (const uint8_t*)data;
+	int32_t offset = prvOffset(address, length);
+	uint32_t i;
+
+	if (offset < 0)
+	{
+		host_flash_errors++;
+		return -1;
+	}
+#ifdef TRC_CFG_PERSIST_ERASE
+	for (i = 0; i < length; i++)
+	{
+		if ((region[offset + i] & bytes[i]) != bytes[i])
+		{
+			host_flash_errors++;
+			return -1;
+		}
+	}
+	for (i = 0; i < length; i++)
+	{
+		region[offset + i] &= bytes[i];
+	}
+#else
+	for (i = 0; i < length; i++)
+	{
+		region[offset + i] = bytes[i];
+	}
+#endif
+	return 0;
+}
+
+int host_flash_erase(uint32_t address)
+{
+	int32_t offset = prvOffset(address, TRC_CFG_PERSIST_PAGE_SIZE);
+
+	if (offset < 0 || offset % (TRC_CFG_PERSIST_PAGE_SIZE) != 0)
+	{
+		host_flash_errors++;
+		return -1;
+	}
+	(void)memset(&region[offset], 0xFF, TRC_CFG_PERSIST_PAGE_SIZE);
+	return 0;
+}
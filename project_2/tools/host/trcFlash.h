@@ -0,0 +1,28 @@
+/*
+ * The persistent trace region of the host side tests in ../, kept in a file,
+ * for TRC_CFG_PERSIST_READ, TRC_CFG_PERSIST_WRITE and TRC_CFG_PERSIST_ERASE.
+ * Built with TRC_CFG_PERSIST_ERASE it behaves as NOR flash: erasing sets a
+ * page to 0xFF and a write may only clear bits, so writing a byte twice
+ * without erasing in between fails.  Without it, as the EEPROM, a write
+ * replaces the bytes.  Addresses outside the region fail as well.
+ */
+
+#ifndef TRC_FLASH_H
+#define TRC_FLASH_H
+
+#include <stdint.h>
+
+/* Loads the region from the file, if there is one, else starts erased */
+int host_flash_open(const char* path);
+
+/* Saves the region to the file given to host_flash_open */
+int host_flash_close(void);
+
+int host_flash_read(uint32_t address, void* data, uint32_t length);
+int host_flash_write(uint32_t address, const void* data, uint32_t length);
+int host_flash_erase(uint32_t address);
+
+/* Failed writes and erases, e.g. a second write of a NOR flash byte */
+extern unsigned long host_flash_errors;
+
+#endif /* TRC_FLASH_H */
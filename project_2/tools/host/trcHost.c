@@ -0,0 +1,81 @@
+/*
+ * trcKernelPort.c for the host side tests in ../: the object table, sized
+ * from TRC_CFG_NTASK etc. as on the target, and the timer of trcHost.h.
+ */
+
+#include "trcRecorder.h"
+
+uint32_t host_time;
+int host_preempt_at;
+void (*host_preempt)(void);
+
+static const uint8_t objectCount[TRACE_NCLASSES] = {
+	TRC_CFG_NQUEUE, TRC_CFG_NSEMAPHORE, TRC_CFG_NMUTEX, TRC_CFG_NTASK, TRC_CFG_NISR,
+	TRC_CFG_NTIMER, TRC_CFG_NEVENTGROUP, TRC_CFG_NSTREAMBUFFER, TRC_CFG_NMESSAGEBUFFER
+};
+
+static const uint8_t nameLength[TRACE_NCLASSES] = {
+	TRC_CFG_NAME_LEN_QUEUE, TRC_CFG_NAME_LEN_SEMAPHORE, TRC_CFG_NAME_LEN_MUTEX,
+	TRC_CFG_NAME_LEN_TASK, TRC_CFG_NAME_LEN_ISR, TRC_CFG_NAME_LEN_TIMER,
+	TRC_CFG_NAME_LEN_EVENTGROUP, TRC_CFG_NAME_LEN_STREAMBUFFER, TRC_CFG_NAME_LEN_MESSAGEBUFFER
+};
+
+static const uint8_t propertyBytes[TRACE_NCLASSES] = {
+	PropertyTableSizeQueue, PropertyTableSizeSemaphore, PropertyTableSizeMutex,
+	PropertyTableSizeTask, PropertyTableSizeISR, PropertyTableSizeTimer,
+	PropertyTableSizeEventGroup, PropertyTableSizeStreamBuffer, PropertyTableSizeMessageBuffer
+};
+
+uint32_t host_hwtc(void)
+{
+	uint32_t t = host_time;
+
+	if (host_preempt_at > 0 && --host_preempt_at == 0)
+	{
+		host_preempt();
+	}
+	return t;
+}
+
+void vTraceInitObjectPropertyTable(void)
+{
+	ObjectPropertyTableType* table = &RecorderDataPtr->ObjectPropertyTable;
+	uint16_t index = 0;
+	int c;
+
+	table->NumberOfObjectClasses = TRACE_NCLASSES;
+	for (c = 0; c < TRACE_NCLASSES; c++)
+	{
+		table->NumberOfObjectsPerClass[c] = objectCount[c];
+		table->NameLengthPerClass[c] = nameLength[c];
+		table->TotalPropertyBytesPerClass[c] = propertyBytes[c];
+		table->StartIndexOfClass[c] = index;
+		index = (uint16_t)(index + objectCount[c] * propertyBytes[c]);
+	}
+	table->ObjectPropertyTableSizeInBytes = TRACE_OBJECT_TABLE_SIZE;
+}
+
+void vTraceInitObjectHandleStack(void)
+{
+	uint16_t index = 0;
+	int c;
+
+	for (c = 0; c < TRACE_NCLASSES; c++)
+	{
+		objectHandleStacks.indexOfNextAvailableHandle[c] = index;
+		objectHandleStacks.lowestIndexOfClass[c] = index;
+		index = (uint16_t)(index + objectCount[c]);
+		objectHandleStacks.highestIndexOfClass[c] = (uint16_t)(index - 1);
+	}
+}
+
+const char* pszTraceGetErrorNotEnoughHandles(traceObjectClass objectclass)
+{
+	(void)objectclass;
+	return "Not enough handles - increase TRC_CFG_NTASK etc.";
+}
+
+int prvTraceIsSchedulerSuspended(void)
+{
+	return 0;
+}
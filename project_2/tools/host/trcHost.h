@@ -0,0 +1,20 @@
+/*
+ * The timer of the host side tests in ../.  TRC_HWTC_COUNT reads host_time,
+ * which only the test advances.  With host_preempt_at set to n, the n-th read
+ * from then on runs host_preempt() first, standing for an interrupt or a
+ * higher priority task that preempts the recorder call at that point; the
+ * read returns the time from before it.
+ */
+
+#ifndef TRC_HOST_H
+#define TRC_HOST_H
+
+#include <stdint.h>
+
+extern uint32_t host_time;
+extern int host_preempt_at;
+extern void (*host_preempt)(void);
+
+uint32_t host_hwtc(void);
+
+#endif /* TRC_HOST_H */
@@ -0,0 +1,262 @@
+/*
+ * trcRecorder.h for the host side tests in ../: the parts of the recorder's
+ * trcRecorder.h, trcHardwarePort.h and trcKernelPort.h that
+ * trcSnapshotRecorder.c needs, for a 32-bit free running timer read through
+ * host_hwtc() (trcHost.h).  The critical sections only count the nesting in
+ * recorder_busy; the tests run in a single thread and simulate preemption
+ * from host_hwtc().
+ */
+
+#ifndef TRC_RECORDER_H
+#define TRC_RECORDER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+
+#include "trcHost.h"
+
+#define TRC_USE_TRACEALYZER_RECORDER			1
+
+#define TRC_RECORDER_MODE_SNAPSHOT				0
+#define TRC_RECORDER_MODE_STREAMING				1
+#define TRC_CFG_RECORDER_MODE					TRC_RECORDER_MODE_SNAPSHOT
+
+#define TRC_RECORDER_BUFFER_ALLOCATION_STATIC	0
+#define TRC_RECORDER_BUFFER_ALLOCATION_DYNAMIC	1
+#define TRC_RECORDER_BUFFER_ALLOCATION_CUSTOM	2
+#define TRC_CFG_RECORDER_BUFFER_ALLOCATION		TRC_RECORDER_BUFFER_ALLOCATION_STATIC
+
+#define TRC_CFG_SCHEDULING_ONLY					0
+#define TRC_CFG_INCLUDE_MEMMANG_EVENTS			1
+#define TRC_CFG_INCLUDE_USER_EVENTS				1
+#define TRC_CFG_INCLUDE_ISR_TRACING				1
+#define TRC_CFG_INCLUDE_READY_EVENTS			1
+#define TRC_CFG_MAX_ISR_NESTING					8
+
+#define TRC_FREE_RUNNING_32BIT_INCR				1
+#define TRC_FREE_RUNNING_32BIT_DECR				2
+#define TRC_OS_TIMER_INCR						3
+#define TRC_OS_TIMER_DECR						4
+#define TRC_CUSTOM_TIMER_INCR					5
+#define TRC_CUSTOM_TIMER_DECR					6
+
+/* 1.25 MHz, as the timestamps of this project's traces */
+#define TRC_HWTC_TYPE							TRC_FREE_RUNNING_32BIT_INCR
+#define TRC_HWTC_COUNT							(host_hwtc())
+#define TRC_HWTC_PERIOD							0
+#define TRC_HWTC_DIVISOR						1
+#define TRC_HWTC_FREQ_HZ						1250000
+#define TRC_IRQ_PRIORITY_ORDER					0
+
+#define TRC_HARDWARE_PORT_Win32					2
+#define TRC_HARDWARE_PORT_MICROCHIP_PIC24_PIC32	10
+#define TRC_CFG_HARDWARE_PORT					TRC_HARDWARE_PORT_MICROCHIP_PIC24_PIC32
+
+#define TRACE_KERNEL_VERSION					0x1AA1
+#define TRC_UNUSED
+
+#include "trcSnapshotConfig.h"
+
+typedef uint8_t traceHandle;
+typedef uint16_t traceString;
+typedef uint8_t traceUBChannel;
+typedef uint8_t traceObjectClass;
+typedef void (*TRACE_STOP_HOOK)(void);
+
+/* Object classes, as in trcKernelPort.h */
+#define TRACE_NCLASSES							9
+#define TRACE_CLASS_QUEUE						0
+#define TRACE_CLASS_SEMAPHORE					1
+#define TRACE_CLASS_MUTEX						2
+#define TRACE_CLASS_TASK						3
+#define TRACE_CLASS_ISR							4
+#define TRACE_CLASS_TIMER						5
+#define TRACE_CLASS_EVENTGROUP					6
+#define TRACE_CLASS_STREAMBUFFER				7
+#define TRACE_CLASS_MESSAGEBUFFER				8
+
+/* Property bytes of an object of each class after its name, as in
+trcKernelPort.h: state, and priority for tasks and ISRs */
+#define PropertyTableSizeQueue					((TRC_CFG_NAME_LEN_QUEUE) + 1)
+#define PropertyTableSizeSemaphore				((TRC_CFG_NAME_LEN_SEMAPHORE) + 1)
+#define PropertyTableSizeMutex					((TRC_CFG_NAME_LEN_MUTEX) + 1)
+#define PropertyTableSizeTask					((TRC_CFG_NAME_LEN_TASK) + 4)
+#define PropertyTableSizeISR					((TRC_CFG_NAME_LEN_ISR) + 2)
+#define PropertyTableSizeTimer					((TRC_CFG_NAME_LEN_TIMER) + 1)
+#define PropertyTableSizeEventGroup				((TRC_CFG_NAME_LEN_EVENTGROUP) + 4)
+#define PropertyTableSizeStreamBuffer			((TRC_CFG_NAME_LEN_STREAMBUFFER) + 4)
+#define PropertyTableSizeMessageBuffer			((TRC_CFG_NAME_LEN_MESSAGEBUFFER) + 4)
+
+#define TRACE_OBJECT_TABLE_SIZE ( \
+	(TRC_CFG_NQUEUE) * PropertyTableSizeQueue + \
+	(TRC_CFG_NSEMAPHORE) * PropertyTableSizeSemaphore + \
+	(TRC_CFG_NMUTEX) * PropertyTableSizeMutex + \
+	(TRC_CFG_NTASK) * PropertyTableSizeTask + \
+	(TRC_CFG_NISR) * PropertyTableSizeISR + \
+	(TRC_CFG_NTIMER) * PropertyTableSizeTimer + \
+	(TRC_CFG_NEVENTGROUP) * PropertyTableSizeEventGroup + \
+	(TRC_CFG_NSTREAMBUFFER) * PropertyTableSizeStreamBuffer + \
+	(TRC_CFG_NMESSAGEBUFFER) * PropertyTableSizeMessageBuffer)
+
+#define TRACE_ALLOC_CRITICAL_SECTION()
+#define TRACE_ENTER_CRITICAL_SECTION()
+#define TRACE_EXIT_CRITICAL_SECTION()
+#define trcCRITICAL_SECTION_BEGIN()				recorder_busy++
+#define trcCRITICAL_SECTION_END()				recorder_busy--
+#define trcSR_ALLOC_CRITICAL_SECTION_ON_CORTEX_M_ONLY()
+#define trcCRITICAL_SECTION_BEGIN_ON_CORTEX_M_ONLY()
+#define trcCRITICAL_SECTION_END_ON_CORTEX_M_ONLY()
+
+#define TRACE_ASSERT(eval, msg, defRetVal) if (!(eval)) { prvTraceError("TRACE_ASSERT: " msg); return defRetVal; }
+#define TRACE_MALLOC(size)						malloc(size)
+
+/* Event codes, as in trcKernelPort.h */
+#define NULL_EVENT								0x00
+#define DIV_XPS									0x01
+#define DIV_TASK_READY							0x02
+#define DIV_NEW_TIME							0x03
+#define TS_ISR_BEGIN							0x04
+#define TS_ISR_RESUME							0x05
+#define TS_TASK_BEGIN							0x06
+#define TS_TASK_RESUME							0x07
+#define USER_EVENT								0x98
+#define XTS8									0xA8
+#define XTS16									0xA9
+#define EVENT_BEING_WRITTEN						0xAA
+#define LOW_POWER_BEGIN							0xAC
+#define LOW_POWER_END							0xAD
+#define XID										0xAE
+#define XTS16L									0xAF
+#define TASK_INSTANCE_FINISHED_NEXT_KSE			0xBA
+#define TASK_INSTANCE_FINISHED_DIRECT			0xBB
+
+#define TASK_STATE_INSTANCE_NOT_ACTIVE			0
+#define TASK_STATE_INSTANCE_ACTIVE				1
+#define TRC_STATE_IN_STARTUP					0
+#define TRC_STATE_IN_TASKSWITCH					1
+#define TRC_STATE_IN_APPLICATION				2
+#define FilterGroup0							1
+
+typedef struct { uint8_t type; uint8_t objHandle; uint16_t dts; } TSEvent, TREvent, KernelCall;
+typedef struct { uint8_t type; uint8_t dummy; uint16_t dts; } LPEvent;
+typedef struct { uint8_t type; uint8_t objHandle; uint8_t param; uint8_t dts; } KernelCallWithParamAndHandle;
+typedef struct { uint8_t type; uint8_t dts; uint16_t param; } KernelCallWithParam16;
+typedef struct { uint8_t type; uint8_t objHandle; uint16_t symbolIndex; } ObjCloseNameEvent;
+typedef struct { uint8_t type; uint8_t arg1; uint8_t arg2; uint8_t arg3; } ObjClosePropEvent;
+typedef struct { uint8_t type; uint8_t unused1; uint8_t unused2; uint8_t dts; } TaskInstanceStatusEvent;
+typedef struct { uint8_t type; uint8_t dts; uint16_t payload; } UserEvent;
+typedef struct { uint8_t type; uint8_t xts_8; uint16_t xts_16; } XTSEvent;
+typedef struct { uint8_t type; uint8_t xps_8; uint16_t xps_16; } XPSEvent;
+typedef struct { uint8_t type; uint8_t dts; uint16_t size; } MemEventSize;
+typedef struct { uint8_t type; uint8_t addr_high; uint16_t addr_low; } MemEventAddr;
+
+typedef struct
+{
+	uint32_t NumberOfObjectClasses;
+	uint32_t ObjectPropertyTableSizeInBytes;
+	traceHandle NumberOfObjectsPerClass[4*((TRACE_NCLASSES+3)/4)];
+	uint8_t NameLengthPerClass[4*((TRACE_NCLASSES+3)/4)];
+	uint8_t TotalPropertyBytesPerClass[4*((TRACE_NCLASSES+3)/4)];
+	uint16_t StartIndexOfClass[2*((TRACE_NCLASSES+1)/2)];
+	uint8_t objbytes[4*((TRACE_OBJECT_TABLE_SIZE+3)/4)];
+} ObjectPropertyTableType;
+
+typedef struct
+{
+	uint32_t symTableSize;
+	uint32_t nextFreeSymbolIndex;
+	uint8_t symbytes[4*(((TRC_CFG_SYMBOL_TABLE_SIZE)+3)/4)];
+	uint16_t latestEntryOfChecksum[64];
+} symbolTableType;
+
+typedef struct
+{
+	volatile uint8_t startmarker0, startmarker1, startmarker2, startmarker3;
+	volatile uint8_t startmarker4, startmarker5, startmarker6, startmarker7;
+	volatile uint8_t startmarker8, startmarker9, startmarker10, startmarker11;
+	uint16_t version;
+	uint8_t minor_version;
+	uint8_t irq_priority_order;
+	uint32_t filesize;
+	uint32_t numEvents;
+	uint32_t maxEvents;
+	uint32_t nextFreeIndex;
+	uint32_t bufferIsFull;
+	uint32_t frequency;
+	uint32_t absTimeLastEvent;
+	uint32_t absTimeLastEventSecond;
+	uint32_t recorderActive;
+	uint32_t isrTailchainingThreshold;
+	uint32_t heapMemMaxUsage;
+	uint32_t heapMemUsage;
+	int32_t debugMarker0;
+	uint32_t isUsing16bitHandles;
+	ObjectPropertyTableType ObjectPropertyTable;
+	int32_t debugMarker1;
+	symbolTableType SymbolTable;
+	uint32_t exampleFloatEncoding;
+	uint32_t internalErrorOccured;
+	int32_t debugMarker2;
+	char systemInfo[80];
+	int32_t debugMarker3;
+	uint8_t eventData[(TRC_CFG_EVENT_BUFFER_SIZE) * 4];
+	uint32_t endOfSecondaryBlocks;
+	uint8_t endmarker0, endmarker1, endmarker2, endmarker3, endmarker4, endmarker5;
+	uint8_t endmarker6, endmarker7, endmarker8, endmarker9, endmarker10, endmarker11;
+} RecorderDataType;
+
+typedef struct
+{
+	uint16_t indexOfNextAvailableHandle[TRACE_NCLASSES];
+	uint16_t lowestIndexOfClass[TRACE_NCLASSES];
+	uint16_t highestIndexOfClass[TRACE_NCLASSES];
+	uint16_t handleCountWaterMarksOfClass[TRACE_NCLASSES];
+	traceHandle objectHandles[TRACE_OBJECT_TABLE_SIZE];
+} objectHandleStackType;
+
+extern objectHandleStackType objectHandleStacks;
+extern RecorderDataType* RecorderDataPtr;
+extern volatile int recorder_busy;
+extern uint32_t init_hwtc_count;
+
+#define TRACE_GET_TASK_NUMBER(x)				0
+#define TRACE_GET_CURRENT_TASK()				0
+#define TRACE_PROPERTY_NAME_GET(c, h)			((const char*)&RecorderDataPtr->ObjectPropertyTable.objbytes[uiIndexOfObject(h, c)])
+#define TRACE_PROPERTY_OBJECT_STATE(c, h)		RecorderDataPtr->ObjectPropertyTable.objbytes[uiIndexOfObject(h, c) + RecorderDataPtr->ObjectPropertyTable.NameLengthPerClass[c]]
+#define TRACE_PROPERTY_ACTOR_PRIORITY(c, h)		RecorderDataPtr->ObjectPropertyTable.objbytes[uiIndexOfObject(h, c) + RecorderDataPtr->ObjectPropertyTable.NameLengthPerClass[c] + 1]
+
+/* trcHost.c, in place of trcKernelPort.c */
+void vTraceInitObjectPropertyTable(void);
+void vTraceInitObjectHandleStack(void);
+const char* pszTraceGetErrorNotEnoughHandles(traceObjectClass objectclass);
+int prvTraceIsSchedulerSuspended(void);
+
+/* trcSnapshotRecorder.c */
+void prvTraceInitTraceData(void);
+uint32_t uiTraceStart(void);
+void vTraceStop(void);
+void vTraceClear(void);
+const char* xTraceGetLastError(void);
+void prvTraceError(const char* msg);
+traceHandle prvTraceGetObjectHandle(traceObjectClass objectclass);
+void prvTraceSetObjectName(traceObjectClass objectclass, traceHandle handle, const char* name);
+void prvTraceSetObjectState(uint8_t objectclass, traceHandle id, uint8_t value);
+void prvTraceSetPriorityProperty(uint8_t objectclass, traceHandle id, uint8_t value);
+uint8_t prvTraceGetPriorityProperty(uint8_t objectclass, traceHandle id);
+uint16_t uiIndexOfObject(traceHandle objecthandle, uint8_t objectclass);
+traceString xTraceRegisterString(const char* name);
+traceHandle xTraceSetISRProperties(const char* name, uint8_t priority);
+void vTracePrintF(traceString chn, const char* fmt, ...);
+void vTraceVPrintF(traceString chn, const char* fmt, va_list vl);
+void vTracePrint(traceString chn, const char* str);
+void prvTraceStoreTaskswitch(traceHandle task_handle);
+void prvTraceStoreTaskReady(traceHandle handle);
+void prvTraceStoreKernelCall(uint32_t ecode, traceObjectClass objectClass, uint32_t objectNumber);
+void prvTraceStoreKernelCallWithNumericParamOnly(uint32_t evtcode, uint32_t param);
+void prvTraceStoreKernelCallWithParam(uint32_t evtcode, traceObjectClass objectClass, uint32_t objectNumber, uint32_t param);
+void vTraceStoreISRBegin(traceHandle handle);
+void vTraceStoreISREnd(int pendingISR);
+void vTraceStoreMemMangEvent(uint32_t ecode, uint32_t address, int32_t signed_size);
+
+#endif /* TRC_RECORDER_H */
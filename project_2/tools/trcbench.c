@@ -0,0 +1,292 @@
+/** @file trcbench.c
+ *
+ * @brief Host side benchmark of the snapshot recorder's compact encoding
+ *
+ * @par
+ * Generates a synthetic event stream shaped like this project's traces -
+ * 1.25 MHz timestamps, a 1 ms tick, task switches, ready events, kernel calls,
+ * delays and occasional user events - and stores it with the encoder of
+ * ../trcSnapshotCompact.h, the same code the target runs with
+ * TRC_CFG_COMPACT_EVENT_ENCODING set. The size of the fixed 4 byte records
+ * for the same stream, including the XTS and XPS records they need, is
+ * counted alongside, and the report gives the bytes per millisecond of each
+ * and how much time a snapshot buffer holds.
+ *
+ * @par
+ * Build and run on any Linux host:
+ *
+ *     cc -O2 -Wall -o trcbench trcbench.c
+ *     ./trcbench -t 10000 -e 4 -b 4000
+ *
+ *     -t  ticks to generate (default 10000)
+ *     -e  average events per tick besides the tick itself (default 4)
+ *     -j  percentage of ticks that arrive off the predicted time (default 5)
+ *     -b  snapshot buffer size in bytes (default 4000)
+ *     -s  random seed (default 1)
+ *
+ * @par
+ * The time per event is measured on the host, so it only compares encoding
+ * settings with each other. Cycle counts for the PIC32 have to be taken on
+ * the target, e.g. with the core timer around prvTraceUpdateCounters.
+ *
+ * @author
+ * Carlos Santos
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../trcSnapshotCompact.h"
+
+#define HWTC_HZ                 1250000u
+#define TICK_COUNTS             (HWTC_HZ / 1000u)
+
+/* Event codes, as in trcKernelPort.h */
+#define DIV_TASK_READY          0x02
+#define TS_TASK_RESUME          0x07
+#define KSE_QUEUE_SEND          0x30
+#define TASK_DELAY              0x89
+
+typedef struct {
+    uint8_t record[4];
+    uint32_t dts;
+    uint32_t param;
+    uint8_t layout;
+    uint8_t slots;
+} bench_event;
+
+static uint32_t rng_state;
+
+static uint32_t rnd(uint32_t n)
+{
+    /* xorshift32 */
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state % n;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: trcbench [-t ticks] [-e events/tick] [-j jitter%%] [-b bytes] [-s seed]\n");
+    exit(2);
+}
+
+static bench_event *add(bench_event *ev, size_t *n, uint8_t type, uint8_t handle, uint32_t dts, uint8_t layout)
+{
+    bench_event *e = &ev[(*n)++];
+
+    memset(e, 0, sizeof(*e));
+    e->record[0] = type;
+    e->record[1] = handle;
+    e->dts = dts;
+    e->layout = layout;
+    return e;
+}
+
+/* Builds the event stream. Events of a tick are spread over its first half,
+ * the rest of the tick is idle. */
+static size_t generate(bench_event *ev, uint32_t ticks, uint32_t per_tick, uint32_t jitter)
+{
+    size_t n = 0;
+    uint32_t t, k, last = 0, tick_time = 0;
+    uint8_t running = 1;
+
+    for(t = 1; t <= ticks; t++)
+    {
+        uint32_t now = t * TICK_COUNTS;
+        uint32_t count = per_tick ? rnd(2 * per_tick + 1) : 0;
+        bench_event *e;
+
+        if(rnd(100) < jitter)
+            now += 1 + rnd(3);
+        e = add(ev, &n, TRC_COMPACT_NEW_TIME, 0, now - last, TRC_COMPACT_LAYOUT_PARAM);
+        e->param = t;
+        last = tick_time = now;
+
+        for(k = 0; k < count; k++)
+        {
+            uint32_t kind = rnd(10);
+            uint32_t left = (tick_time + TICK_COUNTS / 2 > last) ? tick_time + TICK_COUNTS / 2 - last : 0;
+
+            now = last + 1 + rnd(left / (count - k) + 1);
+            if(kind < 3)
+            {
+                running = (uint8_t) (1 + rnd(6));
+                add(ev, &n, TS_TASK_RESUME, running, now - last, TRC_COMPACT_LAYOUT_HANDLE);
+            }
+            else if(kind < 5)
+                add(ev, &n, DIV_TASK_READY, (uint8_t) (1 + rnd(6)), now - last, TRC_COMPACT_LAYOUT_HANDLE);
+            else if(kind < 8)
+                add(ev, &n, KSE_QUEUE_SEND, (uint8_t) (7 + rnd(4)), now - last, TRC_COMPACT_LAYOUT_HANDLE);
+            else if(kind < 9)
+            {
+                e = add(ev, &n, TASK_DELAY, 0, now - last, TRC_COMPACT_LAYOUT_PARAM);
+                e->param = 1 + rnd(100);
+                e->record[2] = (uint8_t) e->param;
+            }
+            else
+            {
+                e = add(ev, &n, (uint8_t) (TRC_COMPACT_USER_EVENT + 1), 0, now - last, TRC_COMPACT_LAYOUT_OTHER);
+                e->record[2] = 0x21;    /* format string symbol */
+                e->slots = 1;
+            }
+            last = now;
+        }
+    }
+    return n;
+}
+
+/* Bytes the fixed records take for the stream, with XTS and XPS records */
+static uint64_t fixed_size(const bench_event *ev, size_t n)
+{
+    uint64_t bytes = 0;
+    size_t i;
+
+    for(i = 0; i < n; i++)
+    {
+        uint32_t max_dts = (ev[i].layout == TRC_COMPACT_LAYOUT_HANDLE) ? 0xFFFF : 0xFF;
+
+        bytes += 4 + 4 * (uint64_t) ev[i].slots;
+        if(ev[i].dts > max_dts)
+            bytes += 4;
+        if(ev[i].param > 0xFFFF)
+            bytes += 4;
+    }
+    return bytes;
+}
+
+static void to_compact(const bench_event *b, TraceCompactEvent *e)
+{
+    static const uint8_t args[4 * TRC_COMPACT_MAX_ARG_SLOTS];
+
+    e->record = b->record;
+    e->args = args;
+    e->argSlots = b->slots;
+    e->dts = b->dts;
+    e->param = b->param;
+    e->layout = b->layout;
+}
+
+/* Bytes the compact encoding takes for the stream, including the padding at
+ * the end of each block */
+static uint64_t compact_size(const bench_event *ev, size_t n, uint32_t block_size)
+{
+    TraceCompactRing ring;
+    TraceCompactEvent e;
+    size_t i;
+
+    memset(&ring, 0, sizeof(ring));
+    ring.size = (uint32_t) ((n * TRC_COMPACT_MAX_RECORD / block_size + 2) * block_size);
+    ring.blockSize = block_size;
+    ring.data = malloc(ring.size);
+    if(ring.data == NULL)
+    {
+        perror("trcbench");
+        exit(1);
+    }
+    for(i = 0; i < n; i++)
+    {
+        to_compact(&ev[i], &e);
+        prvTraceCompactWrite(&ring, &e);
+    }
+    free(ring.data);
+    return ring.next;
+}
+
+/* Host time per stored event, with the ring wrapping in a buffer of the
+ * target's size */
+static double compact_ns_per_event(const bench_event *ev, size_t n, uint32_t buffer, uint32_t block_size)
+{
+    TraceCompactRing ring;
+    TraceCompactEvent e;
+    struct timespec t0, t1;
+    uint32_t rounds = 0;
+    double ns;
+    size_t i;
+
+    memset(&ring, 0, sizeof(ring));
+    ring.size = buffer / block_size * block_size;
+    ring.blockSize = block_size;
+    ring.data = malloc(ring.size);
+    if(ring.data == NULL)
+    {
+        perror("trcbench");
+        exit(1);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    do
+    {
+        for(i = 0; i < n; i++)
+        {
+            to_compact(&ev[i], &e);
+            prvTraceCompactWrite(&ring, &e);
+        }
+        rounds++;
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+    } while(ns < 2e8);
+
+    free(ring.data);
+    return ns / ((double) rounds * n);
+}
+
+int main(int argc, char *argv[])
+{
+    static const uint32_t block_sizes[] = { 64, 200, 512 };
+    uint32_t ticks = 10000, per_tick = 4, jitter = 5, buffer = 4000, seed = 1;
+    bench_event *ev;
+    uint64_t fixed;
+    size_t n, i;
+    int a;
+
+    for(a = 1; a < argc; a++)
+    {
+        if(a + 1 >= argc || argv[a][0] != '-')
+            usage();
+        switch(argv[a][1])
+        {
+            case 't': ticks = (uint32_t) strtoul(argv[++a], NULL, 0); break;
+            case 'e': per_tick = (uint32_t) strtoul(argv[++a], NULL, 0); break;
+            case 'j': jitter = (uint32_t) strtoul(argv[++a], NULL, 0); break;
+            case 'b': buffer = (uint32_t) strtoul(argv[++a], NULL, 0); break;
+            case 's': seed = (uint32_t) strtoul(argv[++a], NULL, 0); break;
+            default: usage();
+        }
+    }
+    if(ticks == 0 || buffer < 2 * 512 || per_tick > 100)
+        usage();
+
+    rng_state = seed ? seed : 1;
+    ev = malloc(((size_t) ticks * (2 * per_tick + 1) + 1) * sizeof(*ev));
+    if(ev == NULL)
+    {
+        perror("trcbench");
+        return 1;
+    }
+    n = generate(ev, ticks, per_tick, jitter);
+    fixed = fixed_size(ev, n);
+
+    printf("%u ticks of 1 ms, %zu events, %u%% of ticks off the prediction\n\n", ticks, n, jitter);
+    printf("%-20s %10s %12s %16s\n", "encoding", "bytes/ms", "bytes/event", "ms in buffer");
+    printf("%-20s %10.1f %12.2f %16.0f\n", "fixed records",
+           (double) fixed / ticks, (double) fixed / n, (double) buffer * ticks / fixed);
+    for(i = 0; i < sizeof(block_sizes) / sizeof(block_sizes[0]); i++)
+    {
+        uint64_t bytes = compact_size(ev, n, block_sizes[i]);
+        char name[32];
+
+        snprintf(name, sizeof(name), "compact, block %u", block_sizes[i]);
+        printf("%-20s %10.1f %12.2f %16.0f   %.1f ns/event on this host\n", name,
+               (double) bytes / ticks, (double) bytes / n,
+               (double) (buffer / block_sizes[i] * block_sizes[i]) * ticks / bytes,
+               compact_ns_per_event(ev, n, buffer, block_sizes[i]));
+    }
+
+    free(ev);
+    return 0;
+}
@@ -0,0 +1,1323 @@
+/** @file trcdecode.c
+ *
+ * @brief Host side decoder for Tracealyzer snapshot trace dumps
+ *
+ * @par
+ * Reads the RecorderDataType structure written by trcSnapshotRecorder.c,
+ * either as saved by Tracealyzer (trace.bin) or as a raw RAM dump made by
+ * the debugger, and writes the task and ISR execution timeline together with
+ * the user events (vTracePrint / vTracePrintF) as CSV, JSON or Chrome
+ * trace-event JSON. The Chrome output loads in chrome://tracing and Perfetto.
+ *
+ * @par
+ * Build and run on any Linux host:
+ *
+ *     cc -O2 -Wall -o trcdecode trcdecode.c
+ *     ./trcdecode -f chrome -o trace.json ../trace.bin
+ *
+ * Several dumps can be given at once; each is then written next to its input
+ * with the format's extension appended (trace.bin.csv, ...).
+ *
+ * @par
+ * The event record layouts are those of recorder library v4.3 with 8 bit
+ * event handles (larger handles arrive through XID records). Timer, event
+ * group, stream buffer and task notification events are skipped - they are
+ * disabled in this project's trcConfig.h - but their timestamps are still
+ * accumulated so the timeline stays correct.
+ *
+ * @par
+ * Dumps made with TRC_CFG_COMPACT_EVENT_ENCODING (see trcSnapshotCompact.h),
+ * which Tracealyzer cannot read, are recognised by their minor version and
+ * decoded in the same way.
+ *
+ * @author
+ * Carlos Santos
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ----- Begin: Snapshot format constants (trcRecorder.h, trcKernelPort.h) ----- */
+#define TRC_VERSION             0x1AA1
+#define TRC_VERSION_SWAPPED     0xA11A
+
+#define CLASS_TASK              3
+#define CLASS_ISR               4
+
+#define NULL_EVENT              0x00
+#define DIV_XPS                 0x01
+#define DIV_TASK_READY          0x02
+#define DIV_NEW_TIME            0x03
+#define TS_ISR_BEGIN            0x04
+#define TS_ISR_RESUME           0x05
+#define TS_TASK_BEGIN           0x06
+#define TS_TASK_RESUME          0x07
+#define OBJCLOSE_NAME           0x08    /* + object class */
+#define OBJCLOSE_PROP           0x10    /* + object class */
+#define KSE_FIRST               0x18    /* kernel services on objects */
+#define KSE_LAST                0x87
+#define TASK_DELAY_UNTIL        0x88
+#define TASK_DELAY              0x89
+#define TASK_PRIORITY_SET       0x8D
+#define TASK_PRIORITY_DISINHERIT 0x8F
+#define MEM_MALLOC_SIZE         0x94
+#define MEM_FREE_ADDR           0x97
+#define USER_EVENT              0x98    /* + number of argument slots */
+#define USER_EVENT_LAST         0xA7
+#define XTS8                    0xA8
+#define XTS16                   0xA9
+#define EVENT_BEING_WRITTEN     0xAA
+#define LOW_POWER_BEGIN         0xAC
+#define LOW_POWER_END           0xAD
+#define XID                     0xAE
+#define XTS16L                  0xAF
+#define TRACE_UNUSED_STACK      0xEA
+
+#define MAX_HANDLES             65536
+
+/* Compact encoding, TRC_CFG_COMPACT_EVENT_ENCODING (trcSnapshotCompact.h) */
+#define C_MINOR_VERSION_FLAG    0x80    /* + block size / 8 */
+#define C_PAD                   0x00
+#define C_TICK_RUN              0xFF
+#define C_TICK                  0xFE
+#define C_RAW                   0xFD
+#define C_RAW_DTS               0xFC
+#define C_USER                  0xFB
+#define C_PARAM                 0xFA
+#define C_SMALL_HANDLES         15
+/* ----- End: Snapshot format constants ----- */
+
+/* ----- Begin: Decoder types ----- */
+typedef enum { FMT_CSV, FMT_JSON, FMT_CHROME } out_format;
+
+typedef struct {
+    const uint8_t *buf;         /* start of RecorderDataType */
+    size_t len;                 /* bytes available from buf */
+    int swapped;                /* target endianness differs from little endian */
+
+    uint32_t frequency;         /* timestamp ticks per second, 0 if unknown */
+    uint32_t abs_last;          /* time of the last event within its second */
+    uint32_t abs_last_second;
+    uint32_t num_events;
+    uint32_t max_events;
+    uint32_t next_free;         /* record index, or byte offset if block_size != 0 */
+    uint32_t full;
+    uint32_t block_size;        /* compact encoding block size, 0 for fixed size records */
+
+    /* Object property table */
+    uint32_t nclasses;
+    size_t objects_per_class;   /* offsets of the per class arrays */
+    int handles16;
+    size_t name_len_per_class;
+    size_t prop_bytes_per_class;
+    size_t start_index_of_class;
+    size_t objbytes;
+
+    /* Symbol table */
+    size_t symbytes;
+    uint32_t sym_size;
+
+    size_t event_data;
+    char system_info[81];
+} trace_dump;
+
+typedef struct {
+    uint8_t cls;                /* CLASS_TASK or CLASS_ISR */
+    uint16_t handle;
+    uint16_t generation;        /* handle reuse count, see actor_lookup() */
+    char name[64];
+} actor;
+
+typedef struct {
+    uint32_t actor;
+    uint64_t start;
+    uint64_t end;
+} slice;
+
+typedef struct {
+    uint32_t actor;             /* running when the event was stored, or ~0 */
+    uint64_t time;
+    char channel[64];
+    char text[256];
+} user_event;
+
+/* Everything produced from one dump. Reused between files so that batch runs
+ * do not allocate per file once the arrays have grown. */
+typedef struct {
+    actor *actors;
+    size_t nactors, actors_cap;
+    slice *slices;
+    size_t nslices, slices_cap;
+    user_event *users;
+    size_t nusers, users_cap;
+    uint64_t first_time;        /* absolute time of the first decoded event */
+    uint32_t decoded;           /* records decoded, including XTS/XPS */
+} timeline;
+/* ----- End: Decoder types ----- */
+
+/* Per handle state, indexed [0 = task, 1 = ISR][handle] */
+static uint16_t generation[2][MAX_HANDLES];
+static uint32_t actor_index[2][MAX_HANDLES];    /* 0 = none yet, else index + 1 */
+
+/* Names of objects that were deleted while recording, in close order */
+typedef struct {
+    uint8_t cls;
+    uint16_t handle;
+    uint16_t generation;
+    uint16_t symbol;
+} closed_name;
+
+static closed_name *closed;
+static size_t nclosed, closed_cap;
+
+static const char *prog = "trcdecode";
+
+/* ----- Begin: Byte access ----- */
+static uint16_t get16(int swapped, const uint8_t *p)
+{
+    return swapped ? (uint16_t) ((p[0] << 8) | p[1]) : (uint16_t) (p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(int swapped, const uint8_t *p)
+{
+    if(swapped)
+        return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3];
+    return p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static uint16_t rd16(const trace_dump *t, size_t off)
+{
+    return get16(t->swapped, t->buf + off);
+}
+
+static uint32_t rd32(const trace_dump *t, size_t off)
+{
+    return get32(t->swapped, t->buf + off);
+}
+
+/* Returns the offset of the first 4 byte aligned marker word at or after off,
+ * or 0 if there is none before limit. */
+static size_t find_marker(const trace_dump *t, size_t off, size_t limit, uint8_t marker)
+{
+    off = (off + 3) & ~(size_t) 3;
+    for(; off + 4 <= limit; off += 4)
+    {
+        const uint8_t *p = t->buf + off;
+
+        if(p[0] == marker && p[1] == marker && p[2] == marker && p[3] == marker)
+            return off;
+    }
+    return 0;
+}
+
+static void *grow(void *array, size_t *cap, size_t need, size_t size)
+{
+    if(need > *cap)
+    {
+        size_t n = *cap ? *cap * 2 : 256;
+
+        while(n < need)
+            n *= 2;
+        array = realloc(array, n * size);
+        if(array == NULL)
+        {
+            fprintf(stderr, "%s: out of memory\n", prog);
+            exit(1);
+        }
+        *cap = n;
+    }
+    return array;
+}
+/* ----- End: Byte access ----- */
+
+/* ----- Begin: Dump parsing ----- */
+/* parse_dump Function Description *******************************************
+SYNTAX:         static const char *parse_dump(trace_dump *t,
+                                              const uint8_t *buf, size_t len);
+DESCRIPTION:    Locates RecorderDataType in buf and fills in t. The header
+                fields are at fixed offsets; the object table, symbol table
+                and event buffer are found through the debug markers the
+                recorder places between them, so dumps from recorders built
+                with other table sizes decode too.
+RETURN VALUE:   NULL on success, otherwise a description of the problem.
+END DESCRIPTION ************************************************************/
+static const char *parse_dump(trace_dump *t, const uint8_t *buf, size_t len)
+{
+    static const uint8_t start_markers[12] = {
+        0x01, 0x02, 0x03, 0x04, 0x71, 0x72, 0x73, 0x74, 0xF1, 0xF2, 0xF3, 0xF4
+    };
+    size_t off, m0, m1, m2, m3, n, i;
+    uint16_t version;
+
+    memset(t, 0, sizeof(*t));
+
+    /* Raw RAM dumps start with the start markers, possibly after unrelated
+     * memory; Tracealyzer's trace.bin starts at the version field. */
+    off = 0;
+    for(i = 0; i + sizeof(start_markers) <= len; i += 4)
+    {
+        if(memcmp(buf + i, start_markers, sizeof(start_markers)) == 0)
+        {
+            off = i + sizeof(start_markers);
+            break;
+        }
+    }
+    if(len < off + 0x60)
+        return "file too short";
+
+    t->buf = buf + off;
+    t->len = len - off;
+    version = (uint16_t) (t->buf[0] | (t->buf[1] << 8));
+    if(version == TRC_VERSION_SWAPPED)
+        t->swapped = 1;
+    else if(version != TRC_VERSION)
+        return "not a snapshot trace (bad version field)";
+
+    if(t->buf[2] & C_MINOR_VERSION_FLAG)
+        t->block_size = (uint32_t) (t->buf[2] & ~C_MINOR_VERSION_FLAG) * 8;
+    t->num_events = rd32(t, 0x08);
+    t->max_events = rd32(t, 0x0C);
+    t->next_free = rd32(t, 0x10);
+    t->full = rd32(t, 0x14);
+    t->frequency = rd32(t, 0x18);
+    t->abs_last = rd32(t, 0x1C);
+    t->abs_last_second = rd32(t, 0x20);
+
+    m0 = find_marker(t, 0x28, t->len < 0x100 ? t->len : 0x100, 0xF0);
+    if(m0 == 0)
+        return "debug marker 0 not found";
+
+    /* Object property table, after isUsing16bitHandles */
+    off = m0 + 8;
+    if(off + 8 > t->len)
+        return "truncated object table";
+    t->handles16 = rd32(t, m0 + 4) != 0;
+    t->nclasses = rd32(t, off);
+    if(t->nclasses == 0 || t->nclasses > 32)
+        return "bad number of object classes";
+    n = rd32(t, off + 4);
+    off += 8;
+    t->objects_per_class = off;
+    off += t->handles16 ? 4 * ((t->nclasses + 1) / 2) : 4 * ((t->nclasses + 3) / 4);
+    t->name_len_per_class = off;
+    off += 4 * ((t->nclasses + 3) / 4);
+    t->prop_bytes_per_class = off;
+    off += 4 * ((t->nclasses + 3) / 4);
+    t->start_index_of_class = off;
+    off += 2 * (2 * ((t->nclasses + 1) / 2));
+    t->objbytes = off;
+    off += 4 * ((n + 3) / 4);
+
+    if(off + 4 <= t->len && rd32(t, off) == 0xF1F1F1F1)
+        m1 = off;
+    else if((m1 = find_marker(t, t->objbytes, t->len, 0xF1)) == 0)
+        return "debug marker 1 not found";
+    if(m1 < t->objbytes + n)
+        return "object table larger than its space";
+
+    /* Symbol table */
+    if(m1 + 12 > t->len)
+        return "truncated symbol table";
+    t->sym_size = rd32(t, m1 + 4);
+    t->symbytes = m1 + 12;
+    if(t->symbytes + t->sym_size > t->len)
+        return "truncated symbol table";
+
+    m2 = find_marker(t, t->symbytes + t->sym_size, t->len, 0xF2);
+    if(m2 == 0)
+        return "debug marker 2 not found";
+    m3 = find_marker(t, m2 + 4, t->len, 0xF3);
+    if(m3 == 0)
+        return "debug marker 3 not found";
+
+    n = m3 - (m2 + 4);
+    if(n > sizeof(t->system_info) - 1)
+        n = sizeof(t->system_info) - 1;
+    memcpy(t->system_info, t->buf + m2 + 4, n);
+    t->system_info[n] = '\0';
+
+    t->event_data = m3 + 4;
+    if(t->max_events == 0 || t->next_free > (t->block_size ? t->max_events * 4 : t->max_events))
+        return "bad event buffer header";
+    if(t->block_size != 0 && (t->block_size < 64 || t->block_size > t->max_events * 4))
+        return "bad compact block size";
+    if(t->event_data + (size_t) t->max_events * 4 > t->len)
+    {
+        /* Truncated dump - keep what is there unless the ring has wrapped,
+         * in which case the oldest events are the ones that are missing. */
+        uint32_t have = (uint32_t) ((t->len - t->event_data) / 4);
+
+        if(t->full || (t->block_size ? have * 4 : have) < t->next_free)
+            return "event buffer truncated";
+        t->max_events = have;
+    }
+    return NULL;
+}
+
+static uint32_t objects_in_class(const trace_dump *t, unsigned cls)
+{
+    if(cls >= t->nclasses)
+        return 0;
+    if(t->handles16)
+        return rd16(t, t->objects_per_class + 2 * cls);
+    return t->buf[t->objects_per_class + cls];
+}
+
+/* Copies a NUL terminated string of at most max bytes, replacing anything
+ * unprintable. Returns the length copied. */
+static size_t copy_string(char *dst, size_t dst_len, const uint8_t *src, size_t max)
+{
+    size_t n = 0;
+
+    while(n < max && n + 1 < dst_len && src[n] != '\0')
+    {
+        dst[n] = (src[n] >= 0x20 && src[n] < 0x7F) ? (char) src[n] : '?';
+        n++;
+    }
+    dst[n] = '\0';
+    return n;
+}
+
+/* Name of an object that still exists, from the object property table */
+static void object_name(const trace_dump *t, unsigned cls, unsigned handle, char *dst, size_t dst_len)
+{
+    size_t off;
+    unsigned name_len, prop_bytes;
+
+    dst[0] = '\0';
+    if(handle == 0 || handle > objects_in_class(t, cls))
+        return;
+
+    name_len = t->buf[t->name_len_per_class + cls];
+    prop_bytes = t->buf[t->prop_bytes_per_class + cls];
+    off = t->objbytes + rd16(t, t->start_index_of_class + 2 * cls) + (size_t) (handle - 1) * prop_bytes;
+    if(off + name_len > t->len)
+        return;
+    copy_string(dst, dst_len, t->buf + off, name_len);
+}
+
+/* A symbol table entry is a 16 bit hash chain link, the 16 bit index of its
+ * channel's symbol (0 for none) and then the string. */
+static const uint8_t *symbol(const trace_dump *t, uint32_t index, uint16_t *channel)
+{
+    if(index == 0 || index + 4 >= t->sym_size)
+        return NULL;
+    if(channel != NULL)
+        *channel = rd16(t, t->symbytes + index + 2);
+    return t->buf + t->symbytes + index + 4;
+}
+
+static void symbol_string(const trace_dump *t, uint32_t index, char *dst, size_t dst_len)
+{
+    const uint8_t *s = symbol(t, index, NULL);
+
+    dst[0] = '\0';
+    if(s != NULL)
+        copy_string(dst, dst_len, s, t->sym_size - index - 4);
+}
+/* ----- End: Dump parsing ----- */
+
+/* ----- Begin: Event decoding ----- */
+/* Returns the index of the actor for a task or ISR handle, creating it on
+ * first use. The generation counts the OBJCLOSE_NAME records seen for the
+ * handle so far, which tells apart objects that reused a deleted one's
+ * handle; names are filled in by name_actors() once all closes are known. */
+static uint32_t actor_lookup(timeline *tl, uint8_t cls, uint16_t handle)
+{
+    int k = (cls == CLASS_ISR);
+    uint32_t i = actor_index[k][handle];
+    actor *a;
+
+    if(i != 0 && tl->actors[i - 1].generation == generation[k][handle])
+        return i - 1;
+
+    tl->actors = grow(tl->actors, &tl->actors_cap, tl->nactors + 1, sizeof(actor));
+    a = &tl->actors[tl->nactors];
+    a->cls = cls;
+    a->handle = handle;
+    a->generation = generation[k][handle];
+    a->name[0] = '\0';
+    actor_index[k][handle] = (uint32_t) ++tl->nactors;
+    return tl->nactors - 1;
+}
+
+static void name_actors(const trace_dump *t, timeline *tl)
+{
+    size_t i, j;
+
+    for(i = 0; i < tl->nactors; i++)
+    {
+        actor *a = &tl->actors[i];
+
+        for(j = 0; j < nclosed; j++)
+        {
+            if(closed[j].cls == a->cls && closed[j].handle == a->handle && closed[j].generation == a->generation)
+            {
+                symbol_string(t, closed[j].symbol, a->name, sizeof(a->name));
+                break;
+            }
+        }
+        if(j == nclosed)
+            object_name(t, a->cls, a->handle, a->name, sizeof(a->name));
+        if(a->name[0] == '\0')
+            snprintf(a->name, sizeof(a->name), "%s #%u", a->cls == CLASS_ISR ? "ISR" : "Task", a->handle);
+    }
+}
+
+/* format_user_event Function Description ************************************
+SYNTAX:         static void format_user_event(const trace_dump *t,
+                        const char *fmt, const uint8_t *args, size_t nargs,
+                        char *dst, size_t dst_len);
+DESCRIPTION:    Expands a vTracePrintF format string with the arguments that
+                prvTraceUserEventFormat() packed after the event record:
+                %d %u %x and %f take 4 aligned bytes, %lf 8, %hd/%hu 2,
+                %bd/%bu 1 and %s a 2 byte symbol table index.
+END DESCRIPTION ************************************************************/
+static void format_user_event(const trace_dump *t, const char *fmt, const uint8_t *args, size_t nargs,
+                              char *dst, size_t dst_len)
+{
+    size_t i = 0, n = 0;
+    char spec[16], val[128];
+
+    while(*fmt != '\0' && n + 1 < dst_len)
+    {
+        const char *start;
+        size_t speclen;
+        uint32_t v = 0;
+        int width = 0;
+
+        if(*fmt != '%')
+        {
+            dst[n++] = *fmt++;
+            continue;
+        }
+        if(fmt[1] == '%')
+        {
+            dst[n++] = '%';
+            fmt += 2;
+            continue;
+        }
+
+        start = fmt++;
+        while((*fmt >= '0' && *fmt <= '9') || *fmt == '#' || *fmt == '.')
+            fmt++;
+        if(*fmt == 'l' || *fmt == 'h' || *fmt == 'b')
+            width = *fmt++;
+        if(*fmt == '\0')
+            break;
+        speclen = (size_t) (fmt - start) + 1;
+        if(speclen >= sizeof(spec) - 2)
+            speclen = sizeof(spec) - 3;
+        memcpy(spec, start, speclen);
+        spec[speclen] = '\0';
+
+        val[0] = '\0';
+        switch(*fmt)
+        {
+            case 'd': case 'u': case 'x': case 'X':
+                if(width == 'b')
+                {
+                    if(i + 1 <= nargs)
+                        v = args[i];
+                    i += 1;
+                    if(*fmt == 'd')
+                        v = (uint32_t) (int32_t) (int8_t) v;
+                }
+                else if(width == 'h')
+                {
+                    i = (i + 1) & ~(size_t) 1;
+                    if(i + 2 <= nargs)
+                        v = get16(t->swapped, args + i);
+                    i += 2;
+                    if(*fmt == 'd')
+                        v = (uint32_t) (int32_t) (int16_t) v;
+                }
+                else
+                {
+                    i = (i + 3) & ~(size_t) 3;
+                    if(i + 4 <= nargs)
+                        v = get32(t->swapped, args + i);
+                    i += 4;
+                }
+                /* Drop the b/h/l modifier, print through a plain int spec */
+                spec[speclen - 1 - (width != 0)] = *fmt;
+                spec[speclen - (width != 0)] = '\0';
+                if(*fmt == 'd')
+                    snprintf(val, sizeof(val), spec, (int) (int32_t) v);
+                else
+                    snprintf(val, sizeof(val), spec, (unsigned) v);
+                break;
+
+            case 's':
+                i = (i + 1) & ~(size_t) 1;
+                if(i + 2 <= nargs)
+                    symbol_string(t, get16(t->swapped, args + i), val, sizeof(val));
+                i += 2;
+                break;
+
+            case 'f':
+            {
+                double d = 0;
+
+                i = (i + 3) & ~(size_t) 3;
+                if(width == 'l')
+                {
+                    uint64_t bits = 0;
+
+                    if(i + 8 <= nargs)
+                        bits = get32(t->swapped, args + i) | ((uint64_t) get32(t->swapped, args + i + 4) << 32);
+                    memcpy(&d, &bits, sizeof(d));
+                    i += 8;
+                }
+                else
+                {
+                    float f = 0;
+
+                    if(i + 4 <= nargs)
+                        v = get32(t->swapped, args + i);
+                    memcpy(&f, &v, sizeof(f));
+                    d = f;
+                    i += 4;
+                }
+                spec[speclen - 1 - (width != 0)] = 'f';
+                spec[speclen - (width != 0)] = '\0';
+                snprintf(val, sizeof(val), spec, d);
+                break;
+            }
+
+            default:
+                /* Not a conversion the recorder understands - copy it as is */
+                snprintf(val, sizeof(val), "%s", spec);
+                break;
+        }
+        fmt++;
+        n += (size_t) snprintf(dst + n, dst_len - n, "%s", val);
+        if(n >= dst_len)
+            n = dst_len - 1;
+    }
+    dst[n] = '\0';
+}
+
+/* Width of the timestamp difference stored in an event record: 0 for records
+ * without one, 8 or 16 bits otherwise, and where it is stored. */
+static int dts_field(uint8_t type, int *pos)
+{
+    if(type == DIV_TASK_READY || (type >= TS_ISR_BEGIN && type <= TS_TASK_RESUME) ||
+       type == LOW_POWER_BEGIN || type == LOW_POWER_END)
+    {
+        *pos = 2;
+        return 16;
+    }
+    if(type == DIV_NEW_TIME || type == TASK_DELAY_UNTIL || type == TASK_DELAY ||
+       (type >= USER_EVENT && type <= USER_EVENT_LAST) ||
+       (type >= MEM_MALLOC_SIZE && type <= MEM_FREE_ADDR && (type & 1) == 0))
+    {
+        *pos = 1;
+        return 8;
+    }
+    if((type >= TASK_PRIORITY_SET && type <= TASK_PRIORITY_DISINHERIT) || type == TRACE_UNUSED_STACK)
+    {
+        *pos = 3;
+        return 8;
+    }
+    if(type < KSE_FIRST || (type >= MEM_MALLOC_SIZE && type <= MEM_FREE_ADDR) ||
+       (type >= XTS8 && type <= XTS16L))
+        return 0;
+    /* KernelCall: handle in byte 1, 16 bit dts in bytes 2-3 */
+    *pos = 2;
+    return 16;
+}
+
+static void add_slice(timeline *tl, uint32_t a, uint64_t start, uint64_t end)
+{
+    slice *s;
+
+    if(end <= start)
+        return;
+    tl->slices = grow(tl->slices, &tl->slices_cap, tl->nslices + 1, sizeof(slice));
+    s = &tl->slices[tl->nslices++];
+    s->actor = a;
+    s->start = start;
+    s->end = end;
+}
+
+/* Running state of the event walk */
+typedef struct {
+    uint64_t now;               /* time of the current record, from the first one */
+    uint64_t run_start;
+    uint32_t running;           /* actor index, or UINT32_MAX before the first switch */
+    uint32_t xid;
+    int have_xid;
+} walk_state;
+
+/* apply_record Function Description ******************************************
+SYNTAX:         static void apply_record(const trace_dump *t, timeline *tl,
+                    walk_state *w, const uint8_t *e, const uint8_t *args,
+                    uint32_t nslots);
+DESCRIPTION:    Applies one 4 byte record, whose timestamp has already been
+                added to w->now, to the timeline. args holds the nslots
+                argument slots of a user event.
+END DESCRIPTION ************************************************************/
+static void apply_record(const trace_dump *t, timeline *tl, walk_state *w,
+                         const uint8_t *e, const uint8_t *args, uint32_t nslots)
+{
+    uint8_t type = e[0];
+    uint16_t handle;
+
+    tl->decoded++;
+    if(type == XID)
+    {
+        w->have_xid = 1;
+        w->xid = get16(t->swapped, e + 2);
+        return;
+    }
+    if(type == DIV_XPS)
+        return;     /* Only extends numeric parameters, which are not exported */
+
+    handle = e[1];
+    if(w->have_xid && handle == 255)
+        handle = (uint16_t) w->xid;
+    w->have_xid = 0;
+
+    if(type >= TS_ISR_BEGIN && type <= TS_TASK_RESUME)
+    {
+        uint32_t a = actor_lookup(tl, type <= TS_ISR_RESUME ? CLASS_ISR : CLASS_TASK, handle);
+
+        if(w->running != UINT32_MAX)
+            add_slice(tl, w->running, w->run_start, w->now);
+        w->running = a;
+        w->run_start = w->now;
+    }
+    else if(type >= OBJCLOSE_NAME && type < OBJCLOSE_PROP)
+    {
+        uint8_t cls = (uint8_t) (type - OBJCLOSE_NAME);
+
+        if(cls == CLASS_TASK || cls == CLASS_ISR)
+        {
+            int g = (cls == CLASS_ISR);
+
+            closed = grow(closed, &closed_cap, nclosed + 1, sizeof(closed_name));
+            closed[nclosed].cls = cls;
+            closed[nclosed].handle = handle;
+            closed[nclosed].generation = generation[g][handle];
+            closed[nclosed].symbol = get16(t->swapped, e + 2);
+            nclosed++;
+            generation[g][handle]++;
+        }
+    }
+    else if(type >= USER_EVENT && type <= USER_EVENT_LAST)
+    {
+        uint16_t channel = 0;
+        const uint8_t *fmt;
+        char fmtbuf[256];
+        user_event *u;
+
+        tl->users = grow(tl->users, &tl->users_cap, tl->nusers + 1, sizeof(user_event));
+        u = &tl->users[tl->nusers++];
+        u->actor = w->running;
+        u->time = w->now;
+        u->channel[0] = '\0';
+
+        fmt = symbol(t, get16(t->swapped, e + 2), &channel);
+        if(fmt == NULL)
+        {
+            snprintf(u->text, sizeof(u->text), "<symbol %u>", get16(t->swapped, e + 2));
+            return;
+        }
+        copy_string(fmtbuf, sizeof(fmtbuf), fmt, t->sym_size - (size_t) (fmt - (t->buf + t->symbytes)));
+        symbol_string(t, channel, u->channel, sizeof(u->channel));
+        format_user_event(t, fmtbuf, args, nslots * 4, u->text, sizeof(u->text));
+    }
+}
+
+/* Walks the fixed size records from the oldest to the newest, adding the
+ * high timestamp bits from XTS records. */
+static void decode_fixed(const trace_dump *t, timeline *tl, walk_state *w)
+{
+    uint32_t count, k, idx;
+    uint32_t xts_hi = 0;
+    int xts = 0;
+
+    count = t->full ? t->max_events : t->next_free;
+    idx = t->full ? t->next_free : 0;
+
+    for(k = 0; k < count; k++, idx = (idx + 1 == t->max_events) ? 0 : idx + 1)
+    {
+        const uint8_t *e = t->buf + t->event_data + (size_t) idx * 4;
+        uint8_t type = e[0];
+        uint8_t args[15 * 4];
+        uint32_t nslots = 0;
+        int bits, pos = 0;
+
+        if(type == NULL_EVENT || type == EVENT_BEING_WRITTEN)
+            continue;
+
+        if(type == XTS8)
+        {
+            xts = XTS8;
+            xts_hi = ((uint32_t) e[1] << 24) | ((uint32_t) get16(t->swapped, e + 2) << 8);
+            tl->decoded++;
+            continue;
+        }
+        if(type == XTS16)
+        {
+            xts = XTS16;
+            xts_hi = (uint32_t) get16(t->swapped, e + 2) << 16;
+            tl->decoded++;
+            continue;
+        }
+
+        bits = (type == XID || type == DIV_XPS) ? 0 : dts_field(type, &pos);
+        if(bits != 0)
+        {
+            uint32_t dts = (bits == 16) ? get16(t->swapped, e + pos) : e[pos];
+
+            if(xts != 0)
+                dts |= xts_hi;
+            w->now += dts;
+            xts = 0;
+        }
+
+        /* Argument slots are contiguous; the recorder never splits an event
+         * across the end of the ring. */
+        if(type >= USER_EVENT && type <= USER_EVENT_LAST)
+        {
+            for(; nslots < (uint32_t) (type - USER_EVENT) && k + 1 < count; nslots++)
+            {
+                idx = (idx + 1 == t->max_events) ? 0 : idx + 1;
+                k++;
+                memcpy(&args[nslots * 4], t->buf + t->event_data + (size_t) idx * 4, 4);
+            }
+        }
+        apply_record(t, tl, w, e, args, nslots);
+    }
+}
+
+/* Reads a varint at *p, not past end. Returns 0 if it is cut off. */
+static int get_varint(const uint8_t **p, const uint8_t *end, uint64_t *value)
+{
+    unsigned shift = 0;
+
+    *value = 0;
+    while(*p < end && shift < 64)
+    {
+        uint8_t b = *(*p)++;
+
+        *value |= (uint64_t) (b & 0x7F) << shift;
+        if((b & 0x80) == 0)
+            return 1;
+        shift += 7;
+    }
+    return 0;
+}
+
+/* decode_block Function Description ******************************************
+SYNTAX:         static void decode_block(const trace_dump *t, timeline *tl,
+                    walk_state *w, const uint8_t *p, const uint8_t *end);
+DESCRIPTION:    Decodes the compact records of one block (trcSnapshotCompact.h)
+                up to the padding or end. Tick prediction starts over in
+                every block, as in the encoder.
+END DESCRIPTION ************************************************************/
+static void decode_block(const trace_dump *t, timeline *tl, walk_state *w, const uint8_t *p, const uint8_t *end)
+{
+    uint64_t tick_time = 0, period = 0, v, dts;
+    uint8_t e[4];
+
+    while(p < end && *p != C_PAD)
+    {
+        uint8_t op = *p++;
+        uint32_t n;
+
+        switch(op)
+        {
+            case C_TICK_RUN:
+                if(p >= end)
+                    return;
+                for(n = *p++; n > 0; n--)
+                {
+                    tick_time += period;
+                    tl->decoded++;
+                }
+                w->now = tick_time;
+                continue;
+            case C_TICK:
+                if(!get_varint(&p, end, &v))
+                    return;
+                /* Residual from the predicted time, zigzag coded */
+                w->now = tick_time + period + (uint64_t) (int64_t) ((int32_t) (v >> 1) ^ -(int32_t) (v & 1));
+                period = w->now - tick_time;
+                tick_time = w->now;
+                tl->decoded++;
+                continue;
+            case DIV_NEW_TIME:
+                if(!get_varint(&p, end, &dts) || !get_varint(&p, end, &v))
+                    return;
+                w->now += dts;
+                tick_time = w->now;
+                period = 0;
+                tl->decoded++;
+                continue;
+            case C_RAW:
+            case C_RAW_DTS:
+                if(op == C_RAW_DTS)
+                {
+                    if(!get_varint(&p, end, &dts))
+                        return;
+                    w->now += dts;
+                }
+                if(end - p < 4)
+                    return;
+                memcpy(e, p, 4);
+                p += 4;
+                apply_record(t, tl, w, e, NULL, 0);
+                continue;
+            case C_PARAM:
+                /* Type, then DTS and full parameter as varints */
+                if(p >= end)
+                    return;
+                e[0] = *p++;
+                if(!get_varint(&p, end, &dts) || !get_varint(&p, end, &v))
+                    return;
+                w->now += dts;
+                e[1] = e[2] = e[3] = 0;
+                apply_record(t, tl, w, e, NULL, 0);
+                continue;
+            case C_USER:
+                if(p >= end)
+                    return;
+                n = *p++;
+                if(!get_varint(&p, end, &dts) || n > 15 || (size_t) (end - p) < 2 + 4 * (size_t) n)
+                    return;
+                w->now += dts;
+                e[0] = (uint8_t) (USER_EVENT + n);
+                e[1] = 0;
+                e[2] = p[0];
+                e[3] = p[1];
+                apply_record(t, tl, w, e, p + 2, n);
+                p += 2 + 4 * n;
+                continue;
+            default:
+                /* Handle packed into the low bits of the timestamp */
+                if(!get_varint(&p, end, &v))
+                    return;
+                e[0] = op;
+                e[1] = (uint8_t) (v & 0xF);
+                if(e[1] == C_SMALL_HANDLES)
+                {
+                    if(p >= end)
+                        return;
+                    e[1] = *p++;
+                }
+                e[2] = e[3] = 0;
+                w->now += v >> 4;
+                apply_record(t, tl, w, e, NULL, 0);
+                continue;
+        }
+    }
+}
+
+/* Walks the compact blocks from the oldest to the newest. next_free is the
+ * byte offset after the newest record. */
+static void decode_compact(const trace_dump *t, timeline *tl, walk_state *w)
+{
+    uint32_t nblocks = t->max_events * 4 / t->block_size;
+    uint32_t cur, b;
+
+    if(t->next_free == 0 || nblocks == 0)
+        return;
+    cur = (t->next_free - 1) / t->block_size;
+    b = (t->full && cur + 1 < nblocks) ? cur + 1 : 0;
+    for(;;)
+    {
+        const uint8_t *p = t->buf + t->event_data + (size_t) b * t->block_size;
+        uint32_t used = (b == cur) ? t->next_free - b * t->block_size : t->block_size;
+
+        decode_block(t, tl, w, p, p + used);
+        if(b == cur)
+            break;
+        b = (b + 1 == nblocks) ? 0 : b + 1;
+    }
+}
+
+/* decode_events Function Description ****************************************
+SYNTAX:         static void decode_events(const trace_dump *t, timeline *tl);
+DESCRIPTION:    Walks the event buffer from the oldest record to the newest,
+                accumulating the differential timestamps and switching the
+                running actor on every TS_* record. Times are first kept
+                relative to the first record and then shifted so that the
+                last record lands on the absolute time the recorder stored
+                in its header.
+END DESCRIPTION ************************************************************/
+static void decode_events(const trace_dump *t, timeline *tl)
+{
+    walk_state w;
+    uint64_t end_abs, shift;
+    size_t i;
+
+    tl->nactors = tl->nslices = tl->nusers = 0;
+    tl->decoded = 0;
+    nclosed = 0;
+    memset(generation, 0, sizeof(generation));
+    memset(actor_index, 0, sizeof(actor_index));
+    memset(&w, 0, sizeof(w));
+    w.running = UINT32_MAX;
+
+    if(t->block_size != 0)
+        decode_compact(t, tl, &w);
+    else
+        decode_fixed(t, tl, &w);
+
+    if(w.running != UINT32_MAX)
+        add_slice(tl, w.running, w.run_start, w.now);
+
+    /* Anchor the timeline on the absolute time of the last event */
+    end_abs = (uint64_t) t->abs_last_second * t->frequency + t->abs_last;
+    shift = (end_abs >= w.now) ? end_abs - w.now : 0;
+    for(i = 0; i < tl->nslices; i++)
+    {
+        tl->slices[i].start += shift;
+        tl->slices[i].end += shift;
+    }
+    for(i = 0; i < tl->nusers; i++)
+        tl->users[i].time += shift;
+    tl->first_time = shift;
+
+    name_actors(t, tl);
+}
+/* ----- End: Event decoding ----- */
+
+/* ----- Begin: Output ----- */
+/* Writes a time as microseconds with nanosecond resolution. With an unknown
+ * timestamp frequency the raw tick count is written instead. */
+static void put_time(FILE *f, const trace_dump *t, uint64_t ticks)
+{
+    uint64_t ns;
+
+    if(t->frequency == 0)
+    {
+        fprintf(f, "%llu", (unsigned long long) ticks);
+        return;
+    }
+    ns = (ticks / t->frequency) * 1000000000u + (ticks % t->frequency) * 1000000000u / t->frequency;
+    fprintf(f, "%llu.%03u", (unsigned long long) (ns / 1000), (unsigned) (ns % 1000));
+}
+
+/* Writes s as the body of a JSON string */
+static void put_json(FILE *f, const char *s)
+{
+    for(; *s != '\0'; s++)
+    {
+        if(*s == '"' || *s == '\\')
+            fputc('\\', f);
+        fputc(*s, f);
+    }
+}
+
+/* Writes s as a CSV field, quoted when it needs to be */
+static void put_csv(FILE *f, const char *s)
+{
+    if(strpbrk(s, ",\"\n") == NULL)
+    {
+        fputs(s, f);
+        return;
+    }
+    fputc('"', f);
+    for(; *s != '\0'; s++)
+    {
+        if(*s == '"')
+            fputc('"', f);
+        fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+static const char *actor_kind(const actor *a)
+{
+    return a->cls == CLASS_ISR ? "isr" : "task";
+}
+
+static void write_csv(FILE *f, const trace_dump *t, const timeline *tl)
+{
+    size_t i;
+
+    fputs("kind,actor,handle,start_us,end_us,duration_us,channel,text\n", f);
+    for(i = 0; i < tl->nslices; i++)
+    {
+        const slice *s = &tl->slices[i];
+        const actor *a = &tl->actors[s->actor];
+
+        fprintf(f, "%s,", actor_kind(a));
+        put_csv(f, a->name);
+        fprintf(f, ",%u,", a->handle);
+        put_time(f, t, s->start);
+        fputc(',', f);
+        put_time(f, t, s->end);
+        fputc(',', f);
+        put_time(f, t, s->end - s->start);
+        fputs(",,\n", f);
+    }
+    for(i = 0; i < tl->nusers; i++)
+    {
+        const user_event *u = &tl->users[i];
+
+        fputs("user,", f);
+        if(u->actor != UINT32_MAX)
+        {
+            put_csv(f, tl->actors[u->actor].name);
+            fprintf(f, ",%u,", tl->actors[u->actor].handle);
+        }
+        else
+            fputs(",,", f);
+        put_time(f, t, u->time);
+        fputc(',', f);
+        put_time(f, t, u->time);
+        fputs(",0,", f);
+        put_csv(f, u->channel);
+        fputc(',', f);
+        put_csv(f, u->text);
+        fputc('\n', f);
+    }
+}
+
+static void write_json(FILE *f, const trace_dump *t, const timeline *tl)
+{
+    size_t i;
+
+    fputs("{\n  \"system\": \"", f);
+    put_json(f, t->system_info);
+    fprintf(f, "\",\n  \"frequency\": %u,\n  \"time_unit\": \"%s\",\n  \"events\": %u,\n  \"wrapped\": %s,\n",
+            t->frequency, t->frequency ? "us" : "ticks", tl->decoded, t->full ? "true" : "false");
+
+    fputs("  \"actors\": [", f);
+    for(i = 0; i < tl->nactors; i++)
+    {
+        fprintf(f, "%s\n    {\"id\": %u, \"kind\": \"%s\", \"handle\": %u, \"name\": \"", i ? "," : "",
+                (unsigned) i, actor_kind(&tl->actors[i]), tl->actors[i].handle);
+        put_json(f, tl->actors[i].name);
+        fputs("\"}", f);
+    }
+    fputs("\n  ],\n  \"slices\": [", f);
+    for(i = 0; i < tl->nslices; i++)
+    {
+        fprintf(f, "%s\n    {\"actor\": %u, \"start\": ", i ? "," : "", tl->slices[i].actor);
+        put_time(f, t, tl->slices[i].start);
+        fputs(", \"end\": ", f);
+        put_time(f, t, tl->slices[i].end);
+        fputc('}', f);
+    }
+    fputs("\n  ],\n  \"user_events\": [", f);
+    for(i = 0; i < tl->nusers; i++)
+    {
+        const user_event *u = &tl->users[i];
+
+        fputs(i ? ",\n    {\"time\": " : "\n    {\"time\": ", f);
+        put_time(f, t, u->time);
+        if(u->actor != UINT32_MAX)
+            fprintf(f, ", \"actor\": %u", u->actor);
+        fputs(", \"channel\": \"", f);
+        put_json(f, u->channel);
+        fputs("\", \"text\": \"", f);
+        put_json(f, u->text);
+        fputs("\"}", f);
+    }
+    fputs("\n  ]\n}\n", f);
+}
+
+/* Chrome trace-event format: one thread per task and per ISR, execution
+ * slices as complete ("X") events and user events as thread scoped instant
+ * ("i") events. Timestamps are in microseconds. */
+static void write_chrome(FILE *f, const trace_dump *t, const timeline *tl)
+{
+    size_t i;
+    int first = 1;
+
+    fputs("{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n", f);
+    for(i = 0; i < tl->nactors; i++)
+    {
+        fprintf(f, "%s{\"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"name\": \"thread_name\", \"args\": {\"name\": \"",
+                first ? "" : ",\n", (unsigned) i + 1);
+        put_json(f, tl->actors[i].name);
+        fputs("\"}}", f);
+        /* ISRs sort above the tasks they interrupt */
+        fprintf(f, ",\n{\"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"name\": \"thread_sort_index\", \"args\": {\"sort_index\": %u}}",
+                (unsigned) i + 1, (tl->actors[i].cls == CLASS_ISR ? 0u : 1000u) + (unsigned) i);
+        first = 0;
+    }
+    for(i = 0; i < tl->nslices; i++)
+    {
+        const slice *s = &tl->slices[i];
+
+        fprintf(f, "%s{\"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"cat\": \"%s\", \"name\": \"", first ? "" : ",\n",
+                s->actor + 1, actor_kind(&tl->actors[s->actor]));
+        put_json(f, tl->actors[s->actor].name);
+        fputs("\", \"ts\": ", f);
+        put_time(f, t, s->start);
+        fputs(", \"dur\": ", f);
+        put_time(f, t, s->end - s->start);
+        fputc('}', f);
+        first = 0;
+    }
+    for(i = 0; i < tl->nusers; i++)
+    {
+        const user_event *u = &tl->users[i];
+
+        fprintf(f, "%s{\"ph\": \"i\", \"s\": \"t\", \"pid\": 1, \"tid\": %u, \"cat\": \"user\", \"name\": \"",
+                first ? "" : ",\n", u->actor == UINT32_MAX ? 0u : u->actor + 1);
+        put_json(f, u->text);
+        fputs("\", \"ts\": ", f);
+        put_time(f, t, u->time);
+        fputs(", \"args\": {\"channel\": \"", f);
+        put_json(f, u->channel);
+        fputs("\"}}", f);
+        first = 0;
+    }
+    fputs("\n]}\n", f);
+}
+/* ----- End: Output ----- */
+
+/* ----- Begin: Main ----- */
+static void usage(void)
+{
+    fprintf(stderr,
+            "usage: %s [-f csv|json|chrome] [-o output] [-v] dump...\n"
+            "  -f  output format (default csv)\n"
+            "  -o  output file for a single dump (default stdout); with several\n"
+            "      dumps each is written to <dump>.csv, <dump>.json or <dump>.trace.json\n"
+            "  -v  print a summary of each dump on stderr\n", prog);
+    exit(2);
+}
+
+static uint8_t *read_file(const char *path, size_t *len)
+{
+    FILE *f = fopen(path, "rb");
+    uint8_t *buf = NULL;
+    size_t cap = 0, n = 0, got;
+
+    if(f == NULL)
+        return NULL;
+    do
+    {
+        buf = grow(buf, &cap, n + 65536, 1);
+        got = fread(buf + n, 1, cap - n, f);
+        n += got;
+    } while(got != 0);
+    if(ferror(f))
+    {
+        free(buf);
+        buf = NULL;
+    }
+    fclose(f);
+    *len = n;
+    return buf;
+}
+
+static int decode_file(const char *path, const char *out_path, out_format fmt, int verbose, timeline *tl)
+{
+    static char obuf[1 << 16];
+    trace_dump t;
+    const char *err;
+    uint8_t *buf;
+    size_t len;
+    FILE *out = stdout;
+
+    buf = read_file(path, &len);
+    if(buf == NULL)
+    {
+        fprintf(stderr, "%s: %s: %s\n", prog, path, strerror(errno));
+        return 1;
+    }
+    err = parse_dump(&t, buf, len);
+    if(err != NULL)
+    {
+        fprintf(stderr, "%s: %s: %s\n", prog, path, err);
+        free(buf);
+        return 1;
+    }
+    decode_events(&t, tl);
+
+    if(out_path != NULL && (out = fopen(out_path, "w")) == NULL)
+    {
+        fprintf(stderr, "%s: %s: %s\n", prog, out_path, strerror(errno));
+        free(buf);
+        return 1;
+    }
+    setvbuf(out, obuf, _IOFBF, sizeof(obuf));
+    if(fmt == FMT_CSV)
+        write_csv(out, &t, tl);
+    else if(fmt == FMT_JSON)
+        write_json(out, &t, tl);
+    else
+        write_chrome(out, &t, tl);
+    if(out != stdout)
+        fclose(out);
+    else
+    {
+        fflush(out);
+        setvbuf(out, NULL, _IOFBF, BUFSIZ);
+    }
+
+    if(verbose)
+        fprintf(stderr, "%s: \"%s\", %u Hz, %u records%s, %u tasks/ISRs, %u slices, %u user events\n",
+                path, t.system_info, t.frequency, tl->decoded, t.full ? " (wrapped)" : "",
+                (unsigned) tl->nactors, (unsigned) tl->nslices, (unsigned) tl->nusers);
+    free(buf);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    static const char *ext[] = { ".csv", ".json", ".trace.json" };
+    out_format fmt = FMT_CSV;
+    const char *out_path = NULL;
+    timeline tl;
+    int i, verbose = 0, failed = 0;
+
+    memset(&tl, 0, sizeof(tl));
+
+    for(i = 1; i < argc && argv[i][0] == '-' && argv[i][1] != '\0'; i++)
+    {
+        if(strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+        {
+            i++;
+            if(strcmp(argv[i], "csv") == 0)
+                fmt = FMT_CSV;
+            else if(strcmp(argv[i], "json") == 0)
+                fmt = FMT_JSON;
+            else if(strcmp(argv[i], "chrome") == 0)
+                fmt = FMT_CHROME;
+            else
+                usage();
+        }
+        else if(strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+            out_path = argv[++i];
+        else if(strcmp(argv[i], "-v") == 0)
+            verbose = 1;
+        else
+            usage();
+    }
+    if(i == argc || (out_path != NULL && argc - i > 1))
+        usage();
+
+    if(argc - i == 1)
+        return decode_file(argv[i], out_path, fmt, verbose, &tl);
+
+    for(; i < argc; i++)
+    {
+        size_t n = strlen(argv[i]);
+        char *path = malloc(n + strlen(ext[fmt]) + 1);
+
+        if(path == NULL)
+            return 1;
+        memcpy(path, argv[i], n);
+        strcpy(path + n, ext[fmt]);
+        failed |= decode_file(argv[i], path, fmt, verbose, &tl);
+        free(path);
+    }
+    return failed;
+}
+/* ----- End: Main ----- */
+
+/* End of trcdecode.c */
@@ -0,0 +1,546 @@
+/** @file trcpersist.c
+ *
+ * @brief Host side extractor for the persistent trace of the snapshot recorder
+ *
+ * @par
+ * Reads an image of the EEPROM or flash region written by xTracePersistFlush()
+ * (TRC_CFG_PERSISTENT_TRACE, see ../trcSnapshotPersist.h), e.g. read back with
+ * the debugger or the programmer from TRC_CFG_PERSIST_BASE, and rebuilds a
+ * snapshot dump from it: the newest object and symbol tables with the last
+ * event buffer full of records the target saved before it was reset. The
+ * dump opens in Tracealyzer and in trcdecode like a RAM dump.
+ *
+ * @par
+ * Build and run on any Linux host:
+ *
+ *     cc -O2 -Wall -o trcpersist trcpersist.c
+ *     ./trcpersist -o trace.bin eeprom.bin
+ *     ./trcdecode -o trace.csv trace.bin
+ *
+ *     -o  output dump (default trace.bin)
+ *     -S  session to extract (default the newest, i.e. the last reset)
+ *     -a  keep every saved record of the session instead of one event buffer
+ *         full; only trcdecode reads such dumps
+ *     -l  list the pages instead
+ *
+ * @par
+ * Pages with a bad CRC, e.g. one being written at the reset, are skipped.
+ * Records after the last completed flush, and with the default options the
+ * records before a gap (records lost on the target, see recordsLost in
+ * vTracePersistGetStats), are left out since their time is not known.
+ *
+ * @par
+ * make check in this directory saves a trace from the host build of the
+ * recorder to a file-backed region (trcrecorder.c, host/trcFlash.h) and
+ * checks that this tool gives back what the RAM dump of the same run holds.
+ *
+ * @author
+ * Carlos Santos
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TRC_PERSIST_DECODER
+#include "../trcSnapshotPersist.h"
+
+#define USER_EVENT              0x98    /* + number of argument slots */
+#define USER_EVENT_LAST         0xA7
+
+/* RecorderDataType header fields, from the start markers */
+#define OFF_FILESIZE            16
+#define OFF_NUM_EVENTS          20
+#define OFF_MAX_EVENTS          24
+#define OFF_NEXT_FREE           28
+#define OFF_BUFFER_IS_FULL      32
+#define OFF_ABS_TIME            40
+#define OFF_ABS_TIME_SECOND     44
+#define OFF_RECORDER_ACTIVE     48
+
+/* ----- Begin: Page handling ----- */
+typedef struct {
+    uint32_t slot;
+    const uint8_t *data;        /* header, then payload */
+    TracePersistHeader h;
+} page;
+
+static const char *prog = "trcpersist";
+
+static uint16_t get16(const uint8_t *p)
+{
+    return (uint16_t) (p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+    return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static void put32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t) v;
+    p[1] = (uint8_t) (v >> 8);
+    p[2] = (uint8_t) (v >> 16);
+    p[3] = (uint8_t) (v >> 24);
+}
+
+/* Reads a header in target (little endian) byte order */
+static void get_header(const uint8_t *p, TracePersistHeader *h)
+{
+    h->magic = get16(p);
+    h->kind = p[2];
+    h->flags = p[3];
+    h->sequence = get32(p + 4);
+    h->session = get16(p + 8);
+    h->length = get16(p + 10);
+    h->pageSize = get16(p + 12);
+    h->crc = get16(p + 14);
+    h->info = get32(p + 16);
+    h->info2 = get32(p + 20);
+}
+
+static int valid_page(const uint8_t *p, uint32_t page_size, TracePersistHeader *h)
+{
+    get_header(p, h);
+    return h->magic == TRC_PERSIST_MAGIC && h->pageSize == page_size &&
+           h->length <= page_size - TRC_PERSIST_HEADER_SIZE &&
+           prvTracePersistPageCRC(p, h->length) == h->crc;
+}
+
+/* find_page_size Function Description ***************************************
+SYNTAX:         static uint32_t find_page_size(const uint8_t *buf, size_t len);
+DESCRIPTION:    Finds the page size from the first valid page in the image.
+                Pages start at multiples of their size, so a header found
+                elsewhere, e.g. in an event payload, does not count.
+RETURN VALUE:   The page size, or 0 if there is no valid page.
+END DESCRIPTION ************************************************************/
+static uint32_t find_page_size(const uint8_t *buf, size_t len)
+{
+    TracePersistHeader h;
+    size_t off;
+
+    for(off = 0; off + TRC_PERSIST_HEADER_SIZE <= len; off += 64)
+    {
+        get_header(buf + off, &h);
+        if(h.magic != TRC_PERSIST_MAGIC || h.pageSize < TRC_PERSIST_HEADER_SIZE + 64 ||
+           off % h.pageSize != 0 || off + h.pageSize > len)
+            continue;
+        if(valid_page(buf + off, h.pageSize, &h))
+            return h.pageSize;
+    }
+    return 0;
+}
+
+/* Most records a page can hold: runs of 257 records in 2 bytes */
+static uint32_t page_records(uint32_t page_size)
+{
+    return page_size / 2 * 257 + 1;
+}
+
+static int by_sequence(const void *a, const void *b)
+{
+    int32_t d = (int32_t) (((const page *) a)->h.sequence - ((const page *) b)->h.sequence);
+
+    return (d > 0) - (d < 0);
+}
+
+static void list_pages(const page *pages, size_t n)
+{
+    static const char *kind[] = { "?", "events", "meta" };
+    size_t i;
+
+    printf("slot  sequence  session  kind    bytes  flags\n");
+    for(i = 0; i < n; i++)
+    {
+        const TracePersistHeader *h = &pages[i].h;
+
+        printf("%4u  %8u  %7u  %-6s  %5u ", (unsigned) pages[i].slot, (unsigned) h->sequence,
+               (unsigned) h->session, kind[h->kind <= TRC_PERSIST_KIND_META ? h->kind : 0],
+               (unsigned) h->length);
+        if(h->kind == TRC_PERSIST_KIND_META)
+            printf(" part %u%s", (unsigned) h->info, (h->flags & TRC_PERSIST_FLAG_LAST) ? " last" : "");
+        else
+        {
+            if(h->flags & TRC_PERSIST_FLAG_GAP)
+                printf(" gap");
+            if(h->flags & TRC_PERSIST_FLAG_ANCHOR)
+                printf(" time %u.%u", (unsigned) h->info2, (unsigned) h->info);
+            if(h->flags >> TRC_PERSIST_SKIP_SHIFT)
+                printf(" carry %u", (unsigned) (h->flags >> TRC_PERSIST_SKIP_SHIFT));
+        }
+        printf("\n");
+    }
+}
+/* ----- End: Page handling ----- */
+
+/* ----- Begin: Dump rebuilding ----- */
+typedef struct {
+    uint8_t *records;
+    size_t count, cap;
+    size_t segment;             /* first record after the last gap */
+    size_t anchor_end;          /* records up to the last time anchor */
+    size_t anchor_segment;
+    uint32_t abs_time, abs_time_second;
+    unsigned gaps;
+} record_list;
+
+static int add_records(record_list *r, const page *p, uint32_t max_records)
+{
+    int32_t n;
+
+    if(r->count + max_records > r->cap)
+    {
+        r->cap = (r->count + max_records) * 2;
+        r->records = realloc(r->records, r->cap * 4);
+        if(r->records == NULL)
+        {
+            fprintf(stderr, "%s: out of memory\n", prog);
+            exit(1);
+        }
+    }
+    n = prvTracePersistDecode(p->data + TRC_PERSIST_HEADER_SIZE, p->h.length,
+                              r->records + r->count * 4, max_records);
+    if(n < 0)
+        return -1;
+    r->count += (size_t) n;
+    return 0;
+}
+
+/* First record boundary at or after target, walking from from, which is one */
+static size_t next_boundary(const record_list *r, size_t from, size_t target)
+{
+    size_t i = from;
+
+    while(i < target)
+    {
+        uint8_t type = r->records[i * 4];
+
+        if(type >= USER_EVENT && type <= USER_EVENT_LAST)
+            i += 1 + (size_t) (type - USER_EVENT);
+        else
+            i++;
+    }
+    return i;
+}
+
+/* collect_events Function Description ***************************************
+SYNTAX:         static void collect_events(const page *pages, size_t n,
+                                           uint32_t page_size, record_list *r);
+DESCRIPTION:    Decodes the event pages of one session, sorted by sequence
+                number, into one list of records. A page flagged with a gap,
+                or following a missing page, starts a new segment; records at
+                its start that belong to a user event on a missing page are
+                dropped.
+END DESCRIPTION ************************************************************/
+static void collect_events(const page *pages, size_t n, uint32_t page_size, record_list *r)
+{
+    uint32_t max_records = page_records(page_size);
+    size_t i, skip, start;
+    int new_segment;
+
+    for(i = 0; i < n; i++)
+    {
+        const TracePersistHeader *h = &pages[i].h;
+
+        if(h->kind != TRC_PERSIST_KIND_EVENTS)
+            continue;
+
+        new_segment = (h->flags & TRC_PERSIST_FLAG_GAP) || i == 0 ||
+                      pages[i - 1].h.sequence + 1 != h->sequence;
+        if(new_segment && r->count > 0)
+        {
+            r->gaps++;
+            r->segment = r->count;
+        }
+        start = r->count;
+        if(add_records(r, &pages[i], max_records) != 0)
+        {
+            fprintf(stderr, "%s: page %u: bad payload\n", prog, (unsigned) h->sequence);
+            r->count = start;
+            r->gaps++;
+            r->segment = r->count;
+            continue;
+        }
+        if(new_segment && (h->flags & TRC_PERSIST_FLAG_GAP) == 0)
+        {
+            /* The arguments of a user event on the page before */
+            skip = h->flags >> TRC_PERSIST_SKIP_SHIFT;
+            if(skip > r->count - start)
+                skip = r->count - start;
+            memmove(r->records + start * 4, r->records + (start + skip) * 4, (r->count - start - skip) * 4);
+            r->count -= skip;
+        }
+        if(h->flags & TRC_PERSIST_FLAG_ANCHOR)
+        {
+            r->anchor_end = r->count;
+            r->anchor_segment = r->segment;
+            r->abs_time = h->info;
+            r->abs_time_second = h->info2;
+        }
+    }
+}
+
+/* find_meta Function Description ********************************************
+SYNTAX:         static uint8_t *find_meta(const page *pages, size_t n,
+                                          uint32_t page_size,
+                                          size_t *len, uint32_t *prefix);
+DESCRIPTION:    Decodes the newest complete copy of RecorderDataType without
+                the event buffer: parts 0 to the one flagged last, on pages
+                with consecutive sequence numbers.
+RETURN VALUE:   The copy (to be freed), its length and the offset where the
+                event buffer goes, or NULL if the session has no complete
+                copy.
+END DESCRIPTION ************************************************************/
+static uint8_t *find_meta(const page *pages, size_t n, uint32_t page_size, size_t *len, uint32_t *prefix)
+{
+    size_t i, first, last;
+    size_t cap = 0, count = 0;
+    uint8_t *meta = NULL;
+    int32_t got;
+
+    for(last = n; last-- > 0;)
+    {
+        if(pages[last].h.kind != TRC_PERSIST_KIND_META || !(pages[last].h.flags & TRC_PERSIST_FLAG_LAST))
+            continue;
+        if(pages[last].h.info > last)
+            continue;
+        first = last - pages[last].h.info;
+        for(i = first; i <= last; i++)
+        {
+            if(pages[i].h.kind != TRC_PERSIST_KIND_META || pages[i].h.info != i - first ||
+               pages[i].h.sequence != pages[first].h.sequence + (i - first))
+                break;
+        }
+        if(i <= last)
+            continue;
+
+        count = 0;
+        for(i = first; i <= last; i++)
+        {
+            cap = (count + page_records(page_size)) * 4;
+            meta = realloc(meta, cap);
+            if(meta == NULL)
+            {
+                fprintf(stderr, "%s: out of memory\n", prog);
+                exit(1);
+            }
+            got = prvTracePersistDecode(pages[i].data + TRC_PERSIST_HEADER_SIZE, pages[i].h.length,
+                                        meta + count * 4, page_records(page_size));
+            if(got < 0)
+                break;
+            count += (size_t) got;
+        }
+        if(i <= last || pages[first].h.info2 > count * 4 || count * 4 < OFF_RECORDER_ACTIVE + 4)
+            continue;
+        *len = count * 4;
+        *prefix = pages[first].h.info2;
+        return meta;
+    }
+    free(meta);
+    return NULL;
+}
+
+static int write_dump(const char *path, const uint8_t *meta, size_t meta_len, uint32_t prefix,
+                      const uint8_t *records, size_t count, uint32_t max_events)
+{
+    size_t len = meta_len + (size_t) max_events * 4;
+    uint8_t *dump = calloc(len, 1);
+    FILE *f;
+
+    if(dump == NULL)
+    {
+        fprintf(stderr, "%s: out of memory\n", prog);
+        return 1;
+    }
+    memcpy(dump, meta, prefix);
+    memcpy(dump + prefix, records, count * 4);
+    memcpy(dump + prefix + (size_t) max_events * 4, meta + prefix, meta_len - prefix);
+
+    put32(dump + OFF_FILESIZE, (uint32_t) len);
+    put32(dump + OFF_MAX_EVENTS, max_events);
+    put32(dump + OFF_NUM_EVENTS, (uint32_t) count);
+    put32(dump + OFF_NEXT_FREE, count == max_events ? 0 : (uint32_t) count);
+    put32(dump + OFF_BUFFER_IS_FULL, count == max_events);
+    put32(dump + OFF_RECORDER_ACTIVE, 0);
+
+    f = fopen(path, "wb");
+    if(f == NULL || fwrite(dump, 1, len, f) != len)
+    {
+        fprintf(stderr, "%s: %s: %s\n", prog, path, strerror(errno));
+        if(f != NULL)
+            fclose(f);
+        free(dump);
+        return 1;
+    }
+    fclose(f);
+    free(dump);
+    return 0;
+}
+/* ----- End: Dump rebuilding ----- */
+
+/* ----- Begin: Main ----- */
+static void usage(void)
+{
+    fprintf(stderr,
+            "usage: %s [-o output] [-S session] [-a] [-l] image\n"
+            "  -o  output dump (default trace.bin)\n"
+            "  -S  session to extract (default the newest)\n"
+            "  -a  keep all saved records, not one event buffer full\n"
+            "  -l  list the pages\n", prog);
+    exit(2);
+}
+
+static uint8_t *read_file(const char *path, size_t *len)
+{
+    FILE *f = fopen(path, "rb");
+    uint8_t *buf = NULL;
+    size_t cap = 0, n = 0, got;
+
+    if(f == NULL)
+        return NULL;
+    do
+    {
+        if(n == cap)
+        {
+            cap = cap ? cap * 2 : 65536;
+            buf = realloc(buf, cap);
+            if(buf == NULL)
+                break;
+        }
+        got = fread(buf + n, 1, cap - n, f);
+        n += got;
+    } while(got != 0);
+    if(buf == NULL || ferror(f))
+    {
+        free(buf);
+        buf = NULL;
+    }
+    fclose(f);
+    *len = n;
+    return buf;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *out_path = "trace.bin";
+    uint8_t *image, *meta;
+    size_t len, meta_len, npages = 0, nsession = 0, i, first, count;
+    uint32_t page_size, prefix, max_events;
+    long session = -1;
+    int all = 0, list = 0, result;
+    page *pages;
+    record_list r;
+
+    for(i = 1; i < (size_t) argc && argv[i][0] == '-' && argv[i][1] != '\0'; i++)
+    {
+        if(strcmp(argv[i], "-o") == 0 && i + 1 < (size_t) argc)
+            out_path = argv[++i];
+        else if(strcmp(argv[i], "-S") == 0 && i + 1 < (size_t) argc)
+            session = strtol(argv[++i], NULL, 0);
+        else if(strcmp(argv[i], "-a") == 0)
+            all = 1;
+        else if(strcmp(argv[i], "-l") == 0)
+            list = 1;
+        else
+            usage();
+    }
+    if(i + 1 != (size_t) argc)
+        usage();
+
+    image = read_file(argv[i], &len);
+    if(image == NULL)
+    {
+        fprintf(stderr, "%s: %s: %s\n", prog, argv[i], strerror(errno));
+        return 1;
+    }
+    page_size = find_page_size(image, len);
+    if(page_size == 0)
+    {
+        fprintf(stderr, "%s: %s: no trace pages found\n", prog, argv[i]);
+        return 1;
+    }
+
+    pages = calloc(len / page_size, sizeof(page));
+    if(pages == NULL)
+        return 1;
+    for(i = 0; i < len / page_size; i++)
+    {
+        pages[npages].slot = (uint32_t) i;
+        pages[npages].data = image + i * page_size;
+        if(valid_page(pages[npages].data, page_size, &pages[npages].h))
+            npages++;
+    }
+    qsort(pages, npages, sizeof(page), by_sequence);
+
+    if(list)
+    {
+        list_pages(pages, npages);
+        return 0;
+    }
+
+    /* The session of the newest page, unless another was asked for */
+    if(session < 0)
+        session = pages[npages - 1].h.session;
+    for(i = 0; i < npages; i++)
+    {
+        if(pages[i].h.session == (uint16_t) session)
+            pages[nsession++] = pages[i];
+    }
+    if(nsession == 0)
+    {
+        fprintf(stderr, "%s: no pages of session %ld\n", prog, session);
+        return 1;
+    }
+
+    meta = find_meta(pages, nsession, page_size, &meta_len, &prefix);
+    if(meta == NULL)
+    {
+        fprintf(stderr, "%s: session %ld has no complete object and symbol tables\n", prog, session);
+        return 1;
+    }
+    max_events = get32(meta + OFF_MAX_EVENTS);
+
+    memset(&r, 0, sizeof(r));
+    collect_events(pages, nsession, page_size, &r);
+    if(r.anchor_end == 0)
+    {
+        fprintf(stderr, "%s: session %ld has no completed flush\n", prog, session);
+        return 1;
+    }
+    if(r.count > r.anchor_end)
+        fprintf(stderr, "%s: %u records after the last completed flush left out\n", prog,
+                (unsigned) (r.count - r.anchor_end));
+
+    first = all ? 0 : r.anchor_segment;
+    if(first > 0)
+        fprintf(stderr, "%s: %u records before a gap left out, -a keeps them\n", prog, (unsigned) first);
+    else if(r.gaps > 0)
+        fprintf(stderr, "%s: %u gaps, times before the last are not reliable\n", prog, r.gaps);
+
+    count = r.anchor_end - first;
+    if(all)
+        max_events = (uint32_t) count;
+    else if(count > max_events)
+    {
+        first = next_boundary(&r, first, r.anchor_end - max_events);
+        count = r.anchor_end - first;
+    }
+
+    put32(meta + OFF_ABS_TIME, r.abs_time);
+    put32(meta + OFF_ABS_TIME_SECOND, r.abs_time_second);
+    result = write_dump(out_path, meta, meta_len, prefix, r.records + first * 4, count, max_events);
+    if(result == 0)
+        fprintf(stderr, "%s: session %ld, %u records from %u pages to %s\n", prog, session,
+                (unsigned) count, (unsigned) nsession, out_path);
+    free(r.records);
+    free(meta);
+    free(pages);
+    free(image);
+    return result;
+}
+/* ----- End: Main ----- */
+
+/* End of trcpersist.c */
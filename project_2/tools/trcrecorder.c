@@ -0,0 +1,803 @@
+/** @file trcrecorder.c
+ *
+ * @brief Host side test of the snapshot recorder's context buffers, latency
+ * histograms, object filter, symbol table and triggered capture
+ *
+ * @par
+ * Runs the real ../trcSnapshotRecorder.c on the host, with the timer and the
+ * object table of host/. Preemption is simulated from the timer read
+ * (host/trcHost.h): the test picks a recorder call and the n-th time it reads
+ * the timer, a task of the same level or an ISR of the next one makes
+ * recorder calls of its own, possibly preempted in turn, before the read
+ * returns. With TRC_CFG_CONTEXT_BUFFERS the first read of a context buffer
+ * store falls between reading the head of the buffer and reserving the entry,
+ * the second one between reserving and publishing it. Every replayed event
+ * must then come later than the one before it (the recorder clamps an entry
+ * that is older than the last one replayed, which shows as a zero time
+ * difference), none may be lost, and a flush made while an entry is still
+ * being written must leave that entry and the later ones of its buffer.
+ *
+ * @par
+ * The other tests, for the options the recorder is built with:
+ *  - TRC_CFG_LATENCY_HISTOGRAMS: count, minimum and maximum of a pair are
+ *    exact, and the percentiles are at most half a power of two above the
+ *    exact ones, also for a pair measured from replayed events;
+ *  - TRC_CFG_OBJECT_FILTER: the events of excluded queues, ISRs and tasks,
+ *    and of everything but the included objects, are left out;
+ *  - the symbol table (TRC_CFG_HASHED_SYMBOL_TABLE): a string registered
+ *    again gets the index it got the first time;
+ *  - TRC_CFG_TRIGGERED_CAPTURE: kernel call, user event and application
+ *    triggers fill the capture slots and then stop the recorder, with
+ *    TRC_CFG_TRIGGER_POST_RECORDS records from the trigger on.
+ *
+ * @par
+ * With -o the test instead stores a synthetic trace - tasks, ISRs, kernel
+ * calls and user events, with and without arguments - and writes the RAM
+ * dump, for comparing the output of trcdecode between builds: the Makefile
+ * checks that the build with every option gives the same timeline and user
+ * events (TRC_CFG_DEFERRED_PRINTF) as the one without.
+ *
+ * @par
+ * With TRC_CFG_PERSISTENT_TRACE, -p also saves that trace with
+ * xTracePersistFlush() every ten ticks, to a region kept in the file image
+ * (host/trcFlash.h). The Makefile runs trcpersist on the image and checks
+ * that trcdecode gives the same output for it as for the RAM dump, once
+ * with the region written in place as the EEPROM and once erased a page at
+ * a time as NOR flash.
+ *
+ * @par
+ * Built by the Makefile in this directory:
+ *
+ *     make trcrecorder
+ *     ./trcrecorder
+ *     ./trcrecorder -o trace.bin
+ *     make trcrecorder_eeprom
+ *     ./trcrecorder_eeprom -o trace.bin -p eeprom.bin
+ *
+ * @par
+ * The exit status is 1 if a check failed.
+ *
+ * @author
+ * Carlos Santos
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trcRecorder.h"
+#if (TRC_CFG_CONTEXT_BUFFERS == 1)
+#include "trcSnapshotContext.h"
+#endif
+#if (TRC_CFG_LATENCY_HISTOGRAMS == 1)
+#include "trcSnapshotLatency.h"
+#endif
+#if (TRC_CFG_OBJECT_FILTER == 1)
+#include "trcSnapshotFilter.h"
+#endif
+#if (TRC_CFG_TRIGGERED_CAPTURE == 1)
+#include "trcSnapshotTrigger.h"
+#endif
+#if (TRC_CFG_PERSISTENT_TRACE == 1)
+#include "trcSnapshotPersist.h"
+#include "trcFlash.h"
+#endif
+
+/* Event codes, as in trcKernelPort.h */
+#define KSE_QUEUE_SEND          0x30
+#define KSE_QUEUE_RECEIVE       0x50
+
+#define TASKS                   4
+#define ISRS                    3
+#define QUEUES                  9
+#define MAX_NESTING             3
+
+typedef struct {
+    uint8_t type;
+    uint8_t handle;
+    uint32_t dts;
+} record;
+
+static record records[TRC_CFG_EVENT_BUFFER_SIZE];
+static int record_count;
+static uint32_t first_record;
+
+static traceHandle tasks[TASKS], isrs[ISRS];
+static traceString channel;
+static uint32_t rng_state = 1;
+static unsigned long checks, failures;
+
+static void fail(const char *what)
+{
+    if(failures++ < 10)
+        printf("%s\n", what);
+}
+
+static void check(int ok, const char *what)
+{
+    checks++;
+    if(!ok)
+        fail(what);
+}
+
+static uint32_t rnd(uint32_t n)
+{
+    /* xorshift32 */
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state % n;
+}
+
+static void advance(uint32_t max)
+{
+    host_time += 1 + rnd(max);
+}
+
+/* Flushes the context buffers and starts reading the event buffer at the
+next record */
+static void begin(void)
+{
+#if (TRC_CFG_CONTEXT_BUFFERS == 1)
+    vTraceFlushContextBuffers();
+#endif
+    first_record = RecorderDataPtr->nextFreeIndex;
+}
+
+/* Reads the records stored since begin() into records[], a user event with
+its arguments as one */
+static void read_records(void)
+{
+    uint32_t i, n = RecorderDataPtr->nextFreeIndex, xts = 0;
+
+#if (TRC_CFG_CONTEXT_BUFFERS == 1)
+    vTraceFlushContextBuffers();
+    n = RecorderDataPtr->nextFreeIndex;
+#endif
+    check(!RecorderDataPtr->bufferIsFull, "the event buffer wrapped");
+    record_count = 0;
+    for(i = first_record; i < n; i++)
+    {
+        const uint8_t *r = &RecorderDataPtr->eventData[i * 4];
+        record *rec = &records[record_count];
+
+        if(r[0] == XTS8 || r[0] == XTS16)
+        {
+            /* Only the events after it are ever checked for a zero time */
+            xts = 1;
+            continue;
+        }
+        rec->type = r[0];
+        rec->handle = r[1];
+        if(r[0] >= USER_EVENT && r[0] < USER_EVENT + 16)
+        {
+            rec->dts = r[1];
+            rec->handle = 0;
+            i += r[0] - USER_EVENT;
+        }
+        else
+        {
+            rec->dts = (uint32_t) r[2] | (uint32_t) r[3] << 8;
+        }
+        rec->dts |= xts << 16;
+        xts = 0;
+        record_count++;
+    }
+}
+
+static int count_records(uint8_t type, uint8_t handle)
+{
+    int i, n = 0;
+
+    for(i = 0; i < record_count; i++)
+        if(records[i].type == type && records[i].handle == handle)
+            n++;
+    return n;
+}
+
+static void queue_send(uint8_t queue)
+{
+    advance(20);
+    prvTraceStoreKernelCall(KSE_QUEUE_SEND, TRACE_CLASS_QUEUE, queue);
+}
+
+#if (TRC_CFG_CONTEXT_BUFFERS == 1)
+/* ----- Context buffers ----- */
+static int isr_depth, preempt_depth;
+static unsigned long events, preemptions[2];
+static int preempt_read;
+
+static void preempt(void);
+
+/* Sets up a preemption at the first or second timer read of the next
+recorder call, and counts the event the call stores */
+static void next_event(void)
+{
+    events++;
+    if(preempt_depth < MAX_NESTING && rnd(10) < 3)
+    {
+        preempt_read = 1 + (int) rnd(2);
+        host_preempt_at = preempt_read;
+        host_preempt = preempt;
+    }
+}
+
+static void random_event(void)
+{
+    switch(rnd(3))
+    {
+        case 0:
+            advance(20);
+            next_event();
+            prvTraceStoreTaskReady(tasks[rnd(TASKS)]);
+            break;
+        case 1:
+            advance(20);
+            next_event();
+            prvTraceStoreKernelCall(KSE_QUEUE_RECEIVE, TRACE_CLASS_QUEUE, 1 + rnd(QUEUES));
+            break;
+        default:
+            advance(20);
+            next_event();
+            prvTraceStoreKernelCall(KSE_QUEUE_SEND, TRACE_CLASS_QUEUE, 1 + rnd(QUEUES));
+            break;
+    }
+}
+
+static void isr(void)
+{
+    int i, n = (int) rnd(3);
+
+    isr_depth++;
+    advance(5);
+    next_event();
+    vTraceStoreISRBegin(isrs[isr_depth - 1]);
+    for(i = 0; i < n; i++)
+        random_event();
+    advance(5);
+    next_event();
+    vTraceStoreISREnd(0);
+    isr_depth--;
+}
+
+/* The code that runs when host_hwtc() is preempted: a task of the same
+priority level when a task was preempted, or an ISR */
+static void preempt(void)
+{
+    int read = preempt_read;
+
+    preemptions[read - 1]++;
+    preempt_depth++;
+    if(isr_depth == 0 && rnd(2) == 0)
+    {
+        int i, n = 1 + (int) rnd(3);
+
+        for(i = 0; i < n; i++)
+            random_event();
+    }
+    else if(isr_depth < ISRS)
+    {
+        isr();
+    }
+    /* Returning from the preemption takes time */
+    advance(5);
+    preempt_depth--;
+}
+
+static void test_ordering(void)
+{
+    TraceContextBufferStats before, after;
+    unsigned long stored;
+    int step, i, zero = 0;
+
+    begin();
+    vTraceGetContextBufferStats(&before);
+    events = 0;
+    for(step = 0; step < 1000; step++)
+    {
+        if(rnd(5) == 0)
+            isr();
+        else
+            random_event();
+        check(host_preempt_at == 0, "a preemption did not happen");
+        host_preempt_at = 0;
+        if(step % 4 == 3)
+            vTraceFlushContextBuffers();
+    }
+    read_records();
+    vTraceGetContextBufferStats(&after);
+
+    stored = events;
+    check(record_count == (int) stored, "replayed events missing or extra");
+    check(after.eventsDropped == before.eventsDropped, "events dropped");
+    check(after.eventsCaptured - before.eventsCaptured == stored, "eventsCaptured wrong");
+    for(i = 0; i < record_count; i++)
+        if(records[i].dts == 0)
+            zero++;
+    if(zero != 0)
+        printf("%d of %d events replayed out of order\n", zero, record_count);
+    check(zero == 0, "an event was replayed out of time order");
+    check(preemptions[0] > 100 && preemptions[1] > 100, "too few preemptions");
+}
+
+/* A same level task that stores an event and flushes the buffers while the
+entry of the task it preempted is reserved but not published */
+static uint32_t flushed_at;
+
+static void preempt_and_flush(void)
+{
+    advance(5);
+    prvTraceStoreKernelCall(KSE_QUEUE_SEND, TRACE_CLASS_QUEUE, 3);
+    vTraceFlushContextBuffers();
+    flushed_at = RecorderDataPtr->nextFreeIndex;
+    advance(5);
+}
+
+static void test_unpublished(void)
+{
+    begin();
+    queue_send(1);
+
+    /* The second read is the one after the entry is reserved */
+    host_preempt_at = 2;
+    host_preempt = preempt_and_flush;
+    queue_send(2);
+    check(host_preempt_at == 0, "the store did not read the timer twice");
+    check(flushed_at == first_record + 1, "the flush did not stop at the unpublished entry");
+
+    read_records();
+    check(record_count == 3, "events missing after the flush");
+    if(record_count == 3)
+    {
+        check(records[0].handle == 1 && records[1].handle == 2 && records[2].handle == 3,
+              "events replayed out of order after the flush");
+        check(records[1].dts > 0 && records[2].dts > 0, "an event was replayed out of time order");
+    }
+}
+#endif
+
+#if (TRC_CFG_LATENCY_HISTOGRAMS == 1)
+/* ----- Latency histograms ----- */
+static int compare_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *) a, y = *(const uint32_t *) b;
+
+    return (x > y) - (x < y);
+}
+
+/* The percentile as vTraceGetLatencyStats() takes it, from sorted samples */
+static uint32_t percentile(const uint32_t *sorted, int n, int percent)
+{
+    return sorted[(n * percent + 99) / 100 - 1];
+}
+
+static void check_percentile(uint32_t p, uint32_t exact, const char *what)
+{
+    /* A bucket is at most half a power of two wide */
+    check(p >= exact && p <= exact + exact / 2 + 1, what);
+}
+
+static void test_latency(void)
+{
+    static uint32_t samples[2000], sorted[2000];
+    TraceLatencyStats stats;
+    traceLatency marks, isr_to_task;
+    int i, n = (int) (sizeof(samples) / sizeof(samples[0]));
+
+    marks = xTraceLatencyPair("marks", TRC_LATENCY_MARK, 1, TRC_LATENCY_MARK, 2);
+    isr_to_task = xTraceLatencyPair("isr to task", TRC_LATENCY_ISR_BEGIN, isrs[0],
+                                    TRC_LATENCY_TASK_SWITCH_IN, tasks[1]);
+    check(marks != 0 && isr_to_task != 0, "xTraceLatencyPair failed");
+
+    begin();
+    for(i = 0; i < n; i++)
+    {
+        uint32_t start;
+
+        /* Mostly short, some long ones */
+        samples[i] = (rnd(10) == 0) ? 1000 + rnd(50000) : 1 + rnd(300);
+        advance(100);
+        start = host_time;
+        vTraceLatencyMark(1);
+        /* A second start is ignored */
+        vTraceLatencyMark(1);
+        host_time = start + samples[i];
+        vTraceLatencyMark(2);
+        /* A stop without a start too */
+        advance(10);
+        vTraceLatencyMark(2);
+    }
+
+    /* Measured when the events are replayed, from both context buffers */
+    for(i = 0; i < 100; i++)
+    {
+        uint32_t start;
+
+        advance(100);
+        start = host_time;
+        vTraceStoreISRBegin(isrs[0]);
+        advance(10);
+        vTraceStoreISREnd(1);
+        host_time = start + 47;
+        prvTraceStoreTaskswitch(tasks[1]);
+        advance(100);
+        prvTraceStoreTaskswitch(tasks[0]);
+        begin();
+    }
+
+    memcpy(sorted, samples, sizeof(sorted));
+    qsort(sorted, (size_t) n, sizeof(sorted[0]), compare_u32);
+    vTraceGetLatencyStats(marks, &stats);
+    check(stats.frequency == TRC_HWTC_FREQ_HZ, "latency frequency wrong");
+    check(stats.count == (uint32_t) n, "latency count wrong");
+    check(stats.min == sorted[0], "latency min wrong");
+    check(stats.max == sorted[n - 1], "latency max wrong");
+    check_percentile(stats.p50, percentile(sorted, n, 50), "latency p50 wrong");
+    check_percentile(stats.p90, percentile(sorted, n, 90), "latency p90 wrong");
+    check_percentile(stats.p99, percentile(sorted, n, 99), "latency p99 wrong");
+
+    vTraceGetLatencyStats(isr_to_task, &stats);
+    check(stats.count == 100, "ISR to task latency count wrong");
+    check(stats.min == 47 && stats.p50 == 47 && stats.p99 == 47 && stats.max == 47,
+          "ISR to task latency wrong");
+
+    vTraceLatencyReset();
+    vTraceGetLatencyStats(marks, &stats);
+    check(stats.count == 0 && stats.max == 0, "vTraceLatencyReset did not clear the pair");
+}
+#endif
+
+#if (TRC_CFG_OBJECT_FILTER == 1)
+/* ----- Object filter ----- */
+static int count_switches(traceHandle task)
+{
+    return count_records(TS_TASK_BEGIN, task) + count_records(TS_TASK_RESUME, task);
+}
+
+static void test_filter(void)
+{
+    begin();
+    vTraceSetObjectExcluded(TRACE_CLASS_QUEUE, 2, 1);
+    queue_send(1);
+    queue_send(2);
+    queue_send(3);
+
+    /* An excluded ISR, with what it does */
+    vTraceSetObjectExcluded(TRACE_CLASS_ISR, isrs[1], 1);
+    advance(5);
+    vTraceStoreISRBegin(isrs[1]);
+    queue_send(1);
+    advance(5);
+    vTraceStoreISREnd(0);
+
+    /* An excluded task, with what it does */
+    vTraceSetObjectExcluded(TRACE_CLASS_TASK, tasks[2], 1);
+    advance(5);
+    prvTraceStoreTaskReady(tasks[2]);
+    advance(5);
+    prvTraceStoreTaskswitch(tasks[2]);
+    queue_send(4);
+    advance(5);
+    prvTraceStoreTaskswitch(tasks[3]);
+    queue_send(5);
+    read_records();
+
+    check(xTraceIsObjectExcluded(TRACE_CLASS_QUEUE, 2) && !xTraceIsObjectExcluded(TRACE_CLASS_QUEUE, 3),
+          "xTraceIsObjectExcluded wrong");
+    check(count_records(KSE_QUEUE_SEND, 1) == 1 && count_records(KSE_QUEUE_SEND, 3) == 1,
+          "an included queue was left out");
+    check(count_records(KSE_QUEUE_SEND, 2) == 0, "an excluded queue was stored");
+    check(count_records(TS_ISR_BEGIN, isrs[1]) == 0, "an excluded ISR was stored");
+    check(count_records(DIV_TASK_READY, tasks[2]) == 0 && count_switches(tasks[2]) == 0,
+          "an excluded task was stored");
+    check(count_records(KSE_QUEUE_SEND, 4) == 0, "a kernel call of an excluded task was stored");
+    check(count_switches(tasks[3]) == 1 && count_records(KSE_QUEUE_SEND, 5) == 1,
+          "the task after an excluded one was left out");
+
+    /* Only one queue, and the tasks */
+    vTraceSetAllObjectsExcluded(1);
+    vTraceSetObjectExcluded(TRACE_CLASS_QUEUE, 3, 0);
+    vTraceSetObjectExcluded(TRACE_CLASS_TASK, TRC_FILTER_ALL_OBJECTS, 0);
+    begin();
+    queue_send(1);
+    queue_send(3);
+    advance(5);
+    vTraceStoreISRBegin(isrs[0]);
+    queue_send(3);
+    advance(5);
+    vTraceStoreISREnd(0);
+    advance(5);
+    prvTraceStoreTaskswitch(tasks[0]);
+    read_records();
+
+    check(count_records(KSE_QUEUE_SEND, 1) == 0, "an excluded queue was stored");
+    check(count_records(KSE_QUEUE_SEND, 3) == 1, "the included queue was left out");
+    check(count_records(TS_ISR_BEGIN, isrs[0]) == 0, "an excluded ISR was stored");
+    check(count_switches(tasks[0]) == 1, "an included task was left out");
+
+    vTraceSetAllObjectsExcluded(0);
+}
+#endif
+
+static void test_symbols(void)
+{
+    char name[16];
+    traceString first[60];
+    int i, same = 1, distinct = 1;
+
+    for(i = 0; i < 60; i++)
+    {
+        sprintf(name, "chn%d", i);
+        first[i] = xTraceRegisterString(name);
+    }
+    for(i = 0; i < 60; i++)
+    {
+        sprintf(name, "chn%d", i);
+        if(xTraceRegisterString(name) != first[i])
+            same = 0;
+        if(first[i] == 0 || (i > 0 && first[i] == first[i - 1]))
+            distinct = 0;
+    }
+    check(same, "a string registered again got another index");
+    check(distinct, "two strings got the same index");
+    check(xTraceRegisterString("Chn") == channel, "the channel got another index");
+    check(xTraceGetLastError() == NULL, "the symbol table is full");
+
+    begin();
+    vTracePrint(first[59], "symbols");
+    queue_send(2);
+    read_records();
+    check(record_count == 2 && count_records(KSE_QUEUE_SEND, 2) == 1,
+          "a print and a kernel call did not store two records");
+}
+
+#if (TRC_CFG_TRIGGERED_CAPTURE == 1)
+/* ----- Triggered capture, stops the recorder ----- */
+/* With the context buffers flushed as often as the idle task would */
+static void queue_sends(uint8_t queue, int n)
+{
+    int i;
+
+    for(i = 0; i < n; i++)
+    {
+        queue_send(queue);
+#if (TRC_CFG_CONTEXT_BUFFERS == 1)
+        if(i % 16 == 15)
+            vTraceFlushContextBuffers();
+#endif
+    }
+}
+
+static void test_triggers(void)
+{
+    traceTrigger on_queue, on_channel;
+    uint32_t at;
+
+    on_queue = xTraceTriggerOnEvent(KSE_QUEUE_SEND, 7);
+    on_channel = xTraceTriggerOnUserEvent(channel);
+    check(on_queue != 0 && on_channel != 0, "a trigger could not be set");
+
+    begin();
+    queue_sends(1, 400);
+    queue_send(7);
+    queue_sends(1, 150);
+    begin();
+    check(xTraceGetCaptureCount() == 1 && xTraceGetCaptureTrigger(0) == on_queue,
+          "the kernel call trigger did not make a capture");
+
+    queue_sends(1, 50);
+    advance(5);
+    vTracePrint(channel, "trigger");
+    queue_sends(1, 150);
+    begin();
+    check(xTraceGetCaptureCount() == 2 && xTraceGetCaptureTrigger(1) == on_channel,
+          "the user event trigger did not make a capture");
+
+    /* No slot left, the recorder stops instead */
+    at = RecorderDataPtr->numEvents;
+    vTraceTrigger();
+    queue_sends(1, 150);
+    begin();
+    check(!RecorderDataPtr->recorderActive, "the last trigger did not stop the recorder");
+    check(RecorderDataPtr->numEvents == at + (TRC_CFG_TRIGGER_POST_RECORDS),
+          "the recorder stopped at the wrong record");
+
+    check(xTraceLoadCapture(0), "xTraceLoadCapture failed");
+    first_record = 0;
+    read_records();
+    check(record_count == (TRC_CFG_TRIGGER_CAPTURE_SIZE), "the capture has the wrong size");
+    if(record_count > (TRC_CFG_TRIGGER_POST_RECORDS))
+    {
+        record *r = &records[record_count - (TRC_CFG_TRIGGER_POST_RECORDS)];
+
+        check(r->type == KSE_QUEUE_SEND && r->handle == 7,
+              "the capture does not end TRC_CFG_TRIGGER_POST_RECORDS after the trigger");
+    }
+    check(count_records(KSE_QUEUE_SEND, 7) == 1, "the trigger event is not in the capture");
+}
+#endif
+
+/* ----- Trace for trcdecode ----- */
+/* Writes the RAM dump to path and, with TRC_CFG_PERSISTENT_TRACE, saves the
+trace to the region in the file image as it goes */
+static int write_trace(const char *path, const char *image)
+{
+    static const char *words[] = { "alpha", "beta", "gamma", "delta" };
+    traceString other = xTraceRegisterString("Other");
+    uint32_t start = host_time;
+    FILE *f;
+    int k, persist_failed = 0;
+
+#if (TRC_CFG_PERSISTENT_TRACE == 1)
+    if(image != NULL && host_flash_open(image) != 0)
+    {
+        perror(image);
+        return 1;
+    }
+#else
+    (void) image;
+#endif
+
+    for(k = 0; k < 500; k++)
+    {
+        int task = 1 + (int) rnd(TASKS - 1);
+
+        host_time = start + (uint32_t) k * 1250 + rnd(2);
+        advance(10);
+        prvTraceStoreTaskReady(tasks[task]);
+        advance(30);
+        prvTraceStoreTaskswitch(tasks[task]);
+        queue_send((uint8_t) (1 + rnd(QUEUES)));
+        switch(rnd(8))
+        {
+            case 0:
+                advance(20);
+                vTracePrintF(channel, "v=%d %d", (int) rnd(1000), -(int) rnd(100));
+                break;
+            case 1:
+                advance(20);
+                vTracePrint(channel, "hello");
+                break;
+            case 2:
+                advance(20);
+                vTracePrintF(other, "s=%s n=%u", words[rnd(4)], (unsigned) rnd(77));
+                break;
+            case 3:
+                advance(20);
+                vTracePrintF(channel, "a=%bu b=%hd c=%d", (unsigned) rnd(200), -(int) rnd(300), (int) rnd(100000));
+                break;
+            default:
+                break;
+        }
+        if(rnd(5) == 0)
+        {
+            advance(20);
+            vTraceStoreISRBegin(isrs[rnd(ISRS)]);
+            queue_send((uint8_t) (1 + rnd(QUEUES)));
+            advance(10);
+            vTraceStoreISREnd(0);
+        }
+        advance(200);
+        prvTraceStoreTaskswitch(tasks[0]);
+#if (TRC_CFG_CONTEXT_BUFFERS == 1)
+        /* Task 0 is the idle task */
+        vTraceFlushContextBuffers();
+#endif
+#if (TRC_CFG_PERSISTENT_TRACE == 1)
+        /* As a low priority task would */
+        if(image != NULL && k % 10 == 9 && xTracePersistFlush() != 0)
+            persist_failed = 1;
+#endif
+    }
+#if (TRC_CFG_PERSISTENT_TRACE == 1)
+    if(image != NULL)
+    {
+        TracePersistStats stats;
+
+        if(xTracePersistFlush() != 0)
+            persist_failed = 1;
+        vTracePersistGetStats(&stats);
+        if(persist_failed || stats.recordsLost != 0 || host_flash_errors != 0)
+        {
+            fprintf(stderr, "%s: %u records lost, %u sink errors, %lu bad writes or erases\n",
+                    image, (unsigned) stats.recordsLost, (unsigned) stats.sinkErrors, host_flash_errors);
+            persist_failed = 1;
+        }
+        if(host_flash_close() != 0)
+        {
+            perror(image);
+            persist_failed = 1;
+        }
+    }
+#endif
+    vTraceStop();
+
+    f = fopen(path, "wb");
+    if(f == NULL || fwrite(RecorderDataPtr, sizeof(RecorderDataType), 1, f) != 1 || fclose(f) != 0)
+    {
+        perror(path);
+        return 1;
+    }
+    return persist_failed || xTraceGetLastError() != NULL;
+}
+
+int main(int argc, char **argv)
+{
+    const char *dump = NULL, *image = NULL;
+    int i;
+
+    for(i = 1; i + 1 < argc; i += 2)
+    {
+        if(strcmp(argv[i], "-o") == 0)
+            dump = argv[i + 1];
+#if (TRC_CFG_PERSISTENT_TRACE == 1)
+        else if(strcmp(argv[i], "-p") == 0)
+            image = argv[i + 1];
+#endif
+        else
+            break;
+    }
+    if(i < argc || (image != NULL && dump == NULL))
+    {
+#if (TRC_CFG_PERSISTENT_TRACE == 1)
+        fprintf(stderr, "usage: trcrecorder [-o dump [-p image]]\n");
+#else
+        fprintf(stderr, "usage: trcrecorder [-o dump]\n");
+#endif
+        return 2;
+    }
+
+    host_time = 1000;
+    prvTraceInitTraceData();
+    for(i = 0; i < TASKS; i++)
+    {
+        char name[8];
+
+        sprintf(name, "Task%d", i);
+        tasks[i] = prvTraceGetObjectHandle(TRACE_CLASS_TASK);
+        prvTraceSetObjectName(TRACE_CLASS_TASK, tasks[i], name);
+        prvTraceSetPriorityProperty(TRACE_CLASS_TASK, tasks[i], (uint8_t) i);
+    }
+    for(i = 0; i < ISRS; i++)
+    {
+        char name[8];
+
+        sprintf(name, "ISR%d", i);
+        isrs[i] = xTraceSetISRProperties(name, (uint8_t) (i + 1));
+    }
+    channel = xTraceRegisterString("Chn");
+    uiTraceStart();
+    prvTraceStoreTaskswitch(tasks[0]);
+
+    if(dump != NULL)
+        return write_trace(dump, image);
+
+#if (TRC_CFG_CONTEXT_BUFFERS == 1)
+    test_ordering();
+    test_unpublished();
+#endif
+#if (TRC_CFG_LATENCY_HISTOGRAMS == 1)
+    test_latency();
+#endif
+#if (TRC_CFG_OBJECT_FILTER == 1)
+    test_filter();
+#endif
+    test_symbols();
+#if (TRC_CFG_TRIGGERED_CAPTURE == 1)
+    test_triggers();
+#endif
+
+#if (TRC_CFG_CONTEXT_BUFFERS == 1)
+    {
+        TraceContextBufferStats stats;
+
+        vTraceGetContextBufferStats(&stats);
+        check(stats.eventsDropped == 0, "events dropped");
+    }
+#endif
+    if(xTraceGetLastError() != NULL)
+        printf("%s\n", xTraceGetLastError());
+    check(xTraceGetLastError() == NULL, "the recorder reported an error");
+    printf("%lu checks, %lu failures\n", checks, failures);
+    return failures != 0;
+}
@@ -84,6 +84,287 @@
  ******************************************************************************/
 #define TRC_CFG_EVENT_BUFFER_SIZE 1000
 
+/*******************************************************************************
+ * TRC_CFG_COMPACT_EVENT_ENCODING
+ *
+ * Macro which should be defined as either zero (0) or one (1).
+ *
+ * If one (1), events are stored with variable length timestamps, small object
+ * handles packed into the timestamp and run length coded tick events (see
+ * trcSnapshotCompact.h) in the same TRC_CFG_EVENT_BUFFER_SIZE * 4 bytes. This
+ * typically fits 1.5 to 2 times more execution time in the buffer, most for
+ * lightly loaded systems, and never needs the extra XTS records of the
+ * default encoding.
+ *
+ * Tracealyzer cannot read this format. Decode the RAM dump with
+ * tools/trcdecode.c instead. Cannot be combined with
+ * TRC_CFG_USE_SEPARATE_USER_EVENT_BUFFER.
+ *
+ * Default value is 0.
+ ******************************************************************************/
+#define TRC_CFG_COMPACT_EVENT_ENCODING 0
+
+/*******************************************************************************
+ * TRC_CFG_COMPACT_BLOCK_SIZE
+ *
+ * Macro which should be defined as an integer value, a multiple of 8 between
+ * 64 and 1016.
+ *
+ * Size in bytes of the blocks the event buffer is divided into when
+ * TRC_CFG_COMPACT_EVENT_ENCODING is 1. Records do not cross block boundaries,
+ * so about half a record is lost at the end of every block, and when the
+ * buffer wraps around the oldest block is overwritten as a whole. Only whole
+ * blocks of the event buffer are used.
+ *
+ * Default value is 200, which divides the default buffer into 20 blocks.
+ ******************************************************************************/
+#define TRC_CFG_COMPACT_BLOCK_SIZE 200
+
+/*******************************************************************************
+ * TRC_CFG_CONTEXT_BUFFERS
+ *
+ * Macro which should be defined as either zero (0) or one (1).
+ *
+ * If one (1), task switches, ready events, kernel calls and ISR begin/end are
+ * not stored in the event buffer at once but captured without masking
+ * interrupts into a buffer per context level (tasks, and each ISR nesting
+ * level up to TRC_CFG_MAX_ISR_NESTING). They are merged by timestamp into the
+ * event buffer by vTraceFlushContextBuffers(), which should be called from
+ * the idle hook, and before any directly stored event. See
+ * trcSnapshotContext.h.
+ *
+ * The context level is by default the ISR nesting seen by vTraceStoreISRBegin
+ * and vTraceStoreISREnd. On ports that count interrupt nesting themselves it
+ * can be taken from there instead, e.g. on PIC32:
+ *
+ *   #define TRC_CFG_CONTEXT_LEVEL() (uxInterruptNesting)
+ *
+ * Requires a compiler with the __sync atomic builtins (GCC, XC32).
+ *
+ * Default value is 0.
+ ******************************************************************************/
+#define TRC_CFG_CONTEXT_BUFFERS 0
+
+/*******************************************************************************
+ * TRC_CFG_CONTEXT_BUFFER_SIZE, TRC_CFG_ISR_CONTEXT_BUFFER_SIZE
+ *
+ * Macros which should be defined as powers of two.
+ *
+ * Number of entries in the task level context buffer and in each ISR level
+ * context buffer when TRC_CFG_CONTEXT_BUFFERS is 1. An entry takes 24 bytes.
+ * Events captured while a buffer is full are dropped and counted; the
+ * maxPending statistic shows how much of the buffers is used.
+ *
+ * Default values are 64 and 16.
+ ******************************************************************************/
+#define TRC_CFG_CONTEXT_BUFFER_SIZE 64
+#define TRC_CFG_ISR_CONTEXT_BUFFER_SIZE 16
+
+/*******************************************************************************
+ * TRC_CFG_LATENCY_HISTOGRAMS
+ *
+ * Macro which should be defined as either zero (0) or one (1).
+ *
+ * If one (1), latency histograms can be kept between pairs of start and stop
+ * events, e.g. an ISR and the task it wakes up. See trcSnapshotLatency.h.
+ *
+ * Default value is 0.
+ ******************************************************************************/
+#define TRC_CFG_LATENCY_HISTOGRAMS 0
+
+/*******************************************************************************
+ * TRC_CFG_LATENCY_PAIRS
+ *
+ * Number of latency pairs that can be set up with xTraceLatencyPair when
+ * TRC_CFG_LATENCY_HISTOGRAMS is 1. Each takes 100 bytes of RAM.
+ *
+ * Default value is 4.
+ ******************************************************************************/
+#define TRC_CFG_LATENCY_PAIRS 4
+
+/*******************************************************************************
+ * TRC_CFG_OBJECT_FILTER
+ *
+ * Macro which should be defined as either zero (0) or one (1).
+ *
+ * If one (1), the events of single tasks, ISRs, queues, semaphores etc. can be
+ * excluded at run time with vTraceSetObjectExcluded. The filter takes one bit
+ * per object (TRC_CFG_NTASK, TRC_CFG_NQUEUE, ...). See trcSnapshotFilter.h.
+ *
+ * Default value is 0.
+ ******************************************************************************/
+#define TRC_CFG_OBJECT_FILTER 0
+
+/*******************************************************************************
+ * TRC_CFG_HASHED_SYMBOL_TABLE
+ *
+ * Macro which should be defined as either zero (0) or one (1).
+ *
+ * If one (1), strings are found in the symbol table through a hash index of
+ * TRC_CFG_SYMBOL_HASH_SLOTS entries, comparing a 32-bit hash of the string
+ * and channel before the string itself. Otherwise xTraceRegisterString,
+ * vTracePrint and vTracePrintF search a list of the strings with the same
+ * 6-bit checksum, comparing each. The symbol table layout is unchanged.
+ *
+ * Default value is 0.
+ ******************************************************************************/
+#define TRC_CFG_HASHED_SYMBOL_TABLE 0
+
+/*******************************************************************************
+ * TRC_CFG_SYMBOL_HASH_SLOTS
+ *
+ * Macro which should be defined as a power of two.
+ *
+ * Entries of the symbol table hash index, 8 bytes each. At most 3/4 of them
+ * are used, i.e. 96 strings by default; strings beyond that are still found,
+ * the slow way. Each string takes its length + 5 bytes of the symbol table.
+ *
+ * Default value is 128.
+ ******************************************************************************/
+#define TRC_CFG_SYMBOL_HASH_SLOTS 128
+
+/*******************************************************************************
+ * TRC_CFG_DEFERRED_PRINTF
+ *
+ * Macro which should be defined as either zero (0) or one (1).
+ *
+ * If one (1), vTracePrintF parses each format string once, stores it in the
+ * symbol table and keeps its argument list in a cache of
+ * TRC_CFG_PRINTF_FORMAT_CACHE_SIZE entries. Later calls only store the
+ * format's symbol and the argument values. vTracePrint caches its strings the
+ * same way. The events are the same as otherwise. Not used with
+ * TRC_CFG_USE_SEPARATE_USER_EVENT_BUFFER, which has channel/format pairs.
+ *
+ * The cache identifies a string by its address, so the format strings and
+ * the strings given to vTracePrint must be constants, e.g. string literals,
+ * and never a buffer whose contents change.
+ *
+ * Default value is 0.
+ ******************************************************************************/
+#define TRC_CFG_DEFERRED_PRINTF 0
+
+/*******************************************************************************
+ * TRC_CFG_PRINTF_FORMAT_CACHE_SIZE
+ *
+ * Macro which should be defined as a power of two.
+ *
+ * Entries of the format cache when TRC_CFG_DEFERRED_PRINTF is 1, 32 bytes
+ * each. A string that does not fit is looked up again in the symbol table
+ * and parsed again.
+ *
+ * Default value is 16.
+ ******************************************************************************/
+#define TRC_CFG_PRINTF_FORMAT_CACHE_SIZE 16
+
+/*******************************************************************************
+ * TRC_CFG_TRIGGERED_CAPTURE
+ *
+ * Macro which should be defined as either zero (0) or one (1).
+ *
+ * If one (1), the recorder checks the triggers set with the functions in
+ * trcSnapshotTrigger.h as it stores the events, and keeps the records around
+ * each trigger in a capture slot or, when the slots are used up, stops. Not
+ * used with TRC_CFG_COMPACT_EVENT_ENCODING.
+ *
+ * Default value is 0.
+ ******************************************************************************/
+#define TRC_CFG_TRIGGERED_CAPTURE 0
+
+/*******************************************************************************
+ * TRC_CFG_TRIGGERS
+ *
+ * Number of triggers that can be set when TRC_CFG_TRIGGERED_CAPTURE is 1,
+ * 8 bytes each. Every event stored is checked against all of them.
+ *
+ * Default value is 4.
+ ******************************************************************************/
+#define TRC_CFG_TRIGGERS 4
+
+/*******************************************************************************
+ * TRC_CFG_TRIGGER_POST_RECORDS
+ *
+ * Records stored after a trigger fires before the trace is frozen. The rest
+ * of the capture, or of the event buffer, is what came before the trigger.
+ *
+ * Default value is 100.
+ ******************************************************************************/
+#define TRC_CFG_TRIGGER_POST_RECORDS 100
+
+/*******************************************************************************
+ * TRC_CFG_TRIGGER_CAPTURES
+ *
+ * Capture slots, each TRC_CFG_TRIGGER_CAPTURE_SIZE * 4 + 16 bytes of RAM. With
+ * 0 the first trigger stops the recorder.
+ *
+ * Default value is 2.
+ ******************************************************************************/
+#define TRC_CFG_TRIGGER_CAPTURES 2
+
+/*******************************************************************************
+ * TRC_CFG_TRIGGER_CAPTURE_SIZE
+ *
+ * Records in each capture slot, more than TRC_CFG_TRIGGER_POST_RECORDS and at
+ * most TRC_CFG_EVENT_BUFFER_SIZE.
+ *
+ * Default value is 300.
+ ******************************************************************************/
+#define TRC_CFG_TRIGGER_CAPTURE_SIZE 300
+
+/*******************************************************************************
+ * TRC_CFG_PERSISTENT_TRACE
+ *
+ * Macro which should be defined as either zero (0) or one (1).
+ *
+ * If this is one (1), xTracePersistFlush() saves the trace compressed to a
+ * region of EEPROM or flash, so it survives a reset (trcSnapshotPersist.h).
+ * Call it periodically from a low priority task; tools/trcpersist.c turns
+ * the region back into a dump. Uses about TRC_CFG_PERSIST_PAGE_SIZE + 300
+ * bytes of RAM. Cannot be combined with TRC_CFG_COMPACT_EVENT_ENCODING.
+ *
+ * Default value is 0.
+ ******************************************************************************/
+#define TRC_CFG_PERSISTENT_TRACE 0
+
+/*******************************************************************************
+ * TRC_CFG_PERSIST_BASE, TRC_CFG_PERSIST_PAGE_SIZE, TRC_CFG_PERSIST_PAGES
+ *
+ * The region: TRC_CFG_PERSIST_PAGES pages of TRC_CFG_PERSIST_PAGE_SIZE bytes
+ * from address TRC_CFG_PERSIST_BASE, not used by anything else. For flash the
+ * page size is the erase sector size. The object and symbol tables take a
+ * few pages, written again from time to time, so a region of 32 pages of 512
+ * bytes keeps roughly the last 20 pages of events, about twice as many records
+ * as the same bytes of event buffer.
+ *
+ * The defaults are the upper 16 KB of the 24LC256 I2C EEPROM on the Cerebot
+ * MX7cK (project_3 stores its messages from address 0).
+ ******************************************************************************/
+#define TRC_CFG_PERSIST_BASE 0x4000
+#define TRC_CFG_PERSIST_PAGE_SIZE 512
+#define TRC_CFG_PERSIST_PAGES 32
+
+/*******************************************************************************
+ * TRC_CFG_PERSIST_SINK_INCLUDE, TRC_CFG_PERSIST_READ, TRC_CFG_PERSIST_WRITE,
+ * TRC_CFG_PERSIST_ERASE
+ *
+ * How the region is accessed. READ and WRITE take an address, a buffer and a
+ * length and return 0 on success. ERASE, if defined, erases the page at the
+ * address before it is written; without it pages are written in place, a few
+ * bytes at a time as they fill up, as EEPROM allows.
+ *
+ * The defaults use I2C.c in project_3 and project_4. The EEPROM shares I2C2
+ * with the application, so call xTracePersistFlush() holding the same lock.
+ * For the SPI flash driver (SPIFlash.c, 4 KB sectors) use e.g.:
+ *
+ *	#define TRC_CFG_PERSIST_SINK_INCLUDE "TCPIP Stack/SPIFlash.h"
+ *	#define TRC_CFG_PERSIST_PAGE_SIZE 4096
+ *	#define TRC_CFG_PERSIST_ERASE(addr) (SPIFlashEraseSector(addr), 0)
+ *	#define TRC_CFG_PERSIST_WRITE(addr, data, len) (SPIFlashBeginWrite(addr), SPIFlashWriteArray((BYTE*)(data), (WORD)(len)), 0)
+ *	#define TRC_CFG_PERSIST_READ(addr, data, len) (SPIFlashReadArray((DWORD)(addr), (BYTE*)(data), (WORD)(len)), 0)
+ ******************************************************************************/
+#define TRC_CFG_PERSIST_SINK_INCLUDE "I2C.h"
+#define TRC_CFG_PERSIST_READ(addr, data, len) EEPROM_READ((int)(addr), (char*)(data), (int)(len))
+#define TRC_CFG_PERSIST_WRITE(addr, data, len) EEPROM_WRITE((int)(addr), (char*)(data), (int)(len))
+
 /*******************************************************************************
  * TRC_CFG_NTASK, TRC_CFG_NISR, TRC_CFG_NQUEUE, TRC_CFG_NSEMAPHORE...
  *
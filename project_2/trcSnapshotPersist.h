@@ -0,0 +1,336 @@
+/*******************************************************************************
+ * Trace Recorder Library for Tracealyzer v4.3.11
+ *
+ * trcSnapshotPersist.h
+ *
+ * Persistent trace for the snapshot recorder, used when
+ * TRC_CFG_PERSISTENT_TRACE is 1.
+ *
+ * The snapshot is lost on reset, which is when it is needed most, e.g. after a
+ * watchdog reset or a failed assert. xTracePersistFlush(), called from a low
+ * priority task, saves the records stored since its last call to a region of
+ * EEPROM or flash, compressed, so the trace up to the last flush can be read
+ * after the reset with tools/trcpersist.c.
+ *
+ * The region is TRC_CFG_PERSIST_PAGES pages of TRC_CFG_PERSIST_PAGE_SIZE bytes
+ * at TRC_CFG_PERSIST_BASE, written through the TRC_CFG_PERSIST_READ/WRITE
+ * (and for flash ERASE) macros in trcSnapshotConfig.h. The pages are used in
+ * turn as a ring and, since the first flush after a reset continues after the
+ * newest page, they all wear equally. Each page starts with a header:
+ *
+ *   0  uint16  TRC_PERSIST_MAGIC
+ *   2  uint8   kind, TRC_PERSIST_KIND_xxx
+ *   3  uint8   flags, TRC_PERSIST_FLAG_xxx, and in bits 4 - 7 the records at
+ *              the start of an event page that are the arguments of a user
+ *              event on the page before
+ *   4  uint32  sequence number, one higher for every new page
+ *   8  uint16  session, one higher after every reset
+ *  10  uint16  payload bytes after the header
+ *  12  uint16  page size
+ *  14  uint16  CRC-16/CCITT of the header (without this field) and payload
+ *  16  uint32  events: absTimeLastEvent at the last record, if FLAG_ANCHOR
+ *              meta: part number
+ *  20  uint32  events: absTimeLastEventSecond at the last record
+ *              meta: offset of eventData in RecorderDataType
+ *
+ * all in target (little endian) byte order. Event pages hold the records in
+ * the order they were stored. Meta pages hold RecorderDataType without the
+ * event buffer, i.e. the object and symbol tables, and are written again when
+ * they change and before the ring would overwrite the last copy. The extractor
+ * joins the newest meta with the session's event records into a dump that
+ * Tracealyzer and tools/trcdecode open like a RAM dump.
+ *
+ * Payloads are compressed per page, so each page can be read on its own. The
+ * coder works on whole 4 byte records and refers back to one of the previous
+ * 15 records of the page; most records repeat an event type and handle seen
+ * just before and only differ in the timestamp bytes. Tokens, by tag byte:
+ *
+ *   0x00              Literal record, 4 bytes follow
+ *   (d << 4) | 0      Copy of the record d back (d = 1..15)
+ *   (d << 4) | m      The record d back with the bytes in mask m replaced,
+ *                     m = 1..14, bit n = byte n; the new bytes follow
+ *   (d << 4) | 15, n  n + 2 copies of the record d back, one after another
+ *
+ * The page format and CRC are shared with tools/trcpersist.c, which defines
+ * TRC_PERSIST_DECODER to get the decoder; the recorder defines
+ * TRC_PERSIST_ENCODER to get the encoder. Application code that calls
+ * xTracePersistFlush() gets neither.
+ *
+ * Tabs are used for indent in this file (1 tab = 4 spaces)
+ ******************************************************************************/
+
+#ifndef TRC_SNAPSHOT_PERSIST_H
+#define TRC_SNAPSHOT_PERSIST_H
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TRC_PERSIST_MAGIC			0x5054	/* "TP" */
+#define TRC_PERSIST_HEADER_SIZE		24
+
+#define TRC_PERSIST_KIND_EVENTS		1
+#define TRC_PERSIST_KIND_META		2
+
+#define TRC_PERSIST_FLAG_GAP		0x01	/* Records were lost before this page */
+#define TRC_PERSIST_FLAG_ANCHOR		0x02	/* The absolute time fields are set */
+#define TRC_PERSIST_FLAG_LAST		0x04	/* Last part of a meta copy */
+#define TRC_PERSIST_SKIP_SHIFT		4		/* flags >> 4: argument records carried over */
+
+#define TRC_PERSIST_HISTORY			16		/* Previous records the coder refers to, + 1 */
+#define TRC_PERSIST_MAX_TOKEN		5
+
+typedef struct
+{
+	uint16_t magic;
+	uint8_t kind;
+	uint8_t flags;
+	uint32_t sequence;
+	uint16_t session;
+	uint16_t length;
+	uint16_t pageSize;
+	uint16_t crc;
+	uint32_t info;
+	uint32_t info2;
+} TracePersistHeader;
+
+/* Coder state, reset at the start of every page */
+typedef struct
+{
+	uint8_t history[TRC_PERSIST_HISTORY][4];
+	uint32_t records;		/* Records coded in the page */
+	uint8_t* run;			/* Tag of the last token if it is a copy or a run */
+	uint8_t runDistance;
+} TracePersistCoder;
+
+/* Statistics returned by vTracePersistGetStats() */
+typedef struct
+{
+	uint32_t recordsSaved;
+	uint32_t recordsLost;	/* Overwritten in the event buffer before they were saved */
+	uint32_t bytesSaved;	/* Compressed payload, recordsSaved * 4 bytes uncompressed */
+	uint32_t pagesWritten;	/* Page writes, including rewrites of a page being filled */
+	uint32_t sinkErrors;
+	uint16_t session;
+} TracePersistStats;
+
+/* Saves the records stored since the last call, and the object and symbol
+tables if they changed. Blocks while writing, so call it from a low priority
+task. Returns 0, or -1 if a read or write of the sink failed. */
+int xTracePersistFlush(void);
+
+void vTracePersistGetStats(TracePersistStats* stats);
+
+#if (defined TRC_PERSIST_ENCODER) || (defined TRC_PERSIST_DECODER)
+static uint16_t prvTracePersistCRC(uint16_t crc, const uint8_t* data, uint32_t len)
+{
+	uint32_t i;
+	int bit;
+
+	for (i = 0; i < len; i++)
+	{
+		crc ^= (uint16_t)(data[i] << 8);
+		for (bit = 0; bit < 8; bit++)
+		{
+			crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+		}
+	}
+	return crc;
+}
+
+/* CRC of a page, header at page[0] and payload after it */
+static uint16_t prvTracePersistPageCRC(const uint8_t* page, uint32_t length)
+{
+	uint16_t crc = prvTracePersistCRC(0xFFFF, page, 14);
+
+	return prvTracePersistCRC(crc, &page[16], TRC_PERSIST_HEADER_SIZE - 16 + length);
+}
+
+#ifdef TRC_PERSIST_ENCODER
+static void prvTracePersistCoderReset(TracePersistCoder* c)
+{
+	c->records = 0;
+	c->run = NULL;
+	c->runDistance = 0;
+}
+
+/*******************************************************************************
+ * prvTracePersistEncode
+ *
+ * Codes one record at dst, which must have room for TRC_PERSIST_MAX_TOKEN
+ * bytes. Returns the number of bytes written, 0 if a run was extended in
+ * place.
+ ******************************************************************************/
+static uint32_t prvTracePersistEncode(TracePersistCoder* c, uint8_t* dst, const uint8_t* record)
+{
+	uint32_t avail = (c->records < TRC_PERSIST_HISTORY - 1) ? c->records : TRC_PERSIST_HISTORY - 1;
+	uint32_t n = 0;
+	uint32_t d;
+	uint32_t bestDistance = 0;
+	uint32_t bestBytes = 4;
+	uint32_t bytes;
+	uint8_t bestMask = 0x0F;
+	uint8_t mask;
+	uint8_t extended = 0;
+	const uint8_t* prev;
+	int i;
+
+	/* Another copy of the record that the last copy or run repeated. The tag
+	of that token is the byte just before dst. */
+	if (c->run != NULL &&
+		memcmp(record, c->history[(c->records - c->runDistance) % TRC_PERSIST_HISTORY], 4) == 0)
+	{
+		if ((*c->run & 0x0F) == 0)
+		{
+			*c->run |= 0x0F;
+			dst[0] = 0;
+			n = 1;
+			extended = 1;
+		}
+		else if (c->run[1] < 0xFF)
+		{
+			c->run[1]++;
+			extended = 1;
+		}
+	}
+
+	if (!extended)
+	{
+		for (d = 1; d <= avail && bestBytes > 0; d++)
+		{
+			prev = c->history[(c->records - d) % TRC_PERSIST_HISTORY];
+			mask = 0;
+			bytes = 0;
+			for (i = 0; i < 4; i++)
+			{
+				if (prev[i] != record[i])
+				{
+					mask |= (uint8_t)(1 << i);
+					bytes++;
+				}
+			}
+			if (bytes < bestBytes)
+			{
+				bestBytes = bytes;
+				bestMask = mask;
+				bestDistance = d;
+			}
+		}
+
+		c->run = NULL;
+		if (bestDistance == 0)
+		{
+			dst[0] = 0x00;
+			(void)memcpy(&dst[1], record, 4);
+			n = 5;
+		}
+		else
+		{
+			dst[0] = (uint8_t)((bestDistance << 4) | bestMask);
+			n = 1;
+			for (i = 0; i < 4; i++)
+			{
+				if (bestMask & (1 << i))
+				{
+					dst[n++] = record[i];
+				}
+			}
+			if (bestMask == 0)
+			{
+				c->run = dst;
+				c->runDistance = (uint8_t)bestDistance;
+			}
+		}
+	}
+
+	(void)memcpy(c->history[c->records % TRC_PERSIST_HISTORY], record, 4);
+	c->records++;
+	return n;
+}
+
+#else /* TRC_PERSIST_DECODER */
+
+/*******************************************************************************
+ * prvTracePersistDecode
+ *
+ * Decodes a page payload into records (4 bytes each), at most maxRecords.
+ * Returns the number of records, or -1 if the payload is not valid.
+ ******************************************************************************/
+static int32_t prvTracePersistDecode(const uint8_t* src, uint32_t len, uint8_t* records, uint32_t maxRecords)
+{
+	uint32_t pos = 0;
+	uint32_t count = 0;
+	uint32_t copies;
+	uint32_t d;
+	uint8_t tag;
+	int i;
+
+	while (pos < len)
+	{
+		tag = src[pos++];
+		d = (uint32_t)(tag >> 4);
+
+		if (tag == 0x00)
+		{
+			if (pos + 4 > len || count >= maxRecords)
+			{
+				return -1;
+			}
+			(void)memcpy(&records[count * 4], &src[pos], 4);
+			pos += 4;
+			count++;
+			continue;
+		}
+
+		if (d == 0 || d > count)
+		{
+			return -1;
+		}
+
+		copies = 1;
+		if ((tag & 0x0F) == 0x0F)
+		{
+			if (pos >= len)
+			{
+				return -1;
+			}
+			copies = (uint32_t)src[pos++] + 2;
+		}
+
+		while (copies-- > 0)
+		{
+			if (count >= maxRecords)
+			{
+				return -1;
+			}
+			(void)memcpy(&records[count * 4], &records[(count - d) * 4], 4);
+			if ((tag & 0x0F) != 0x0F)
+			{
+				for (i = 0; i < 4; i++)
+				{
+					if (tag & (1 << i))
+					{
+						if (pos >= len)
+						{
+							return -1;
+						}
+						records[count * 4 + i] = src[pos++];
+					}
+				}
+			}
+			count++;
+		}
+	}
+	return (int32_t)count;
+}
+#endif /* TRC_PERSIST_DECODER */
+#endif /* (defined TRC_PERSIST_ENCODER) || (defined TRC_PERSIST_DECODER) */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRC_SNAPSHOT_PERSIST_H */
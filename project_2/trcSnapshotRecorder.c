@@ -111,7 +111,9 @@ extern traceHandle handle_of_last_logged_task;
 /*************** Private Functions *******************************************/
 static void prvStrncpy(char* dst, const char* src, uint32_t maxLength);
 static uint8_t prvTraceGetObjectState(uint8_t objectclass, traceHandle id); 
+#if (TRC_CFG_HASHED_SYMBOL_TABLE == 0)
 static void prvTraceGetChecksum(const char *pname, uint8_t* pcrc, uint8_t* plength); 
+#endif
 static void* prvTraceNextFreeEventBufferSlot(void); 
 static uint16_t prvTraceGetDTS(uint16_t param_maxDTS);
 static traceString prvTraceOpenSymbol(const char* name, traceString userEventChannel);
@@ -123,6 +125,383 @@ void vTraceStoreMemMangEvent(uint32_t ecode, uint32_t address, int32_t signed_si
 static void prvCheckDataToBeOverwrittenForMultiEntryEvents(uint8_t nEntries);
 #endif
 
+#ifndef TRC_CFG_COMPACT_EVENT_ENCODING
+#define TRC_CFG_COMPACT_EVENT_ENCODING 0
+#endif
+
+#if (TRC_CFG_COMPACT_EVENT_ENCODING == 1)
+#include "trcSnapshotCompact.h"
+
+#if (TRC_CFG_USE_SEPARATE_USER_EVENT_BUFFER == 1)
+#error "TRC_CFG_COMPACT_EVENT_ENCODING cannot be combined with TRC_CFG_USE_SEPARATE_USER_EVENT_BUFFER"
+#endif
+
+#if (((TRC_CFG_COMPACT_BLOCK_SIZE) % 8) != 0) || ((TRC_CFG_COMPACT_BLOCK_SIZE) < 64) || ((TRC_CFG_COMPACT_BLOCK_SIZE) > 1016)
+#error "TRC_CFG_COMPACT_BLOCK_SIZE must be a multiple of 8 between 64 and 1016"
+#endif
+
+#if ((TRC_CFG_EVENT_BUFFER_SIZE) * 4 < (TRC_CFG_COMPACT_BLOCK_SIZE) * 2)
+#error "TRC_CFG_EVENT_BUFFER_SIZE must hold at least two compact blocks"
+#endif
+
+typedef union
+{
+	uint32_t word;
+	uint8_t bytes[4];
+	KernelCallWithParam16 param16;
+	XPSEvent xps;
+} TraceCompactStage;
+
+static TraceCompactRing compactRing;
+
+/* The fixed size record an event writer fills in, encoded by
+prvTraceUpdateCounters. */
+static TraceCompactStage compactStage;
+
+/* DTS from prvTraceGetDTS, not yet stored with an event, and where the
+event's record keeps it (TRC_COMPACT_LAYOUT_xxx) */
+static uint32_t compactDTS = 0;
+static uint8_t compactLayout = TRC_COMPACT_LAYOUT_NONE;
+
+/* An XPS record is held back until the event it extends is known, as the
+compact form of a record with a 16 bit parameter holds the full value */
+static TraceCompactStage compactXPS;
+static uint8_t compactHasXPS = 0;
+
+static void prvTraceCompactReset(void);
+static void prvTraceCompactStore(const uint8_t* args, uint8_t argSlots);
+static void prvTraceCompactFull(uint32_t dts);
+#endif
+
+#ifndef TRC_CFG_CONTEXT_BUFFERS
+#define TRC_CFG_CONTEXT_BUFFERS 0
+#endif
+
+#if (TRC_CFG_CONTEXT_BUFFERS == 1)
+#include "trcSnapshotContext.h"
+
+#if (((TRC_CFG_CONTEXT_BUFFER_SIZE) & ((TRC_CFG_CONTEXT_BUFFER_SIZE) - 1)) != 0) || (((TRC_CFG_ISR_CONTEXT_BUFFER_SIZE) & ((TRC_CFG_ISR_CONTEXT_BUFFER_SIZE) - 1)) != 0)
+#error "TRC_CFG_CONTEXT_BUFFER_SIZE and TRC_CFG_ISR_CONTEXT_BUFFER_SIZE must be powers of two"
+#endif
+
+#define TRC_CONTEXT_LEVELS ((TRC_CFG_MAX_ISR_NESTING) + 1)
+
+/* The recorder call a context buffer entry stands for */
+#define TRC_CONTEXT_TASK_READY			1
+#define TRC_CONTEXT_LOW_POWER			2
+#define TRC_CONTEXT_KERNEL_CALL			3
+#define TRC_CONTEXT_KERNEL_CALL_PARAM	4
+#define TRC_CONTEXT_KERNEL_CALL_NUMERIC	5
+#define TRC_CONTEXT_TASK_SWITCH			6
+#define TRC_CONTEXT_INSTANCE_FINISHED	7
+#define TRC_CONTEXT_ISR_BEGIN			8
+#define TRC_CONTEXT_ISR_END				9
+
+typedef struct
+{
+	volatile uint32_t seq;	/* Index + 1, written last when the entry is complete */
+	uint32_t hwtc;			/* TRC_HWTC_COUNT, as an increasing count */
+	uint32_t tick;			/* uiTraceTickCount, used with OS timer based timestamps */
+	uint32_t param;
+	uint16_t handle;
+	uint16_t cost;			/* Counts spent capturing the entry, for the statistics */
+	uint8_t kind;			/* TRC_CONTEXT_xxx */
+	uint8_t code;			/* Event code */
+	uint8_t cls;			/* Object class, or if the scheduler was suspended (ISR end) */
+} TraceContextEntry;
+
+typedef struct
+{
+	TraceContextEntry* entries;
+	uint32_t mask;				/* Number of entries - 1 */
+	volatile uint32_t head;		/* Entries reserved by the writers */
+	volatile uint32_t tail;		/* Entries replayed, only written by the replay */
+	uint32_t lastKey;			/* Time of the last entry replayed */
+} TraceContextBuffer;
+
+static TraceContextEntry contextTaskEntries[TRC_CFG_CONTEXT_BUFFER_SIZE];
+static TraceContextEntry contextISREntries[TRC_CFG_MAX_ISR_NESTING][TRC_CFG_ISR_CONTEXT_BUFFER_SIZE];
+static TraceContextBuffer contextBuffers[TRC_CONTEXT_LEVELS];
+
+/* The entry being replayed, NULL when the recorder calls come from the
+application or kernel and are to be captured */
+static TraceContextEntry* contextReplay = NULL;
+
+static TraceContextBufferStats contextStats;
+
+#ifdef TRC_CFG_CONTEXT_LEVEL
+#define TRC_CONTEXT_LEVEL() (TRC_CFG_CONTEXT_LEVEL())
+#define TRC_CONTEXT_ISR_ENTER()
+#define TRC_CONTEXT_ISR_EXIT()
+#else
+/* ISR nesting as seen by vTraceStoreISRBegin/End. Nested ISRs restore it
+before returning, so the read-modify-write needs no protection. */
+static volatile uint8_t contextLevel = 0;
+#define TRC_CONTEXT_LEVEL() (contextLevel)
+#define TRC_CONTEXT_ISR_ENTER() (contextLevel++)
+#define TRC_CONTEXT_ISR_EXIT() if (contextLevel > 0) contextLevel--
+#endif
+
+static void prvTraceContextInit(void);
+static int prvTraceContextStore(uint8_t kind, uint8_t code, uint8_t cls, uint16_t handle, uint32_t param);
+static int prvTraceContextReplayNext(void);
+static void prvTraceContextReplayAll(void);
+#endif
+
+#ifndef TRC_CFG_LATENCY_HISTOGRAMS
+#define TRC_CFG_LATENCY_HISTOGRAMS 0
+#endif
+
+#if (TRC_CFG_LATENCY_HISTOGRAMS == 1)
+#include "trcSnapshotLatency.h"
+
+/* Two buckets per power of two, the last one also holds longer times */
+#define TRC_LATENCY_BUCKETS 32
+
+typedef struct
+{
+	const char* name;
+	uint16_t startEvent;
+	uint16_t startHandle;
+	uint16_t stopEvent;
+	uint16_t stopHandle;
+	uint32_t startTime;
+	uint32_t count;
+	uint32_t min;
+	uint32_t max;
+	uint8_t pending;			/* Start seen, waiting for the stop */
+	uint16_t buckets[TRC_LATENCY_BUCKETS];
+} TraceLatencyPair;
+
+static TraceLatencyPair latencyPairs[TRC_CFG_LATENCY_PAIRS];
+static uint8_t latencyPairCount = 0;
+
+/* Timestamp of the event being stored, from prvTraceGetDTS */
+static uint32_t latencyTimestamp = 0;
+
+static void prvTraceLatencyEvent(uint16_t event, uint16_t handle, uint32_t timestamp);
+#endif
+
+#ifndef TRC_CFG_OBJECT_FILTER
+#define TRC_CFG_OBJECT_FILTER 0
+#endif
+
+#if (TRC_CFG_OBJECT_FILTER == 1)
+#include "trcSnapshotFilter.h"
+
+/* Handles 0..N of every class */
+#define TRC_FILTER_BITS ((TRC_CFG_NQUEUE) + (TRC_CFG_NSEMAPHORE) + (TRC_CFG_NMUTEX) + \
+	(TRC_CFG_NTASK) + (TRC_CFG_NISR) + (TRC_CFG_NTIMER) + (TRC_CFG_NEVENTGROUP) + \
+	(TRC_CFG_NSTREAMBUFFER) + (TRC_CFG_NMESSAGEBUFFER) + (TRACE_NCLASSES))
+
+/* One bit per object handle, set if the object is excluded */
+static uint8_t filterBits[(TRC_FILTER_BITS + 7) / 8];
+static uint16_t filterBase[TRACE_NCLASSES];
+
+/* If the running task is excluded, set on task switches */
+static uint8_t filterTaskExcluded = 0;
+
+#if (TRC_CFG_INCLUDE_ISR_TRACING == 1)
+/* ISR nesting including excluded ISRs, and which levels are excluded */
+static uint8_t filterISRNesting = 0;
+static uint32_t filterISRExcluded = 0;
+#endif
+
+/* Captured events were filtered when captured */
+#if (TRC_CFG_CONTEXT_BUFFERS == 1)
+#define TRC_FILTER_ACTIVE() (contextReplay == NULL)
+#else
+#define TRC_FILTER_ACTIVE() (1)
+#endif
+
+static void prvTraceFilterInit(void);
+static uint8_t prvTraceFilterObject(uint8_t objectClass, uint16_t handle);
+static uint8_t prvTraceFilterCurrent(void);
+#endif
+
+#ifndef TRC_CFG_HASHED_SYMBOL_TABLE
+#define TRC_CFG_HASHED_SYMBOL_TABLE 0
+#endif
+
+#if (TRC_CFG_HASHED_SYMBOL_TABLE == 1)
+
+#if (((TRC_CFG_SYMBOL_HASH_SLOTS) & ((TRC_CFG_SYMBOL_HASH_SLOTS) - 1)) != 0)
+#error "TRC_CFG_SYMBOL_HASH_SLOTS must be a power of two"
+#endif
+
+/* An index into the symbol table by a 32 bit hash of the string and the
+channel. The table itself keeps its layout, with the 6 bit checksum chains,
+as that is what Tracealyzer reads. */
+typedef struct
+{
+	uint32_t hash;
+	uint16_t index;		/* Symbol table entry, 0 if the slot is free */
+} TraceSymbolSlot;
+
+static TraceSymbolSlot symbolSlots[TRC_CFG_SYMBOL_HASH_SLOTS];
+static uint16_t symbolSlotsUsed = 0;
+
+/* Set if a symbol could not be indexed, so a miss must be confirmed by
+searching the checksum chains */
+static uint8_t symbolSlotsFull = 0;
+
+static void prvTraceGetSymbolHash(const char* name, traceString channel, uint8_t* pcrc, uint8_t* plength, uint32_t* phash);
+static traceString prvTraceLookupSymbolHash(const char* name, uint8_t crc6, uint8_t len, uint32_t hash, traceString channel);
+static void prvTraceInsertSymbolHash(uint32_t hash, traceString index);
+#endif
+
+#ifndef TRC_CFG_DEFERRED_PRINTF
+#define TRC_CFG_DEFERRED_PRINTF 0
+#endif
+
+#if ((TRC_CFG_DEFERRED_PRINTF == 1) && (TRC_CFG_SCHEDULING_ONLY == 0) && (TRC_CFG_INCLUDE_USER_EVENTS == 1))
+
+#if (((TRC_CFG_PRINTF_FORMAT_CACHE_SIZE) & ((TRC_CFG_PRINTF_FORMAT_CACHE_SIZE) - 1)) != 0)
+#error "TRC_CFG_PRINTF_FORMAT_CACHE_SIZE must be a power of two"
+#endif
+
+/* How a vTracePrintF argument is fetched and stored */
+#define TRC_FORMAT_ARG_INT8			0
+#define TRC_FORMAT_ARG_INT16		1
+#define TRC_FORMAT_ARG_INT32		2
+#define TRC_FORMAT_ARG_STRING		3
+#define TRC_FORMAT_ARG_FLOAT		4
+#define TRC_FORMAT_ARG_DOUBLE		5
+
+/* Max arguments of vTracePrintF */
+#define TRC_FORMAT_MAX_ARGS 15
+
+/* A format string seen by vTracePrintF or vTracePrint, parsed once */
+typedef struct
+{
+	const char* format;		/* NULL if the entry is free */
+	traceString channel;
+	traceString symbol;		/* The format string in the symbol table */
+	const char* error;		/* Why the format cannot be stored, NULL if it can */
+	uint8_t args;
+	uint8_t slots;			/* Event records, including the user event record */
+	uint8_t kind[TRC_FORMAT_MAX_ARGS];	/* TRC_FORMAT_ARG_xxx */
+} TraceFormatEntry;
+
+static TraceFormatEntry formatCache[TRC_CFG_PRINTF_FORMAT_CACHE_SIZE];
+
+static TraceFormatEntry* prvTraceFormatLookup(const char* formatStr, traceString channel);
+static uint8_t prvTraceFormatArgs(const TraceFormatEntry* entry, va_list vl, uint32_t* buffer);
+#endif
+
+#ifndef TRC_CFG_TRIGGERED_CAPTURE
+#define TRC_CFG_TRIGGERED_CAPTURE 0
+#endif
+
+#if (TRC_CFG_TRIGGERED_CAPTURE == 1)
+#include "trcSnapshotTrigger.h"
+
+#if (TRC_CFG_COMPACT_EVENT_ENCODING == 1)
+#error "TRC_CFG_TRIGGERED_CAPTURE cannot be combined with TRC_CFG_COMPACT_EVENT_ENCODING"
+#endif
+
+#if ((TRC_CFG_TRIGGER_CAPTURES) > 0) && (((TRC_CFG_TRIGGER_CAPTURE_SIZE) <= (TRC_CFG_TRIGGER_POST_RECORDS)) || ((TRC_CFG_TRIGGER_CAPTURE_SIZE) > (TRC_CFG_EVENT_BUFFER_SIZE)))
+#error "TRC_CFG_TRIGGER_CAPTURE_SIZE must be above TRC_CFG_TRIGGER_POST_RECORDS and at most TRC_CFG_EVENT_BUFFER_SIZE"
+#endif
+
+#define TRC_TRIGGER_EVENT		1
+#define TRC_TRIGGER_USER_EVENT	2
+#define TRC_TRIGGER_LATENCY		3
+#define TRC_TRIGGER_STACK_LOW	4
+
+typedef struct
+{
+	uint8_t kind;			/* TRC_TRIGGER_xxx */
+	uint8_t code;			/* Event code, or latency pair */
+	uint16_t handle;		/* Object, channel or task, 0 for any */
+	uint32_t threshold;
+} TraceTrigger;
+
+static TraceTrigger triggers[TRC_CFG_TRIGGERS];
+static uint8_t triggerCount = 0;
+
+/* Set when a trigger has fired, until the post-trigger records are stored */
+static uint8_t triggerFired = 0;
+static uint8_t triggerWhich = 0;
+static uint32_t triggerFreezeAt = 0;
+
+#if ((TRC_CFG_TRIGGER_CAPTURES) > 0)
+typedef struct
+{
+	uint32_t records;		/* Records in the capture, the last are the post-trigger records */
+	uint32_t absTimeLastEventSecond;	/* Time of the last record, as in RecorderDataPtr */
+	uint32_t absTimeLastEvent;
+	uint8_t trigger;		/* The trigger that fired, 0 for vTraceTrigger */
+	uint8_t data[(TRC_CFG_TRIGGER_CAPTURE_SIZE) * 4];
+} TraceCapture;
+
+static TraceCapture captures[TRC_CFG_TRIGGER_CAPTURES];
+static uint8_t captureCount = 0;
+
+static void prvTraceCaptureCopy(TraceCapture* capture);
+#endif
+
+static traceTrigger prvTraceTriggerAdd(uint8_t kind, uint8_t code, uint16_t handle, uint32_t threshold);
+static void prvTraceTriggerFire(uint8_t trigger);
+static void prvTraceTriggerFreeze(void);
+
+/* Freezes the buffer once the post-trigger records are stored */
+#define TRC_TRIGGER_CHECK_FREEZE() \
+	if (triggerFired && (int32_t)(RecorderDataPtr->numEvents - triggerFreezeAt) >= 0) prvTraceTriggerFreeze()
+
+static void prvTraceTriggerEvent(uint8_t kind, uint8_t code, uint16_t handle, uint32_t value);
+#endif
+
+#ifndef TRC_CFG_PERSISTENT_TRACE
+#define TRC_CFG_PERSISTENT_TRACE 0
+#endif
+
+#if (TRC_CFG_PERSISTENT_TRACE == 1)
+#include <stddef.h>
+#define TRC_PERSIST_ENCODER
+#include "trcSnapshotPersist.h"
+#include TRC_CFG_PERSIST_SINK_INCLUDE
+
+#if (TRC_CFG_COMPACT_EVENT_ENCODING == 1)
+#error "TRC_CFG_PERSISTENT_TRACE cannot be combined with TRC_CFG_COMPACT_EVENT_ENCODING"
+#endif
+
+#if ((TRC_CFG_PERSIST_PAGE_SIZE) < TRC_PERSIST_HEADER_SIZE + 64) || ((TRC_CFG_PERSIST_PAGE_SIZE) > 65535) || ((TRC_CFG_PERSIST_PAGES) < 4)
+#error "TRC_CFG_PERSIST_PAGE_SIZE must be 88 to 65535 bytes and TRC_CFG_PERSIST_PAGES at least 4"
+#endif
+
+/* Records copied out of the event buffer per critical section */
+#define TRC_PERSIST_CHUNK 32
+
+/* The records of a user event are never split at the end of the event buffer,
+so the writer can skip up to 15 slots at the wrap. Records more than
+maxEvents - TRC_PERSIST_SLACK behind the writer count as lost. */
+#define TRC_PERSIST_SLACK 32
+
+typedef struct
+{
+	uint8_t page[TRC_CFG_PERSIST_PAGE_SIZE];	/* Header and payload of the page being filled */
+	uint32_t length;			/* Payload bytes in page */
+	uint32_t written;			/* Payload bytes already in the sink */
+	uint32_t slot;				/* Where page goes, 0 .. TRC_CFG_PERSIST_PAGES - 1 */
+	uint32_t sequence;			/* Sequence number of the next page */
+	uint32_t readIndex;			/* Next record of the event buffer to save */
+	uint32_t readCount;			/* numEvents when the record before readIndex was stored */
+	uint32_t metaChecksum;		/* Of the tables in the last meta copy */
+	uint32_t pagesSinceMeta;
+	uint32_t metaPages;			/* Pages of the last meta copy */
+	uint8_t started;
+	uint8_t open;				/* page is an event page taking more records */
+	uint8_t gap;				/* Records were lost since the last page */
+	uint8_t arguments;			/* Argument records still to come of the last user event */
+	TracePersistCoder coder;
+	TracePersistStats stats;
+	uint8_t staging[TRC_PERSIST_CHUNK * 4];
+} TracePersistState;
+
+static TracePersistState persist;
+#endif
+
 static traceString prvTraceCreateSymbolTableEntry(const char* name,
 										 uint8_t crc6,
 										 uint8_t len,
@@ -234,6 +613,22 @@ void vTraceClear(void)
 	traceErrorMessage = NULL;
 	RecorderDataPtr->internalErrorOccured = 0;
 	(void)memset(RecorderDataPtr->eventData, 0, RecorderDataPtr->maxEvents * 4);
+#if (TRC_CFG_COMPACT_EVENT_ENCODING == 1)
+	prvTraceCompactReset();
+#endif
+#if (TRC_CFG_CONTEXT_BUFFERS == 1)
+	{
+		uint32_t level;
+
+		for (level = 0; level < TRC_CONTEXT_LEVELS; level++)
+		{
+			contextBuffers[level].tail = contextBuffers[level].head;
+		}
+	}
+#endif
+#if (TRC_CFG_TRIGGERED_CAPTURE == 1)
+	triggerFired = 0;
+#endif
 	handle_of_last_logged_task = 0;
 	trcCRITICAL_SECTION_END();
 }
@@ -316,6 +711,14 @@ void vTraceStart(void)
  ******************************************************************************/
 void vTraceStop(void)
 {
+#if (TRC_CFG_CONTEXT_BUFFERS == 1)
+	if (contextReplay == NULL)
+	{
+		/* Keep what was captured before the stop */
+		vTraceFlushContextBuffers();
+	}
+#endif
+
 	if (RecorderDataPtr != NULL)
 	{
 		RecorderDataPtr->recorderActive = 0;
@@ -412,6 +815,9 @@ static void prvTraceTaskInstanceFinish(int8_t direct)
 	if (RecorderDataPtr->recorderActive && handle_of_last_logged_task)
 	{
 		dts45 = (uint8_t)prvTraceGetDTS(0xFF);
+#if (TRC_CFG_COMPACT_EVENT_ENCODING == 1)
+		compactLayout = TRC_COMPACT_LAYOUT_OTHER;	/* DTS in the last byte */
+#endif
 		tis = (TaskInstanceStatusEvent*) prvTraceNextFreeEventBufferSlot();
 		if (tis != NULL)
 		{
@@ -544,6 +950,41 @@ void vTraceStoreISRBegin(traceHandle handle)
 {
 	TRACE_ALLOC_CRITICAL_SECTION();
 
+#if (TRC_CFG_OBJECT_FILTER == 1)
+	if (TRC_FILTER_ACTIVE())
+	{
+		uint8_t excluded = prvTraceFilterObject(TRACE_CLASS_ISR, handle);
+
+		if (filterISRNesting < 32)
+		{
+			if (excluded)
+			{
+				filterISRExcluded |= (uint32_t)1 << filterISRNesting;
+			}
+			else
+			{
+				filterISRExcluded &= ~((uint32_t)1 << filterISRNesting);
+			}
+		}
+		filterISRNesting++;
+		if (excluded)
+		{
+			return;
+		}
+	}
+#endif
+
+#if (TRC_CFG_CONTEXT_BUFFERS == 1)
+	if (contextReplay == NULL)
+	{
+		TRC_CONTEXT_ISR_ENTER();
+		if (prvTraceContextStore(TRC_CONTEXT_ISR_BEGIN, 0, 0, handle, 0))
+		{
+			return;
+		}
+	}
+#endif
+
 	if (recorder_busy)
 	{
 		/*************************************************************************
@@ -569,6 +1010,9 @@ void vTraceStoreISRBegin(traceHandle handle)
 		TRACE_ASSERT(handle <= RecorderDataPtr->ObjectPropertyTable.NumberOfObjectsPerClass[TRACE_CLASS_ISR], "vTraceStoreISRBegin: Invalid ISR handle (> NISR)", TRC_UNUSED);
 		
 		dts4 = (uint16_t)prvTraceGetDTS(0xFFFF);
+#if (TRC_CFG_LATENCY_HISTOGRAMS == 1)
+		prvTraceLatencyEvent(TRC_LATENCY_ISR_BEGIN, handle, latencyTimestamp);
+#endif
 
 		if (RecorderDataPtr->recorderActive) /* Need to repeat this check! */
 		{
@@ -627,6 +1071,30 @@ void vTraceStoreISREnd(int pendingISR)
 	
 	TRACE_ALLOC_CRITICAL_SECTION();
 
+#if (TRC_CFG_OBJECT_FILTER == 1)
+	if (TRC_FILTER_ACTIVE() && filterISRNesting > 0)
+	{
+		filterISRNesting--;
+		if (filterISRNesting < 32 && ((filterISRExcluded >> filterISRNesting) & 1))
+		{
+			return;
+		}
+	}
+#endif
+
+#if (TRC_CFG_CONTEXT_BUFFERS == 1)
+	if (contextReplay == NULL)
+	{
+		int stored = prvTraceContextStore(TRC_CONTEXT_ISR_END, 0, (uint8_t)prvTraceIsSchedulerSuspended(), 0, (uint32_t)pendingISR);
+
+		TRC_CONTEXT_ISR_EXIT();
+		if (stored)
+		{
+			return;
+		}
+	}
+#endif
+
 	if (! RecorderDataPtr->recorderActive ||  ! handle_of_last_logged_task)
 	{
 		return;
@@ -663,7 +1131,11 @@ void vTraceStoreISREnd(int pendingISR)
 		type = TS_ISR_RESUME;
 		hnd8 = prvTraceGet8BitHandle(isrstack[nISRactive - 1]); /* isrstack[nISRactive] is the handle of the ISR we're currently exiting. isrstack[nISRactive - 1] is the handle of the ISR that was executing previously. */
 	}
+#if (TRC_CFG_CONTEXT_BUFFERS == 1)
+	else if ((isPendingContextSwitch == 0) || (contextReplay != NULL && contextReplay->cls) || (contextReplay == NULL && prvTraceIsSchedulerSuspended()))
+#else
 	else if ((isPendingContextSwitch == 0) || (prvTraceIsSchedulerSuspended()))	
+#endif
 	{
 		/* Return to interrupted task, if no context switch will occur in between. */
 		type = TS_TASK_RESUME;
@@ -854,7 +1326,7 @@ static uint8_t writeDouble(void * buffer, uint8_t i, double value)
  *
  * Parses the format string and stores the arguments in the buffer.
  ******************************************************************************/
-#if ((TRC_CFG_SCHEDULING_ONLY == 0) && (TRC_CFG_INCLUDE_USER_EVENTS == 1))
+#if ((TRC_CFG_SCHEDULING_ONLY == 0) && (TRC_CFG_INCLUDE_USER_EVENTS == 1) && ((TRC_CFG_DEFERRED_PRINTF == 0) || (TRC_CFG_USE_SEPARATE_USER_EVENT_BUFFER == 1)))
 static uint8_t prvTraceUserEventFormat(const char* formatStr, va_list vl, uint8_t* buffer, uint8_t byteOffset)
 {
 	uint16_t formatStrIndex = 0;
@@ -1007,6 +1479,200 @@ static uint8_t prvTraceUserEventFormat(const char* formatStr, va_list vl, uint8_
 }
 #endif
 
+#if ((TRC_CFG_DEFERRED_PRINTF == 1) && (TRC_CFG_SCHEDULING_ONLY == 0) && (TRC_CFG_INCLUDE_USER_EVENTS == 1))
+/*******************************************************************************
+ * prvTraceFormatParse
+ *
+ * Lists the arguments of a format string, and counts the event records they
+ * take as prvTraceUserEventFormat would store them.
+ ******************************************************************************/
+static void prvTraceFormatParse(const char* formatStr, TraceFormatEntry* entry)
+{
+	uint16_t formatStrIndex = 0;
+	uint8_t i = 4;
+	uint8_t kind;
+	uint8_t size;
+	uint8_t align;
+
+	entry->error = NULL;
+	entry->args = 0;
+
+	while (formatStr[formatStrIndex] != '\0')
+	{
+		if (formatStr[formatStrIndex] == '%')
+		{
+			if (formatStr[formatStrIndex + 1] == '%')
+			{
+				formatStrIndex += 2;
+				continue;
+			}
+
+			formatStrIndex++;
+
+			while ((formatStr[formatStrIndex] >= '0' && formatStr[formatStrIndex] <= '9') || formatStr[formatStrIndex] == '#' || formatStr[formatStrIndex] == '.')
+				formatStrIndex++;
+
+			kind = 0xFF;
+			switch (formatStr[formatStrIndex])
+			{
+				case '\0':
+					formatStrIndex--;
+					break;
+				case 'd':
+				case 'x':
+				case 'X':
+				case 'u':
+					kind = TRC_FORMAT_ARG_INT32;
+					break;
+				case 's':
+					kind = TRC_FORMAT_ARG_STRING;
+					break;
+				case 'f':
+					kind = TRC_FORMAT_ARG_FLOAT;
+					break;
+				case 'l':
+					if (formatStr[formatStrIndex + 1] == 'f')
+					{
+						kind = TRC_FORMAT_ARG_DOUBLE;
+						formatStrIndex++;
+					}
+					break;
+				case 'h':
+				case 'b':
+					if (formatStr[formatStrIndex + 1] == 'd' || formatStr[formatStrIndex + 1] == 'u')
+					{
+						kind = (formatStr[formatStrIndex] == 'h') ? TRC_FORMAT_ARG_INT16 : TRC_FORMAT_ARG_INT8;
+						formatStrIndex++;
+					}
+					break;
+				default:
+					/* False alarm: this wasn't a valid format specifier */
+					break;
+			}
+
+			if (kind != 0xFF)
+			{
+				if (entry->args == TRC_FORMAT_MAX_ARGS)
+				{
+					entry->error = "vTracePrintF - Too many arguments, max 15 allowed!";
+					return;
+				}
+
+				switch (kind)
+				{
+					case TRC_FORMAT_ARG_INT8:	size = 1; break;
+					case TRC_FORMAT_ARG_INT16:
+					case TRC_FORMAT_ARG_STRING:	size = 2; break;
+					case TRC_FORMAT_ARG_DOUBLE:	size = 8; break;
+					default:					size = 4; break;
+				}
+
+				/* Doubles are aligned as 32 bit values */
+				align = (uint8_t)((size < 4) ? size : 4);
+				i = (uint8_t)((i + align - 1) & ~(align - 1));
+
+				if (i + size > MAX_ARG_SIZE)
+				{
+					entry->error = "vTracePrintF - Too large arguments, max 32 byte allowed!";
+					return;
+				}
+
+				entry->kind[entry->args] = kind;
+				entry->args++;
+				i = (uint8_t)(i + size);
+			}
+		}
+		formatStrIndex++;
+	}
+
+	entry->slots = (uint8_t)((i + 3) / 4);
+}
+
+/*******************************************************************************
+ * prvTraceFormatLookup
+ *
+ * Returns the format cache entry of a format string, parsing the string and
+ * storing it in the symbol table the first time. The string is identified by
+ * its address. NULL if the symbol table is full.
+ *
+ * NOTE: this function MUST be called from within a critical section.
+ ******************************************************************************/
+static TraceFormatEntry* prvTraceFormatLookup(const char* formatStr, traceString channel)
+{
+	TraceFormatEntry* entry;
+
+	entry = &formatCache[(((uint32_t)(uintptr_t)formatStr * 2654435761u) >> 16) & ((TRC_CFG_PRINTF_FORMAT_CACHE_SIZE) - 1)];
+
+	if (entry->format != formatStr || entry->channel != channel)
+	{
+		entry->format = NULL;
+		entry->symbol = prvTraceOpenSymbol(formatStr, channel);
+		if (entry->symbol == 0)
+		{
+			return NULL;
+		}
+		prvTraceFormatParse(formatStr, entry);
+		entry->channel = channel;
+		entry->format = formatStr;
+	}
+
+	return entry;
+}
+
+/*******************************************************************************
+ * prvTraceFormatArgs
+ *
+ * Stores the arguments listed by prvTraceFormatParse after the user event
+ * record, without looking at the format string. Returns the number of event
+ * records.
+ ******************************************************************************/
+static uint8_t prvTraceFormatArgs(const TraceFormatEntry* entry, va_list vl, uint32_t* buffer)
+{
+	uint8_t i = 4;
+	uint8_t n;
+
+	for (n = 0; n < entry->args; n++)
+	{
+		switch (entry->kind[n])
+		{
+			case TRC_FORMAT_ARG_INT8:
+				i = writeInt8(buffer, i, (uint8_t)va_arg(vl, uint32_t));
+				break;
+			case TRC_FORMAT_ARG_INT16:
+				i = writeInt16(buffer, i, (uint16_t)va_arg(vl, uint32_t));
+				break;
+			case TRC_FORMAT_ARG_STRING:
+				i = writeInt16(buffer, i, xTraceRegisterString((char*)va_arg(vl, char*)));
+				break;
+#if (TRC_CFG_INCLUDE_FLOAT_SUPPORT)
+			/* "float" is promoted into "double" by the va_arg stuff */
+			case TRC_FORMAT_ARG_FLOAT:
+				i = writeFloat(buffer, i, (float)va_arg(vl, double));
+				break;
+			case TRC_FORMAT_ARG_DOUBLE:
+				i = writeDouble(buffer, i, (double)va_arg(vl, double));
+				break;
+#else
+			/* No float support, stored as integers to keep va_arg
+			consistent (will not be displayed anyway) */
+			case TRC_FORMAT_ARG_FLOAT:
+				i = writeInt32(buffer, i, (uint32_t)va_arg(vl, double));
+				break;
+			case TRC_FORMAT_ARG_DOUBLE:
+				i = writeInt32(buffer, i, (uint32_t)va_arg(vl, double));
+				i = writeInt32(buffer, i, 0);
+				break;
+#endif
+			default:
+				i = writeInt32(buffer, i, (uint32_t)va_arg(vl, uint32_t));
+				break;
+		}
+	}
+
+	return entry->slots;
+}
+#endif
+
 /*******************************************************************************
  * prvTraceClearChannelBuffer
  *
@@ -1312,10 +1978,25 @@ void vTraceVPrintF(traceString eventLabel, const char* formatStr, va_list vl)
 	uint32_t noOfSlots;
 	UserEvent* ue1;
 	uint32_t tempDataBuffer[(3 + MAX_ARG_SIZE) / 4];
+#if (TRC_CFG_DEFERRED_PRINTF == 1)
+	TraceFormatEntry* format;
+#endif
 	TRACE_ALLOC_CRITICAL_SECTION();
 
 	TRACE_ASSERT(formatStr != NULL, "vTraceVPrintF: formatStr == NULL", TRC_UNUSED);
 
+#if (TRC_CFG_CONTEXT_BUFFERS == 1)
+	/* The task switch to the current task may still be in a context buffer */
+	vTraceFlushContextBuffers();
+#endif
+
+#if (TRC_CFG_OBJECT_FILTER == 1)
+	if (prvTraceFilterCurrent())
+	{
+		return;
+	}
+#endif
+
 	trcCRITICAL_SECTION_BEGIN();
 
 	if (RecorderDataPtr->recorderActive && handle_of_last_logged_task)
@@ -1327,16 +2008,44 @@ void vTraceVPrintF(traceString eventLabel, const char* formatStr, va_list vl)
 
 		ue1->type = EVENT_BEING_WRITTEN;	 /* Update this as the last step */
 
-		noOfSlots = prvTraceUserEventFormat(formatStr, vl, (uint8_t*)tempDataBuffer, 4);
-
-		/* Store the format string, with a reference to the channel symbol */
+#if (TRC_CFG_DEFERRED_PRINTF == 1)
+		/* The format string was parsed and stored when first seen */
+		noOfSlots = 0;
+		ue1->payload = 0;
+		format = prvTraceFormatLookup(formatStr, eventLabel);
+		if (format != NULL)
+		{
+			if (format->error != NULL)
+			{
+				prvTraceError(format->error);
+			}
+			else
+			{
+				noOfSlots = prvTraceFormatArgs(format, vl, tempDataBuffer);
+				ue1->payload = format->symbol;
+			}
+		}
+#else
+		noOfSlots = prvTraceUserEventFormat(formatStr, vl, (uint8_t*)tempDataBuffer, 4);
+
+		/* Store the format string, with a reference to the channel symbol */
 		ue1->payload = prvTraceOpenSymbol(formatStr, eventLabel);
+#endif
 
 		ue1->dts = (uint8_t)prvTraceGetDTS(0xFF);
 
 		 /* prvTraceGetDTS might stop the recorder in some cases... */
 		if (RecorderDataPtr->recorderActive)
 		{
+#if (TRC_CFG_TRIGGERED_CAPTURE == 1)
+			prvTraceTriggerEvent(TRC_TRIGGER_USER_EVENT, 0, eventLabel, 0);
+#endif
+#if (TRC_CFG_COMPACT_EVENT_ENCODING == 1)
+			/* A single record, so there is nothing to wrap or clean up */
+			ue1->type = (uint8_t) (USER_EVENT + noOfSlots - 1);
+			(void)memcpy(compactStage.bytes, tempDataBuffer, 4);
+			prvTraceCompactStore((uint8_t*)&tempDataBuffer[1], (uint8_t)(noOfSlots - 1));
+#else
 
 			/* If the data does not fit in the remaining main buffer, wrap around to
 			0 if allowed, otherwise stop the recorder and quit). */
@@ -1394,13 +2103,17 @@ void vTraceVPrintF(traceString eventLabel, const char* formatStr, va_list vl)
 					vTraceStop();
 					#endif
 				}
+
+#if (TRC_CFG_TRIGGERED_CAPTURE == 1)
+				TRC_TRIGGER_CHECK_FREEZE();
+#endif
 			}
 
 			#if (TRC_CFG_SNAPSHOT_MODE == TRC_SNAPSHOT_MODE_RING_BUFFER)
 			/* Make sure the next entry is cleared correctly */
 			prvCheckDataToBeOverwrittenForMultiEntryEvents(1);
 			#endif
-
+#endif /* (TRC_CFG_COMPACT_EVENT_ENCODING == 1) */
 		}
 	}
 	trcCRITICAL_SECTION_END();
@@ -1436,18 +2149,41 @@ void vTracePrint(traceString chn, const char* str)
 #if (TRC_CFG_USE_SEPARATE_USER_EVENT_BUFFER == 0)
 	UserEvent* ue;
 	uint8_t dts1;
+#if (TRC_CFG_DEFERRED_PRINTF == 1)
+	TraceFormatEntry* format;
+#endif
 	TRACE_ALLOC_CRITICAL_SECTION();
 
+#if (TRC_CFG_CONTEXT_BUFFERS == 1)
+	/* The task switch to the current task may still be in a context buffer */
+	vTraceFlushContextBuffers();
+#endif
+
+#if (TRC_CFG_OBJECT_FILTER == 1)
+	if (prvTraceFilterCurrent())
+	{
+		return;
+	}
+#endif
+
 	trcCRITICAL_SECTION_BEGIN();
 	if (RecorderDataPtr->recorderActive && handle_of_last_logged_task)
 	{
 		dts1 = (uint8_t)prvTraceGetDTS(0xFF);
+#if (TRC_CFG_TRIGGERED_CAPTURE == 1)
+		prvTraceTriggerEvent(TRC_TRIGGER_USER_EVENT, 0, chn, 0);
+#endif
 		ue = (UserEvent*) prvTraceNextFreeEventBufferSlot();
 		if (ue != NULL)
 		{
 			ue->dts = dts1;
 			ue->type = USER_EVENT;
+#if (TRC_CFG_DEFERRED_PRINTF == 1)
+			format = prvTraceFormatLookup(str, chn);
+			ue->payload = (format != NULL) ? format->symbol : 0;
+#else
 			ue->payload = prvTraceOpenSymbol(str, chn);
+#endif
 			prvTraceUpdateCounters();
 		}
 	}
@@ -1533,6 +2269,20 @@ void prvTraceStoreTaskReady(traceHandle handle)
 
 	TRACE_ASSERT(handle <= (TRC_CFG_NTASK), "prvTraceStoreTaskReady: Invalid value for handle", TRC_UNUSED);
 
+#if (TRC_CFG_OBJECT_FILTER == 1)
+	if (TRC_FILTER_ACTIVE() && prvTraceFilterObject(TRACE_CLASS_TASK, handle))
+	{
+		return;
+	}
+#endif
+
+#if (TRC_CFG_CONTEXT_BUFFERS == 1)
+	if (contextReplay == NULL && prvTraceContextStore(TRC_CONTEXT_TASK_READY, 0, 0, handle, 0))
+	{
+		return;
+	}
+#endif
+
 	if (recorder_busy)
 	{
 		/*************************************************************************
@@ -1580,6 +2330,13 @@ void prvTraceStoreLowPower(uint32_t flag)
 
 	TRACE_ASSERT(flag <= 1, "prvTraceStoreLowPower: Invalid flag value", TRC_UNUSED);
 
+#if (TRC_CFG_CONTEXT_BUFFERS == 1)
+	if (contextReplay == NULL && prvTraceContextStore(TRC_CONTEXT_LOW_POWER, 0, 0, 0, flag))
+	{
+		return;
+	}
+#endif
+
 	if (recorder_busy)
 	{
 		/*************************************************************************
@@ -1659,7 +2416,11 @@ void vTraceStoreMemMangEvent(uint32_t ecode, uint32_t address, int32_t signed_si
 		if (ms != NULL)
 		{
 			ms->dts = dts1;
+#if (TRC_CFG_COMPACT_EVENT_ENCODING == 1)
+			ms->type = (uint8_t) ecode; /* Encoded by prvTraceUpdateCounters, ms is reused for ma */
+#else
 			ms->type = NULL_EVENT; /* Updated when all events are written */
+#endif
 			ms->size = size_low;
 			prvTraceUpdateCounters();
 
@@ -1683,7 +2444,9 @@ void vTraceStoreMemMangEvent(uint32_t ecode, uint32_t address, int32_t signed_si
 				ma->addr_low = addr_low;
 				ma->addr_high = addr_high;
 				ma->type = (uint8_t) (ecode  + 1); /* Note this! */
+#if (TRC_CFG_COMPACT_EVENT_ENCODING == 0)
 				ms->type = (uint8_t) ecode;
+#endif
 				prvTraceUpdateCounters();					
 				RecorderDataPtr->heapMemUsage = heapMemUsage;
 			}
@@ -1712,6 +2475,20 @@ void prvTraceStoreKernelCall(uint32_t ecode, traceObjectClass objectClass, uint3
 	TRACE_ASSERT(objectClass < TRACE_NCLASSES, "prvTraceStoreKernelCall: objectClass >= TRACE_NCLASSES", TRC_UNUSED);
 	TRACE_ASSERT(objectNumber <= RecorderDataPtr->ObjectPropertyTable.NumberOfObjectsPerClass[objectClass], "prvTraceStoreKernelCall: Invalid value for objectNumber", TRC_UNUSED);
 
+#if (TRC_CFG_OBJECT_FILTER == 1)
+	if (TRC_FILTER_ACTIVE() && (prvTraceFilterCurrent() || prvTraceFilterObject((uint8_t)objectClass, (uint16_t)objectNumber)))
+	{
+		return;
+	}
+#endif
+
+#if (TRC_CFG_CONTEXT_BUFFERS == 1)
+	if (contextReplay == NULL && prvTraceContextStore(TRC_CONTEXT_KERNEL_CALL, (uint8_t)ecode, (uint8_t)objectClass, (uint16_t)objectNumber, 0))
+	{
+		return;
+	}
+#endif
+
 	if (recorder_busy)
 	{
 		/*************************************************************************
@@ -1737,6 +2514,12 @@ void prvTraceStoreKernelCall(uint32_t ecode, traceObjectClass objectClass, uint3
 	if (RecorderDataPtr->recorderActive)
 	{
 		dts1 = (uint16_t)prvTraceGetDTS(0xFFFF);
+#if (TRC_CFG_LATENCY_HISTOGRAMS == 1)
+		prvTraceLatencyEvent((uint16_t)ecode, (uint16_t)objectNumber, latencyTimestamp);
+#endif
+#if (TRC_CFG_TRIGGERED_CAPTURE == 1)
+		prvTraceTriggerEvent(TRC_TRIGGER_EVENT, (uint8_t)ecode, (uint16_t)objectNumber, 0);
+#endif
 		hnd8 = prvTraceGet8BitHandle((traceHandle)objectNumber);
 		kse = (KernelCall*) prvTraceNextFreeEventBufferSlot();
 		if (kse != NULL)
@@ -1774,6 +2557,20 @@ void prvTraceStoreKernelCallWithParam(uint32_t evtcode,
 	TRACE_ASSERT(objectClass < TRACE_NCLASSES, "prvTraceStoreKernelCallWithParam: objectClass >= TRACE_NCLASSES", TRC_UNUSED);
 	TRACE_ASSERT(objectNumber <= RecorderDataPtr->ObjectPropertyTable.NumberOfObjectsPerClass[objectClass], "prvTraceStoreKernelCallWithParam: Invalid value for objectNumber", TRC_UNUSED);
 
+#if (TRC_CFG_OBJECT_FILTER == 1)
+	if (TRC_FILTER_ACTIVE() && (prvTraceFilterCurrent() || prvTraceFilterObject((uint8_t)objectClass, (uint16_t)objectNumber)))
+	{
+		return;
+	}
+#endif
+
+#if (TRC_CFG_CONTEXT_BUFFERS == 1)
+	if (contextReplay == NULL && prvTraceContextStore(TRC_CONTEXT_KERNEL_CALL_PARAM, (uint8_t)evtcode, (uint8_t)objectClass, (uint16_t)objectNumber, param))
+	{
+		return;
+	}
+#endif
+
 	if (recorder_busy)
 	{
 		/*************************************************************************
@@ -1794,6 +2591,21 @@ void prvTraceStoreKernelCallWithParam(uint32_t evtcode,
 	if (RecorderDataPtr->recorderActive && handle_of_last_logged_task)
 	{
 		dts2 = (uint8_t)prvTraceGetDTS(0xFF);
+#if (TRC_CFG_COMPACT_EVENT_ENCODING == 1)
+		compactLayout = TRC_COMPACT_LAYOUT_OTHER;	/* DTS in the last byte */
+#endif
+#if (TRC_CFG_LATENCY_HISTOGRAMS == 1)
+		prvTraceLatencyEvent((uint16_t)evtcode, (uint16_t)objectNumber, latencyTimestamp);
+#endif
+#if (TRC_CFG_TRIGGERED_CAPTURE == 1)
+		prvTraceTriggerEvent(TRC_TRIGGER_EVENT, (uint8_t)evtcode, (uint16_t)objectNumber, param);
+#if defined(TRC_CFG_ENABLE_STACK_MONITOR) && (TRC_CFG_ENABLE_STACK_MONITOR == 1)
+		if (evtcode == TRACE_UNUSED_STACK)
+		{
+			prvTraceTriggerEvent(TRC_TRIGGER_STACK_LOW, 0, (uint16_t)objectNumber, param);
+		}
+#endif
+#endif
 		p8 = (uint8_t) prvTraceGetParam(0xFF, param);
 		hnd8 = prvTraceGet8BitHandle((traceHandle)objectNumber);
 		kse = (KernelCallWithParamAndHandle*) prvTraceNextFreeEventBufferSlot();
@@ -1864,6 +2676,20 @@ void prvTraceStoreKernelCallWithNumericParamOnly(uint32_t evtcode, uint32_t para
 
 	TRACE_ASSERT(evtcode < 0xFF, "prvTraceStoreKernelCallWithNumericParamOnly: Invalid value for evtcode", TRC_UNUSED);
 
+#if (TRC_CFG_OBJECT_FILTER == 1)
+	if (TRC_FILTER_ACTIVE() && prvTraceFilterCurrent())
+	{
+		return;
+	}
+#endif
+
+#if (TRC_CFG_CONTEXT_BUFFERS == 1)
+	if (contextReplay == NULL && prvTraceContextStore(TRC_CONTEXT_KERNEL_CALL_NUMERIC, (uint8_t)evtcode, 0, 0, param))
+	{
+		return;
+	}
+#endif
+
 	if (recorder_busy)
 	{
 		/*************************************************************************
@@ -1884,6 +2710,12 @@ void prvTraceStoreKernelCallWithNumericParamOnly(uint32_t evtcode, uint32_t para
 	if (RecorderDataPtr->recorderActive && handle_of_last_logged_task)
 	{
 		dts6 = (uint8_t)prvTraceGetDTS(0xFF);
+#if (TRC_CFG_LATENCY_HISTOGRAMS == 1)
+		prvTraceLatencyEvent((uint16_t)evtcode, 0, latencyTimestamp);
+#endif
+#if (TRC_CFG_TRIGGERED_CAPTURE == 1)
+		prvTraceTriggerEvent(TRC_TRIGGER_EVENT, (uint8_t)evtcode, 0, param);
+#endif
 		restParam = (uint16_t)prvTraceGetParam(0xFFFF, param);
 		kse = (KernelCallWithParam16*) prvTraceNextFreeEventBufferSlot();
 		if (kse != NULL)
@@ -1916,6 +2748,24 @@ void prvTraceStoreTaskswitch(traceHandle task_handle)
 	TRACE_ASSERT(task_handle <= (TRC_CFG_NTASK),
 		"prvTraceStoreTaskswitch: Invalid value for task_handle", TRC_UNUSED);
 
+#if (TRC_CFG_OBJECT_FILTER == 1)
+	if (TRC_FILTER_ACTIVE())
+	{
+		filterTaskExcluded = prvTraceFilterObject(TRACE_CLASS_TASK, task_handle);
+		if (filterTaskExcluded)
+		{
+			return;
+		}
+	}
+#endif
+
+#if (TRC_CFG_CONTEXT_BUFFERS == 1)
+	if (contextReplay == NULL && prvTraceContextStore(TRC_CONTEXT_TASK_SWITCH, 0, 0, task_handle, 0))
+	{
+		return;
+	}
+#endif
+
 	trcCRITICAL_SECTION_BEGIN_ON_CORTEX_M_ONLY();
 
 	if ((task_handle != handle_of_last_logged_task) && (RecorderDataPtr->recorderActive))
@@ -1925,6 +2775,9 @@ void prvTraceStoreTaskswitch(traceHandle task_handle)
 #endif
 
 		dts3 = (uint16_t)prvTraceGetDTS(0xFFFF);
+#if (TRC_CFG_LATENCY_HISTOGRAMS == 1)
+		prvTraceLatencyEvent(TRC_LATENCY_TASK_SWITCH_IN, task_handle, latencyTimestamp);
+#endif
 		handle_of_last_logged_task = task_handle;
 		hnd8 = prvTraceGet8BitHandle(handle_of_last_logged_task);
 		ts = (TSEvent*)prvTraceNextFreeEventBufferSlot();
@@ -1977,7 +2830,13 @@ void prvTraceStoreObjectNameOnCloseEvent(uint8_t evtcode, traceHandle handle,
 
 	if (RecorderDataPtr->recorderActive)
 	{
-		uint8_t hnd8 = prvTraceGet8BitHandle(handle);
+		uint8_t hnd8;
+
+#if (TRC_CFG_CONTEXT_BUFFERS == 1)
+		/* Earlier events may refer to the object being closed */
+		prvTraceContextReplayAll();
+#endif
+		hnd8 = prvTraceGet8BitHandle(handle);
 		name = TRACE_PROPERTY_NAME_GET(objectclass, handle);
 		idx = prvTraceOpenSymbol(name, 0);
 
@@ -2005,6 +2864,9 @@ void prvTraceStoreObjectPropertiesOnCloseEvent(uint8_t evtcode, traceHandle hand
 
 	if (RecorderDataPtr->recorderActive)
 	{
+#if (TRC_CFG_CONTEXT_BUFFERS == 1)
+		prvTraceContextReplayAll();
+#endif
 		// Interrupt disable not necessary, already done in trcHooks.h macro
 		pe = (ObjClosePropEvent*) prvTraceNextFreeEventBufferSlot();
 		if (pe != NULL)
@@ -2069,6 +2931,13 @@ void prvTraceSetTaskInstanceFinished(traceHandle handle)
 		"prvTraceSetTaskInstanceFinished: Invalid value for handle", TRC_UNUSED);
 
 #if (TRC_CFG_USE_IMPLICIT_IFE_RULES == 1)
+#if (TRC_CFG_CONTEXT_BUFFERS == 1)
+	/* Must not overtake the captured task switch to this task */
+	if (contextReplay == NULL && prvTraceContextStore(TRC_CONTEXT_INSTANCE_FINISHED, 0, 0, handle, 0))
+	{
+		return;
+	}
+#endif
 	TRACE_PROPERTY_OBJECT_STATE(TRACE_CLASS_TASK, handle) = 0;
 #endif
 }
@@ -2144,7 +3013,15 @@ void prvTraceInitTraceData()
 	(void)memset(RecorderDataPtr, 0, sizeof(RecorderDataType));
 	
 	RecorderDataPtr->version = TRACE_KERNEL_VERSION;
+#if (TRC_CFG_COMPACT_EVENT_ENCODING == 1)
+	RecorderDataPtr->minor_version = (uint8_t)(TRC_COMPACT_MINOR_VERSION_FLAG + (TRC_CFG_COMPACT_BLOCK_SIZE) / 8);
+	prvTraceCompactReset();
+#else
 	RecorderDataPtr->minor_version = TRACE_MINOR_VERSION;
+#endif
+#if (TRC_CFG_CONTEXT_BUFFERS == 1)
+	prvTraceContextInit();
+#endif
 	RecorderDataPtr->irq_priority_order = TRC_IRQ_PRIORITY_ORDER;
 	RecorderDataPtr->filesize = sizeof(RecorderDataType);
 	RecorderDataPtr->maxEvents = (TRC_CFG_EVENT_BUFFER_SIZE);
@@ -2154,10 +3031,21 @@ void prvTraceInitTraceData()
 
 	/* This function is kernel specific */
 	vTraceInitObjectPropertyTable();
+#if (TRC_CFG_OBJECT_FILTER == 1)
+	prvTraceFilterInit();
+#endif
 
 	RecorderDataPtr->debugMarker1 = (int32_t)0xF1F1F1F1;
 	RecorderDataPtr->SymbolTable.symTableSize = (TRC_CFG_SYMBOL_TABLE_SIZE);
 	RecorderDataPtr->SymbolTable.nextFreeSymbolIndex = 1;
+#if (TRC_CFG_HASHED_SYMBOL_TABLE == 1)
+	(void)memset(symbolSlots, 0, sizeof(symbolSlots));
+	symbolSlotsUsed = 0;
+	symbolSlotsFull = 0;
+#endif
+#if ((TRC_CFG_DEFERRED_PRINTF == 1) && (TRC_CFG_SCHEDULING_ONLY == 0) && (TRC_CFG_INCLUDE_USER_EVENTS == 1))
+	(void)memset(formatCache, 0, sizeof(formatCache));
+#endif
 #if (TRC_CFG_INCLUDE_FLOAT_SUPPORT == 1)
 	RecorderDataPtr->exampleFloatEncoding = 1.0f; /* otherwise already zero */
 #endif
@@ -2239,12 +3127,17 @@ void* prvTraceNextFreeEventBufferSlot(void)
 		return NULL;
 	}
 
+#if (TRC_CFG_COMPACT_EVENT_ENCODING == 1)
+	compactStage.word = 0;
+	return (void*)&compactStage;
+#else
 	if (RecorderDataPtr->nextFreeIndex >= (TRC_CFG_EVENT_BUFFER_SIZE))
 	{
 		prvTraceError("Attempt to index outside event buffer!");
 		return NULL;
 	}
 	return (void*)(&RecorderDataPtr->eventData[RecorderDataPtr->nextFreeIndex*4]);
+#endif
 }
 
 uint16_t uiIndexOfObject(traceHandle objecthandle, uint8_t objectclass)
@@ -2419,6 +3312,9 @@ traceString prvTraceOpenSymbol(const char* name, traceString userEventChannel)
 	uint16_t result;
 	uint8_t len;
 	uint8_t crc;
+#if (TRC_CFG_HASHED_SYMBOL_TABLE == 1)
+	uint32_t hash;
+#endif
 	TRACE_ALLOC_CRITICAL_SECTION();
 	
 	len = 0;
@@ -2426,6 +3322,21 @@ traceString prvTraceOpenSymbol(const char* name, traceString userEventChannel)
 	
 	TRACE_ASSERT(name != NULL, "prvTraceOpenSymbol: name == NULL", (traceString)0);
 
+#if (TRC_CFG_HASHED_SYMBOL_TABLE == 1)
+	prvTraceGetSymbolHash(name, userEventChannel, &crc, &len, &hash);
+
+	trcCRITICAL_SECTION_BEGIN();
+	result = prvTraceLookupSymbolHash(name, crc, len, hash, userEventChannel);
+	if (!result)
+	{
+		result = prvTraceCreateSymbolTableEntry(name, crc, len, userEventChannel);
+		if (result)
+		{
+			prvTraceInsertSymbolHash(hash, result);
+		}
+	}
+	trcCRITICAL_SECTION_END();
+#else
 	prvTraceGetChecksum(name, &crc, &len);
 
 	trcCRITICAL_SECTION_BEGIN();
@@ -2435,6 +3346,7 @@ traceString prvTraceOpenSymbol(const char* name, traceString userEventChannel)
 		result = prvTraceCreateSymbolTableEntry(name, crc, len, userEventChannel);
 	}
 	trcCRITICAL_SECTION_END();
+#endif
 
 	return result;
 }
@@ -2571,6 +3483,11 @@ void prvTraceUpdateCounters(void)
 	{
 		return;
 	}
+
+#if (TRC_CFG_COMPACT_EVENT_ENCODING == 1)
+	prvTraceCompactStore(NULL, 0);
+	return;
+#endif
 	
 	RecorderDataPtr->numEvents++;
 
@@ -2589,6 +3506,10 @@ void prvTraceUpdateCounters(void)
 #if (TRC_CFG_SNAPSHOT_MODE == TRC_SNAPSHOT_MODE_RING_BUFFER)
 	prvCheckDataToBeOverwrittenForMultiEntryEvents(1);
 #endif
+
+#if (TRC_CFG_TRIGGERED_CAPTURE == 1)
+	TRC_TRIGGER_CHECK_FREEZE();
+#endif
 }
 
 /******************************************************************************
@@ -2604,12 +3525,23 @@ void prvTraceUpdateCounters(void)
 uint16_t prvTraceGetDTS(uint16_t param_maxDTS)
 {
 	static uint32_t old_timestamp = 0;
+#if (TRC_CFG_COMPACT_EVENT_ENCODING == 0)
 	XTSEvent* xts = 0;
+#endif
 	uint32_t dts = 0;
 	uint32_t timestamp = 0;
 
 	TRACE_ASSERT(param_maxDTS == 0xFF || param_maxDTS == 0xFFFF, "prvTraceGetDTS: Invalid value for param_maxDTS", 0);
 
+#if (TRC_CFG_CONTEXT_BUFFERS == 1)
+	if (contextReplay == NULL)
+	{
+		/* An event stored directly, e.g. a user event. Store what the context
+		buffers hold first, as it happened before. */
+		prvTraceContextReplayAll();
+	}
+#endif
+
 	
 	if (RecorderDataPtr->frequency == 0)
 	{	
@@ -2637,6 +3569,9 @@ uint16_t prvTraceGetDTS(uint16_t param_maxDTS)
 	**************************************************************************/
 	
 	prvTracePortGetTimeStamp(&timestamp);	
+#if (TRC_CFG_LATENCY_HISTOGRAMS == 1)
+	latencyTimestamp = timestamp;
+#endif
 	
 	/***************************************************************************
 	* Since dts is unsigned the result will be correct even if timestamp has
@@ -2675,6 +3610,12 @@ uint16_t prvTraceGetDTS(uint16_t param_maxDTS)
 		RecorderDataPtr->absTimeLastEvent = timestamp;
 	}
 
+#if (TRC_CFG_COMPACT_EVENT_ENCODING == 1)
+	/* Stored in full with the next event. Added to, should the previous event
+	not have been stored after all. */
+	compactDTS += dts;
+	compactLayout = (param_maxDTS == 0xFFFF) ? TRC_COMPACT_LAYOUT_HANDLE : TRC_COMPACT_LAYOUT_PARAM;
+#else
 	/* If the dts (time since last event) does not fit in event->dts (only 8 or 16 bits) */
 	if (dts > param_maxDTS)
 	{
@@ -2702,121 +3643,1679 @@ uint16_t prvTraceGetDTS(uint16_t param_maxDTS)
 			prvTraceUpdateCounters();
 		}
 	}
+#endif
 
 	return (uint16_t)dts & param_maxDTS;
 }
 
+#if (TRC_CFG_COMPACT_EVENT_ENCODING == 1)
 /*******************************************************************************
- * prvTraceLookupSymbolTableEntry
+ * prvTraceCompactReset
  *
- * Find an entry in the symbol table, return 0 if not present.
- *
- * The strings are stored in a byte pool, with four bytes of "meta-data" for
- * every string.
- * byte 0-1: index of next entry with same checksum (for fast lookup).
- * byte 2-3: reference to a symbol table entry, a label for vTracePrintF
- * format strings only (the handle of the destination channel).
- * byte 4..(4 + length): the string (object name or user event label), with
- * zero-termination
+ * Empties the compact event buffer. Called on init and from vTraceClear.
  ******************************************************************************/
-traceString prvTraceLookupSymbolTableEntry(const char* name,
-										 uint8_t crc6,
-										 uint8_t len,
-										 traceString chn)
+static void prvTraceCompactReset(void)
 {
-	uint16_t i = RecorderDataPtr->SymbolTable.latestEntryOfChecksum[ crc6 ];
+	(void)memset(&compactRing, 0, sizeof(compactRing));
+	compactRing.data = RecorderDataPtr->eventData;
+	compactRing.blockSize = (TRC_CFG_COMPACT_BLOCK_SIZE);
+	compactRing.size = ((TRC_CFG_EVENT_BUFFER_SIZE) * 4 / (TRC_CFG_COMPACT_BLOCK_SIZE)) * (TRC_CFG_COMPACT_BLOCK_SIZE);
+#if (TRC_CFG_SNAPSHOT_MODE == TRC_SNAPSHOT_MODE_STOP_WHEN_FULL)
+	compactRing.stopWhenFull = 1;
+#endif
+	compactDTS = 0;
+	compactLayout = TRC_COMPACT_LAYOUT_NONE;
+	compactHasXPS = 0;
+}
 
-	TRACE_ASSERT(name != NULL, "prvTraceLookupSymbolTableEntry: name == NULL", (traceString)0);
-	TRACE_ASSERT(len != 0, "prvTraceLookupSymbolTableEntry: len == 0", (traceString)0);
+/*******************************************************************************
+ * prvTraceCompactFull
+ *
+ * Stops the recorder when the buffer is full in stop-when-full mode. The time
+ * of the events that were not stored has already been added to the absolute
+ * time of the last event, which the trace is aligned on, so it is taken back.
+ ******************************************************************************/
+static void prvTraceCompactFull(uint32_t dts)
+{
+	uint32_t freq = RecorderDataPtr->frequency;
 
-	while (i != 0)
+	if (freq > 0)
 	{
-		if (RecorderDataPtr->SymbolTable.symbytes[i + 2] == (chn & 0x00FF))
+		RecorderDataPtr->absTimeLastEventSecond -= dts / freq;
+		dts %= freq;
+		if (RecorderDataPtr->absTimeLastEvent < dts)
 		{
-			if (RecorderDataPtr->SymbolTable.symbytes[i + 3] == (chn / 0x100))
-			{
-				if (RecorderDataPtr->SymbolTable.symbytes[i + 4 + len] == '\0')
-				{
-					if (strncmp((char*)(& RecorderDataPtr->SymbolTable.symbytes[i + 4]), name, len) == 0)
-					{
-						break; /* found */
-					}
-				}
-			}
+			RecorderDataPtr->absTimeLastEventSecond--;
+			RecorderDataPtr->absTimeLastEvent += freq;
 		}
-		i = (uint16_t)(RecorderDataPtr->SymbolTable.symbytes[i] + (RecorderDataPtr->SymbolTable.symbytes[i + 1] * 0x100));
+		RecorderDataPtr->absTimeLastEvent -= dts;
 	}
-	return i;
+	vTraceStop();
 }
 
 /*******************************************************************************
- * prvTraceCreateSymbolTableEntry
- *
- * Creates an entry in the symbol table, independent if it exists already.
+ * prvTraceCompactStore
  *
- * The strings are stored in a byte pool, with four bytes of "meta-data" for
- * every string.
- * byte 0-1: index of next entry with same checksum (for fast lookup).
- * byte 2-3: reference to a symbol table entry, a label for vTracePrintF
- * format strings only (the handle of the destination channel).
- * byte 4..(4 + length): the string (object name or user event label), with
- * zero-termination
+ * Encodes the record in compactStage (followed by argSlots argument slots for
+ * a user event) into the event buffer. Takes the place of advancing
+ * nextFreeIndex in prvTraceUpdateCounters, which is a byte offset in this mode.
  ******************************************************************************/
-uint16_t prvTraceCreateSymbolTableEntry(const char* name,
-										uint8_t crc6,
-										uint8_t len,
-										traceString channel)
+static void prvTraceCompactStore(const uint8_t* args, uint8_t argSlots)
 {
-	uint16_t ret = 0;
-
-	TRACE_ASSERT(name != NULL, "prvTraceCreateSymbolTableEntry: name == NULL", 0);
-	TRACE_ASSERT(len != 0, "prvTraceCreateSymbolTableEntry: len == 0", 0);
+	TraceCompactEvent e;
+	uint8_t type = compactStage.bytes[0];
+	uint8_t layout = compactLayout;
 
-	if (RecorderDataPtr->SymbolTable.nextFreeSymbolIndex + len + 4 >= (TRC_CFG_SYMBOL_TABLE_SIZE))
+	if (type == DIV_XPS || type == XID)
 	{
-		prvTraceError("Symbol table full. Increase TRC_CFG_SYMBOL_TABLE_SIZE in trcConfig.h");
-		ret = 0;
+		/* Stored between prvTraceGetDTS and the event they belong to */
+		layout = TRC_COMPACT_LAYOUT_NONE;
 	}
-	else
+	else if (type >= USER_EVENT && type < USER_EVENT + 16)
 	{
+		layout = TRC_COMPACT_LAYOUT_OTHER;
+	}
 
-		RecorderDataPtr->SymbolTable.symbytes
-			[ RecorderDataPtr->SymbolTable.nextFreeSymbolIndex] =
-			(uint8_t)(RecorderDataPtr->SymbolTable.latestEntryOfChecksum[ crc6 ] & 0x00FF);
-
-		RecorderDataPtr->SymbolTable.symbytes
-			[ RecorderDataPtr->SymbolTable.nextFreeSymbolIndex + 1] =
-			(uint8_t)(RecorderDataPtr->SymbolTable.latestEntryOfChecksum[ crc6 ] / 0x100);
+	if (compactHasXPS && layout != TRC_COMPACT_LAYOUT_PARAM)
+	{
+		e.record = compactXPS.bytes;
+		e.layout = TRC_COMPACT_LAYOUT_NONE;
+		e.dts = 0;
+		compactHasXPS = 0;
+		if (prvTraceCompactWrite(&compactRing, &e) != 0)
+		{
+			prvTraceCompactFull(compactDTS);
+			return;
+		}
+		RecorderDataPtr->numEvents++;
+	}
 
-		RecorderDataPtr->SymbolTable.symbytes
-			[ RecorderDataPtr->SymbolTable.nextFreeSymbolIndex + 2] =
-			(uint8_t)(channel & 0x00FF);
+	if (type == DIV_XPS)
+	{
+		compactXPS = compactStage;
+		compactHasXPS = 1;
+		return;
+	}
 
-		RecorderDataPtr->SymbolTable.symbytes
-			[ RecorderDataPtr->SymbolTable.nextFreeSymbolIndex + 3] =
-			(uint8_t)(channel / 0x100);
+	e.record = compactStage.bytes;
+	e.args = args;
+	e.argSlots = argSlots;
+	e.layout = layout;
+	e.dts = 0;
+	e.param = 0;
+	if (layout != TRC_COMPACT_LAYOUT_NONE)
+	{
+		e.dts = compactDTS;
+		compactDTS = 0;
+		compactLayout = TRC_COMPACT_LAYOUT_NONE;
+	}
 
-		/* set name (bytes 4...4+len-1) */
-		prvStrncpy((char*)&(RecorderDataPtr->SymbolTable.symbytes
-			[ RecorderDataPtr->SymbolTable.nextFreeSymbolIndex + 4]), name, len);
+	if (layout == TRC_COMPACT_LAYOUT_PARAM)
+	{
+		/* Parameters above 0xFFFF came with an XPS record */
+		e.param = compactStage.param16.param;
+		if (compactHasXPS)
+		{
+			e.param |= (uint32_t)compactXPS.xps.xps_16 << 16;
+			compactHasXPS = 0;
+		}
+	}
 
-		/* Set zero termination (at offset 4+len) */
-		RecorderDataPtr->SymbolTable.symbytes
-			[RecorderDataPtr->SymbolTable.nextFreeSymbolIndex + 4 + len] = '\0';
+	if (prvTraceCompactWrite(&compactRing, &e) != 0)
+	{
+		prvTraceCompactFull(e.dts + compactDTS);
+		return;
+	}
 
-		/* store index of entry (for return value, and as head of LL[crc6]) */
-		RecorderDataPtr->SymbolTable.latestEntryOfChecksum
-			[ crc6 ] = (uint16_t)RecorderDataPtr->SymbolTable.nextFreeSymbolIndex;
+	RecorderDataPtr->numEvents++;
+	RecorderDataPtr->nextFreeIndex = compactRing.next;
+	if (compactRing.wrapped)
+	{
+		RecorderDataPtr->bufferIsFull = 1;
+	}
+}
+#endif /* (TRC_CFG_COMPACT_EVENT_ENCODING == 1) */
 
-		RecorderDataPtr->SymbolTable.nextFreeSymbolIndex += (uint32_t) (len + 5);
+#if (TRC_CFG_CONTEXT_BUFFERS == 1)
+/* TRC_HWTC_COUNT as an increasing count */
+static uint32_t prvTraceContextHWTC(void)
+{
+#if (TRC_HWTC_TYPE == TRC_OS_TIMER_INCR || TRC_HWTC_TYPE == TRC_FREE_RUNNING_32BIT_INCR)
+	return (TRC_HWTC_COUNT);
+#else
+	return (TRC_HWTC_PERIOD) - (TRC_HWTC_COUNT);
+#endif
+}
 
-		ret = (uint16_t)(RecorderDataPtr->SymbolTable.nextFreeSymbolIndex - (uint8_t)(len + 5));
+/* Counts from start to end, for the statistics */
+static uint32_t prvTraceContextElapsed(uint32_t start, uint32_t end)
+{
+#if (TRC_HWTC_TYPE == TRC_OS_TIMER_INCR || TRC_HWTC_TYPE == TRC_OS_TIMER_DECR)
+	if (end < start)
+	{
+		return end + (TRC_HWTC_PERIOD) - start;
 	}
-
-	return ret;
+#endif
+	return end - start;
 }
 
+/* Capture time of an entry, comparable between buffers */
+static uint32_t prvTraceContextKey(const TraceContextEntry* e)
+{
+#if (TRC_HWTC_TYPE == TRC_OS_TIMER_INCR || TRC_HWTC_TYPE == TRC_OS_TIMER_DECR)
+	return e->tick * (TRC_HWTC_PERIOD) + e->hwtc;
+#else
+	return e->hwtc;
+#endif
+}
+
+static void prvTraceContextInit(void)
+{
+	uint32_t level;
+
+	(void)memset(contextBuffers, 0, sizeof(contextBuffers));
+	contextBuffers[0].entries = contextTaskEntries;
+	contextBuffers[0].mask = (TRC_CFG_CONTEXT_BUFFER_SIZE) - 1;
+	for (level = 1; level < TRC_CONTEXT_LEVELS; level++)
+	{
+		contextBuffers[level].entries = contextISREntries[level - 1];
+		contextBuffers[level].mask = (TRC_CFG_ISR_CONTEXT_BUFFER_SIZE) - 1;
+	}
+}
+
+/*******************************************************************************
+ * prvTraceContextStore
+ *
+ * Captures a recorder call into the buffer of the current context level,
+ * without masking interrupts. An ISR never writes the buffer of the code it
+ * interrupted, so only tasks preempting tasks (or ISRs not reported with
+ * vTraceStoreISRBegin) compete for the same buffer; an entry is reserved with
+ * compare-and-swap and marked complete by writing its sequence number last.
+ *
+ * Returns 0 if the recorder is not active, in which case the call is handled
+ * as usual.
+ ******************************************************************************/
+static int prvTraceContextStore(uint8_t kind, uint8_t code, uint8_t cls, uint16_t handle, uint32_t param)
+{
+	TraceContextBuffer* buf;
+	TraceContextEntry* e;
+	uint32_t level = TRC_CONTEXT_LEVEL();
+	uint32_t idx, hwtc, cost;
+#if (TRC_HWTC_TYPE == TRC_OS_TIMER_INCR || TRC_HWTC_TYPE == TRC_OS_TIMER_DECR)
+	uint32_t tick;
+#endif
+
+	if (RecorderDataPtr == NULL || ! RecorderDataPtr->recorderActive)
+	{
+		return 0;
+	}
+
+	if (level >= TRC_CONTEXT_LEVELS)
+	{
+		level = TRC_CONTEXT_LEVELS - 1;
+	}
+	buf = &contextBuffers[level];
+
+	/* The time is read between reading head and reserving the entry. A writer
+	that preempts in between reserves an entry first, so the compare-and-swap
+	fails and the time is read again: the entries of a buffer are in time
+	order. */
+	do
+	{
+		idx = buf->head;
+		if (idx - buf->tail > buf->mask)
+		{
+			(void)__sync_fetch_and_add(&contextStats.eventsDropped, 1);
+			return 1;
+		}
+#if (TRC_HWTC_TYPE == TRC_OS_TIMER_INCR || TRC_HWTC_TYPE == TRC_OS_TIMER_DECR)
+		/* Read again if the tick interrupt came in between */
+		do
+		{
+			tick = *(volatile uint32_t*)&uiTraceTickCount;
+			hwtc = prvTraceContextHWTC();
+		} while (tick != *(volatile uint32_t*)&uiTraceTickCount);
+#else
+		hwtc = prvTraceContextHWTC();
+#endif
+	} while (! __sync_bool_compare_and_swap(&buf->head, idx, idx + 1));
+
+	e = &buf->entries[idx & buf->mask];
+	e->hwtc = hwtc;
+#if (TRC_HWTC_TYPE == TRC_OS_TIMER_INCR || TRC_HWTC_TYPE == TRC_OS_TIMER_DECR)
+	e->tick = tick;
+#endif
+	e->param = param;
+	e->handle = handle;
+	e->kind = kind;
+	e->code = code;
+	e->cls = cls;
+	cost = prvTraceContextElapsed(hwtc, prvTraceContextHWTC());
+	e->cost = (uint16_t)((cost > 0xFFFF) ? 0xFFFF : cost);
+	__sync_synchronize();
+	e->seq = idx + 1;
+	return 1;
+}
+
+/*******************************************************************************
+ * prvTraceContextReplayNext
+ *
+ * Stores the oldest complete entry of all context buffers in the event buffer,
+ * by making the recorder call it stands for with contextReplay pointing to it.
+ * Returns 0 if there was none. An entry still being written holds back the
+ * later ones of its buffer.
+ *
+ * May only be called within a critical section!
+ ******************************************************************************/
+static int prvTraceContextReplayNext(void)
+{
+	TraceContextBuffer* from = NULL;
+	TraceContextEntry* next = NULL;
+	uint32_t level, nextKey = 0, start, elapsed, pending;
+	int busy;
+
+	for (level = 0; level < TRC_CONTEXT_LEVELS; level++)
+	{
+		TraceContextBuffer* buf = &contextBuffers[level];
+		TraceContextEntry* e = &buf->entries[buf->tail & buf->mask];
+		uint32_t key;
+
+		if (e->seq != buf->tail + 1)
+		{
+			continue;
+		}
+
+		key = prvTraceContextKey(e);
+#if (TRC_HWTC_TYPE == TRC_OS_TIMER_INCR || TRC_HWTC_TYPE == TRC_OS_TIMER_DECR)
+		if (key - buf->lastKey >= 0x80000000 && buf->lastKey - key <= (TRC_HWTC_PERIOD))
+		{
+			/* Captured after the timer wrapped but before the tick interrupt
+			had run, so the tick count was one behind */
+			e->tick++;
+			key += (TRC_HWTC_PERIOD);
+		}
+#endif
+		/* On equal times, the lower level goes first */
+		if (next == NULL || key - nextKey >= 0x80000000)
+		{
+			next = e;
+			nextKey = key;
+			from = buf;
+		}
+	}
+
+	if (next == NULL)
+	{
+		return 0;
+	}
+
+	pending = from->head - from->tail;
+	if (pending > contextStats.maxPending)
+	{
+		contextStats.maxPending = pending;
+	}
+
+	start = prvTraceContextHWTC();
+
+	/* The recorder calls below would report the flush they are called from as
+	a preempted recorder call */
+	busy = recorder_busy;
+	recorder_busy = 0;
+	contextReplay = next;
+
+	switch (next->kind)
+	{
+#if ((!defined TRC_CFG_INCLUDE_READY_EVENTS) || (TRC_CFG_INCLUDE_READY_EVENTS == 1))
+	case TRC_CONTEXT_TASK_READY:
+		prvTraceStoreTaskReady(next->handle);
+		break;
+#endif
+	case TRC_CONTEXT_LOW_POWER:
+		prvTraceStoreLowPower(next->param);
+		break;
+#if (TRC_CFG_SCHEDULING_ONLY == 0)
+	case TRC_CONTEXT_KERNEL_CALL:
+		prvTraceStoreKernelCall(next->code, (traceObjectClass)next->cls, next->handle);
+		break;
+	case TRC_CONTEXT_KERNEL_CALL_PARAM:
+		prvTraceStoreKernelCallWithParam(next->code, (traceObjectClass)next->cls, next->handle, next->param);
+		break;
+	case TRC_CONTEXT_KERNEL_CALL_NUMERIC:
+		prvTraceStoreKernelCallWithNumericParamOnly(next->code, next->param);
+		break;
+#endif
+	case TRC_CONTEXT_TASK_SWITCH:
+		prvTraceStoreTaskswitch(next->handle);
+		break;
+	case TRC_CONTEXT_INSTANCE_FINISHED:
+		prvTraceSetTaskInstanceFinished(next->handle);
+		break;
+#if (TRC_CFG_INCLUDE_ISR_TRACING == 1)
+	case TRC_CONTEXT_ISR_BEGIN:
+		vTraceStoreISRBegin(next->handle);
+		break;
+	case TRC_CONTEXT_ISR_END:
+		vTraceStoreISREnd((int)next->param);
+		break;
+#endif
+	default:
+		break;
+	}
+
+	contextReplay = NULL;
+	recorder_busy = busy;
+	from->lastKey = nextKey;
+	from->tail++;
+
+	elapsed = prvTraceContextElapsed(start, prvTraceContextHWTC());
+	contextStats.eventsCaptured++;
+	contextStats.captureCounts += next->cost;
+	contextStats.replayCounts += elapsed;
+	if (elapsed > contextStats.maxReplayCounts)
+	{
+		contextStats.maxReplayCounts = elapsed;
+	}
+	return 1;
+}
+
+/* Replays everything pending before an event is stored directly. May only be
+called within a critical section! */
+static void prvTraceContextReplayAll(void)
+{
+	while (prvTraceContextReplayNext())
+	{
+	}
+}
+
+/*******************************************************************************
+ * vTraceFlushContextBuffers
+ *
+ * Stores the events captured in the context buffers in the event buffer,
+ * masking interrupts for one event at a time. Call it from the idle hook, and
+ * before reading a snapshot of a running recorder with the debugger.
+ ******************************************************************************/
+void vTraceFlushContextBuffers(void)
+{
+	int more;
+	TRACE_ALLOC_CRITICAL_SECTION();
+
+	if (RecorderDataPtr == NULL)
+	{
+		return;
+	}
+
+	do
+	{
+		TRACE_ENTER_CRITICAL_SECTION();
+		more = prvTraceContextReplayNext();
+		TRACE_EXIT_CRITICAL_SECTION();
+	} while (more);
+}
+
+void vTraceGetContextBufferStats(TraceContextBufferStats* stats)
+{
+	TRACE_ALLOC_CRITICAL_SECTION();
+
+	TRACE_ENTER_CRITICAL_SECTION();
+	*stats = contextStats;
+	TRACE_EXIT_CRITICAL_SECTION();
+}
+#endif /* (TRC_CFG_CONTEXT_BUFFERS == 1) */
+#if (TRC_CFG_LATENCY_HISTOGRAMS == 1)
+/* Histogram bucket of a time: 0 and 1 have their own, above that there are
+two per power of two, [2^n, 1.5 * 2^n) and [1.5 * 2^n, 2^(n+1)) */
+static uint8_t prvTraceLatencyBucket(uint32_t t)
+{
+	uint8_t n = 1;
+
+	if (t < 2)
+	{
+		return (uint8_t)t;
+	}
+	while ((t >> n) > 1)
+	{
+		n++;
+	}
+	n = (uint8_t)(2 * n + ((t >> (n - 1)) & 1));
+	return (n < TRC_LATENCY_BUCKETS) ? n : (TRC_LATENCY_BUCKETS - 1);
+}
+
+/* Highest time that falls in a bucket */
+static uint32_t prvTraceLatencyBucketLimit(uint8_t bucket)
+{
+	uint8_t n = (uint8_t)(bucket / 2);
+
+	if (bucket < 2)
+	{
+		return bucket;
+	}
+	return ((uint32_t)(3 + (bucket & 1)) << (n - 1)) - 1;
+}
+
+static void prvTraceLatencySample(TraceLatencyPair* p, uint32_t t)
+{
+	uint8_t b = prvTraceLatencyBucket(t);
+	uint8_t i;
+
+	if (p->count == 0 || t < p->min)
+	{
+		p->min = t;
+	}
+	if (t > p->max)
+	{
+		p->max = t;
+	}
+	p->count++;
+
+	if (p->buckets[b] == 0xFFFF)
+	{
+		/* Halve the histogram rather than let one bucket saturate, which
+		keeps the percentiles right */
+		for (i = 0; i < TRC_LATENCY_BUCKETS; i++)
+		{
+			p->buckets[i] = (uint16_t)((p->buckets[i] + 1) / 2);
+		}
+	}
+	p->buckets[b]++;
+}
+
+/*******************************************************************************
+ * prvTraceLatencyEvent
+ *
+ * Matches an event against the start and stop events of the latency pairs.
+ *
+ * May only be called within a critical section!
+ ******************************************************************************/
+static void prvTraceLatencyEvent(uint16_t event, uint16_t handle, uint32_t timestamp)
+{
+	uint8_t i;
+
+	for (i = 0; i < latencyPairCount; i++)
+	{
+		TraceLatencyPair* p = &latencyPairs[i];
+
+		if (p->pending)
+		{
+			if (event == p->stopEvent &&
+				(p->stopHandle == TRC_LATENCY_ANY_HANDLE || p->stopHandle == handle))
+			{
+				prvTraceLatencySample(p, timestamp - p->startTime);
+				p->pending = 0;
+#if (TRC_CFG_TRIGGERED_CAPTURE == 1)
+				prvTraceTriggerEvent(TRC_TRIGGER_LATENCY, (uint8_t)(i + 1), 0, timestamp - p->startTime);
+#endif
+			}
+		}
+		else if (event == p->startEvent &&
+			(p->startHandle == TRC_LATENCY_ANY_HANDLE || p->startHandle == handle))
+		{
+			p->startTime = timestamp;
+			p->pending = 1;
+		}
+	}
+}
+
+traceLatency xTraceLatencyPair(const char* name,
+							uint16_t startEvent, uint16_t startHandle,
+							uint16_t stopEvent, uint16_t stopHandle)
+{
+	traceLatency pair = 0;
+	TRACE_ALLOC_CRITICAL_SECTION();
+
+	TRACE_ASSERT(name != NULL, "xTraceLatencyPair: name == NULL", 0);
+
+	trcCRITICAL_SECTION_BEGIN();
+	if (latencyPairCount < (TRC_CFG_LATENCY_PAIRS))
+	{
+		TraceLatencyPair* p = &latencyPairs[latencyPairCount];
+
+		(void)memset(p, 0, sizeof(TraceLatencyPair));
+		p->name = name;
+		p->startEvent = startEvent;
+		p->startHandle = startHandle;
+		p->stopEvent = stopEvent;
+		p->stopHandle = stopHandle;
+		pair = ++latencyPairCount;
+	}
+	trcCRITICAL_SECTION_END();
+
+	if (pair == 0)
+	{
+		prvTraceError("Not enough latency pairs - increase TRC_CFG_LATENCY_PAIRS!");
+	}
+	return pair;
+}
+
+void vTraceLatencyMark(uint16_t handle)
+{
+	uint32_t timestamp;
+	TRACE_ALLOC_CRITICAL_SECTION();
+
+	if (RecorderDataPtr == NULL)
+	{
+		return;
+	}
+
+	trcCRITICAL_SECTION_BEGIN();
+	if (RecorderDataPtr->recorderActive)
+	{
+#if (TRC_CFG_CONTEXT_BUFFERS == 1)
+		/* The captured events come first, they may start a pair */
+		prvTraceContextReplayAll();
+#endif
+		prvTracePortGetTimeStamp(&timestamp);
+		prvTraceLatencyEvent(TRC_LATENCY_MARK, handle, timestamp);
+	}
+	trcCRITICAL_SECTION_END();
+}
+
+void vTraceGetLatencyStats(traceLatency pair, TraceLatencyStats* stats)
+{
+	static const uint8_t percent[3] = { 50, 90, 99 };
+	uint32_t* result[3];
+	uint32_t total = 0, seen = 0;
+	TraceLatencyPair* p;
+	uint8_t i, b = 0;
+	TRACE_ALLOC_CRITICAL_SECTION();
+
+	TRACE_ASSERT(stats != NULL, "vTraceGetLatencyStats: stats == NULL", TRC_UNUSED);
+
+	(void)memset(stats, 0, sizeof(TraceLatencyStats));
+	stats->frequency = (RecorderDataPtr != NULL && RecorderDataPtr->frequency != 0) ?
+		RecorderDataPtr->frequency : (TRC_HWTC_FREQ_HZ) / (TRC_HWTC_DIVISOR);
+
+	TRACE_ASSERT(pair > 0 && pair <= latencyPairCount, "vTraceGetLatencyStats: Invalid pair", TRC_UNUSED);
+	p = &latencyPairs[pair - 1];
+
+	result[0] = &stats->p50;
+	result[1] = &stats->p90;
+	result[2] = &stats->p99;
+
+	trcCRITICAL_SECTION_BEGIN();
+	stats->count = p->count;
+	stats->min = p->min;
+	stats->max = p->max;
+	for (i = 0; i < TRC_LATENCY_BUCKETS; i++)
+	{
+		total += p->buckets[i];
+	}
+	for (i = 0; i < 3 && total > 0; i++)
+	{
+		uint32_t rank = (total * percent[i] + 99) / 100;
+
+		while (seen + p->buckets[b] < rank)
+		{
+			seen += p->buckets[b];
+			b++;
+		}
+		*result[i] = (b == TRC_LATENCY_BUCKETS - 1) ? p->max : prvTraceLatencyBucketLimit(b);
+		if (*result[i] < p->min)
+		{
+			*result[i] = p->min;
+		}
+		if (*result[i] > p->max)
+		{
+			*result[i] = p->max;
+		}
+	}
+	trcCRITICAL_SECTION_END();
+}
+
+void vTraceLatencyReset(void)
+{
+	uint8_t i;
+	TRACE_ALLOC_CRITICAL_SECTION();
+
+	trcCRITICAL_SECTION_BEGIN();
+	for (i = 0; i < latencyPairCount; i++)
+	{
+		TraceLatencyPair* p = &latencyPairs[i];
+
+		p->count = 0;
+		p->min = 0;
+		p->max = 0;
+		p->pending = 0;
+		(void)memset(p->buckets, 0, sizeof(p->buckets));
+	}
+	trcCRITICAL_SECTION_END();
+}
+
+#if ((TRC_CFG_SCHEDULING_ONLY == 0) && (TRC_CFG_INCLUDE_USER_EVENTS == 1))
+static int32_t prvTraceLatencyMicroseconds(uint32_t t, uint32_t frequency)
+{
+	return (int32_t)(((uint64_t)t * 1000000) / frequency);
+}
+
+void vTraceLatencyReport(traceString channel)
+{
+	TraceLatencyStats stats;
+	uint8_t i;
+
+	for (i = 1; i <= latencyPairCount; i++)
+	{
+		vTraceGetLatencyStats(i, &stats);
+		vTracePrintF(channel, "%s n=%d min=%d p50=%d p90=%d p99=%d max=%d",
+			latencyPairs[i - 1].name, (int32_t)stats.count,
+			prvTraceLatencyMicroseconds(stats.min, stats.frequency),
+			prvTraceLatencyMicroseconds(stats.p50, stats.frequency),
+			prvTraceLatencyMicroseconds(stats.p90, stats.frequency),
+			prvTraceLatencyMicroseconds(stats.p99, stats.frequency),
+			prvTraceLatencyMicroseconds(stats.max, stats.frequency));
+	}
+}
+#endif
+#endif /* (TRC_CFG_LATENCY_HISTOGRAMS == 1) */
+
+#if (TRC_CFG_OBJECT_FILTER == 1)
+static void prvTraceFilterInit(void)
+{
+	uint16_t base = 0;
+	uint8_t i;
+
+	for (i = 0; i < TRACE_NCLASSES; i++)
+	{
+		filterBase[i] = base;
+		base = (uint16_t)(base + RecorderDataPtr->ObjectPropertyTable.NumberOfObjectsPerClass[i] + 1);
+	}
+
+	if (base > TRC_FILTER_BITS)
+	{
+		prvTraceError("Object filter too small for the object classes");
+	}
+}
+
+/* If the events of an object are excluded */
+static uint8_t prvTraceFilterObject(uint8_t objectClass, uint16_t handle)
+{
+	uint16_t bit;
+
+	if (RecorderDataPtr == NULL || handle > RecorderDataPtr->ObjectPropertyTable.NumberOfObjectsPerClass[objectClass])
+	{
+		return 0;
+	}
+	bit = (uint16_t)(filterBase[objectClass] + handle);
+	return (uint8_t)((filterBits[bit >> 3] >> (bit & 7)) & 1);
+}
+
+/* If the events of the running task or ISR are excluded */
+static uint8_t prvTraceFilterCurrent(void)
+{
+#if (TRC_CFG_INCLUDE_ISR_TRACING == 1)
+	if (filterISRNesting > 0)
+	{
+		return (uint8_t)((filterISRNesting > 32) ? 0 : ((filterISRExcluded >> (filterISRNesting - 1)) & 1));
+	}
+#endif
+	return filterTaskExcluded;
+}
+
+void vTraceSetObjectExcluded(traceObjectClass objectClass, traceHandle handle, uint8_t excluded)
+{
+	uint16_t first, last, bit;
+	TRACE_ALLOC_CRITICAL_SECTION();
+
+	TRACE_ASSERT(RecorderDataPtr != NULL, "vTraceSetObjectExcluded: Recorder not initialized, call vTraceEnable() first!", TRC_UNUSED);
+	TRACE_ASSERT(objectClass < TRACE_NCLASSES, "vTraceSetObjectExcluded: objectClass >= TRACE_NCLASSES", TRC_UNUSED);
+	TRACE_ASSERT(handle <= RecorderDataPtr->ObjectPropertyTable.NumberOfObjectsPerClass[objectClass], "vTraceSetObjectExcluded: Invalid value for handle", TRC_UNUSED);
+
+	first = filterBase[objectClass];
+	if (handle == TRC_FILTER_ALL_OBJECTS)
+	{
+		last = (uint16_t)(first + RecorderDataPtr->ObjectPropertyTable.NumberOfObjectsPerClass[objectClass]);
+	}
+	else
+	{
+		first = (uint16_t)(first + handle);
+		last = first;
+	}
+
+	TRACE_ENTER_CRITICAL_SECTION();
+	for (bit = first; bit <= last; bit++)
+	{
+		if (excluded)
+		{
+			filterBits[bit >> 3] |= (uint8_t)(1 << (bit & 7));
+		}
+		else
+		{
+			filterBits[bit >> 3] &= (uint8_t)~(1 << (bit & 7));
+		}
+	}
+	TRACE_EXIT_CRITICAL_SECTION();
+}
+
+void vTraceSetAllObjectsExcluded(uint8_t excluded)
+{
+	TRACE_ALLOC_CRITICAL_SECTION();
+
+	TRACE_ENTER_CRITICAL_SECTION();
+	(void)memset(filterBits, excluded ? 0xFF : 0, sizeof(filterBits));
+	TRACE_EXIT_CRITICAL_SECTION();
+}
+
+uint8_t xTraceIsObjectExcluded(traceObjectClass objectClass, traceHandle handle)
+{
+	TRACE_ASSERT(objectClass < TRACE_NCLASSES, "xTraceIsObjectExcluded: objectClass >= TRACE_NCLASSES", 0);
+
+	return prvTraceFilterObject((uint8_t)objectClass, (uint16_t)handle);
+}
+#endif /* (TRC_CFG_OBJECT_FILTER == 1) */
+
+#if (TRC_CFG_TRIGGERED_CAPTURE == 1)
+/*******************************************************************************
+ * prvTraceTriggerEvent
+ *
+ * Checks the triggers against an event being stored. value is the parameter
+ * of kernel calls, the sample of latency pairs and the unused stack of stack
+ * reports.
+ *
+ * NOTE: this function MUST be called from within a critical section.
+ ******************************************************************************/
+static void prvTraceTriggerEvent(uint8_t kind, uint8_t code, uint16_t handle, uint32_t value)
+{
+	uint8_t i;
+
+	if (triggerFired)
+	{
+		return;
+	}
+
+	for (i = 0; i < triggerCount; i++)
+	{
+		TraceTrigger* t = &triggers[i];
+
+		if (t->kind != kind)
+		{
+			continue;
+		}
+
+		switch (kind)
+		{
+			case TRC_TRIGGER_EVENT:
+				if (t->code == code && (t->handle == TRC_TRIGGER_ANY_OBJECT || t->handle == handle))
+				{
+					prvTraceTriggerFire((uint8_t)(i + 1));
+				}
+				break;
+			case TRC_TRIGGER_USER_EVENT:
+				if (t->handle == handle)
+				{
+					prvTraceTriggerFire((uint8_t)(i + 1));
+				}
+				break;
+			case TRC_TRIGGER_LATENCY:
+				if (t->code == code && value > t->threshold)
+				{
+					prvTraceTriggerFire((uint8_t)(i + 1));
+				}
+				break;
+			case TRC_TRIGGER_STACK_LOW:
+				if ((t->handle == TRC_TRIGGER_ANY_OBJECT || t->handle == handle) && value < t->threshold)
+				{
+					prvTraceTriggerFire((uint8_t)(i + 1));
+				}
+				break;
+			default:
+				break;
+		}
+
+		if (triggerFired)
+		{
+			return;
+		}
+	}
+}
+
+/*******************************************************************************
+ * prvTraceTriggerFire
+ *
+ * Starts counting the post-trigger records.
+ *
+ * NOTE: this function MUST be called from within a critical section.
+ ******************************************************************************/
+static void prvTraceTriggerFire(uint8_t trigger)
+{
+	if (triggerFired)
+	{
+		return;
+	}
+
+	triggerFired = 1;
+	triggerWhich = trigger;
+	triggerFreezeAt = RecorderDataPtr->numEvents + (TRC_CFG_TRIGGER_POST_RECORDS);
+}
+
+/*******************************************************************************
+ * prvTraceTriggerFreeze
+ *
+ * Called when the post-trigger records are stored. Copies the last records to
+ * a free capture slot, or stops the recorder if there is none.
+ *
+ * NOTE: this function MUST be called from within a critical section.
+ ******************************************************************************/
+static void prvTraceTriggerFreeze(void)
+{
+	triggerFired = 0;
+
+#if ((TRC_CFG_TRIGGER_CAPTURES) > 0)
+	if (captureCount < (TRC_CFG_TRIGGER_CAPTURES))
+	{
+		prvTraceCaptureCopy(&captures[captureCount]);
+		captureCount++;
+		return;
+	}
+#endif
+
+	vTraceStop();
+}
+
+#if ((TRC_CFG_TRIGGER_CAPTURES) > 0)
+/*******************************************************************************
+ * prvTraceCaptureCopy
+ *
+ * Copies up to TRC_CFG_TRIGGER_CAPTURE_SIZE of the latest records. The copy
+ * starts at a record boundary, found by stepping over the records from the
+ * oldest one, so it never begins with the data of a user event.
+ *
+ * NOTE: this function MUST be called from within a critical section.
+ ******************************************************************************/
+static void prvTraceCaptureCopy(TraceCapture* capture)
+{
+	uint32_t maxEvents = RecorderDataPtr->maxEvents;
+	uint32_t oldest = RecorderDataPtr->bufferIsFull ? RecorderDataPtr->nextFreeIndex : 0;
+	uint32_t stored = RecorderDataPtr->bufferIsFull ? maxEvents : RecorderDataPtr->nextFreeIndex;
+	uint32_t skip = (stored > (TRC_CFG_TRIGGER_CAPTURE_SIZE)) ? stored - (TRC_CFG_TRIGGER_CAPTURE_SIZE) : 0;
+	uint32_t i = 0;
+	uint32_t first;
+	uint32_t n;
+	uint8_t type;
+
+	while (i < skip)
+	{
+		type = RecorderDataPtr->eventData[((oldest + i) % maxEvents) * 4];
+		if (type > USER_EVENT && type < USER_EVENT + 16)
+		{
+			i += 1 + (uint32_t)(type - USER_EVENT);
+		}
+		else
+		{
+			i++;
+		}
+	}
+	if (i > stored)
+	{
+		i = stored;
+	}
+
+	first = (oldest + i) % maxEvents;
+	n = stored - i;
+
+	if (first + n > maxEvents)
+	{
+		(void)memcpy(capture->data, &RecorderDataPtr->eventData[first * 4], (maxEvents - first) * 4);
+		(void)memcpy(&capture->data[(maxEvents - first) * 4], RecorderDataPtr->eventData, (first + n - maxEvents) * 4);
+	}
+	else
+	{
+		(void)memcpy(capture->data, &RecorderDataPtr->eventData[first * 4], n * 4);
+	}
+
+	capture->records = n;
+	capture->absTimeLastEventSecond = RecorderDataPtr->absTimeLastEventSecond;
+	capture->absTimeLastEvent = RecorderDataPtr->absTimeLastEvent;
+	capture->trigger = triggerWhich;
+}
+#endif
+
+static traceTrigger prvTraceTriggerAdd(uint8_t kind, uint8_t code, uint16_t handle, uint32_t threshold)
+{
+	traceTrigger trigger = 0;
+	TRACE_ALLOC_CRITICAL_SECTION();
+
+	trcCRITICAL_SECTION_BEGIN();
+	if (triggerCount < (TRC_CFG_TRIGGERS))
+	{
+		TraceTrigger* t = &triggers[triggerCount];
+
+		t->kind = kind;
+		t->code = code;
+		t->handle = handle;
+		t->threshold = threshold;
+		trigger = ++triggerCount;
+	}
+	trcCRITICAL_SECTION_END();
+
+	if (trigger == 0)
+	{
+		prvTraceError("Not enough triggers - increase TRC_CFG_TRIGGERS!");
+	}
+	return trigger;
+}
+
+traceTrigger xTraceTriggerOnEvent(uint8_t eventCode, traceHandle objectHandle)
+{
+	return prvTraceTriggerAdd(TRC_TRIGGER_EVENT, eventCode, (uint16_t)objectHandle, 0);
+}
+
+traceTrigger xTraceTriggerOnUserEvent(traceString channel)
+{
+	return prvTraceTriggerAdd(TRC_TRIGGER_USER_EVENT, 0, (uint16_t)channel, 0);
+}
+
+traceTrigger xTraceTriggerOnLatency(uint8_t pair, uint32_t threshold)
+{
+	return prvTraceTriggerAdd(TRC_TRIGGER_LATENCY, pair, 0, threshold);
+}
+
+traceTrigger xTraceTriggerOnStackLow(traceHandle task, uint32_t minUnused)
+{
+	return prvTraceTriggerAdd(TRC_TRIGGER_STACK_LOW, 0, (uint16_t)task, minUnused);
+}
+
+void vTraceClearTriggers(void)
+{
+	TRACE_ALLOC_CRITICAL_SECTION();
+
+	trcCRITICAL_SECTION_BEGIN();
+	triggerCount = 0;
+	trcCRITICAL_SECTION_END();
+}
+
+void vTraceTrigger(void)
+{
+	TRACE_ALLOC_CRITICAL_SECTION();
+
+	if (RecorderDataPtr == NULL)
+	{
+		return;
+	}
+
+	trcCRITICAL_SECTION_BEGIN();
+	if (RecorderDataPtr->recorderActive)
+	{
+		prvTraceTriggerFire(0);
+	}
+	trcCRITICAL_SECTION_END();
+}
+
+uint8_t xTraceGetCaptureCount(void)
+{
+#if ((TRC_CFG_TRIGGER_CAPTURES) > 0)
+	return captureCount;
+#else
+	return 0;
+#endif
+}
+
+traceTrigger xTraceGetCaptureTrigger(uint8_t n)
+{
+#if ((TRC_CFG_TRIGGER_CAPTURES) > 0)
+	return (n < captureCount) ? captures[n].trigger : 0;
+#else
+	(void)n;
+	return 0;
+#endif
+}
+
+int xTraceLoadCapture(uint8_t n)
+{
+#if ((TRC_CFG_TRIGGER_CAPTURES) > 0)
+	uint32_t records;
+	TRACE_ALLOC_CRITICAL_SECTION();
+
+	if (RecorderDataPtr == NULL || RecorderDataPtr->recorderActive || n >= captureCount)
+	{
+		return 0;
+	}
+
+	trcCRITICAL_SECTION_BEGIN();
+	records = captures[n].records;
+	(void)memcpy(RecorderDataPtr->eventData, captures[n].data, records * 4);
+	(void)memset(&RecorderDataPtr->eventData[records * 4], 0, (RecorderDataPtr->maxEvents - records) * 4);
+	RecorderDataPtr->numEvents = records;
+	RecorderDataPtr->absTimeLastEventSecond = captures[n].absTimeLastEventSecond;
+	RecorderDataPtr->absTimeLastEvent = captures[n].absTimeLastEvent;
+	if (records >= RecorderDataPtr->maxEvents)
+	{
+		RecorderDataPtr->nextFreeIndex = 0;
+		RecorderDataPtr->bufferIsFull = 1;
+	}
+	else
+	{
+		RecorderDataPtr->nextFreeIndex = records;
+		RecorderDataPtr->bufferIsFull = 0;
+	}
+	trcCRITICAL_SECTION_END();
+
+	return 1;
+#else
+	(void)n;
+	return 0;
+#endif
+}
+#endif /* (TRC_CFG_TRIGGERED_CAPTURE == 1) */
+
+#if (TRC_CFG_PERSISTENT_TRACE == 1)
+/*******************************************************************************
+ * prvTracePersistWritePage
+ *
+ * Writes the page being filled to its slot. A sink without erase gets only the
+ * payload added since the last write and then the header, so a reset half way
+ * leaves the page as it was or with a CRC that does not match.
+ ******************************************************************************/
+static int prvTracePersistWritePage(void)
+{
+	TracePersistHeader* header = (TracePersistHeader*)persist.page;
+	uint32_t address = (uint32_t)(TRC_CFG_PERSIST_BASE) + persist.slot * (TRC_CFG_PERSIST_PAGE_SIZE);
+	int result = 0;
+
+	header->length = (uint16_t)persist.length;
+	header->crc = prvTracePersistPageCRC(persist.page, persist.length);
+
+#ifdef TRC_CFG_PERSIST_ERASE
+	if (TRC_CFG_PERSIST_ERASE(address) != 0 ||
+		TRC_CFG_PERSIST_WRITE(address, persist.page, TRC_PERSIST_HEADER_SIZE + persist.length) != 0)
+	{
+		result = -1;
+	}
+#else
+	if (persist.written < persist.length &&
+		TRC_CFG_PERSIST_WRITE(address + TRC_PERSIST_HEADER_SIZE + persist.written,
+							&persist.page[TRC_PERSIST_HEADER_SIZE + persist.written],
+							persist.length - persist.written) != 0)
+	{
+		result = -1;
+	}
+	else if (TRC_CFG_PERSIST_WRITE(address, persist.page, TRC_PERSIST_HEADER_SIZE) != 0)
+	{
+		result = -1;
+	}
+#endif
+
+	if (result != 0)
+	{
+		persist.stats.sinkErrors++;
+		return -1;
+	}
+	persist.written = persist.length;
+	persist.stats.pagesWritten++;
+	return 0;
+}
+
+/* Starts a page in the next slot. Nothing is written until it is filled or
+flushed. */
+static void prvTracePersistNewPage(uint8_t kind, uint8_t flags, uint32_t info)
+{
+	TracePersistHeader* header = (TracePersistHeader*)persist.page;
+
+	persist.slot = (persist.slot + 1) % (TRC_CFG_PERSIST_PAGES);
+	header->magic = TRC_PERSIST_MAGIC;
+	header->kind = kind;
+	header->flags = flags;
+	header->sequence = persist.sequence++;
+	header->session = persist.stats.session;
+	header->length = 0;
+	header->pageSize = (uint16_t)(TRC_CFG_PERSIST_PAGE_SIZE);
+	header->crc = 0;
+	header->info = info;
+	header->info2 = 0;
+	persist.length = 0;
+	persist.written = 0;
+	persist.pagesSinceMeta++;
+	prvTracePersistCoderReset(&persist.coder);
+}
+
+/* Finds the newest page in the region, to go on after it in a new session */
+static int prvTracePersistStart(void)
+{
+	TracePersistHeader header;
+	uint32_t slot;
+	uint32_t newest = 0;
+	uint16_t session = 0;
+	uint8_t found = 0;
+
+	for (slot = 0; slot < (TRC_CFG_PERSIST_PAGES); slot++)
+	{
+		if (TRC_CFG_PERSIST_READ((uint32_t)(TRC_CFG_PERSIST_BASE) + slot * (TRC_CFG_PERSIST_PAGE_SIZE),
+								&header, TRC_PERSIST_HEADER_SIZE) != 0)
+		{
+			persist.stats.sinkErrors++;
+			return -1;
+		}
+		if (header.magic == TRC_PERSIST_MAGIC && header.pageSize == (TRC_CFG_PERSIST_PAGE_SIZE) &&
+			(!found || (int32_t)(header.sequence - newest) > 0))
+		{
+			found = 1;
+			newest = header.sequence;
+			session = header.session;
+			persist.slot = slot;
+		}
+	}
+
+	if (!found)
+	{
+		persist.slot = (TRC_CFG_PERSIST_PAGES) - 1;
+	}
+	persist.sequence = newest + 1;
+	persist.stats.session = (uint16_t)(session + 1);
+
+	/* A full ring buffer has lost its oldest records already. Start with the
+	next one stored rather than guess where they begin. */
+	if (RecorderDataPtr->bufferIsFull)
+	{
+		persist.readIndex = RecorderDataPtr->nextFreeIndex;
+		persist.readCount = RecorderDataPtr->numEvents;
+	}
+	else
+	{
+		persist.readIndex = 0;
+		persist.readCount = RecorderDataPtr->numEvents - RecorderDataPtr->nextFreeIndex;
+	}
+	persist.open = 0;
+	persist.gap = 0;
+	persist.arguments = 0;
+	persist.started = 1;
+	return 0;
+}
+
+/* FNV-1a of the object and symbol tables, to see if they changed */
+static uint32_t prvTracePersistTablesChecksum(void)
+{
+	const uint8_t* p = (const uint8_t*)&RecorderDataPtr->ObjectPropertyTable;
+	const uint8_t* end = RecorderDataPtr->eventData;
+	uint32_t hash = 2166136261UL;
+
+	while (p < end)
+	{
+		hash = (hash ^ *p++) * 16777619UL;
+	}
+	return hash;
+}
+
+/*******************************************************************************
+ * prvTracePersistMeta
+ *
+ * Writes RecorderDataType without the event buffer to as many meta pages as
+ * needed. The tables are read without a critical section; if they change
+ * meanwhile the checksum differs and the next flush writes them again.
+ ******************************************************************************/
+static int prvTracePersistMeta(void)
+{
+	const uint8_t* image = (const uint8_t*)RecorderDataPtr;
+	uint32_t prefix = (uint32_t)offsetof(RecorderDataType, eventData);
+	uint32_t suffix = prefix + (TRC_CFG_EVENT_BUFFER_SIZE) * 4;
+	uint32_t offset;
+	uint32_t part = 0;
+	uint32_t checksum = prvTracePersistTablesChecksum();
+
+	if (persist.open)
+	{
+		persist.open = 0;
+		if (persist.written < persist.length && prvTracePersistWritePage() != 0)
+		{
+			return -1;
+		}
+	}
+
+	prvTracePersistNewPage(TRC_PERSIST_KIND_META, 0, part);
+	((TracePersistHeader*)persist.page)->info2 = prefix;
+	for (offset = 0; offset < sizeof(RecorderDataType); offset += 4)
+	{
+		if (offset == prefix)
+		{
+			offset = suffix - 4;
+			continue;
+		}
+		if (TRC_PERSIST_HEADER_SIZE + persist.length + TRC_PERSIST_MAX_TOKEN > (TRC_CFG_PERSIST_PAGE_SIZE))
+		{
+			if (prvTracePersistWritePage() != 0)
+			{
+				return -1;
+			}
+			prvTracePersistNewPage(TRC_PERSIST_KIND_META, 0, ++part);
+			((TracePersistHeader*)persist.page)->info2 = prefix;
+		}
+		persist.length += prvTracePersistEncode(&persist.coder,
+						&persist.page[TRC_PERSIST_HEADER_SIZE + persist.length], &image[offset]);
+	}
+	((TracePersistHeader*)persist.page)->flags = TRC_PERSIST_FLAG_LAST;
+	if (prvTracePersistWritePage() != 0)
+	{
+		return -1;
+	}
+
+	persist.metaChecksum = checksum;
+	persist.metaPages = part + 1;
+	persist.pagesSinceMeta = 0;
+
+	/* Room for the copy, the next copy and some event pages in between */
+	if (persist.metaPages * 3 > (TRC_CFG_PERSIST_PAGES))
+	{
+		prvTraceError("TRC_CFG_PERSIST_PAGES too small for the object and symbol tables");
+	}
+	return 0;
+}
+
+/* Adds records to the event page, starting new pages as they fill up */
+static int prvTracePersistAdd(const uint8_t* records, uint32_t count)
+{
+	uint32_t i;
+	uint32_t n;
+	TracePersistHeader* header = (TracePersistHeader*)persist.page;
+
+	if (persist.gap && persist.open)
+	{
+		persist.open = 0;
+		if (persist.written < persist.length && prvTracePersistWritePage() != 0)
+		{
+			persist.stats.recordsLost += count;
+			return -1;
+		}
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		if (persist.open &&
+			TRC_PERSIST_HEADER_SIZE + persist.length + TRC_PERSIST_MAX_TOKEN > (TRC_CFG_PERSIST_PAGE_SIZE))
+		{
+			persist.open = 0;
+			if (prvTracePersistWritePage() != 0)
+			{
+				break;
+			}
+		}
+		if (!persist.open)
+		{
+			/* A new copy of the tables before the ring overwrites the last one */
+			if (persist.pagesSinceMeta + 2 * persist.metaPages + 1 >= (TRC_CFG_PERSIST_PAGES) &&
+				prvTracePersistMeta() != 0)
+			{
+				break;
+			}
+			prvTracePersistNewPage(TRC_PERSIST_KIND_EVENTS,
+						(uint8_t)((persist.gap ? TRC_PERSIST_FLAG_GAP : 0) | (persist.arguments << TRC_PERSIST_SKIP_SHIFT)), 0);
+			persist.gap = 0;
+			persist.open = 1;
+		}
+		if (persist.arguments > 0)
+		{
+			persist.arguments--;
+		}
+		else if (records[i * 4] >= USER_EVENT && records[i * 4] <= USER_EVENT + 15)
+		{
+			persist.arguments = (uint8_t)(records[i * 4] - USER_EVENT);
+		}
+		/* Extending a run changes the bytes of the last token, which may be
+		in the sink already */
+		if (persist.coder.run != NULL &&
+			(uint32_t)(persist.coder.run - &persist.page[TRC_PERSIST_HEADER_SIZE]) < persist.written)
+		{
+			persist.written = (uint32_t)(persist.coder.run - &persist.page[TRC_PERSIST_HEADER_SIZE]);
+		}
+		n = prvTracePersistEncode(&persist.coder, &persist.page[TRC_PERSIST_HEADER_SIZE + persist.length], &records[i * 4]);
+		persist.length += n;
+		persist.stats.bytesSaved += n;
+	}
+
+	if (i < count)
+	{
+		/* The rest of the records are dropped, the next page says so */
+		persist.stats.recordsLost += count - i;
+		persist.arguments = 0;
+		persist.gap = 1;
+		return -1;
+	}
+
+	if (count > 0)
+	{
+		/* The time anchor is for the last record of the page */
+		header->flags &= (uint8_t)~TRC_PERSIST_FLAG_ANCHOR;
+		persist.stats.recordsSaved += count;
+	}
+	return 0;
+}
+
+/*******************************************************************************
+ * xTracePersistFlush
+ *
+ * Saves the records stored since the last call, see trcSnapshotPersist.h.
+ * Interrupts are masked only while up to TRC_PERSIST_CHUNK records are copied
+ * out of the event buffer; the coding and writing is done with them enabled.
+ * Must only be called from one task.
+ ******************************************************************************/
+int xTracePersistFlush(void)
+{
+	uint32_t n;
+	int32_t lag;
+	uint32_t head;
+	uint32_t skipped;
+	uint32_t step;
+	uint8_t type;
+	uint32_t copied = 0;
+	uint32_t absTime = 0;
+	uint32_t absTimeSecond = 0;
+	uint8_t caughtUp = 0;
+	TracePersistHeader* header = (TracePersistHeader*)persist.page;
+	TRACE_ALLOC_CRITICAL_SECTION();
+
+	if (RecorderDataPtr == NULL)
+	{
+		return 0;
+	}
+
+	if (!persist.started && prvTracePersistStart() != 0)
+	{
+		return -1;
+	}
+
+	if (persist.metaPages == 0 || prvTracePersistTablesChecksum() != persist.metaChecksum)
+	{
+		if (prvTracePersistMeta() != 0)
+		{
+			return -1;
+		}
+	}
+
+	/* Gives up for now after a buffer full, if the events come faster than
+	they are saved */
+	while (!caughtUp && copied < RecorderDataPtr->maxEvents)
+	{
+		trcCRITICAL_SECTION_BEGIN();
+		/* readCount also counts the slots zeroed at a wrap, so it can be up to
+		TRC_PERSIST_SLACK ahead */
+		lag = (int32_t)(RecorderDataPtr->numEvents - persist.readCount);
+		if (lag < -TRC_PERSIST_SLACK)
+		{
+			/* Cleared, e.g. by vTraceClear */
+			persist.readIndex = 0;
+			persist.readCount = 0;
+			persist.arguments = 0;
+			persist.gap = 1;
+		}
+		else if (lag > (int32_t)(RecorderDataPtr->maxEvents - TRC_PERSIST_SLACK))
+		{
+			/* Overwritten before they were saved. Go on with the newer half of
+			the buffer, leaving the writer room to go on while it is saved,
+			from the first record boundary after the oldest record. */
+			skipped = 0;
+			persist.readIndex = RecorderDataPtr->nextFreeIndex;
+			while (skipped < RecorderDataPtr->maxEvents / 2)
+			{
+				type = RecorderDataPtr->eventData[persist.readIndex * 4];
+				step = (type >= USER_EVENT && type <= USER_EVENT + 15) ? 1 + type - USER_EVENT : 1;
+				skipped += step;
+				persist.readIndex += step;
+				if (persist.readIndex >= RecorderDataPtr->maxEvents)
+				{
+					persist.readIndex = 0;
+				}
+			}
+			persist.readCount = RecorderDataPtr->numEvents - (RecorderDataPtr->maxEvents - skipped);
+			persist.stats.recordsLost += (uint32_t)lag - (RecorderDataPtr->maxEvents - skipped);
+			persist.arguments = 0;
+			persist.gap = 1;
+		}
+
+		head = RecorderDataPtr->nextFreeIndex;
+		n = (head >= persist.readIndex) ? head - persist.readIndex : RecorderDataPtr->maxEvents - persist.readIndex;
+		if (n > TRC_PERSIST_CHUNK)
+		{
+			n = TRC_PERSIST_CHUNK;
+		}
+		(void)memcpy(persist.staging, &RecorderDataPtr->eventData[persist.readIndex * 4], n * 4);
+		persist.readIndex += n;
+		copied += n;
+
+		/* In stop-when-full mode the head stays at maxEvents when full */
+		if (persist.readIndex == head)
+		{
+			caughtUp = 1;
+			persist.readCount = RecorderDataPtr->numEvents;
+			absTime = RecorderDataPtr->absTimeLastEvent;
+			absTimeSecond = RecorderDataPtr->absTimeLastEventSecond;
+		}
+		else
+		{
+			persist.readCount += n;
+			if (persist.readIndex >= RecorderDataPtr->maxEvents)
+			{
+				persist.readIndex = 0;
+			}
+		}
+		trcCRITICAL_SECTION_END();
+
+		if (prvTracePersistAdd(persist.staging, n) != 0)
+		{
+			return -1;
+		}
+	}
+
+	if (caughtUp && persist.open &&
+		(persist.written < persist.length || !(header->flags & TRC_PERSIST_FLAG_ANCHOR)))
+	{
+		header->flags |= TRC_PERSIST_FLAG_ANCHOR;
+		header->info = absTime;
+		header->info2 = absTimeSecond;
+		if (prvTracePersistWritePage() != 0)
+		{
+			return -1;
+		}
+	}
+	return 0;
+}
+
+void vTracePersistGetStats(TracePersistStats* stats)
+{
+	TRACE_ASSERT(stats != NULL, "vTracePersistGetStats: stats == NULL", TRC_UNUSED);
+
+	*stats = persist.stats;
+}
+#endif /* (TRC_CFG_PERSISTENT_TRACE == 1) */
+
+#if (TRC_CFG_HASHED_SYMBOL_TABLE == 1)
+/*******************************************************************************
+ * prvTraceGetSymbolHash
+ *
+ * Calculates the 6-bit checksum and the length as prvTraceGetChecksum, and a
+ * 32-bit FNV-1a hash of the string and the channel, in one pass.
+ ******************************************************************************/
+static void prvTraceGetSymbolHash(const char* name, traceString channel, uint8_t* pcrc, uint8_t* plength, uint32_t* phash)
+{
+	unsigned char c;
+	int length = 1;		/* Should be 1 to account for '\0' */
+	int crc = 0;
+	uint32_t hash = 2166136261u;
+
+	TRACE_ASSERT(name != NULL, "prvTraceGetSymbolHash: name == NULL", TRC_UNUSED);
+
+	for (; (c = (unsigned char) *name++) != '\0';)
+	{
+		crc += c;
+		length++;
+		hash = (hash ^ c) * 16777619u;
+	}
+	hash = (hash ^ (channel & 0x00FF)) * 16777619u;
+	hash = (hash ^ (channel / 0x100)) * 16777619u;
+
+	*pcrc = (uint8_t)(crc & 0x3F);
+	*plength = (uint8_t)length;
+	*phash = hash;
+}
+
+/*******************************************************************************
+ * prvTraceLookupSymbolHash
+ *
+ * Finds a symbol table entry by its hash, return 0 if not present. The string
+ * is only compared when the full hash and the channel match.
+ *
+ * NOTE: this function MUST be called from within a critical section.
+ ******************************************************************************/
+static traceString prvTraceLookupSymbolHash(const char* name, uint8_t crc6, uint8_t len, uint32_t hash, traceString channel)
+{
+	uint32_t slot = hash & ((TRC_CFG_SYMBOL_HASH_SLOTS) - 1);
+	uint16_t i;
+
+	while ((i = symbolSlots[slot].index) != 0)
+	{
+		if (symbolSlots[slot].hash == hash &&
+			RecorderDataPtr->SymbolTable.symbytes[i + 2] == (channel & 0x00FF) &&
+			RecorderDataPtr->SymbolTable.symbytes[i + 3] == (channel / 0x100) &&
+			memcmp(&RecorderDataPtr->SymbolTable.symbytes[i + 4], name, len) == 0)
+		{
+			return i;
+		}
+		slot = (slot + 1) & ((TRC_CFG_SYMBOL_HASH_SLOTS) - 1);
+	}
+
+	if (symbolSlotsFull)
+	{
+		return prvTraceLookupSymbolTableEntry(name, crc6, len, channel);
+	}
+
+	return 0;
+}
+
+/*******************************************************************************
+ * prvTraceInsertSymbolHash
+ *
+ * Indexes a new symbol table entry. The index is kept at most 3/4 full, later
+ * entries are only found through the checksum chains.
+ *
+ * NOTE: this function MUST be called from within a critical section.
+ ******************************************************************************/
+static void prvTraceInsertSymbolHash(uint32_t hash, traceString index)
+{
+	uint32_t slot = hash & ((TRC_CFG_SYMBOL_HASH_SLOTS) - 1);
+
+	if ((uint32_t)(symbolSlotsUsed + 1) * 4 > (uint32_t)(TRC_CFG_SYMBOL_HASH_SLOTS) * 3)
+	{
+		symbolSlotsFull = 1;
+		return;
+	}
 
+	while (symbolSlots[slot].index != 0)
+	{
+		slot = (slot + 1) & ((TRC_CFG_SYMBOL_HASH_SLOTS) - 1);
+	}
+
+	symbolSlots[slot].hash = hash;
+	symbolSlots[slot].index = index;
+	symbolSlotsUsed++;
+}
+#endif /* (TRC_CFG_HASHED_SYMBOL_TABLE == 1) */
+
+/*******************************************************************************
+ * prvTraceLookupSymbolTableEntry
+ *
+ * Find an entry in the symbol table, return 0 if not present.
+ *
+ * The strings are stored in a byte pool, with four bytes of "meta-data" for
+ * every string.
+ * byte 0-1: index of next entry with same checksum (for fast lookup).
+ * byte 2-3: reference to a symbol table entry, a label for vTracePrintF
+ * format strings only (the handle of the destination channel).
+ * byte 4..(4 + length): the string (object name or user event label), with
+ * zero-termination
+ ******************************************************************************/
+traceString prvTraceLookupSymbolTableEntry(const char* name,
+										 uint8_t crc6,
+										 uint8_t len,
+										 traceString chn)
+{
+	uint16_t i = RecorderDataPtr->SymbolTable.latestEntryOfChecksum[ crc6 ];
+
+	TRACE_ASSERT(name != NULL, "prvTraceLookupSymbolTableEntry: name == NULL", (traceString)0);
+	TRACE_ASSERT(len != 0, "prvTraceLookupSymbolTableEntry: len == 0", (traceString)0);
+
+	while (i != 0)
+	{
+		if (RecorderDataPtr->SymbolTable.symbytes[i + 2] == (chn & 0x00FF))
+		{
+			if (RecorderDataPtr->SymbolTable.symbytes[i + 3] == (chn / 0x100))
+			{
+				if (RecorderDataPtr->SymbolTable.symbytes[i + 4 + len] == '\0')
+				{
+					if (strncmp((char*)(& RecorderDataPtr->SymbolTable.symbytes[i + 4]), name, len) == 0)
+					{
+						break; /* found */
+					}
+				}
+			}
+		}
+		i = (uint16_t)(RecorderDataPtr->SymbolTable.symbytes[i] + (RecorderDataPtr->SymbolTable.symbytes[i + 1] * 0x100));
+	}
+	return i;
+}
+
+/*******************************************************************************
+ * prvTraceCreateSymbolTableEntry
+ *
+ * Creates an entry in the symbol table, independent if it exists already.
+ *
+ * The strings are stored in a byte pool, with four bytes of "meta-data" for
+ * every string.
+ * byte 0-1: index of next entry with same checksum (for fast lookup).
+ * byte 2-3: reference to a symbol table entry, a label for vTracePrintF
+ * format strings only (the handle of the destination channel).
+ * byte 4..(4 + length): the string (object name or user event label), with
+ * zero-termination
+ ******************************************************************************/
+uint16_t prvTraceCreateSymbolTableEntry(const char* name,
+										uint8_t crc6,
+										uint8_t len,
+										traceString channel)
+{
+	uint16_t ret = 0;
+
+	TRACE_ASSERT(name != NULL, "prvTraceCreateSymbolTableEntry: name == NULL", 0);
+	TRACE_ASSERT(len != 0, "prvTraceCreateSymbolTableEntry: len == 0", 0);
+
+	if (RecorderDataPtr->SymbolTable.nextFreeSymbolIndex + len + 4 >= (TRC_CFG_SYMBOL_TABLE_SIZE))
+	{
+		prvTraceError("Symbol table full. Increase TRC_CFG_SYMBOL_TABLE_SIZE in trcConfig.h");
+		ret = 0;
+	}
+	else
+	{
+
+		RecorderDataPtr->SymbolTable.symbytes
+			[ RecorderDataPtr->SymbolTable.nextFreeSymbolIndex] =
+			(uint8_t)(RecorderDataPtr->SymbolTable.latestEntryOfChecksum[ crc6 ] & 0x00FF);
+
+		RecorderDataPtr->SymbolTable.symbytes
+			[ RecorderDataPtr->SymbolTable.nextFreeSymbolIndex + 1] =
+			(uint8_t)(RecorderDataPtr->SymbolTable.latestEntryOfChecksum[ crc6 ] / 0x100);
+
+		RecorderDataPtr->SymbolTable.symbytes
+			[ RecorderDataPtr->SymbolTable.nextFreeSymbolIndex + 2] =
+			(uint8_t)(channel & 0x00FF);
+
+		RecorderDataPtr->SymbolTable.symbytes
+			[ RecorderDataPtr->SymbolTable.nextFreeSymbolIndex + 3] =
+			(uint8_t)(channel / 0x100);
+
+		/* set name (bytes 4...4+len-1) */
+		prvStrncpy((char*)&(RecorderDataPtr->SymbolTable.symbytes
+			[ RecorderDataPtr->SymbolTable.nextFreeSymbolIndex + 4]), name, len);
+
+		/* Set zero termination (at offset 4+len) */
+		RecorderDataPtr->SymbolTable.symbytes
+			[RecorderDataPtr->SymbolTable.nextFreeSymbolIndex + 4 + len] = '\0';
+
+		/* store index of entry (for return value, and as head of LL[crc6]) */
+		RecorderDataPtr->SymbolTable.latestEntryOfChecksum
+			[ crc6 ] = (uint16_t)RecorderDataPtr->SymbolTable.nextFreeSymbolIndex;
+
+		RecorderDataPtr->SymbolTable.nextFreeSymbolIndex += (uint32_t) (len + 5);
+
+		ret = (uint16_t)(RecorderDataPtr->SymbolTable.nextFreeSymbolIndex - (uint8_t)(len + 5));
+	}
+
+	return ret;
+}
+
+
+#if (TRC_CFG_HASHED_SYMBOL_TABLE == 0)
 /*******************************************************************************
  * prvTraceGetChecksum
  *
@@ -2844,6 +5343,7 @@ void prvTraceGetChecksum(const char *pname, uint8_t* pcrc, uint8_t* plength)
 	*pcrc = (uint8_t)(crc & 0x3F);
 	*plength = (uint8_t)length;
 }
+#endif
 
 #if (TRC_CFG_USE_16BIT_OBJECT_HANDLES == 1)
 
@@ -2969,6 +5469,7 @@ void prvTracePortGetTimeStamp(uint32_t *pTimestamp)
 	/* systick based timer */
 	static uint32_t last_traceTickCount = 0;
 	uint32_t traceTickCount = 0;
+	uint32_t currentTickCount = uiTraceTickCount;
 #else /*TRC_HWTC_TYPE == TRC_OS_TIMER_INCR || TRC_HWTC_TYPE == TRC_OS_TIMER_DECR*/
 	/* Free running timer */
 	static uint32_t last_hwtc_rest = 0;
@@ -2994,6 +5495,29 @@ void prvTracePortGetTimeStamp(uint32_t *pTimestamp)
 	#error "TRC_HWTC_TYPE has unexpected value"
 #endif
 
+#if (TRC_CFG_CONTEXT_BUFFERS == 1)
+	if (contextReplay != NULL)
+	{
+		/* Replaying a captured event, use the time it was captured at.
+		Never go back before the previous event. */
+		hwtc_count = contextReplay->hwtc;
+#if (TRC_HWTC_TYPE == TRC_OS_TIMER_INCR || TRC_HWTC_TYPE == TRC_OS_TIMER_DECR)
+		currentTickCount = contextReplay->tick;
+		if ((int32_t)(currentTickCount - last_traceTickCount) < 0 ||
+			(currentTickCount == last_traceTickCount && hwtc_count < last_hwtc_count))
+		{
+			currentTickCount = last_traceTickCount;
+			hwtc_count = last_hwtc_count;
+		}
+#else
+		if ((int32_t)(hwtc_count - last_hwtc_count) < 0)
+		{
+			hwtc_count = last_hwtc_count;
+		}
+#endif
+	}
+#endif
+
 #if (TRC_CFG_HARDWARE_PORT == TRC_HARDWARE_PORT_Win32)
 	/* The Win32 port uses ulGetRunTimeCounterValue for timestamping, which in turn
 	uses QueryPerformanceCounter. That function is not always reliable when used over
@@ -3009,7 +5533,7 @@ void prvTracePortGetTimeStamp(uint32_t *pTimestamp)
 
 #if (TRC_HWTC_TYPE == TRC_OS_TIMER_INCR || TRC_HWTC_TYPE == TRC_OS_TIMER_DECR)
 	/* Timestamping is based on a timer that wraps at TRC_HWTC_PERIOD */
-	if (last_traceTickCount - uiTraceTickCount - 1 < 0x80000000)
+	if (last_traceTickCount - currentTickCount - 1 < 0x80000000)
 	{
 		/* This means last_traceTickCount is higher than uiTraceTickCount,
 		so we have previously compensated for a missed tick.
@@ -3019,7 +5543,7 @@ void prvTracePortGetTimeStamp(uint32_t *pTimestamp)
 	else
 	{
 		/* Business as usual */
-		traceTickCount = uiTraceTickCount;
+		traceTickCount = currentTickCount;
 	}
 
 	/* Check for overflow. May occur if the update of uiTraceTickCount has been
@@ -23,6 +23,7 @@
 #include "I2C.h"
 #include "semphr.h"
 #include "LCD.h"
+#include "trcSnapshotPersist.h"
 
 /* Carlos Home board development set if at home */
 #define HOME_PRO_MX7_BOARD 0
@@ -33,6 +34,9 @@ static void prvSetupHardware( void );
 static void EEPROM_Task(void *pvParameters);
 static void LCD_Task(void *pvParameters);
 static void HeatBeat_Task(void *pvParameters);
+#if ( configUSE_TRACE_FACILITY == 1 ) && ( TRC_CFG_PERSISTENT_TRACE == 1 )
+static void TracePersist_Task(void *pvParameters);
+#endif
 /* ----- UART ISR ----- */
 void vUART_ISR_Handler(void);
 void __attribute__((interrupt(IPL2), vector(_UART_1_VECTOR))) vUART_ISR_Wrapper(void);
@@ -46,6 +50,17 @@ void hw_msDelay(unsigned int);
 /* Semaphore Handles */
 SemaphoreHandle_t EEPROM_Semaphore;
 SemaphoreHandle_t LCD_Semaphore;
+#if ( configUSE_TRACE_FACILITY == 1 ) && ( TRC_CFG_PERSISTENT_TRACE == 1 )
+/* The trace flush shares the EEPROM with the tasks, so I2C access goes
+ * through a mutex; without it only EEPROM_Task and LCD_Task use the bus and
+ * the mutex is left out. */
+SemaphoreHandle_t I2C_Semaphore;
+#define I2C_TAKE()  xSemaphoreTake(I2C_Semaphore, portMAX_DELAY)
+#define I2C_GIVE()  xSemaphoreGive(I2C_Semaphore)
+#else
+#define I2C_TAKE()
+#define I2C_GIVE()
+#endif
 
 /* Queue Handles */
 QueueHandle_t UART_Q;
@@ -127,6 +142,15 @@ int main( void )
         for(;;);
     }
     
+    #if ( configUSE_TRACE_FACILITY == 1 ) && ( TRC_CFG_PERSISTENT_TRACE == 1 )
+        I2C_Semaphore = xSemaphoreCreateMutex(); // the EEPROM starts out free
+        if(I2C_Semaphore == NULL)
+        {
+            vTracePrint(str, "Error creating! I2C_SEMAPHORE!");
+            for(;;);
+        }
+    #endif
+    
     
     /* Create the tasks then start the scheduler. */
     xTaskCreate( EEPROM_Task, "EEPROM_Task", configMINIMAL_STACK_SIZE,
@@ -136,6 +160,10 @@ int main( void )
                                     NULL, tskIDLE_PRIORITY+1, NULL );
     xTaskCreate( HeatBeat_Task, "HeatBeat_Task", configMINIMAL_STACK_SIZE,
                                     NULL, tskIDLE_PRIORITY+2, NULL );
+    #if ( configUSE_TRACE_FACILITY == 1 ) && ( TRC_CFG_PERSISTENT_TRACE == 1 )
+        xTaskCreate( TracePersist_Task, "TracePersist_Task", configMINIMAL_STACK_SIZE,
+                                    NULL, tskIDLE_PRIORITY+1, NULL );
+    #endif
     
 
     vTaskStartScheduler();	/*  Finally start the scheduler. */
@@ -230,6 +258,7 @@ static void EEPROM_Task (void *pvParameters)
         #endif
         
         int message_length = 0;
+        I2C_TAKE();
         portBASE_TYPE UART_Q_Status = xQueueReceive(UART_Q, &charbuf,0);
         while((UART_Q_Status != pdFAIL) && (charbuf != '\r')) //we must have gotten something
         {
@@ -250,6 +279,7 @@ static void EEPROM_Task (void *pvParameters)
         charbuf = NULL;
         EEPROM_WRITE(SAddr, &charbuf, 1);
         EEPROM_POLL();
+        I2C_GIVE();
         message_length = message_length + 1;
         SAddr = SAddr + 1;
         
@@ -330,8 +360,10 @@ static void LCD_Task(void *pvParameters)
             int length = Receive_msg.length;
             char Rmsg[length];
             // Read From EEPROM and Print to UART
+            I2C_TAKE();
             EEPROM_READ(Address, Rmsg, length);
             EEPROM_POLL();
+            I2C_GIVE();
             char message[] = "Read message from EEPROM!\n";
             putsU1(message);
             putsU1(Rmsg);
@@ -368,6 +400,23 @@ static void HeatBeat_Task(void *pvParameters)
         vTaskDelayUntil(&xLastWakeTick, pdMS_TO_TICKS(1)); // delay for 1 ms
     }
 }
+#if ( configUSE_TRACE_FACILITY == 1 ) && ( TRC_CFG_PERSISTENT_TRACE == 1 )
+static void TracePersist_Task(void *pvParameters)
+{
+    TickType_t xLastWakeTick = xTaskGetTickCount();
+
+    for (;;) {
+        /* Save the trace stored since the last pass to the upper half of the
+         * EEPROM so it survives a reset (trcSnapshotPersist.h) */
+        I2C_TAKE();
+        if (xTracePersistFlush() != 0)
+            vTracePrint(str, "Trace flush to EEPROM failed");
+        I2C_GIVE();
+        vTaskDelayUntil(&xLastWakeTick, pdMS_TO_TICKS(100)); // every 100 ms
+    }
+}
+#endif
+
 static void prvSetupHardware( void )
 {
     Cerebot_mx7cK_setup();
@@ -315,6 +315,63 @@ extern "C" {
  *****************************************************************************/
 #define TRC_CFG_STACK_MONITOR_MAX_REPORTS 1
 
+ /******************************************************************************
+ * TRC_CFG_STACK_MONITOR_INCREMENTAL
+ *
+ * Macro which should be defined as either zero (0) or one (1).
+ *
+ * If one (1), the stack monitor checks the stacks itself instead of calling
+ * uxTaskGetStackHighWaterMark for TRC_CFG_STACK_MONITOR_MAX_REPORTS tasks per
+ * TzCtrl pass. Each pass checks at most TRC_CFG_STACK_MONITOR_SCAN_WORDS words,
+ * continuing where the last pass stopped, and each stack is only scanned up to
+ * its known high-water mark. TRACE_UNUSED_STACK is stored when the high-water
+ * mark of a task moves, instead of every pass.
+ *
+ * All tasks the recorder traces are covered (TRC_CFG_NTASK in snapshot mode;
+ * TRC_CFG_STACK_MONITOR_MAX_TASKS is not used), and the ISR stack if
+ * TRC_CFG_STACK_MONITOR_ISR_STACK is 1. Does not need
+ * INCLUDE_uxTaskGetStackHighWaterMark.
+ *****************************************************************************/
+#define TRC_CFG_STACK_MONITOR_INCREMENTAL 1
+
+ /******************************************************************************
+ * TRC_CFG_STACK_MONITOR_SCAN_WORDS
+ *
+ * Macro which should be defined as a non-zero integer value.
+ *
+ * The most stack words checked per TzCtrl pass, for all stacks together, with
+ * the scheduler suspended. With TRC_CFG_CTRL_TASK_DELAY this sets how quickly
+ * a new high-water mark is found.
+ *
+ * Default value is 64.
+ *****************************************************************************/
+#define TRC_CFG_STACK_MONITOR_SCAN_WORDS 64
+
+ /******************************************************************************
+ * TRC_CFG_STACK_MONITOR_MARGIN
+ *
+ * Macro which should be defined as an integer value.
+ *
+ * When a task or the ISR stack has fewer unused words than this, a user event
+ * "<name> below margin, <n> words unused" is stored on the "Stack" channel,
+ * once per stack. To keep the trace around it, see xTraceTriggerOnStackLow
+ * in trcSnapshotTrigger.h.
+ *
+ * Default value is 32.
+ *****************************************************************************/
+#define TRC_CFG_STACK_MONITOR_MARGIN 32
+
+ /******************************************************************************
+ * TRC_CFG_STACK_MONITOR_ISR_STACK
+ *
+ * Macro which should be defined as either zero (0) or one (1).
+ *
+ * If one (1), the incremental stack monitor also checks xISRStack of the PIC32
+ * port. Needs configCHECK_FOR_STACK_OVERFLOW 3, which fills the ISR stack with
+ * a known pattern.
+ *****************************************************************************/
+#define TRC_CFG_STACK_MONITOR_ISR_STACK 1
+
  /*******************************************************************************
  * Configuration Macro: TRC_CFG_CTRL_TASK_PRIORITY
  *
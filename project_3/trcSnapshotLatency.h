@@ -0,0 +1,115 @@
+/*******************************************************************************
+ * Trace Recorder Library for Tracealyzer v4.3.11
+ *
+ * trcSnapshotLatency.h
+ *
+ * Latency histograms for the snapshot recorder, used when
+ * TRC_CFG_LATENCY_HISTOGRAMS is 1.
+ *
+ * A latency pair names a start event and a stop event, e.g. an ISR beginning
+ * and the task it wakes up being switched in, or a semaphore being given and
+ * taken. The recorder matches the events as it stores them and keeps, for
+ * each pair, the number of samples, the shortest and the longest, and a
+ * histogram with two buckets per power of two. The 50th, 90th and 99th
+ * percentiles are read from the histogram, at most half a power of two too
+ * high, in about 100 bytes per pair and without storing any extra events.
+ *
+ * A start that comes while the pair is already waiting for its stop is
+ * ignored, so the sample is measured from the first start. A stop without a
+ * start is ignored as well.
+ *
+ * Events:
+ *  0x00 - 0xFF                 Kernel call event codes as in trcKernelPort.h,
+ *                              e.g. EVENTGROUP_SEND_TRCSUCCESS +
+ *                              TRACE_CLASS_SEMAPHORE. Handle from
+ *                              prvTraceGetQueueNumberLow16(object).
+ *  TRC_LATENCY_ISR_BEGIN       vTraceStoreISRBegin. Handle from
+ *                              xTraceSetISRProperties.
+ *  TRC_LATENCY_TASK_SWITCH_IN  A task starting or resuming after a task
+ *                              switch. Handle from
+ *                              prvTraceGetTaskNumberLow16(task).
+ *  TRC_LATENCY_MARK            vTraceLatencyMark, for points in the
+ *                              application that are not kernel events. The
+ *                              handle is any number but 0.
+ *
+ * TRC_LATENCY_ANY_HANDLE as the handle matches every object.
+ *
+ * Example, from a button ISR to the task it unblocks and from a received
+ * request to the reply being sent:
+ *
+ *	 lat1 = xTraceLatencyPair("BTN1 to LEDC",
+ *			TRC_LATENCY_ISR_BEGIN, isrHandle,
+ *			TRC_LATENCY_TASK_SWITCH_IN, prvTraceGetTaskNumberLow16(ledcTask));
+ *	 lat2 = xTraceLatencyPair("recv to send",
+ *			TRC_LATENCY_MARK, 1, TRC_LATENCY_MARK, 2);
+ *	 ...
+ *	 FreeRTOS_recv(...);
+ *	 vTraceLatencyMark(1);
+ *	 ...
+ *	 FreeRTOS_send(...);
+ *	 vTraceLatencyMark(2);
+ *	 ...
+ *	 vTraceLatencyReport(xTraceRegisterString("Latency"));
+ *
+ * vTraceLatencyReport stores one user event per pair, so the statistics are
+ * part of the snapshot and can be read in Tracealyzer or with tools/trcdecode.
+ *
+ * Tabs are used for indent in this file (1 tab = 4 spaces)
+ ******************************************************************************/
+
+#ifndef TRC_SNAPSHOT_LATENCY_H
+#define TRC_SNAPSHOT_LATENCY_H
+
+#include <stdint.h>
+#include "trcRecorder.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TRC_LATENCY_ISR_BEGIN 0x100
+#define TRC_LATENCY_TASK_SWITCH_IN 0x101
+#define TRC_LATENCY_MARK 0x102
+
+#define TRC_LATENCY_ANY_HANDLE 0
+
+/* Returned by xTraceLatencyPair, 0 if there was no free pair */
+typedef uint8_t traceLatency;
+
+/* Statistics returned by vTraceGetLatencyStats(). Times are in timestamp
+units, frequency per second. The percentiles are the upper bounds of the
+histogram buckets they fall in, limited to min and max. */
+typedef struct
+{
+	uint32_t frequency;
+	uint32_t count;
+	uint32_t min;
+	uint32_t p50;
+	uint32_t p90;
+	uint32_t p99;
+	uint32_t max;
+} TraceLatencyStats;
+
+/* Sets up a latency pair. Call after the recorder is initialized, e.g. after
+vTraceEnable. */
+traceLatency xTraceLatencyPair(const char* name,
+							uint16_t startEvent, uint16_t startHandle,
+							uint16_t stopEvent, uint16_t stopHandle);
+
+/* Application defined start or stop point, see TRC_LATENCY_MARK */
+void vTraceLatencyMark(uint16_t handle);
+
+void vTraceGetLatencyStats(traceLatency pair, TraceLatencyStats* stats);
+
+/* Stores the statistics of every pair as a user event on the channel, in
+microseconds: "<name> n=.. min=.. p50=.. p90=.. p99=.. max=.." */
+void vTraceLatencyReport(traceString channel);
+
+/* Clears the samples of all pairs, keeping the pairs */
+void vTraceLatencyReset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRC_SNAPSHOT_LATENCY_H */
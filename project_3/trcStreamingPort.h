@@ -0,0 +1,132 @@
+/*******************************************************************************
+ * Trace Recorder Library for Tracealyzer v4.3.11
+ *
+ * trcStreamingPort.h
+ *
+ * Stream port for hosted builds, i.e. the kernel running as a process on a
+ * POSIX host (the FreeRTOS Linux simulator). The trace is streamed to a file,
+ * a named pipe or a Unix domain stream socket instead of a debug probe or a
+ * target side network interface, so captures are limited by disk space rather
+ * than by the snapshot recorder's event buffer.
+ *
+ * The recorder's paged event buffer (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_COUNT
+ * pages of TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE bytes) is drained by the TzCtrl
+ * task as usual. TzCtrl only copies full pages into one of two host side
+ * batch buffers; a dedicated writer thread, which is not a kernel task, does
+ * the write() calls on the other one. A slow consumer therefore never stalls
+ * the simulated CPU inside a system call.
+ *
+ * When both batch buffers are full the port either waits for the writer
+ * (TRC_CFG_STREAM_PORT_BLOCK_WHEN_FULL == 1, the default) so that back
+ * pressure reaches the recorder, which then drops events and counts them in
+ * DroppedEventCounter, or discards the page and counts it. Either way the
+ * losses are reported by vTraceStreamPortGetStats() and Tracealyzer shows the
+ * gap from the event counters.
+ *
+ * The destination is TRC_CFG_STREAM_PORT_DESTINATION, overridden at run time
+ * by the TRC_STREAM environment variable:
+ *    "path"          - file or named pipe, created/truncated
+ *    "unix:path"     - connect to a listening Unix domain stream socket, which
+ *                      also carries Tracealyzer's start/stop commands
+ *    "-"             - standard output
+ *
+ * Timestamps: set TRC_CFG_HARDWARE_PORT to TRC_HARDWARE_PORT_APPLICATION_DEFINED
+ * and use uiTraceStreamPortHostTimestamp() as TRC_HWTC_COUNT, with
+ * TRC_HWTC_TYPE TRC_FREE_RUNNING_32BIT_INCR and TRC_HWTC_FREQ_HZ
+ * TRC_STREAM_PORT_HOST_TIMESTAMP_HZ.
+ ******************************************************************************/
+
+#ifndef TRC_STREAMING_PORT_H
+#define TRC_STREAMING_PORT_H
+
+#if !defined(__unix__) && !defined(__APPLE__)
+#error "trcStreamingPort.h: this stream port is for hosted POSIX builds only"
+#endif
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*******************************************************************************
+ * Configuration Macro: TRC_CFG_STREAM_PORT_DESTINATION
+ *
+ * Where the trace is written when the TRC_STREAM environment variable is not
+ * set. See above for the accepted forms.
+ ******************************************************************************/
+#ifndef TRC_CFG_STREAM_PORT_DESTINATION
+#define TRC_CFG_STREAM_PORT_DESTINATION "trace.psf"
+#endif
+
+/*******************************************************************************
+ * Configuration Macro: TRC_CFG_STREAM_PORT_BATCH_SIZE
+ *
+ * Size in bytes of each of the two host side batch buffers. Several recorder
+ * pages are gathered into one write() when the writer falls behind. Must be at
+ * least TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE.
+ ******************************************************************************/
+#ifndef TRC_CFG_STREAM_PORT_BATCH_SIZE
+#define TRC_CFG_STREAM_PORT_BATCH_SIZE ((TRC_CFG_PAGED_EVENT_BUFFER_PAGE_COUNT) * (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE))
+#endif
+
+/*******************************************************************************
+ * Configuration Macro: TRC_CFG_STREAM_PORT_BLOCK_WHEN_FULL
+ *
+ * 1: TzCtrl waits for the writer thread when both batch buffers are full.
+ *    No data is lost in the port; if the consumer stays slow the recorder's
+ *    own page buffer fills and it drops new events instead.
+ * 0: The page is discarded and counted, and TzCtrl never waits.
+ ******************************************************************************/
+#ifndef TRC_CFG_STREAM_PORT_BLOCK_WHEN_FULL
+#define TRC_CFG_STREAM_PORT_BLOCK_WHEN_FULL 1
+#endif
+
+#define TRC_STREAM_PORT_HOST_TIMESTAMP_HZ 1000000
+
+/* Statistics returned by vTraceStreamPortGetStats() */
+typedef struct
+{
+	uint32_t bytesWritten;			/* Bytes the writer thread has written */
+	uint32_t writeCalls;			/* write()/send() calls, fewer than pages when batching */
+	uint32_t pagesQueued;			/* Recorder pages accepted into a batch buffer */
+	uint32_t pagesDropped;			/* Pages discarded (TRC_CFG_STREAM_PORT_BLOCK_WHEN_FULL == 0) */
+	uint32_t bytesDropped;
+	uint32_t stalls;				/* Times TzCtrl waited for the writer */
+	uint32_t maxStallMicroseconds;
+	uint32_t recorderDroppedEvents;	/* DroppedEventCounter, events lost in the recorder's own buffer */
+	int32_t lastError;				/* errno of the first failed write, 0 if none */
+} TraceStreamPortStats;
+
+int32_t prvTraceStreamPortInit(void);
+int32_t prvTraceStreamPortRead(void* ptrData, uint32_t size, int32_t* ptrBytesRead);
+int32_t prvTraceStreamPortWrite(void* ptrData, uint32_t size, int32_t* ptrBytesWritten);
+void prvTraceStreamPortOnTraceBegin(void);
+void prvTraceStreamPortOnTraceEnd(void);
+
+/* Writes out everything buffered, stops the writer thread and closes the
+destination. Call before the process exits. */
+void vTraceStreamPortClose(void);
+
+void vTraceStreamPortGetStats(TraceStreamPortStats* stats);
+
+/* Free running 32 bit microsecond counter from CLOCK_MONOTONIC */
+uint32_t uiTraceStreamPortHostTimestamp(void);
+
+#define TRC_STREAM_PORT_USE_INTERNAL_BUFFER 1
+
+#define TRC_STREAM_PORT_INIT() prvTraceStreamPortInit()
+
+#define TRC_STREAM_PORT_READ_DATA(_ptrData, _size, _ptrBytesRead) prvTraceStreamPortRead(_ptrData, _size, _ptrBytesRead)
+
+#define TRC_STREAM_PORT_WRITE_DATA(_ptrData, _size, _ptrBytesWritten) prvTraceStreamPortWrite(_ptrData, _size, _ptrBytesWritten)
+
+#define TRC_STREAM_PORT_ON_TRACE_BEGIN() prvTraceStreamPortOnTraceBegin()
+
+#define TRC_STREAM_PORT_ON_TRACE_END() prvTraceStreamPortOnTraceEnd()
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRC_STREAMING_PORT_H */
@@ -113,6 +113,7 @@ int EEPROM_READ(int mem_addr, char *i2cdata, int len) {
     IdleI2C2();
     StopI2C2();
     IdleI2C2();
+    return 0;
 }
 
 int EEPROM_WRITE(int mem_addr, char *i2cdata, int len) {
@@ -179,6 +180,7 @@ int EEPROM_WRITE(int mem_addr, char *i2cdata, int len) {
     if (write_err) return (-1); // Some problem during write
 
     EEPROM_POLL();
+    return 0;
 }
 
 void EEPROM_POLL() {
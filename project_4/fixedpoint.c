@@ -0,0 +1,299 @@
+/*  fixedpoint.c
+ *
+ *  Q16.16 and Q1.31 fixed point arithmetic. See fixedpoint.h for the
+ *  formats and ranges.
+ *
+ *  Intermediate products are formed with 32x32->64 bit multiplies, which the
+ *  PIC32 MULT instruction does in hardware. Only q16_div() needs a 64 bit
+ *  divide (a library call); q16_div_fast() and q16_recip() avoid it with a
+ *  Newton-Raphson reciprocal.
+*/
+
+#include <string.h>
+
+#include "fixedpoint.h"
+
+/* Constants of the reciprocal's initial estimate 48/17 - 32/17 * d, in Q2.30 */
+#define RECIP_A     3031741620u     /* 48/17 */
+#define RECIP_B     2021161081u     /* 32/17 */
+#define RECIP_STEPS 3               /* each step doubles the bits of precision */
+
+/* 9/5 and 5/9 in Q2.30. Rounded to Q16.16 they would be off by up to 1/131072,
+ * an error that grows with the temperature (14 LSB at -70 C). */
+#define NINE_FIFTHS 1932735283      /* 1.8 */
+#define FIVE_NINTHS 596523236       /* 0.5555... */
+
+static q16_t saturate(int64_t v)
+{
+    if(v > (int64_t) Q16_MAX)
+        return Q16_MAX;
+    if(v < (int64_t) Q16_MIN)
+        return Q16_MIN;
+    return (q16_t) v;
+}
+
+static uint32_t magnitude(int32_t v)
+{
+    return (v < 0) ? (0u - (uint32_t) v) : (uint32_t) v;
+}
+
+/* Applies a sign to a magnitude of up to 2^31 and saturates */
+static q16_t signed_saturate(uint64_t mag, int negative)
+{
+    if(negative)
+        return (mag > 0x80000000u) ? Q16_MIN : (q16_t) (0u - (uint32_t) mag);
+    return (mag > 0x7FFFFFFFu) ? Q16_MAX : (q16_t) mag;
+}
+
+/* recip_normalized Function Description **************************************
+SYNTAX:         static uint32_t recip_normalized(uint32_t d);
+PARAMETER1:     d - divisor normalized to [0.5, 1) in Q0.32, i.e. bit 31 set
+DESCRIPTION:    Returns 1/d in Q2.30 by Newton-Raphson iteration
+                y = y * (2 - d * y) from a linear first estimate. The
+                estimate's error is at most 1/17 so three steps reach
+                the precision of Q2.30; with the truncation in each step
+                the result is within 2 units of its last place.
+RETURN VALUE:   1/d in Q2.30, in (2^30, 2^31]
+END DESCRIPTION ************************************************************/
+static uint32_t recip_normalized(uint32_t d)
+{
+    uint32_t y, e;
+    int step;
+
+    y = RECIP_A - (uint32_t) (((uint64_t) RECIP_B * d) >> 32);
+
+    for(step = 0; step < RECIP_STEPS; step++)
+    {
+        e = (uint32_t) (((uint64_t) d * y) >> 32);                  // d * y, Q2.30
+        y = (uint32_t) (((uint64_t) y * (0x80000000u - e)) >> 30);  // y * (2 - d * y)
+    }
+
+    return y;
+}
+
+q16_t q16_add(q16_t a, q16_t b)
+{
+    q16_t r = (q16_t) ((uint32_t) a + (uint32_t) b);
+
+    // Overflow if both operands have the same sign and the result does not
+    if(((a ^ r) & (b ^ r)) < 0)
+        r = (a < 0) ? Q16_MIN : Q16_MAX;
+
+    return r;
+}
+
+q16_t q16_sub(q16_t a, q16_t b)
+{
+    q16_t r = (q16_t) ((uint32_t) a - (uint32_t) b);
+
+    // Overflow if the operands differ in sign and the result's sign is b's
+    if(((a ^ b) & (a ^ r)) < 0)
+        r = (a < 0) ? Q16_MIN : Q16_MAX;
+
+    return r;
+}
+
+q16_t q16_mul(q16_t a, q16_t b)
+{
+    int64_t p = (int64_t) a * b;
+
+    return saturate((p + 0x8000) >> 16);
+}
+
+q16_t q16_div(q16_t a, q16_t b)
+{
+    uint64_t ua, ub;
+
+    if(b == 0)
+        return (a < 0) ? Q16_MIN : Q16_MAX;
+
+    ua = (uint64_t) magnitude(a) << 16;
+    ub = magnitude(b);
+
+    return signed_saturate((ua + (ub >> 1)) / ub, (a < 0) != (b < 0));
+}
+
+q16_t q16_div_fast(q16_t a, q16_t b)
+{
+    uint32_t ub, y;
+    uint64_t p;
+    int n, shift;
+
+    if(b == 0)
+        return (a < 0) ? Q16_MIN : Q16_MAX;
+
+    /* b = d * 2^(16 - n) with d in [0.5, 1), so
+     * a / b = a * (1/d) * 2^(n - 16) = (a * y) >> (46 - n) */
+    ub = magnitude(b);
+    n = __builtin_clz(ub);
+    y = recip_normalized(ub << n);
+    shift = 46 - n;
+
+    p = (uint64_t) magnitude(a) * y;
+    p = (p + ((uint64_t) 1 << (shift - 1))) >> shift;
+
+    /* y is within 2 units of its last place, which can put p a few LSB off
+     * for large quotients. Correct p with the remainder of the division,
+     * which only takes a multiply, so it rounds exactly like q16_div().
+     * Larger values of p saturate anyway. */
+    if(p <= 0xFFFFFFFFu)
+    {
+        int64_t r = (int64_t) (((uint64_t) magnitude(a) << 16) + (ub >> 1)) - (int64_t) (p * ub);
+
+        while(r < 0)
+        {
+            p--;
+            r += ub;
+        }
+        while(r >= (int64_t) ub)
+        {
+            p++;
+            r -= ub;
+        }
+    }
+
+    return signed_saturate(p, (a < 0) != (b < 0));
+}
+
+q16_t q16_recip(q16_t x)
+{
+    uint32_t ux, y;
+    uint64_t r;
+    int n;
+
+    if(x == 0)
+        return Q16_MAX;
+
+    /* 1/x = (1/d) * 2^n in Q16.16, with y = (1/d) in Q2.30 */
+    ux = magnitude(x);
+    n = __builtin_clz(ux);
+    y = recip_normalized(ux << n);
+
+    if(n >= 30)
+        r = (uint64_t) y << (n - 30);
+    else
+        r = ((uint64_t) y + (1u << (29 - n))) >> (30 - n);
+
+    return signed_saturate(r, x < 0);
+}
+
+q31_t q31_add(q31_t a, q31_t b)
+{
+    return q16_add(a, b);   // identical in two's complement
+}
+
+q31_t q31_sub(q31_t a, q31_t b)
+{
+    return q16_sub(a, b);
+}
+
+q31_t q31_mul(q31_t a, q31_t b)
+{
+    int64_t p = (int64_t) a * b;
+
+    return saturate((p + 0x40000000) >> 31);    // only -1 * -1 saturates
+}
+
+q31_t q16_to_q31(q16_t x)
+{
+    if(x >= Q16_ONE)
+        return Q31_MAX;
+    if(x < -Q16_ONE)
+        return Q31_MIN;
+    return (q31_t) ((uint32_t) x << 15);
+}
+
+q16_t q31_to_q16(q31_t x)
+{
+    return ((x >> 14) + 1) >> 1;
+}
+
+/* The MLX90614 reports object temperature in units of 0.02 K, so
+ * K = raw / 50 = raw * 32768 / 25 in Q16.16. */
+q16_t q16_mlx90614_to_celsius(uint16_t raw)
+{
+    q16_t kelvin = (q16_t) (((uint32_t) raw * 32768u + 12u) / 25u);
+
+    return kelvin - Q16_CONST(273.15);
+}
+
+q16_t q16_celsius_to_fahrenheit(q16_t celsius)
+{
+    int64_t p = (int64_t) celsius * NINE_FIFTHS + (1 << 29);
+
+    return saturate((p >> 30) + Q16_FROM_INT(32));
+}
+
+q16_t q16_fahrenheit_to_celsius(q16_t fahrenheit)
+{
+    int64_t p = ((int64_t) fahrenheit - Q16_FROM_INT(32)) * FIVE_NINTHS + (1 << 29);
+
+    return saturate(p >> 30);
+}
+
+/* q16_format Function Description ********************************************
+SYNTAX:         size_t q16_format(char *buf, size_t len, q16_t x,
+                                  unsigned int decimals);
+PARAMETER1:     buf - destination for the string
+PARAMETER2:     len - size of buf in bytes
+PARAMETER3:     x - value to format
+PARAMETER4:     decimals - decimal places, clamped to Q16_MAX_DECIMALS
+KEYWORDS:       format, printf, decimal, string
+DESCRIPTION:    Integer only replacement for sprintf("%.*f"). The digits are
+                built backwards in a local buffer then copied out.
+RETURN VALUE:   Characters written excluding the NUL, or 0 if buf is too
+                small (buf is then set to an empty string when len > 0).
+END DESCRIPTION ************************************************************/
+size_t q16_format(char *buf, size_t len, q16_t x, unsigned int decimals)
+{
+    static const uint32_t scale[Q16_MAX_DECIMALS + 1] = { 1, 10, 100, 1000, 10000 };
+    char tmp[16];   // "-32768.0000" plus NUL fits with room to spare
+    char *p = &tmp[sizeof(tmp) - 1];
+    uint32_t mag, ipart, fpart;
+    unsigned int i;
+    size_t n;
+
+    if(decimals > Q16_MAX_DECIMALS)
+        decimals = Q16_MAX_DECIMALS;
+
+    mag = magnitude(x);
+    ipart = mag >> 16;
+    fpart = ((mag & 0xFFFFu) * scale[decimals] + 0x8000u) >> 16;
+    if(fpart >= scale[decimals])
+    {
+        // Rounding carried into the integer part
+        ipart++;
+        fpart -= scale[decimals];
+    }
+
+    *p = '\0';
+    for(i = 0; i < decimals; i++)
+    {
+        *--p = (char) ('0' + fpart % 10);
+        fpart /= 10;
+    }
+    if(decimals > 0)
+        *--p = '.';
+    do
+    {
+        *--p = (char) ('0' + ipart % 10);
+        ipart /= 10;
+    } while(ipart != 0);
+
+    // Don't print "-0.00" for small negative values that round to zero
+    if(x < 0 && strspn(p, "0.") != strlen(p))
+        *--p = '-';
+
+    n = (size_t) (&tmp[sizeof(tmp) - 1] - p);
+    if(n + 1 > len)
+    {
+        if(len > 0)
+            buf[0] = '\0';
+        return 0;
+    }
+
+    memcpy(buf, p, n + 1);
+    return n;
+}
+
+/* End of fixedpoint.c */
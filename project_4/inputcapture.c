@@ -2,9 +2,14 @@
 #include <plib.h>
 #include "inputcapture.h"
 
-float RPS = 0; // global variable for speed
-float RPS_arr[15]; // global array for RPS
-float RPS_Average; // global variable for RPS average
+// Timer 3 count rate (10 MHz / 256 prescale) in Q16.16. RPS = RPS_SCALE / time_diff
+// is then a single 32 bit integer divide instead of soft-float math in the ISR.
+#define RPS_SCALE       2560000000u
+#define RPS_HISTORY     16  // power of 2 so the average is a shift
+
+q16_t RPS = 0; // global variable for speed (Q16.16)
+q16_t RPS_arr[RPS_HISTORY]; // global array for RPS
+q16_t RPS_Average; // global variable for RPS average (Q16.16)
 
 void inputcapture_init()
 {
@@ -34,27 +39,31 @@ void __ISR( _INPUT_CAPTURE_5_VECTOR, ipl3) Capture5(void)
 
     // Compute motor speed in RPS (revolutions per second) and save as global variable3
 
-    RPS = (float)10000000 / ((float)256 * (float)time_diff); // calc RPS
+    if(time_diff != 0)
+    {
+        uint32_t rps = RPS_SCALE / time_diff; // calc RPS
+        RPS = (rps > (uint32_t) Q16_MAX) ? Q16_MAX : (q16_t) rps;
+    }
 
     RPS_arr[i] = RPS;
 
     i++; // i for RPS_arr
 
     // circular buffer
-    if(i > 15)
+    if(i >= RPS_HISTORY)
     {
         i = 0;
     }
 
-    float sum = 0; // make sure to start it at zero
+    int64_t sum = 0; // make sure to start it at zero
     int j;
 
-    for(j=0;j<15;j++)
+    for(j=0;j<RPS_HISTORY;j++)
     {
         sum = sum + RPS_arr[j];
     }
     // update the RPS average
-    RPS_Average = (sum/16);
+    RPS_Average = (q16_t) (sum / RPS_HISTORY);
 
     mIC5ClearIntFlag();  
     // Clears interrupt flag 
@@ -1,2 +1,7 @@
+#include "fixedpoint.h"
+
+extern q16_t RPS; // motor speed in revolutions per second (Q16.16)
+extern q16_t RPS_Average;
+
 void timer3_init();
 void inputcapture_init();
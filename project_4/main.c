@@ -14,6 +14,7 @@
 #include "pwm.h"
 #include "inputcapture.h"
 #include "LCD.h"
+#include "fixedpoint.h"
 
 /* ----- hardware setup ----- */
 static void prvSetupHardware( void );
@@ -57,9 +58,8 @@ int main( void )
 static void IOUnitTask (void *pvParameters)
 {   
     /* ----- IOUnit Task should use the CAN2 Module ----- */
-    //  Motor RPS of 10 floats
-    extern float RPS;
-    float RPS_Array[] = {0,0,0,0,0,0,0,0,0,0};
+    //  Motor RPS of 10 Q16.16 values
+    q16_t RPS_Array[] = {0,0,0,0,0,0,0,0,0,0};
     int i = 0;
     
     // Initial PWM
@@ -73,14 +73,11 @@ static void IOUnitTask (void *pvParameters)
       int data[3];
       IR_READ(data);
       
-      // Convert Temp to Kelvin
-      float Kelvin = (float)((data[1] << 8) | data[0])* 0.02;
-      
-      // Convert Temp to Celsius
-      float Celsius = Kelvin - 273.15;
+      // Convert Temp to Celsius (Q16.16, raw reading is 0.02 K per LSB)
+      q16_t Celsius = q16_mlx90614_to_celsius((uint16_t)((data[1] << 8) | data[0]));
 
       // Convert Temp to Fahrenheit
-      float Fahrenheit = Celsius * (9/5) + 32;
+      q16_t Fahrenheit = q16_celsius_to_fahrenheit(Celsius);
       /* ----- End: IR Sensor Readings ----- */
       
       /* ----- Begin: RPS Readings ----- */
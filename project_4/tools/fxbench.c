@@ -0,0 +1,307 @@
+/** @file fxbench.c
+ *
+ * @brief Cycle count benchmark of the fixed point library against float
+ *
+ * @par
+ * Times the code paths that were moved from float to ../fixedpoint.c, each
+ * in its float form and its fixed point form:
+ *
+ *     rps     Capture5's speed calculation, 10 MHz / (256 * time_diff)
+ *     ir      IOUnitTask's MLX90614 reading to Celsius and Fahrenheit
+ *     adc     the echo server's ADC reading to volts, formatted with 2
+ *             decimals by snprintf("%.2f") or q16_format()
+ *     mul     a single multiply, float and q16_mul()
+ *     div     a single divide, float, q16_div() and q16_div_fast()
+ *
+ * and reports the fewest cycles per operation over a number of runs.
+ *
+ * @par
+ * On the PIC32 every float operation is a call into the XC32 soft-float
+ * library, which is what the comparison is about. Build the file on its own
+ * in an XC32 project (it has its own main) with the optimisation level of the
+ * application; the core timer gives the cycle counts, the report goes to
+ * stdout, i.e. the UART _mon_putc() writes to, and the numbers are also left
+ * in fxbench_results[] for the debugger:
+ *
+ *     xc32-gcc -mprocessor=32MX795F512L -O1 -o fxbench.elf fxbench.c ../fixedpoint.c
+ *
+ * @par
+ * On a Linux host the same code runs with a hardware FPU, so the float
+ * column there is not representative of the PIC32; the host build is for
+ * checking the benchmark itself. On x86 the cycles are time stamp counter
+ * ticks.
+ *
+ *     cc -O1 -Wall -o fxbench fxbench.c ../fixedpoint.c
+ *     ./fxbench
+ *
+ * @author
+ * Carlos Santos
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../fixedpoint.h"
+
+#if defined(__XC32)
+    #include <xc.h>
+    /* The core timer counts every other system clock */
+    #define CYCLES()    ((uint32_t) _CP0_GET_COUNT() * 2u)
+#elif defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+    #define CYCLES()    ((uint32_t) __rdtsc())
+#else
+    #include <time.h>
+    static uint32_t CYCLES(void)
+    {
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint32_t) ts.tv_sec * 1000000000u + (uint32_t) ts.tv_nsec;
+    }
+#endif
+
+#define NOINLINE        __attribute__((noinline))
+
+#define BATCH           64      /* operations per timed run */
+#define RUNS            200     /* timed runs, the fastest one counts */
+
+/* Same constant as inputcapture.c: Timer 3 count rate in Q16.16 */
+#define RPS_SCALE       2560000000u
+
+typedef struct {
+    const char *name;
+    uint32_t float_cycles;      /* per operation, x100 */
+    uint32_t fixed_cycles;
+    uint32_t fast_cycles;       /* q16_div_fast(), div only */
+} fxbench_result;
+
+fxbench_result fxbench_results[5];
+
+static uint16_t time_diff[BATCH], ir_raw[BATCH], adc[BATCH];
+static float fa[BATCH], fb[BATCH];
+static q16_t qa[BATCH], qb[BATCH];
+static volatile int32_t sink;
+
+/* Each kernel runs BATCH operations and returns something that depends on
+ * all of them, so the compiler cannot leave any out. */
+
+static NOINLINE int32_t rps_float(void)
+{
+    float sum = 0;
+    int i;
+
+    for(i = 0; i < BATCH; i++)
+        sum += (float)10000000 / ((float)256 * (float)time_diff[i]);
+    return (int32_t) sum;
+}
+
+static NOINLINE int32_t rps_fixed(void)
+{
+    int32_t sum = 0;
+    int i;
+
+    for(i = 0; i < BATCH; i++)
+    {
+        uint32_t rps = RPS_SCALE / time_diff[i];
+
+        sum += (rps > (uint32_t) Q16_MAX) ? Q16_MAX : (q16_t) rps;
+    }
+    return sum;
+}
+
+static NOINLINE int32_t ir_float(void)
+{
+    float sum = 0;
+    int i;
+
+    for(i = 0; i < BATCH; i++)
+    {
+        /* As IOUnitTask had it, with 1.8 in place of (9/5) */
+        float Kelvin = (float)ir_raw[i] * 0.02;
+        float Celsius = Kelvin - 273.15;
+        float Fahrenheit = Celsius * 1.8 + 32;
+
+        sum += Celsius + Fahrenheit;
+    }
+    return (int32_t) sum;
+}
+
+static NOINLINE int32_t ir_fixed(void)
+{
+    int32_t sum = 0;
+    int i;
+
+    for(i = 0; i < BATCH; i++)
+    {
+        q16_t Celsius = q16_mlx90614_to_celsius(ir_raw[i]);
+        q16_t Fahrenheit = q16_celsius_to_fahrenheit(Celsius);
+
+        sum += Celsius + Fahrenheit;
+    }
+    return sum;
+}
+
+static NOINLINE int32_t adc_float(void)
+{
+    char buf[20];
+    int32_t sum = 0;
+    int i;
+
+    for(i = 0; i < BATCH; i++)
+    {
+        float ADCValue = ((float)adc[i] / 1024) * 3.3;
+
+        sum += snprintf(buf, sizeof(buf), "%.2f", ADCValue) + buf[0];
+    }
+    return sum;
+}
+
+static NOINLINE int32_t adc_fixed(void)
+{
+    char buf[20];
+    int32_t sum = 0;
+    int i;
+
+    for(i = 0; i < BATCH; i++)
+    {
+        q16_t ADCValue = (q16_t) ((adc[i] * Q16_CONST(3.3)) >> 10);
+
+        sum += (int32_t) q16_format(buf, sizeof(buf), ADCValue, 2) + buf[0];
+    }
+    return sum;
+}
+
+static NOINLINE int32_t mul_float(void)
+{
+    float sum = 0;
+    int i;
+
+    for(i = 0; i < BATCH; i++)
+        sum += fa[i] * fb[i];
+    return (int32_t) sum;
+}
+
+static NOINLINE int32_t mul_fixed(void)
+{
+    int32_t sum = 0;
+    int i;
+
+    for(i = 0; i < BATCH; i++)
+        sum += q16_mul(qa[i], qb[i]);
+    return sum;
+}
+
+static NOINLINE int32_t div_float(void)
+{
+    float sum = 0;
+    int i;
+
+    for(i = 0; i < BATCH; i++)
+        sum += fa[i] / fb[i];
+    return (int32_t) sum;
+}
+
+static NOINLINE int32_t div_fixed(void)
+{
+    int32_t sum = 0;
+    int i;
+
+    for(i = 0; i < BATCH; i++)
+        sum += q16_div(qa[i], qb[i]);
+    return sum;
+}
+
+static NOINLINE int32_t div_fast(void)
+{
+    int32_t sum = 0;
+    int i;
+
+    for(i = 0; i < BATCH; i++)
+        sum += q16_div_fast(qa[i], qb[i]);
+    return sum;
+}
+
+/* Cycles per operation, x100, of the fastest of RUNS runs */
+static uint32_t measure(int32_t (*kernel)(void))
+{
+    uint32_t best = UINT32_MAX;
+    int run;
+
+    for(run = 0; run < RUNS; run++)
+    {
+        uint32_t start = CYCLES();
+
+        sink = kernel();
+        start = CYCLES() - start;
+        if(start < best)
+            best = start;
+    }
+    return (uint32_t) (((uint64_t) best * 100u + BATCH / 2) / BATCH);
+}
+
+static void setup(void)
+{
+    uint32_t x = 1;
+    int i;
+
+    for(i = 0; i < BATCH; i++)
+    {
+        /* xorshift32 */
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        time_diff[i] = (uint16_t) (40 + x % 60000u);        /* 0.65 to 1000 RPS */
+        ir_raw[i] = (uint16_t) (13000u + (x >> 8) % 3000u);   /* -13 to 47 C */
+        adc[i] = (uint16_t) ((x >> 16) % 1024u);
+        fa[i] = (float) (int32_t) (x % 2000000u - 1000000) / 1024;   /* +-977 */
+        fb[i] = (float) (int32_t) ((x >> 4) % 200000u + 1) / 1024;   /* up to 195 */
+        qa[i] = (q16_t) (fa[i] * 65536);
+        qb[i] = (q16_t) (fb[i] * 65536);
+    }
+}
+
+static void print_cycles(uint32_t c)
+{
+    if(c == 0)
+        printf("%10s", "-");
+    else
+        printf("%7lu.%02lu", (unsigned long) (c / 100u), (unsigned long) (c % 100u));
+}
+
+int main(void)
+{
+    int i;
+
+    setup();
+
+    fxbench_results[0].name = "rps";
+    fxbench_results[0].float_cycles = measure(rps_float);
+    fxbench_results[0].fixed_cycles = measure(rps_fixed);
+    fxbench_results[1].name = "ir";
+    fxbench_results[1].float_cycles = measure(ir_float);
+    fxbench_results[1].fixed_cycles = measure(ir_fixed);
+    fxbench_results[2].name = "adc";
+    fxbench_results[2].float_cycles = measure(adc_float);
+    fxbench_results[2].fixed_cycles = measure(adc_fixed);
+    fxbench_results[3].name = "mul";
+    fxbench_results[3].float_cycles = measure(mul_float);
+    fxbench_results[3].fixed_cycles = measure(mul_fixed);
+    fxbench_results[4].name = "div";
+    fxbench_results[4].float_cycles = measure(div_float);
+    fxbench_results[4].fixed_cycles = measure(div_fixed);
+    fxbench_results[4].fast_cycles = measure(div_fast);
+
+    printf("cycles per operation\n");
+    printf("kernel         float     fixed  fixed fast\n");
+    for(i = 0; i < 5; i++)
+    {
+        printf("%-6s ", fxbench_results[i].name);
+        print_cycles(fxbench_results[i].float_cycles);
+        print_cycles(fxbench_results[i].fixed_cycles);
+        print_cycles(fxbench_results[i].fast_cycles);
+        printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,222 @@
+/** @file fxtest.c
+ *
+ * @brief Host side accuracy test of the fixed point library
+ *
+ * @par
+ * Checks every function of ../fixedpoint.c against double precision (or
+ * exact 64 bit integer) results: the saturating Q16.16 and Q1.31 add,
+ * subtract and multiply, q16_div() to within 1/2 LSB, q16_div_fast() to the
+ * same result as q16_div() and q16_recip() to within 1 LSB, the Q16.16/Q1.31
+ * conversions, the MLX90614 and Celsius/Fahrenheit conversions, and
+ * q16_format() against printf("%.*f"). Random operands are drawn with
+ * magnitudes spread over the whole 32 bits, together with the limits of the
+ * types.
+ *
+ * @par
+ * Build and run on any Linux host:
+ *
+ *     cc -O2 -Wall -o fxtest fxtest.c ../fixedpoint.c -lm
+ *     ./fxtest -n 1000000
+ *
+ *     -n  random operand pairs per function (default 1000000)
+ *     -s  random seed (default 1)
+ *
+ * @par
+ * The first failures are listed; the exit status is 1 if any check failed.
+ *
+ * @author
+ * Carlos Santos
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../fixedpoint.h"
+
+#define SHOW_FAILURES   10
+
+static uint32_t rng_state;
+static unsigned long checks, failures;
+
+static uint32_t rnd32(void)
+{
+    /* xorshift32 */
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+/* A random operand: one in 16 is a limit or a small value, the others have
+ * a random number of significant bits so small and large magnitudes are
+ * equally likely. */
+static int32_t operand(void)
+{
+    static const int32_t special[] = { 0, 1, -1, Q16_ONE, -Q16_ONE, Q16_MAX, Q16_MIN, Q16_MIN + 1 };
+    uint32_t r = rnd32();
+
+    if((r & 15u) == 0)
+        return special[(r >> 4) % (sizeof(special) / sizeof(special[0]))];
+    return (int32_t) rnd32() >> (rnd32() % 32u);
+}
+
+static double clamp(double v)
+{
+    if(v > 2147483647.0)
+        return 2147483647.0;
+    if(v < -2147483648.0)
+        return -2147483648.0;
+    return v;
+}
+
+/* Counts one check; reports it when the result is off by more than the
+ * tolerance (in LSB) from the exact value. */
+static void check(const char *what, int32_t a, int32_t b, int32_t result, double exact, double tolerance)
+{
+    checks++;
+    if(fabs((double) result - exact) <= tolerance)
+        return;
+    if(failures++ < SHOW_FAILURES)
+        printf("%s(%ld, %ld) = %ld, expected %.3f\n", what, (long) a, (long) b, (long) result, exact);
+}
+
+static void test_arithmetic(unsigned long n)
+{
+    unsigned long i;
+
+    for(i = 0; i < n; i++)
+    {
+        int32_t a = operand(), b = operand();
+
+        check("q16_add", a, b, q16_add(a, b), clamp((double) a + b), 0);
+        check("q16_sub", a, b, q16_sub(a, b), clamp((double) a - b), 0);
+        check("q16_mul", a, b, q16_mul(a, b), clamp((double) a * b / 65536.0), 0.5);
+        check("q31_add", a, b, q31_add(a, b), clamp((double) a + b), 0);
+        check("q31_sub", a, b, q31_sub(a, b), clamp((double) a - b), 0);
+        check("q31_mul", a, b, q31_mul(a, b), clamp((double) a * b / 2147483648.0), 0.5);
+
+        if(b != 0)
+        {
+            check("q16_div", a, b, q16_div(a, b), clamp((double) a / b * 65536.0), 0.5);
+            check("q16_div_fast", a, b, q16_div_fast(a, b), q16_div(a, b), 0);
+            check("q16_recip", b, 0, q16_recip(b), clamp(4294967296.0 / b), 1);
+        }
+        else
+        {
+            check("q16_div", a, b, q16_div(a, b), (a < 0) ? Q16_MIN : Q16_MAX, 0);
+            check("q16_div_fast", a, b, q16_div_fast(a, b), (a < 0) ? Q16_MIN : Q16_MAX, 0);
+        }
+
+        check("q16_to_q31", a, 0, q16_to_q31(a), clamp((double) a * 32768.0), 0);
+        check("q31_to_q16", a, 0, q31_to_q16(a), (double) a / 32768.0, 0.5);
+    }
+    check("q16_recip", 0, 0, q16_recip(0), Q16_MAX, 0);
+}
+
+static void test_temperature(void)
+{
+    uint32_t raw;
+    int32_t c;
+
+    /* Every raw reading: K = raw * 0.02, rounded, less 273.15 rounded */
+    for(raw = 0; raw <= 0xFFFFu; raw++)
+        check("q16_mlx90614_to_celsius", (int32_t) raw, 0, q16_mlx90614_to_celsius((uint16_t) raw),
+              ((double) raw * 0.02 - 273.15) * 65536.0, 1);
+
+    /* The sensor's range, -70 to 380 C, in steps of about 1/256 C */
+    for(c = Q16_FROM_INT(-70); c <= Q16_FROM_INT(380); c += 257)
+    {
+        check("q16_celsius_to_fahrenheit", c, 0, q16_celsius_to_fahrenheit(c),
+              ((double) c / 65536.0 * 1.8 + 32.0) * 65536.0, 1);
+        check("q16_fahrenheit_to_celsius", c, 0, q16_fahrenheit_to_celsius(c),
+              ((double) c / 65536.0 - 32.0) / 1.8 * 65536.0, 1);
+    }
+}
+
+/* printf() rounds exact ties to even and writes "-0.00" for small negative
+ * values; q16_format() rounds ties away from zero and leaves out the sign of
+ * a zero. Returns 1 if the two strings agree apart from that. */
+static int same_format(const char *got, const char *expected, int32_t x, unsigned int decimals)
+{
+    static const uint32_t scale[Q16_MAX_DECIMALS + 1] = { 1, 10, 100, 1000, 10000 };
+    uint32_t mag = (x < 0) ? 0u - (uint32_t) x : (uint32_t) x;
+
+    if(strcmp(got, expected) == 0)
+        return 1;
+    if(expected[0] == '-' && strspn(expected + 1, "0.") == strlen(expected + 1) && strcmp(got, expected + 1) == 0)
+        return 1;
+    return (((mag & 0xFFFFu) * scale[decimals]) & 0xFFFFu) == 0x8000u;
+}
+
+static void test_format(unsigned long n)
+{
+    static const int32_t ipart[] = { 0, 1, -1, 9, -10, 99, 32767, -32768 };
+    char got[24], expected[32];
+    unsigned long i;
+    unsigned int d, k;
+    uint32_t f;
+    int32_t x;
+
+    /* Every fraction with a few integer parts, then random values */
+    for(k = 0; k < sizeof(ipart) / sizeof(ipart[0]) + n / 65536u; k++)
+    {
+        for(f = 0; f <= 0xFFFFu; f++)
+        {
+            x = (k < sizeof(ipart) / sizeof(ipart[0])) ? (int32_t) ((uint32_t) ipart[k] << 16 | f) : (int32_t) rnd32();
+            for(d = 0; d <= Q16_MAX_DECIMALS; d++)
+            {
+                size_t len = q16_format(got, sizeof(got), x, d);
+
+                snprintf(expected, sizeof(expected), "%.*f", (int) d, (double) x / 65536.0);
+                checks++;
+                if(len == strlen(got) && same_format(got, expected, x, d))
+                    continue;
+                if(failures++ < SHOW_FAILURES)
+                    printf("q16_format(%ld, %u) = \"%s\", expected \"%s\"\n", (long) x, d, got, expected);
+            }
+        }
+    }
+
+    /* Too small a buffer gives an empty string */
+    for(i = 0; i <= 12; i++)
+    {
+        size_t len = q16_format(got, i, Q16_MIN, 4);      /* "-32768.0000" */
+
+        checks++;
+        if((i < 12 && (len != 0 || (i > 0 && got[0] != '\0'))) || (i == 12 && len != 11))
+        {
+            if(failures++ < SHOW_FAILURES)
+                printf("q16_format() with a %lu byte buffer returned %lu\n", i, (unsigned long) len);
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long n = 1000000;
+    int i;
+
+    rng_state = 1;
+    for(i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            n = strtoul(argv[++i], NULL, 0);
+        else if(strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+            rng_state = (uint32_t) strtoul(argv[++i], NULL, 0) | 1u;
+        else
+        {
+            fprintf(stderr, "usage: fxtest [-n pairs] [-s seed]\n");
+            return 2;
+        }
+    }
+
+    test_arithmetic(n);
+    test_temperature();
+    test_format(n);
+
+    printf("%lu checks, %lu failures\n", checks, failures);
+    return failures != 0;
+}
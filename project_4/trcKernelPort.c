@@ -350,6 +350,228 @@ void cortex_a9_r5_exit_critical(int cs_type)
 
 #if defined(TRC_CFG_ENABLE_STACK_MONITOR) && (TRC_CFG_ENABLE_STACK_MONITOR == 1) && (TRC_CFG_SCHEDULING_ONLY == 0)
 
+#ifndef TRC_CFG_STACK_MONITOR_INCREMENTAL
+#define TRC_CFG_STACK_MONITOR_INCREMENTAL 0
+#endif
+
+#if (TRC_CFG_STACK_MONITOR_INCREMENTAL == 1)
+
+#ifndef TRC_CFG_STACK_MONITOR_SCAN_WORDS
+#define TRC_CFG_STACK_MONITOR_SCAN_WORDS 64
+#endif
+
+#ifndef TRC_CFG_STACK_MONITOR_MARGIN
+#define TRC_CFG_STACK_MONITOR_MARGIN 32
+#endif
+
+#ifndef TRC_CFG_STACK_MONITOR_ISR_STACK
+#define TRC_CFG_STACK_MONITOR_ISR_STACK 0
+#endif
+
+#if (portSTACK_GROWTH > 0)
+#error "TRC_CFG_STACK_MONITOR_INCREMENTAL only supports stacks growing downwards"
+#endif
+
+#if (TRC_CFG_STACK_MONITOR_ISR_STACK == 1) && (!defined(configCHECK_FOR_STACK_OVERFLOW) || (configCHECK_FOR_STACK_OVERFLOW <= 2))
+#error "TRC_CFG_STACK_MONITOR_ISR_STACK needs configCHECK_FOR_STACK_OVERFLOW 3, which fills the ISR stack"
+#endif
+
+/* The fill patterns of unused stack, tskSTACK_FILL_BYTE in tasks.c and
+portISR_STACK_FILL_BYTE in the PIC32 port.c */
+#define TRC_STACK_FILL_BYTE 0xA5
+#define TRC_ISR_STACK_FILL_BYTE 0xEE
+
+#if (TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_SNAPSHOT)
+/* Every task the recorder can trace */
+#define TRC_STACK_MONITOR_SLOTS (TRC_CFG_NTASK)
+#else
+#define TRC_STACK_MONITOR_SLOTS (TRC_CFG_STACK_MONITOR_MAX_TASKS)
+#endif
+
+/* A stack is scanned from its lowest word up to the lowest word known to be
+used, a limited number of words per TzCtrl pass. A used word found below the
+known one becomes the new high-water mark and the scan starts over from the
+bottom, so the words closest to an overflow are the ones checked most often. */
+typedef struct {
+	void* tcb;				/* NULL for a free slot */
+	StackType_t* base;		/* Lowest word of the stack, NULL until read */
+	StackType_t* next;		/* Next word to check */
+	StackType_t* mark;		/* Lowest word seen in use, NULL until found */
+	uint8_t warned;			/* Set when the margin was crossed */
+} TaskStackMonitorEntry_t;
+
+static TaskStackMonitorEntry_t tasksInStackMonitor[TRC_STACK_MONITOR_SLOTS];
+
+#if (TRC_CFG_STACK_MONITOR_ISR_STACK == 1)
+extern StackType_t xISRStack[];
+static TaskStackMonitorEntry_t isrStackMonitor = { NULL, xISRStack, xISRStack, NULL, 0 };
+#endif
+
+#if (TRC_CFG_INCLUDE_USER_EVENTS == 1)
+static traceString stackChannel = 0;
+#endif
+
+int tasksNotIncluded = 0;
+
+void prvAddTaskToStackMonitor(void* task)
+{
+	int i;
+
+	for (i = 0; i < TRC_STACK_MONITOR_SLOTS; i++)
+	{
+		if (tasksInStackMonitor[i].tcb == NULL)
+		{
+			tasksInStackMonitor[i].base = NULL;
+			tasksInStackMonitor[i].next = NULL;
+			tasksInStackMonitor[i].mark = NULL;
+			tasksInStackMonitor[i].warned = 0;
+			tasksInStackMonitor[i].tcb = task;
+			return;
+		}
+	}
+
+	tasksNotIncluded++;
+}
+
+void prvRemoveTaskFromStackMonitor(void* task)
+{
+	int i;
+
+	for (i = 0; i < TRC_STACK_MONITOR_SLOTS; i++)
+	{
+		if (tasksInStackMonitor[i].tcb == task)
+		{
+			tasksInStackMonitor[i].tcb = NULL;
+		}
+	}
+}
+
+static StackType_t prvStackFillWord(uint8_t fill)
+{
+	StackType_t word = 0;
+	unsigned int i;
+
+	for (i = 0; i < sizeof(StackType_t); i++)
+	{
+		word = (StackType_t)((word << 8) | fill);
+	}
+	return word;
+}
+
+/* Checks at most budget words of the stack. Returns the words checked and
+sets *changed if the high-water mark moved. */
+static uint32_t prvScanStack(TaskStackMonitorEntry_t* entry, StackType_t fill, uint32_t budget, int* changed)
+{
+	uint32_t checked = 0;
+
+	while (checked < budget)
+	{
+		if (entry->mark != NULL && entry->next >= entry->mark)
+		{
+			/* Nothing new below the mark, start over */
+			entry->next = entry->base;
+			break;
+		}
+
+		checked++;
+		if (*entry->next != fill)
+		{
+			entry->mark = entry->next;
+			entry->next = entry->base;
+			*changed = 1;
+			break;
+		}
+		entry->next++;
+	}
+
+	return checked;
+}
+
+#if (TRC_CFG_INCLUDE_USER_EVENTS == 1)
+static void prvReportStackMargin(TaskStackMonitorEntry_t* entry, const char* name, uint32_t unused)
+{
+	if (entry->warned == 0 && unused < (TRC_CFG_STACK_MONITOR_MARGIN))
+	{
+		entry->warned = 1;
+		if (stackChannel == 0)
+		{
+			stackChannel = xTraceRegisterString("Stack");
+		}
+		vTracePrintF(stackChannel, "%s below margin, %d words unused", name, (int32_t)unused);
+	}
+}
+#else
+#define prvReportStackMargin(entry, name, unused)
+#endif
+
+void prvReportStackUsage()
+{
+	static int i = 0;	/* Slot to continue with, TRC_STACK_MONITOR_SLOTS is the ISR stack */
+	uint32_t budget = TRC_CFG_STACK_MONITOR_SCAN_WORDS;
+	uint32_t unused;
+	int n;
+	int changed;
+	TaskStackMonitorEntry_t* entry;
+	TaskStatus_t status;
+
+	/* Keeps deleted tasks' stacks from being freed during the pass */
+	vTaskSuspendAll();
+
+	for (n = 0; n <= TRC_STACK_MONITOR_SLOTS && budget > 0; n++)
+	{
+		changed = 0;
+
+		if (i < TRC_STACK_MONITOR_SLOTS)
+		{
+			entry = &tasksInStackMonitor[i];
+			if (entry->tcb != NULL)
+			{
+				if (entry->base == NULL)
+				{
+					vTaskGetInfo((TaskHandle_t)entry->tcb, &status, pdFALSE, eInvalid);
+					entry->base = entry->next = status.pxStackBase;
+				}
+
+				budget -= prvScanStack(entry, prvStackFillWord(TRC_STACK_FILL_BYTE), budget, &changed);
+
+				if (changed)
+				{
+					unused = (uint32_t)(entry->mark - entry->base);
+#if TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_SNAPSHOT
+					prvTraceStoreKernelCallWithParam(TRACE_UNUSED_STACK, TRACE_CLASS_TASK, TRACE_GET_TASK_NUMBER(entry->tcb), unused);
+#else /* TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_SNAPSHOT */
+					prvTraceStoreEvent2(PSF_EVENT_UNUSED_STACK, (uint32_t)entry->tcb, unused);
+#endif /* TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_SNAPSHOT */
+					prvReportStackMargin(entry, pcTaskGetName((TaskHandle_t)entry->tcb), unused);
+				}
+			}
+		}
+#if (TRC_CFG_STACK_MONITOR_ISR_STACK == 1)
+		else
+		{
+			entry = &isrStackMonitor;
+			budget -= prvScanStack(entry, prvStackFillWord(TRC_ISR_STACK_FILL_BYTE), budget, &changed);
+
+			if (changed)
+			{
+				unused = (uint32_t)(entry->mark - entry->base);
+				prvReportStackMargin(entry, "ISR stack", unused);
+			}
+		}
+#endif /* (TRC_CFG_STACK_MONITOR_ISR_STACK == 1) */
+
+		/* Stay on a stack that used up the budget, its scan goes on next time */
+		if (budget > 0)
+		{
+			i = (i + 1) % (TRC_STACK_MONITOR_SLOTS + 1);
+		}
+	}
+
+	(void)xTaskResumeAll();
+}
+
+#else /* (TRC_CFG_STACK_MONITOR_INCREMENTAL == 1) */
+
 typedef struct {
 	void* tcb;
 	uint32_t uiPreviousLowMark;
@@ -426,6 +648,8 @@ void prvReportStackUsage()
 		i = (i + 1) % TRC_CFG_STACK_MONITOR_MAX_TASKS; // Move i beyond this task
 	} while (count < TRC_CFG_STACK_MONITOR_MAX_REPORTS && i != initial);
 }
+
+#endif /* (TRC_CFG_STACK_MONITOR_INCREMENTAL == 1) */
 #endif /* defined(TRC_CFG_ENABLE_STACK_MONITOR) && (TRC_CFG_ENABLE_STACK_MONITOR == 1) && (TRC_CFG_SCHEDULING_ONLY == 0) */
 
 #if (TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING)
@@ -0,0 +1,309 @@
+/*******************************************************************************
+ * Trace Recorder Library for Tracealyzer v4.3.11
+ *
+ * trcSnapshotCompact.h
+ *
+ * Compact event encoding for the snapshot recorder, used instead of the fixed
+ * 4 byte records when TRC_CFG_COMPACT_EVENT_ENCODING is 1.
+ *
+ * The fixed records hold an 8 or 16 bit timestamp difference (DTS) and need an
+ * extra XTS record whenever more time than that has passed since the previous
+ * event. With a 1.25 MHz timestamp and a 1 ms tick this is the case for most
+ * tick events and for every event after an idle period. The compact encoding
+ * instead stores:
+ *
+ *  - the DTS as a variable length integer (7 bits per byte, low bits first),
+ *    so it never needs an extra record,
+ *  - the handle of task switch, ready and kernel call events in the low four
+ *    bits of the DTS varint when it is below 15,
+ *  - tick events (DIV_NEW_TIME) as the difference to the time predicted from
+ *    the previous tick period, and consecutive ticks that arrive exactly on
+ *    the prediction as a single run record with a count.
+ *
+ * Records are variable length, so the event buffer is divided into blocks of
+ * TRC_CFG_COMPACT_BLOCK_SIZE bytes. A record never crosses a block boundary
+ * (the rest of the block is left zero) and the prediction state starts over
+ * in every block, so after the ring buffer has wrapped the decoder starts at
+ * the oldest complete block. RecorderDataType.nextFreeIndex is a byte offset
+ * in this mode, and minor_version is TRC_COMPACT_MINOR_VERSION_FLAG plus the
+ * block size in units of 8 bytes, which also keeps Tracealyzer from reading
+ * the buffer as fixed size records. Use tools/trcdecode.c to read the trace.
+ *
+ * Record formats, by the first byte:
+ *
+ *   0x00                 Padding, the rest of the block is unused
+ *   0xFF count           <count> ticks, each one tick later and exactly one
+ *                        tick period after the previous
+ *   0xFE res             One tick later, <res> (zigzag varint) ticks of
+ *                        timestamp from the predicted time
+ *   0xFD r0 r1 r2 r3     Fixed record without a timestamp (XPS, XID, object
+ *                        close and memory address records)
+ *   0xFC dts r0 r1 r2 r3 Fixed record with a timestamp but no compact form;
+ *                        its own DTS field is not used
+ *   0xFB n dts fmt args  User event, 16 bit format string symbol in target
+ *                        byte order and n argument slots of 4 bytes
+ *   0xFA type dts param  Record with an 8 bit DTS and a 16 bit parameter
+ *                        (delays, heap allocation sizes), full parameter
+ *                        as varint
+ *   0x03 dts tick        Tick (DIV_NEW_TIME), full tick count as varint
+ *   other: type v [h]    Record with a 16 bit DTS and an 8 bit handle, i.e.
+ *                        task switch, ready, low power and kernel call
+ *                        records. v is the varint of DTS * 16 + handle, or of
+ *                        DTS * 16 + 15 followed by the handle byte if the
+ *                        handle is 15 or more.
+ *
+ * The functions below are static so that tools/trcbench.c can build and time
+ * exactly the code the target runs.
+ *
+ * Tabs are used for indent in this file (1 tab = 4 spaces)
+ ******************************************************************************/
+
+#ifndef TRC_SNAPSHOT_COMPACT_H
+#define TRC_SNAPSHOT_COMPACT_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define TRC_COMPACT_PAD				0x00
+#define TRC_COMPACT_TICK_RUN		0xFF
+#define TRC_COMPACT_TICK			0xFE
+#define TRC_COMPACT_RAW				0xFD
+#define TRC_COMPACT_RAW_DTS			0xFC
+#define TRC_COMPACT_USER			0xFB
+#define TRC_COMPACT_PARAM			0xFA
+#define TRC_COMPACT_NEW_TIME		0x03	/* DIV_NEW_TIME */
+#define TRC_COMPACT_USER_EVENT		0x98	/* USER_EVENT, + number of argument slots */
+#define TRC_COMPACT_SMALL_HANDLES	15
+
+#define TRC_COMPACT_MINOR_VERSION_FLAG	0x80
+
+/* Largest user event: 8 argument slots (MAX_ARG_SIZE in trcSnapshotRecorder.c) */
+#define TRC_COMPACT_MAX_ARG_SLOTS	8
+#define TRC_COMPACT_MAX_RECORD		(1 + 1 + 5 + 2 + 4 * TRC_COMPACT_MAX_ARG_SLOTS)
+
+/* Prediction state, reset at the start of every block */
+typedef struct
+{
+	uint32_t time;			/* Sum of the DTS of all records in the block */
+	uint32_t tick;			/* Tick count of the last tick in the block */
+	uint32_t tickTime;		/* Time of that tick */
+	uint32_t tickPeriod;	/* Time between the last two ticks, 0 if unknown */
+	uint8_t* runCount;		/* Count byte of the last record if it is a tick run */
+	uint8_t hasTick;
+} TraceCompactState;
+
+/* The event buffer as a sequence of blocks */
+typedef struct
+{
+	uint8_t* data;
+	uint32_t size;			/* A multiple of blockSize */
+	uint32_t blockSize;
+	uint32_t next;			/* Byte offset of the next record */
+	uint32_t blockEnd;		/* End of the block holding next, 0 before the first record */
+	uint8_t wrapped;
+	uint8_t stopWhenFull;
+	uint8_t full;			/* Set instead of wrapping when stopWhenFull */
+	TraceCompactState state;
+} TraceCompactRing;
+
+/* Where a fixed size record keeps its DTS, i.e. what can be left out */
+#define TRC_COMPACT_LAYOUT_NONE		0	/* No DTS */
+#define TRC_COMPACT_LAYOUT_HANDLE	1	/* type, handle, 16 bit DTS */
+#define TRC_COMPACT_LAYOUT_PARAM	2	/* type, 8 bit DTS, 16 bit parameter */
+#define TRC_COMPACT_LAYOUT_OTHER	3	/* Any other record with a DTS */
+
+/* One event as handed to prvTraceCompactWrite */
+typedef struct
+{
+	const uint8_t* record;	/* The fixed size record, as the writer filled it in */
+	const uint8_t* args;	/* Argument slots of a user event */
+	uint32_t dts;			/* Full DTS, unless layout is TRC_COMPACT_LAYOUT_NONE */
+	uint32_t param;			/* Full parameter, for TRC_COMPACT_LAYOUT_PARAM */
+	uint8_t layout;
+	uint8_t argSlots;
+} TraceCompactEvent;
+
+static uint32_t prvTraceCompactVarint(uint8_t* dst, uint32_t value)
+{
+	uint32_t n = 0;
+
+	while (value > 0x7F)
+	{
+		dst[n++] = (uint8_t)(value | 0x80);
+		value >>= 7;
+	}
+	dst[n++] = (uint8_t)value;
+	return n;
+}
+
+/*******************************************************************************
+ * prvTraceCompactEncode
+ *
+ * Encodes one event at dst, using and updating the prediction state. Returns
+ * the number of bytes written, which is 0 if a tick run was extended in place.
+ * dst must have room for TRC_COMPACT_MAX_RECORD bytes.
+ ******************************************************************************/
+static uint32_t prvTraceCompactEncode(TraceCompactState* s, uint8_t* dst, const TraceCompactEvent* e)
+{
+	const uint8_t* r = e->record;
+	uint32_t n = 1;
+	uint32_t now = s->time + e->dts;
+
+	if (e->layout == TRC_COMPACT_LAYOUT_NONE)
+	{
+		dst[0] = TRC_COMPACT_RAW;
+		(void)memcpy(&dst[1], r, 4);
+		s->runCount = NULL;
+		return 5;
+	}
+
+	if (r[0] == TRC_COMPACT_NEW_TIME)
+	{
+		if (s->hasTick && e->param == s->tick + 1)
+		{
+			int32_t residual = (int32_t)(now - s->tickTime - s->tickPeriod);
+			uint32_t zz = ((uint32_t)residual << 1) ^ (uint32_t)(residual >> 31);
+
+			s->tickPeriod = now - s->tickTime;
+			if (zz == 0 && s->runCount != NULL && *s->runCount < 0xFF)
+			{
+				(*s->runCount)++;
+				n = 0;
+			}
+			else if (zz == 0)
+			{
+				dst[0] = TRC_COMPACT_TICK_RUN;
+				dst[1] = 1;
+				s->runCount = &dst[1];
+				n = 2;
+			}
+			else
+			{
+				dst[0] = TRC_COMPACT_TICK;
+				n += prvTraceCompactVarint(&dst[1], zz);
+				s->runCount = NULL;
+			}
+		}
+		else
+		{
+			dst[0] = TRC_COMPACT_NEW_TIME;
+			n += prvTraceCompactVarint(&dst[1], e->dts);
+			n += prvTraceCompactVarint(&dst[n], e->param);
+			s->tickPeriod = 0;
+			s->runCount = NULL;
+		}
+		s->hasTick = 1;
+		s->tick = e->param;
+		s->tickTime = now;
+		s->time = now;
+		return n;
+	}
+
+	s->runCount = NULL;
+	s->time = now;
+
+	if (r[0] >= TRC_COMPACT_USER_EVENT && r[0] < TRC_COMPACT_USER_EVENT + 16)
+	{
+		dst[0] = TRC_COMPACT_USER;
+		dst[1] = e->argSlots;
+		n = 2 + prvTraceCompactVarint(&dst[2], e->dts);
+		dst[n] = r[2];
+		dst[n + 1] = r[3];
+		(void)memcpy(&dst[n + 2], e->args, 4 * (uint32_t)e->argSlots);
+		return n + 2 + 4 * (uint32_t)e->argSlots;
+	}
+
+	if (e->layout == TRC_COMPACT_LAYOUT_PARAM)
+	{
+		dst[0] = TRC_COMPACT_PARAM;
+		dst[1] = r[0];
+		n = 2 + prvTraceCompactVarint(&dst[2], e->dts);
+		return n + prvTraceCompactVarint(&dst[n], e->param);
+	}
+
+	if (e->layout == TRC_COMPACT_LAYOUT_HANDLE && r[0] < TRC_COMPACT_PARAM)
+	{
+		uint8_t h = r[1];
+
+		dst[0] = r[0];
+		if (h < TRC_COMPACT_SMALL_HANDLES)
+			return 1 + prvTraceCompactVarint(&dst[1], (e->dts << 4) | h);
+
+		/* The varint of dts * 16 + 15, written in two parts so that a 32 bit
+		DTS does not overflow */
+		dst[1] = (uint8_t)(((e->dts & 0x7) << 4) | TRC_COMPACT_SMALL_HANDLES);
+		if ((e->dts >> 3) != 0)
+		{
+			dst[1] |= 0x80;
+			n += prvTraceCompactVarint(&dst[2], e->dts >> 3);
+		}
+		dst[n + 1] = h;
+		return n + 2;
+	}
+
+	dst[0] = TRC_COMPACT_RAW_DTS;
+	n += prvTraceCompactVarint(&dst[1], e->dts);
+	(void)memcpy(&dst[n], r, 4);
+	return n + 4;
+}
+
+/*******************************************************************************
+ * prvTraceCompactWrite
+ *
+ * Stores one event in the ring, starting a new block when it does not fit in
+ * the current one. Returns 0, or -1 if the ring is full and stopWhenFull is
+ * set, in which case nothing is written.
+ ******************************************************************************/
+static int32_t prvTraceCompactWrite(TraceCompactRing* ring, const TraceCompactEvent* e)
+{
+	uint8_t tmp[TRC_COMPACT_MAX_RECORD];
+	TraceCompactState saved;
+	uint32_t n;
+
+	if (ring->blockEnd != 0)
+	{
+		if (ring->blockEnd - ring->next >= TRC_COMPACT_MAX_RECORD)
+		{
+			ring->next += prvTraceCompactEncode(&ring->state, &ring->data[ring->next], e);
+			return 0;
+		}
+
+		/* Near the end of the block - encode aside and see if it fits */
+		saved = ring->state;
+		n = prvTraceCompactEncode(&ring->state, tmp, e);
+		if (n <= ring->blockEnd - ring->next)
+		{
+			if (ring->state.runCount == &tmp[1])
+				ring->state.runCount = &ring->data[ring->next + 1];
+			(void)memcpy(&ring->data[ring->next], tmp, n);
+			ring->next += n;
+			return 0;
+		}
+		ring->state = saved;
+
+		if (ring->blockEnd >= ring->size)
+		{
+			if (ring->stopWhenFull)
+			{
+				ring->full = 1;
+				return -1;
+			}
+			ring->wrapped = 1;
+			ring->next = 0;
+		}
+		else
+		{
+			ring->next = ring->blockEnd;
+		}
+	}
+
+	/* Start a new block: clear it, so that the decoder finds the end of the
+	data, and reset the prediction state */
+	ring->blockEnd = ring->next + ring->blockSize;
+	(void)memset(&ring->data[ring->next], 0, ring->blockSize);
+	(void)memset(&ring->state, 0, sizeof(ring->state));
+	ring->next += prvTraceCompactEncode(&ring->state, &ring->data[ring->next], e);
+	return 0;
+}
+
+#endif /* TRC_SNAPSHOT_COMPACT_H */
@@ -0,0 +1,66 @@
+/*******************************************************************************
+ * Trace Recorder Library for Tracealyzer v4.3.11
+ *
+ * trcSnapshotContext.h
+ *
+ * Per-context event buffers for the snapshot recorder, used when
+ * TRC_CFG_CONTEXT_BUFFERS is 1.
+ *
+ * Normally every task switch, ready event, kernel call and ISR begin/end is
+ * encoded into the event buffer inside the recorder's critical section, with
+ * interrupts masked for the whole call. With context buffers these calls only
+ * append a small entry (a timestamp and the call's arguments) to a buffer of
+ * their own context level - one for tasks and one per ISR nesting level - and
+ * return. No interrupts are masked: an ISR never writes the buffer of the code
+ * it interrupted, and tasks at the same level reserve entries with an atomic
+ * compare-and-swap.
+ *
+ * The entries are merged by timestamp and run through the normal recorder
+ * code later, one entry per (short) critical section, by
+ * vTraceFlushContextBuffers(), which is meant to be called from the idle hook.
+ * vTraceStop() and any event that is still stored directly (user events, heap
+ * events, object close events) flush the buffers first, so the event buffer
+ * keeps the original order. Before reading a snapshot with the debugger while
+ * the recorder is running, call vTraceFlushContextBuffers() or let the idle
+ * task run.
+ *
+ * vTraceGetContextBufferStats() reports the recorder overhead in both forms:
+ * the time per event spent capturing, at the traced code, and the time per
+ * event spent replaying, which is what the event used to cost there with
+ * interrupts masked.
+ *
+ * Tabs are used for indent in this file (1 tab = 4 spaces)
+ ******************************************************************************/
+
+#ifndef TRC_SNAPSHOT_CONTEXT_H
+#define TRC_SNAPSHOT_CONTEXT_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Statistics returned by vTraceGetContextBufferStats(). Times are in
+TRC_HWTC_COUNT counts (TRC_HWTC_FREQ_HZ). */
+typedef struct
+{
+	uint32_t eventsCaptured;	/* Entries captured and stored in the event buffer since */
+	uint32_t eventsDropped;		/* Entries lost because their buffer was full */
+	uint32_t maxPending;		/* Highest number of entries waiting in one buffer */
+	uint32_t captureCounts;		/* Time spent capturing eventsCaptured, interrupts enabled */
+	uint32_t replayCounts;		/* Time spent replaying eventsCaptured, interrupts masked */
+	uint32_t maxReplayCounts;	/* Longest replay of one entry */
+} TraceContextBufferStats;
+
+/* Stores everything captured so far in the event buffer. Masks interrupts for
+one entry at a time. */
+void vTraceFlushContextBuffers(void);
+
+void vTraceGetContextBufferStats(TraceContextBufferStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRC_SNAPSHOT_CONTEXT_H */
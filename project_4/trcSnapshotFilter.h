@@ -0,0 +1,59 @@
+/*******************************************************************************
+ * Trace Recorder Library for Tracealyzer v4.3.11
+ *
+ * trcSnapshotFilter.h
+ *
+ * Run-time object filter for the snapshot recorder, used when
+ * TRC_CFG_OBJECT_FILTER is 1.
+ *
+ * The recorder keeps one bit per object handle of every class (tasks, ISRs,
+ * queues, semaphores, mutexes, ...). The store functions check it before
+ * doing anything else, so an excluded object costs a table lookup per event
+ * and no buffer space. For an excluded
+ *  task     - task switches to it, its ready events, and the kernel calls,
+ *             delays and user events made while it runs are not stored. Its
+ *             execution time shows as the task that ran before it.
+ *  ISR      - vTraceStoreISRBegin/End and the kernel calls and user events
+ *             made inside it are not stored.
+ *  other    - kernel calls on the object are not stored.
+ * Object creation, names and close events are always stored, so the trace
+ * keeps the names of excluded objects.
+ *
+ * To keep only the events of one queue and the task using it:
+ *
+ *	 vTraceSetAllObjectsExcluded(1);
+ *	 vTraceSetObjectExcluded(TRACE_CLASS_QUEUE, prvTraceGetQueueNumberLow16(xQueue), 0);
+ *	 vTraceSetObjectExcluded(TRACE_CLASS_TASK, prvTraceGetTaskNumberLow16(xTask), 0);
+ *
+ * The filter can be changed at any time, e.g. from a command handler or with
+ * the debugger, and is kept by vTraceClear.
+ *
+ * Tabs are used for indent in this file (1 tab = 4 spaces)
+ ******************************************************************************/
+
+#ifndef TRC_SNAPSHOT_FILTER_H
+#define TRC_SNAPSHOT_FILTER_H
+
+#include <stdint.h>
+#include "trcRecorder.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* As the handle, to set every object of the class */
+#define TRC_FILTER_ALL_OBJECTS 0
+
+/* Excludes (1) or includes (0) the events of an object */
+void vTraceSetObjectExcluded(traceObjectClass objectClass, traceHandle handle, uint8_t excluded);
+
+/* Excludes (1) or includes (0) the events of every object */
+void vTraceSetAllObjectsExcluded(uint8_t excluded);
+
+uint8_t xTraceIsObjectExcluded(traceObjectClass objectClass, traceHandle handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRC_SNAPSHOT_FILTER_H */
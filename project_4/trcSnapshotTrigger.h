@@ -0,0 +1,101 @@
+/*******************************************************************************
+ * Trace Recorder Library for Tracealyzer v4.3.11
+ *
+ * trcSnapshotTrigger.h
+ *
+ * Triggered capture for the snapshot recorder, used when
+ * TRC_CFG_TRIGGERED_CAPTURE is 1.
+ *
+ * In ring buffer mode the event of interest is usually overwritten by the
+ * time vTraceStop is called. A trigger is a condition the recorder checks as
+ * it stores the events:
+ *
+ *  xTraceTriggerOnEvent        a kernel event code, on one object or any
+ *  xTraceTriggerOnUserEvent    any user event on a channel
+ *  xTraceTriggerOnLatency      a latency pair sample longer than a threshold
+ *                              (needs TRC_CFG_LATENCY_HISTOGRAMS)
+ *  xTraceTriggerOnStackLow     a stack monitor report (TRACE_UNUSED_STACK)
+ *                              with less unused stack than a threshold, in
+ *                              the units of uxTaskGetStackHighWaterMark
+ *  vTraceTrigger               the application, e.g. from an assert handler
+ *
+ * When a trigger fires the recorder goes on for TRC_CFG_TRIGGER_POST_RECORDS
+ * more records and then freezes what it has: the last
+ * TRC_CFG_TRIGGER_CAPTURE_SIZE records are copied to one of
+ * TRC_CFG_TRIGGER_CAPTURES capture slots and recording goes on, waiting for
+ * the next trigger. When the slots are used up, the next trigger stops the
+ * recorder instead, freezing the event buffer itself with
+ * TRC_CFG_TRIGGER_POST_RECORDS records after the trigger. Triggers that fire
+ * while the recorder is waiting for the post-trigger records are ignored.
+ *
+ * To read a capture, stop the recorder (or wait for the last trigger), save
+ * the live snapshot first if needed and call xTraceLoadCapture(n). It
+ * replaces the event buffer with capture n, so the next RAM dump opens in
+ * Tracealyzer or tools/trcdecode as usual, with the time the capture was
+ * taken. The object and symbol tables are the live ones;
+ * names of objects deleted and reused after the capture may be wrong.
+ *
+ * Example, keeping the trace around the first three times the button ISR is
+ * more than 200 us late in waking its task:
+ *
+ *	 lat = xTraceLatencyPair("BTN1 to LEDC", ...);
+ *	 xTraceTriggerOnLatency(lat, 200 * (TRC_HWTC_FREQ_HZ / TRC_HWTC_DIVISOR) / 1000000);
+ *
+ * Cannot be combined with TRC_CFG_COMPACT_EVENT_ENCODING.
+ *
+ * Tabs are used for indent in this file (1 tab = 4 spaces)
+ ******************************************************************************/
+
+#ifndef TRC_SNAPSHOT_TRIGGER_H
+#define TRC_SNAPSHOT_TRIGGER_H
+
+#include <stdint.h>
+#include "trcRecorder.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TRC_TRIGGER_ANY_OBJECT 0
+
+/* Returned by the xTraceTriggerOnXxx functions, 0 if there was no free
+trigger */
+typedef uint8_t traceTrigger;
+
+/* Fires on kernel events with the event code, e.g. QUEUE_SEND_TRCFAILED +
+TRACE_CLASS_QUEUE (trcKernelPort.h), on the object with the handle or, with
+TRC_TRIGGER_ANY_OBJECT, on any object */
+traceTrigger xTraceTriggerOnEvent(uint8_t eventCode, traceHandle objectHandle);
+
+/* Fires on vTracePrint and vTracePrintF events on the channel */
+traceTrigger xTraceTriggerOnUserEvent(traceString channel);
+
+/* Fires when the latency pair (trcSnapshotLatency.h) measures more than
+threshold timestamp units */
+traceTrigger xTraceTriggerOnLatency(uint8_t pair, uint32_t threshold);
+
+/* Fires when the stack monitor reports less than minUnused unused stack for
+the task (prvTraceGetTaskNumberLow16) or any task */
+traceTrigger xTraceTriggerOnStackLow(traceHandle task, uint32_t minUnused);
+
+/* Removes all triggers. Captures already stored are kept. */
+void vTraceClearTriggers(void);
+
+/* Fires a trigger from the application */
+void vTraceTrigger(void);
+
+/* Number of captures stored */
+uint8_t xTraceGetCaptureCount(void);
+
+/* The trigger that caused capture n, 0 for vTraceTrigger */
+traceTrigger xTraceGetCaptureTrigger(uint8_t n);
+
+/* Replaces the event buffer with capture n (0 = oldest). The recorder must be
+stopped. Returns 1 if done. */
+int xTraceLoadCapture(uint8_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRC_SNAPSHOT_TRIGGER_H */
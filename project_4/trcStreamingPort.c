@@ -0,0 +1,382 @@
+/*******************************************************************************
+ * Trace Recorder Library for Tracealyzer v4.3.11
+ *
+ * trcStreamingPort.c
+ *
+ * Stream port for hosted (POSIX) builds - file, named pipe or Unix domain
+ * socket output through a writer thread. See trcStreamingPort.h.
+ *
+ * Tabs are used for indent in this file (1 tab = 4 spaces)
+ ******************************************************************************/
+
+#include "trcRecorder.h"
+
+#if (TRC_USE_TRACEALYZER_RECORDER == 1)
+#if (TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#if ((TRC_CFG_STREAM_PORT_BATCH_SIZE) < (TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE))
+#error "TRC_CFG_STREAM_PORT_BATCH_SIZE must be at least TRC_CFG_PAGED_EVENT_BUFFER_PAGE_SIZE"
+#endif
+
+#define NO_BATCH (-1)
+
+extern uint32_t DroppedEventCounter;
+
+/* Two batch buffers: TzCtrl appends pages to batch[filling] while the writer
+thread writes batch[writing] out. All fields are protected by lock. */
+static char batch[2][TRC_CFG_STREAM_PORT_BATCH_SIZE];
+static uint32_t batchUsed[2];
+static int filling = 0;
+static int writing = NO_BATCH;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t batchReady = PTHREAD_COND_INITIALIZER;	/* signalled to the writer */
+static pthread_cond_t batchDone = PTHREAD_COND_INITIALIZER;		/* signalled by the writer */
+static pthread_t writerThread;
+static int writerRunning = 0;
+static int writerExit = 0;
+
+static int fd = -1;
+static int isSocket = 0;
+static int isRegularFile = 0;
+
+static TraceStreamPortStats stats;
+
+static uint64_t prvMonotonicMicroseconds(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+uint32_t uiTraceStreamPortHostTimestamp(void)
+{
+	return (uint32_t)prvMonotonicMicroseconds();
+}
+
+/* Writes all of data, retrying on short writes and signals. The kernel's
+tick and context switch signals are blocked in the writer thread, but a
+debugger or the application may still interrupt it. */
+static int prvWriteAll(const char* data, uint32_t size, uint32_t* calls)
+{
+	while (size > 0)
+	{
+		ssize_t n;
+
+		if (isSocket)
+			n = send(fd, data, size, MSG_NOSIGNAL);
+		else
+			n = write(fd, data, size);
+
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return errno;
+		}
+
+		(*calls)++;
+		data += n;
+		size -= (uint32_t)n;
+	}
+	return 0;
+}
+
+/* Hands the filling batch to the writer. Called with lock held, and only when
+the writer is idle. */
+static void prvSubmitBatch(void)
+{
+	writing = filling;
+	filling = !filling;
+	batchUsed[filling] = 0;
+	pthread_cond_signal(&batchReady);
+}
+
+static void* prvWriterThread(void* arg)
+{
+	(void)arg;
+
+	pthread_mutex_lock(&lock);
+	for (;;)
+	{
+		uint32_t calls = 0;
+		int err;
+
+		while (writing == NO_BATCH && !writerExit)
+			pthread_cond_wait(&batchReady, &lock);
+
+		if (writing == NO_BATCH)
+			break;
+
+		/* The batch being written is not touched by TzCtrl, so the lock can
+		be released for the duration of the system call. */
+		pthread_mutex_unlock(&lock);
+		err = (stats.lastError == 0) ? prvWriteAll(batch[writing], batchUsed[writing], &calls) : stats.lastError;
+		pthread_mutex_lock(&lock);
+
+		stats.writeCalls += calls;
+		if (err == 0)
+			stats.bytesWritten += batchUsed[writing];
+		else if (stats.lastError == 0)
+			stats.lastError = err;
+
+		batchUsed[writing] = 0;
+		writing = NO_BATCH;
+
+		/* Keep the output flowing at low load: pass on whatever has
+		collected in the meantime instead of waiting for a full batch. */
+		if (batchUsed[filling] > 0)
+			prvSubmitBatch();
+
+		pthread_cond_broadcast(&batchDone);
+	}
+	pthread_mutex_unlock(&lock);
+	return NULL;
+}
+
+/* Opens the destination given by TRC_STREAM or TRC_CFG_STREAM_PORT_DESTINATION */
+static int prvOpenDestination(void)
+{
+	const char* dest = getenv("TRC_STREAM");
+	struct stat st;
+
+	if (dest == NULL || dest[0] == '\0')
+		dest = TRC_CFG_STREAM_PORT_DESTINATION;
+
+	if (strcmp(dest, "-") == 0)
+	{
+		fd = STDOUT_FILENO;
+	}
+	else if (strncmp(dest, "unix:", 5) == 0)
+	{
+		struct sockaddr_un addr;
+
+		fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd < 0)
+			return -1;
+
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		strncpy(addr.sun_path, dest + 5, sizeof(addr.sun_path) - 1);
+		if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+		{
+			close(fd);
+			fd = -1;
+			return -1;
+		}
+		isSocket = 1;
+	}
+	else
+	{
+		/* Opening a named pipe blocks until a reader has opened it */
+		fd = open(dest, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0)
+			return -1;
+	}
+
+	isRegularFile = (fstat(fd, &st) == 0) && S_ISREG(st.st_mode);
+	return 0;
+}
+
+int32_t prvTraceStreamPortInit(void)
+{
+	sigset_t all, old;
+	int err;
+
+	if (writerRunning)
+		return 0;
+
+	if (prvOpenDestination() != 0)
+	{
+		stats.lastError = errno;
+		return -1;
+	}
+
+	/* The writer thread must never run the kernel's signal handlers, so it
+	starts with every signal blocked (the mask is inherited). */
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &old);
+	err = pthread_create(&writerThread, NULL, prvWriterThread, NULL);
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+	if (err != 0)
+	{
+		stats.lastError = err;
+		return -1;
+	}
+	writerRunning = 1;
+	return 0;
+}
+
+/* Only a socket can carry commands from Tracealyzer; for files and pipes
+there is never anything to read, which the recorder treats as "no command". */
+int32_t prvTraceStreamPortRead(void* ptrData, uint32_t size, int32_t* ptrBytesRead)
+{
+	ssize_t n;
+
+	*ptrBytesRead = 0;
+	if (!isSocket)
+		return 0;
+
+	n = recv(fd, ptrData, size, MSG_DONTWAIT);
+	if (n < 0)
+		return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+	if (n == 0)
+		return -1;	/* Host closed the connection */
+
+	*ptrBytesRead = (int32_t)n;
+	return 0;
+}
+
+/*******************************************************************************
+ * prvTraceStreamPortWrite
+ *
+ * Called by TzCtrl (through prvPagedEventBufferTransfer) with one page of the
+ * recorder's buffer. The page is copied into the filling batch, so the
+ * recorder can reuse it at once; the batch goes to the writer thread as soon
+ * as the writer is idle. Only when the writer is busy and the batch is full
+ * does this wait or drop, depending on TRC_CFG_STREAM_PORT_BLOCK_WHEN_FULL.
+ *
+ * Returns 0, or -1 after a write error so the recorder stops tracing.
+ ******************************************************************************/
+int32_t prvTraceStreamPortWrite(void* ptrData, uint32_t size, int32_t* ptrBytesWritten)
+{
+	*ptrBytesWritten = 0;
+
+	if (size > (TRC_CFG_STREAM_PORT_BATCH_SIZE))
+		size = (TRC_CFG_STREAM_PORT_BATCH_SIZE);	/* Cannot happen with a valid configuration */
+
+	pthread_mutex_lock(&lock);
+
+	if (stats.lastError != 0 || !writerRunning)
+	{
+		pthread_mutex_unlock(&lock);
+		return -1;
+	}
+
+	if (batchUsed[filling] + size > (TRC_CFG_STREAM_PORT_BATCH_SIZE))
+	{
+#if (TRC_CFG_STREAM_PORT_BLOCK_WHEN_FULL == 1)
+		uint64_t start = prvMonotonicMicroseconds();
+		uint64_t waited;
+
+		/* The writer is busy with the other batch (it is handed any
+		non-empty batch as soon as it is idle), and picks up this one when
+		done. Wait for that. */
+		stats.stalls++;
+		while (batchUsed[filling] + size > (TRC_CFG_STREAM_PORT_BATCH_SIZE) && stats.lastError == 0)
+			pthread_cond_wait(&batchDone, &lock);
+
+		waited = prvMonotonicMicroseconds() - start;
+		if (waited > stats.maxStallMicroseconds)
+			stats.maxStallMicroseconds = (uint32_t)waited;
+
+		if (stats.lastError != 0)
+		{
+			pthread_mutex_unlock(&lock);
+			return -1;
+		}
+#else
+		/* Report the page as written so that the recorder frees it */
+		stats.pagesDropped++;
+		stats.bytesDropped += size;
+		*ptrBytesWritten = (int32_t)size;
+		pthread_mutex_unlock(&lock);
+		return 0;
+#endif
+	}
+
+	memcpy(&batch[filling][batchUsed[filling]], ptrData, size);
+	batchUsed[filling] += size;
+	stats.pagesQueued++;
+
+	if (writing == NO_BATCH)
+		prvSubmitBatch();
+
+	pthread_mutex_unlock(&lock);
+
+	*ptrBytesWritten = (int32_t)size;
+	return 0;
+}
+
+/* Waits until everything handed to the port has been written. Called with
+lock held. */
+static void prvDrain(void)
+{
+	while ((writing != NO_BATCH || batchUsed[filling] > 0) && stats.lastError == 0 && writerRunning)
+	{
+		if (writing == NO_BATCH)
+			prvSubmitBatch();
+		pthread_cond_wait(&batchDone, &lock);
+	}
+}
+
+/* A new recording after vTraceStop starts with a new PSF header, so a file
+destination is rewritten from the start rather than appended to. */
+void prvTraceStreamPortOnTraceBegin(void)
+{
+	pthread_mutex_lock(&lock);
+	prvDrain();
+	if (isRegularFile && stats.bytesWritten > 0)
+	{
+		if (ftruncate(fd, 0) == 0)
+			(void)lseek(fd, 0, SEEK_SET);
+	}
+	pthread_mutex_unlock(&lock);
+}
+
+void prvTraceStreamPortOnTraceEnd(void)
+{
+	pthread_mutex_lock(&lock);
+	if (writing == NO_BATCH && batchUsed[filling] > 0)
+		prvSubmitBatch();
+	pthread_mutex_unlock(&lock);
+}
+
+void vTraceStreamPortClose(void)
+{
+	pthread_mutex_lock(&lock);
+	if (!writerRunning)
+	{
+		pthread_mutex_unlock(&lock);
+		return;
+	}
+	prvDrain();
+	writerExit = 1;
+	pthread_cond_signal(&batchReady);
+	pthread_mutex_unlock(&lock);
+
+	pthread_join(writerThread, NULL);
+
+	pthread_mutex_lock(&lock);
+	writerRunning = 0;
+	writerExit = 0;
+	if (fd > STDERR_FILENO)
+		close(fd);
+	fd = -1;
+	pthread_mutex_unlock(&lock);
+}
+
+void vTraceStreamPortGetStats(TraceStreamPortStats* pStats)
+{
+	pthread_mutex_lock(&lock);
+	*pStats = stats;
+	pStats->recorderDroppedEvents = DroppedEventCounter;
+	pthread_mutex_unlock(&lock);
+}
+
+#endif	/*(TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING)*/
+#endif	/*(TRC_USE_TRACEALYZER_RECORDER == 1)*/
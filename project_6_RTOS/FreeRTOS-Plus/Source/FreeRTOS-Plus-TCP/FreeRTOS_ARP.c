@@ -64,11 +64,96 @@ entry is still valid and can therefore be refreshed. */
  */
 static eARPLookupResult_t prvCacheLookup( uint32_t ulAddressToLookup, MACAddress_t * const pxMACAddress );
 
+#if( ipconfigUSE_ARP_HASH_TABLE != 0 )
+	/*
+	 * Return the row in xARPCache that holds ulIPAddress, or -1 if there is
+	 * none.
+	 */
+	static BaseType_t prvARPHashFind( uint32_t ulIPAddress );
+
+	/*
+	 * Add row x, of which ulIPAddress has been set, to the hash table.
+	 */
+	static void prvARPHashInsert( BaseType_t x );
+
+	/*
+	 * Remove row x from the hash table and from the LRU list, clear it, and
+	 * put it on the list of free rows.
+	 */
+	static void prvARPRemoveRow( BaseType_t x );
+
+	/*
+	 * Make row x the most recently used entry.
+	 */
+	static void prvARPTouchRow( BaseType_t x );
+
+	/*
+	 * Return a free row, after removing the least recently used entry if the
+	 * cache is full.
+	 */
+	static BaseType_t prvARPAllocateRow( void );
+#endif /* ipconfigUSE_ARP_HASH_TABLE */
+
+#if( ipconfigARP_PENDING_PACKETS != 0 )
+	/*
+	 * The MAC address of ulIPAddress has become known: send the packets that
+	 * are held for it, and wake up the TCP sockets that are waiting for it.
+	 */
+	static void prvARPSendPending( uint32_t ulIPAddress );
+
+	/*
+	 * Release all held packets.
+	 */
+	static void prvARPDropPending( void );
+#endif /* ipconfigARP_PENDING_PACKETS */
+
 /*-----------------------------------------------------------*/
 
 /* The ARP cache. */
 static ARPCacheRow_t xARPCache[ ipconfigARP_CACHE_ENTRIES ];
 
+#if( ipconfigUSE_ARP_HASH_TABLE != 0 )
+	/* Index of xARPCache keyed by IP address, with linear probing.  A slot
+	holds a row number + 1, or 0 when it is empty, so that a cleared table is
+	empty. */
+	static uint16_t usARPHashTable[ ipconfigARP_HASH_SLOTS ];
+
+	/* The rows in use form a list from the most to the least recently used
+	entry, linked through usOlder and usNewer.  Both hold row numbers + 1. */
+	static uint16_t usARPNewest = 0u;
+	static uint16_t usARPOldest = 0u;
+
+	/* Rows 0 up to uxARPRowsUsed have been handed out.  Rows freed after that
+	are linked through usOlder, starting at usARPFreeRows. */
+	static UBaseType_t uxARPRowsUsed = 0u;
+	static uint16_t usARPFreeRows = 0u;
+
+	/* The home slot of an IP address (network byte order).  The addresses on
+	one segment differ in the last byte, which is the most significant byte on
+	a little endian CPU, so the upper half is first folded into the lower. */
+	#define arpHASH_SLOT( ulIPAddress ) \
+		( ( UBaseType_t ) ( ( ( ( ( ulIPAddress ) ^ ( ( ulIPAddress ) >> 16 ) ) * 0x9E3779B1uL ) >> 16 ) & ( ipconfigARP_HASH_SLOTS - 1u ) ) )
+#endif /* ipconfigUSE_ARP_HASH_TABLE */
+
+#if( ipconfigARP_PENDING_PACKETS != 0 )
+	typedef struct xARP_PENDING_PACKET
+	{
+		NetworkBufferDescriptor_t *pxBuffer;	/* The held packet, or NULL for connecting TCP sockets. */
+		uint32_t ulIPAddress;					/* The address that is being resolved. */
+		TickType_t xHeldTime;					/* The time at which the packet was held. */
+	} ARPPendingPacket_t;
+
+	/* The held packets, the oldest first. */
+	static ARPPendingPacket_t xARPPending[ ipconfigARP_PENDING_PACKETS ];
+	static UBaseType_t uxARPPendingCount = 0u;
+
+	/* Set while prvARPSendPending() passes packets to
+	vProcessGeneratedUDPPacket(), which must not hold them again. */
+	static BaseType_t xARPSendingPending = pdFALSE;
+
+	static ARPPendingCounters_t xARPPendingCounters;
+#endif /* ipconfigARP_PENDING_PACKETS */
+
 /* The time at which the last gratuitous ARP was sent.  Gratuitous ARPs are used
 to ensure ARP tables are up to date and to detect IP address conflicts. */
 static TickType_t xLastGratuitousARPTime = ( TickType_t ) 0;
@@ -198,7 +283,18 @@ uint32_t ulTargetProtocolAddress, ulSenderProtocolAddress;
 			if( ( memcmp( xARPCache[ x ].xMACAddress.ucBytes, pxMACAddress->ucBytes, sizeof( pxMACAddress->ucBytes ) ) == 0 ) )
 			{
 				lResult = xARPCache[ x ].ulIPAddress;
-				memset( &xARPCache[ x ], '\0', sizeof( xARPCache[ x ] ) );
+				#if( ipconfigUSE_ARP_HASH_TABLE != 0 )
+				{
+					if( lResult != 0ul )
+					{
+						prvARPRemoveRow( x );
+					}
+				}
+				#else
+				{
+					memset( &xARPCache[ x ], '\0', sizeof( xARPCache[ x ] ) );
+				}
+				#endif /* ipconfigUSE_ARP_HASH_TABLE */
 				break;
 			}
 		}
@@ -209,6 +305,8 @@ uint32_t ulTargetProtocolAddress, ulSenderProtocolAddress;
 #endif	/* ipconfigUSE_ARP_REMOVE_ENTRY != 0 */
 /*-----------------------------------------------------------*/
 
+#if( ipconfigUSE_ARP_HASH_TABLE == 0 )
+
 void vARPRefreshCacheEntry( const MACAddress_t * pxMACAddress, const uint32_t ulIPAddress )
 {
 BaseType_t x = 0;
@@ -261,6 +359,15 @@ uint8_t ucMinAgeFound = 0U;
 					optimisation. */
 					xARPCache[ x ].ucAge = ( uint8_t ) ipconfigMAX_ARP_AGE;
 					xARPCache[ x ].ucValid = ( uint8_t ) pdTRUE;
+
+					#if( ipconfigARP_PENDING_PACKETS != 0 )
+					{
+						if( uxARPPendingCount != 0u )
+						{
+							prvARPSendPending( ulIPAddress );
+						}
+					}
+					#endif /* ipconfigARP_PENDING_PACKETS */
 					return;
 				}
 
@@ -333,6 +440,15 @@ uint8_t ucMinAgeFound = 0U;
 			/* And this entry does not need immediate attention */
 			xARPCache[ xUseEntry ].ucAge = ( uint8_t ) ipconfigMAX_ARP_AGE;
 			xARPCache[ xUseEntry ].ucValid = ( uint8_t ) pdTRUE;
+
+			#if( ipconfigARP_PENDING_PACKETS != 0 )
+			{
+				if( uxARPPendingCount != 0u )
+				{
+					prvARPSendPending( ulIPAddress );
+				}
+			}
+			#endif /* ipconfigARP_PENDING_PACKETS */
 		}
 		else if( xIpEntry < 0 )
 		{
@@ -343,6 +459,270 @@ uint8_t ucMinAgeFound = 0U;
 }
 /*-----------------------------------------------------------*/
 
+#else /* ipconfigUSE_ARP_HASH_TABLE != 0 */
+
+/*
+ * The same as above, but the entry is found through the hash table and, when
+ * the cache is full, the least recently used entry is replaced.  An entry
+ * that is reserved for an outstanding ARP request starts as the least recently
+ * used one, so that sending to many unknown hosts does not push out the
+ * resolved entries.  Unlike the linear version, an entry is not taken over by
+ * another IP address with the same MAC address: a host with several addresses
+ * keeps one entry for each, and an address that is no longer used ages out.
+ */
+void vARPRefreshCacheEntry( const MACAddress_t * pxMACAddress, const uint32_t ulIPAddress )
+{
+BaseType_t x;
+
+	#if( ipconfigARP_STORES_REMOTE_ADDRESSES == 0 )
+		/* Only process the IP address if it is on the local network.
+		Unless: when '*ipLOCAL_IP_ADDRESS_POINTER' equals zero, the IP-address
+		and netmask are still unknown. */
+		if( ( ( ulIPAddress & xNetworkAddressing.ulNetMask ) == ( ( *ipLOCAL_IP_ADDRESS_POINTER ) & xNetworkAddressing.ulNetMask ) ) ||
+			( *ipLOCAL_IP_ADDRESS_POINTER == 0ul ) )
+	#else
+		/* See the linear version above. */
+		if( pdTRUE )
+	#endif
+	{
+		/* 0.0.0.0 can not be stored, it marks an unused row. */
+		if( ulIPAddress != 0ul )
+		{
+			x = prvARPHashFind( ulIPAddress );
+
+			if( x < 0 )
+			{
+				x = prvARPAllocateRow();
+				xARPCache[ x ].ulIPAddress = ulIPAddress;
+				prvARPHashInsert( x );
+
+				if( pxMACAddress == NULL )
+				{
+					/* An entry is reserved to indicate that there is an
+					outstanding ARP request.  It goes to the end of the LRU
+					list. */
+					xARPCache[ x ].ucAge = ( uint8_t ) ipconfigMAX_ARP_RETRANSMISSIONS;
+					xARPCache[ x ].ucValid = ( uint8_t ) pdFALSE;
+					xARPCache[ x ].usNewer = usARPOldest;
+
+					if( usARPOldest != 0u )
+					{
+						xARPCache[ usARPOldest - 1u ].usOlder = ( uint16_t ) ( x + 1 );
+					}
+					else
+					{
+						usARPNewest = ( uint16_t ) ( x + 1 );
+					}
+
+					usARPOldest = ( uint16_t ) ( x + 1 );
+				}
+			}
+
+			if( pxMACAddress != NULL )
+			{
+				if( ( xARPCache[ x ].ucValid == ( uint8_t ) pdFALSE ) ||
+					( memcmp( xARPCache[ x ].xMACAddress.ucBytes, pxMACAddress->ucBytes, sizeof( pxMACAddress->ucBytes ) ) != 0 ) )
+				{
+					memcpy( xARPCache[ x ].xMACAddress.ucBytes, pxMACAddress->ucBytes, sizeof( pxMACAddress->ucBytes ) );
+					iptraceARP_TABLE_ENTRY_CREATED( ulIPAddress, (*pxMACAddress) );
+				}
+
+				xARPCache[ x ].ucAge = ( uint8_t ) ipconfigMAX_ARP_AGE;
+				xARPCache[ x ].ucValid = ( uint8_t ) pdTRUE;
+				prvARPTouchRow( x );
+
+				#if( ipconfigARP_PENDING_PACKETS != 0 )
+				{
+					if( uxARPPendingCount != 0u )
+					{
+						prvARPSendPending( ulIPAddress );
+					}
+				}
+				#endif /* ipconfigARP_PENDING_PACKETS */
+			}
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvARPHashFind( uint32_t ulIPAddress )
+{
+UBaseType_t uxSlot;
+uint16_t usRow;
+BaseType_t xReturn = -1;
+
+	/* The table always has more slots than rows, so an empty slot ends the
+	search. */
+	for( uxSlot = arpHASH_SLOT( ulIPAddress ); ; uxSlot = ( uxSlot + 1u ) & ( ipconfigARP_HASH_SLOTS - 1u ) )
+	{
+		usRow = usARPHashTable[ uxSlot ];
+
+		if( usRow == 0u )
+		{
+			break;
+		}
+
+		if( xARPCache[ usRow - 1u ].ulIPAddress == ulIPAddress )
+		{
+			xReturn = ( BaseType_t ) usRow - 1;
+			break;
+		}
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void prvARPHashInsert( BaseType_t x )
+{
+UBaseType_t uxSlot;
+
+	uxSlot = arpHASH_SLOT( xARPCache[ x ].ulIPAddress );
+
+	while( usARPHashTable[ uxSlot ] != 0u )
+	{
+		uxSlot = ( uxSlot + 1u ) & ( ipconfigARP_HASH_SLOTS - 1u );
+	}
+
+	usARPHashTable[ uxSlot ] = ( uint16_t ) ( x + 1 );
+}
+/*-----------------------------------------------------------*/
+
+static void prvARPRemoveRow( BaseType_t x )
+{
+UBaseType_t uxHole, uxSlot, uxHome;
+uint16_t usRow;
+
+	/* Find the slot of the row. */
+	uxHole = arpHASH_SLOT( xARPCache[ x ].ulIPAddress );
+
+	while( usARPHashTable[ uxHole ] != ( uint16_t ) ( x + 1 ) )
+	{
+		uxHole = ( uxHole + 1u ) & ( ipconfigARP_HASH_SLOTS - 1u );
+	}
+
+	/* Empty the slot without leaving a marker: move the following entries of
+	the probe sequence back into the hole when their home slot allows it. */
+	usARPHashTable[ uxHole ] = 0u;
+	uxSlot = uxHole;
+
+	for( ;; )
+	{
+		uxSlot = ( uxSlot + 1u ) & ( ipconfigARP_HASH_SLOTS - 1u );
+		usRow = usARPHashTable[ uxSlot ];
+
+		if( usRow == 0u )
+		{
+			break;
+		}
+
+		uxHome = arpHASH_SLOT( xARPCache[ usRow - 1u ].ulIPAddress );
+
+		/* The entry can move if its home slot is not between the hole and
+		its current slot (cyclically). */
+		if( ( ( uxSlot - uxHome ) & ( ipconfigARP_HASH_SLOTS - 1u ) ) >= ( ( uxSlot - uxHole ) & ( ipconfigARP_HASH_SLOTS - 1u ) ) )
+		{
+			usARPHashTable[ uxHole ] = usRow;
+			usARPHashTable[ uxSlot ] = 0u;
+			uxHole = uxSlot;
+		}
+	}
+
+	/* Unlink the row from the LRU list. */
+	if( xARPCache[ x ].usNewer != 0u )
+	{
+		xARPCache[ xARPCache[ x ].usNewer - 1u ].usOlder = xARPCache[ x ].usOlder;
+	}
+	else
+	{
+		usARPNewest = xARPCache[ x ].usOlder;
+	}
+
+	if( xARPCache[ x ].usOlder != 0u )
+	{
+		xARPCache[ xARPCache[ x ].usOlder - 1u ].usNewer = xARPCache[ x ].usNewer;
+	}
+	else
+	{
+		usARPOldest = xARPCache[ x ].usNewer;
+	}
+
+	memset( &xARPCache[ x ], '\0', sizeof( xARPCache[ x ] ) );
+	xARPCache[ x ].usOlder = usARPFreeRows;
+	usARPFreeRows = ( uint16_t ) ( x + 1 );
+}
+/*-----------------------------------------------------------*/
+
+static void prvARPTouchRow( BaseType_t x )
+{
+uint16_t usRow = ( uint16_t ) ( x + 1 );
+
+	if( usARPNewest != usRow )
+	{
+		/* Unlink the row, if it is in the list already.  A new row has
+		usNewer and usOlder cleared.  A row in the list that is not the newest
+		has usNewer set. */
+		if( xARPCache[ x ].usNewer != 0u )
+		{
+			xARPCache[ xARPCache[ x ].usNewer - 1u ].usOlder = xARPCache[ x ].usOlder;
+
+			if( xARPCache[ x ].usOlder != 0u )
+			{
+				xARPCache[ xARPCache[ x ].usOlder - 1u ].usNewer = xARPCache[ x ].usNewer;
+			}
+			else
+			{
+				usARPOldest = xARPCache[ x ].usNewer;
+			}
+		}
+
+		/* And insert it at the head. */
+		xARPCache[ x ].usNewer = 0u;
+		xARPCache[ x ].usOlder = usARPNewest;
+
+		if( usARPNewest != 0u )
+		{
+			xARPCache[ usARPNewest - 1u ].usNewer = usRow;
+		}
+		else
+		{
+			usARPOldest = usRow;
+		}
+
+		usARPNewest = usRow;
+	}
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvARPAllocateRow( void )
+{
+BaseType_t x;
+
+	if( ( usARPFreeRows == 0u ) && ( uxARPRowsUsed < ( UBaseType_t ) ipconfigARP_CACHE_ENTRIES ) )
+	{
+		x = ( BaseType_t ) uxARPRowsUsed;
+		uxARPRowsUsed++;
+	}
+	else
+	{
+		if( usARPFreeRows == 0u )
+		{
+			/* The cache is full, replace the least recently used entry. */
+			iptraceARP_TABLE_ENTRY_EXPIRED( xARPCache[ usARPOldest - 1u ].ulIPAddress );
+			prvARPRemoveRow( ( BaseType_t ) usARPOldest - 1 );
+		}
+
+		x = ( BaseType_t ) usARPFreeRows - 1;
+		usARPFreeRows = xARPCache[ x ].usOlder;
+		xARPCache[ x ].usOlder = 0u;
+	}
+
+	return x;
+}
+
+#endif /* ipconfigUSE_ARP_HASH_TABLE */
+/*-----------------------------------------------------------*/
+
 #if( ipconfigUSE_ARP_REVERSED_LOOKUP == 1 )
 	eARPLookupResult_t eARPGetCacheEntryByMac( MACAddress_t * const pxMACAddress, uint32_t *pulIPAddress )
 	{
@@ -444,9 +824,10 @@ uint32_t ulAddressToLookup;
 			{
 				eReturn = prvCacheLookup( ulAddressToLookup, pxMACAddress );
 
-				if( eReturn == eARPCacheMiss )
+				if( eReturn != eARPCacheHit )
 				{
-					/* It might be that the ARP has to go to the gateway. */
+					/* It might be that the ARP has to go to the gateway, or
+					that a packet is held until the gateway replies. */
 					*pulIPAddress = ulAddressToLookup;
 				}
 			}
@@ -458,6 +839,8 @@ uint32_t ulAddressToLookup;
 
 /*-----------------------------------------------------------*/
 
+#if( ipconfigUSE_ARP_HASH_TABLE == 0 )
+
 static eARPLookupResult_t prvCacheLookup( uint32_t ulAddressToLookup, MACAddress_t * const pxMACAddress )
 {
 BaseType_t x;
@@ -488,6 +871,36 @@ eARPLookupResult_t eReturn = eARPCacheMiss;
 
 	return eReturn;
 }
+
+#else /* ipconfigUSE_ARP_HASH_TABLE != 0 */
+
+static eARPLookupResult_t prvCacheLookup( uint32_t ulAddressToLookup, MACAddress_t * const pxMACAddress )
+{
+BaseType_t x;
+eARPLookupResult_t eReturn = eARPCacheMiss;
+
+	x = prvARPHashFind( ulAddressToLookup );
+
+	if( x >= 0 )
+	{
+		if( xARPCache[ x ].ucValid == ( uint8_t ) pdFALSE )
+		{
+			/* This entry is waiting an ARP reply, so is not valid. */
+			eReturn = eCantSendPacket;
+		}
+		else
+		{
+			/* A valid entry was found. */
+			memcpy( pxMACAddress->ucBytes, xARPCache[ x ].xMACAddress.ucBytes, sizeof( MACAddress_t ) );
+			eReturn = eARPCacheHit;
+			prvARPTouchRow( x );
+		}
+	}
+
+	return eReturn;
+}
+
+#endif /* ipconfigUSE_ARP_HASH_TABLE */
 /*-----------------------------------------------------------*/
 
 void vARPAgeCache( void )
@@ -527,7 +940,15 @@ TickType_t xTimeNow;
 			{
 				/* The entry is no longer valid.  Wipe it out. */
 				iptraceARP_TABLE_ENTRY_EXPIRED( xARPCache[ x ].ulIPAddress );
-				xARPCache[ x ].ulIPAddress = 0UL;
+				#if( ipconfigUSE_ARP_HASH_TABLE != 0 )
+				{
+					prvARPRemoveRow( x );
+				}
+				#else
+				{
+					xARPCache[ x ].ulIPAddress = 0UL;
+				}
+				#endif /* ipconfigUSE_ARP_HASH_TABLE */
 			}
 		}
 	}
@@ -615,9 +1036,214 @@ ARPPacket_t *pxARPPacket;
 }
 /*-----------------------------------------------------------*/
 
+#if( ipconfigARP_PENDING_PACKETS != 0 )
+
+	BaseType_t xARPHoldPacket( NetworkBufferDescriptor_t * const pxNetworkBuffer, uint32_t ulIPAddress )
+	{
+	UBaseType_t uxIndex;
+	UBaseType_t uxHeldForAddress = 0u;
+	BaseType_t xWaiting = pdFALSE;
+	BaseType_t xReturn = pdFALSE;
+	MACAddress_t xMACAddress;
+
+		if( xARPSendingPending == pdFALSE )
+		{
+			for( uxIndex = 0u; uxIndex < uxARPPendingCount; uxIndex++ )
+			{
+				if( xARPPending[ uxIndex ].ulIPAddress == ulIPAddress )
+				{
+					if( xARPPending[ uxIndex ].pxBuffer != NULL )
+					{
+						uxHeldForAddress++;
+					}
+					else
+					{
+						xWaiting = pdTRUE;
+					}
+				}
+			}
+
+			if( pxNetworkBuffer == NULL )
+			{
+				/* A TCP socket is connecting.  One entry for each address is
+				enough to wake up all sockets that wait for it. */
+				if( ( xWaiting == pdFALSE ) && ( uxARPPendingCount < ( UBaseType_t ) ipconfigARP_PENDING_PACKETS ) )
+				{
+					xReturn = pdTRUE;
+				}
+			}
+			else if( prvCacheLookup( ulIPAddress, &xMACAddress ) != eCantSendPacket )
+			{
+				/* There is no ARP request outstanding for ulIPAddress, for
+				instance because it is not on the local network. */
+			}
+			else if( ( uxHeldForAddress >= ( UBaseType_t ) ipconfigARP_PENDING_PACKETS_PER_ADDRESS ) ||
+					 ( uxARPPendingCount >= ( UBaseType_t ) ipconfigARP_PENDING_PACKETS ) )
+			{
+				xARPPendingCounters.ulRejected++;
+			}
+			else
+			{
+				xARPPendingCounters.ulHeld++;
+				xReturn = pdTRUE;
+			}
+		}
+
+		if( xReturn != pdFALSE )
+		{
+			xARPPending[ uxARPPendingCount ].pxBuffer = pxNetworkBuffer;
+			xARPPending[ uxARPPendingCount ].ulIPAddress = ulIPAddress;
+			xARPPending[ uxARPPendingCount ].xHeldTime = xTaskGetTickCount();
+			uxARPPendingCount++;
+
+			if( uxARPPendingCount == 1u )
+			{
+				vIPReloadARPPendingTimer( pdMS_TO_TICKS( ipconfigARP_PENDING_TIMEOUT_MS ) );
+			}
+		}
+
+		return xReturn;
+	}
+	/*-----------------------------------------------------------*/
+
+	static void prvARPSendPending( uint32_t ulIPAddress )
+	{
+	UBaseType_t uxSource, uxTarget = 0u;
+	NetworkBufferDescriptor_t *pxNetworkBuffer;
+	BaseType_t xWakeUpSockets = pdFALSE;
+
+		xARPSendingPending = pdTRUE;
+
+		for( uxSource = 0u; uxSource < uxARPPendingCount; uxSource++ )
+		{
+			if( xARPPending[ uxSource ].ulIPAddress == ulIPAddress )
+			{
+				pxNetworkBuffer = xARPPending[ uxSource ].pxBuffer;
+
+				if( pxNetworkBuffer != NULL )
+				{
+					/* The lookup will succeed now, and the packet will be
+					sent, in the order in which the packets were held. */
+					xARPPendingCounters.ulSent++;
+					vProcessGeneratedUDPPacket( pxNetworkBuffer );
+				}
+				else
+				{
+					xWakeUpSockets = pdTRUE;
+				}
+			}
+			else
+			{
+				xARPPending[ uxTarget ] = xARPPending[ uxSource ];
+				uxTarget++;
+			}
+		}
+
+		uxARPPendingCount = uxTarget;
+		xARPSendingPending = pdFALSE;
+
+		if( uxARPPendingCount == 0u )
+		{
+			vIPSetARPPendingTimerEnableState( pdFALSE );
+		}
+
+		#if( ipconfigUSE_TCP == 1 )
+		{
+			if( xWakeUpSockets != pdFALSE )
+			{
+				vTCPWakeUpConnectingSockets();
+			}
+		}
+		#else
+		{
+			( void ) xWakeUpSockets;
+		}
+		#endif /* ipconfigUSE_TCP */
+	}
+	/*-----------------------------------------------------------*/
+
+	void vARPCheckPendingPackets( void )
+	{
+	TickType_t xNow = xTaskGetTickCount();
+	TickType_t xAge = 0u;
+
+		/* The oldest packets are at the start of the list. */
+		while( uxARPPendingCount != 0u )
+		{
+			xAge = xNow - xARPPending[ 0 ].xHeldTime;
+
+			if( xAge < pdMS_TO_TICKS( ipconfigARP_PENDING_TIMEOUT_MS ) )
+			{
+				break;
+			}
+
+			if( xARPPending[ 0 ].pxBuffer != NULL )
+			{
+				xARPPendingCounters.ulDropped++;
+				vReleaseNetworkBufferAndDescriptor( xARPPending[ 0 ].pxBuffer );
+			}
+
+			uxARPPendingCount--;
+			memmove( &( xARPPending[ 0 ] ), &( xARPPending[ 1 ] ), uxARPPendingCount * sizeof( xARPPending[ 0 ] ) );
+		}
+
+		if( uxARPPendingCount != 0u )
+		{
+			vIPReloadARPPendingTimer( pdMS_TO_TICKS( ipconfigARP_PENDING_TIMEOUT_MS ) - xAge );
+		}
+		else
+		{
+			vIPSetARPPendingTimerEnableState( pdFALSE );
+		}
+	}
+	/*-----------------------------------------------------------*/
+
+	static void prvARPDropPending( void )
+	{
+	UBaseType_t uxIndex;
+
+		for( uxIndex = 0u; uxIndex < uxARPPendingCount; uxIndex++ )
+		{
+			if( xARPPending[ uxIndex ].pxBuffer != NULL )
+			{
+				xARPPendingCounters.ulDropped++;
+				vReleaseNetworkBufferAndDescriptor( xARPPending[ uxIndex ].pxBuffer );
+			}
+		}
+
+		uxARPPendingCount = 0u;
+		vIPSetARPPendingTimerEnableState( pdFALSE );
+	}
+	/*-----------------------------------------------------------*/
+
+	void vARPGetPendingCounters( ARPPendingCounters_t *pxCounters )
+	{
+		*pxCounters = xARPPendingCounters;
+	}
+
+#endif /* ipconfigARP_PENDING_PACKETS */
+/*-----------------------------------------------------------*/
+
 void FreeRTOS_ClearARP( void )
 {
 	memset( xARPCache, '\0', sizeof( xARPCache ) );
+
+	#if( ipconfigARP_PENDING_PACKETS != 0 )
+	{
+		/* Without a network, the held packets can not be sent. */
+		prvARPDropPending();
+	}
+	#endif /* ipconfigARP_PENDING_PACKETS */
+
+	#if( ipconfigUSE_ARP_HASH_TABLE != 0 )
+	{
+		memset( usARPHashTable, '\0', sizeof( usARPHashTable ) );
+		usARPNewest = 0u;
+		usARPOldest = 0u;
+		uxARPRowsUsed = 0u;
+		usARPFreeRows = 0u;
+	}
+	#endif /* ipconfigUSE_ARP_HASH_TABLE */
 }
 /*-----------------------------------------------------------*/
 
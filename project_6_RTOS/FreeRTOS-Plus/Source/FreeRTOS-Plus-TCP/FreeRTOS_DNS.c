@@ -52,12 +52,16 @@
 	#define dnsOUTGOING_FLAGS				0x0001 /* Standard query. */
 	#define dnsRX_FLAGS_MASK				0x0f80 /* The bits of interest in the flags field of incoming DNS messages. */
 	#define dnsEXPECTED_RX_FLAGS			0x0080 /* Should be a response, without any errors. */
+	#define dnsNXDOMAIN_RX_FLAGS			0x0380 /* A response telling that the name does not exist. */
+	#define dnsRX_FLAGS_RESPONSE			0x0080 /* The message is a response. */
 #else
 	#define dnsDNS_PORT						0x0035
 	#define dnsONE_QUESTION					0x0001
 	#define dnsOUTGOING_FLAGS				0x0100 /* Standard query. */
 	#define dnsRX_FLAGS_MASK				0x800f /* The bits of interest in the flags field of incoming DNS messages. */
 	#define dnsEXPECTED_RX_FLAGS			0x8000 /* Should be a response, without any errors. */
+	#define dnsNXDOMAIN_RX_FLAGS			0x8003 /* A response telling that the name does not exist. */
+	#define dnsRX_FLAGS_RESPONSE			0x8000 /* The message is a response. */
 
 #endif /* ipconfigBYTE_ORDER */
 
@@ -79,6 +83,7 @@ name field is an offset to the string, rather than the string itself. */
 
 /* Host types. */
 #define dnsTYPE_A_HOST						0x01
+#define dnsTYPE_SOA							0x06
 #define dnsCLASS_IN							0x01
 
 /* LLMNR constants. */
@@ -127,6 +132,13 @@ static uint32_t prvParseDNSReply( uint8_t *pucUDPPayloadBuffer, size_t xBufferLe
  */
 static uint32_t prvGetHostByName( const char *pcHostName, TickType_t xIdentifier, TickType_t xReadTimeOut_ms );
 
+/*
+ * Return pdTRUE when a reply with the identifier usIdentifier, that came in on
+ * port usPort (in network byte order), answers a request that was sent without
+ * a socket, or from a socket that has been closed since.
+ */
+static BaseType_t prvDNSReplyIsExpected( uint16_t usIdentifier, uint16_t usPort );
+
 /*
  * The NBNS and the LLMNR protocol share this reply function.
  */
@@ -140,6 +152,9 @@ static uint32_t prvGetHostByName( const char *pcHostName, TickType_t xIdentifier
 
 #if( ipconfigUSE_DNS_CACHE == 1 )
 	static uint8_t *prvReadNameField( uint8_t *pucByte, size_t xSourceLen, char *pcName, size_t xLen );
+#endif /* ipconfigUSE_DNS_CACHE == 1 */
+
+#if( ipconfigUSE_DNS_CACHE == 1 ) && ( ipconfigUSE_DNS_CACHE_HASH == 0 )
 	static void prvProcessDNSCache( const char *pcName, uint32_t *pulIP, uint32_t ulTTL, BaseType_t xLookUp );
 
 	typedef struct xDNS_CACHE_TABLE_ROW
@@ -151,7 +166,193 @@ static uint32_t prvGetHostByName( const char *pcHostName, TickType_t xIdentifier
 	} DNSCacheRow_t;
 
 	static DNSCacheRow_t xDNSCache[ ipconfigDNS_CACHE_ENTRIES ];
-#endif /* ipconfigUSE_DNS_CACHE == 1 */
+#endif /* ipconfigUSE_DNS_CACHE == 1 && ipconfigUSE_DNS_CACHE_HASH == 0 */
+
+#if( ipconfigUSE_DNS_CACHE_HASH != 0 )
+	/*
+	 * Look up pcName in the cache.  Returns -1 when it is not there, 0 when the
+	 * name is known not to exist, or else the number of addresses copied to
+	 * pulAddresses, at most xMaxCount.  The first one copied is the next one in
+	 * turn.
+	 */
+	static BaseType_t prvDNSCacheLookup( const char *pcName, uint32_t *pulAddresses, BaseType_t xMaxCount );
+
+	/*
+	 * Store xCount addresses for pcName, to be kept for ulTTL seconds.  A count
+	 * of zero stores a negative entry, a TTL of zero removes the name.
+	 */
+	static void prvDNSCacheStore( const char *pcName, const uint32_t *pulAddresses, BaseType_t xCount, uint32_t ulTTL );
+
+	/*
+	 * FNV-1a hash of a name.
+	 */
+	static uint32_t prvDNSHash( const char *pcName );
+
+	/*
+	 * Return the row in xDNSCache that holds pcName, or -1 if there is none.
+	 */
+	static BaseType_t prvDNSCacheFind( const char *pcName, uint32_t ulHash );
+
+	/*
+	 * Remove row x from the hash table and clear it.
+	 */
+	static void prvDNSRemoveRow( BaseType_t x );
+
+	/*
+	 * Return a free row, after removing the entry that would expire first if
+	 * the cache is full.
+	 */
+	static BaseType_t prvDNSAllocateRow( uint32_t ulNow );
+
+	/*
+	 * Make sure that the cache timer expires no later than at ulDue.
+	 */
+	static void prvDNSScheduleRefresh( uint32_t ulDue, uint32_t ulNow );
+
+	/*
+	 * Walk over the answer and authority records of a negative answer, and
+	 * return for how many seconds it may be cached.
+	 */
+	static uint32_t prvReadNegativeTTL( uint8_t *pucByte, size_t xSourceBytesRemaining, uint16_t usAnswers, uint16_t usAuthorityRRs );
+
+	/* An entry that has been looked up since it was stored. */
+	#define dnsCACHE_USED				( ( uint8_t ) 0x01u )
+	/* A new request for the entry has been sent. */
+	#define dnsCACHE_REFRESHING			( ( uint8_t ) 0x02u )
+
+	/* An entry in use is asked again when 1/8 of its TTL is left.  Entries
+	with a TTL shorter than 8 seconds are not refreshed. */
+	#define dnsREFRESH_LEAD( ulTTL )	( ( ulTTL ) >> 3 )
+
+	/* The cache timer is reloaded with at most this many seconds.  When it
+	expires early, vDNSCheckCache() reloads it. */
+	#define dnsMAX_REFRESH_DELAY		( 3600uL )
+
+	#define dnsSECONDS_NOW()			( ( uint32_t ) ( xTaskGetTickCount() / configTICK_RATE_HZ ) )
+
+	typedef struct xDNS_CACHE_TABLE_ROW
+	{
+		uint32_t ulIPAddresses[ ipconfigDNS_CACHE_ADDRESSES_PER_ENTRY ];	/* In network byte order. */
+		char pcName[ ipconfigDNS_CACHE_NAME_LENGTH ];	/* The name of the host, empty if the row is free. */
+		uint32_t ulTTL;						/* Time-to-Live in seconds, in host byte order. */
+		uint32_t ulTimeWhenAddedInSeconds;
+		uint32_t ulHash;					/* The hash of pcName. */
+		uint8_t ucNumIPAddresses;			/* Zero for a name that does not exist. */
+		uint8_t ucCurrentIPAddress;			/* The address to be handed out next. */
+		uint8_t ucFlags;					/* dnsCACHE_USED and dnsCACHE_REFRESHING. */
+		uint16_t usRefreshIdentifier;		/* The identifier of the refresh request, with dnsCACHE_REFRESHING. */
+		uint16_t usRefreshPort;				/* The port it was sent from, in network byte order. */
+	} DNSCacheRow_t;
+
+	static DNSCacheRow_t xDNSCache[ ipconfigDNS_CACHE_ENTRIES ];
+
+	/* Index of xDNSCache keyed by the hash of the name, with linear probing.  A
+	slot holds a row number + 1, or 0 when it is empty. */
+	static uint16_t usDNSHashTable[ ipconfigDNS_CACHE_HASH_SLOTS ];
+
+	/* The time (in seconds) at which the cache timer will expire, valid when
+	xDNSRefreshScheduled is true. */
+	static uint32_t ulDNSNextRefresh = 0uL;
+	static BaseType_t xDNSRefreshScheduled = pdFALSE;
+
+	#define dnsHASH_SLOT( ulHash ) \
+		( ( UBaseType_t ) ( ( ulHash ) & ( ipconfigDNS_CACHE_HASH_SLOTS - 1u ) ) )
+#endif /* ipconfigUSE_DNS_CACHE_HASH */
+
+#if( ipconfigDNS_COALESCE_REQUESTS != 0 )
+	/* A look-up that is in progress.  Other callers that ask for the same name
+	attach to it, in stead of sending requests of their own. */
+	typedef struct xDNS_REQUEST
+	{
+		struct xLIST_ITEM xListItem;	/* The item value is the identifier of the request. */
+		EventGroupHandle_t xEventGroup;	/* Created for the first task that has to wait for another one. */
+		uint32_t ulIPAddress;			/* The result, valid once xDone is set. */
+		UBaseType_t uxUsers;			/* Tasks that are blocked in FreeRTOS_gethostbyname() on this look-up. */
+		BaseType_t xDone;				/* The look-up has finished, successful or not. */
+		BaseType_t xHasOwner;			/* One of the users sends the requests and receives the reply. */
+	#if( ipconfigDNS_USE_CALLBACKS != 0 )
+		TickType_t xLastSendTime;		/* When the IP-task sent a request for a look-up without owner. */
+		UBaseType_t uxAttempts;			/* The number of requests sent by the IP-task. */
+		uint16_t usPort;				/* The port it sends them from, in network byte order, or zero. */
+	#endif
+		char pcName[ 1 ];
+	} DNSRequest_t;
+
+	/*
+	 * Find the look-up of pcHostName that is in progress, or start a new one.
+	 * xWaitForReply is false for a call with a call-back function.
+	 * *pxSendRequest is set when the caller must send the (first) request.
+	 * Returns NULL when there is not enough memory.
+	 */
+	static DNSRequest_t *prvDNSAttachRequest( const char *pcHostName, BaseType_t xWaitForReply, BaseType_t *pxSendRequest );
+
+	/*
+	 * Complete the look-up for the caller of FreeRTOS_gethostbyname_a() after
+	 * it attached to pxRequest: send the requests, or wait for the task that
+	 * does.
+	 */
+	static uint32_t prvDNSRunRequest( DNSRequest_t *pxRequest, const char *pcHostName, BaseType_t xWaitForReply, BaseType_t xSendRequest, TickType_t xReadTimeOut_ms );
+
+	/*
+	 * Store the result of the look-up with the given identifier and wake up the
+	 * tasks that are waiting for it.
+	 */
+	static void prvDNSSetRequestResult( TickType_t xIdentifier, uint32_t ulIPAddress );
+
+	/*
+	 * Store the result of a look-up, wake up the tasks that are waiting for it,
+	 * and free it if there are none.
+	 */
+	static void prvDNSCompleteRequest( DNSRequest_t *pxRequest, uint32_t ulIPAddress );
+
+	/*
+	 * Remove a request from xRequestList and free it.
+	 */
+	static void prvDNSFreeRequest( DNSRequest_t *pxRequest );
+
+	#if( ipconfigDNS_USE_CALLBACKS != 0 )
+		/*
+		 * Finish the look-ups without owner that have used all attempts, and
+		 * forget those that nobody waits for.  If xSendRequests is true, also
+		 * send the requests that are due.  Returns pdTRUE while look-ups
+		 * without owner are in progress.
+		 */
+		static BaseType_t prvDNSCheckRequests( BaseType_t xSendRequests );
+
+		/*
+		 * Send the requests for the look-ups without owner that are due, from
+		 * a port without a socket.
+		 */
+		static void prvDNSSendRequests( void );
+
+		/* A look-up without owner is asked again after this time. */
+		#define dnsREQUEST_RESEND_TIME		pdMS_TO_TICKS( 1000u )
+	#endif /* ipconfigDNS_USE_CALLBACKS */
+
+	/* The bit that is set in xEventGroup when the look-up is done. */
+	#define dnsREQUEST_DONE_BIT			( ( EventBits_t ) 0x0001u )
+
+	/* Longer names are looked up without coalescing. */
+	#define dnsMAX_REQUEST_NAME_LENGTH	( 253u )
+
+	/* The look-ups in progress. */
+	static List_t xRequestList;
+#endif /* ipconfigDNS_COALESCE_REQUESTS */
+
+#if( ipconfigUSE_DNS_CACHE_HASH != 0 ) || ( ( ipconfigDNS_COALESCE_REQUESTS != 0 ) && ( ipconfigDNS_USE_CALLBACKS != 0 ) )
+	/*
+	 * Return a port number, in network byte order, that no UDP socket is bound
+	 * to.  Called by the IP-task only, which owns the list of bound sockets.
+	 */
+	static uint16_t prvDNSGetFreePort( void );
+
+	/*
+	 * Send a request created by prvCreateDNSMessage() from usPort, which has no
+	 * socket, so that the reply will be passed to ulDNSHandlePacket().  Called
+	 * by the IP-task only.
+	 */
+	static void prvDNSSendWithoutSocket( NetworkBufferDescriptor_t *pxNetworkBuffer, size_t xPayloadLength, uint16_t usPort, BaseType_t xUseLLMNR );
+#endif
 
 #if( ipconfigUSE_LLMNR == 1 )
 	const MACAddress_t xLLMNR_MacAdress = { { 0x01, 0x00, 0x5e, 0x00, 0x00, 0xfc } };
@@ -252,14 +453,37 @@ typedef struct xDNSAnswerRecord DNSAnswerRecord_t;
 
 /*-----------------------------------------------------------*/
 
-#if( ipconfigUSE_DNS_CACHE == 1 )
+#if( ipconfigUSE_DNS_CACHE == 1 ) && ( ipconfigUSE_DNS_CACHE_HASH == 0 )
 	uint32_t FreeRTOS_dnslookup( const char *pcHostName )
 	{
 	uint32_t ulIPAddress = 0UL;
 		prvProcessDNSCache( pcHostName, &ulIPAddress, 0, pdTRUE );
 		return ulIPAddress;
 	}
-#endif /* ipconfigUSE_DNS_CACHE == 1 */
+#endif /* ipconfigUSE_DNS_CACHE == 1 && ipconfigUSE_DNS_CACHE_HASH == 0 */
+/*-----------------------------------------------------------*/
+
+#if( ipconfigUSE_DNS_CACHE_HASH != 0 )
+	uint32_t FreeRTOS_dnslookup( const char *pcHostName )
+	{
+	uint32_t ulIPAddress = 0UL;
+		( void ) prvDNSCacheLookup( pcHostName, &ulIPAddress, 1 );
+		return ulIPAddress;
+	}
+	/*-----------------------------------------------------------*/
+
+	BaseType_t FreeRTOS_dnslookup_all( const char *pcHostName, uint32_t *pulAddresses, BaseType_t xMaxCount )
+	{
+	BaseType_t xCount;
+
+		xCount = prvDNSCacheLookup( pcHostName, pulAddresses, xMaxCount );
+		if( xCount < 0 )
+		{
+			xCount = 0;
+		}
+		return xCount;
+	}
+#endif /* ipconfigUSE_DNS_CACHE_HASH != 0 */
 /*-----------------------------------------------------------*/
 
 #if( ipconfigDNS_USE_CALLBACKS != 0 )
@@ -270,6 +494,7 @@ typedef struct xDNSAnswerRecord DNSAnswerRecord_t;
 		TimeOut_t xTimeoutState;
 		void *pvSearchID;
 		struct xLIST_ITEM xListItem;
+		uint16_t usPort;				/* The port of the socket that sent the request, in network byte order, or zero. */
 		char pcName[ 1 ];
 	} DNSCallback_t;
 
@@ -300,6 +525,7 @@ typedef struct xDNSAnswerRecord DNSAnswerRecord_t;
 	{
 	const ListItem_t *pxIterator;
 	const MiniListItem_t* xEnd = ( const MiniListItem_t* )listGET_END_MARKER( &xCallbackList );
+	BaseType_t xRequestsPending = pdFALSE;
 
 		vTaskSuspendAll();
 		{
@@ -325,10 +551,24 @@ typedef struct xDNSAnswerRecord DNSAnswerRecord_t;
 		}
 		xTaskResumeAll();
 
-		if( listLIST_IS_EMPTY( &xCallbackList ) )
+		#if( ipconfigDNS_COALESCE_REQUESTS != 0 )
 		{
-			vIPSetDnsTimerEnableState( pdFALSE );
+			/* The IP-task sends the requests of look-ups without owner, and
+			repeats them from the DNS timer. */
+			xRequestsPending = prvDNSCheckRequests( ( pvSearchID == NULL ) ? pdTRUE : pdFALSE );
 		}
+		#endif /* ipconfigDNS_COALESCE_REQUESTS */
+
+		vTaskSuspendAll();
+		{
+			/* vDNSSetCallBack() starts the timer when it stores the first
+			call-back, with the scheduler suspended as well. */
+			if( listLIST_IS_EMPTY( &xCallbackList ) && ( xRequestsPending == pdFALSE ) )
+			{
+				vIPSetDnsTimerEnableState( pdFALSE );
+			}
+		}
+		xTaskResumeAll();
 	}
 	/*-----------------------------------------------------------*/
 
@@ -351,20 +591,26 @@ typedef struct xDNSAnswerRecord DNSAnswerRecord_t;
 		xTimeout /= portTICK_PERIOD_MS;
 		if( pxCallback != NULL )
 		{
-			if( listLIST_IS_EMPTY( &xCallbackList ) )
-			{
-				/* This is the first one, start the DNS timer to check for timeouts */
-				vIPReloadDNSTimer( FreeRTOS_min_uint32( 1000U, xTimeout ) );
-			}
 			strcpy( pxCallback->pcName, pcHostName );
 			pxCallback->pCallbackFunction = pCallbackFunction;
 			pxCallback->pvSearchID = pvSearchID;
 			pxCallback->xRemaningTime = xTimeout;
+			pxCallback->usPort = 0u;
 			vTaskSetTimeOutState( &pxCallback->xTimeoutState );
 			listSET_LIST_ITEM_OWNER( &( pxCallback->xListItem ), ( void* ) pxCallback );
-			listSET_LIST_ITEM_VALUE( &( pxCallback->xListItem ), xIdentifier );
+			/* Only 16 bits of the identifier are sent, and compared with the
+			identifier of the replies. */
+			listSET_LIST_ITEM_VALUE( &( pxCallback->xListItem ), ( TickType_t ) ( uint16_t ) xIdentifier );
 			vTaskSuspendAll();
 			{
+				if( listLIST_IS_EMPTY( &xCallbackList ) )
+				{
+					/* This is the first one, start the DNS timer to check for
+					timeouts.  Done with the scheduler suspended, so that
+					vDNSCheckCallBack() can not stop it again for an empty
+					list. */
+					vIPReloadDNSTimer( FreeRTOS_min_uint32( 1000U, xTimeout ) );
+				}
 				vListInsertEnd( &xCallbackList, &pxCallback->xListItem );
 			}
 			xTaskResumeAll();
@@ -372,6 +618,33 @@ typedef struct xDNSAnswerRecord DNSAnswerRecord_t;
 	}
 	/*-----------------------------------------------------------*/
 
+	/* prvGetHostByName() sends the request of a call-back from a socket that
+	it closes before the reply comes in.  Remember the port, so that
+	ulDNSHandlePacket() can tell the reply from a forged one. */
+	static void prvDNSSetCallBackPort( TickType_t xIdentifier, uint16_t usPort );
+	static void prvDNSSetCallBackPort( TickType_t xIdentifier, uint16_t usPort )
+	{
+		const ListItem_t *pxIterator;
+		const MiniListItem_t* xEnd = ( const MiniListItem_t* )listGET_END_MARKER( &xCallbackList );
+
+		vTaskSuspendAll();
+		{
+			for( pxIterator  = ( const ListItem_t * ) listGET_NEXT( xEnd );
+				 pxIterator != ( const ListItem_t * ) xEnd;
+				 pxIterator  = ( const ListItem_t * ) listGET_NEXT( pxIterator ) )
+			{
+				DNSCallback_t *pxCallback = ( DNSCallback_t * ) listGET_LIST_ITEM_OWNER( pxIterator );
+
+				if( listGET_LIST_ITEM_VALUE( pxIterator ) == ( TickType_t ) ( uint16_t ) xIdentifier )
+				{
+					pxCallback->usPort = usPort;
+				}
+			}
+		}
+		xTaskResumeAll();
+	}
+	/*-----------------------------------------------------------*/
+
 	/* A DNS reply was received, see if there is any matching entry and
 	call the handler. */
 	static void vDNSDoCallback( TickType_t xIdentifier, const char *pcName, uint32_t ulIPAddress );
@@ -380,32 +653,454 @@ typedef struct xDNSAnswerRecord DNSAnswerRecord_t;
 		const ListItem_t *pxIterator;
 		const MiniListItem_t* xEnd = ( const MiniListItem_t* )listGET_END_MARKER( &xCallbackList );
 
+		#if( ipconfigDNS_COALESCE_REQUESTS != 0 )
+		{
+			/* Tasks may be blocked in FreeRTOS_gethostbyname() on the same
+			look-up. */
+			prvDNSSetRequestResult( xIdentifier, ulIPAddress );
+		}
+		#endif /* ipconfigDNS_COALESCE_REQUESTS */
+
 		vTaskSuspendAll();
 		{
+			/* Several call-backs may be waiting for the same reply. */
 			for( pxIterator  = ( const ListItem_t * ) listGET_NEXT( xEnd );
 				 pxIterator != ( const ListItem_t * ) xEnd;
-				 pxIterator  = ( const ListItem_t * ) listGET_NEXT( pxIterator ) )
+				  )
 			{
-				if( listGET_LIST_ITEM_VALUE( pxIterator ) == xIdentifier )
+				DNSCallback_t *pxCallback = ( DNSCallback_t * ) listGET_LIST_ITEM_OWNER( pxIterator );
+				/* Move to the next item because we might remove this item */
+				pxIterator  = ( const ListItem_t * ) listGET_NEXT( pxIterator );
+				if( listGET_LIST_ITEM_VALUE( &( pxCallback->xListItem ) ) == xIdentifier )
 				{
-					DNSCallback_t *pxCallback = ( DNSCallback_t * ) listGET_LIST_ITEM_OWNER( pxIterator );
 					pxCallback->pCallbackFunction( pcName, pxCallback->pvSearchID, ulIPAddress );
 					uxListRemove( &pxCallback->xListItem );
 					vPortFree( pxCallback );
-					if( listLIST_IS_EMPTY( &xCallbackList ) )
+				}
+			}
+			#if( ipconfigDNS_COALESCE_REQUESTS == 0 )
+			{
+				if( listLIST_IS_EMPTY( &xCallbackList ) )
+				{
+					vIPSetDnsTimerEnableState( pdFALSE );
+				}
+			}
+			#endif /* ipconfigDNS_COALESCE_REQUESTS */
+			/* Otherwise vDNSCheckCallBack() will stop the timer, when also
+			no look-ups without owner are in progress. */
+		}
+		xTaskResumeAll();
+	}
+
+#endif	/* ipconfigDNS_USE_CALLBACKS != 0 */
+/*-----------------------------------------------------------*/
+
+#if( ipconfigDNS_COALESCE_REQUESTS != 0 )
+
+	static DNSRequest_t *prvDNSAttachRequest( const char *pcHostName, BaseType_t xWaitForReply, BaseType_t *pxSendRequest )
+	{
+	const ListItem_t *pxIterator;
+	const MiniListItem_t* xEnd = ( const MiniListItem_t* )listGET_END_MARKER( &xRequestList );
+	DNSRequest_t *pxRequest = NULL;
+	size_t uxLength = strlen( pcHostName );
+	uint16_t usIdentifier;
+
+		*pxSendRequest = pdFALSE;
+
+		if( uxLength > dnsMAX_REQUEST_NAME_LENGTH )
+		{
+			return NULL;
+		}
+
+		vTaskSuspendAll();
+		{
+			if( listLIST_IS_INITIALISED( &xRequestList ) == pdFALSE )
+			{
+				vListInitialise( &xRequestList );
+			}
+
+			for( pxIterator  = ( const ListItem_t * ) listGET_NEXT( xEnd );
+				 pxIterator != ( const ListItem_t * ) xEnd;
+				 pxIterator  = ( const ListItem_t * ) listGET_NEXT( pxIterator ) )
+			{
+				DNSRequest_t *pxCandidate = ( DNSRequest_t * ) listGET_LIST_ITEM_OWNER( pxIterator );
+
+				if( ( pxCandidate->xDone == pdFALSE ) && ( strcmp( pxCandidate->pcName, pcHostName ) == 0 ) )
+				{
+					#if( ipconfigDNS_USE_CALLBACKS != 0 )
 					{
-						vIPSetDnsTimerEnableState( pdFALSE );
+						if( ( pxCandidate->xHasOwner == pdFALSE ) && ( pxCandidate->uxAttempts >= ipconfigDNS_REQUEST_ATTEMPTS ) )
+						{
+							/* All requests have been sent without an answer,
+							this caller gets a new series. */
+							continue;
+						}
 					}
+					#endif /* ipconfigDNS_USE_CALLBACKS */
+
+					pxRequest = pxCandidate;
 					break;
 				}
 			}
+
+			if( pxRequest == NULL )
+			{
+				/* Nobody is looking up this name yet. */
+				pxRequest = ( DNSRequest_t * ) pvPortMalloc( sizeof( *pxRequest ) + uxLength );
+
+				if( pxRequest != NULL )
+				{
+					memset( pxRequest, '\0', sizeof( *pxRequest ) );
+					strcpy( pxRequest->pcName, pcHostName );
+
+					/* Only 16 bits are sent, and zero means 'no request'. */
+					do
+					{
+						usIdentifier = ( uint16_t ) ipconfigRAND32();
+					} while( usIdentifier == 0u );
+
+					listSET_LIST_ITEM_OWNER( &( pxRequest->xListItem ), ( void * ) pxRequest );
+					listSET_LIST_ITEM_VALUE( &( pxRequest->xListItem ), ( TickType_t ) usIdentifier );
+					vListInsertEnd( &xRequestList, &( pxRequest->xListItem ) );
+					pxRequest->xHasOwner = xWaitForReply;
+					*pxSendRequest = pdTRUE;
+				}
+			}
+			else if( ( xWaitForReply != pdFALSE ) && ( pxRequest->xEventGroup == NULL ) )
+			{
+				/* This is the first task that has to wait for another one, or
+				for the IP-task. */
+				pxRequest->xEventGroup = xEventGroupCreate();
+
+				if( pxRequest->xEventGroup == NULL )
+				{
+					pxRequest = NULL;
+				}
+			}
+
+			if( ( pxRequest != NULL ) && ( xWaitForReply != pdFALSE ) )
+			{
+				pxRequest->uxUsers++;
+			}
 		}
 		xTaskResumeAll();
+
+		return pxRequest;
 	}
+	/*-----------------------------------------------------------*/
 
-#endif	/* ipconfigDNS_USE_CALLBACKS != 0 */
+	static uint32_t prvDNSRunRequest( DNSRequest_t *pxRequest, const char *pcHostName, BaseType_t xWaitForReply, BaseType_t xSendRequest, TickType_t xReadTimeOut_ms )
+	{
+	uint32_t ulIPAddress = 0UL;
+	TickType_t xIdentifier;
+
+		if( xWaitForReply == pdFALSE )
+		{
+			/* pxRequest may already have been answered and freed, it is
+			not read here. */
+			#if( ipconfigDNS_USE_CALLBACKS != 0 )
+			{
+				/* The call-back has been registered, the request is sent
+				without a socket and the reply will be handled by the IP-task,
+				which also repeats the request when needed. */
+				if( xSendRequest != pdFALSE )
+				{
+					if( xIsCallingFromIPTask() != pdFALSE )
+					{
+						prvDNSSendRequests();
+					}
+					else
+					{
+						/* Only the IP-task may look for a free port, let it
+						send the request now.  If the event can not be posted,
+						it is sent when the DNS timer expires. */
+						( void ) xSendEventToIPTask( eDNSTimerEvent );
+					}
+				}
+			}
+			#endif /* ipconfigDNS_USE_CALLBACKS */
+		}
+		else
+		{
+			/* This task is a user, the request stays until it detaches. */
+			xIdentifier = listGET_LIST_ITEM_VALUE( &( pxRequest->xListItem ) );
+
+			if( xSendRequest != pdFALSE )
+			{
+				ulIPAddress = prvGetHostByName( pcHostName, xIdentifier, xReadTimeOut_ms );
+
+				#if( ipconfigDNS_USE_CALLBACKS != 0 )
+				{
+					if( ulIPAddress == 0UL )
+					{
+						/* The call-backs that attached to this look-up don't
+						have to wait for their time-out. */
+						vDNSDoCallback( xIdentifier, pcHostName, 0UL );
+					}
+				}
+				#endif /* ipconfigDNS_USE_CALLBACKS */
+
+				/* Normally already done while parsing the reply. */
+				prvDNSSetRequestResult( xIdentifier, ulIPAddress );
+			}
+			else
+			{
+			TickType_t xWaitTime = portMAX_DELAY;
+
+				#if( ipconfigDNS_USE_CALLBACKS != 0 )
+				{
+					if( pxRequest->xHasOwner == pdFALSE )
+					{
+						/* The IP-task finishes the look-up from the DNS timer,
+						which may not be running if no call-back could be
+						stored. */
+						xWaitTime = ( ipconfigDNS_REQUEST_ATTEMPTS + 1 ) * dnsREQUEST_RESEND_TIME;
+					}
+				}
+				#endif /* ipconfigDNS_USE_CALLBACKS */
+
+				/* An owner always finishes the look-up, successful or not,
+				within its own time-outs. */
+				( void ) xEventGroupWaitBits( pxRequest->xEventGroup, dnsREQUEST_DONE_BIT, pdFALSE, pdFALSE, xWaitTime );
+			}
+
+			vTaskSuspendAll();
+			{
+				ulIPAddress = pxRequest->ulIPAddress;
+				pxRequest->uxUsers--;
+
+				if( ( pxRequest->uxUsers == 0u ) && ( pxRequest->xDone != pdFALSE ) )
+				{
+					prvDNSFreeRequest( pxRequest );
+				}
+			}
+			xTaskResumeAll();
+		}
+
+		return ulIPAddress;
+	}
+	/*-----------------------------------------------------------*/
+
+	static void prvDNSSetRequestResult( TickType_t xIdentifier, uint32_t ulIPAddress )
+	{
+	const ListItem_t *pxIterator;
+	const MiniListItem_t* xEnd = ( const MiniListItem_t* )listGET_END_MARKER( &xRequestList );
+
+		vTaskSuspendAll();
+		{
+			if( listLIST_IS_INITIALISED( &xRequestList ) != pdFALSE )
+			{
+				for( pxIterator  = ( const ListItem_t * ) listGET_NEXT( xEnd );
+					 pxIterator != ( const ListItem_t * ) xEnd;
+					 pxIterator  = ( const ListItem_t * ) listGET_NEXT( pxIterator ) )
+				{
+					DNSRequest_t *pxRequest = ( DNSRequest_t * ) listGET_LIST_ITEM_OWNER( pxIterator );
+
+					if( ( listGET_LIST_ITEM_VALUE( pxIterator ) == xIdentifier ) && ( pxRequest->xDone == pdFALSE ) )
+					{
+						prvDNSCompleteRequest( pxRequest, ulIPAddress );
+						break;
+					}
+				}
+			}
+		}
+		xTaskResumeAll();
+	}
+	/*-----------------------------------------------------------*/
+
+	static void prvDNSCompleteRequest( DNSRequest_t *pxRequest, uint32_t ulIPAddress )
+	{
+		/* Called with the scheduler suspended. */
+		pxRequest->ulIPAddress = ulIPAddress;
+		pxRequest->xDone = pdTRUE;
+
+		if( pxRequest->xEventGroup != NULL )
+		{
+			( void ) xEventGroupSetBits( pxRequest->xEventGroup, dnsREQUEST_DONE_BIT );
+		}
+
+		if( pxRequest->uxUsers == 0u )
+		{
+			/* Only call-backs were waiting. */
+			prvDNSFreeRequest( pxRequest );
+		}
+	}
+	/*-----------------------------------------------------------*/
+
+	static void prvDNSFreeRequest( DNSRequest_t *pxRequest )
+	{
+		/* Called with the scheduler suspended. */
+		( void ) uxListRemove( &( pxRequest->xListItem ) );
+
+		if( pxRequest->xEventGroup != NULL )
+		{
+			vEventGroupDelete( pxRequest->xEventGroup );
+		}
+
+		vPortFree( pxRequest );
+	}
+	/*-----------------------------------------------------------*/
+
+	#if( ipconfigDNS_USE_CALLBACKS != 0 )
+
+		static BaseType_t prvDNSCheckRequests( BaseType_t xSendRequests )
+		{
+		const ListItem_t *pxIterator, *pxCallbackIterator;
+		const MiniListItem_t* xEnd = ( const MiniListItem_t* )listGET_END_MARKER( &xRequestList );
+		const MiniListItem_t* xCallbackEnd = ( const MiniListItem_t* )listGET_END_MARKER( &xCallbackList );
+		TickType_t xNow = xTaskGetTickCount();
+		BaseType_t xPending = pdFALSE;
+
+			vTaskSuspendAll();
+			{
+				if( listLIST_IS_INITIALISED( &xRequestList ) != pdFALSE )
+				{
+					for( pxIterator  = ( const ListItem_t * ) listGET_NEXT( xEnd );
+						 pxIterator != ( const ListItem_t * ) xEnd;
+						  )
+					{
+						DNSRequest_t *pxRequest = ( DNSRequest_t * ) listGET_LIST_ITEM_OWNER( pxIterator );
+						/* Move to the next item because we might remove this item */
+						pxIterator  = ( const ListItem_t * ) listGET_NEXT( pxIterator );
+
+						if( ( pxRequest->xHasOwner != pdFALSE ) || ( pxRequest->xDone != pdFALSE ) )
+						{
+							continue;
+						}
+
+						if( ( pxRequest->uxAttempts >= ipconfigDNS_REQUEST_ATTEMPTS ) &&
+							( ( xNow - pxRequest->xLastSendTime ) >= dnsREQUEST_RESEND_TIME ) )
+						{
+							/* None of the requests was answered.  The
+							call-backs will see their own time-out. */
+							prvDNSCompleteRequest( pxRequest, 0UL );
+							continue;
+						}
+
+						/* Otherwise it is kept for the tasks and call-backs
+						waiting for it.  One that has not been sent yet has just
+						been created. */
+						if( ( pxRequest->uxUsers == 0u ) && ( pxRequest->uxAttempts != 0u ) )
+						{
+							for( pxCallbackIterator  = ( const ListItem_t * ) listGET_NEXT( xCallbackEnd );
+								 pxCallbackIterator != ( const ListItem_t * ) xCallbackEnd;
+								 pxCallbackIterator  = ( const ListItem_t * ) listGET_NEXT( pxCallbackIterator ) )
+							{
+								if( listGET_LIST_ITEM_VALUE( pxCallbackIterator ) == listGET_LIST_ITEM_VALUE( &( pxRequest->xListItem ) ) )
+								{
+									break;
+								}
+							}
+
+							if( pxCallbackIterator == ( const ListItem_t * ) xCallbackEnd )
+							{
+								prvDNSFreeRequest( pxRequest );
+								continue;
+							}
+						}
+
+						xPending = pdTRUE;
+					}
+				}
+			}
+			xTaskResumeAll();
+
+			if( ( xSendRequests != pdFALSE ) && ( xPending != pdFALSE ) )
+			{
+				prvDNSSendRequests();
+			}
+
+			return xPending;
+		}
+		/*-----------------------------------------------------------*/
+
+		static void prvDNSSendRequests( void )
+		{
+		const ListItem_t *pxIterator;
+		const MiniListItem_t* xEnd = ( const MiniListItem_t* )listGET_END_MARKER( &xRequestList );
+		NetworkBufferDescriptor_t *pxNetworkBuffer = NULL;
+		size_t xPayloadLength;
+		uint16_t usPort = 0u;
+		BaseType_t xUseLLMNR = pdFALSE;
+		TickType_t xNow;
+
+			for( ;; )
+			{
+				if( pxNetworkBuffer == NULL )
+				{
+					/* This is called from the IP-task, so a block time must not
+					be used.  A request that can not be sent now will be sent
+					when the DNS timer expires. */
+					pxNetworkBuffer = pxGetNetworkBufferWithDescriptor( sizeof( UDPPacket_t ) + sizeof( DNSMessage_t ) + dnsMAX_REQUEST_NAME_LENGTH + 2u + sizeof( DNSTail_t ), ( TickType_t ) 0 );
+
+					if( pxNetworkBuffer == NULL )
+					{
+						break;
+					}
+				}
+
+				xPayloadLength = 0u;
+				xNow = xTaskGetTickCount();
+
+				vTaskSuspendAll();
+				{
+					for( pxIterator  = ( const ListItem_t * ) listGET_NEXT( xEnd );
+						 pxIterator != ( const ListItem_t * ) xEnd;
+						 pxIterator  = ( const ListItem_t * ) listGET_NEXT( pxIterator ) )
+					{
+						DNSRequest_t *pxRequest = ( DNSRequest_t * ) listGET_LIST_ITEM_OWNER( pxIterator );
+
+						if( ( pxRequest->xHasOwner != pdFALSE ) ||
+							( pxRequest->uxAttempts >= ipconfigDNS_REQUEST_ATTEMPTS ) ||
+							( ( pxRequest->uxAttempts != 0u ) && ( ( xNow - pxRequest->xLastSendTime ) < dnsREQUEST_RESEND_TIME ) ) )
+						{
+							continue;
+						}
+
+						xPayloadLength = prvCreateDNSMessage( pxNetworkBuffer->pucEthernetBuffer + ipUDP_PAYLOAD_OFFSET_IPv4, pxRequest->pcName, listGET_LIST_ITEM_VALUE( pxIterator ) );
+						pxRequest->uxAttempts++;
+						pxRequest->xLastSendTime = xNow;
+
+						/* Every request of a look-up is sent from the same port,
+						so that ulDNSHandlePacket() accepts the reply to any of
+						them. */
+						if( pxRequest->usPort == 0u )
+						{
+							pxRequest->usPort = prvDNSGetFreePort();
+						}
+						usPort = pxRequest->usPort;
+
+						#if( ipconfigUSE_LLMNR == 1 )
+						{
+							xUseLLMNR = ( strchr( pxRequest->pcName, '.' ) == NULL ) ? pdTRUE : pdFALSE;
+						}
+						#endif /* ipconfigUSE_LLMNR */
+						break;
+					}
+				}
+				( void ) xTaskResumeAll();
+
+				if( xPayloadLength == 0u )
+				{
+					break;
+				}
+
+				prvDNSSendWithoutSocket( pxNetworkBuffer, xPayloadLength, usPort, xUseLLMNR );
+				pxNetworkBuffer = NULL;
+			}
+
+			if( pxNetworkBuffer != NULL )
+			{
+				vReleaseNetworkBufferAndDescriptor( pxNetworkBuffer );
+			}
+		}
+
+	#endif /* ipconfigDNS_USE_CALLBACKS */
+
+#endif /* ipconfigDNS_COALESCE_REQUESTS */
 /*-----------------------------------------------------------*/
 
+
 #if( ipconfigDNS_USE_CALLBACKS == 0 )
 uint32_t FreeRTOS_gethostbyname( const char *pcHostName )
 #else
@@ -415,6 +1110,15 @@ uint32_t FreeRTOS_gethostbyname_a( const char *pcHostName, FOnDNSEvent pCallback
 uint32_t ulIPAddress = 0UL;
 TickType_t xReadTimeOut_ms = ipconfigSOCK_DEFAULT_RECEIVE_BLOCK_TIME;
 TickType_t xIdentifier = 0;
+BaseType_t xKnownNegative = pdFALSE;
+#if( ipconfigDNS_COALESCE_REQUESTS != 0 )
+	DNSRequest_t *pxRequest = NULL;
+	BaseType_t xSendRequest = pdFALSE;
+	BaseType_t xWaitForReply = pdTRUE;
+	#if( ipconfigDNS_USE_CALLBACKS != 0 )
+		BaseType_t xCallbackStored = pdFALSE;
+	#endif
+#endif
 
 	/* If the supplied hostname is IP address, convert it to uint32_t
 	and return. */
@@ -430,7 +1134,19 @@ TickType_t xIdentifier = 0;
 	{
 		if( ulIPAddress == 0UL )
 		{
-			ulIPAddress = FreeRTOS_dnslookup( pcHostName );
+			#if( ipconfigUSE_DNS_CACHE_HASH != 0 )
+			{
+				/* The cache may also know that the name does not exist. */
+				if( prvDNSCacheLookup( pcHostName, &ulIPAddress, 1 ) == 0 )
+				{
+					xKnownNegative = pdTRUE;
+				}
+			}
+			#else
+			{
+				ulIPAddress = FreeRTOS_dnslookup( pcHostName );
+			}
+			#endif /* ipconfigUSE_DNS_CACHE_HASH */
 			if( ulIPAddress != 0 )
 			{
 				FreeRTOS_debug_printf( ( "FreeRTOS_gethostbyname: found '%s' in cache: %lxip\n", pcHostName, ulIPAddress ) );
@@ -444,9 +1160,70 @@ TickType_t xIdentifier = 0;
 	#endif /* ipconfigUSE_DNS_CACHE == 1 */
 
 	/* Generate a unique identifier. */
-	if( 0 == ulIPAddress )
+	if( ( 0 == ulIPAddress ) && ( xKnownNegative == pdFALSE ) )
 	{
-		xIdentifier = ( TickType_t )ipconfigRAND32( );
+		#if( ipconfigDNS_COALESCE_REQUESTS != 0 )
+		{
+			#if( ipconfigDNS_USE_CALLBACKS != 0 )
+			{
+				if( pCallback != NULL )
+				{
+					xWaitForReply = pdFALSE;
+				}
+			}
+			#endif /* ipconfigDNS_USE_CALLBACKS */
+
+			/* Use the identifier of a look-up of the same name which is
+			already in progress, or start a new one.  The reply to a look-up in
+			progress may come in at any moment, so a call-back is stored in the
+			same critical section: the look-up can not be completed before its
+			call-back is in the list.  The request itself may be freed as soon
+			as the scheduler is resumed. */
+			vTaskSuspendAll();
+			{
+				pxRequest = prvDNSAttachRequest( pcHostName, xWaitForReply, &xSendRequest );
+
+				#if( ipconfigUSE_DNS_CACHE == 1 )
+				{
+					if( ( pxRequest != NULL ) && ( xSendRequest != pdFALSE ) )
+					{
+						/* A look-up of the same name may have been answered
+						after the cache was checked above.  Nobody can have
+						attached to the new one yet. */
+						ulIPAddress = FreeRTOS_dnslookup( pcHostName );
+
+						if( ulIPAddress != 0UL )
+						{
+							prvDNSFreeRequest( pxRequest );
+							pxRequest = NULL;
+						}
+					}
+				}
+				#endif /* ipconfigUSE_DNS_CACHE == 1 */
+
+				if( pxRequest != NULL )
+				{
+					xIdentifier = listGET_LIST_ITEM_VALUE( &( pxRequest->xListItem ) );
+
+					#if( ipconfigDNS_USE_CALLBACKS != 0 )
+					{
+						if( pCallback != NULL )
+						{
+							vDNSSetCallBack( pcHostName, pvSearchID, pCallback, xTimeout, xIdentifier );
+							xCallbackStored = pdTRUE;
+						}
+					}
+					#endif /* ipconfigDNS_USE_CALLBACKS */
+				}
+			}
+			( void ) xTaskResumeAll();
+		}
+		#endif /* ipconfigDNS_COALESCE_REQUESTS */
+
+		if( xIdentifier == 0 )
+		{
+			xIdentifier = ( TickType_t )ipconfigRAND32( );
+		}
 	}
 
 	#if( ipconfigDNS_USE_CALLBACKS != 0 )
@@ -459,7 +1236,17 @@ TickType_t xIdentifier = 0;
 				if( 0 != xIdentifier )
 				{
 					xReadTimeOut_ms = 0;
-					vDNSSetCallBack( pcHostName, pvSearchID, pCallback, xTimeout, ( TickType_t )xIdentifier );
+					#if( ipconfigDNS_COALESCE_REQUESTS != 0 )
+					if( xCallbackStored == pdFALSE )
+					#endif
+					{
+						vDNSSetCallBack( pcHostName, pvSearchID, pCallback, xTimeout, ( TickType_t )xIdentifier );
+					}
+				}
+				else if( xKnownNegative != pdFALSE )
+				{
+					/* The name is known not to exist, do the call-back now. */
+					pCallback( pcHostName, pvSearchID, 0UL );
 				}
 			}
 			else
@@ -473,7 +1260,16 @@ TickType_t xIdentifier = 0;
 
 	if( ( ulIPAddress == 0UL ) && ( 0 != xIdentifier ) )
 	{
-		ulIPAddress = prvGetHostByName( pcHostName, xIdentifier, xReadTimeOut_ms );
+#if( ipconfigDNS_COALESCE_REQUESTS != 0 )
+		if( pxRequest != NULL )
+		{
+			ulIPAddress = prvDNSRunRequest( pxRequest, pcHostName, xWaitForReply, xSendRequest, xReadTimeOut_ms );
+		}
+		else
+#endif /* ipconfigDNS_COALESCE_REQUESTS */
+		{
+			ulIPAddress = prvGetHostByName( pcHostName, xIdentifier, xReadTimeOut_ms );
+		}
 	}
 
 	return ulIPAddress;
@@ -485,6 +1281,7 @@ static uint32_t prvGetHostByName( const char *pcHostName, TickType_t xIdentifier
 struct freertos_sockaddr xAddress;
 Socket_t xDNSSocket;
 uint32_t ulIPAddress = 0UL;
+uint32_t ulDNSServer = 0UL;
 uint8_t *pucUDPPayloadBuffer;
 uint32_t ulAddressLength = sizeof( struct freertos_sockaddr );
 BaseType_t xAttempt;
@@ -523,6 +1320,16 @@ TickType_t xWriteTimeOut_ms = ipconfigSOCK_DEFAULT_SEND_BLOCK_TIME;
 		FreeRTOS_setsockopt( xDNSSocket, 0, FREERTOS_SO_SNDTIMEO, ( void * ) &xWriteTimeOut_ms, sizeof( TickType_t ) );
 		FreeRTOS_setsockopt( xDNSSocket, 0, FREERTOS_SO_RCVTIMEO, ( void * ) &xReadTimeOut_ms,  sizeof( TickType_t ) );
 
+		#if( ipconfigDNS_USE_CALLBACKS != 0 )
+		{
+			if( xReadTimeOut_ms == 0u )
+			{
+				/* The reply will come in after the socket has been closed. */
+				prvDNSSetCallBackPort( xIdentifier, FreeRTOS_htons( ( ( FreeRTOS_Socket_t * ) xDNSSocket )->usLocalPort ) );
+			}
+		}
+		#endif /* ipconfigDNS_USE_CALLBACKS */
+
 		for( xAttempt = 0; xAttempt < ipconfigDNS_REQUEST_ATTEMPTS; xAttempt++ )
 		{
 			/* Get a buffer.  This uses a maximum delay, but the delay will be
@@ -538,7 +1345,8 @@ TickType_t xWriteTimeOut_ms = ipconfigSOCK_DEFAULT_SEND_BLOCK_TIME;
 				iptraceSENDING_DNS_REQUEST();
 
 				/* Obtain the DNS server address. */
-				FreeRTOS_GetAddressConfiguration( NULL, NULL, NULL, &ulIPAddress );
+				FreeRTOS_GetAddressConfiguration( NULL, NULL, NULL, &ulDNSServer );
+				ulIPAddress = ulDNSServer;
 
 				/* Send the DNS message. */
 #if( ipconfigUSE_LLMNR == 1 )
@@ -566,8 +1374,20 @@ TickType_t xWriteTimeOut_ms = ipconfigSOCK_DEFAULT_SEND_BLOCK_TIME;
 
 					if( lBytes > 0 )
 					{
-						/* The reply was received.  Process it. */
-						ulIPAddress = prvParseDNSReply( pucUDPPayloadBuffer, lBytes, xIdentifier );
+						/* The reply was received.  Process it, unless it comes
+						from another host than the DNS server. */
+#if( ipconfigUSE_LLMNR == 1 )
+						if( bHasDot == pdFALSE )
+						{
+							/* Any host on the link may answer an LLMNR request. */
+							ulIPAddress = prvParseDNSReply( pucUDPPayloadBuffer, lBytes, xIdentifier );
+						}
+						else
+#endif
+						if( xAddress.sin_addr == ulDNSServer )
+						{
+							ulIPAddress = prvParseDNSReply( pucUDPPayloadBuffer, lBytes, xIdentifier );
+						}
 
 						/* Finished with the buffer.  The zero copy interface
 						is being used, so the buffer must be freed by the
@@ -579,6 +1399,17 @@ TickType_t xWriteTimeOut_ms = ipconfigSOCK_DEFAULT_SEND_BLOCK_TIME;
 							/* All done. */
 							break;
 						}
+
+						#if( ipconfigUSE_DNS_CACHE_HASH != 0 )
+						{
+							/* The reply may have said that the name does not
+							exist, there is no need to ask again. */
+							if( prvDNSCacheLookup( pcHostName, &ulIPAddress, 1 ) >= 0 )
+							{
+								break;
+							}
+						}
+						#endif /* ipconfigUSE_DNS_CACHE_HASH */
 					}
 				}
 				else
@@ -809,19 +1640,42 @@ static uint8_t *prvSkipNameField( uint8_t *pucByte, size_t xSourceLen )
 
 uint32_t ulDNSHandlePacket( NetworkBufferDescriptor_t *pxNetworkBuffer )
 {
+UDPPacket_t *pxUDPPacket = ( UDPPacket_t * ) pxNetworkBuffer->pucEthernetBuffer;
 uint8_t *pucUDPPayloadBuffer;
 size_t xPlayloadBufferLength;
 DNSMessage_t *pxDNSMessageHeader;
 
-	xPlayloadBufferLength = pxNetworkBuffer->xDataLength - sizeof( UDPPacket_t );
-	if ( xPlayloadBufferLength < sizeof( DNSMessage_t ) )
+	if( pxNetworkBuffer->xDataLength < sizeof( UDPPacket_t ) + sizeof( DNSMessage_t ) )
 	{
 		return pdFAIL;
 	}
 
+	xPlayloadBufferLength = pxNetworkBuffer->xDataLength - sizeof( UDPPacket_t );
+
 	pucUDPPayloadBuffer = pxNetworkBuffer->pucEthernetBuffer + sizeof( UDPPacket_t );
 	pxDNSMessageHeader = ( DNSMessage_t * ) pucUDPPayloadBuffer;
 
+	if( ( pxDNSMessageHeader->usFlags & dnsRX_FLAGS_RESPONSE ) != 0u )
+	{
+		/* A reply is only read when it answers a request of this node: it
+		must come from the DNS server (LLMNR replies may come from any host on
+		the link), and carry the identifier of a request and come in on the
+		port it was sent from.  Otherwise anyone could fill the cache, or have a
+		name cached as non-existent. */
+		if( ( ( pxUDPPacket->xUDPHeader.usSourcePort == dnsDNS_PORT ) &&
+			  ( pxUDPPacket->xIPHeader.ulSourceIPAddress != FreeRTOS_GetDNSServerAddress() ) ) ||
+			( prvDNSReplyIsExpected( pxDNSMessageHeader->usIdentifier, pxUDPPacket->xUDPHeader.usDestinationPort ) == pdFALSE ) )
+		{
+			iptraceDNS_REPLY_DROPPED( pxUDPPacket->xIPHeader.ulSourceIPAddress );
+			return pdFAIL;
+		}
+	}
+	else if( pxUDPPacket->xUDPHeader.usSourcePort == dnsDNS_PORT )
+	{
+		/* Only LLMNR requests are answered. */
+		return pdFAIL;
+	}
+
 	if( pxNetworkBuffer->xDataLength > sizeof( UDPPacket_t ) )
 	{
 		prvParseDNSReply( pucUDPPayloadBuffer,
@@ -834,6 +1688,86 @@ DNSMessage_t *pxDNSMessageHeader;
 }
 /*-----------------------------------------------------------*/
 
+static BaseType_t prvDNSReplyIsExpected( uint16_t usIdentifier, uint16_t usPort )
+{
+BaseType_t xReturn = pdFALSE;
+
+	( void ) usIdentifier;
+	( void ) usPort;
+
+	vTaskSuspendAll();
+	{
+		#if( ipconfigUSE_DNS_CACHE_HASH != 0 )
+		{
+		BaseType_t x;
+
+			/* A refresh of a cached name, sent by vDNSCheckCache(). */
+			for( x = 0; x < ipconfigDNS_CACHE_ENTRIES; x++ )
+			{
+				if( ( ( xDNSCache[ x ].ucFlags & dnsCACHE_REFRESHING ) != 0u ) &&
+					( xDNSCache[ x ].usRefreshIdentifier == usIdentifier ) &&
+					( xDNSCache[ x ].usRefreshPort == usPort ) )
+				{
+					xReturn = pdTRUE;
+					break;
+				}
+			}
+		}
+		#endif /* ipconfigUSE_DNS_CACHE_HASH */
+
+		#if( ipconfigDNS_USE_CALLBACKS != 0 )
+		{
+		const ListItem_t *pxIterator;
+		const MiniListItem_t* xEnd = ( const MiniListItem_t* )listGET_END_MARKER( &xCallbackList );
+
+			/* A look-up with a call-back, of which the socket has been closed. */
+			for( pxIterator  = ( const ListItem_t * ) listGET_NEXT( xEnd );
+				 ( pxIterator != ( const ListItem_t * ) xEnd ) && ( xReturn == pdFALSE );
+				 pxIterator  = ( const ListItem_t * ) listGET_NEXT( pxIterator ) )
+			{
+				DNSCallback_t *pxCallback = ( DNSCallback_t * ) listGET_LIST_ITEM_OWNER( pxIterator );
+
+				if( ( listGET_LIST_ITEM_VALUE( pxIterator ) == ( TickType_t ) usIdentifier ) &&
+					( pxCallback->usPort == usPort ) && ( usPort != 0u ) )
+				{
+					xReturn = pdTRUE;
+				}
+			}
+		}
+		#endif /* ipconfigDNS_USE_CALLBACKS */
+
+		#if( ipconfigDNS_COALESCE_REQUESTS != 0 ) && ( ipconfigDNS_USE_CALLBACKS != 0 )
+		{
+		const ListItem_t *pxIterator;
+		const MiniListItem_t* xEnd = ( const MiniListItem_t* )listGET_END_MARKER( &xRequestList );
+
+			/* A look-up without owner, of which the IP-task sends the
+			requests. */
+			if( listLIST_IS_INITIALISED( &xRequestList ) != pdFALSE )
+			{
+				for( pxIterator  = ( const ListItem_t * ) listGET_NEXT( xEnd );
+					 ( pxIterator != ( const ListItem_t * ) xEnd ) && ( xReturn == pdFALSE );
+					 pxIterator  = ( const ListItem_t * ) listGET_NEXT( pxIterator ) )
+				{
+					DNSRequest_t *pxRequest = ( DNSRequest_t * ) listGET_LIST_ITEM_OWNER( pxIterator );
+
+					if( ( listGET_LIST_ITEM_VALUE( pxIterator ) == ( TickType_t ) usIdentifier ) &&
+						( pxRequest->xHasOwner == pdFALSE ) && ( pxRequest->xDone == pdFALSE ) &&
+						( pxRequest->usPort == usPort ) && ( usPort != 0u ) )
+					{
+						xReturn = pdTRUE;
+					}
+				}
+			}
+		}
+		#endif /* ipconfigDNS_COALESCE_REQUESTS && ipconfigDNS_USE_CALLBACKS */
+	}
+	( void ) xTaskResumeAll();
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
 #if( ipconfigUSE_NBNS == 1 )
 
 	uint32_t ulNBNSHandlePacket (NetworkBufferDescriptor_t *pxNetworkBuffer )
@@ -872,6 +1806,11 @@ uint16_t x, usDataLength, usQuestions;
 #if( ipconfigUSE_DNS_CACHE == 1 )
 	char pcName[ ipconfigDNS_CACHE_NAME_LENGTH ] = "";
 #endif
+#if( ipconfigUSE_DNS_CACHE_HASH != 0 )
+	uint32_t ulAddresses[ ipconfigDNS_CACHE_ADDRESSES_PER_ENTRY ];
+	BaseType_t xAddressCount = 0;
+	uint32_t ulTTL = 0UL;
+#endif
 
 	/* Ensure that the buffer is of at least minimal DNS message length. */
 	if( xBufferLength < sizeof( DNSMessage_t ) )
@@ -994,26 +1933,54 @@ uint16_t x, usDataLength, usQuestions;
 					/* Sanity check the data length of an IPv4 answer. */
 					if( FreeRTOS_ntohs( pxDNSAnswerRecord->usDataLength ) == sizeof( uint32_t ) )
 					{
-						/* Copy the IP address out of the record. */
-						memcpy( &ulIPAddress,
-								pucByte + sizeof( DNSAnswerRecord_t ),
-								sizeof( uint32_t ) );
-
-						#if( ipconfigUSE_DNS_CACHE == 1 )
+						#if( ipconfigUSE_DNS_CACHE_HASH != 0 )
 						{
-							prvProcessDNSCache( pcName, &ulIPAddress, pxDNSAnswerRecord->ulTTL, pdFALSE );
+							/* Collect the addresses, they are cached together
+							with the smallest of their TTL's. */
+							memcpy( &( ulAddresses[ xAddressCount ] ),
+									pucByte + sizeof( DNSAnswerRecord_t ),
+									sizeof( uint32_t ) );
+
+							if( ( xAddressCount == 0 ) || ( FreeRTOS_ntohl( pxDNSAnswerRecord->ulTTL ) < ulTTL ) )
+							{
+								ulTTL = FreeRTOS_ntohl( pxDNSAnswerRecord->ulTTL );
+							}
+							xAddressCount++;
 						}
-						#endif /* ipconfigUSE_DNS_CACHE */
-						#if( ipconfigDNS_USE_CALLBACKS != 0 )
+						#else
 						{
-							/* See if any asynchronous call was made to FreeRTOS_gethostbyname_a() */
-							vDNSDoCallback( ( TickType_t ) pxDNSMessageHeader->usIdentifier, pcName, ulIPAddress );
+							/* Copy the IP address out of the record. */
+							memcpy( &ulIPAddress,
+									pucByte + sizeof( DNSAnswerRecord_t ),
+									sizeof( uint32_t ) );
+
+							#if( ipconfigUSE_DNS_CACHE == 1 )
+							{
+								prvProcessDNSCache( pcName, &ulIPAddress, pxDNSAnswerRecord->ulTTL, pdFALSE );
+							}
+							#endif /* ipconfigUSE_DNS_CACHE */
+							#if( ipconfigDNS_USE_CALLBACKS != 0 )
+							{
+								/* See if any asynchronous call was made to FreeRTOS_gethostbyname_a() */
+								vDNSDoCallback( ( TickType_t ) pxDNSMessageHeader->usIdentifier, pcName, ulIPAddress );
+							}
+							#endif	/* ipconfigDNS_USE_CALLBACKS != 0 */
 						}
-						#endif	/* ipconfigDNS_USE_CALLBACKS != 0 */
+						#endif /* ipconfigUSE_DNS_CACHE_HASH */
 					}
 
 					pucByte += sizeof( DNSAnswerRecord_t ) + sizeof( uint32_t );
 					xSourceBytesRemaining -= ( sizeof( DNSAnswerRecord_t ) + sizeof( uint32_t ) );
+
+					#if( ipconfigUSE_DNS_CACHE_HASH != 0 )
+					{
+						if( xAddressCount < ipconfigDNS_CACHE_ADDRESSES_PER_ENTRY )
+						{
+							/* Look for more addresses. */
+							continue;
+						}
+					}
+					#endif /* ipconfigUSE_DNS_CACHE_HASH */
 					break;
 				}
 				else if( xSourceBytesRemaining >= sizeof( DNSAnswerRecord_t ) )
@@ -1040,7 +2007,41 @@ uint16_t x, usDataLength, usQuestions;
 					}
 				}
 			}
+
+			#if( ipconfigUSE_DNS_CACHE_HASH != 0 )
+			{
+				if( xAddressCount != 0 )
+				{
+					ulIPAddress = ulAddresses[ 0 ];
+					prvDNSCacheStore( pcName, ulAddresses, xAddressCount, ulTTL );
+				}
+				else
+				{
+					/* The name exists, but it has no address: remember that
+					for a while. */
+					prvDNSCacheStore( pcName, NULL, 0, prvReadNegativeTTL( pucByte, xSourceBytesRemaining, 0u, FreeRTOS_ntohs( pxDNSMessageHeader->usAuthorityRRs ) ) );
+				}
+				#if( ipconfigDNS_USE_CALLBACKS != 0 )
+				{
+					/* See if any asynchronous call was made to FreeRTOS_gethostbyname_a() */
+					vDNSDoCallback( ( TickType_t ) pxDNSMessageHeader->usIdentifier, pcName, ulIPAddress );
+				}
+				#endif	/* ipconfigDNS_USE_CALLBACKS != 0 */
+			}
+			#endif /* ipconfigUSE_DNS_CACHE_HASH */
+		}
+#if( ipconfigUSE_DNS_CACHE_HASH != 0 )
+		else if( ( pxDNSMessageHeader->usFlags & dnsRX_FLAGS_MASK ) == dnsNXDOMAIN_RX_FLAGS )
+		{
+			/* The name does not exist: remember that for a while. */
+			prvDNSCacheStore( pcName, NULL, 0, prvReadNegativeTTL( pucByte, xSourceBytesRemaining, pxDNSMessageHeader->usAnswers, FreeRTOS_ntohs( pxDNSMessageHeader->usAuthorityRRs ) ) );
+			#if( ipconfigDNS_USE_CALLBACKS != 0 )
+			{
+				vDNSDoCallback( ( TickType_t ) pxDNSMessageHeader->usIdentifier, pcName, 0UL );
+			}
+			#endif	/* ipconfigDNS_USE_CALLBACKS != 0 */
 		}
+#endif /* ipconfigUSE_DNS_CACHE_HASH */
 #if( ipconfigUSE_LLMNR == 1 )
 		else if( usQuestions && ( usType == dnsTYPE_A_HOST ) && ( usClass == dnsCLASS_IN ) )
 		{
@@ -1180,7 +2181,15 @@ uint16_t x, usDataLength, usQuestions;
 				{
 					/* If this is a response from another device,
 					add the name to the DNS cache */
-					prvProcessDNSCache( ( char * ) ucNBNSName, &ulIPAddress, 0, pdFALSE );
+					#if( ipconfigUSE_DNS_CACHE_HASH != 0 )
+					{
+						prvDNSCacheStore( ( char * ) ucNBNSName, &ulIPAddress, 1, dnsNBNS_TTL_VALUE );
+					}
+					#else
+					{
+						prvProcessDNSCache( ( char * ) ucNBNSName, &ulIPAddress, 0, pdFALSE );
+					}
+					#endif /* ipconfigUSE_DNS_CACHE_HASH */
 				}
 			}
 			#else
@@ -1334,7 +2343,57 @@ TickType_t xTimeoutTime = pdMS_TO_TICKS( 200 );
 #endif /* ipconfigUSE_NBNS == 1 || ipconfigUSE_LLMNR == 1 */
 /*-----------------------------------------------------------*/
 
-#if( ipconfigUSE_DNS_CACHE == 1 )
+#if( ipconfigUSE_DNS_CACHE_HASH != 0 ) || ( ( ipconfigDNS_COALESCE_REQUESTS != 0 ) && ( ipconfigDNS_USE_CALLBACKS != 0 ) )
+
+	static uint16_t prvDNSGetFreePort( void )
+	{
+	uint16_t usPort;
+
+		/* This runs in the IP-task, the only task that reads or changes the
+		list of bound sockets. */
+		do
+		{
+			usPort = FreeRTOS_htons( ( uint16_t ) ( ipconfigRAND32() | 0xC000uL ) );
+		} while( pxUDPSocketLookup( ( UBaseType_t ) usPort ) != NULL );
+
+		return usPort;
+	}
+	/*-----------------------------------------------------------*/
+
+	static void prvDNSSendWithoutSocket( NetworkBufferDescriptor_t *pxNetworkBuffer, size_t xPayloadLength, uint16_t usPort, BaseType_t xUseLLMNR )
+	{
+	uint32_t ulDNSServer;
+
+#if( ipconfigUSE_LLMNR == 1 )
+		if( xUseLLMNR != pdFALSE )
+		{
+			/* A name without a dot is looked up with LLMNR. */
+			( ( DNSMessage_t * ) ( pxNetworkBuffer->pucEthernetBuffer + ipUDP_PAYLOAD_OFFSET_IPv4 ) )->usFlags = 0;
+			pxNetworkBuffer->ulIPAddress = ipLLMNR_IP_ADDR;
+			pxNetworkBuffer->usPort = FreeRTOS_ntohs( ipLLMNR_PORT );
+		}
+		else
+#endif /* ipconfigUSE_LLMNR */
+		{
+			( void ) xUseLLMNR;
+			FreeRTOS_GetAddressConfiguration( NULL, NULL, NULL, &ulDNSServer );
+			pxNetworkBuffer->ulIPAddress = ulDNSServer;
+			pxNetworkBuffer->usPort = dnsDNS_PORT;
+		}
+
+		pxNetworkBuffer->usBoundPort = usPort;
+		pxNetworkBuffer->xDataLength = xPayloadLength;
+		pxNetworkBuffer->pucEthernetBuffer[ ipSOCKET_OPTIONS_OFFSET ] = FREERTOS_SO_UDPCKSUM_OUT;
+
+		iptraceSENDING_DNS_REQUEST();
+
+		vProcessGeneratedUDPPacket( pxNetworkBuffer );
+	}
+
+#endif /* ipconfigUSE_DNS_CACHE_HASH || ( ipconfigDNS_COALESCE_REQUESTS && ipconfigDNS_USE_CALLBACKS ) */
+/*-----------------------------------------------------------*/
+
+#if( ipconfigUSE_DNS_CACHE == 1 ) && ( ipconfigUSE_DNS_CACHE_HASH == 0 )
 
 	static void prvProcessDNSCache( const char *pcName, uint32_t *pulIP, uint32_t ulTTL, BaseType_t xLookUp )
 	{
@@ -1343,7 +2402,174 @@ TickType_t xTimeoutTime = pdMS_TO_TICKS( 200 );
 	uint32_t ulCurrentTimeSeconds = ( xTaskGetTickCount() / portTICK_PERIOD_MS ) / 1000;
 	static BaseType_t xFreeEntry = 0;
 
-		/* For each entry in the DNS cache table. */
+		/* Tasks look up names while the IP-task stores the replies. */
+		vTaskSuspendAll();
+		{
+			/* For each entry in the DNS cache table. */
+			for( x = 0; x < ipconfigDNS_CACHE_ENTRIES; x++ )
+			{
+				if( xDNSCache[ x ].pcName[ 0 ] == 0 )
+				{
+					break;
+				}
+
+				if( 0 == strcmp( xDNSCache[ x ].pcName, pcName ) )
+				{
+					/* Is this function called for a lookup or to add/update an IP address? */
+					if( xLookUp != pdFALSE )
+					{
+						/* Confirm that the record is still fresh. */
+						if( ulCurrentTimeSeconds < ( xDNSCache[ x ].ulTimeWhenAddedInSeconds + FreeRTOS_ntohl( xDNSCache[ x ].ulTTL ) ) )
+						{
+							*pulIP = xDNSCache[ x ].ulIPAddress;
+						}
+						else
+						{
+							/* Age out the old cached record. */
+							xDNSCache[ x ].pcName[ 0 ] = 0;
+						}
+					}
+					else
+					{
+						xDNSCache[ x ].ulIPAddress = *pulIP;
+						xDNSCache[ x ].ulTTL = ulTTL;
+						xDNSCache[ x ].ulTimeWhenAddedInSeconds = ulCurrentTimeSeconds;
+					}
+
+					xFound = pdTRUE;
+					break;
+				}
+			}
+
+			if( xFound == pdFALSE )
+			{
+				if( xLookUp != pdFALSE )
+				{
+					*pulIP = 0;
+				}
+				else
+				{
+					/* Add or update the item. */
+					if( strlen( pcName ) < ipconfigDNS_CACHE_NAME_LENGTH )
+					{
+						strcpy( xDNSCache[ xFreeEntry ].pcName, pcName );
+
+						xDNSCache[ xFreeEntry ].ulIPAddress = *pulIP;
+						xDNSCache[ xFreeEntry ].ulTTL = ulTTL;
+						xDNSCache[ xFreeEntry ].ulTimeWhenAddedInSeconds = ulCurrentTimeSeconds;
+
+						xFreeEntry++;
+						if( xFreeEntry == ipconfigDNS_CACHE_ENTRIES )
+						{
+							xFreeEntry = 0;
+						}
+					}
+				}
+			}
+		}
+		xTaskResumeAll();
+
+		if( ( xLookUp == 0 ) || ( *pulIP != 0 ) )
+		{
+			FreeRTOS_debug_printf( ( "prvProcessDNSCache: %s: '%s' @ %lxip\n", xLookUp ? "look-up" : "add", pcName, FreeRTOS_ntohl( *pulIP ) ) );
+		}
+	}
+
+#endif /* ipconfigUSE_DNS_CACHE == 1 && ipconfigUSE_DNS_CACHE_HASH == 0 */
+/*-----------------------------------------------------------*/
+
+#if( ipconfigUSE_DNS_CACHE_HASH != 0 )
+
+	static uint32_t prvDNSHash( const char *pcName )
+	{
+	uint32_t ulHash = 0x811C9DC5uL;
+
+		while( *pcName != '\0' )
+		{
+			ulHash ^= ( uint8_t ) *( pcName++ );
+			ulHash *= 0x01000193uL;
+		}
+
+		return ulHash;
+	}
+	/*-----------------------------------------------------------*/
+
+	static BaseType_t prvDNSCacheFind( const char *pcName, uint32_t ulHash )
+	{
+	UBaseType_t uxSlot;
+	uint16_t usRow;
+	BaseType_t xReturn = -1;
+
+		/* The table always has more slots than rows, so an empty slot ends the
+		search. */
+		for( uxSlot = dnsHASH_SLOT( ulHash ); ; uxSlot = ( uxSlot + 1u ) & ( ipconfigDNS_CACHE_HASH_SLOTS - 1u ) )
+		{
+			usRow = usDNSHashTable[ uxSlot ];
+
+			if( usRow == 0u )
+			{
+				break;
+			}
+
+			if( ( xDNSCache[ usRow - 1u ].ulHash == ulHash ) && ( strcmp( xDNSCache[ usRow - 1u ].pcName, pcName ) == 0 ) )
+			{
+				xReturn = ( BaseType_t ) usRow - 1;
+				break;
+			}
+		}
+
+		return xReturn;
+	}
+	/*-----------------------------------------------------------*/
+
+	static void prvDNSRemoveRow( BaseType_t x )
+	{
+	UBaseType_t uxHole, uxSlot, uxHome;
+	uint16_t usRow;
+
+		/* Find the slot of the row. */
+		uxHole = dnsHASH_SLOT( xDNSCache[ x ].ulHash );
+		while( usDNSHashTable[ uxHole ] != ( uint16_t ) ( x + 1 ) )
+		{
+			uxHole = ( uxHole + 1u ) & ( ipconfigDNS_CACHE_HASH_SLOTS - 1u );
+		}
+
+		/* Empty the slot without leaving a marker: move the following entries
+		of the probe sequence back into the hole when their home slot allows
+		it. */
+		usDNSHashTable[ uxHole ] = 0u;
+		uxSlot = uxHole;
+		for( ;; )
+		{
+			uxSlot = ( uxSlot + 1u ) & ( ipconfigDNS_CACHE_HASH_SLOTS - 1u );
+			usRow = usDNSHashTable[ uxSlot ];
+
+			if( usRow == 0u )
+			{
+				break;
+			}
+
+			uxHome = dnsHASH_SLOT( xDNSCache[ usRow - 1u ].ulHash );
+
+			/* The entry can move if its home slot is not between the hole and
+			its current slot (cyclically). */
+			if( ( ( uxSlot - uxHome ) & ( ipconfigDNS_CACHE_HASH_SLOTS - 1u ) ) >= ( ( uxSlot - uxHole ) & ( ipconfigDNS_CACHE_HASH_SLOTS - 1u ) ) )
+			{
+				usDNSHashTable[ uxHole ] = usRow;
+				usDNSHashTable[ uxSlot ] = 0u;
+				uxHole = uxSlot;
+			}
+		}
+
+		memset( &xDNSCache[ x ], '\0', sizeof( xDNSCache[ x ] ) );
+	}
+	/*-----------------------------------------------------------*/
+
+	static BaseType_t prvDNSAllocateRow( uint32_t ulNow )
+	{
+	BaseType_t x, xVictim = 0;
+	int32_t lLeft, lVictimLeft = 0;
+
 		for( x = 0; x < ipconfigDNS_CACHE_ENTRIES; x++ )
 		{
 			if( xDNSCache[ x ].pcName[ 0 ] == 0 )
@@ -1351,67 +2577,299 @@ TickType_t xTimeoutTime = pdMS_TO_TICKS( 200 );
 				break;
 			}
 
-			if( 0 == strcmp( xDNSCache[ x ].pcName, pcName ) )
+			/* The number of seconds that this entry is still valid. */
+			lLeft = ( int32_t ) ( xDNSCache[ x ].ulTimeWhenAddedInSeconds + xDNSCache[ x ].ulTTL - ulNow );
+			if( ( x == 0 ) || ( lLeft < lVictimLeft ) )
 			{
-				/* Is this function called for a lookup or to add/update an IP address? */
-				if( xLookUp != pdFALSE )
+				xVictim = x;
+				lVictimLeft = lLeft;
+			}
+		}
+
+		if( x == ipconfigDNS_CACHE_ENTRIES )
+		{
+			/* The cache is full: drop the entry that expires first. */
+			x = xVictim;
+			prvDNSRemoveRow( x );
+		}
+
+		return x;
+	}
+	/*-----------------------------------------------------------*/
+
+	static void prvDNSScheduleRefresh( uint32_t ulDue, uint32_t ulNow )
+	{
+	uint32_t ulDelay;
+
+		if( ( xDNSRefreshScheduled == pdFALSE ) || ( ( int32_t ) ( ulDue - ulDNSNextRefresh ) < 0 ) )
+		{
+			if( ( int32_t ) ( ulDue - ulNow ) > 0 )
+			{
+				ulDelay = FreeRTOS_min_uint32( ulDue - ulNow, dnsMAX_REFRESH_DELAY );
+			}
+			else
+			{
+				ulDelay = 0uL;
+			}
+
+			ulDNSNextRefresh = ulNow + ulDelay;
+			xDNSRefreshScheduled = pdTRUE;
+			vIPReloadDNSCacheTimer( ( TickType_t ) ( ulDelay * configTICK_RATE_HZ ) );
+		}
+	}
+	/*-----------------------------------------------------------*/
+
+	static BaseType_t prvDNSCacheLookup( const char *pcName, uint32_t *pulAddresses, BaseType_t xMaxCount )
+	{
+	BaseType_t x, xIndex, xReturn = -1;
+	uint32_t ulHash = prvDNSHash( pcName );
+	uint32_t ulNow = dnsSECONDS_NOW();
+	DNSCacheRow_t *pxRow;
+
+		vTaskSuspendAll();
+		{
+			x = prvDNSCacheFind( pcName, ulHash );
+
+			if( x >= 0 )
+			{
+				pxRow = &( xDNSCache[ x ] );
+
+				/* Confirm that the record is still fresh. */
+				if( ( ulNow - pxRow->ulTimeWhenAddedInSeconds ) < pxRow->ulTTL )
 				{
-					/* Confirm that the record is still fresh. */
-					if( ulCurrentTimeSeconds < ( xDNSCache[ x ].ulTimeWhenAddedInSeconds + FreeRTOS_ntohl( xDNSCache[ x ].ulTTL ) ) )
+					/* Hand out the addresses in turn. */
+					for( xIndex = 0; ( xIndex < ( BaseType_t ) pxRow->ucNumIPAddresses ) && ( xIndex < xMaxCount ); xIndex++ )
 					{
-						*pulIP = xDNSCache[ x ].ulIPAddress;
+						pulAddresses[ xIndex ] = pxRow->ulIPAddresses[ ( pxRow->ucCurrentIPAddress + xIndex ) % pxRow->ucNumIPAddresses ];
 					}
-					else
+					xReturn = xIndex;
+
+					if( pxRow->ucNumIPAddresses != 0u )
+					{
+						pxRow->ucCurrentIPAddress = ( uint8_t ) ( ( pxRow->ucCurrentIPAddress + 1u ) % pxRow->ucNumIPAddresses );
+
+						/* The first look-up makes the entry worth a refresh. */
+						if( ( pxRow->ucFlags & dnsCACHE_USED ) == 0u )
+						{
+							pxRow->ucFlags |= dnsCACHE_USED;
+
+							if( dnsREFRESH_LEAD( pxRow->ulTTL ) != 0uL )
+							{
+								prvDNSScheduleRefresh( pxRow->ulTimeWhenAddedInSeconds + pxRow->ulTTL - dnsREFRESH_LEAD( pxRow->ulTTL ), ulNow );
+							}
+						}
+					}
+				}
+				else
+				{
+					/* Age out the old cached record. */
+					prvDNSRemoveRow( x );
+				}
+			}
+		}
+		( void ) xTaskResumeAll();
+
+		if( xReturn > 0 )
+		{
+			FreeRTOS_debug_printf( ( "prvDNSCacheLookup: '%s' @ %lxip\n", pcName, FreeRTOS_ntohl( pulAddresses[ 0 ] ) ) );
+		}
+
+		return xReturn;
+	}
+	/*-----------------------------------------------------------*/
+
+	static void prvDNSCacheStore( const char *pcName, const uint32_t *pulAddresses, BaseType_t xCount, uint32_t ulTTL )
+	{
+	BaseType_t x;
+	uint32_t ulHash;
+	UBaseType_t uxSlot;
+
+		/* A TTL with the highest bit set is to be read as zero (RFC 2181). */
+		if( ulTTL > 0x7FFFFFFFuL )
+		{
+			ulTTL = 0uL;
+		}
+
+		if( ( pcName[ 0 ] != '\0' ) && ( strlen( pcName ) < ipconfigDNS_CACHE_NAME_LENGTH ) )
+		{
+			ulHash = prvDNSHash( pcName );
+
+			vTaskSuspendAll();
+			{
+				x = prvDNSCacheFind( pcName, ulHash );
+
+				if( ulTTL == 0uL )
+				{
+					/* The answer may not be cached. */
+					if( x >= 0 )
 					{
-						/* Age out the old cached record. */
-						xDNSCache[ x ].pcName[ 0 ] = 0;
+						prvDNSRemoveRow( x );
 					}
 				}
 				else
 				{
-					xDNSCache[ x ].ulIPAddress = *pulIP;
+					if( x < 0 )
+					{
+						x = prvDNSAllocateRow( dnsSECONDS_NOW() );
+						strcpy( xDNSCache[ x ].pcName, pcName );
+						xDNSCache[ x ].ulHash = ulHash;
+
+						uxSlot = dnsHASH_SLOT( ulHash );
+						while( usDNSHashTable[ uxSlot ] != 0u )
+						{
+							uxSlot = ( uxSlot + 1u ) & ( ipconfigDNS_CACHE_HASH_SLOTS - 1u );
+						}
+						usDNSHashTable[ uxSlot ] = ( uint16_t ) ( x + 1 );
+					}
+
+					if( xCount > 0 )
+					{
+						memcpy( xDNSCache[ x ].ulIPAddresses, pulAddresses, ( size_t ) xCount * sizeof( uint32_t ) );
+					}
+					xDNSCache[ x ].ucNumIPAddresses = ( uint8_t ) xCount;
+					xDNSCache[ x ].ucCurrentIPAddress = 0u;
+					xDNSCache[ x ].ucFlags = 0u;
 					xDNSCache[ x ].ulTTL = ulTTL;
-					xDNSCache[ x ].ulTimeWhenAddedInSeconds = ulCurrentTimeSeconds;
+					xDNSCache[ x ].ulTimeWhenAddedInSeconds = dnsSECONDS_NOW();
 				}
+			}
+			( void ) xTaskResumeAll();
+
+			FreeRTOS_debug_printf( ( "prvDNSCacheStore: '%s' %ld addresses, TTL %lu\n", pcName, xCount, ulTTL ) );
+		}
+	}
+	/*-----------------------------------------------------------*/
+
+	static uint32_t prvReadNegativeTTL( uint8_t *pucByte, size_t xSourceBytesRemaining, uint16_t usAnswers, uint16_t usAuthorityRRs )
+	{
+	uint32_t ulTTL = ipconfigDNS_CACHE_NEGATIVE_TTL;
+	uint8_t *pucEnd = pucByte + xSourceBytesRemaining;
+	uint16_t x, usType, usDataLength;
+
+		for( x = 0u; x < ( uint16_t ) ( usAnswers + usAuthorityRRs ); x++ )
+		{
+			pucByte = prvSkipNameField( pucByte, ( size_t ) ( pucEnd - pucByte ) );
+
+			if( ( pucByte == NULL ) || ( ( size_t ) ( pucEnd - pucByte ) < sizeof( DNSAnswerRecord_t ) ) )
+			{
+				break;
+			}
+
+			usType = usChar2u16( pucByte );
+			usDataLength = usChar2u16( pucByte + offsetof( DNSAnswerRecord_t, usDataLength ) );
+
+			if( ( size_t ) ( pucEnd - pucByte ) < sizeof( DNSAnswerRecord_t ) + usDataLength )
+			{
+				break;
+			}
 
-				xFound = pdTRUE;
+			if( ( x >= usAnswers ) && ( usType == dnsTYPE_SOA ) && ( usDataLength >= 5u * sizeof( uint32_t ) ) )
+			{
+				/* A negative answer may be cached as long as the SOA record of
+				the zone, and no longer than its MINIMUM field, which ends the
+				record (RFC 2308). */
+				ulTTL = FreeRTOS_min_uint32( ulTTL, ulChar2u32( pucByte + offsetof( DNSAnswerRecord_t, ulTTL ) ) );
+				ulTTL = FreeRTOS_min_uint32( ulTTL, ulChar2u32( pucByte + sizeof( DNSAnswerRecord_t ) + usDataLength - sizeof( uint32_t ) ) );
 				break;
 			}
+
+			pucByte += sizeof( DNSAnswerRecord_t ) + usDataLength;
 		}
 
-		if( xFound == pdFALSE )
+		return ulTTL;
+	}
+	/*-----------------------------------------------------------*/
+
+	void vDNSCheckCache( void )
+	{
+	NetworkBufferDescriptor_t *pxNetworkBuffer = NULL;
+	DNSCacheRow_t *pxRow;
+	BaseType_t x;
+	uint32_t ulNow = dnsSECONDS_NOW();
+	uint32_t ulDue;
+	size_t xPayloadLength;
+	uint16_t usPort = 0u;
+	BaseType_t xUseLLMNR = pdFALSE;
+
+		xDNSRefreshScheduled = pdFALSE;
+		vIPSetDNSCacheTimerEnableState( pdFALSE );
+
+		/* Send one request for each entry that has been looked up and is about
+		to expire, and schedule the next refresh. */
+		for( ;; )
 		{
-			if( xLookUp != pdFALSE )
+			if( pxNetworkBuffer == NULL )
 			{
-				*pulIP = 0;
+				/* This is called from the IP-task, so a block time must not be
+				used. */
+				pxNetworkBuffer = pxGetNetworkBufferWithDescriptor( sizeof( UDPPacket_t ) + sizeof( DNSMessage_t ) + ipconfigDNS_CACHE_NAME_LENGTH + 1u + sizeof( DNSTail_t ), ( TickType_t ) 0 );
 			}
-			else
+
+			xPayloadLength = 0u;
+
+			vTaskSuspendAll();
 			{
-				/* Add or update the item. */
-				if( strlen( pcName ) < ipconfigDNS_CACHE_NAME_LENGTH )
+				for( x = 0; x < ipconfigDNS_CACHE_ENTRIES; x++ )
 				{
-					strcpy( xDNSCache[ xFreeEntry ].pcName, pcName );
+					pxRow = &( xDNSCache[ x ] );
+
+					if( ( pxRow->pcName[ 0 ] == 0 ) ||
+						( pxRow->ucFlags != dnsCACHE_USED ) ||
+						( dnsREFRESH_LEAD( pxRow->ulTTL ) == 0uL ) ||
+						( ( ulNow - pxRow->ulTimeWhenAddedInSeconds ) >= pxRow->ulTTL ) )
+					{
+						/* Free, not in use, already asked, or expired. */
+						continue;
+					}
 
-					xDNSCache[ xFreeEntry ].ulIPAddress = *pulIP;
-					xDNSCache[ xFreeEntry ].ulTTL = ulTTL;
-					xDNSCache[ xFreeEntry ].ulTimeWhenAddedInSeconds = ulCurrentTimeSeconds;
+					ulDue = pxRow->ulTimeWhenAddedInSeconds + pxRow->ulTTL - dnsREFRESH_LEAD( pxRow->ulTTL );
 
-					xFreeEntry++;
-					if( xFreeEntry == ipconfigDNS_CACHE_ENTRIES )
+					if( ( int32_t ) ( ulNow - ulDue ) < 0 )
 					{
-						xFreeEntry = 0;
+						prvDNSScheduleRefresh( ulDue, ulNow );
+					}
+					else if( pxNetworkBuffer == NULL )
+					{
+						/* Try again in a second. */
+						prvDNSScheduleRefresh( ulNow + 1uL, ulNow );
+					}
+					else
+					{
+						/* Remember the request, only its reply will be
+						accepted by ulDNSHandlePacket(). */
+						pxRow->usRefreshIdentifier = ( uint16_t ) ipconfigRAND32();
+						pxRow->usRefreshPort = prvDNSGetFreePort();
+						pxRow->ucFlags |= dnsCACHE_REFRESHING;
+						usPort = pxRow->usRefreshPort;
+						xPayloadLength = prvCreateDNSMessage( pxNetworkBuffer->pucEthernetBuffer + ipUDP_PAYLOAD_OFFSET_IPv4, pxRow->pcName, ( TickType_t ) pxRow->usRefreshIdentifier );
+
+						#if( ipconfigUSE_LLMNR == 1 )
+						{
+							xUseLLMNR = ( strchr( pxRow->pcName, '.' ) == NULL ) ? pdTRUE : pdFALSE;
+						}
+						#endif /* ipconfigUSE_LLMNR */
+						break;
 					}
 				}
 			}
+			( void ) xTaskResumeAll();
+
+			if( xPayloadLength == 0u )
+			{
+				break;
+			}
+
+			prvDNSSendWithoutSocket( pxNetworkBuffer, xPayloadLength, usPort, xUseLLMNR );
+			pxNetworkBuffer = NULL;
 		}
 
-		if( ( xLookUp == 0 ) || ( *pulIP != 0 ) )
+		if( pxNetworkBuffer != NULL )
 		{
-			FreeRTOS_debug_printf( ( "prvProcessDNSCache: %s: '%s' @ %lxip\n", xLookUp ? "look-up" : "add", pcName, FreeRTOS_ntohl( *pulIP ) ) );
+			vReleaseNetworkBufferAndDescriptor( pxNetworkBuffer );
 		}
 	}
 
-#endif /* ipconfigUSE_DNS_CACHE */
+#endif /* ipconfigUSE_DNS_CACHE_HASH */
 
 #endif /* ipconfigUSE_DNS != 0 */
 
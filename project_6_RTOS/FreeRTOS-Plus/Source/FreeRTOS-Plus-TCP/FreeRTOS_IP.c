@@ -104,14 +104,6 @@ needs to call eConsiderFrameForProcessing. */
 character expected to fill ICMP echo replies. */
 #define ipECHO_DATA_FILL_BYTE						'x'
 
-#if( ipconfigBYTE_ORDER == pdFREERTOS_LITTLE_ENDIAN )
-	/* The bits in the two byte IP header field that make up the fragment offset value. */
-	#define ipFRAGMENT_OFFSET_BIT_MASK				( ( uint16_t ) 0xff0f )
-#else
-	/* The bits in the two byte IP header field that make up the fragment offset value. */
-	#define ipFRAGMENT_OFFSET_BIT_MASK				( ( uint16_t ) 0x0fff )
-#endif /* ipconfigBYTE_ORDER */
-
 /* The maximum time the IP task is allowed to remain in the Blocked state if no
 events are posted to the network event queue. */
 #ifndef	ipconfigMAX_IP_TASK_SLEEP_TIME
@@ -127,6 +119,15 @@ It is advised to increment it by 1 ever 4us, which makes about 256 times
 per ms: */
 #define ipINITIAL_SEQUENCE_NUMBER_FACTOR	256UL
 
+/* The longest IP packet of which usGenerateProtocolChecksum() accepts to
+calculate the checksum.  A UDP datagram that is sent in fragments, or that has
+been reassembled, can be longer than the MTU. */
+#if( ( ipconfigUSE_IP_REASSEMBLY != 0 ) || ( ipconfigCAN_FRAGMENT_OUTGOING_PACKETS != 0 ) )
+	#define ipMAX_PROTOCOL_PACKET_LENGTH	( 0xffffU )
+#else
+	#define ipMAX_PROTOCOL_PACKET_LENGTH	( ipconfigNETWORK_MTU )
+#endif
+
 /* Returned as the (invalid) checksum when the protocol being checked is not
 handled.  The value is chosen simply to be easy to spot when debugging. */
 #define ipUNHANDLED_PROTOCOL		0x4321u
@@ -186,6 +187,47 @@ static void prvProcessEthernetPacket( NetworkBufferDescriptor_t * const pxNetwor
  */
 static eFrameProcessingResult_t prvProcessIPPacket( IPPacket_t * const pxIPPacket, NetworkBufferDescriptor_t * const pxNetworkBuffer );
 
+#if( ipconfigUSE_IP_REASSEMBLY != 0 )
+	/* The descriptor of a hole in a datagram that is being reassembled, see
+	RFC 815.  It is stored in the first bytes of the hole itself.  All fragments
+	but the last carry a multiple of 8 bytes, so a hole is at least 8 bytes. */
+	typedef struct xIP_REASSEMBLY_HOLE
+	{
+		uint16_t usFirst;	/* Offset of the first missing byte. */
+		uint16_t usLast;	/* Offset of the last missing byte. */
+		uint16_t usNext;	/* Offset of the next hole, or ipREASSEMBLY_NO_HOLE. */
+	} IPReassemblyHole_t;
+
+	/* A UDP datagram of which not all fragments have come in yet. */
+	typedef struct xIP_REASSEMBLY
+	{
+		NetworkBufferDescriptor_t *pxBuffer;	/* The headers and the IP payload, or NULL when the entry is free. */
+		TickType_t xStartTime;					/* When the first fragment came in. */
+		uint32_t ulSourceIPAddress;				/* Together with usIdentification, identifies the datagram. */
+		uint16_t usIdentification;
+		uint16_t usFirstHole;					/* Offset of the first hole, or ipREASSEMBLY_NO_HOLE. */
+		uint16_t usSize;						/* Length of the IP payload, or its maximum until the last fragment is known. */
+		uint8_t ucHaveLast;						/* Set when the fragment without the 'more fragments' flag has come in. */
+	} IPReassembly_t;
+
+	/*
+	 * Copy a fragment of a UDP datagram into the datagram that is being
+	 * reassembled, and process the datagram as soon as it is complete.
+	 */
+	static void prvIPReassemble( NetworkBufferDescriptor_t * const pxNetworkBuffer );
+
+	/*
+	 * Drop the datagrams that have not been completed within
+	 * ipconfigIP_REASSEMBLY_TIMEOUT_MS.  Called when xReassemblyTimer expires.
+	 */
+	static void prvIPReassemblyCheck( void );
+
+	/*
+	 * Release the buffer of a datagram that is being reassembled.
+	 */
+	static void prvIPReassemblyFree( IPReassembly_t *pxDatagram );
+#endif /* ipconfigUSE_IP_REASSEMBLY */
+
 #if ( ipconfigREPLY_TO_INCOMING_PINGS == 1 ) || ( ipconfigSUPPORT_OUTGOING_PINGS == 1 )
 	/*
 	 * Process incoming ICMP packets.
@@ -289,6 +331,9 @@ regular basis:
 	2. DPHC, to send requests and to renew a reservation
 	3. TCP, to check for timeouts, resends
 	4. DNS, to check for timeouts when looking-up a domain.
+	5. ARP, to drop the packets held for an address that doesn't reply.
+	6. DNS, to refresh the cached names in use before they expire.
+	7. IP, to drop the datagrams that are not reassembled in time.
  */
 static IPTimer_t xARPTimer;
 #if( ipconfigUSE_DHCP != 0 )
@@ -300,6 +345,23 @@ static IPTimer_t xARPTimer;
 #if( ipconfigDNS_USE_CALLBACKS != 0 )
 	static IPTimer_t xDNSTimer;
 #endif
+#if( ipconfigARP_PENDING_PACKETS != 0 )
+	static IPTimer_t xARPPendingTimer;
+#endif
+#if( ipconfigUSE_DNS_CACHE_HASH != 0 )
+	static IPTimer_t xDNSCacheTimer;
+#endif
+#if( ipconfigUSE_IP_REASSEMBLY != 0 )
+	static IPTimer_t xReassemblyTimer;
+#endif
+
+#if( ipconfigUSE_IP_REASSEMBLY != 0 )
+	/* Marks the end of the list of holes of a datagram being reassembled. */
+	#define ipREASSEMBLY_NO_HOLE	( ( uint16_t ) 0xffffu )
+
+	/* The datagrams of which fragments are coming in. */
+	static IPReassembly_t xReassembly[ ipconfigIP_REASSEMBLY_MAX_DATAGRAMS ];
+#endif
 
 /* Set to pdTRUE when the IP task is ready to start processing packets. */
 static BaseType_t xIPTaskInitialised = pdFALSE;
@@ -463,6 +525,21 @@ struct freertos_sockaddr xAddress;
 				#endif /* ipconfigSUPPORT_SIGNALS */
 				break;
 
+			case eDNSTimerEvent :
+				#if( ipconfigDNS_USE_CALLBACKS != 0 )
+				{
+					/* FreeRTOS_gethostbyname_a() started a look-up, of which
+					the IP-task sends the requests.  Mark the DNS timer as
+					expired so prvCheckNetworkTimers() sends them now. */
+					if( xDNSTimer.bActive == pdFALSE_UNSIGNED )
+					{
+						prvIPTimerReload( &xDNSTimer, pdMS_TO_TICKS( 1000u ) );
+					}
+					xDNSTimer.bExpired = pdTRUE_UNSIGNED;
+				}
+				#endif /* ipconfigDNS_USE_CALLBACKS */
+				break;
+
 			case eTCPTimerEvent :
 				#if( ipconfigUSE_TCP == 1 )
 				{
@@ -618,6 +695,42 @@ TickType_t xMaximumSleepTime;
 	}
 	#endif
 
+	#if( ipconfigARP_PENDING_PACKETS != 0 )
+	{
+		if( xARPPendingTimer.bActive != pdFALSE_UNSIGNED )
+		{
+			if( xARPPendingTimer.ulRemainingTime < xMaximumSleepTime )
+			{
+				xMaximumSleepTime = xARPPendingTimer.ulRemainingTime;
+			}
+		}
+	}
+	#endif
+
+	#if( ipconfigUSE_DNS_CACHE_HASH != 0 )
+	{
+		if( xDNSCacheTimer.bActive != pdFALSE_UNSIGNED )
+		{
+			if( xDNSCacheTimer.ulRemainingTime < xMaximumSleepTime )
+			{
+				xMaximumSleepTime = xDNSCacheTimer.ulRemainingTime;
+			}
+		}
+	}
+	#endif
+
+	#if( ipconfigUSE_IP_REASSEMBLY != 0 )
+	{
+		if( xReassemblyTimer.bActive != pdFALSE_UNSIGNED )
+		{
+			if( xReassemblyTimer.ulRemainingTime < xMaximumSleepTime )
+			{
+				xMaximumSleepTime = xReassemblyTimer.ulRemainingTime;
+			}
+		}
+	}
+	#endif
+
 	return xMaximumSleepTime;
 }
 /*-----------------------------------------------------------*/
@@ -652,6 +765,36 @@ static void prvCheckNetworkTimers( void )
 	}
 	#endif /* ipconfigDNS_USE_CALLBACKS */
 
+	#if( ipconfigARP_PENDING_PACKETS != 0 )
+	{
+		/* Have packets been waiting too long for an ARP reply? */
+		if( prvIPTimerCheck( &xARPPendingTimer ) != pdFALSE )
+		{
+			vARPCheckPendingPackets();
+		}
+	}
+	#endif /* ipconfigARP_PENDING_PACKETS */
+
+	#if( ipconfigUSE_DNS_CACHE_HASH != 0 )
+	{
+		/* Is it time to refresh cached names? */
+		if( prvIPTimerCheck( &xDNSCacheTimer ) != pdFALSE )
+		{
+			vDNSCheckCache();
+		}
+	}
+	#endif /* ipconfigUSE_DNS_CACHE_HASH */
+
+	#if( ipconfigUSE_IP_REASSEMBLY != 0 )
+	{
+		/* Have datagrams been waiting too long for their fragments? */
+		if( prvIPTimerCheck( &xReassemblyTimer ) != pdFALSE )
+		{
+			prvIPReassemblyCheck();
+		}
+	}
+	#endif /* ipconfigUSE_IP_REASSEMBLY */
+
 	#if( ipconfigUSE_TCP == 1 )
 	{
 	BaseType_t xWillSleep;
@@ -839,6 +982,12 @@ NetworkBufferDescriptor_t * pxNewBuffer;
 		pxNewBuffer->ulIPAddress = pxNetworkBuffer->ulIPAddress;
 		pxNewBuffer->usPort = pxNetworkBuffer->usPort;
 		pxNewBuffer->usBoundPort = pxNetworkBuffer->usBoundPort;
+		#if( ipconfigUSE_CHECKSUM_COPY != 0 )
+		{
+			pxNewBuffer->usPayloadChecksum = pxNetworkBuffer->usPayloadChecksum;
+			pxNewBuffer->usPayloadChecksumLength = pxNetworkBuffer->usPayloadChecksumLength;
+		}
+		#endif /* ipconfigUSE_CHECKSUM_COPY */
 		memcpy( pxNewBuffer->pucEthernetBuffer, pxNetworkBuffer->pucEthernetBuffer, pxNetworkBuffer->xDataLength );
 	}
 
@@ -1446,8 +1595,9 @@ eFrameProcessingResult_t eReturn = eProcessBuffer;
 
 			/* Ensure that the incoming packet is not fragmented (only outgoing
 			packets can be fragmented) as these are the only handled IP frames
-			currently. */
-			if( ( pxIPHeader->usFragmentOffset & ipFRAGMENT_OFFSET_BIT_MASK ) != 0U )
+			currently.  Fragments of UDP datagrams can be reassembled. */
+			if( ( ( pxIPHeader->usFragmentOffset & ( ipFRAGMENT_OFFSET_BIT_MASK | ipFRAGMENT_FLAGS_MORE_FRAGMENTS ) ) != 0U ) &&
+				( ( ipconfigUSE_IP_REASSEMBLY == 0 ) || ( pxIPHeader->ucProtocol != ( uint8_t ) ipPROTOCOL_UDP ) ) )
 			{
 				/* Can not handle, fragmented packet. */
 				eReturn = eReleaseBuffer;
@@ -1491,6 +1641,13 @@ eFrameProcessingResult_t eReturn = eProcessBuffer;
 				/* Check sum in IP-header not correct. */
 				eReturn = eReleaseBuffer;
 			}
+			#if( ipconfigUSE_IP_REASSEMBLY != 0 )
+			else if( ( pxIPHeader->usFragmentOffset & ( ipFRAGMENT_OFFSET_BIT_MASK | ipFRAGMENT_FLAGS_MORE_FRAGMENTS ) ) != 0U )
+			{
+				/* The UDP checksum covers the whole datagram, it will be
+				checked once the datagram has been reassembled. */
+			}
+			#endif /* ipconfigUSE_IP_REASSEMBLY */
 			/* Is the upper-layer checksum (TCP/UDP/ICMP) correct? */
 			else if( usGenerateProtocolChecksum( ( uint8_t * )( pxNetworkBuffer->pucEthernetBuffer ), pxNetworkBuffer->xDataLength, pdFALSE ) != ipCORRECT_CRC )
 			{
@@ -1554,6 +1711,18 @@ uint8_t ucProtocol;
 												( ( ipSIZE_OF_IPv4_HEADER >> 2 ) & 0x0F ); /* Low nibble is the header size, in bytes, divided by four. */
 		}
 
+		#if( ipconfigUSE_IP_REASSEMBLY != 0 )
+		{
+			if( ( pxIPHeader->usFragmentOffset & ( ipFRAGMENT_OFFSET_BIT_MASK | ipFRAGMENT_FLAGS_MORE_FRAGMENTS ) ) != 0U )
+			{
+				/* The contents of the fragment are copied, this buffer can be
+				released. */
+				prvIPReassemble( pxNetworkBuffer );
+				return eReleaseBuffer;
+			}
+		}
+		#endif /* ipconfigUSE_IP_REASSEMBLY */
+
 		/* Add the IP and MAC addresses to the ARP table if they are not
 		already there - otherwise refresh the age of the existing
 		entry. */
@@ -1666,6 +1835,310 @@ uint8_t ucProtocol;
 }
 /*-----------------------------------------------------------*/
 
+#if( ipconfigUSE_IP_REASSEMBLY != 0 )
+
+	static void prvIPReassemble( NetworkBufferDescriptor_t * const pxNetworkBuffer )
+	{
+	IPPacket_t *pxIPPacket = ( IPPacket_t * ) pxNetworkBuffer->pucEthernetBuffer;
+	IPHeader_t *pxIPHeader = &( pxIPPacket->xIPHeader );
+	IPReassembly_t *pxDatagram = NULL, *pxFree = NULL, *pxOldest = NULL;
+	NetworkBufferDescriptor_t *pxBuffer;
+	IPReassemblyHole_t xHole, xNewHole;
+	uint8_t *pucPayload;
+	size_t uxLength, uxFirst, uxLast, uxSize;
+	uint16_t usHole, usPrevious, usNext;
+	BaseType_t xIndex, xMoreFragments;
+	TickType_t xNow = xTaskGetTickCount();
+
+		/* Only the fragments of UDP datagrams are reassembled. */
+		if( pxIPHeader->ucProtocol != ( uint8_t ) ipPROTOCOL_UDP )
+		{
+			return;
+		}
+
+		/* The IP options have been removed, the IP header is 20 bytes. */
+		uxLength = ( size_t ) FreeRTOS_ntohs( pxIPHeader->usLength );
+
+		if( ( uxLength <= ipSIZE_OF_IPv4_HEADER ) || ( ( uxLength + ipSIZE_OF_ETH_HEADER ) > pxNetworkBuffer->xDataLength ) )
+		{
+			return;
+		}
+
+		uxLength -= ipSIZE_OF_IPv4_HEADER;
+		uxFirst = ( ( size_t ) FreeRTOS_ntohs( pxIPHeader->usFragmentOffset & ipFRAGMENT_OFFSET_BIT_MASK ) ) << 3;
+		uxLast = ( uxFirst + uxLength ) - 1u;
+		xMoreFragments = ( ( pxIPHeader->usFragmentOffset & ipFRAGMENT_FLAGS_MORE_FRAGMENTS ) != 0U ) ? pdTRUE : pdFALSE;
+
+		/* Only the last fragment may have a length that is not a multiple of 8. */
+		if( ( xMoreFragments != pdFALSE ) && ( ( uxLength & 0x07u ) != 0u ) )
+		{
+			return;
+		}
+
+		for( xIndex = 0; xIndex < ( BaseType_t ) ipconfigIP_REASSEMBLY_MAX_DATAGRAMS; xIndex++ )
+		{
+			if( xReassembly[ xIndex ].pxBuffer == NULL )
+			{
+				pxFree = &( xReassembly[ xIndex ] );
+			}
+			else if( ( xReassembly[ xIndex ].ulSourceIPAddress == pxIPHeader->ulSourceIPAddress ) &&
+					 ( xReassembly[ xIndex ].usIdentification == pxIPHeader->usIdentification ) )
+			{
+				pxDatagram = &( xReassembly[ xIndex ] );
+				break;
+			}
+			else if( ( pxOldest == NULL ) ||
+					 ( ( xNow - xReassembly[ xIndex ].xStartTime ) > ( xNow - pxOldest->xStartTime ) ) )
+			{
+				pxOldest = &( xReassembly[ xIndex ] );
+			}
+		}
+
+		if( pxDatagram == NULL )
+		{
+			if( uxLast >= ( size_t ) ipconfigIP_REASSEMBLY_MAX_SIZE )
+			{
+				/* The datagram would be too long. */
+				return;
+			}
+
+			/* The size of the datagram is known if its last fragment comes in
+			first. */
+			uxSize = ( xMoreFragments != pdFALSE ) ? ( size_t ) ipconfigIP_REASSEMBLY_MAX_SIZE : ( uxLast + 1u );
+			pxBuffer = pxGetNetworkBufferWithDescriptor( ipIP_PAYLOAD_OFFSET + uxSize, ( TickType_t ) 0u );
+
+			if( pxBuffer == NULL )
+			{
+				return;
+			}
+
+			if( pxFree == NULL )
+			{
+				/* All entries are in use, the datagram that has waited longest
+				is least likely to be completed. */
+				prvIPReassemblyFree( pxOldest );
+				pxFree = pxOldest;
+			}
+
+			pxDatagram = pxFree;
+			pxDatagram->pxBuffer = pxBuffer;
+			pxDatagram->xStartTime = xNow;
+			pxDatagram->ulSourceIPAddress = pxIPHeader->ulSourceIPAddress;
+			pxDatagram->usIdentification = pxIPHeader->usIdentification;
+			pxDatagram->usSize = ( uint16_t ) uxSize;
+			pxDatagram->ucHaveLast = pdFALSE_UNSIGNED;
+
+			/* Initially, the whole datagram is one hole. */
+			xHole.usFirst = 0u;
+			xHole.usLast = ( uint16_t ) ( uxSize - 1u );
+			xHole.usNext = ipREASSEMBLY_NO_HOLE;
+			memcpy( pxBuffer->pucEthernetBuffer + ipIP_PAYLOAD_OFFSET, &xHole, sizeof( xHole ) );
+			pxDatagram->usFirstHole = 0u;
+
+			if( xReassemblyTimer.bActive == pdFALSE_UNSIGNED )
+			{
+				prvIPTimerReload( &xReassemblyTimer, pdMS_TO_TICKS( ipconfigIP_REASSEMBLY_TIMEOUT_MS ) );
+			}
+		}
+
+		/* A fragment that does not agree with the length of the datagram makes
+		the datagram useless. */
+		if( ( uxLast >= ( size_t ) pxDatagram->usSize ) ||
+			( ( xMoreFragments == pdFALSE ) && ( pxDatagram->ucHaveLast != pdFALSE_UNSIGNED ) && ( ( uxLast + 1u ) != ( size_t ) pxDatagram->usSize ) ) )
+		{
+			prvIPReassemblyFree( pxDatagram );
+			return;
+		}
+
+		if( xMoreFragments == pdFALSE )
+		{
+			pxDatagram->usSize = ( uint16_t ) ( uxLast + 1u );
+			pxDatagram->ucHaveLast = pdTRUE_UNSIGNED;
+		}
+
+		/* Replace every hole that the fragment fills, partly or completely,
+		by the parts of it that remain missing.  The list stays sorted by
+		offset.  The last fragment also removes the holes that follow it. */
+		pucPayload = pxDatagram->pxBuffer->pucEthernetBuffer + ipIP_PAYLOAD_OFFSET;
+		usPrevious = ipREASSEMBLY_NO_HOLE;
+		usHole = pxDatagram->usFirstHole;
+
+		while( usHole != ipREASSEMBLY_NO_HOLE )
+		{
+			memcpy( &xHole, pucPayload + usHole, sizeof( xHole ) );
+
+			if( ( uxFirst > ( size_t ) xHole.usLast ) ||
+				( ( uxLast < ( size_t ) xHole.usFirst ) && ( xMoreFragments != pdFALSE ) ) )
+			{
+				/* This hole remains as it is. */
+				usPrevious = usHole;
+			}
+			else
+			{
+				usNext = xHole.usNext;
+
+				if( ( uxLast < ( size_t ) xHole.usLast ) && ( xMoreFragments != pdFALSE ) )
+				{
+					/* The end of the hole is still missing. */
+					xNewHole.usFirst = ( uint16_t ) ( uxLast + 1u );
+					xNewHole.usLast = xHole.usLast;
+					xNewHole.usNext = usNext;
+					memcpy( pucPayload + xNewHole.usFirst, &xNewHole, sizeof( xNewHole ) );
+					usNext = xNewHole.usFirst;
+				}
+
+				if( uxFirst > ( size_t ) xHole.usFirst )
+				{
+					/* The start of the hole is still missing. */
+					xNewHole.usFirst = xHole.usFirst;
+					xNewHole.usLast = ( uint16_t ) ( uxFirst - 1u );
+					xNewHole.usNext = usNext;
+					memcpy( pucPayload + xNewHole.usFirst, &xNewHole, sizeof( xNewHole ) );
+					usNext = xNewHole.usFirst;
+				}
+
+				/* Link the previous hole to the remaining parts, or to the
+				next hole. */
+				if( usPrevious == ipREASSEMBLY_NO_HOLE )
+				{
+					pxDatagram->usFirstHole = usNext;
+				}
+				else
+				{
+					memcpy( &xNewHole, pucPayload + usPrevious, sizeof( xNewHole ) );
+					xNewHole.usNext = usNext;
+					memcpy( pucPayload + usPrevious, &xNewHole, sizeof( xNewHole ) );
+				}
+
+				/* Skip the remaining parts, they lie outside the fragment. */
+				while( usNext != xHole.usNext )
+				{
+					usPrevious = usNext;
+					memcpy( &xNewHole, pucPayload + usNext, sizeof( xNewHole ) );
+					usNext = xNewHole.usNext;
+				}
+			}
+
+			usHole = xHole.usNext;
+		}
+
+		/* The hole descriptors that remain lie outside the fragment, the data
+		can be copied.  Where it overlaps earlier fragments, it replaces their
+		data. */
+		memcpy( pucPayload + uxFirst, pxNetworkBuffer->pucEthernetBuffer + ipIP_PAYLOAD_OFFSET, uxLength );
+
+		if( uxFirst == 0u )
+		{
+			/* The Ethernet and IP headers of the first fragment are used for
+			the datagram. */
+			memcpy( pxDatagram->pxBuffer->pucEthernetBuffer, pxNetworkBuffer->pucEthernetBuffer, ipIP_PAYLOAD_OFFSET );
+		}
+
+		if( pxDatagram->usFirstHole == ipREASSEMBLY_NO_HOLE )
+		{
+			if( pxDatagram->ucHaveLast == pdFALSE_UNSIGNED )
+			{
+				/* All of ipconfigIP_REASSEMBLY_MAX_SIZE has been filled, and
+				more fragments are to come. */
+				prvIPReassemblyFree( pxDatagram );
+			}
+			else
+			{
+				/* The datagram is complete: make it look like a single
+				packet, and let it take the normal path. */
+				pxBuffer = pxDatagram->pxBuffer;
+				pxDatagram->pxBuffer = NULL;
+				pxBuffer->xDataLength = ipIP_PAYLOAD_OFFSET + ( size_t ) pxDatagram->usSize;
+
+				pxIPPacket = ( IPPacket_t * ) pxBuffer->pucEthernetBuffer;
+				pxIPHeader = &( pxIPPacket->xIPHeader );
+				pxIPHeader->usLength = FreeRTOS_htons( ( uint16_t ) ( ipSIZE_OF_IPv4_HEADER + pxDatagram->usSize ) );
+				pxIPHeader->usFragmentOffset = 0u;
+				pxIPHeader->usHeaderChecksum = 0u;
+				pxIPHeader->usHeaderChecksum = usGenerateChecksum( 0UL, ( uint8_t * ) &( pxIPHeader->ucVersionHeaderLength ), ipSIZE_OF_IPv4_HEADER );
+				pxIPHeader->usHeaderChecksum = ~FreeRTOS_htons( pxIPHeader->usHeaderChecksum );
+
+				/* The UDP checksum covers the whole datagram, neither the
+				driver nor prvAllowIPPacket() could check it on the fragments.
+				When ipconfigDRIVER_INCLUDED_RX_IP_CHECKSUM is 0 the datagram
+				is checked once more below, but the check must not depend on
+				what prvProcessIPPacket() happens to do. */
+				if( usGenerateProtocolChecksum( pxBuffer->pucEthernetBuffer, pxBuffer->xDataLength, pdFALSE ) != ipCORRECT_CRC )
+				{
+					vReleaseNetworkBufferAndDescriptor( pxBuffer );
+					pxBuffer = NULL;
+				}
+
+				if( pxBuffer != NULL )
+				{
+					if( prvProcessIPPacket( pxIPPacket, pxBuffer ) != eFrameConsumed )
+					{
+						vReleaseNetworkBufferAndDescriptor( pxBuffer );
+					}
+				}
+			}
+		}
+	}
+
+#endif /* ipconfigUSE_IP_REASSEMBLY */
+/*-----------------------------------------------------------*/
+
+#if( ipconfigUSE_IP_REASSEMBLY != 0 )
+
+	static void prvIPReassemblyCheck( void )
+	{
+	BaseType_t xIndex;
+	TickType_t xAge, xNextCheck = pdMS_TO_TICKS( ipconfigIP_REASSEMBLY_TIMEOUT_MS );
+	BaseType_t xWaiting = pdFALSE;
+
+		for( xIndex = 0; xIndex < ( BaseType_t ) ipconfigIP_REASSEMBLY_MAX_DATAGRAMS; xIndex++ )
+		{
+			if( xReassembly[ xIndex ].pxBuffer != NULL )
+			{
+				xAge = xTaskGetTickCount() - xReassembly[ xIndex ].xStartTime;
+
+				if( xAge >= pdMS_TO_TICKS( ipconfigIP_REASSEMBLY_TIMEOUT_MS ) )
+				{
+					prvIPReassemblyFree( &( xReassembly[ xIndex ] ) );
+				}
+				else
+				{
+					/* Check again when the oldest of the remaining datagrams
+					expires. */
+					if( ( pdMS_TO_TICKS( ipconfigIP_REASSEMBLY_TIMEOUT_MS ) - xAge ) < xNextCheck )
+					{
+						xNextCheck = pdMS_TO_TICKS( ipconfigIP_REASSEMBLY_TIMEOUT_MS ) - xAge;
+					}
+					xWaiting = pdTRUE;
+				}
+			}
+		}
+
+		if( xWaiting != pdFALSE )
+		{
+			prvIPTimerReload( &xReassemblyTimer, xNextCheck );
+		}
+		else
+		{
+			xReassemblyTimer.bActive = pdFALSE_UNSIGNED;
+		}
+	}
+
+#endif /* ipconfigUSE_IP_REASSEMBLY */
+/*-----------------------------------------------------------*/
+
+#if( ipconfigUSE_IP_REASSEMBLY != 0 )
+
+	static void prvIPReassemblyFree( IPReassembly_t *pxDatagram )
+	{
+		iptraceIP_REASSEMBLY_DROPPED( pxDatagram->ulSourceIPAddress );
+		vReleaseNetworkBufferAndDescriptor( pxDatagram->pxBuffer );
+		pxDatagram->pxBuffer = NULL;
+	}
+
+#endif /* ipconfigUSE_IP_REASSEMBLY */
+/*-----------------------------------------------------------*/
+
 #if ( ipconfigSUPPORT_OUTGOING_PINGS == 1 )
 
 	static void prvProcessICMPEchoReply( ICMPPacket_t * const pxICMPPacket )
@@ -1914,7 +2387,7 @@ uint8_t ucProtocol;
 		( FreeRTOS_ntohs( pxIPPacket->xIPHeader.usLength ) - ( ( uint16_t ) uxIPHeaderLength ) ); /* normally minus 20 */
 
 	if( ( ulLength < sizeof( pxProtPack->xUDPPacket.xUDPHeader ) ) ||
-		( ulLength > ( uint32_t )( ipconfigNETWORK_MTU - uxIPHeaderLength ) ) )
+		( ulLength > ( uint32_t )( ipMAX_PROTOCOL_PACKET_LENGTH - uxIPHeaderLength ) ) )
 	{
 		#if( ipconfigHAS_DEBUG_PRINTF != 0 )
 		{
@@ -2030,6 +2503,8 @@ uint8_t ucProtocol;
  *   uxDataLengthBytes: This argument contains the number of bytes that this method
  *	 should process.
  */
+#if( ipconfigCHECKSUM_ACCUMULATOR_BITS == 0 )
+
 uint16_t usGenerateChecksum( uint32_t ulSum, const uint8_t * pucNextData, size_t uxDataLengthBytes )
 {
 xUnion32 xSum2, xSum, xTerm;
@@ -2146,6 +2621,327 @@ uint32_t ulAlignBits, ulCarry = 0ul;
 }
 /*-----------------------------------------------------------*/
 
+#else /* ipconfigCHECKSUM_ACCUMULATOR_BITS != 0 */
+
+/*
+ * The same sum, but without counting the carries while adding.  With
+ * ipconfigCHECKSUM_ACCUMULATOR_BITS set to 64, the 32-bit words are added to a
+ * 64-bit accumulator, which can not overflow for any packet size.  With 32, the
+ * two 16-bit halves of each word are added to a 32-bit accumulator, which is
+ * folded after every block of ipCHECKSUM_BLOCK_WORDS words.  The carries are
+ * only folded back in at the end.  The main loop handles 8 words (32 bytes) per
+ * iteration.
+ */
+#define ipCHECKSUM_BLOCK_WORDS		( ( size_t ) 4096u )
+
+uint16_t usGenerateChecksum( uint32_t ulSum, const uint8_t * pucNextData, size_t uxDataLengthBytes )
+{
+xUnion32 xSum, xTerm;
+xUnionPtr xSource;		/* Points to first byte */
+uint32_t ulAlignBits;
+size_t uxWords;
+#if( ipconfigCHECKSUM_ACCUMULATOR_BITS == 64 )
+	uint64_t ullAcc;
+#else
+	uint32_t ulAcc, ulWord;
+	size_t uxBlock;
+#endif
+
+	/* Swap the input (little endian platform only). */
+	xSum.u32 = FreeRTOS_ntohs( ulSum );
+	xTerm.u32 = 0ul;
+
+	xSource.u8ptr = ( uint8_t * ) pucNextData;
+	ulAlignBits = ( ( ( uint32_t ) pucNextData ) & 0x03u ); /* gives 0, 1, 2, or 3 */
+
+	/* If byte (8-bit) aligned... */
+	if( ( ( ulAlignBits & 1ul ) != 0ul ) && ( uxDataLengthBytes >= ( size_t ) 1 ) )
+	{
+		xTerm.u8[ 1 ] = *( xSource.u8ptr );
+		( xSource.u8ptr )++;
+		uxDataLengthBytes--;
+		/* Now xSource is word (16-bit) aligned. */
+	}
+
+	/* If half-word (16-bit) aligned... */
+	if( ( ( ulAlignBits == 1u ) || ( ulAlignBits == 2u ) ) && ( uxDataLengthBytes >= 2u ) )
+	{
+		xSum.u32 += *(xSource.u16ptr);
+		( xSource.u16ptr )++;
+		uxDataLengthBytes -= 2u;
+		/* Now xSource is word (32-bit) aligned. */
+	}
+
+	uxWords = uxDataLengthBytes / 4u;
+
+	#if( ipconfigCHECKSUM_ACCUMULATOR_BITS == 64 )
+	{
+		ullAcc = ( uint64_t ) xSum.u32 + xTerm.u32;
+
+		while( uxWords >= 8u )
+		{
+			ullAcc += ( uint64_t ) xSource.u32ptr[ 0 ];
+			ullAcc += ( uint64_t ) xSource.u32ptr[ 1 ];
+			ullAcc += ( uint64_t ) xSource.u32ptr[ 2 ];
+			ullAcc += ( uint64_t ) xSource.u32ptr[ 3 ];
+			ullAcc += ( uint64_t ) xSource.u32ptr[ 4 ];
+			ullAcc += ( uint64_t ) xSource.u32ptr[ 5 ];
+			ullAcc += ( uint64_t ) xSource.u32ptr[ 6 ];
+			ullAcc += ( uint64_t ) xSource.u32ptr[ 7 ];
+			xSource.u32ptr += 8;
+			uxWords -= 8u;
+		}
+
+		while( uxWords > 0u )
+		{
+			ullAcc += ( uint64_t ) xSource.u32ptr[ 0 ];
+			xSource.u32ptr++;
+			uxWords--;
+		}
+
+		/* Fold the 64-bit sum into 32 bits, twice for the carry. */
+		ullAcc = ( ullAcc & 0xffffffffull ) + ( ullAcc >> 32 );
+		ullAcc = ( ullAcc & 0xffffffffull ) + ( ullAcc >> 32 );
+		xSum.u32 = ( uint32_t ) ullAcc;
+		xSum.u32 = ( uint32_t ) xSum.u16[ 0 ] + xSum.u16[ 1 ];
+	}
+	#else
+	{
+		ulAcc = ( uint32_t ) xSum.u16[ 0 ] + xSum.u16[ 1 ] + xTerm.u16[ 0 ] + xTerm.u16[ 1 ];
+
+		while( uxWords > 0u )
+		{
+			uxBlock = ( uxWords < ipCHECKSUM_BLOCK_WORDS ) ? uxWords : ipCHECKSUM_BLOCK_WORDS;
+			uxWords -= uxBlock;
+
+			while( uxBlock >= 8u )
+			{
+				ulWord = xSource.u32ptr[ 0 ];
+				ulAcc += ( ulWord & 0xffffu ) + ( ulWord >> 16 );
+				ulWord = xSource.u32ptr[ 1 ];
+				ulAcc += ( ulWord & 0xffffu ) + ( ulWord >> 16 );
+				ulWord = xSource.u32ptr[ 2 ];
+				ulAcc += ( ulWord & 0xffffu ) + ( ulWord >> 16 );
+				ulWord = xSource.u32ptr[ 3 ];
+				ulAcc += ( ulWord & 0xffffu ) + ( ulWord >> 16 );
+				ulWord = xSource.u32ptr[ 4 ];
+				ulAcc += ( ulWord & 0xffffu ) + ( ulWord >> 16 );
+				ulWord = xSource.u32ptr[ 5 ];
+				ulAcc += ( ulWord & 0xffffu ) + ( ulWord >> 16 );
+				ulWord = xSource.u32ptr[ 6 ];
+				ulAcc += ( ulWord & 0xffffu ) + ( ulWord >> 16 );
+				ulWord = xSource.u32ptr[ 7 ];
+				ulAcc += ( ulWord & 0xffffu ) + ( ulWord >> 16 );
+				xSource.u32ptr += 8;
+				uxBlock -= 8u;
+			}
+
+			while( uxBlock > 0u )
+			{
+				ulWord = xSource.u32ptr[ 0 ];
+				ulAcc += ( ulWord & 0xffffu ) + ( ulWord >> 16 );
+				xSource.u32ptr++;
+				uxBlock--;
+			}
+
+			/* At most 4096 * 2 * 0xffff was added, fold before the next block. */
+			ulAcc = ( ulAcc & 0xffffu ) + ( ulAcc >> 16 );
+		}
+
+		xSum.u32 = ulAcc;
+	}
+	#endif /* ipconfigCHECKSUM_ACCUMULATOR_BITS */
+
+	/* The last half-word and byte. */
+	if( ( uxDataLengthBytes & 2u ) != 0u )
+	{
+		xSum.u32 += xSource.u16ptr[ 0 ];
+		xSource.u16ptr++;
+	}
+
+	if( ( uxDataLengthBytes & ( size_t ) 1 ) != 0u )
+	{
+		xTerm.u32 = 0ul;
+		xTerm.u8[ 0 ] = xSource.u8ptr[ 0 ];
+		xSum.u32 += xTerm.u32;
+	}
+
+	/* Now add all carries, twice as the first addition may carry again. */
+	xSum.u32 = ( uint32_t ) xSum.u16[ 0 ] + xSum.u16[ 1 ];
+	xSum.u32 = ( uint32_t ) xSum.u16[ 0 ] + xSum.u16[ 1 ];
+
+	if( ( ulAlignBits & 1u ) != 0u )
+	{
+		/* pucNextData was odd, the checksum was calculated starting at an odd
+		position. */
+		xSum.u32 = ( ( xSum.u32 & 0xffu ) << 8 ) | ( ( xSum.u32 & 0xff00u ) >> 8 );
+	}
+
+	/* swap the output (little endian platform only). */
+	return FreeRTOS_htons( ( (uint16_t) xSum.u32 ) );
+}
+
+#endif /* ipconfigCHECKSUM_ACCUMULATOR_BITS */
+/*-----------------------------------------------------------*/
+
+#if( ipconfigUSE_CHECKSUM_COPY != 0 )
+
+	/* Copy one 32-bit word from any address to an aligned one, and return it. */
+	static portINLINE uint32_t prvCopyWord( uint32_t *pulTarget, const uint8_t *pucSource );
+	static portINLINE uint32_t prvCopyWord( uint32_t *pulTarget, const uint8_t *pucSource )
+	{
+	uint32_t ulWord;
+
+		/* memcpy() of 4 bytes becomes a single (unaligned) load. */
+		memcpy( &ulWord, pucSource, sizeof( ulWord ) );
+		*pulTarget = ulWord;
+
+		return ulWord;
+	}
+	/*-----------------------------------------------------------*/
+
+	/*
+	 * Copy and sum in one pass.  The alignment is taken from pucTarget, so the
+	 * words are stored at aligned addresses, the source may have any alignment.
+	 * The main loop handles 8 words (32 bytes) per iteration.
+	 */
+	uint16_t usGenerateChecksumCopy( uint32_t ulSum, uint8_t * pucTarget, const uint8_t * pucSource, size_t uxDataLengthBytes )
+	{
+	xUnion32 xSum, xTerm;
+	xUnionPtr xTarget;		/* Points to first byte */
+	uint32_t ulAlignBits;
+	uint16_t usHalf;
+	size_t uxWords;
+	#if( ipconfigCHECKSUM_ACCUMULATOR_BITS == 64 )
+		uint64_t ullAcc;
+	#else
+		uint32_t ulAcc, ulWord;
+		UBaseType_t uxIndex;
+	#endif
+
+		/* Swap the input (little endian platform only). */
+		xSum.u32 = FreeRTOS_ntohs( ulSum );
+		xTerm.u32 = 0ul;
+
+		xTarget.u8ptr = pucTarget;
+		ulAlignBits = ( ( ( uint32_t ) pucTarget ) & 0x03u ); /* gives 0, 1, 2, or 3 */
+
+		/* If byte (8-bit) aligned... */
+		if( ( ( ulAlignBits & 1ul ) != 0ul ) && ( uxDataLengthBytes >= ( size_t ) 1 ) )
+		{
+			xTerm.u8[ 1 ] = *pucSource;
+			*( xTarget.u8ptr ) = *pucSource;
+			( xTarget.u8ptr )++;
+			pucSource++;
+			uxDataLengthBytes--;
+		}
+
+		/* If half-word (16-bit) aligned... */
+		if( ( ( ulAlignBits == 1u ) || ( ulAlignBits == 2u ) ) && ( uxDataLengthBytes >= 2u ) )
+		{
+			memcpy( &usHalf, pucSource, sizeof( usHalf ) );
+			*( xTarget.u16ptr ) = usHalf;
+			xSum.u32 += usHalf;
+			( xTarget.u16ptr )++;
+			pucSource += 2;
+			uxDataLengthBytes -= 2u;
+		}
+
+		uxWords = uxDataLengthBytes / 4u;
+
+		#if( ipconfigCHECKSUM_ACCUMULATOR_BITS == 64 )
+		{
+			ullAcc = ( uint64_t ) xSum.u32 + xTerm.u32;
+
+			while( uxWords >= 8u )
+			{
+				ullAcc += ( uint64_t ) prvCopyWord( &( xTarget.u32ptr[ 0 ] ), &( pucSource[ 0 ] ) );
+				ullAcc += ( uint64_t ) prvCopyWord( &( xTarget.u32ptr[ 1 ] ), &( pucSource[ 4 ] ) );
+				ullAcc += ( uint64_t ) prvCopyWord( &( xTarget.u32ptr[ 2 ] ), &( pucSource[ 8 ] ) );
+				ullAcc += ( uint64_t ) prvCopyWord( &( xTarget.u32ptr[ 3 ] ), &( pucSource[ 12 ] ) );
+				ullAcc += ( uint64_t ) prvCopyWord( &( xTarget.u32ptr[ 4 ] ), &( pucSource[ 16 ] ) );
+				ullAcc += ( uint64_t ) prvCopyWord( &( xTarget.u32ptr[ 5 ] ), &( pucSource[ 20 ] ) );
+				ullAcc += ( uint64_t ) prvCopyWord( &( xTarget.u32ptr[ 6 ] ), &( pucSource[ 24 ] ) );
+				ullAcc += ( uint64_t ) prvCopyWord( &( xTarget.u32ptr[ 7 ] ), &( pucSource[ 28 ] ) );
+				xTarget.u32ptr += 8;
+				pucSource += 32;
+				uxWords -= 8u;
+			}
+
+			while( uxWords > 0u )
+			{
+				ullAcc += ( uint64_t ) prvCopyWord( xTarget.u32ptr, pucSource );
+				( xTarget.u32ptr )++;
+				pucSource += 4;
+				uxWords--;
+			}
+
+			/* Fold the 64-bit sum into 32 bits, twice for the carry. */
+			ullAcc = ( ullAcc & 0xffffffffull ) + ( ullAcc >> 32 );
+			ullAcc = ( ullAcc & 0xffffffffull ) + ( ullAcc >> 32 );
+			xSum.u32 = ( uint32_t ) ullAcc;
+			xSum.u32 = ( uint32_t ) xSum.u16[ 0 ] + xSum.u16[ 1 ];
+		}
+		#else
+		{
+			/* Add the 16-bit halves, and fold after every 8 words so that the
+			32-bit accumulator can not overflow. */
+			ulAcc = ( uint32_t ) xSum.u16[ 0 ] + xSum.u16[ 1 ] + xTerm.u16[ 0 ] + xTerm.u16[ 1 ];
+
+			while( uxWords > 0u )
+			{
+				for( uxIndex = 0u; ( uxIndex < 8u ) && ( uxWords > 0u ); uxIndex++ )
+				{
+					ulWord = prvCopyWord( xTarget.u32ptr, pucSource );
+					ulAcc += ( ulWord & 0xffffu ) + ( ulWord >> 16 );
+					( xTarget.u32ptr )++;
+					pucSource += 4;
+					uxWords--;
+				}
+
+				ulAcc = ( ulAcc & 0xffffu ) + ( ulAcc >> 16 );
+			}
+
+			xSum.u32 = ulAcc;
+		}
+		#endif /* ipconfigCHECKSUM_ACCUMULATOR_BITS */
+
+		/* The last half-word and byte. */
+		if( ( uxDataLengthBytes & 2u ) != 0u )
+		{
+			memcpy( &usHalf, pucSource, sizeof( usHalf ) );
+			*( xTarget.u16ptr ) = usHalf;
+			xSum.u32 += usHalf;
+			( xTarget.u16ptr )++;
+			pucSource += 2;
+		}
+
+		if( ( uxDataLengthBytes & ( size_t ) 1 ) != 0u )
+		{
+			xTerm.u32 = 0ul;
+			xTerm.u8[ 0 ] = *pucSource;
+			*( xTarget.u8ptr ) = *pucSource;
+			xSum.u32 += xTerm.u32;
+		}
+
+		/* Now add all carries, twice as the first addition may carry again. */
+		xSum.u32 = ( uint32_t ) xSum.u16[ 0 ] + xSum.u16[ 1 ];
+		xSum.u32 = ( uint32_t ) xSum.u16[ 0 ] + xSum.u16[ 1 ];
+
+		if( ( ulAlignBits & 1u ) != 0u )
+		{
+			/* pucTarget was odd, the checksum was calculated starting at an odd
+			position. */
+			xSum.u32 = ( ( xSum.u32 & 0xffu ) << 8 ) | ( ( xSum.u32 & 0xff00u ) >> 8 );
+		}
+
+		/* swap the output (little endian platform only). */
+		return FreeRTOS_htons( ( (uint16_t) xSum.u32 ) );
+	}
+
+#endif /* ipconfigUSE_CHECKSUM_COPY */
+/*-----------------------------------------------------------*/
+
 void vReturnEthernetFrame( NetworkBufferDescriptor_t * pxNetworkBuffer, BaseType_t xReleaseAfterSend )
 {
 EthernetHeader_t *pxEthernetHeader;
@@ -2297,6 +3093,52 @@ void FreeRTOS_SetGatewayAddress ( uint32_t ulGatewayAddress )
 #endif /* ipconfigDNS_USE_CALLBACKS != 0 */
 /*-----------------------------------------------------------*/
 
+#if( ipconfigARP_PENDING_PACKETS != 0 )
+	void vIPReloadARPPendingTimer( TickType_t xTime )
+	{
+		prvIPTimerReload( &xARPPendingTimer, xTime );
+	}
+#endif /* ipconfigARP_PENDING_PACKETS */
+/*-----------------------------------------------------------*/
+
+#if( ipconfigARP_PENDING_PACKETS != 0 )
+	void vIPSetARPPendingTimerEnableState( BaseType_t xEnableState )
+	{
+		if( xEnableState != pdFALSE )
+		{
+			xARPPendingTimer.bActive = pdTRUE_UNSIGNED;
+		}
+		else
+		{
+			xARPPendingTimer.bActive = pdFALSE_UNSIGNED;
+		}
+	}
+#endif /* ipconfigARP_PENDING_PACKETS */
+/*-----------------------------------------------------------*/
+
+#if( ipconfigUSE_DNS_CACHE_HASH != 0 )
+	void vIPReloadDNSCacheTimer( TickType_t xTime )
+	{
+		prvIPTimerReload( &xDNSCacheTimer, xTime );
+	}
+#endif /* ipconfigUSE_DNS_CACHE_HASH */
+/*-----------------------------------------------------------*/
+
+#if( ipconfigUSE_DNS_CACHE_HASH != 0 )
+	void vIPSetDNSCacheTimerEnableState( BaseType_t xEnableState )
+	{
+		if( xEnableState != pdFALSE )
+		{
+			xDNSCacheTimer.bActive = pdTRUE_UNSIGNED;
+		}
+		else
+		{
+			xDNSCacheTimer.bActive = pdFALSE_UNSIGNED;
+		}
+	}
+#endif /* ipconfigUSE_DNS_CACHE_HASH */
+/*-----------------------------------------------------------*/
+
 BaseType_t xIPIsNetworkTaskReady( void )
 {
 	return xIPTaskInitialised;
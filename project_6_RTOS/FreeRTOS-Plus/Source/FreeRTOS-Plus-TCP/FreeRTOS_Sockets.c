@@ -39,6 +39,7 @@
 #include "FreeRTOS_IP.h"
 #include "FreeRTOS_Sockets.h"
 #include "FreeRTOS_IP_Private.h"
+#include "FreeRTOS_ARP.h"
 #include "FreeRTOS_DNS.h"
 #include "NetworkBufferManagement.h"
 
@@ -72,6 +73,10 @@ range 1024-65535" excluding those already in use (inbound or outbound). */
 /* A block time of 0 simply means "don't block". */
 #define socketDONT_BLOCK				( ( TickType_t ) 0 )
 
+/* pdTRUE when tick count xA is not before xB, also when the tick count has
+wrapped in between. */
+#define socketTIME_NOT_BEFORE( xA, xB )	( ( ( TickType_t ) ( ( xA ) - ( xB ) ) ) <= ( portMAX_DELAY >> 1 ) )
+
 #if( ( ipconfigUSE_TCP == 1 ) && !defined( ipTCP_TIMER_PERIOD_MS ) )
 	#define ipTCP_TIMER_PERIOD_MS	( 1000 )
 #endif
@@ -90,6 +95,10 @@ respectively. */
 #define socketNEXT_UDP_PORT_NUMBER_INDEX	0
 #define socketNEXT_TCP_PORT_NUMBER_INDEX	1
 
+#if( ipconfigUSE_SOCKET_HASH == 1 )
+	/* The hash table bucket of a local port number (host byte order). */
+	#define socketHASH_PORT( usPort )	( ( ( usPort ) ^ ( ( usPort ) >> 8 ) ) & ( ipconfigSOCKET_HASH_BUCKETS - 1u ) )
+#endif /* ipconfigUSE_SOCKET_HASH */
 
 /*-----------------------------------------------------------*/
 
@@ -154,6 +163,37 @@ static BaseType_t prvDetermineSocketSize( BaseType_t xDomain, BaseType_t xType,
 	static FreeRTOS_Socket_t *prvFindSelectedSocket( SocketSelect_t *pxSocketSet );
 
 #endif /* ipconfigSUPPORT_SELECT_FUNCTION == 1 */
+
+#if( ipconfigUSE_SOCKET_HASH == 1 )
+	/*
+	 * Add a socket to the front of a hash bucket, or take it out of the bucket
+	 * it is in.
+	 */
+	static void prvSocketHashInsert( FreeRTOS_Socket_t **ppxBucket, FreeRTOS_Socket_t *pxSocket );
+	static void prvSocketHashRemove( FreeRTOS_Socket_t *pxSocket );
+#endif /* ipconfigUSE_SOCKET_HASH */
+
+#if( ( ipconfigUSE_SOCKET_HASH == 1 ) && ( ipconfigUSE_TCP == 1 ) )
+	/*
+	 * The hash table bucket of a TCP connection, all ports in host byte order.
+	 */
+	static UBaseType_t prvSocketHashConnection( uint16_t usLocalPort, uint32_t ulRemoteIP, uint16_t usRemotePort );
+#endif /* ipconfigUSE_SOCKET_HASH && ipconfigUSE_TCP */
+
+#if( ( ipconfigUSE_TCP == 1 ) && ( ipconfigUSE_TCP_TIMER_WHEEL == 1 ) )
+	/*
+	 * Put a socket in the timer wheel according to its usTimeout, of which
+	 * xElapsed ticks have already passed.  A socket that is due is added to
+	 * pxExpiredList.
+	 */
+	static void prvTCPTimerArm( FreeRTOS_Socket_t *pxSocket, List_t *pxExpiredList, TickType_t xNow, TickType_t xElapsed );
+
+	/*
+	 * Take a socket out of the timer wheel and out of the list of changed
+	 * sockets.
+	 */
+	static void prvTCPTimerRemove( FreeRTOS_Socket_t *pxSocket );
+#endif /* ipconfigUSE_TCP && ipconfigUSE_TCP_TIMER_WHEEL */
 /*-----------------------------------------------------------*/
 
 /* The list that contains mappings between sockets and port numbers.  Accesses
@@ -164,6 +204,39 @@ List_t xBoundUDPSocketsList;
 	List_t xBoundTCPSocketsList;
 #endif /* ipconfigUSE_TCP == 1 */
 
+#if( ipconfigUSE_SOCKET_HASH == 1 )
+	/* Hash tables over the bound sockets, to find the socket of a received
+	packet without walking the lists above.  A UDP socket, and a TCP socket
+	bound by the application (a listening socket or a client), is the only one
+	bound to its port and is found by the port number.  The child sockets that
+	a listening socket creates share its port number, so they are found by the
+	local port, remote IP address and remote port of their connection.  The
+	tables are only used by the IP-task: sockets are added in vSocketBind() and
+	vSocketHashAddConnection() and removed in vSocketClose(). */
+	static FreeRTOS_Socket_t *pxUDPPortHash[ ipconfigSOCKET_HASH_BUCKETS ];
+
+	#if( ipconfigUSE_TCP == 1 )
+		static FreeRTOS_Socket_t *pxTCPPortHash[ ipconfigSOCKET_HASH_BUCKETS ];
+		static FreeRTOS_Socket_t *pxTCPConnectionHash[ ipconfigSOCKET_HASH_BUCKETS ];
+	#endif /* ipconfigUSE_TCP == 1 */
+#endif /* ipconfigUSE_SOCKET_HASH */
+
+#if( ( ipconfigUSE_TCP == 1 ) && ( ipconfigUSE_TCP_TIMER_WHEEL == 1 ) )
+	/* The TCP timer wheel.  A bound TCP socket with a time-out is in slot
+	( deadline % ipconfigTCP_TIMER_WHEEL_SLOTS ), the item value of its
+	xTimerListItem is the deadline in ticks.  xTCPTimerWheelEarliest[] holds a
+	deadline that is not later than any deadline in the slot, so that a slot
+	only has to be searched when it may have a socket that is due.  The wheel is
+	only used by the IP-task. */
+	static List_t xTCPTimerWheel[ ipconfigTCP_TIMER_WHEEL_SLOTS ];
+	static TickType_t xTCPTimerWheelEarliest[ ipconfigTCP_TIMER_WHEEL_SLOTS ];
+
+	/* The sockets of which usTimeout or xEventBits have changed since the last
+	call to xTCPTimerCheck().  The API may add sockets to it, so it is accessed
+	from within a critical section. */
+	static List_t xTCPTimerChangedList;
+#endif /* ipconfigUSE_TCP && ipconfigUSE_TCP_TIMER_WHEEL */
+
 /*-----------------------------------------------------------*/
 
 static BaseType_t prvValidSocket( FreeRTOS_Socket_t *pxSocket, BaseType_t xProtocol, BaseType_t xIsBound )
@@ -196,6 +269,18 @@ BaseType_t vNetworkSocketsInit( void )
 	#if( ipconfigUSE_TCP == 1 )
 	{
 		vListInitialise( &xBoundTCPSocketsList );
+
+		#if( ipconfigUSE_TCP_TIMER_WHEEL == 1 )
+		{
+		UBaseType_t uxSlot;
+
+			for( uxSlot = 0u; uxSlot < ( UBaseType_t ) ipconfigTCP_TIMER_WHEEL_SLOTS; uxSlot++ )
+			{
+				vListInitialise( &( xTCPTimerWheel[ uxSlot ] ) );
+			}
+			vListInitialise( &xTCPTimerChangedList );
+		}
+		#endif /* ipconfigUSE_TCP_TIMER_WHEEL */
 	}
 	#endif  /* ipconfigUSE_TCP == 1 */
 
@@ -346,6 +431,15 @@ Socket_t xReturn;
 					/* The above values are just defaults, and can be overridden by
 					calling FreeRTOS_setsockopt().  No buffers will be allocated until a
 					socket is connected and data is exchanged. */
+
+					#if( ipconfigUSE_TCP_TIMER_WHEEL == 1 )
+					{
+						vListInitialiseItem( &( pxSocket->u.xTCP.xTimerListItem ) );
+						listSET_LIST_ITEM_OWNER( &( pxSocket->u.xTCP.xTimerListItem ), ( void * ) pxSocket );
+						vListInitialiseItem( &( pxSocket->u.xTCP.xTimerChangedItem ) );
+						listSET_LIST_ITEM_OWNER( &( pxSocket->u.xTCP.xTimerChangedItem ), ( void * ) pxSocket );
+					}
+					#endif /* ipconfigUSE_TCP_TIMER_WHEEL */
 				}
 			}
 			#endif  /* ipconfigUSE_TCP == 1 */
@@ -1058,6 +1152,36 @@ List_t *pxSocketList;
 				}
 				#endif /* ipconfigETHERNET_DRIVER_FILTERS_PACKETS */
 			}
+
+			#if( ipconfigUSE_SOCKET_HASH == 1 )
+			{
+				#if( ipconfigUSE_TCP == 1 )
+				if( pxSocket->ucProtocol == ( uint8_t ) FREERTOS_IPPROTO_TCP )
+				{
+					/* A child socket (xInternal) shares the port of its parent,
+					it is added to the connection table once its peer is known. */
+					if( xInternal == pdFALSE )
+					{
+						prvSocketHashInsert( &( pxTCPPortHash[ socketHASH_PORT( pxSocket->usLocalPort ) ] ), pxSocket );
+					}
+				}
+				else
+				#endif /* ipconfigUSE_TCP == 1 */
+				{
+					prvSocketHashInsert( &( pxUDPPortHash[ socketHASH_PORT( pxSocket->usLocalPort ) ] ), pxSocket );
+				}
+			}
+			#endif /* ipconfigUSE_SOCKET_HASH */
+
+			#if( ( ipconfigUSE_TCP == 1 ) && ( ipconfigUSE_TCP_TIMER_WHEEL == 1 ) )
+			{
+				/* Time-outs set before binding were ignored by xTCPTimerCheck(). */
+				if( pxSocket->ucProtocol == ( uint8_t ) FREERTOS_IPPROTO_TCP )
+				{
+					vTCPTimerSocketChanged( pxSocket );
+				}
+			}
+			#endif /* ipconfigUSE_TCP && ipconfigUSE_TCP_TIMER_WHEEL */
 		}
 	}
 	else
@@ -1166,6 +1290,12 @@ NetworkBufferDescriptor_t *pxNetworkBuffer;
 			/* In case this is a child socket, make sure the child-count of the
 			parent socket is decreased. */
 			prvTCPSetSocketCount( pxSocket );
+
+			#if( ipconfigUSE_TCP_TIMER_WHEEL == 1 )
+			{
+				prvTCPTimerRemove( pxSocket );
+			}
+			#endif /* ipconfigUSE_TCP_TIMER_WHEEL */
 		}
 	}
 	#endif  /* ipconfigUSE_TCP == 1 */
@@ -1190,6 +1320,12 @@ NetworkBufferDescriptor_t *pxNetworkBuffer;
 			xTaskResumeAll();
 		}
 		#endif /* ipconfigETHERNET_DRIVER_FILTERS_PACKETS */
+
+		#if( ipconfigUSE_SOCKET_HASH == 1 )
+		{
+			prvSocketHashRemove( pxSocket );
+		}
+		#endif /* ipconfigUSE_SOCKET_HASH */
 	}
 
 	/* Now the socket is not bound the list of waiting packets can be
@@ -1563,6 +1699,7 @@ FreeRTOS_Socket_t *pxSocket;
 						( FreeRTOS_outstanding( pxSocket ) != 0 ) )
 					{
 						pxSocket->u.xTCP.usTimeout = 1u; /* to set/clear bSendFullSize */
+						ipTCP_TIMER_SOCKET_CHANGED( pxSocket );
 						xSendEventToIPTask( eTCPTimerEvent );
 					}
 				}
@@ -1587,6 +1724,7 @@ FreeRTOS_Socket_t *pxSocket;
 
 					pxSocket->u.xTCP.bits.bWinChange = pdTRUE_UNSIGNED;
 					pxSocket->u.xTCP.usTimeout = 1u; /* to set/clear bRxStopped */
+					ipTCP_TIMER_SOCKET_CHANGED( pxSocket );
 					xSendEventToIPTask( eTCPTimerEvent );
 				}
 				xReturn = 0;
@@ -1705,25 +1843,123 @@ const ListItem_t * pxResult = NULL;
 
 /*-----------------------------------------------------------*/
 
-FreeRTOS_Socket_t *pxUDPSocketLookup( UBaseType_t uxLocalPort )
-{
-const ListItem_t *pxListItem;
-FreeRTOS_Socket_t *pxSocket = NULL;
+#if( ipconfigUSE_SOCKET_HASH == 0 )
+
+	FreeRTOS_Socket_t *pxUDPSocketLookup( UBaseType_t uxLocalPort )
+	{
+	const ListItem_t *pxListItem;
+	FreeRTOS_Socket_t *pxSocket = NULL;
 
-	/* Looking up a socket is quite simple, find a match with the local port.
+		/* Looking up a socket is quite simple, find a match with the local port.
 
-	See if there is a list item associated with the port number on the
-	list of bound sockets. */
-	pxListItem = pxListFindListItemWithValue( &xBoundUDPSocketsList, ( TickType_t ) uxLocalPort );
+		See if there is a list item associated with the port number on the
+		list of bound sockets. */
+		pxListItem = pxListFindListItemWithValue( &xBoundUDPSocketsList, ( TickType_t ) uxLocalPort );
 
-	if( pxListItem != NULL )
+		if( pxListItem != NULL )
+		{
+			/* The owner of the list item is the socket itself. */
+			pxSocket = ( FreeRTOS_Socket_t * ) listGET_LIST_ITEM_OWNER( pxListItem );
+			configASSERT( pxSocket != NULL );
+		}
+		return pxSocket;
+	}
+
+#else
+
+	FreeRTOS_Socket_t *pxUDPSocketLookup( UBaseType_t uxLocalPort )
 	{
-		/* The owner of the list item is the socket itself. */
-		pxSocket = ( FreeRTOS_Socket_t * ) listGET_LIST_ITEM_OWNER( pxListItem );
-		configASSERT( pxSocket != NULL );
+	FreeRTOS_Socket_t *pxSocket;
+	uint16_t usLocalPort = FreeRTOS_ntohs( ( uint16_t ) uxLocalPort );
+
+		/* uxLocalPort is in network byte order, like the list item values.
+		The port is unique among the UDP sockets, and the bucket holds only
+		the sockets of a few ports. */
+		for( pxSocket  = pxUDPPortHash[ socketHASH_PORT( usLocalPort ) ];
+			 pxSocket != NULL;
+			 pxSocket  = pxSocket->pxHashNext )
+		{
+			if( pxSocket->usLocalPort == usLocalPort )
+			{
+				break;
+			}
+		}
+
+		return pxSocket;
+	}
+
+#endif /* ipconfigUSE_SOCKET_HASH */
+/*-----------------------------------------------------------*/
+
+#if( ipconfigUSE_SOCKET_HASH == 1 )
+
+	static void prvSocketHashInsert( FreeRTOS_Socket_t **ppxBucket, FreeRTOS_Socket_t *pxSocket )
+	{
+		pxSocket->pxHashNext = *ppxBucket;
+		pxSocket->ppxHashBucket = ppxBucket;
+		*ppxBucket = pxSocket;
+	}
+
+#endif /* ipconfigUSE_SOCKET_HASH */
+/*-----------------------------------------------------------*/
+
+#if( ipconfigUSE_SOCKET_HASH == 1 )
+
+	static void prvSocketHashRemove( FreeRTOS_Socket_t *pxSocket )
+	{
+	FreeRTOS_Socket_t **ppxLink;
+
+		if( pxSocket->ppxHashBucket != NULL )
+		{
+			for( ppxLink  = pxSocket->ppxHashBucket;
+				 *ppxLink != NULL;
+				 ppxLink  = &( ( *ppxLink )->pxHashNext ) )
+			{
+				if( *ppxLink == pxSocket )
+				{
+					*ppxLink = pxSocket->pxHashNext;
+					break;
+				}
+			}
+
+			pxSocket->ppxHashBucket = NULL;
+			pxSocket->pxHashNext = NULL;
+		}
 	}
-	return pxSocket;
-}
+
+#endif /* ipconfigUSE_SOCKET_HASH */
+/*-----------------------------------------------------------*/
+
+#if( ( ipconfigUSE_SOCKET_HASH == 1 ) && ( ipconfigUSE_TCP == 1 ) )
+
+	static UBaseType_t prvSocketHashConnection( uint16_t usLocalPort, uint32_t ulRemoteIP, uint16_t usRemotePort )
+	{
+	uint32_t ulHash;
+
+		/* The connections to one server port often differ only in the remote
+		port, or come from consecutive addresses: a multiplicative hash spreads
+		them over the buckets through the upper bits. */
+		ulHash = ( ulRemoteIP ^ ( ( ( uint32_t ) usRemotePort ) << 16 ) ^ ( uint32_t ) usLocalPort ) * 0x9E3779B1uL;
+
+		return ( UBaseType_t ) ( ( ulHash >> 16 ) & ( ipconfigSOCKET_HASH_BUCKETS - 1u ) );
+	}
+
+#endif /* ipconfigUSE_SOCKET_HASH && ipconfigUSE_TCP */
+/*-----------------------------------------------------------*/
+
+#if( ( ipconfigUSE_SOCKET_HASH == 1 ) && ( ipconfigUSE_TCP == 1 ) )
+
+	void vSocketHashAddConnection( FreeRTOS_Socket_t *pxSocket )
+	{
+	UBaseType_t uxBucket;
+
+		uxBucket = prvSocketHashConnection( pxSocket->usLocalPort, pxSocket->u.xTCP.ulRemoteIP, pxSocket->u.xTCP.usRemotePort );
+
+		prvSocketHashRemove( pxSocket );
+		prvSocketHashInsert( &( pxTCPConnectionHash[ uxBucket ] ), pxSocket );
+	}
+
+#endif /* ipconfigUSE_SOCKET_HASH && ipconfigUSE_TCP */
 
 /*-----------------------------------------------------------*/
 
@@ -1975,6 +2211,7 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t *pxSocket )
 
 				/* To start an active connect. */
 				pxSocket->u.xTCP.usTimeout = 1u;
+				ipTCP_TIMER_SOCKET_CHANGED( pxSocket );
 
 				if( xSendEventToIPTask( eTCPTimerEvent ) != pdPASS )
 				{
@@ -2338,6 +2575,7 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t *pxSocket )
 							pxSocket->u.xTCP.bits.bLowWater = pdFALSE_UNSIGNED;
 							pxSocket->u.xTCP.bits.bWinChange = pdTRUE_UNSIGNED;
 							pxSocket->u.xTCP.usTimeout = 1u; /* because bLowWater is cleared. */
+							ipTCP_TIMER_SOCKET_CHANGED( pxSocket );
 							xSendEventToIPTask( eTCPTimerEvent );
 						}
 					}
@@ -2515,6 +2753,7 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t *pxSocket )
 					/* Send a message to the IP-task so it can work on this
 					socket.  Data is sent, let the IP-task work on it. */
 					pxSocket->u.xTCP.usTimeout = 1u;
+					ipTCP_TIMER_SOCKET_CHANGED( pxSocket );
 
 					if( xIsCallingFromIPTask() == pdFALSE )
 					{
@@ -2704,6 +2943,7 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t *pxSocket )
 
 			/* Let the IP-task perform the shutdown of the connection. */
 			pxSocket->u.xTCP.usTimeout = 1u;
+			ipTCP_TIMER_SOCKET_CHANGED( pxSocket );
 			xSendEventToIPTask( eTCPTimerEvent );
 			xResult = 0;
 		}
@@ -2715,7 +2955,49 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t *pxSocket )
 #endif /* ipconfigUSE_TCP */
 /*-----------------------------------------------------------*/
 
-#if( ipconfigUSE_TCP == 1 )
+#if( ( ipconfigUSE_TCP == 1 ) && ( ipconfigARP_PENDING_PACKETS != 0 ) )
+
+	void vTCPWakeUpConnectingSockets( void )
+	{
+	FreeRTOS_Socket_t *pxSocket;
+	const ListItem_t *pxEnd = ( const ListItem_t * ) listGET_END_MARKER( &xBoundTCPSocketsList );
+	const ListItem_t *pxIterator;
+	uint32_t ulIPAddress;
+	MACAddress_t xMACAddress;
+	BaseType_t xWakeUp = pdFALSE;
+
+		for( pxIterator = ( const ListItem_t * ) listGET_HEAD_ENTRY( &xBoundTCPSocketsList );
+			 pxIterator != pxEnd;
+			 pxIterator = ( const ListItem_t * ) listGET_NEXT( pxIterator ) )
+		{
+			pxSocket = ( FreeRTOS_Socket_t * ) listGET_LIST_ITEM_OWNER( pxIterator );
+
+			if( ( pxSocket->u.xTCP.ucTCPState == eCONNECT_SYN ) &&
+				( pxSocket->u.xTCP.bits.bConnPrepared == pdFALSE_UNSIGNED ) )
+			{
+				/* Only wake up the sockets that will find the MAC address,
+				each try counts. */
+				ulIPAddress = FreeRTOS_htonl( pxSocket->u.xTCP.ulRemoteIP );
+
+				if( eARPGetCacheEntry( &ulIPAddress, &xMACAddress ) == eARPCacheHit )
+				{
+					pxSocket->u.xTCP.usTimeout = 1u;
+					ipTCP_TIMER_SOCKET_CHANGED( pxSocket );
+					xWakeUp = pdTRUE;
+				}
+			}
+		}
+
+		if( xWakeUp != pdFALSE )
+		{
+			( void ) xSendEventToIPTask( eTCPTimerEvent );
+		}
+	}
+
+#endif /* ipconfigUSE_TCP && ipconfigARP_PENDING_PACKETS */
+/*-----------------------------------------------------------*/
+
+#if( ( ipconfigUSE_TCP == 1 ) && ( ipconfigUSE_TCP_TIMER_WHEEL == 0 ) )
 
 	/*
 	 * A TCP timer has expired, now check all TCP sockets for:
@@ -2800,7 +3082,279 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t *pxSocket )
 		return xShortest;
 	}
 
-#endif /* ipconfigUSE_TCP */
+#endif /* ipconfigUSE_TCP && ipconfigUSE_TCP_TIMER_WHEEL == 0 */
+/*-----------------------------------------------------------*/
+
+#if( ( ipconfigUSE_TCP == 1 ) && ( ipconfigUSE_TCP_TIMER_WHEEL == 1 ) )
+
+	void vTCPTimerSocketChanged( FreeRTOS_Socket_t *pxSocket )
+	{
+		taskENTER_CRITICAL();
+		{
+			if( listLIST_ITEM_CONTAINER( &( pxSocket->u.xTCP.xTimerChangedItem ) ) == NULL )
+			{
+				vListInsertEnd( &xTCPTimerChangedList, &( pxSocket->u.xTCP.xTimerChangedItem ) );
+			}
+		}
+		taskEXIT_CRITICAL();
+	}
+	/*-----------------------------------------------------------*/
+
+	static void prvTCPTimerArm( FreeRTOS_Socket_t *pxSocket, List_t *pxExpiredList, TickType_t xNow, TickType_t xElapsed )
+	{
+	ListItem_t *pxItem = &( pxSocket->u.xTCP.xTimerListItem );
+	TickType_t xTimeout = ( TickType_t ) pxSocket->u.xTCP.usTimeout;
+	TickType_t xDeadline;
+	UBaseType_t uxSlot;
+
+		if( listLIST_ITEM_CONTAINER( pxItem ) != NULL )
+		{
+			( void ) uxListRemove( pxItem );
+		}
+
+		pxSocket->u.xTCP.usTimerArmed = pxSocket->u.xTCP.usTimeout;
+
+		/* Sockets with 'tmout == 0' do not need any regular attention. */
+		if( xTimeout != 0u )
+		{
+			if( xElapsed >= xTimeout )
+			{
+				vListInsertEnd( pxExpiredList, pxItem );
+			}
+			else
+			{
+				xDeadline = xNow + ( xTimeout - xElapsed );
+				uxSlot = ( UBaseType_t ) ( xDeadline & ( TickType_t ) ( ipconfigTCP_TIMER_WHEEL_SLOTS - 1 ) );
+
+				if( ( listLIST_IS_EMPTY( &( xTCPTimerWheel[ uxSlot ] ) ) != pdFALSE ) ||
+					( socketTIME_NOT_BEFORE( xDeadline, xTCPTimerWheelEarliest[ uxSlot ] ) == pdFALSE ) )
+				{
+					xTCPTimerWheelEarliest[ uxSlot ] = xDeadline;
+				}
+
+				listSET_LIST_ITEM_VALUE( pxItem, xDeadline );
+				vListInsertEnd( &( xTCPTimerWheel[ uxSlot ] ), pxItem );
+			}
+		}
+	}
+	/*-----------------------------------------------------------*/
+
+	static void prvTCPTimerRemove( FreeRTOS_Socket_t *pxSocket )
+	{
+		if( listLIST_ITEM_CONTAINER( &( pxSocket->u.xTCP.xTimerListItem ) ) != NULL )
+		{
+			( void ) uxListRemove( &( pxSocket->u.xTCP.xTimerListItem ) );
+		}
+
+		taskENTER_CRITICAL();
+		{
+			if( listLIST_ITEM_CONTAINER( &( pxSocket->u.xTCP.xTimerChangedItem ) ) != NULL )
+			{
+				( void ) uxListRemove( &( pxSocket->u.xTCP.xTimerChangedItem ) );
+			}
+		}
+		taskEXIT_CRITICAL();
+	}
+	/*-----------------------------------------------------------*/
+
+	/*
+	 * A TCP timer has expired.  Look at the sockets that were changed since
+	 * the last call and at the sockets of which the time-out has been reached,
+	 * for:
+	 * - Active connect
+	 * - Send a delayed ACK
+	 * - Send new data
+	 * - Send a keep-alive packet
+	 * - Check for timeout (in non-connected states only)
+	 * The other sockets stay in the timer wheel and are not touched.
+	 */
+	TickType_t xTCPTimerCheck( BaseType_t xWillSleep )
+	{
+	FreeRTOS_Socket_t *pxSocket;
+	TickType_t xShortest = pdMS_TO_TICKS( ( TickType_t ) ipTCP_TIMER_PERIOD_MS );
+	TickType_t xNow = xTaskGetTickCount();
+	static TickType_t xLastTime = 0u;
+	TickType_t xDelta = xNow - xLastTime;
+	TickType_t xDeadline, xEarliest;
+	List_t xExpiredList;
+	ListItem_t *pxIterator, *pxNext, *pxEnd;
+	UBaseType_t uxCount, uxSlot;
+	BaseType_t xFound, xEmpty;
+	BaseType_t rc;
+
+		xLastTime = xNow;
+
+		if( xDelta == 0u )
+		{
+			xDelta = 1u;
+		}
+
+		vListInitialise( &xExpiredList );
+
+		/* First the sockets of which the time-out or events have changed.  A
+		time-out that was set since the last call has been running for at most
+		xDelta ticks.  Sockets that are added while doing this will be seen
+		during the next call. */
+		taskENTER_CRITICAL();
+		{
+			uxCount = listCURRENT_LIST_LENGTH( &xTCPTimerChangedList );
+		}
+		taskEXIT_CRITICAL();
+
+		for( ; uxCount > 0u; uxCount-- )
+		{
+			taskENTER_CRITICAL();
+			{
+				pxSocket = ( FreeRTOS_Socket_t * ) listGET_OWNER_OF_HEAD_ENTRY( &xTCPTimerChangedList );
+				( void ) uxListRemove( &( pxSocket->u.xTCP.xTimerChangedItem ) );
+			}
+			taskEXIT_CRITICAL();
+
+			if( socketSOCKET_IS_BOUND( pxSocket ) == pdFALSE )
+			{
+				/* vSocketBind() will add the socket again. */
+				continue;
+			}
+
+			/* A time-out that is still the same keeps its deadline. */
+			if( ( pxSocket->u.xTCP.usTimeout != pxSocket->u.xTCP.usTimerArmed ) ||
+				( listLIST_ITEM_CONTAINER( &( pxSocket->u.xTCP.xTimerListItem ) ) == NULL ) )
+			{
+				prvTCPTimerArm( pxSocket, &xExpiredList, xNow, xDelta );
+			}
+
+			if( pxSocket->xEventBits != 0u )
+			{
+				if( xWillSleep != pdFALSE )
+				{
+					vSocketWakeUpUser( pxSocket );
+				}
+				else
+				{
+					/* Wake-up the owner during a next call. */
+					vTCPTimerSocketChanged( pxSocket );
+					xShortest = ( TickType_t ) 0;
+				}
+			}
+		}
+
+		/* Move the sockets of which the deadline has been reached from the
+		wheel to xExpiredList.  Only slots that may hold such a socket are
+		searched. */
+		for( uxSlot = 0u; uxSlot < ( UBaseType_t ) ipconfigTCP_TIMER_WHEEL_SLOTS; uxSlot++ )
+		{
+			if( ( listLIST_IS_EMPTY( &( xTCPTimerWheel[ uxSlot ] ) ) == pdFALSE ) &&
+				( socketTIME_NOT_BEFORE( xNow, xTCPTimerWheelEarliest[ uxSlot ] ) != pdFALSE ) )
+			{
+				pxEnd = ( ListItem_t * ) listGET_END_MARKER( &( xTCPTimerWheel[ uxSlot ] ) );
+				pxIterator = ( ListItem_t * ) listGET_HEAD_ENTRY( &( xTCPTimerWheel[ uxSlot ] ) );
+				xEarliest = 0u;
+				xFound = pdFALSE;
+
+				while( pxIterator != pxEnd )
+				{
+					pxNext = ( ListItem_t * ) listGET_NEXT( pxIterator );
+					xDeadline = listGET_LIST_ITEM_VALUE( pxIterator );
+
+					if( socketTIME_NOT_BEFORE( xNow, xDeadline ) != pdFALSE )
+					{
+						( void ) uxListRemove( pxIterator );
+						vListInsertEnd( &xExpiredList, pxIterator );
+					}
+					else if( ( xFound == pdFALSE ) || ( socketTIME_NOT_BEFORE( xDeadline, xEarliest ) == pdFALSE ) )
+					{
+						xEarliest = xDeadline;
+						xFound = pdTRUE;
+					}
+
+					pxIterator = pxNext;
+				}
+
+				xTCPTimerWheelEarliest[ uxSlot ] = xEarliest;
+			}
+		}
+
+		while( listLIST_IS_EMPTY( &xExpiredList ) == pdFALSE )
+		{
+			pxSocket = ( FreeRTOS_Socket_t * ) listGET_OWNER_OF_HEAD_ENTRY( &xExpiredList );
+			( void ) uxListRemove( &( pxSocket->u.xTCP.xTimerListItem ) );
+
+			pxSocket->u.xTCP.usTimeout = 0u;
+			rc = xTCPSocketCheck( pxSocket );
+
+			/* Within this function, the socket might want to send a delayed
+			ack or send out data or whatever it needs to do. */
+			if( rc < 0 )
+			{
+				/* Continue because the socket was deleted. */
+				continue;
+			}
+
+			/* xTCPSocketCheck() has set the next time-out, which starts now. */
+			taskENTER_CRITICAL();
+			{
+				if( listLIST_ITEM_CONTAINER( &( pxSocket->u.xTCP.xTimerChangedItem ) ) != NULL )
+				{
+					( void ) uxListRemove( &( pxSocket->u.xTCP.xTimerChangedItem ) );
+				}
+			}
+			taskEXIT_CRITICAL();
+
+			prvTCPTimerArm( pxSocket, &xExpiredList, xNow, 0u );
+
+			/* In xEventBits the driver may indicate that the socket has
+			important events for the user.  These are only done just before the
+			IP-task goes to sleep. */
+			if( pxSocket->xEventBits != 0u )
+			{
+				if( xWillSleep != pdFALSE )
+				{
+					/* The IP-task is about to go to sleep, so messages can be
+					sent to the socket owners. */
+					vSocketWakeUpUser( pxSocket );
+				}
+				else
+				{
+					/* Or else make sure this will be called again to wake-up
+					the sockets' owner. */
+					vTCPTimerSocketChanged( pxSocket );
+					xShortest = ( TickType_t ) 0;
+				}
+			}
+		}
+
+		/* Sleep until the earliest deadline in the wheel, or not at all if
+		other sockets have changed in the mean time. */
+		for( uxSlot = 0u; uxSlot < ( UBaseType_t ) ipconfigTCP_TIMER_WHEEL_SLOTS; uxSlot++ )
+		{
+			if( listLIST_IS_EMPTY( &( xTCPTimerWheel[ uxSlot ] ) ) == pdFALSE )
+			{
+				if( socketTIME_NOT_BEFORE( xNow, xTCPTimerWheelEarliest[ uxSlot ] ) != pdFALSE )
+				{
+					xShortest = ( TickType_t ) 0;
+				}
+				else if( xShortest > ( xTCPTimerWheelEarliest[ uxSlot ] - xNow ) )
+				{
+					xShortest = xTCPTimerWheelEarliest[ uxSlot ] - xNow;
+				}
+			}
+		}
+
+		taskENTER_CRITICAL();
+		{
+			xEmpty = listLIST_IS_EMPTY( &xTCPTimerChangedList );
+		}
+		taskEXIT_CRITICAL();
+
+		if( xEmpty == pdFALSE )
+		{
+			xShortest = ( TickType_t ) 0;
+		}
+
+		return xShortest;
+	}
+
+#endif /* ipconfigUSE_TCP && ipconfigUSE_TCP_TIMER_WHEEL */
 /*-----------------------------------------------------------*/
 
 #if( ipconfigUSE_TCP == 1 )
@@ -2813,36 +3367,89 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t *pxSocket )
 	 */
 	FreeRTOS_Socket_t *pxTCPSocketLookup( uint32_t ulLocalIP, UBaseType_t uxLocalPort, uint32_t ulRemoteIP, UBaseType_t uxRemotePort )
 	{
-	ListItem_t *pxIterator;
 	FreeRTOS_Socket_t *pxResult = NULL, *pxListenSocket = NULL;
-	MiniListItem_t *pxEnd = ( MiniListItem_t* )listGET_END_MARKER( &xBoundTCPSocketsList );
+	#if( ipconfigUSE_SOCKET_HASH == 1 )
+		FreeRTOS_Socket_t *pxSocket;
+		UBaseType_t uxBucket;
+	#else
+		ListItem_t *pxIterator;
+		MiniListItem_t *pxEnd = ( MiniListItem_t* )listGET_END_MARKER( &xBoundTCPSocketsList );
+	#endif /* ipconfigUSE_SOCKET_HASH */
 
 		/* Parameter not yet supported. */
 		( void ) ulLocalIP;
 
-		for( pxIterator  = ( ListItem_t * ) listGET_NEXT( pxEnd );
-			 pxIterator != ( ListItem_t * ) pxEnd;
-			 pxIterator  = ( ListItem_t * ) listGET_NEXT( pxIterator ) )
+		#if( ipconfigUSE_SOCKET_HASH == 1 )
 		{
-			FreeRTOS_Socket_t *pxSocket = ( FreeRTOS_Socket_t * ) listGET_LIST_ITEM_OWNER( pxIterator );
+			/* First a child socket of a listening socket, connected to this
+			peer. */
+			uxBucket = prvSocketHashConnection( ( uint16_t ) uxLocalPort, ulRemoteIP, ( uint16_t ) uxRemotePort );
 
-			if( pxSocket->usLocalPort == ( uint16_t ) uxLocalPort )
+			for( pxSocket  = pxTCPConnectionHash[ uxBucket ];
+				 pxSocket != NULL;
+				 pxSocket  = pxSocket->pxHashNext )
 			{
-				if( pxSocket->u.xTCP.ucTCPState == eTCP_LISTEN )
+				if( ( pxSocket->usLocalPort == ( uint16_t ) uxLocalPort ) &&
+					( pxSocket->u.xTCP.usRemotePort == ( uint16_t ) uxRemotePort ) &&
+					( pxSocket->u.xTCP.ulRemoteIP == ulRemoteIP ) )
 				{
-					/* If this is a socket listening to uxLocalPort, remember it
-					in case there is no perfect match. */
-					pxListenSocket = pxSocket;
-				}
-				else if( ( pxSocket->u.xTCP.usRemotePort == ( uint16_t ) uxRemotePort ) && ( pxSocket->u.xTCP.ulRemoteIP == ulRemoteIP ) )
-				{
-					/* For sockets not in listening mode, find a match with
-					xLocalPort, ulRemoteIP AND xRemotePort. */
 					pxResult = pxSocket;
 					break;
 				}
 			}
+
+			if( pxResult == NULL )
+			{
+				/* Otherwise the socket bound to the port by the application:
+				a listening socket, or a client (or a listening socket with
+				bReuseSocket) connected to this peer. */
+				for( pxSocket  = pxTCPPortHash[ socketHASH_PORT( ( uint16_t ) uxLocalPort ) ];
+					 pxSocket != NULL;
+					 pxSocket  = pxSocket->pxHashNext )
+				{
+					if( pxSocket->usLocalPort == ( uint16_t ) uxLocalPort )
+					{
+						if( pxSocket->u.xTCP.ucTCPState == eTCP_LISTEN )
+						{
+							pxListenSocket = pxSocket;
+						}
+						else if( ( pxSocket->u.xTCP.usRemotePort == ( uint16_t ) uxRemotePort ) && ( pxSocket->u.xTCP.ulRemoteIP == ulRemoteIP ) )
+						{
+							pxResult = pxSocket;
+						}
+						break;
+					}
+				}
+			}
+		}
+		#else
+		{
+			for( pxIterator  = ( ListItem_t * ) listGET_NEXT( pxEnd );
+				 pxIterator != ( ListItem_t * ) pxEnd;
+				 pxIterator  = ( ListItem_t * ) listGET_NEXT( pxIterator ) )
+			{
+				FreeRTOS_Socket_t *pxSocket = ( FreeRTOS_Socket_t * ) listGET_LIST_ITEM_OWNER( pxIterator );
+
+				if( pxSocket->usLocalPort == ( uint16_t ) uxLocalPort )
+				{
+					if( pxSocket->u.xTCP.ucTCPState == eTCP_LISTEN )
+					{
+						/* If this is a socket listening to uxLocalPort, remember it
+						in case there is no perfect match. */
+						pxListenSocket = pxSocket;
+					}
+					else if( ( pxSocket->u.xTCP.usRemotePort == ( uint16_t ) uxRemotePort ) && ( pxSocket->u.xTCP.ulRemoteIP == ulRemoteIP ) )
+					{
+						/* For sockets not in listening mode, find a match with
+						xLocalPort, ulRemoteIP AND xRemotePort. */
+						pxResult = pxSocket;
+						break;
+					}
+				}
+			}
 		}
+		#endif /* ipconfigUSE_SOCKET_HASH */
+
 		if( pxResult == NULL )
 		{
 			/* An exact match was not found, maybe a listening socket was
@@ -3044,6 +3651,7 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t *pxSocket )
 
 						/* bLowWater was reached, send the changed window size. */
 						pxSocket->u.xTCP.usTimeout = 1u;
+						ipTCP_TIMER_SOCKET_CHANGED( pxSocket );
 						xSendEventToIPTask( eTCPTimerEvent );
 					}
 				}
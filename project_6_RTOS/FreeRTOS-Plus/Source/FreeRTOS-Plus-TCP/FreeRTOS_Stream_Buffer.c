@@ -197,3 +197,66 @@ size_t uxSize, uxCount, uxFirst, uxNextTail;
 	return uxCount;
 }
 
+#if( ipconfigUSE_CHECKSUM_COPY != 0 )
+
+	/*
+	 * uxStreamBufferGetChecksum( )
+	 * Reads like uxStreamBufferGet( ) in 'peek' mode, while calculating the
+	 * checksum of the bytes copied.  When the data wraps around, the two parts are
+	 * summed separately.  A second part that starts at an odd position in
+	 * 'pucData' has its sum byte-swapped before it is added.
+	 */
+	size_t uxStreamBufferGetChecksum( const StreamBuffer_t *pxBuffer, size_t uxOffset, uint8_t *pucData, size_t uxMaxCount, uint16_t *pusChecksum )
+	{
+	size_t uxSize, uxCount, uxFirst, uxNextTail;
+	uint32_t ulSum, ulSecond;
+
+		/* How much data is available? */
+		uxSize = uxStreamBufferGetSize( pxBuffer );
+
+		if( uxSize > uxOffset )
+		{
+			uxSize -= uxOffset;
+		}
+		else
+		{
+			uxSize = 0u;
+		}
+
+		/* Use the minimum of the wanted bytes and the available bytes. */
+		uxCount = FreeRTOS_min_uint32( uxSize, uxMaxCount );
+		ulSum = 0ul;
+
+		if( uxCount > 0u )
+		{
+			uxNextTail = pxBuffer->uxTail + uxOffset;
+			if( uxNextTail >= pxBuffer->LENGTH )
+			{
+				uxNextTail -= pxBuffer->LENGTH;
+			}
+
+			uxFirst = FreeRTOS_min_uint32( pxBuffer->LENGTH - uxNextTail, uxCount );
+			ulSum = usGenerateChecksumCopy( 0ul, pucData, pxBuffer->ucArray + uxNextTail, uxFirst );
+
+			if( uxCount > uxFirst )
+			{
+				ulSecond = usGenerateChecksumCopy( 0ul, pucData + uxFirst, pxBuffer->ucArray, uxCount - uxFirst );
+
+				if( ( uxFirst & 1u ) != 0u )
+				{
+					ulSecond = ( ( ulSecond & 0xffu ) << 8 ) | ( ( ulSecond & 0xff00u ) >> 8 );
+				}
+
+				/* One's complement addition of the two sums. */
+				ulSum += ulSecond;
+				ulSum = ( ulSum & 0xffffu ) + ( ulSum >> 16 );
+			}
+		}
+
+		*pusChecksum = ( uint16_t ) ulSum;
+
+		return uxCount;
+	}
+
+#endif /* ipconfigUSE_CHECKSUM_COPY */
+/*-----------------------------------------------------------*/
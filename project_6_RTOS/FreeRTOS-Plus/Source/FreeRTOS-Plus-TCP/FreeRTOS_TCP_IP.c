@@ -204,6 +204,14 @@ static int32_t prvTCPSendRepeated( FreeRTOS_Socket_t *pxSocket, NetworkBufferDes
 static void prvTCPReturnPacket( FreeRTOS_Socket_t *pxSocket, NetworkBufferDescriptor_t *pxNetworkBuffer,
 	uint32_t ulLen, BaseType_t xReleaseAfterSend );
 
+#if( ipconfigUSE_CHECKSUM_COPY != 0 ) && ( ipconfigDRIVER_INCLUDED_TX_IP_CHECKSUM == 0 )
+	/*
+	 * Calculate the TCP checksum of an outgoing packet, using the sum of the
+	 * payload stored by prvTCPPrepareSend() if it is still valid.
+	 */
+	static void prvTCPSetChecksum( NetworkBufferDescriptor_t *pxNetworkBuffer, uint32_t ulLen );
+#endif
+
 /*
  * Initialise the data structures which keep track of the TCP windowing system.
  */
@@ -692,6 +700,11 @@ NetworkBufferDescriptor_t xTempBuffer;
 			xTempBuffer.pxNextBuffer = NULL;
 		}
 		#endif
+		#if( ipconfigUSE_CHECKSUM_COPY != 0 )
+		{
+			xTempBuffer.usPayloadChecksumLength = 0u;
+		}
+		#endif
 		xTempBuffer.pucEthernetBuffer = pxSocket->u.xTCP.xPacket.u.ucLastPacket;
 		xTempBuffer.xDataLength = sizeof( pxSocket->u.xTCP.xPacket.u.ucLastPacket );
 		xReleaseAfterSend = pdFALSE;
@@ -884,7 +897,15 @@ NetworkBufferDescriptor_t xTempBuffer;
 			pxIPHeader->usHeaderChecksum = ~FreeRTOS_htons( pxIPHeader->usHeaderChecksum );
 
 			/* calculate the TCP checksum for an outgoing packet. */
-			usGenerateProtocolChecksum( (uint8_t*)pxTCPPacket, pxNetworkBuffer->xDataLength, pdTRUE );
+			#if( ipconfigUSE_CHECKSUM_COPY != 0 )
+			{
+				prvTCPSetChecksum( pxNetworkBuffer, ulLen );
+			}
+			#else
+			{
+				usGenerateProtocolChecksum( (uint8_t*)pxTCPPacket, pxNetworkBuffer->xDataLength, pdTRUE );
+			}
+			#endif
 
 			/* A calculated checksum of 0 must be inverted as 0 means the checksum
 			is disabled. */
@@ -943,6 +964,45 @@ NetworkBufferDescriptor_t xTempBuffer;
 }
 /*-----------------------------------------------------------*/
 
+#if( ipconfigUSE_CHECKSUM_COPY != 0 ) && ( ipconfigDRIVER_INCLUDED_TX_IP_CHECKSUM == 0 )
+
+	static void prvTCPSetChecksum( NetworkBufferDescriptor_t *pxNetworkBuffer, uint32_t ulLen )
+	{
+	TCPPacket_t *pxTCPPacket = ( TCPPacket_t * ) ( pxNetworkBuffer->pucEthernetBuffer );
+	uint32_t ulLength, ulHeaderLength, ulSum;
+
+		/* The length of the TCP header, options included, and data. */
+		ulLength = ulLen - ipSIZE_OF_IPv4_HEADER;
+		ulHeaderLength = ( uint32_t ) ( ( pxTCPPacket->xTCPHeader.ucTCPOffset & 0xf0u ) >> 2 );
+
+		if( ( pxNetworkBuffer->usPayloadChecksumLength != 0u ) &&
+			( ( ulHeaderLength + pxNetworkBuffer->usPayloadChecksumLength ) == ulLength ) )
+		{
+			pxTCPPacket->xTCPHeader.usChecksum = 0u;
+
+			/* Sum the pseudo header and the TCP header, like
+			usGenerateProtocolChecksum() does.  The header length is a multiple
+			of 4, so the payload starts at an even position and its sum can be
+			added as it is. */
+			ulSum = usGenerateChecksum( ulLength + ( uint32_t ) ipPROTOCOL_TCP, ( uint8_t * ) &( pxTCPPacket->xIPHeader.ulSourceIPAddress ),
+				( 2u * sizeof( pxTCPPacket->xIPHeader.ulSourceIPAddress ) ) + ulHeaderLength );
+			ulSum += pxNetworkBuffer->usPayloadChecksum;
+			ulSum = ( ulSum & 0xffffu ) + ( ulSum >> 16 );
+
+			pxTCPPacket->xTCPHeader.usChecksum = FreeRTOS_htons( ( uint16_t ) ~ulSum );
+		}
+		else
+		{
+			usGenerateProtocolChecksum( ( uint8_t * ) pxTCPPacket, pxNetworkBuffer->xDataLength, pdTRUE );
+		}
+
+		/* The sum is only valid for the packet prepared with it. */
+		pxNetworkBuffer->usPayloadChecksumLength = 0u;
+	}
+
+#endif /* ipconfigUSE_CHECKSUM_COPY */
+/*-----------------------------------------------------------*/
+
 /*
  * The SYN event is very important: the sequence numbers, which have a kind of
  * random starting value, are being synchronised.  The sliding window manager
@@ -1019,6 +1079,14 @@ uint32_t ulInitialSequenceNumber = 0;
 		/* And issue a (new) ARP request */
 		FreeRTOS_OutputARPRequest( ulRemoteIP );
 
+		#if( ipconfigARP_PENDING_PACKETS != 0 )
+		{
+			/* Have the socket woken up as soon as the reply comes in, instead
+			of at the next poll. */
+			( void ) xARPHoldPacket( NULL, ulRemoteIP );
+		}
+		#endif /* ipconfigARP_PENDING_PACKETS */
+
 		xReturn = pdFALSE;
 	}
 
@@ -1478,6 +1546,11 @@ BaseType_t bAfter  = ( BaseType_t ) NOW_CONNECTED( eTCPState );						/* Is it co
 					}
 					#endif
 
+					/* The events of the parent have changed too.  A listening
+					socket has no time-out, the timer wheel only looks at it
+					when told so. */
+					ipTCP_TIMER_SOCKET_CHANGED( xParent );
+
 					#if( ipconfigUSE_CALLBACKS == 1 )
 					{
 						if( ( ipconfigIS_VALID_PROG_ADDRESS( xParent->u.xTCP.pxHandleConnected ) != pdFALSE ) &&
@@ -1571,6 +1644,9 @@ BaseType_t bAfter  = ( BaseType_t ) NOW_CONNECTED( eTCPState );						/* Is it co
 	/* touch the alive timers because moving to another state. */
 	prvTCPTouchSocket( pxSocket );
 
+	/* The time-out or the events of the socket may have changed. */
+	ipTCP_TIMER_SOCKET_CHANGED( pxSocket );
+
 	#if( ipconfigHAS_DEBUG_PRINTF == 1 )
 	{
 	if( ( xTCPWindowLoggingLevel >= 0 ) && ( ipconfigTCP_MAY_LOG_PORT( pxSocket->usLocalPort ) != pdFALSE ) )
@@ -1730,7 +1806,19 @@ int32_t lStreamPos;
 
 				/* Here data is copied from the txStream in 'peek' mode.  Only
 				when the packets are acked, the tail marker will be updated. */
-				ulDataGot = ( uint32_t ) uxStreamBufferGet( pxSocket->u.xTCP.txStream, uxOffset, pucSendData, ( size_t ) lDataLen, pdTRUE );
+				#if( ipconfigUSE_CHECKSUM_COPY != 0 )
+				{
+					/* Sum the payload while copying it, prvTCPReturnPacket() will
+					only have to add the headers. */
+					ulDataGot = ( uint32_t ) uxStreamBufferGetChecksum( pxSocket->u.xTCP.txStream, uxOffset, pucSendData, ( size_t ) lDataLen,
+						&( pxNewBuffer->usPayloadChecksum ) );
+					pxNewBuffer->usPayloadChecksumLength = ( uint16_t ) ulDataGot;
+				}
+				#else
+				{
+					ulDataGot = ( uint32_t ) uxStreamBufferGet( pxSocket->u.xTCP.txStream, uxOffset, pucSendData, ( size_t ) lDataLen, pdTRUE );
+				}
+				#endif
 
 				#if( ipconfigHAS_DEBUG_PRINTF != 0 )
 				{
@@ -1914,6 +2002,9 @@ TickType_t ulDelayMs = ( TickType_t ) tcpMAXIMUM_TCP_WAKEUP_TIME_MS;
 		keep-alive/delayed-ACK mechanism). */
 	}
 
+	/* The timer wheel must see the new time-out. */
+	ipTCP_TIMER_SOCKET_CHANGED( pxSocket );
+
 	/* Return the number of clock ticks before the timer expires. */
 	return ( TickType_t ) pxSocket->u.xTCP.usTimeout;
 }
@@ -2216,8 +2307,31 @@ UBaseType_t uxOptionsLength = pxTCPWindow->ucOptionLength;
 					uxOptionsLength,
 					FreeRTOS_ntohl( pxTCPWindow->ulOptionsData[ 1 ] ) - pxSocket->u.xTCP.xTCPWindow.rx.ulFirstSequenceNumber,
 					FreeRTOS_ntohl( pxTCPWindow->ulOptionsData[ 2 ] ) - pxSocket->u.xTCP.xTCPWindow.rx.ulFirstSequenceNumber ) );
+			#if( ipconfigTCP_SACK_BLOCKS > 1 )
+			{
+				/* The options are written into the buffer of the packet that
+				was received.  A buffer of variable size may be too short to
+				hold all SACK blocks, leave out the oldest blocks if so. */
+				while( ( xBufferAllocFixedSize == pdFALSE ) && ( uxOptionsLength > 12u ) &&
+					   ( ( ipSIZE_OF_ETH_HEADER + ipSIZE_OF_IPv4_HEADER + ipSIZE_OF_TCP_HEADER + uxOptionsLength ) > pxNetworkBuffer->xDataLength ) )
+				{
+					uxOptionsLength -= 8u;
+				}
+
+				pxTCPWindow->ucOptionLength = ( uint8_t ) uxOptionsLength;
+			}
+			#endif /* ipconfigTCP_SACK_BLOCKS */
+
 			memcpy( pxTCPHeader->ucOptdata, pxTCPWindow->ulOptionsData, ( size_t ) uxOptionsLength );
 
+			#if( ipconfigTCP_SACK_BLOCKS > 1 )
+			{
+				/* The length of the SACK option follows the 2 NOP's and the
+				kind. */
+				pxTCPHeader->ucOptdata[ 3 ] = ( uint8_t ) ( uxOptionsLength - 2u );
+			}
+			#endif /* ipconfigTCP_SACK_BLOCKS */
+
 			/* The header length divided by 4, goes into the higher nibble,
 			effectively a shift-left 2. */
 			pxTCPHeader->ucTCPOffset = ( uint8_t )( ( ipSIZE_OF_TCP_HEADER + uxOptionsLength ) << 2 );
@@ -3143,6 +3257,17 @@ uint32_t ulInitialSequenceNumber;
 		pxReturn->u.xTCP.ulRemoteIP = FreeRTOS_htonl( pxTCPPacket->xIPHeader.ulSourceIPAddress );
 		pxReturn->u.xTCP.xTCPWindow.ulOurSequenceNumber = ulInitialSequenceNumber;
 
+		#if( ipconfigUSE_SOCKET_HASH == 1 )
+		{
+			/* A new child socket can now be found by its peer.  A listening
+			socket with bReuseSocket stays in the port table. */
+			if( pxReturn != pxSocket )
+			{
+				vSocketHashAddConnection( pxReturn );
+			}
+		}
+		#endif /* ipconfigUSE_SOCKET_HASH */
+
 		/* Here is the SYN action. */
 		pxReturn->u.xTCP.xTCPWindow.rx.ulCurrentSequenceNumber = FreeRTOS_ntohl( pxTCPPacket->xTCPHeader.ulSequenceNumber );
 		prvSocketSetMSS( pxReturn );
@@ -87,6 +87,14 @@
 	 */
 	#define MAX_TRANSMIT_COUNT_USING_LARGE_WINDOW		( 4u )
 
+	/* The first word of a SACK option: NOP (0x01), NOP (0x01), SACK (0x05),
+	and the length, which is added to it, in host byte order. */
+	#define OPTION_CODE_SACK							( 0x01010500UL )
+
+	/* An AVL tree of height 32 holds millions of segments: the paths through
+	the segment trees are never longer. */
+	#define winTREE_MAX_DEPTH							( 32u )
+
 #endif /* configUSE_TCP_WIN */
 /*-----------------------------------------------------------*/
 
@@ -150,7 +158,7 @@ extern void vListInsertGeneric( List_t * const pxList, ListItem_t * const pxNewL
  *	The ownership will be passed back to the segment pool
  */
 #if( ipconfigUSE_TCP_WIN == 1 )
-	static void vTCPWindowFree( TCPSegment_t *pxSegment );
+	static void vTCPWindowFree( TCPWindow_t *pxWindow, TCPSegment_t *pxSegment );
 #endif /* ipconfigUSE_TCP_WIN == 1 */
 
 /*
@@ -189,6 +197,13 @@ extern void vListInsertGeneric( List_t * const pxList, ListItem_t * const pxNewL
 	static uint32_t prvTCPWindowTxCheckAck( TCPWindow_t *pxWindow, uint32_t ulFirst, uint32_t ulLast );
 #endif /* ipconfigUSE_TCP_WIN == 1 */
 
+/*
+ * A segment has been ACK'd: adapt the smoothed round trip time to its age.
+ */
+#if( ipconfigUSE_TCP_WIN == 1 )
+	static void prvTCPWindowTxRTT( TCPWindow_t *pxWindow, TCPSegment_t *pxSegment );
+#endif /* ipconfigUSE_TCP_WIN == 1 */
+
 /*
  * A higher Tx block has been acknowledged.  Now iterate through the xWaitQueue
  * to find a possible condition for a FAST retransmission.
@@ -197,6 +212,48 @@ extern void vListInsertGeneric( List_t * const pxList, ListItem_t * const pxNewL
 	static uint32_t prvTCPWindowFastRetransmit( TCPWindow_t *pxWindow, uint32_t ulFirst );
 #endif /* ipconfigUSE_TCP_WIN == 1 */
 
+/*
+ * The segments of a window can also be found through a balanced binary tree
+ * (AVL), ordered on sequence number.  Add a segment to a tree, or remove it.
+ */
+#if( ( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_WIN_USE_SEGMENT_TREE != 0 ) )
+	static void prvTCPWindowTreeInsert( TCPSegment_t **ppxRoot, TCPSegment_t *pxSegment );
+	static void prvTCPWindowTreeRemove( TCPSegment_t **ppxRoot, TCPSegment_t *pxSegment );
+#endif /* ipconfigTCP_WIN_USE_SEGMENT_TREE */
+
+/*
+ * Find the segment with the lowest sequence number that is equal to or higher
+ * than 'ulSequenceNumber' in a segment tree.
+ */
+#if( ( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_WIN_USE_SEGMENT_TREE != 0 ) )
+	static TCPSegment_t *prvTCPWindowTreeFind( TCPSegment_t *pxRoot, uint32_t ulSequenceNumber );
+#endif /* ipconfigTCP_WIN_USE_SEGMENT_TREE */
+
+/*
+ * Find the segment with the highest sequence number that is lower than
+ * 'ulSequenceNumber' in a segment tree.
+ */
+#if( ( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_WIN_USE_SEGMENT_TREE != 0 ) )
+	static TCPSegment_t *prvTCPWindowTreeFindBelow( TCPSegment_t *pxRoot, uint32_t ulSequenceNumber );
+#endif /* ipconfigTCP_WIN_USE_SEGMENT_TREE */
+
+/*
+ * An out-of-order segment from 'ulFirst' up to 'ulLast' has been stored.  Make
+ * it part of the block of contiguous data around it, which will be the first
+ * block of the SACK option, followed by the blocks reported earlier.
+ */
+#if( ( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_WIN_USE_SEGMENT_TREE != 0 ) )
+	static void prvTCPWindowRxSack( TCPWindow_t *pxWindow, uint32_t ulFirst, uint32_t ulLast );
+#endif /* ipconfigTCP_WIN_USE_SEGMENT_TREE */
+
+/*
+ * Forget the SACK blocks that have become part of the contiguous data, and
+ * write the remaining ones into the TCP options.
+ */
+#if( ( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_WIN_USE_SEGMENT_TREE != 0 ) )
+	static void prvTCPWindowSetSackOption( TCPWindow_t *pxWindow );
+#endif /* ipconfigTCP_WIN_USE_SEGMENT_TREE */
+
 /*-----------------------------------------------------------*/
 
 /* TCP segment pool. */
@@ -341,7 +398,7 @@ void vListInsertGeneric( List_t * const pxList, ListItem_t * const pxNewListItem
 #endif /* ipconfigUSE_TCP_WIN == 1 */
 /*-----------------------------------------------------------*/
 
-#if( ipconfigUSE_TCP_WIN == 1 )
+#if( ( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_WIN_USE_SEGMENT_TREE == 0 ) )
 
 	static TCPSegment_t *xTCPWindowRxFind( TCPWindow_t *pxWindow, uint32_t ulSequenceNumber )
 	{
@@ -373,6 +430,27 @@ void vListInsertGeneric( List_t * const pxList, ListItem_t * const pxNewListItem
 #endif /* ipconfigUSE_TCP_WIN == 1 */
 /*-----------------------------------------------------------*/
 
+#if( ( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_WIN_USE_SEGMENT_TREE != 0 ) )
+
+	static TCPSegment_t *xTCPWindowRxFind( TCPWindow_t *pxWindow, uint32_t ulSequenceNumber )
+	{
+	TCPSegment_t *pxReturn;
+
+		/* Find a segment with a given sequence number in the tree of received
+		segments. */
+		pxReturn = prvTCPWindowTreeFind( pxWindow->pxRxTree, ulSequenceNumber );
+
+		if( ( pxReturn != NULL ) && ( pxReturn->ulSequenceNumber != ulSequenceNumber ) )
+		{
+			pxReturn = NULL;
+		}
+
+		return pxReturn;
+	}
+
+#endif /* ipconfigTCP_WIN_USE_SEGMENT_TREE */
+/*-----------------------------------------------------------*/
+
 #if( ipconfigUSE_TCP_WIN == 1 )
 
 	static TCPSegment_t *xTCPWindowNew( TCPWindow_t *pxWindow, uint32_t ulSequenceNumber, int32_t lCount, BaseType_t xIsForRx )
@@ -405,6 +483,15 @@ void vListInsertGeneric( List_t * const pxList, ListItem_t * const pxNewListItem
 			/* Add it to either the connections' Rx or Tx queue. */
 			vListInsertFifo( xIsForRx ? &pxWindow->xRxSegments : &pxWindow->xTxSegments, pxItem );
 
+			#if( ipconfigTCP_WIN_USE_SEGMENT_TREE != 0 )
+			{
+				/* And to the tree of the same segments, which is ordered on
+				sequence number. */
+				pxSegment->ulSequenceNumber = ulSequenceNumber;
+				prvTCPWindowTreeInsert( xIsForRx ? &pxWindow->pxRxTree : &pxWindow->pxTxTree, pxSegment );
+			}
+			#endif /* ipconfigTCP_WIN_USE_SEGMENT_TREE */
+
 			/* And set the segment's timer to zero */
 			vTCPTimerSet( &pxSegment->xTransmitTimer );
 
@@ -520,7 +607,7 @@ void vListInsertGeneric( List_t * const pxList, ListItem_t * const pxNewListItem
 
 #if( ipconfigUSE_TCP_WIN == 1 )
 
-	static void vTCPWindowFree( TCPSegment_t *pxSegment )
+	static void vTCPWindowFree( TCPWindow_t *pxWindow, TCPSegment_t *pxSegment )
 	{
 		/*  Free entry pxSegment because it's not used any more.  The ownership
 		will be passed back to the segment pool.
@@ -531,6 +618,26 @@ void vListInsertGeneric( List_t * const pxList, ListItem_t * const pxNewListItem
 			uxListRemove( &( pxSegment->xQueueItem ) );
 		}
 
+		#if( ipconfigTCP_WIN_USE_SEGMENT_TREE != 0 )
+		{
+			/* The tree is searched on sequence number, so take the segment out
+			before its sequence number is cleared.  A TX segment left pxTxTree
+			when it was ACK'd. */
+			if( pxSegment->u.bits.bIsForRx != pdFALSE_UNSIGNED )
+			{
+				prvTCPWindowTreeRemove( &pxWindow->pxRxTree, pxSegment );
+			}
+			else if( pxSegment->u.bits.bAcked == pdFALSE_UNSIGNED )
+			{
+				prvTCPWindowTreeRemove( &pxWindow->pxTxTree, pxSegment );
+			}
+		}
+		#else
+		{
+			( void ) pxWindow;
+		}
+		#endif /* ipconfigTCP_WIN_USE_SEGMENT_TREE */
+
 		pxSegment->ulSequenceNumber = 0u;
 		pxSegment->lDataLength = 0l;
 		pxSegment->u.ulFlags = 0u;
@@ -576,7 +683,7 @@ void vListInsertGeneric( List_t * const pxList, ListItem_t * const pxNewListItem
 				while( listCURRENT_LIST_LENGTH( pxSegments ) > 0U )
 				{
 					pxSegment = ( TCPSegment_t * ) listGET_OWNER_OF_HEAD_ENTRY( pxSegments );
-					vTCPWindowFree( pxSegment );
+					vTCPWindowFree( pxWindow, pxSegment );
 				}
 			}
 		}
@@ -603,6 +710,14 @@ void vTCPWindowCreate( TCPWindow_t *pxWindow, uint32_t ulRxWindowLength,
 		vListInitialise( &pxWindow->xPriorityQueue );			/* Priority queue: segments which must be sent immediately */
 		vListInitialise( &pxWindow->xTxQueue   );			/* Transmit queue: segments queued for transmission */
 		vListInitialise( &pxWindow->xWaitQueue );			/* Waiting queue:  outstanding segments */
+
+		#if( ipconfigTCP_WIN_USE_SEGMENT_TREE != 0 )
+		{
+			pxWindow->pxTxTree = NULL;
+			pxWindow->pxRxTree = NULL;
+			pxWindow->ucSackBlockCount = 0u;
+		}
+		#endif /* ipconfigTCP_WIN_USE_SEGMENT_TREE */
 	}
 	#endif /* ipconfigUSE_TCP_WIN == 1 */
 
@@ -690,6 +805,260 @@ const int32_t l500ms = 500;
 #endif /* ipconfgiUSE_TCP_WIN == 1 */
 /*-----------------------------------------------------------*/
 
+#if( ( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_WIN_USE_SEGMENT_TREE != 0 ) )
+
+	static portINLINE uint8_t ucTreeHeight( const TCPSegment_t *pxSegment );
+	static portINLINE uint8_t ucTreeHeight( const TCPSegment_t *pxSegment )
+	{
+		return ( pxSegment != NULL ) ? pxSegment->ucHeight : 0u;
+	}
+
+#endif /* ipconfigTCP_WIN_USE_SEGMENT_TREE */
+/*-----------------------------------------------------------*/
+
+#if( ( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_WIN_USE_SEGMENT_TREE != 0 ) )
+
+	static TCPSegment_t *prvTCPWindowTreeBalance( TCPSegment_t *pxNode );
+	static TCPSegment_t *prvTCPWindowTreeBalance( TCPSegment_t *pxNode )
+	{
+	TCPSegment_t *pxChild;
+	int32_t lBalance;
+
+		/* The sub-trees of pxNode are balanced, but their heights may differ
+		by 2.  If so, rotate pxNode's heavier child up.  Returns the node that
+		takes the place of pxNode. */
+		lBalance = ( int32_t ) ucTreeHeight( pxNode->pxLeft ) - ( int32_t ) ucTreeHeight( pxNode->pxRight );
+
+		if( lBalance > 1 )
+		{
+			pxChild = pxNode->pxLeft;
+
+			if( ucTreeHeight( pxChild->pxLeft ) < ucTreeHeight( pxChild->pxRight ) )
+			{
+				/* Left-right case: rotate the left child to the left first. */
+				pxNode->pxLeft = pxChild->pxRight;
+				pxChild->pxRight = pxNode->pxLeft->pxLeft;
+				pxNode->pxLeft->pxLeft = pxChild;
+				pxChild->ucHeight = ( uint8_t ) ( FreeRTOS_max_uint32( ucTreeHeight( pxChild->pxLeft ), ucTreeHeight( pxChild->pxRight ) ) + 1u );
+				pxChild = pxNode->pxLeft;
+			}
+
+			pxNode->pxLeft = pxChild->pxRight;
+			pxChild->pxRight = pxNode;
+		}
+		else if( lBalance < -1 )
+		{
+			pxChild = pxNode->pxRight;
+
+			if( ucTreeHeight( pxChild->pxRight ) < ucTreeHeight( pxChild->pxLeft ) )
+			{
+				/* Right-left case: rotate the right child to the right first. */
+				pxNode->pxRight = pxChild->pxLeft;
+				pxChild->pxLeft = pxNode->pxRight->pxRight;
+				pxNode->pxRight->pxRight = pxChild;
+				pxChild->ucHeight = ( uint8_t ) ( FreeRTOS_max_uint32( ucTreeHeight( pxChild->pxLeft ), ucTreeHeight( pxChild->pxRight ) ) + 1u );
+				pxChild = pxNode->pxRight;
+			}
+
+			pxNode->pxRight = pxChild->pxLeft;
+			pxChild->pxLeft = pxNode;
+		}
+		else
+		{
+			pxChild = NULL;
+		}
+
+		pxNode->ucHeight = ( uint8_t ) ( FreeRTOS_max_uint32( ucTreeHeight( pxNode->pxLeft ), ucTreeHeight( pxNode->pxRight ) ) + 1u );
+
+		if( pxChild != NULL )
+		{
+			pxChild->ucHeight = ( uint8_t ) ( FreeRTOS_max_uint32( ucTreeHeight( pxChild->pxLeft ), ucTreeHeight( pxChild->pxRight ) ) + 1u );
+			pxNode = pxChild;
+		}
+
+		return pxNode;
+	}
+
+#endif /* ipconfigTCP_WIN_USE_SEGMENT_TREE */
+/*-----------------------------------------------------------*/
+
+#if( ( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_WIN_USE_SEGMENT_TREE != 0 ) )
+
+	static void prvTCPWindowTreeInsert( TCPSegment_t **ppxRoot, TCPSegment_t *pxSegment )
+	{
+	TCPSegment_t **ppxPath[ winTREE_MAX_DEPTH ];
+	TCPSegment_t **ppxLink = ppxRoot;
+	UBaseType_t uxDepth = 0u;
+
+		/* Walk down to the leaf where the segment belongs, remembering the
+		links that were followed.  A window never holds two segments with the
+		same sequence number. */
+		while( *ppxLink != NULL )
+		{
+			configASSERT( uxDepth < winTREE_MAX_DEPTH );
+			ppxPath[ uxDepth++ ] = ppxLink;
+
+			if( xSequenceLessThan( pxSegment->ulSequenceNumber, ( *ppxLink )->ulSequenceNumber ) != pdFALSE )
+			{
+				ppxLink = &( ( *ppxLink )->pxLeft );
+			}
+			else
+			{
+				ppxLink = &( ( *ppxLink )->pxRight );
+			}
+		}
+
+		pxSegment->pxLeft = NULL;
+		pxSegment->pxRight = NULL;
+		pxSegment->ucHeight = 1u;
+		*ppxLink = pxSegment;
+
+		/* Restore the balance on the way back up. */
+		while( uxDepth > 0u )
+		{
+			uxDepth--;
+			*( ppxPath[ uxDepth ] ) = prvTCPWindowTreeBalance( *( ppxPath[ uxDepth ] ) );
+		}
+	}
+
+#endif /* ipconfigTCP_WIN_USE_SEGMENT_TREE */
+/*-----------------------------------------------------------*/
+
+#if( ( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_WIN_USE_SEGMENT_TREE != 0 ) )
+
+	static void prvTCPWindowTreeRemove( TCPSegment_t **ppxRoot, TCPSegment_t *pxSegment )
+	{
+	TCPSegment_t **ppxPath[ winTREE_MAX_DEPTH ];
+	TCPSegment_t **ppxLink = ppxRoot, **ppxNext;
+	TCPSegment_t *pxNext;
+	UBaseType_t uxDepth = 0u, uxSegmentDepth;
+
+		/* Walk down to the segment, remembering the links that were followed. */
+		while( ( *ppxLink != NULL ) && ( *ppxLink != pxSegment ) )
+		{
+			configASSERT( uxDepth < winTREE_MAX_DEPTH );
+			ppxPath[ uxDepth++ ] = ppxLink;
+
+			if( xSequenceLessThan( pxSegment->ulSequenceNumber, ( *ppxLink )->ulSequenceNumber ) != pdFALSE )
+			{
+				ppxLink = &( ( *ppxLink )->pxLeft );
+			}
+			else
+			{
+				ppxLink = &( ( *ppxLink )->pxRight );
+			}
+		}
+
+		configASSERT( *ppxLink != NULL );
+
+		if( *ppxLink != NULL )
+		{
+			if( pxSegment->pxLeft == NULL )
+			{
+				*ppxLink = pxSegment->pxRight;
+			}
+			else if( pxSegment->pxRight == NULL )
+			{
+				*ppxLink = pxSegment->pxLeft;
+			}
+			else
+			{
+				/* The segment has two children.  Its place will be taken by
+				the next segment, the left-most one in its right sub-tree. */
+				uxSegmentDepth = uxDepth;
+				ppxPath[ uxDepth++ ] = ppxLink;
+				ppxNext = &( pxSegment->pxRight );
+
+				while( ( *ppxNext )->pxLeft != NULL )
+				{
+					configASSERT( uxDepth < winTREE_MAX_DEPTH );
+					ppxPath[ uxDepth++ ] = ppxNext;
+					ppxNext = &( ( *ppxNext )->pxLeft );
+				}
+
+				pxNext = *ppxNext;
+				*ppxNext = pxNext->pxRight;
+				pxNext->pxLeft = pxSegment->pxLeft;
+				pxNext->pxRight = pxSegment->pxRight;
+				*ppxLink = pxNext;
+
+				if( uxDepth > ( uxSegmentDepth + 1u ) )
+				{
+					/* The path went through the right link of pxSegment, which
+					is now the right link of pxNext. */
+					ppxPath[ uxSegmentDepth + 1u ] = &( pxNext->pxRight );
+				}
+			}
+
+			pxSegment->pxLeft = NULL;
+			pxSegment->pxRight = NULL;
+
+			/* Restore the balance on the way back up. */
+			while( uxDepth > 0u )
+			{
+				uxDepth--;
+				*( ppxPath[ uxDepth ] ) = prvTCPWindowTreeBalance( *( ppxPath[ uxDepth ] ) );
+			}
+		}
+	}
+
+#endif /* ipconfigTCP_WIN_USE_SEGMENT_TREE */
+/*-----------------------------------------------------------*/
+
+#if( ( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_WIN_USE_SEGMENT_TREE != 0 ) )
+
+	static TCPSegment_t *prvTCPWindowTreeFind( TCPSegment_t *pxRoot, uint32_t ulSequenceNumber )
+	{
+	TCPSegment_t *pxNode = pxRoot, *pxReturn = NULL;
+
+		/* Find the segment with the lowest sequence number that is equal to or
+		higher than 'ulSequenceNumber'. */
+		while( pxNode != NULL )
+		{
+			if( xSequenceLessThan( pxNode->ulSequenceNumber, ulSequenceNumber ) != pdFALSE )
+			{
+				pxNode = pxNode->pxRight;
+			}
+			else
+			{
+				pxReturn = pxNode;
+				pxNode = pxNode->pxLeft;
+			}
+		}
+
+		return pxReturn;
+	}
+
+#endif /* ipconfigTCP_WIN_USE_SEGMENT_TREE */
+/*-----------------------------------------------------------*/
+
+#if( ( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_WIN_USE_SEGMENT_TREE != 0 ) )
+
+	static TCPSegment_t *prvTCPWindowTreeFindBelow( TCPSegment_t *pxRoot, uint32_t ulSequenceNumber )
+	{
+	TCPSegment_t *pxNode = pxRoot, *pxReturn = NULL;
+
+		/* Find the segment with the highest sequence number that is lower than
+		'ulSequenceNumber'. */
+		while( pxNode != NULL )
+		{
+			if( xSequenceLessThan( pxNode->ulSequenceNumber, ulSequenceNumber ) != pdFALSE )
+			{
+				pxReturn = pxNode;
+				pxNode = pxNode->pxRight;
+			}
+			else
+			{
+				pxNode = pxNode->pxLeft;
+			}
+		}
+
+		return pxReturn;
+	}
+
+#endif /* ipconfigTCP_WIN_USE_SEGMENT_TREE */
+/*-----------------------------------------------------------*/
+
 /*=============================================================================
  *
  *                ######        #    #
@@ -705,7 +1074,7 @@ const int32_t l500ms = 500;
  *
  *=============================================================================*/
 
-#if( ipconfigUSE_TCP_WIN == 1 )
+#if( ( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_WIN_USE_SEGMENT_TREE == 0 ) )
 
 	static TCPSegment_t *xTCPWindowRxConfirm( TCPWindow_t *pxWindow, uint32_t ulSequenceNumber, uint32_t ulLength )
 	{
@@ -763,6 +1132,216 @@ const int32_t l500ms = 500;
 #endif /* ipconfgiUSE_TCP_WIN == 1 */
 /*-----------------------------------------------------------*/
 
+#if( ( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_WIN_USE_SEGMENT_TREE != 0 ) )
+
+	static TCPSegment_t *xTCPWindowRxConfirm( TCPWindow_t *pxWindow, uint32_t ulSequenceNumber, uint32_t ulLength )
+	{
+	TCPSegment_t *pxBest;
+	uint32_t ulNextSequenceNumber = ulSequenceNumber + ulLength;
+
+		/* See xTCPWindowRxConfirm() above.  The tree returns the segment with
+		the lowest sequence number that is equal to or higher than
+		'ulSequenceNumber' at once. */
+		pxBest = prvTCPWindowTreeFind( pxWindow->pxRxTree, ulSequenceNumber );
+
+		if( ( pxBest != NULL ) && ( xSequenceLessThan( pxBest->ulSequenceNumber, ulNextSequenceNumber ) == pdFALSE ) )
+		{
+			pxBest = NULL;
+		}
+
+		if( ( pxBest != NULL ) &&
+			( ( pxBest->ulSequenceNumber != ulSequenceNumber ) || ( pxBest->lDataLength != ( int32_t ) ulLength ) ) )
+		{
+			FreeRTOS_flush_logging();
+			FreeRTOS_debug_printf( ( "xTCPWindowRxConfirm[%u]: search %lu (+%ld=%lu) found %lu (+%ld=%lu)\n",
+				pxWindow->usPeerPortNumber,
+				ulSequenceNumber - pxWindow->rx.ulFirstSequenceNumber,
+				ulLength,
+				ulSequenceNumber + ulLength - pxWindow->rx.ulFirstSequenceNumber,
+				pxBest->ulSequenceNumber - pxWindow->rx.ulFirstSequenceNumber,
+				pxBest->lDataLength,
+				pxBest->ulSequenceNumber + ( ( uint32_t ) pxBest->lDataLength ) - pxWindow->rx.ulFirstSequenceNumber ) );
+		}
+
+		return pxBest;
+	}
+
+#endif /* ipconfigTCP_WIN_USE_SEGMENT_TREE */
+/*-----------------------------------------------------------*/
+
+#if( ( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_WIN_USE_SEGMENT_TREE != 0 ) )
+
+	static void prvTCPWindowRxSack( TCPWindow_t *pxWindow, uint32_t ulFirst, uint32_t ulLast )
+	{
+	TCPSegment_t *pxFound;
+	BaseType_t xIndex, xCount = 0;
+
+		/* Extend the block with the data that was stored before, in both
+		directions.  A block reported earlier covers all stored data up to
+		its edges, so the block can jump over it at once, instead of walking
+		through its segments one by one. */
+		for( ;; )
+		{
+			for( xIndex = 0; xIndex < ( BaseType_t ) pxWindow->ucSackBlockCount; xIndex++ )
+			{
+				if( pxWindow->xSackBlocks[ xIndex ].ulFirst == ulLast )
+				{
+					break;
+				}
+			}
+
+			if( xIndex < ( BaseType_t ) pxWindow->ucSackBlockCount )
+			{
+				ulLast = pxWindow->xSackBlocks[ xIndex ].ulLast;
+			}
+			else if( ( pxFound = xTCPWindowRxFind( pxWindow, ulLast ) ) != NULL )
+			{
+				ulLast += ( uint32_t ) pxFound->lDataLength;
+			}
+			else
+			{
+				break;
+			}
+		}
+
+		for( ;; )
+		{
+			for( xIndex = 0; xIndex < ( BaseType_t ) pxWindow->ucSackBlockCount; xIndex++ )
+			{
+				if( pxWindow->xSackBlocks[ xIndex ].ulLast == ulFirst )
+				{
+					break;
+				}
+			}
+
+			if( xIndex < ( BaseType_t ) pxWindow->ucSackBlockCount )
+			{
+				ulFirst = pxWindow->xSackBlocks[ xIndex ].ulFirst;
+			}
+			else if( ( ( pxFound = prvTCPWindowTreeFindBelow( pxWindow->pxRxTree, ulFirst ) ) != NULL ) &&
+					 ( ( pxFound->ulSequenceNumber + ( uint32_t ) pxFound->lDataLength ) == ulFirst ) )
+			{
+				ulFirst = pxFound->ulSequenceNumber;
+			}
+			else
+			{
+				break;
+			}
+		}
+
+		/* Blocks that were reported earlier and that touch this block become
+		part of it.  The others are kept, in the same order. */
+		for( xIndex = 0; xIndex < ( BaseType_t ) pxWindow->ucSackBlockCount; xIndex++ )
+		{
+			if( ( xSequenceLessThanOrEqual( pxWindow->xSackBlocks[ xIndex ].ulFirst, ulLast ) != pdFALSE ) &&
+				( xSequenceGreaterThanOrEqual( pxWindow->xSackBlocks[ xIndex ].ulLast, ulFirst ) != pdFALSE ) )
+			{
+				if( xSequenceLessThan( pxWindow->xSackBlocks[ xIndex ].ulFirst, ulFirst ) != pdFALSE )
+				{
+					ulFirst = pxWindow->xSackBlocks[ xIndex ].ulFirst;
+				}
+
+				if( xSequenceGreaterThan( pxWindow->xSackBlocks[ xIndex ].ulLast, ulLast ) != pdFALSE )
+				{
+					ulLast = pxWindow->xSackBlocks[ xIndex ].ulLast;
+				}
+			}
+			else
+			{
+				pxWindow->xSackBlocks[ xCount ] = pxWindow->xSackBlocks[ xIndex ];
+				xCount++;
+			}
+		}
+
+		/* The new block comes first, followed by the most recent ones.  The
+		oldest block is not reported any more if there is no space for it. */
+		if( xCount > ( ipconfigTCP_SACK_BLOCKS - 1 ) )
+		{
+			xCount = ipconfigTCP_SACK_BLOCKS - 1;
+		}
+
+		for( xIndex = xCount; xIndex > 0; xIndex-- )
+		{
+			pxWindow->xSackBlocks[ xIndex ] = pxWindow->xSackBlocks[ xIndex - 1 ];
+		}
+
+		pxWindow->xSackBlocks[ 0 ].ulFirst = ulFirst;
+		pxWindow->xSackBlocks[ 0 ].ulLast = ulLast;
+		pxWindow->ucSackBlockCount = ( uint8_t ) ( xCount + 1 );
+
+		if( xTCPWindowLoggingLevel >= 1 )
+		{
+			FreeRTOS_debug_printf( ( "prvTCPWindowRxSack[%d,%d]: SACK %lu - %lu (blocks %u)\n",
+				pxWindow->usPeerPortNumber, pxWindow->usOurPortNumber,
+				ulFirst - pxWindow->rx.ulFirstSequenceNumber,
+				ulLast - pxWindow->rx.ulFirstSequenceNumber,
+				pxWindow->ucSackBlockCount ) );
+		}
+
+		prvTCPWindowSetSackOption( pxWindow );
+	}
+
+#endif /* ipconfigTCP_WIN_USE_SEGMENT_TREE */
+/*-----------------------------------------------------------*/
+
+#if( ( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_WIN_USE_SEGMENT_TREE != 0 ) )
+
+	static void prvTCPWindowSetSackOption( TCPWindow_t *pxWindow )
+	{
+	BaseType_t xIndex, xCount = 0;
+	uint32_t ulCurrentSequenceNumber = pxWindow->rx.ulCurrentSequenceNumber;
+
+		/* Data below rx.ulCurrentSequenceNumber has been acknowledged, and may
+		not be reported in a SACK block any more. */
+		for( xIndex = 0; xIndex < ( BaseType_t ) pxWindow->ucSackBlockCount; xIndex++ )
+		{
+			if( xSequenceGreaterThan( pxWindow->xSackBlocks[ xIndex ].ulLast, ulCurrentSequenceNumber ) != pdFALSE )
+			{
+				pxWindow->xSackBlocks[ xCount ] = pxWindow->xSackBlocks[ xIndex ];
+
+				if( xSequenceLessThan( pxWindow->xSackBlocks[ xCount ].ulFirst, ulCurrentSequenceNumber ) != pdFALSE )
+				{
+					pxWindow->xSackBlocks[ xCount ].ulFirst = ulCurrentSequenceNumber;
+				}
+
+				/* The blocks are sent in network byte order, following the
+				option code. */
+				pxWindow->ulOptionsData[ 1 + ( 2 * xCount ) ] = FreeRTOS_htonl( pxWindow->xSackBlocks[ xCount ].ulFirst );
+				pxWindow->ulOptionsData[ 2 + ( 2 * xCount ) ] = FreeRTOS_htonl( pxWindow->xSackBlocks[ xCount ].ulLast );
+				xCount++;
+			}
+		}
+
+		pxWindow->ucSackBlockCount = ( uint8_t ) xCount;
+
+		if( xCount != 0 )
+		{
+			/* 2 bytes for kind and length, and 8 bytes per block, preceded by
+			2 NOP's. */
+			pxWindow->ulOptionsData[ 0 ] = FreeRTOS_htonl( OPTION_CODE_SACK | ( 2UL + ( 8UL * ( uint32_t ) xCount ) ) );
+			pxWindow->ucOptionLength = ( uint8_t ) ( 4u + ( 8u * ( uint32_t ) xCount ) );
+		}
+		else
+		{
+		TCPSegment_t *pxSegment;
+
+			pxWindow->ucOptionLength = 0u;
+
+			/* All blocks that were remembered have been acknowledged, but
+			blocks that did not fit in the history may still be stored.  Report
+			the lowest of them. */
+			pxSegment = prvTCPWindowTreeFind( pxWindow->pxRxTree, ulCurrentSequenceNumber );
+
+			if( pxSegment != NULL )
+			{
+				prvTCPWindowRxSack( pxWindow, pxSegment->ulSequenceNumber, pxSegment->ulSequenceNumber + ( uint32_t ) pxSegment->lDataLength );
+			}
+		}
+	}
+
+#endif /* ipconfigTCP_WIN_USE_SEGMENT_TREE */
+/*-----------------------------------------------------------*/
+
 #if( ipconfigUSE_TCP_WIN == 1 )
 
 	int32_t lTCPWindowRxCheck( TCPWindow_t *pxWindow, uint32_t ulSequenceNumber, uint32_t ulLength, uint32_t ulSpace )
@@ -816,7 +1395,7 @@ const int32_t l500ms = 500;
                         if ( pxFound != NULL )
                         {
                             /* Remove it because it will be passed to user directly. */
-                            vTCPWindowFree( pxFound );
+                            vTCPWindowFree( pxWindow, pxFound );
                         }
                     } while ( pxFound );
 
@@ -828,7 +1407,7 @@ const int32_t l500ms = 500;
 
 						/* As all packet below this one have been passed to the
 						user it can be discarded. */
-						vTCPWindowFree( pxFound );
+						vTCPWindowFree( pxWindow, pxFound );
 					}
 
 					if( ulSavedSequenceNumber != ulCurrentSequenceNumber )
@@ -851,6 +1430,14 @@ const int32_t l500ms = 500;
 
 				pxWindow->rx.ulCurrentSequenceNumber = ulCurrentSequenceNumber;
 
+				#if( ipconfigTCP_WIN_USE_SEGMENT_TREE != 0 )
+				{
+					/* While out-of-order data is held, every ACK carries SACK
+					blocks (RFC 2018). */
+					prvTCPWindowSetSackOption( pxWindow );
+				}
+				#endif /* ipconfigTCP_WIN_USE_SEGMENT_TREE */
+
 				/* Packet was expected, may be passed directly to the socket
 				buffer or application.  Store the packet at offset 0. */
 				lReturn = 0;
@@ -888,6 +1475,7 @@ const int32_t l500ms = 500;
 			}
 			else
 			{
+				#if( ipconfigTCP_WIN_USE_SEGMENT_TREE == 0 )
 				/* See if there is more data in a contiguous block to make the
 				SACK describe a longer range of data. */
 
@@ -922,6 +1510,7 @@ const int32_t l500ms = 500;
 
 				/* Which make 12 (3*4) option bytes. */
 				pxWindow->ucOptionLength = 3 * sizeof( pxWindow->ulOptionsData[ 0 ] );
+				#endif /* ipconfigTCP_WIN_USE_SEGMENT_TREE */
 
 				pxFound = xTCPWindowRxFind( pxWindow, ulSequenceNumber );
 
@@ -961,6 +1550,17 @@ const int32_t l500ms = 500;
 						lReturn = ( int32_t ) ( ulSequenceNumber - ulCurrentSequenceNumber );
 					}
 				}
+
+				#if( ipconfigTCP_WIN_USE_SEGMENT_TREE != 0 )
+				{
+					if( pxFound != NULL )
+					{
+						/* The packet is stored, now or earlier.  Prepare the
+						SACK (Selective ACK) message. */
+						prvTCPWindowRxSack( pxWindow, ulSequenceNumber, ulLast );
+					}
+				}
+				#endif /* ipconfigTCP_WIN_USE_SEGMENT_TREE */
 			}
 		}
 
@@ -1439,15 +2039,41 @@ const int32_t l500ms = 500;
 #endif /* ipconfigUSE_TCP_WIN == 1 */
 /*-----------------------------------------------------------*/
 
+#if( ipconfigUSE_TCP_WIN == 1 )
+
+	static void prvTCPWindowTxRTT( TCPWindow_t *pxWindow, TCPSegment_t *pxSegment )
+	{
+	int32_t mS = ( int32_t ) ulTimerGetAge( &( pxSegment->xTransmitTimer ) );
+
+		/* The segment was sent-out once and it is the last ACK'd segment in a
+		range: its age is the round trip time. */
+		if( pxWindow->lSRTT >= mS )
+		{
+			/* RTT becomes smaller: adapt slowly. */
+			pxWindow->lSRTT = ( ( winSRTT_DECREMENT_NEW * mS ) + ( winSRTT_DECREMENT_CURRENT * pxWindow->lSRTT ) ) / ( winSRTT_DECREMENT_NEW + winSRTT_DECREMENT_CURRENT );
+		}
+		else
+		{
+			/* RTT becomes larger: adapt quicker */
+			pxWindow->lSRTT = ( ( winSRTT_INCREMENT_NEW * mS ) + ( winSRTT_INCREMENT_CURRENT * pxWindow->lSRTT ) ) / ( winSRTT_INCREMENT_NEW + winSRTT_INCREMENT_CURRENT );
+		}
+
+		/* Cap to the minimum of 50ms. */
+		if( pxWindow->lSRTT < winSRTT_CAP_mS )
+		{
+			pxWindow->lSRTT = winSRTT_CAP_mS;
+		}
+	}
+
+#endif /* ipconfigUSE_TCP_WIN == 1 */
+/*-----------------------------------------------------------*/
+
 #if( ipconfigUSE_TCP_WIN == 1 )
 
 	static uint32_t prvTCPWindowTxCheckAck( TCPWindow_t *pxWindow, uint32_t ulFirst, uint32_t ulLast )
 	{
 	uint32_t ulBytesConfirmed = 0u;
 	uint32_t ulSequenceNumber = ulFirst, ulDataLength;
-	const ListItem_t *pxIterator;
-	const MiniListItem_t *pxEnd = ( const MiniListItem_t* )listGET_END_MARKER( &pxWindow->xTxSegments );
-	BaseType_t xDoUnlink;
 	TCPSegment_t *pxSegment;
 		/* An acknowledgement or a selective ACK (SACK) was received.  See if some outstanding data
 		may be removed from the transmission queue(s).
@@ -1470,120 +2096,174 @@ const int32_t l500ms = 500;
 		 A Smoothed RTT will increase quickly, but it is conservative when
 		 becoming smaller. */
 
-		for(
-				pxIterator  = ( const ListItem_t * ) listGET_NEXT( pxEnd );
-				( pxIterator != ( const ListItem_t * ) pxEnd ) && ( xSequenceLessThan( ulSequenceNumber, ulLast ) != 0 );
-			)
+		#if( ipconfigTCP_WIN_USE_SEGMENT_TREE != 0 )
 		{
-			xDoUnlink = pdFALSE;
-			pxSegment = ( TCPSegment_t * ) listGET_LIST_ITEM_OWNER( pxIterator );
+			/* pxTxTree only holds the segments that are not ACK'd yet, so the
+			segments within the block are found in order of sequence number
+			without passing the ones SACK'd earlier.  The segments in between
+			are ACK'd already: xTxSegments has no gaps.  Unlike the list walk,
+			a block that does not start at a segment boundary still ACKs the
+			segments that lie entirely within it (RFC 2018). */
+			if( xSequenceLessThan( ulFirst, pxWindow->tx.ulCurrentSequenceNumber ) == pdFALSE )
+			{
+				for( pxSegment = prvTCPWindowTreeFind( pxWindow->pxTxTree, ulFirst );
+					 ( pxSegment != NULL ) && ( xSequenceLessThan( pxSegment->ulSequenceNumber, ulLast ) != pdFALSE );
+					 pxSegment = prvTCPWindowTreeFind( pxWindow->pxTxTree, ulSequenceNumber ) )
+				{
+					ulDataLength = ( uint32_t ) pxSegment->lDataLength;
+					ulSequenceNumber = pxSegment->ulSequenceNumber + ulDataLength;
+
+					if( xSequenceGreaterThan( ulSequenceNumber, ulLast ) != pdFALSE )
+					{
+						/* Only part of this segment was accepted. */
+						break;
+					}
 
-			/* Move to the next item because the current item might get
-			removed. */
-			pxIterator = ( const ListItem_t * ) listGET_NEXT( pxIterator );
+					pxSegment->u.bits.bAcked = pdTRUE_UNSIGNED;
 
-			/* Continue if this segment does not fall within the ACK'd range. */
-			if( xSequenceGreaterThan( ulSequenceNumber, pxSegment->ulSequenceNumber ) != pdFALSE )
-			{
-				continue;
+					if( ( pxSegment->u.bits.ucTransmitCount == 1 ) && ( ulSequenceNumber == ulLast ) )
+					{
+						prvTCPWindowTxRTT( pxWindow, pxSegment );
+					}
+
+					/* Take it out of the tree and the queues, but do not destroy
+					it (yet). */
+					prvTCPWindowTreeRemove( &pxWindow->pxTxTree, pxSegment );
+
+					if( listLIST_ITEM_CONTAINER( &( pxSegment->xQueueItem ) ) != NULL )
+					{
+						uxListRemove( &pxSegment->xQueueItem );
+					}
+				}
 			}
 
-			/* Is it ready? */
-			if( ulSequenceNumber != pxSegment->ulSequenceNumber )
+			/* Free the ACK'd segments at the left side of the transmission
+			queue, as far as the block reaches. */
+			if( ulFirst == pxWindow->tx.ulCurrentSequenceNumber )
 			{
-				break;
+				while( listLIST_IS_EMPTY( &pxWindow->xTxSegments ) == pdFALSE )
+				{
+					pxSegment = ( TCPSegment_t * ) listGET_OWNER_OF_HEAD_ENTRY( &pxWindow->xTxSegments );
+
+					if( ( pxSegment->u.bits.bAcked == pdFALSE_UNSIGNED ) ||
+						( xSequenceLessThan( pxSegment->ulSequenceNumber, ulLast ) == pdFALSE ) )
+					{
+						break;
+					}
+
+					ulDataLength = ( uint32_t ) pxSegment->lDataLength;
+					pxWindow->tx.ulCurrentSequenceNumber += ulDataLength;
+					ulBytesConfirmed += ulDataLength;
+					vTCPWindowFree( pxWindow, pxSegment );
+				}
 			}
+		}
+		#else
+		{
+		const ListItem_t *pxIterator;
+		const MiniListItem_t *pxEnd = ( const MiniListItem_t* )listGET_END_MARKER( &pxWindow->xTxSegments );
+		BaseType_t xDoUnlink;
 
-			ulDataLength = ( uint32_t ) pxSegment->lDataLength;
+			pxIterator = ( const ListItem_t * ) listGET_NEXT( pxEnd );
 
-			if( pxSegment->u.bits.bAcked == pdFALSE_UNSIGNED )
+			for( ;
+					( pxIterator != ( const ListItem_t * ) pxEnd ) && ( xSequenceLessThan( ulSequenceNumber, ulLast ) != 0 );
+				)
 			{
-				if( xSequenceGreaterThan( pxSegment->ulSequenceNumber + ( uint32_t )ulDataLength, ulLast ) != pdFALSE )
+				xDoUnlink = pdFALSE;
+				pxSegment = ( TCPSegment_t * ) listGET_LIST_ITEM_OWNER( pxIterator );
+
+				/* Move to the next item because the current item might get
+				removed. */
+				pxIterator = ( const ListItem_t * ) listGET_NEXT( pxIterator );
+
+				/* Continue if this segment does not fall within the ACK'd range. */
+				if( xSequenceGreaterThan( ulSequenceNumber, pxSegment->ulSequenceNumber ) != pdFALSE )
 				{
-					/* What happens?  Only part of this segment was accepted,
-					probably due to WND limits
+					continue;
+				}
 
-					  AAAAAAA BBBBBBB << acked
-					  aaaaaaa aaaa    << sent */
-					#if( ipconfigHAS_DEBUG_PRINTF != 0 )
-					{
-						uint32_t ulFirstSeq = pxSegment->ulSequenceNumber - pxWindow->tx.ulFirstSequenceNumber;
-						FreeRTOS_debug_printf( ( "prvTCPWindowTxCheckAck[%u.%u]: %lu - %lu Partial sequence number %lu - %lu\n",
-							pxWindow->usPeerPortNumber,
-							pxWindow->usOurPortNumber,
-							ulFirstSeq - pxWindow->tx.ulFirstSequenceNumber,
-							ulLast - pxWindow->tx.ulFirstSequenceNumber,
-							ulFirstSeq, ulFirstSeq + ulDataLength ) );
-					}
-					#endif /* ipconfigHAS_DEBUG_PRINTF */
+				/* Is it ready? */
+				if( ulSequenceNumber != pxSegment->ulSequenceNumber )
+				{
 					break;
 				}
 
-				/* This segment is fully ACK'd, set the flag. */
-				pxSegment->u.bits.bAcked = pdTRUE_UNSIGNED;
+				ulDataLength = ( uint32_t ) pxSegment->lDataLength;
 
-				/* Calculate the RTT only if the segment was sent-out for the
-				first time and if this is the last ACK'd segment in a range. */
-				if( ( pxSegment->u.bits.ucTransmitCount == 1 ) && ( ( pxSegment->ulSequenceNumber + ulDataLength ) == ulLast ) )
+				if( pxSegment->u.bits.bAcked == pdFALSE_UNSIGNED )
 				{
-					int32_t mS = ( int32_t ) ulTimerGetAge( &( pxSegment->xTransmitTimer ) );
-
-					if( pxWindow->lSRTT >= mS )
-					{
-						/* RTT becomes smaller: adapt slowly. */
-						pxWindow->lSRTT = ( ( winSRTT_DECREMENT_NEW * mS ) + ( winSRTT_DECREMENT_CURRENT * pxWindow->lSRTT ) ) / ( winSRTT_DECREMENT_NEW + winSRTT_DECREMENT_CURRENT );
-					}
-					else
+					if( xSequenceGreaterThan( pxSegment->ulSequenceNumber + ( uint32_t )ulDataLength, ulLast ) != pdFALSE )
 					{
-						/* RTT becomes larger: adapt quicker */
-						pxWindow->lSRTT = ( ( winSRTT_INCREMENT_NEW * mS ) + ( winSRTT_INCREMENT_CURRENT * pxWindow->lSRTT ) ) / ( winSRTT_INCREMENT_NEW + winSRTT_INCREMENT_CURRENT );
+						/* What happens?  Only part of this segment was accepted,
+						probably due to WND limits
+
+						  AAAAAAA BBBBBBB << acked
+						  aaaaaaa aaaa    << sent */
+						#if( ipconfigHAS_DEBUG_PRINTF != 0 )
+						{
+							uint32_t ulFirstSeq = pxSegment->ulSequenceNumber - pxWindow->tx.ulFirstSequenceNumber;
+							FreeRTOS_debug_printf( ( "prvTCPWindowTxCheckAck[%u.%u]: %lu - %lu Partial sequence number %lu - %lu\n",
+								pxWindow->usPeerPortNumber,
+								pxWindow->usOurPortNumber,
+								ulFirstSeq - pxWindow->tx.ulFirstSequenceNumber,
+								ulLast - pxWindow->tx.ulFirstSequenceNumber,
+								ulFirstSeq, ulFirstSeq + ulDataLength ) );
+						}
+						#endif /* ipconfigHAS_DEBUG_PRINTF */
+						break;
 					}
 
-					/* Cap to the minimum of 50ms. */
-					if( pxWindow->lSRTT < winSRTT_CAP_mS )
+					/* This segment is fully ACK'd, set the flag. */
+					pxSegment->u.bits.bAcked = pdTRUE_UNSIGNED;
+
+					/* Calculate the RTT only if the segment was sent-out for the
+					first time and if this is the last ACK'd segment in a range. */
+					if( ( pxSegment->u.bits.ucTransmitCount == 1 ) && ( ( pxSegment->ulSequenceNumber + ulDataLength ) == ulLast ) )
 					{
-						pxWindow->lSRTT = winSRTT_CAP_mS;
+						prvTCPWindowTxRTT( pxWindow, pxSegment );
 					}
-				}
 
-				/* Unlink it from the 3 queues, but do not destroy it (yet). */
-				xDoUnlink = pdTRUE;
-			}
+					/* Unlink it from the 3 queues, but do not destroy it (yet). */
+					xDoUnlink = pdTRUE;
+				}
 
-			/* pxSegment->u.bits.bAcked is now true.  Is it located at the left
-			side of the transmission queue?  If so, it may be freed. */
-			if( ulSequenceNumber == pxWindow->tx.ulCurrentSequenceNumber )
-			{
-				if( ( xTCPWindowLoggingLevel >= 2 ) && ( ipconfigTCP_MAY_LOG_PORT( pxWindow->usOurPortNumber ) != pdFALSE ) )
+				/* pxSegment->u.bits.bAcked is now true.  Is it located at the left
+				side of the transmission queue?  If so, it may be freed. */
+				if( ulSequenceNumber == pxWindow->tx.ulCurrentSequenceNumber )
 				{
-					FreeRTOS_debug_printf( ( "prvTCPWindowTxCheckAck: %lu - %lu Ready sequence number %lu\n",
-						ulFirst - pxWindow->tx.ulFirstSequenceNumber,
-						ulLast - pxWindow->tx.ulFirstSequenceNumber,
-						pxSegment->ulSequenceNumber - pxWindow->tx.ulFirstSequenceNumber ) );
-				}
+					if( ( xTCPWindowLoggingLevel >= 2 ) && ( ipconfigTCP_MAY_LOG_PORT( pxWindow->usOurPortNumber ) != pdFALSE ) )
+					{
+						FreeRTOS_debug_printf( ( "prvTCPWindowTxCheckAck: %lu - %lu Ready sequence number %lu\n",
+							ulFirst - pxWindow->tx.ulFirstSequenceNumber,
+							ulLast - pxWindow->tx.ulFirstSequenceNumber,
+							pxSegment->ulSequenceNumber - pxWindow->tx.ulFirstSequenceNumber ) );
+					}
 
-				/* Increase the left-hand value of the transmission window. */
-				pxWindow->tx.ulCurrentSequenceNumber += ulDataLength;
+					/* Increase the left-hand value of the transmission window. */
+					pxWindow->tx.ulCurrentSequenceNumber += ulDataLength;
 
-				/* This function will return the number of bytes that the tail
-				of txStream may be advanced. */
-				ulBytesConfirmed += ulDataLength;
+					/* This function will return the number of bytes that the tail
+					of txStream may be advanced. */
+					ulBytesConfirmed += ulDataLength;
 
-				/* All segments below tx.ulCurrentSequenceNumber may be freed. */
-				vTCPWindowFree( pxSegment );
+					/* All segments below tx.ulCurrentSequenceNumber may be freed. */
+					vTCPWindowFree( pxWindow, pxSegment );
 
-				/* No need to unlink it any more. */
-				xDoUnlink = pdFALSE;
-			}
+					/* No need to unlink it any more. */
+					xDoUnlink = pdFALSE;
+				}
 
-			if( ( xDoUnlink != pdFALSE ) && ( listLIST_ITEM_CONTAINER( &( pxSegment->xQueueItem ) ) != NULL ) )
-			{
-				/* Remove item from its queues. */
-				uxListRemove( &pxSegment->xQueueItem );
-			}
+				if( ( xDoUnlink != pdFALSE ) && ( listLIST_ITEM_CONTAINER( &( pxSegment->xQueueItem ) ) != NULL ) )
+				{
+					/* Remove item from its queues. */
+					uxListRemove( &pxSegment->xQueueItem );
+				}
 
-			ulSequenceNumber += ulDataLength;
+				ulSequenceNumber += ulDataLength;
+			}
 		}
+		#endif /* ipconfigTCP_WIN_USE_SEGMENT_TREE */
 
 		return ulBytesConfirmed;
 	}
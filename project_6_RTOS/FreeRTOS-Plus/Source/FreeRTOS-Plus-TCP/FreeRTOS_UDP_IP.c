@@ -50,6 +50,23 @@
 /* The expected IP version and header length coded into the IP header itself. */
 #define ipIP_VERSION_AND_HEADER_LENGTH_BYTE ( ( uint8_t ) 0x45 )
 
+#if( ipconfigCAN_FRAGMENT_OUTGOING_PACKETS != 0 )
+	/* The number of bytes of IP payload in each fragment but the last, a
+	multiple of 8. */
+	#define ipFRAGMENT_PAYLOAD_LENGTH ( ( size_t ) ( ipconfigNETWORK_MTU - ipSIZE_OF_IPv4_HEADER ) )
+
+	/*
+	 * Send a UDP datagram that is longer than the MTU in fragments.
+	 */
+	static void prvSendFragments( NetworkBufferDescriptor_t * const pxNetworkBuffer );
+
+	/*
+	 * Fill in the IP header of a fragment that is uxLength bytes long, and
+	 * starts at uxOffset in the datagram, and send it.
+	 */
+	static void prvSendFragment( NetworkBufferDescriptor_t * const pxNetworkBuffer, size_t uxOffset, size_t uxLength, BaseType_t xMoreFragments );
+#endif /* ipconfigCAN_FRAGMENT_OUTGOING_PACKETS */
+
 /* Part of the Ethernet and IP headers are always constant when sending an IPv4
 UDP packet.  This array defines the constant parts, allowing this part of the
 packet to be filled in using a simple memcpy() instead of individual writes. */
@@ -78,6 +95,7 @@ UDPPacket_t *pxUDPPacket;
 IPHeader_t *pxIPHeader;
 eARPLookupResult_t eReturned;
 uint32_t ulIPAddress = pxNetworkBuffer->ulIPAddress;
+BaseType_t xHeld = pdFALSE;
 
 	/* Map the UDP packet onto the start of the frame. */
 	pxUDPPacket = ( UDPPacket_t * ) pxNetworkBuffer->pucEthernetBuffer;
@@ -157,6 +175,18 @@ uint32_t ulIPAddress = pxNetworkBuffer->ulIPAddress;
 			/* HT:endian: changed back to network endian */
 			pxIPHeader->ulDestinationIPAddress = pxNetworkBuffer->ulIPAddress;
 
+			#if( ipconfigCAN_FRAGMENT_OUTGOING_PACKETS != 0 )
+			{
+				if( pxNetworkBuffer->xDataLength > ( size_t ) ( ipconfigNETWORK_MTU + ipSIZE_OF_ETH_HEADER ) )
+				{
+					/* The receiver tells the fragments of this datagram apart
+					by the identification field. */
+					pxIPHeader->usIdentification = FreeRTOS_htons( usPacketIdentifier );
+					usPacketIdentifier++;
+				}
+			}
+			#endif /* ipconfigCAN_FRAGMENT_OUTGOING_PACKETS */
+
 			#if( ipconfigUSE_LLMNR == 1 )
 			{
 				/* LLMNR messages are typically used on a LAN and they're
@@ -192,10 +222,26 @@ uint32_t ulIPAddress = pxNetworkBuffer->ulIPAddress;
 			outstanding, and perform retransmissions if necessary. */
 			vARPRefreshCacheEntry( NULL, ulIPAddress );
 
-			/* Generate an ARP for the required IP address. */
-			iptracePACKET_DROPPED_TO_GENERATE_ARP( pxNetworkBuffer->ulIPAddress );
-			pxNetworkBuffer->ulIPAddress = ulIPAddress;
-			vARPGenerateRequestPacket( pxNetworkBuffer );
+			#if( ipconfigARP_PENDING_PACKETS != 0 )
+			{
+				/* Keep the packet until the ARP reply comes in, and send the
+				ARP request in a new buffer. */
+				xHeld = xARPHoldPacket( pxNetworkBuffer, ulIPAddress );
+
+				if( xHeld != pdFALSE )
+				{
+					FreeRTOS_OutputARPRequest( ulIPAddress );
+				}
+			}
+			#endif /* ipconfigARP_PENDING_PACKETS */
+
+			if( xHeld == pdFALSE )
+			{
+				/* Generate an ARP for the required IP address. */
+				iptracePACKET_DROPPED_TO_GENERATE_ARP( pxNetworkBuffer->ulIPAddress );
+				pxNetworkBuffer->ulIPAddress = ulIPAddress;
+				vARPGenerateRequestPacket( pxNetworkBuffer );
+			}
 		}
 		else
 		{
@@ -204,8 +250,21 @@ uint32_t ulIPAddress = pxNetworkBuffer->ulIPAddress;
 			eReturned = eCantSendPacket;
 		}
 	}
+	#if( ipconfigARP_PENDING_PACKETS != 0 )
+	else
+	{
+		/* Either there is no IP address or router, or an ARP request is
+		outstanding for the queried address.  In the latter case, the packet
+		can be held. */
+		xHeld = xARPHoldPacket( pxNetworkBuffer, ulIPAddress );
+	}
+	#endif /* ipconfigARP_PENDING_PACKETS */
 
-	if( eReturned != eCantSendPacket )
+	if( xHeld != pdFALSE )
+	{
+		/* The packet will be sent, or released, by the ARP module. */
+	}
+	else if( eReturned != eCantSendPacket )
 	{
 		/* The network driver is responsible for freeing the network buffer
 		after the packet has been sent. */
@@ -225,7 +284,16 @@ uint32_t ulIPAddress = pxNetworkBuffer->ulIPAddress;
 		}
 		#endif
 
-		xNetworkInterfaceOutput( pxNetworkBuffer, pdTRUE );
+		#if( ipconfigCAN_FRAGMENT_OUTGOING_PACKETS != 0 )
+		if( pxNetworkBuffer->xDataLength > ( size_t ) ( ipconfigNETWORK_MTU + ipSIZE_OF_ETH_HEADER ) )
+		{
+			prvSendFragments( pxNetworkBuffer );
+		}
+		else
+		#endif /* ipconfigCAN_FRAGMENT_OUTGOING_PACKETS */
+		{
+			xNetworkInterfaceOutput( pxNetworkBuffer, pdTRUE );
+		}
 	}
 	else
 	{
@@ -236,6 +304,93 @@ uint32_t ulIPAddress = pxNetworkBuffer->ulIPAddress;
 }
 /*-----------------------------------------------------------*/
 
+#if( ipconfigCAN_FRAGMENT_OUTGOING_PACKETS != 0 )
+
+	static void prvSendFragments( NetworkBufferDescriptor_t * const pxNetworkBuffer )
+	{
+	NetworkBufferDescriptor_t *pxFragment;
+	const size_t uxPayloadLength = pxNetworkBuffer->xDataLength - ipIP_PAYLOAD_OFFSET;
+	size_t uxOffset, uxLength = 0u;
+
+		/* The driver sends, and releases, every network buffer on its own, so
+		each fragment but the first is copied into a buffer of its own.  These
+		are sent while the original buffer is still intact.  The first fragment
+		is sent last, from the original buffer. */
+		for( uxOffset = ipFRAGMENT_PAYLOAD_LENGTH; uxOffset < uxPayloadLength; uxOffset += uxLength )
+		{
+			uxLength = uxPayloadLength - uxOffset;
+
+			if( uxLength > ipFRAGMENT_PAYLOAD_LENGTH )
+			{
+				uxLength = ipFRAGMENT_PAYLOAD_LENGTH;
+			}
+
+			pxFragment = pxGetNetworkBufferWithDescriptor( ipIP_PAYLOAD_OFFSET + uxLength, ( TickType_t ) 0u );
+
+			if( pxFragment == NULL )
+			{
+				/* Without this fragment, the datagram can not be reassembled. */
+				break;
+			}
+
+			memcpy( pxFragment->pucEthernetBuffer, pxNetworkBuffer->pucEthernetBuffer, ipIP_PAYLOAD_OFFSET );
+			memcpy( pxFragment->pucEthernetBuffer + ipIP_PAYLOAD_OFFSET, pxNetworkBuffer->pucEthernetBuffer + ipIP_PAYLOAD_OFFSET + uxOffset, uxLength );
+			prvSendFragment( pxFragment, uxOffset, uxLength, ( ( uxOffset + uxLength ) < uxPayloadLength ) ? pdTRUE : pdFALSE );
+		}
+
+		if( uxOffset >= uxPayloadLength )
+		{
+			prvSendFragment( pxNetworkBuffer, 0u, ipFRAGMENT_PAYLOAD_LENGTH, pdTRUE );
+		}
+		else
+		{
+			vReleaseNetworkBufferAndDescriptor( pxNetworkBuffer );
+		}
+	}
+
+#endif /* ipconfigCAN_FRAGMENT_OUTGOING_PACKETS */
+/*-----------------------------------------------------------*/
+
+#if( ipconfigCAN_FRAGMENT_OUTGOING_PACKETS != 0 )
+
+	static void prvSendFragment( NetworkBufferDescriptor_t * const pxNetworkBuffer, size_t uxOffset, size_t uxLength, BaseType_t xMoreFragments )
+	{
+	IPHeader_t *pxIPHeader = &( ( ( IPPacket_t * ) pxNetworkBuffer->pucEthernetBuffer )->xIPHeader );
+
+		pxIPHeader->usLength = FreeRTOS_htons( ( uint16_t ) ( ipSIZE_OF_IPv4_HEADER + uxLength ) );
+		pxIPHeader->usFragmentOffset = FreeRTOS_htons( ( uint16_t ) ( uxOffset >> 3 ) );
+
+		if( xMoreFragments != pdFALSE )
+		{
+			pxIPHeader->usFragmentOffset |= ipFRAGMENT_FLAGS_MORE_FRAGMENTS;
+		}
+
+		pxNetworkBuffer->xDataLength = ipIP_PAYLOAD_OFFSET + uxLength;
+
+		#if( ipconfigDRIVER_INCLUDED_TX_IP_CHECKSUM == 0 )
+		{
+			pxIPHeader->usHeaderChecksum = 0u;
+			pxIPHeader->usHeaderChecksum = usGenerateChecksum( 0UL, ( uint8_t * ) &( pxIPHeader->ucVersionHeaderLength ), ipSIZE_OF_IPv4_HEADER );
+			pxIPHeader->usHeaderChecksum = ~FreeRTOS_htons( pxIPHeader->usHeaderChecksum );
+		}
+		#endif
+
+		#if defined( ipconfigETHERNET_MINIMUM_PACKET_BYTES )
+		{
+			if( pxNetworkBuffer->xDataLength < ( size_t ) ipconfigETHERNET_MINIMUM_PACKET_BYTES )
+			{
+				memset( pxNetworkBuffer->pucEthernetBuffer + pxNetworkBuffer->xDataLength, 0, ( size_t ) ipconfigETHERNET_MINIMUM_PACKET_BYTES - pxNetworkBuffer->xDataLength );
+				pxNetworkBuffer->xDataLength = ( size_t ) ipconfigETHERNET_MINIMUM_PACKET_BYTES;
+			}
+		}
+		#endif
+
+		xNetworkInterfaceOutput( pxNetworkBuffer, pdTRUE );
+	}
+
+#endif /* ipconfigCAN_FRAGMENT_OUTGOING_PACKETS */
+/*-----------------------------------------------------------*/
+
 BaseType_t xProcessReceivedUDPPacket( NetworkBufferDescriptor_t *pxNetworkBuffer, uint16_t usPort )
 {
 BaseType_t xReturn = pdPASS;
@@ -347,6 +502,18 @@ UDPPacket_t *pxUDPPacket = (UDPPacket_t *) pxNetworkBuffer->pucEthernetBuffer;
 		/* There is no socket listening to the target port, but still it might
 		be for this node. */
 
+		#if( ipconfigUSE_DNS == 1 ) && ( ( ipconfigDNS_USE_CALLBACKS != 0 ) || ( ipconfigUSE_DNS_CACHE_HASH != 0 ) )
+			/* A DNS reply for a request of which the socket has been closed
+			already, or which was sent without a socket: it may still complete
+			a call-back or fill the cache. */
+			if( pxUDPPacket->xUDPHeader.usSourcePort == FreeRTOS_ntohs( ipDNS_PORT ) )
+			{
+				vARPRefreshCacheEntry( &( pxUDPPacket->xEthernetHeader.xSourceAddress ), pxUDPPacket->xIPHeader.ulSourceIPAddress );
+				xReturn = ( BaseType_t )ulDNSHandlePacket( pxNetworkBuffer );
+			}
+			else
+		#endif /* ipconfigDNS_USE_CALLBACKS || ipconfigUSE_DNS_CACHE_HASH */
+
 		#if( ipconfigUSE_LLMNR == 1 )
 			/* a LLMNR request, check for the destination port. */
 			if( ( usPort == FreeRTOS_ntohs( ipLLMNR_PORT ) ) ||
@@ -11,6 +11,13 @@ stack repeating the checksum calculations. */
 #define ipconfigDRIVER_INCLUDED_TX_IP_CHECKSUM  ( 0 )
 #define ipconfigDRIVER_INCLUDED_RX_IP_CHECKSUM  ( 0 )
 
+/* The checksums are calculated in software.  The PIC32MX is a 32-bit CPU
+without add-with-carry, so the 16-bit halves are added to a 32-bit accumulator. */
+#define ipconfigCHECKSUM_ACCUMULATOR_BITS       ( 32 )
+
+/* Sum the TCP payload while copying it from the socket's txStream. */
+#define ipconfigUSE_CHECKSUM_COPY               ( 1 )
+
 /* Several API's will block until the result is known, or the action has been
 performed, for example FreeRTOS_send() and FreeRTOS_recv().  The timeouts can be
 set per socket, using setsockopt().  If not set, the times below will be
@@ -40,6 +47,17 @@ a socket. */
 //#define ipconfigDNS_CACHE_ENTRIES               ( 4 )
 //#define ipconfigDNS_REQUEST_ATTEMPTS            ( 2 )
 
+/* Keep eight names.  Below about 16 names the linear search of the cache is as
+fast as the hashed one or faster (tools/dnscache.c), so the hash, with its
+several addresses per name and refresh before the TTL runs out, is left off. */
+#define ipconfigUSE_DNS_CACHE                   ( 1 )
+#define ipconfigUSE_DNS_CACHE_HASH              ( 0 )
+#define ipconfigDNS_CACHE_NAME_LENGTH           ( 64 )
+#define ipconfigDNS_CACHE_ENTRIES               ( 8 )
+
+/* Send one request for a name that several tasks look up at the same time. */
+#define ipconfigDNS_COALESCE_REQUESTS           ( 1 )
+
 /*THIS NEED TO BE IN FreeRTOSConfig.h SO CHANGES MAY BE REQUIRED*/
 #define ipconfigIP_TASK_PRIORITY                ( configMAX_PRIORITIES - 3 )
 
@@ -108,7 +126,20 @@ message is sent to a remote IP address that does not already appear in the ARP
 cache then the UDP message is replaced by a ARP message that solicits the
 required MAC address information.  ipconfigARP_CACHE_ENTRIES defines the maximum
 number of entries that can exist in the ARP table at any one time. */
-//#define ipconfigARP_CACHE_ENTRIES               6
+#define ipconfigARP_CACHE_ENTRIES               64
+
+/* Find ARP cache entries through a hash table and replace the least recently
+used one when the cache is full, so the cache can hold every echo client on the
+segment. */
+#define ipconfigUSE_ARP_HASH_TABLE              ( 1 )
+//#define ipconfigARP_HASH_SLOTS                  128
+
+/* Hold up to ipconfigARP_PENDING_PACKETS outgoing UDP packets (at most
+ipconfigARP_PENDING_PACKETS_PER_ADDRESS for each destination) while their
+destination is being resolved, and send them when the ARP reply comes in. */
+#define ipconfigARP_PENDING_PACKETS             ( 4 )
+#define ipconfigARP_PENDING_PACKETS_PER_ADDRESS ( 2 )
+//#define ipconfigARP_PENDING_TIMEOUT_MS          2000
 
 /* ARP requests that do not result in an ARP response will be re-transmitted a
 maximum of ipconfigMAX_ARP_RETRANSMISSIONS times before the ARP request is
@@ -178,6 +209,16 @@ aborted. */
 /* USE_WIN: Let TCP use windowing mechanism. */
 //#define ipconfigUSE_TCP_WIN                     ( 1 )
 
+/* Find the socket of a received packet through hash tables rather than by
+walking the list of bound sockets, which grows with every echo connection. */
+#define ipconfigUSE_SOCKET_HASH                 ( 1 )
+//#define ipconfigSOCKET_HASH_BUCKETS             32
+
+/* Keep the TCP socket time-outs in a timing wheel, so that the IP-task only
+looks at the connections that need attention. */
+#define ipconfigUSE_TCP_TIMER_WHEEL             ( 1 )
+//#define ipconfigTCP_TIMER_WHEEL_SLOTS           64
+
 /* The MTU is the maximum number of bytes the payload of a network frame can
 contain.  For normal Ethernet V2 frames the maximum MTU is 1500.  Setting a
 lower value can save RAM, depending on the buffer management scheme used.  If
@@ -185,6 +226,17 @@ ipconfigCAN_FRAGMENT_OUTGOING_PACKETS is 1 then (ipconfigNETWORK_MTU - 28) must
 be divisible by 8. */
 #define ipconfigNETWORK_MTU                     1500
 
+/* Send UDP datagrams larger than the MTU in fragments, and reassemble up to two
+incoming fragmented datagrams of at most 4 KB at a time.  A datagram being
+reassembled holds a buffer of ipconfigIP_REASSEMBLY_MAX_SIZE bytes until its
+last fragment arrives, and the buffers come from the 60 KB heap
+(configTOTAL_HEAP_SIZE) that is shared with the network buffers. */
+#define ipconfigCAN_FRAGMENT_OUTGOING_PACKETS   ( 1 )
+#define ipconfigUSE_IP_REASSEMBLY               ( 1 )
+#define ipconfigIP_REASSEMBLY_MAX_DATAGRAMS     ( 2 )
+#define ipconfigIP_REASSEMBLY_MAX_SIZE          ( 4096 )
+//#define ipconfigIP_REASSEMBLY_TIMEOUT_MS        3000
+
 /* Set ipconfigUSE_DNS to 1 to include a basic DNS client/resolver.  DNS is used
 through the FreeRTOS_gethostbyname() API function. */
 //#define ipconfigUSE_DNS                         1
@@ -228,6 +280,13 @@ outstanding packets (for Rx and Tx).  When using up to 10 TP sockets
 simultaneously, one could define TCP_WIN_SEG_COUNT as 120. */
 //#define ipconfigTCP_WIN_SEG_COUNT               64
 
+/* Set ipconfigTCP_WIN_USE_SEGMENT_TREE to 1 to find TCP segments by sequence
+number through a balanced tree, and report up to four received blocks in every
+SACK option.  The tree only pays off from windows of about 64 segments; with
+the small windows of this server the lists are faster. */
+#define ipconfigTCP_WIN_USE_SEGMENT_TREE        ( 0 )
+//#define ipconfigTCP_SACK_BLOCKS                 4
+
 /* Each TCP socket has a circular buffers for Rx and Tx, which have a fixed
 maximum size.  Define the size of Rx buffer for TCP sockets. */
 //#define ipconfigTCP_RX_BUFFER_LENGTH            ( 3 * ipconfigTCP_MSS )
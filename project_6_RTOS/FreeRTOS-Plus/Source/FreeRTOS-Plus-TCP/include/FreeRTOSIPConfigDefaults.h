@@ -557,4 +557,275 @@ connections, hang protection can help reduce the impact of SYN floods. */
 	#define ipconfigPACKET_FILLER_SIZE 2
 #endif
 
+/* BufferAllocation_2.c only: the index of the heap_5.c region from which
+Ethernet buffers are allocated with pvPortMallocRegion(), for example a DMA
+coherent region.  Negative values use pvPortMalloc(). */
+#ifndef ipconfigBUFFER_ALLOCATION_HEAP_REGION
+	#define ipconfigBUFFER_ALLOCATION_HEAP_REGION -1
+#endif
+
+/* When 1, received packets are matched to their socket through hash tables
+instead of walking the bound socket lists: UDP sockets and TCP sockets bound by
+the application by local port, and the connected children of listening TCP
+sockets by local port, remote IP address and remote port.  The lists are still
+kept for everything else.  Costs one pointer per socket and three tables of
+ipconfigSOCKET_HASH_BUCKETS pointers. */
+#ifndef ipconfigUSE_SOCKET_HASH
+	#define ipconfigUSE_SOCKET_HASH 0
+#endif
+
+/* Number of buckets in each socket hash table, a power of 2. */
+#ifndef ipconfigSOCKET_HASH_BUCKETS
+	#define ipconfigSOCKET_HASH_BUCKETS 32
+#endif
+
+#if( ( ipconfigSOCKET_HASH_BUCKETS & ( ipconfigSOCKET_HASH_BUCKETS - 1 ) ) != 0 )
+	#error ipconfigSOCKET_HASH_BUCKETS must be a power of 2
+#endif
+
+/* When 1, each TCP socket with a time-out (retransmission, delayed ACK,
+keep-alive, connect or hang protection, all kept in usTimeout) is put in a
+hashed timing wheel of ipconfigTCP_TIMER_WHEEL_SLOTS slots.  When the TCP timer
+expires, xTCPTimerCheck() only looks at the sockets whose deadline has passed
+or whose time-out or events changed, instead of at every bound TCP socket. */
+#ifndef ipconfigUSE_TCP_TIMER_WHEEL
+	#define ipconfigUSE_TCP_TIMER_WHEEL 0
+#endif
+
+/* Number of slots in the TCP timer wheel, a power of 2.  A socket is in slot
+( deadline % slots ), so each slot holds about 1 / slots of the sockets. */
+#ifndef ipconfigTCP_TIMER_WHEEL_SLOTS
+	#define ipconfigTCP_TIMER_WHEEL_SLOTS 64
+#endif
+
+#if( ( ipconfigTCP_TIMER_WHEEL_SLOTS & ( ipconfigTCP_TIMER_WHEEL_SLOTS - 1 ) ) != 0 )
+	#error ipconfigTCP_TIMER_WHEEL_SLOTS must be a power of 2
+#endif
+
+/* Selects the implementation of usGenerateChecksum().  0: the original one,
+which counts the carries of its 32-bit additions.  64: adds 32-bit words to a
+64-bit accumulator and folds the carries once at the end, best for CPUs with
+64-bit registers or add-with-carry.  32: adds the 16-bit halves of each word to
+a 32-bit accumulator, for CPUs where 64-bit additions are expensive. */
+#ifndef ipconfigCHECKSUM_ACCUMULATOR_BITS
+	#define ipconfigCHECKSUM_ACCUMULATOR_BITS 0
+#endif
+
+#if( ( ipconfigCHECKSUM_ACCUMULATOR_BITS != 0 ) && ( ipconfigCHECKSUM_ACCUMULATOR_BITS != 32 ) && ( ipconfigCHECKSUM_ACCUMULATOR_BITS != 64 ) )
+	#error ipconfigCHECKSUM_ACCUMULATOR_BITS must be 0, 32 or 64
+#endif
+
+/* When 1, prvTCPPrepareSend() sums the TCP payload while copying it from the
+txStream into the network buffer, and keeps the partial sum in the network
+buffer descriptor.  prvTCPReturnPacket() then only sums the pseudo header and
+the TCP header, instead of reading the payload a second time.  Only useful when
+ipconfigDRIVER_INCLUDED_TX_IP_CHECKSUM is 0. */
+#ifndef ipconfigUSE_CHECKSUM_COPY
+	#define ipconfigUSE_CHECKSUM_COPY 0
+#endif
+
+/* When 1, the ARP cache rows are found through an open-addressed hash table
+keyed by IP address, instead of by comparing all ipconfigARP_CACHE_ENTRIES rows
+for every packet sent or received.  The rows are kept in least recently used
+order, and when the cache is full the least recently used entry is replaced.
+This makes ARP caches with hundreds of entries practical. */
+#ifndef ipconfigUSE_ARP_HASH_TABLE
+	#define ipconfigUSE_ARP_HASH_TABLE 0
+#endif
+
+/* Number of slots in the ARP hash table, a power of 2 larger than
+ipconfigARP_CACHE_ENTRIES.  Each slot takes 2 bytes.  The default keeps the
+table at most half full. */
+#ifndef ipconfigARP_HASH_SLOTS
+	#if( ipconfigARP_CACHE_ENTRIES <= 8 )
+		#define ipconfigARP_HASH_SLOTS 16
+	#elif( ipconfigARP_CACHE_ENTRIES <= 16 )
+		#define ipconfigARP_HASH_SLOTS 32
+	#elif( ipconfigARP_CACHE_ENTRIES <= 32 )
+		#define ipconfigARP_HASH_SLOTS 64
+	#elif( ipconfigARP_CACHE_ENTRIES <= 64 )
+		#define ipconfigARP_HASH_SLOTS 128
+	#elif( ipconfigARP_CACHE_ENTRIES <= 128 )
+		#define ipconfigARP_HASH_SLOTS 256
+	#elif( ipconfigARP_CACHE_ENTRIES <= 256 )
+		#define ipconfigARP_HASH_SLOTS 512
+	#elif( ipconfigARP_CACHE_ENTRIES <= 512 )
+		#define ipconfigARP_HASH_SLOTS 1024
+	#else
+		#define ipconfigARP_HASH_SLOTS 2048
+	#endif
+#endif
+
+#if( ipconfigUSE_ARP_HASH_TABLE != 0 )
+	#if( ( ipconfigARP_HASH_SLOTS & ( ipconfigARP_HASH_SLOTS - 1 ) ) != 0 )
+		#error ipconfigARP_HASH_SLOTS must be a power of 2
+	#endif
+	#if( ( ipconfigARP_HASH_SLOTS <= ipconfigARP_CACHE_ENTRIES ) || ( ipconfigARP_HASH_SLOTS > 65536 ) )
+		#error ipconfigARP_HASH_SLOTS must be larger than ipconfigARP_CACHE_ENTRIES and at most 65536
+	#endif
+#endif
+
+/* When non-zero, a UDP or ICMP packet to an address of which the MAC address
+is not yet known is held, instead of being turned into an ARP request, and sent
+as soon as the ARP reply comes in.  A TCP socket that connects to such an
+address sends its SYN as soon as the reply comes in, instead of at the next
+poll.  ipconfigARP_PENDING_PACKETS is the number of network buffers that can be
+held in total, ipconfigARP_PENDING_PACKETS_PER_ADDRESS the number for each
+destination.  Held packets are dropped when no reply has come within
+ipconfigARP_PENDING_TIMEOUT_MS.  When the queue is full, the packet is turned
+into an ARP request as before. */
+#ifndef ipconfigARP_PENDING_PACKETS
+	#define ipconfigARP_PENDING_PACKETS 0
+#endif
+
+#ifndef ipconfigARP_PENDING_PACKETS_PER_ADDRESS
+	#define ipconfigARP_PENDING_PACKETS_PER_ADDRESS 2
+#endif
+
+#ifndef ipconfigARP_PENDING_TIMEOUT_MS
+	#define ipconfigARP_PENDING_TIMEOUT_MS 2000
+#endif
+
+#if( ipconfigARP_PENDING_PACKETS != 0 )
+	#if( ( ipconfigARP_PENDING_PACKETS_PER_ADDRESS < 1 ) || ( ipconfigARP_PENDING_PACKETS_PER_ADDRESS > ipconfigARP_PENDING_PACKETS ) )
+		#error ipconfigARP_PENDING_PACKETS_PER_ADDRESS must be between 1 and ipconfigARP_PENDING_PACKETS
+	#endif
+#endif
+
+/* When non-zero, the DNS cache is indexed by a hash of the name and it keeps
+up to ipconfigDNS_CACHE_ADDRESSES_PER_ENTRY addresses for each name, for as
+long as the TTL of the answer allows.  FreeRTOS_dnslookup() hands the addresses
+out in turn.  Names that do not exist, or have no address, are remembered for
+ipconfigDNS_CACHE_NEGATIVE_TTL seconds at most, or shorter when the server says
+so.  An entry that has been looked up is asked again shortly before it expires,
+so that its users keep finding it in the cache.  Requires ipconfigUSE_DNS_CACHE.
+A look-up costs a hash of the name, so it is only faster than the linear search
+from about 16 ipconfigDNS_CACHE_ENTRIES on (tools/dnscache.c). */
+#ifndef ipconfigUSE_DNS_CACHE_HASH
+	#define ipconfigUSE_DNS_CACHE_HASH 0
+#endif
+
+#ifndef ipconfigDNS_CACHE_ADDRESSES_PER_ENTRY
+	#define ipconfigDNS_CACHE_ADDRESSES_PER_ENTRY 4
+#endif
+
+#ifndef ipconfigDNS_CACHE_NEGATIVE_TTL
+	#define ipconfigDNS_CACHE_NEGATIVE_TTL 60
+#endif
+
+#ifndef ipconfigDNS_CACHE_HASH_SLOTS
+	#if( ipconfigUSE_DNS_CACHE == 0 )
+		#define ipconfigDNS_CACHE_HASH_SLOTS 2
+	#elif( ipconfigDNS_CACHE_ENTRIES <= 8 )
+		#define ipconfigDNS_CACHE_HASH_SLOTS 16
+	#elif( ipconfigDNS_CACHE_ENTRIES <= 16 )
+		#define ipconfigDNS_CACHE_HASH_SLOTS 32
+	#elif( ipconfigDNS_CACHE_ENTRIES <= 32 )
+		#define ipconfigDNS_CACHE_HASH_SLOTS 64
+	#elif( ipconfigDNS_CACHE_ENTRIES <= 64 )
+		#define ipconfigDNS_CACHE_HASH_SLOTS 128
+	#elif( ipconfigDNS_CACHE_ENTRIES <= 128 )
+		#define ipconfigDNS_CACHE_HASH_SLOTS 256
+	#else
+		#define ipconfigDNS_CACHE_HASH_SLOTS 512
+	#endif
+#endif
+
+#if( ipconfigUSE_DNS_CACHE_HASH != 0 )
+	#if( ipconfigUSE_DNS_CACHE == 0 )
+		#error ipconfigUSE_DNS_CACHE_HASH requires ipconfigUSE_DNS_CACHE
+	#endif
+	#if( ( ipconfigDNS_CACHE_ADDRESSES_PER_ENTRY < 1 ) || ( ipconfigDNS_CACHE_ADDRESSES_PER_ENTRY > 255 ) )
+		#error ipconfigDNS_CACHE_ADDRESSES_PER_ENTRY must be between 1 and 255
+	#endif
+	#if( ( ipconfigDNS_CACHE_HASH_SLOTS & ( ipconfigDNS_CACHE_HASH_SLOTS - 1 ) ) != 0 )
+		#error ipconfigDNS_CACHE_HASH_SLOTS must be a power of 2
+	#endif
+	#if( ( ipconfigDNS_CACHE_HASH_SLOTS <= ipconfigDNS_CACHE_ENTRIES ) || ( ipconfigDNS_CACHE_HASH_SLOTS > 65536 ) )
+		#error ipconfigDNS_CACHE_HASH_SLOTS must be larger than ipconfigDNS_CACHE_ENTRIES and at most 65536
+	#endif
+#endif
+
+/* When several tasks look up the same name at the same time, only one request is
+sent: later callers wait for the result of the first, and a call-back is
+attached to the look-up in progress.  A look-up started by a call with a
+call-back function is sent, and repeated, by the IP-task. */
+#ifndef ipconfigDNS_COALESCE_REQUESTS
+	#define ipconfigDNS_COALESCE_REQUESTS 0
+#endif
+
+/* When non-zero, fragmented UDP datagrams are reassembled, instead of dropped.
+At most ipconfigIP_REASSEMBLY_MAX_DATAGRAMS datagrams are reassembled at the
+same time, each in a network buffer of ipconfigIP_REASSEMBLY_MAX_SIZE bytes
+(the size of the IP payload), which requires BufferAllocation_2.c.  A datagram
+that is not complete within ipconfigIP_REASSEMBLY_TIMEOUT_MS is dropped. */
+#ifndef ipconfigUSE_IP_REASSEMBLY
+	#define ipconfigUSE_IP_REASSEMBLY 0
+#endif
+
+#ifndef ipconfigIP_REASSEMBLY_MAX_DATAGRAMS
+	#define ipconfigIP_REASSEMBLY_MAX_DATAGRAMS 2
+#endif
+
+#ifndef ipconfigIP_REASSEMBLY_MAX_SIZE
+	#define ipconfigIP_REASSEMBLY_MAX_SIZE 4096
+#endif
+
+#ifndef ipconfigIP_REASSEMBLY_TIMEOUT_MS
+	#define ipconfigIP_REASSEMBLY_TIMEOUT_MS 3000
+#endif
+
+#if( ipconfigUSE_IP_REASSEMBLY != 0 )
+	#if( ipconfigIP_REASSEMBLY_MAX_DATAGRAMS < 1 )
+		#error ipconfigIP_REASSEMBLY_MAX_DATAGRAMS must be at least 1
+	#endif
+	#if( ( ( ipconfigIP_REASSEMBLY_MAX_SIZE % 8 ) != 0 ) || ( ipconfigIP_REASSEMBLY_MAX_SIZE < 16 ) || ( ipconfigIP_REASSEMBLY_MAX_SIZE > 65512 ) )
+		#error ipconfigIP_REASSEMBLY_MAX_SIZE must be a multiple of 8, between 16 and 65512
+	#endif
+#endif
+
+/* When non-zero, UDP datagrams that do not fit in ipconfigNETWORK_MTU are sent
+in fragments, instead of being refused by FreeRTOS_sendto().  Requires
+BufferAllocation_2.c. */
+#ifndef ipconfigCAN_FRAGMENT_OUTGOING_PACKETS
+	#define ipconfigCAN_FRAGMENT_OUTGOING_PACKETS 0
+#endif
+
+#if( ipconfigCAN_FRAGMENT_OUTGOING_PACKETS != 0 )
+	#if( ( ( ipconfigNETWORK_MTU - 28 ) % 8 ) != 0 )
+		#error (ipconfigNETWORK_MTU - 28) must be divisible by 8 when ipconfigCAN_FRAGMENT_OUTGOING_PACKETS is set
+	#endif
+#endif
+
+/* When non-zero, the TCP segments of every socket are also kept in a balanced
+binary tree (AVL), ordered on sequence number.  Looking up a received segment,
+or the first segment covered by a (selective) ACK, takes O(log n) steps instead
+of a walk along all segments of the window, which matters for large windows
+with packet loss.  On a host, the tree wins from windows of about 64 segments;
+below 32 segments the lists are faster.  Every segment grows by two pointers
+and a byte. */
+#ifndef ipconfigTCP_WIN_USE_SEGMENT_TREE
+	#define ipconfigTCP_WIN_USE_SEGMENT_TREE 0
+#endif
+
+/* The maximum number of blocks in an outgoing SACK option.  Besides the block
+that holds the segment just received, the blocks that were reported most
+recently are repeated (RFC 2018).  More than one block requires
+ipconfigTCP_WIN_USE_SEGMENT_TREE.  TCP options leave space for 4 blocks. */
+#ifndef ipconfigTCP_SACK_BLOCKS
+	#if( ipconfigTCP_WIN_USE_SEGMENT_TREE != 0 )
+		#define ipconfigTCP_SACK_BLOCKS 4
+	#else
+		#define ipconfigTCP_SACK_BLOCKS 1
+	#endif
+#endif
+
+#if( ( ipconfigTCP_SACK_BLOCKS < 1 ) || ( ipconfigTCP_SACK_BLOCKS > 4 ) )
+	#error ipconfigTCP_SACK_BLOCKS must be between 1 and 4
+#endif
+
+#if( ( ipconfigTCP_SACK_BLOCKS > 1 ) && ( ipconfigTCP_WIN_USE_SEGMENT_TREE == 0 ) )
+	#error ipconfigTCP_SACK_BLOCKS larger than 1 requires ipconfigTCP_WIN_USE_SEGMENT_TREE
+#endif
+
 #endif /* FREERTOS_DEFAULT_IP_CONFIG_H */
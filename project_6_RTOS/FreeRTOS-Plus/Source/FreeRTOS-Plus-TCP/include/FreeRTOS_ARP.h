@@ -45,6 +45,10 @@ typedef struct xARP_CACHE_TABLE_ROW
 	MACAddress_t xMACAddress;  /* The MAC address of an ARP cache entry. */
 	uint8_t ucAge;				/* A value that is periodically decremented but can also be refreshed by active communication.  The ARP cache entry is removed if the value reaches zero. */
     uint8_t ucValid;			/* pdTRUE: xMACAddress is valid, pdFALSE: waiting for ARP reply */
+	#if( ipconfigUSE_ARP_HASH_TABLE != 0 )
+		uint16_t usNewer;		/* Row number + 1 of the next more recently used entry, 0 if none. */
+		uint16_t usOlder;		/* Row number + 1 of the next less recently used entry, or of the next free row. */
+	#endif
 } ARPCacheRow_t;
 
 typedef enum
@@ -121,6 +125,41 @@ void vARPGenerateRequestPacket( NetworkBufferDescriptor_t * const pxNetworkBuffe
  */
 void vARPSendGratuitous( void );
 
+#if( ipconfigARP_PENDING_PACKETS != 0 )
+
+	typedef struct xARP_PENDING_COUNTERS
+	{
+		uint32_t ulHeld;		/* Packets held while the MAC address of their destination was resolved. */
+		uint32_t ulSent;		/* Held packets sent after the MAC address became known. */
+		uint32_t ulDropped;		/* Held packets dropped after ipconfigARP_PENDING_TIMEOUT_MS, or because the network went down. */
+		uint32_t ulRejected;	/* Packets not held because the queue was full, they were turned into an ARP request instead. */
+	} ARPPendingCounters_t;
+
+	/*
+	 * Hold pxNetworkBuffer, an outgoing UDP or ICMP packet, until the MAC
+	 * address of ulIPAddress is known, and then pass it to
+	 * vProcessGeneratedUDPPacket() again.  ulIPAddress is the address that
+	 * was looked up, i.e. the destination or the gateway.  A packet is only held
+	 * when an ARP request for ulIPAddress is outstanding.  When pxNetworkBuffer
+	 * is NULL, connecting TCP sockets will be woken up when the MAC address of
+	 * ulIPAddress becomes known.  Returns pdTRUE if the packet is held, and
+	 * pdFALSE if the caller must still deal with it.
+	 */
+	BaseType_t xARPHoldPacket( NetworkBufferDescriptor_t * const pxNetworkBuffer, uint32_t ulIPAddress );
+
+	/*
+	 * Drop the held packets of which the time has expired.  Called from the IP
+	 * task when the timer set by vIPReloadARPPendingTimer() expires.
+	 */
+	void vARPCheckPendingPackets( void );
+
+	/*
+	 * Copy the counters of the held packets into *pxCounters.
+	 */
+	void vARPGetPendingCounters( ARPPendingCounters_t *pxCounters );
+
+#endif /* ipconfigARP_PENDING_PACKETS */
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
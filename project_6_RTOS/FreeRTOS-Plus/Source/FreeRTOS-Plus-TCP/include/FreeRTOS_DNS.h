@@ -88,6 +88,23 @@ uint32_t ulDNSHandlePacket( NetworkBufferDescriptor_t *pxNetworkBuffer );
 
 #endif /* ipconfigUSE_DNS_CACHE != 0 */
 
+#if( ipconfigUSE_DNS_CACHE_HASH != 0 )
+
+	/*
+	 * Copy at most xMaxCount of the cached addresses of pcHostName to
+	 * pulAddresses, and return the number copied.  Zero is returned when the
+	 * name is not in the cache, or when it is known not to exist.
+	 */
+	BaseType_t FreeRTOS_dnslookup_all( const char *pcHostName, uint32_t *pulAddresses, BaseType_t xMaxCount );
+
+	/*
+	 * Called by the IP-task when the DNS cache timer expires: ask again for the
+	 * names that have been looked up and will soon expire.
+	 */
+	void vDNSCheckCache( void );
+
+#endif /* ipconfigUSE_DNS_CACHE_HASH != 0 */
+
 #if( ipconfigDNS_USE_CALLBACKS != 0 )
 
 	/*
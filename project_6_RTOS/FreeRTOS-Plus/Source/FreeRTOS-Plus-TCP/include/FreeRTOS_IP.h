@@ -94,6 +94,10 @@ typedef struct xNETWORK_BUFFER
 	size_t xDataLength; 			/* Starts by holding the total Ethernet frame length, then the UDP/TCP payload length. */
 	uint16_t usPort;				/* Source or destination port, depending on usage scenario. */
 	uint16_t usBoundPort;			/* The port to which a transmitting socket is bound. */
+	#if( ipconfigUSE_CHECKSUM_COPY != 0 )
+		uint16_t usPayloadChecksum;		/* Sum of the TCP payload, as returned by usGenerateChecksum(). */
+		uint16_t usPayloadChecksumLength; /* The number of payload bytes in usPayloadChecksum, 0 when not set. */
+	#endif
 	#if( ipconfigUSE_LINKED_RX_MESSAGES != 0 )
 		struct xNETWORK_BUFFER *pxNextBuffer; /* Possible optimisation for expert users - requires network driver support. */
 	#endif
@@ -228,8 +228,13 @@ typedef union XPROT_PACKET
 } ProtocolPacket_t;
 
 
-/* The maximum UDP payload length. */
-#define ipMAX_UDP_PAYLOAD_LENGTH ( ( ipconfigNETWORK_MTU - ipSIZE_OF_IPv4_HEADER ) - ipSIZE_OF_UDP_HEADER )
+/* The maximum UDP payload length.  When outgoing packets can be fragmented,
+it is limited by the 16-bit length field of the IP header. */
+#if( ipconfigCAN_FRAGMENT_OUTGOING_PACKETS != 0 )
+	#define ipMAX_UDP_PAYLOAD_LENGTH ( ( 0xffffU - ipSIZE_OF_IPv4_HEADER ) - ipSIZE_OF_UDP_HEADER )
+#else
+	#define ipMAX_UDP_PAYLOAD_LENGTH ( ( ipconfigNETWORK_MTU - ipSIZE_OF_IPv4_HEADER ) - ipSIZE_OF_UDP_HEADER )
+#endif
 
 typedef enum
 {
@@ -254,6 +259,7 @@ typedef enum
 	eSocketCloseEvent,		/* 9: Send a message to the IP-task to close a socket. */
 	eSocketSelectEvent,		/*10: Send a message to the IP-task for select(). */
 	eSocketSignalEvent,		/*11: A socket must be signalled. */
+	eDNSTimerEvent,			/*12: Send the DNS requests of look-ups with a call-back. */
 } eIPEvent_t;
 
 typedef struct IP_TASK_COMMANDS
@@ -304,6 +310,11 @@ typedef struct xUDP_IP_FRAGMENT_PARAMETERS IPFragmentParameters_t;
 	#define ipARP_REQUEST					( 0x0100U )
 	#define ipARP_REPLY						( 0x0200U )
 
+	/* The bits in the two byte IP header field that make up the fragment
+	offset value, and the 'more fragments' flag. */
+	#define ipFRAGMENT_OFFSET_BIT_MASK		( ( uint16_t ) 0xff1fU )
+	#define ipFRAGMENT_FLAGS_MORE_FRAGMENTS	( ( uint16_t ) 0x0020U )
+
 #else
 
 	/* Ethernet frame types. */
@@ -316,6 +327,11 @@ typedef struct xUDP_IP_FRAGMENT_PARAMETERS IPFragmentParameters_t;
 	#define ipARP_REQUEST ( 0x0001 )
 	#define ipARP_REPLY ( 0x0002 )
 
+	/* The bits in the two byte IP header field that make up the fragment
+	offset value, and the 'more fragments' flag. */
+	#define ipFRAGMENT_OFFSET_BIT_MASK ( ( uint16_t ) 0x1fffU )
+	#define ipFRAGMENT_FLAGS_MORE_FRAGMENTS ( ( uint16_t ) 0x2000U )
+
 #endif /* ipconfigBYTE_ORDER == pdFREERTOS_LITTLE_ENDIAN */
 
 
@@ -435,6 +451,15 @@ eFrameProcessingResult_t eConsiderFrameForProcessing( const uint8_t * const pucE
  */
 uint16_t usGenerateChecksum( uint32_t ulSum, const uint8_t * pucNextData, size_t uxDataLengthBytes );
 
+#if( ipconfigUSE_CHECKSUM_COPY != 0 )
+	/*
+	 * Copy uxDataLengthBytes from pucSource to pucTarget and return the checksum
+	 * that usGenerateChecksum( ulSum, pucTarget, uxDataLengthBytes ) would return
+	 * after the copy.
+	 */
+	uint16_t usGenerateChecksumCopy( uint32_t ulSum, uint8_t * pucTarget, const uint8_t * pucSource, size_t uxDataLengthBytes );
+#endif
+
 /* Socket related private functions. */
 
 /* 
@@ -473,6 +498,29 @@ BaseType_t xIPIsNetworkTaskReady( void );
 	 */
 	TickType_t xTCPTimerCheck( BaseType_t xWillSleep );
 
+	#if( ipconfigUSE_TCP_TIMER_WHEEL == 1 )
+		struct XSOCKET;
+
+		/*
+		 * The usTimeout or xEventBits of a TCP socket have changed: let the
+		 * next xTCPTimerCheck() look at it.  May be called from any task.
+		 */
+		void vTCPTimerSocketChanged( struct XSOCKET *pxSocket );
+		#define ipTCP_TIMER_SOCKET_CHANGED( pxSocket )	vTCPTimerSocketChanged( pxSocket )
+	#else
+		/* xTCPTimerCheck() looks at all sockets. */
+		#define ipTCP_TIMER_SOCKET_CHANGED( pxSocket )
+	#endif /* ipconfigUSE_TCP_TIMER_WHEEL */
+
+	#if( ipconfigARP_PENDING_PACKETS != 0 )
+		/*
+		 * The MAC address of a peer or of the gateway has become known: let
+		 * the sockets that are waiting for it in the eCONNECT_SYN state send
+		 * their SYN now.
+		 */
+		void vTCPWakeUpConnectingSockets( void );
+	#endif /* ipconfigARP_PENDING_PACKETS */
+
 	/* Every TCP socket has a buffer space just big enough to store
 	the last TCP header received.
 	As a reference of this field may be passed to DMA, force the
@@ -536,6 +584,11 @@ BaseType_t xIPIsNetworkTaskReady( void );
 		uint32_t ulHighestRxAllowed;
 								/* The highest sequence number that we can receive at any moment */
 		uint16_t usTimeout;		/* Time (in ticks) after which this socket needs attention */
+		#if( ipconfigUSE_TCP_TIMER_WHEEL == 1 )
+			uint16_t usTimerArmed;			/* usTimeout when the socket was put in the timer wheel */
+			ListItem_t xTimerListItem;		/* In a slot of the timer wheel, the item value is the deadline */
+			ListItem_t xTimerChangedItem;	/* In the list of sockets that xTCPTimerCheck() must look at */
+		#endif /* ipconfigUSE_TCP_TIMER_WHEEL */
 		uint16_t usCurMSS;		/* Current Maximum Segment Size */
 		uint16_t usInitMSS;		/* Initial maximum segment Size */
 		uint16_t usChildCount;	/* In case of a listening socket: number of connections on this port number */
@@ -618,6 +671,10 @@ typedef struct XSOCKET
 	EventGroupHandle_t xEventGroup;
 
 	ListItem_t xBoundSocketListItem; /* Used to reference the socket from a bound sockets list. */
+	#if( ipconfigUSE_SOCKET_HASH == 1 )
+		struct XSOCKET **ppxHashBucket;	/* The hash bucket the socket is in, or NULL. */
+		struct XSOCKET *pxHashNext;		/* The next socket in that bucket. */
+	#endif /* ipconfigUSE_SOCKET_HASH */
 	TickType_t xReceiveBlockTime; /* if recv[to] is called while no data is available, wait this amount of time. Unit in clock-ticks */
 	TickType_t xSendBlockTime; /* if send[to] is called while there is not enough space to send, wait this amount of time. Unit in clock-ticks */
 
@@ -662,6 +719,15 @@ typedef struct XSOCKET
 	 */
 	FreeRTOS_Socket_t *pxTCPSocketLookup( uint32_t ulLocalIP, UBaseType_t uxLocalPort, uint32_t ulRemoteIP, UBaseType_t uxRemotePort );
 
+	#if( ipconfigUSE_SOCKET_HASH == 1 )
+		/*
+		 * Called by the IP-task once a listening socket has set the remote IP
+		 * address and port of a new child socket, to add the child to the
+		 * connection hash table.
+		 */
+		void vSocketHashAddConnection( FreeRTOS_Socket_t *pxSocket );
+	#endif /* ipconfigUSE_SOCKET_HASH */
+
 #endif /* ipconfigUSE_TCP */
 
 /*
@@ -803,6 +869,14 @@ void vIPReloadDHCPTimer( uint32_t ulLeaseTime );
 	void vIPReloadDNSTimer( uint32_t ulCheckTime );
 	void vIPSetDnsTimerEnableState( BaseType_t xEnableState );
 #endif
+#if( ipconfigARP_PENDING_PACKETS != 0 )
+	void vIPReloadARPPendingTimer( TickType_t xTime );
+	void vIPSetARPPendingTimerEnableState( BaseType_t xEnableState );
+#endif
+#if( ipconfigUSE_DNS_CACHE_HASH != 0 )
+	void vIPReloadDNSCacheTimer( TickType_t xTime );
+	void vIPSetDNSCacheTimerEnableState( BaseType_t xEnableState );
+#endif
 
 /* Send the network-up event and start the ARP timer. */
 void vIPNetworkUpCalls( void );
@@ -251,6 +251,15 @@ size_t uxStreamBufferAdd( StreamBuffer_t *pxBuffer, size_t uxOffset, const uint8
  */
 size_t uxStreamBufferGet( StreamBuffer_t *pxBuffer, size_t uxOffset, uint8_t *pucData, size_t uxMaxCount, BaseType_t xPeek );
 
+#if( ipconfigUSE_CHECKSUM_COPY != 0 )
+	/*
+	 * Like uxStreamBufferGet() with xPeek set to pdTRUE, but the checksum of the
+	 * bytes, as returned by usGenerateChecksum(), is calculated while copying
+	 * them and written to '*pusChecksum'.
+	 */
+	size_t uxStreamBufferGetChecksum( const StreamBuffer_t *pxBuffer, size_t uxOffset, uint8_t *pucData, size_t uxMaxCount, uint16_t *pusChecksum );
+#endif
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -65,6 +65,11 @@ typedef struct xTCP_SEGMENT
 #if( ipconfigUSE_TCP_WIN != 0 )
 	struct xLIST_ITEM xQueueItem;	/* TX only: segments can be linked in one of three queues: xPriorityQueue, xTxQueue, and xWaitQueue */
 	struct xLIST_ITEM xListItem;	/* With this item the segment can be connected to a list, depending on who is owning it */
+	#if( ipconfigTCP_WIN_USE_SEGMENT_TREE != 0 )
+		struct xTCP_SEGMENT *pxLeft;	/* Segment tree of the window: the segments with a lower sequence number */
+		struct xTCP_SEGMENT *pxRight;	/* and the segments with a higher sequence number */
+		uint8_t ucHeight;				/* Height of the sub-tree that starts at this segment, 1 for a leaf */
+	#endif
 #endif
 } TCPSegment_t;
 
@@ -85,6 +90,18 @@ typedef struct xTCP_WINSIZE
 	#define ipSIZE_TCP_OPTIONS   12u
 #endif
 
+#if( ipconfigUSE_TCP_WIN == 1 )
+	/* The SACK option that is sent with ipconfigTCP_SACK_BLOCKS blocks: 2 NOP's,
+	kind and length, followed by 8 bytes for every block. */
+	#define ipSIZE_TCP_SACK_OPTION	( 4u + ( 8u * ipconfigTCP_SACK_BLOCKS ) )
+
+	#if( ipSIZE_TCP_SACK_OPTION > ipSIZE_TCP_OPTIONS )
+		#define ipSIZE_TCP_OPTIONS_DATA	ipSIZE_TCP_SACK_OPTION
+	#else
+		#define ipSIZE_TCP_OPTIONS_DATA	ipSIZE_TCP_OPTIONS
+	#endif
+#endif
+
 /*
  *	Every TCP connection owns a TCP window for the administration of all packets
  *	It owns two sets of segment descriptors, incoming and outgoing
@@ -123,9 +140,19 @@ typedef struct xTCP_WINDOW
 	List_t xTxQueue;					/* Transmit queue: segments queued for transmission */
 	List_t xWaitQueue;					/* Waiting queue:  outstanding segments */
 	TCPSegment_t *pxHeadSegment;		/* points to a segment which has not been transmitted and it's size is still growing (user data being added) */
-	uint32_t ulOptionsData[ipSIZE_TCP_OPTIONS/sizeof(uint32_t)];	/* Contains the options we send out */
+	uint32_t ulOptionsData[ipSIZE_TCP_OPTIONS_DATA/sizeof(uint32_t)];	/* Contains the options we send out */
 	List_t xTxSegments;					/* A linked list of all transmission segments, sorted on sequence number */
 	List_t xRxSegments;					/* A linked list of reception segments, order depends on sequence of arrival */
+	#if( ipconfigTCP_WIN_USE_SEGMENT_TREE != 0 )
+		TCPSegment_t *pxTxTree;			/* Root of a balanced tree of the xTxSegments that are not ACK'd yet, ordered on sequence number */
+		TCPSegment_t *pxRxTree;			/* Root of a balanced tree of the xRxSegments, ordered on sequence number */
+		struct
+		{
+			uint32_t ulFirst;			/* Sequence number of the first byte of the block */
+			uint32_t ulLast;			/* Sequence number of the last byte of the block + 1 */
+		} xSackBlocks[ ipconfigTCP_SACK_BLOCKS ];	/* The SACK blocks that were sent most recently, the latest first */
+		uint8_t ucSackBlockCount;		/* Number of valid entries in xSackBlocks[] */
+	#endif
 #else
 	/* For tiny TCP, there is only 1 outstanding TX segment */
 	TCPSegment_t xTxSegment;			/* Priority queue */
@@ -190,4 +190,12 @@ http://www.FreeRTOS.org/FreeRTOS-Plus/FreeRTOS_Plus_TCP/TCP_IP_Trace.html */
 	#define iptraceSENDTO_DATA_TOO_LONG()
 #endif
 
+#ifndef iptraceIP_REASSEMBLY_DROPPED
+	#define iptraceIP_REASSEMBLY_DROPPED( ulSourceIPAddress )
+#endif
+
+#ifndef iptraceDNS_REPLY_DROPPED
+	#define iptraceDNS_REPLY_DROPPED( ulSourceIPAddress )
+#endif
+
 #endif /* UDP_TRACE_MACRO_DEFAULTS_H */
@@ -46,6 +46,11 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "NetworkInterface.h"
 #include "NetworkBufferManagement.h"
 
+/* All buffers have the size of a single frame. */
+#if( ( ipconfigUSE_IP_REASSEMBLY != 0 ) || ( ipconfigCAN_FRAGMENT_OUTGOING_PACKETS != 0 ) )
+	#error ipconfigUSE_IP_REASSEMBLY and ipconfigCAN_FRAGMENT_OUTGOING_PACKETS require BufferAllocation_2.c
+#endif
+
 /* For an Ethernet interrupt to be able to obtain a network buffer there must
 be at least this number of buffers available. */
 #define baINTERRUPT_BUFFER_GET_THRESHOLD	( 3 )
@@ -281,6 +286,13 @@ UBaseType_t uxCount;
 				}
 				#endif /* ipconfigUSE_LINKED_RX_MESSAGES */
 
+				#if( ipconfigUSE_CHECKSUM_COPY != 0 )
+				{
+					/* No payload checksum has been calculated yet. */
+					pxReturn->usPayloadChecksumLength = 0u;
+				}
+				#endif /* ipconfigUSE_CHECKSUM_COPY */
+
 				if( xTCPWindowLoggingLevel > 3 )
 				{
 					FreeRTOS_debug_printf( ( "BUF_GET[%ld]: %p (%p)\n",
@@ -326,6 +338,12 @@ NetworkBufferDescriptor_t *pxReturn = NULL;
 			ipconfigBUFFER_ALLOC_UNLOCK_FROM_ISR();
 
 			iptraceNETWORK_BUFFER_OBTAINED_FROM_ISR( pxReturn );
+
+			#if( ipconfigUSE_CHECKSUM_COPY != 0 )
+			{
+				pxReturn->usPayloadChecksumLength = 0u;
+			}
+			#endif /* ipconfigUSE_CHECKSUM_COPY */
 		}
 	}
 
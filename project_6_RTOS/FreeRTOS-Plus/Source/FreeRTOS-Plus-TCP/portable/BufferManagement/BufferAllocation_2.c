@@ -71,6 +71,14 @@ replace the packet that was requested to be sent. */
 	STATIC_ASSERT( ipconfigETHERNET_MINIMUM_PACKET_BYTES <= baMINIMAL_BUFFER_SIZE );
 #endif
 
+/* Ethernet buffers are taken from a single heap_5 region, for example one that
+is DMA coherent, when ipconfigBUFFER_ALLOCATION_HEAP_REGION is not negative. */
+#if( ipconfigBUFFER_ALLOCATION_HEAP_REGION >= 0 )
+	#define baMALLOC( xSize )	pvPortMallocRegion( ipconfigBUFFER_ALLOCATION_HEAP_REGION, ( xSize ) )
+#else
+	#define baMALLOC( xSize )	pvPortMalloc( xSize )
+#endif
+
 /* A list of free (available) NetworkBufferDescriptor_t structures. */
 static List_t xFreeBuffersList;
 
@@ -177,7 +185,7 @@ size_t xSize = *pxRequestedSizeBytes;
 	/* Allocate a buffer large enough to store the requested Ethernet frame size
 	and a pointer to a network buffer structure (hence the addition of
 	ipBUFFER_PADDING bytes). */
-	pucEthernetBuffer = ( uint8_t * ) pvPortMalloc( xSize + ipBUFFER_PADDING );
+	pucEthernetBuffer = ( uint8_t * ) baMALLOC( xSize + ipBUFFER_PADDING );
 	configASSERT( pucEthernetBuffer );
 
 	if( pucEthernetBuffer != NULL )
@@ -250,7 +258,7 @@ size_t uxCount;
 		{
 			/* Extra space is obtained so a pointer to the network buffer can
 			be stored at the beginning of the buffer. */
-			pxReturn->pucEthernetBuffer = ( uint8_t * ) pvPortMalloc( xRequestedSizeBytes + ipBUFFER_PADDING );
+			pxReturn->pucEthernetBuffer = ( uint8_t * ) baMALLOC( xRequestedSizeBytes + ipBUFFER_PADDING );
 
 			if( pxReturn->pucEthernetBuffer == NULL )
 			{
@@ -279,6 +287,13 @@ size_t uxCount;
 					pxReturn->pxNextBuffer = NULL;
 				}
 				#endif /* ipconfigUSE_LINKED_RX_MESSAGES */
+
+				#if( ipconfigUSE_CHECKSUM_COPY != 0 )
+				{
+					/* No payload checksum has been calculated yet. */
+					pxReturn->usPayloadChecksumLength = 0u;
+				}
+				#endif /* ipconfigUSE_CHECKSUM_COPY */
 			}
 		}
 		else
@@ -718,6 +718,45 @@ extern "C" {
 	#define configUSE_MALLOC_FAILED_HOOK 0
 #endif
 
+#ifndef configHEAP_MAX_REGIONS
+	/* The number of regions heap_5.c can manage. */
+	#define configHEAP_MAX_REGIONS 4
+#endif
+
+#ifndef configUSE_HEAP_PROFILER
+	#define configUSE_HEAP_PROFILER 0
+#endif
+
+#if ( configUSE_HEAP_PROFILER == 1 )
+
+	#ifndef configHEAP_PROFILER_MAX_SITES
+		#define configHEAP_PROFILER_MAX_SITES 32
+	#endif
+
+	#ifndef configHEAP_PROFILER_MAX_LIVE_BLOCKS
+		#define configHEAP_PROFILER_MAX_LIVE_BLOCKS 128
+	#endif
+
+	#ifndef configHEAP_PROFILER_LINE_LENGTH
+		#define configHEAP_PROFILER_LINE_LENGTH 64
+	#endif
+
+	#ifndef configHEAP_PROFILER_CALL_SITE
+		/* Evaluated inside pvPortMalloc(), so yields the caller of pvPortMalloc(). */
+		#define configHEAP_PROFILER_CALL_SITE() __builtin_return_address( 0 )
+	#endif
+
+	#ifndef configHEAP_PROFILER_GET_TIMESTAMP
+		/* Latency is not measured unless a timestamp source is provided. */
+		#define configHEAP_PROFILER_GET_TIMESTAMP() ( 0UL )
+	#endif
+
+#endif /* configUSE_HEAP_PROFILER */
+
+#ifndef configUSE_QUEUE_STATS
+	#define configUSE_QUEUE_STATS 0
+#endif
+
 #ifndef portPRIVILEGE_BIT
 	#define portPRIVILEGE_BIT ( ( UBaseType_t ) 0x00 )
 #endif
@@ -0,0 +1,145 @@
+/*
+ * FreeRTOS Kernel V10.2.0
+ * Copyright (C) 2019 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/*
+ * Optional allocation profiler for the heap_n.c memory managers.
+ *
+ * When configUSE_HEAP_PROFILER is set to 1 in FreeRTOSConfig.h the heap
+ * implementation reports every successful and failed pvPortMalloc() and every
+ * vPortFree() to the profiler.  The profiler remembers, for each live block,
+ * the call site that allocated it, the task that owned the CPU at the time and
+ * the power of two size class of the request.  From that it maintains per call
+ * site live and peak statistics and a histogram of allocation latency.
+ *
+ * All of the profiler state is statically allocated so the profiler itself
+ * never calls pvPortMalloc().  Its tables are sized by:
+ *
+ * configHEAP_PROFILER_MAX_SITES - the number of distinct call sites tracked.
+ *     Must be a power of two.
+ * configHEAP_PROFILER_MAX_LIVE_BLOCKS - the number of simultaneously live
+ *     blocks tracked.  Must be a power of two.
+ *
+ * The call site defaults to the return address of pvPortMalloc(), so is the
+ * kernel or application function that called it.  configHEAP_PROFILER_CALL_SITE()
+ * can be defined to override that.  Allocation latency is only measured if
+ * configHEAP_PROFILER_GET_TIMESTAMP() is defined to return a free running
+ * counter - on the PIC32 the CP0 count register is a good choice.
+ */
+
+#ifndef HEAP_PROFILER_H
+#define HEAP_PROFILER_H
+
+#ifndef INC_FREERTOS_H
+	#error "include FreeRTOS.h must appear in source files before include heap_profiler.h"
+#endif
+
+#if defined( __cplusplus )
+extern "C" {
+#endif
+
+/* Number of power of two size classes, and latency histogram buckets. */
+#define heapprofNUM_SIZE_CLASSES		( 16 )
+#define heapprofNUM_LATENCY_BUCKETS		( 16 )
+
+/* Statistics kept for each call site that has allocated memory. */
+typedef struct xHEAP_PROFILER_SITE
+{
+	void *pvCallSite;			/* Address from which pvPortMalloc() was called. */
+	size_t xLiveBytes;			/* Bytes currently allocated from this site. */
+	size_t xPeakLiveBytes;		/* High water mark of xLiveBytes. */
+	uint32_t ulLiveBlocks;		/* Blocks currently allocated from this site. */
+	uint32_t ulAllocations;		/* Total successful allocations from this site. */
+	uint32_t ulFrees;			/* Total frees of blocks allocated from this site. */
+	uint32_t ulFailures;		/* Total allocations from this site that returned NULL. */
+} HeapProfilerSite_t;
+
+/* Summary returned by vPortHeapProfilerGetStats(). */
+typedef struct xHEAP_PROFILER_STATS
+{
+	uint32_t ulSitesInUse;				/* Entries used in the call site table. */
+	uint32_t ulLiveBlocks;				/* Blocks currently tracked. */
+	uint32_t ulUntrackedAllocations;	/* Allocations not tracked because a table was full. */
+	uint32_t ulFailures;				/* Allocations that returned NULL, including those from untracked call sites. */
+	uint32_t ulLatencyHistogram[ heapprofNUM_LATENCY_BUCKETS ]; /* Bucket n counts latencies in [2^n, 2^(n+1)) timestamp units. */
+	uint32_t ulSizeClassLiveBlocks[ heapprofNUM_SIZE_CLASSES ]; /* Class n counts live blocks of [2^n, 2^(n+1)) bytes. */
+} HeapProfilerStats_t;
+
+/*
+ * Called by the heap implementation.  Not intended to be called directly by
+ * application code.  Both are called with the scheduler suspended.
+ */
+void vPortHeapProfilerRecordMalloc( void *pvAddress, size_t xRequestedSize, void *pvCallSite, uint32_t ulLatency ) PRIVILEGED_FUNCTION;
+void vPortHeapProfilerRecordFree( void *pvAddress ) PRIVILEGED_FUNCTION;
+
+/*
+ * Copies a consistent snapshot of the summary statistics into *pxStats.
+ */
+void vPortHeapProfilerGetStats( HeapProfilerStats_t *pxStats ) PRIVILEGED_FUNCTION;
+
+/*
+ * Copies up to uxMaxSites entries of the call site table into pxSites and
+ * returns the number of entries copied.
+ */
+UBaseType_t uxPortHeapProfilerGetSites( HeapProfilerSite_t *pxSites, UBaseType_t uxMaxSites ) PRIVILEGED_FUNCTION;
+
+/*
+ * Writes a text snapshot of the profiler state one line at a time through
+ * pvWriteLine, which is passed a NUL terminated line without a line ending.
+ * Lines are of the following forms, fields separated by single spaces and
+ * addresses written in hex:
+ *
+ * site <call site> <live bytes> <peak bytes> <live blocks> <allocs> <frees> <failures>
+ * block <address> <size> <call site> <owner task>
+ * latency <bucket> <count>
+ * class <size class> <live blocks>
+ * stack <owner task>;<call site> <live bytes>
+ * totals <live blocks> <untracked allocations> <failures>
+ *
+ * There is one "block" and one "stack" line per live block.  The "stack" lines
+ * are in the folded stack format that flame graph tools consume directly
+ * (identical stacks are summed), giving a report of live memory by task and
+ * call site.  Spaces in task names are written as underscores.
+ *
+ * Each entry is copied with the scheduler suspended and written after the
+ * scheduler has been resumed, so pvWriteLine may block.  Blocks allocated or
+ * freed while the dump is being written may or may not be listed.  Lines are
+ * at most configHEAP_PROFILER_LINE_LENGTH bytes.
+ */
+void vPortHeapProfilerDump( void ( *pvWriteLine )( const char *pcLine ) ) PRIVILEGED_FUNCTION;
+
+/*
+ * Clears the latency histogram and the cumulative allocation, free and failure
+ * counters, and sets each call site's peak back to its current live size.
+ * Live blocks remain tracked so their eventual frees are still accounted for.
+ */
+void vPortHeapProfilerReset( void ) PRIVILEGED_FUNCTION;
+
+#if defined( __cplusplus )
+}
+#endif
+
+#endif /* HEAP_PROFILER_H */
@@ -115,8 +115,22 @@ typedef struct HeapRegion
 {
 	uint8_t *pucStartAddress;
 	size_t xSizeInBytes;
+	BaseType_t xExplicitOnly;	/* Set to pdTRUE to stop pvPortMalloc() using the region. */
 } HeapRegion_t;
 
+/* Used by heap_5.c to report on a single region. */
+typedef struct HeapRegionStats
+{
+	size_t xTotalBytes;
+	size_t xFreeBytesRemaining;
+	size_t xMinimumEverFreeBytesRemaining;
+	size_t xLargestFreeBlock;
+	UBaseType_t uxFreeBlocks;
+	uint32_t ulAllocations;
+	uint32_t ulFrees;
+	uint32_t ulFailures;		/* Failed pvPortMallocRegion() calls for this region. */
+} HeapRegionStats_t;
+
 /*
  * Used to define multiple heap regions for use by heap_5.c.  This function
  * must be called before any calls to pvPortMalloc() - not creating a task,
@@ -130,6 +144,27 @@ typedef struct HeapRegion
  */
 void vPortDefineHeapRegions( const HeapRegion_t * const pxHeapRegions ) PRIVILEGED_FUNCTION;
 
+/*
+ * Used by heap_5.c.  Allocates from the region at index xRegion of the array
+ * passed to vPortDefineHeapRegions() only, returning NULL if that region does
+ * not have a large enough free block.  Memory is returned with vPortFree().
+ */
+void *pvPortMallocRegion( BaseType_t xRegion, size_t xSize ) PRIVILEGED_FUNCTION;
+
+/*
+ * Used by heap_5.c.  Fills *pxStats with the state of the region at index
+ * xRegion.  Returns pdFAIL if xRegion is not a defined region.
+ */
+BaseType_t xPortGetHeapRegionStats( BaseType_t xRegion, HeapRegionStats_t *pxStats ) PRIVILEGED_FUNCTION;
+
+/*
+ * Used by heap_5.c.  Returns the number of pvPortMalloc() calls that found no
+ * region, other than the explicit only regions, with a large enough free
+ * block.  Failed pvPortMallocRegion() calls are counted in the ulFailures
+ * member of the stats of the region that was asked for instead.
+ */
+uint32_t ulPortGetHeapMallocFailures( void ) PRIVILEGED_FUNCTION;
+
 
 /*
  * Map to the memory management routines required for the port.
@@ -61,6 +61,24 @@ typedef struct QueueDefinition * QueueSetHandle_t;
  */
 typedef struct QueueDefinition * QueueSetMemberHandle_t;
 
+/**
+ * Contention statistics kept for each queue, semaphore and mutex when
+ * configUSE_QUEUE_STATS is set to 1.  Wait times are in ticks and are measured
+ * from when a call first finds it cannot proceed until it returns, whether or
+ * not it was successful.
+ */
+typedef struct xQUEUE_STATS
+{
+	uint32_t ulSends;					/*< Items sent, or semaphores given, from tasks and interrupts. */
+	uint32_t ulReceives;				/*< Items received, or semaphores taken, from tasks and interrupts.  Peeks are not counted. */
+	uint32_t ulSendWaits;				/*< Calls that had to wait because the queue was full. */
+	uint32_t ulReceiveWaits;			/*< Calls that had to wait because the queue was empty. */
+	uint32_t ulTotalWaitTicks;			/*< Sum of the time spent by all waiting calls. */
+	uint32_t ulMaxWaitTicks;			/*< Longest time any single call waited. */
+	uint32_t ulPriorityInheritances;	/*< Times a task blocking on this mutex left the holder running at an inherited priority. */
+	UBaseType_t uxHighWaterMark;		/*< The most items ever held by the queue at once. */
+} QueueStats_t;
+
 /* For internal use only. */
 #define	queueSEND_TO_BACK		( ( BaseType_t ) 0 )
 #define	queueSEND_TO_FRONT		( ( BaseType_t ) 1 )
@@ -1487,6 +1505,42 @@ BaseType_t xQueueGiveMutexRecursive( QueueHandle_t xMutex ) PRIVILEGED_FUNCTION;
 	const char *pcQueueGetName( QueueHandle_t xQueue ) PRIVILEGED_FUNCTION; /*lint !e971 Unqualified char types are allowed for strings and single characters only. */
 #endif
 
+/*
+ * Copies the contention statistics of a queue, semaphore or mutex into
+ * *pxStats, or zeros them.  configUSE_QUEUE_STATS must be set to 1 in
+ * FreeRTOSConfig.h for these functions to be available.
+ */
+#if( configUSE_QUEUE_STATS == 1 )
+	void vQueueGetStats( QueueHandle_t xQueue, QueueStats_t *pxStats ) PRIVILEGED_FUNCTION;
+	void vQueueResetStats( QueueHandle_t xQueue ) PRIVILEGED_FUNCTION;
+#endif
+
+/*
+ * Iterates over the queue registry, returning the name and contention
+ * statistics of each registered queue, semaphore or mutex in turn.  Set
+ * *puxIndex to 0 before the first call.  Returns pdTRUE and advances *puxIndex
+ * while registered objects remain, then pdFALSE.  For example:
+ *
+ *	UBaseType_t uxIndex = 0;
+ *	const char *pcName;
+ *	QueueStats_t xStats;
+ *
+ *	while( xQueueGetNextRegisteredStats( &uxIndex, &pcName, &xStats ) != pdFALSE )
+ *	{
+ *		// Print pcName, xStats.ulSendWaits, xStats.ulMaxWaitTicks, etc.
+ *	}
+ *
+ * xQueueGetStatsByName() finds a single registered object by name.  It returns
+ * pdFALSE if no object with that name is registered.
+ *
+ * Both configUSE_QUEUE_STATS must be set to 1 and configQUEUE_REGISTRY_SIZE
+ * must be greater than 0 for these functions to be available.
+ */
+#if( ( configUSE_QUEUE_STATS == 1 ) && ( configQUEUE_REGISTRY_SIZE > 0 ) )
+	BaseType_t xQueueGetNextRegisteredStats( UBaseType_t *puxIndex, const char **ppcQueueName, QueueStats_t *pxStats ) PRIVILEGED_FUNCTION; /*lint !e971 Unqualified char types are allowed for strings and single characters only. */
+	BaseType_t xQueueGetStatsByName( const char *pcQueueName, QueueStats_t *pxStats ) PRIVILEGED_FUNCTION; /*lint !e971 Unqualified char types are allowed for strings and single characters only. */
+#endif
+
 /*
  * Generic version of the function used to creaet a queue using dynamic memory
  * allocation.  This is called by other functions and macros that create other
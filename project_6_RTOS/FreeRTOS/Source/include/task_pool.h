@@ -0,0 +1,188 @@
+/*
+ * FreeRTOS Kernel V10.2.0
+ * Copyright (C) 2019 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/*
+ * A task pool is a set of pre-created worker tasks that take jobs from a
+ * shared, bounded backlog.  Handing a short lived piece of work to a pool
+ * avoids the cost of creating and deleting a task (allocating and freeing a
+ * TCB and a stack) for every piece of work.
+ *
+ * A pool always keeps uxMinWorkers workers.  If a job is submitted when the
+ * jobs waiting for a worker outnumber the idle workers, and fewer than
+ * uxMaxWorkers workers exist, then another worker is created, and workers
+ * above the minimum delete themselves once they have been idle for
+ * xIdleTimeout ticks.  Setting uxMinWorkers equal to uxMaxWorkers
+ * gives a fixed size pool that never creates or deletes tasks once running.
+ *
+ * Each job can request the priority its worker runs at, and can ask for a
+ * callback function to be called and/or a task to be notified when it has
+ * completed.  The pool keeps statistics on queueing delay (the time from
+ * submission until a worker starts the job) and service time (the time the job
+ * function takes), both measured in ticks.
+ *
+ * INCLUDE_vTaskPrioritySet and INCLUDE_vTaskDelete must be set to 1 in
+ * FreeRTOSConfig.h to use task pools.
+ */
+
+#ifndef TASK_POOL_H
+#define TASK_POOL_H
+
+#ifndef INC_FREERTOS_H
+	#error "include FreeRTOS.h" must appear in source files before "include task_pool.h"
+#endif
+
+#include "task.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Type by which task pools are referenced.
+ */
+struct TaskPoolDef_t;
+typedef struct TaskPoolDef_t * TaskPoolHandle_t;
+
+/*
+ * Used as the uxPriority member of a TaskPoolJob_t to run the job at the
+ * priority the pool was created with.
+ */
+#define taskpoolPOOL_PRIORITY	( ( UBaseType_t ) ~( ( UBaseType_t ) 0U ) )
+
+/*
+ * The prototype of job functions and job completion callbacks.
+ */
+typedef void (*TaskPoolFunction_t)( void *pvParameters );
+
+/*
+ * Describes one job.  The job is copied by xTaskPoolSubmit() so it need not
+ * remain in scope after submission.
+ */
+typedef struct xTASK_POOL_JOB
+{
+	TaskPoolFunction_t pxFunction;		/*< The function the worker runs.  Must return when the job is done. */
+	void *pvParameters;					/*< Passed to pxFunction and pxCompletionCallback. */
+	UBaseType_t uxPriority;				/*< Priority to run the job at, or taskpoolPOOL_PRIORITY. */
+	TaskPoolFunction_t pxCompletionCallback;	/*< Called by the worker after pxFunction returns, or NULL. */
+	TaskHandle_t xTaskToNotify;			/*< Sent xTaskNotifyGive() after the job completes, or NULL. */
+} TaskPoolJob_t;
+
+/*
+ * Statistics returned by vTaskPoolGetStats().  Times are in ticks.
+ */
+typedef struct xTASK_POOL_STATS
+{
+	uint32_t ulJobsSubmitted;			/*< Jobs accepted into the backlog. */
+	uint32_t ulJobsCompleted;			/*< Jobs whose function has returned. */
+	uint32_t ulJobsRejected;			/*< Jobs refused because the backlog stayed full. */
+	uint32_t ulTotalQueueingDelay;		/*< Sum of the queueing delay of completed jobs. */
+	uint32_t ulMaxQueueingDelay;
+	uint32_t ulTotalServiceTime;		/*< Sum of the service time of completed jobs. */
+	uint32_t ulMaxServiceTime;
+	UBaseType_t uxWorkers;				/*< Workers that currently exist. */
+	UBaseType_t uxPeakWorkers;
+	UBaseType_t uxPeakBacklog;			/*< Most jobs ever waiting for a worker at once. */
+} TaskPoolStats_t;
+
+/**
+ * task_pool.h
+ *<pre>
+ TaskPoolHandle_t xTaskPoolCreate( const char * const pcName,
+                                   UBaseType_t uxMinWorkers,
+                                   UBaseType_t uxMaxWorkers,
+                                   configSTACK_DEPTH_TYPE usStackDepth,
+                                   UBaseType_t uxPriority,
+                                   UBaseType_t uxBacklog,
+                                   TickType_t xIdleTimeout );
+ </pre>
+ *
+ * Creates a task pool and its first uxMinWorkers workers.
+ *
+ * @param pcName The name given to each worker task.
+ *
+ * @param uxMinWorkers The number of workers that always exist.  Must be at
+ * least 1.
+ *
+ * @param uxMaxWorkers The most workers that can exist at once.
+ *
+ * @param usStackDepth The stack size of each worker, in words, as passed to
+ * xTaskCreate().  It must be large enough for every job run by the pool.
+ *
+ * @param uxPriority The priority at which workers wait for jobs, and at which
+ * jobs submitted with taskpoolPOOL_PRIORITY run.
+ *
+ * @param uxBacklog The most jobs that can be waiting for a worker at once.
+ *
+ * @param xIdleTimeout How long a worker above the minimum waits for a job
+ * before deleting itself.
+ *
+ * @return The handle of the pool, or NULL if there was insufficient heap to
+ * create the pool and its minimum number of workers.
+ */
+TaskPoolHandle_t xTaskPoolCreate( const char * const pcName, UBaseType_t uxMinWorkers, UBaseType_t uxMaxWorkers, configSTACK_DEPTH_TYPE usStackDepth, UBaseType_t uxPriority, UBaseType_t uxBacklog, TickType_t xIdleTimeout ) PRIVILEGED_FUNCTION; /*lint !e971 Unqualified char types are allowed for strings and single characters only. */
+
+/**
+ * task_pool.h
+ *<pre>
+ BaseType_t xTaskPoolSubmit( TaskPoolHandle_t xPool, const TaskPoolJob_t * const pxJob, TickType_t xTicksToWait );
+ </pre>
+ *
+ * Places a job in the pool's backlog.  Jobs that request a priority above the
+ * pool's priority are placed at the front of the backlog, others at the back.
+ * Must not be called from an interrupt.
+ *
+ * @param xTicksToWait How long to wait for space in the backlog if it is full.
+ *
+ * @return pdPASS if the job was accepted, otherwise errQUEUE_FULL.
+ */
+BaseType_t xTaskPoolSubmit( TaskPoolHandle_t xPool, const TaskPoolJob_t * const pxJob, TickType_t xTicksToWait ) PRIVILEGED_FUNCTION;
+
+/**
+ * task_pool.h
+ *<pre>
+ void vTaskPoolGetStats( TaskPoolHandle_t xPool, TaskPoolStats_t *pxStats );
+ </pre>
+ *
+ * Copies the pool's statistics into *pxStats.
+ */
+void vTaskPoolGetStats( TaskPoolHandle_t xPool, TaskPoolStats_t *pxStats ) PRIVILEGED_FUNCTION;
+
+/**
+ * task_pool.h
+ *<pre>
+ void vTaskPoolResetStats( TaskPoolHandle_t xPool );
+ </pre>
+ *
+ * Zeros the job counters and timing statistics of the pool.
+ */
+void vTaskPoolResetStats( TaskPoolHandle_t xPool ) PRIVILEGED_FUNCTION;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TASK_POOL_H */
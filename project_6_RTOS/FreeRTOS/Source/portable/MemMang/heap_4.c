@@ -43,6 +43,10 @@ task.h is included from an application file. */
 #include "FreeRTOS.h"
 #include "task.h"
 
+#if( configUSE_HEAP_PROFILER == 1 )
+	#include "heap_profiler.h"
+#endif
+
 #undef MPU_WRAPPERS_INCLUDED_FROM_API_FILE
 
 #if( configSUPPORT_DYNAMIC_ALLOCATION == 0 )
@@ -114,6 +118,11 @@ void *pvPortMalloc( size_t xWantedSize )
 {
 BlockLink_t *pxBlock, *pxPreviousBlock, *pxNewBlockLink;
 void *pvReturn = NULL;
+#if( configUSE_HEAP_PROFILER == 1 )
+	void *pvCallSite = configHEAP_PROFILER_CALL_SITE();
+	size_t xRequestedSize = xWantedSize;
+	uint32_t ulStartTime = ( uint32_t ) configHEAP_PROFILER_GET_TIMESTAMP();
+#endif
 
 	vTaskSuspendAll();
 	{
@@ -238,6 +247,12 @@ void *pvReturn = NULL;
 		}
 
 		traceMALLOC( pvReturn, xWantedSize );
+
+		#if( configUSE_HEAP_PROFILER == 1 )
+		{
+			vPortHeapProfilerRecordMalloc( pvReturn, xRequestedSize, pvCallSite, ( uint32_t ) configHEAP_PROFILER_GET_TIMESTAMP() - ulStartTime );
+		}
+		#endif
 	}
 	( void ) xTaskResumeAll();
 
@@ -291,6 +306,13 @@ BlockLink_t *pxLink;
 					/* Add this block to the list of free blocks. */
 					xFreeBytesRemaining += pxLink->xBlockSize;
 					traceFREE( pv, pxLink->xBlockSize );
+
+					#if( configUSE_HEAP_PROFILER == 1 )
+					{
+						vPortHeapProfilerRecordFree( pv );
+					}
+					#endif
+
 					prvInsertBlockIntoFreeList( ( ( BlockLink_t * ) pxLink ) );
 				}
 				( void ) xTaskResumeAll();
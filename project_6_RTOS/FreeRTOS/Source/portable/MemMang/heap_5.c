@@ -48,6 +48,7 @@
  * {
  *	uint8_t *pucStartAddress; << Start address of a block of memory that will be part of the heap.
  *	size_t xSizeInBytes;	  << Size of the block of memory.
+ *	BaseType_t xExplicitOnly; << pdTRUE if only pvPortMallocRegion() may use the block.
  * } HeapRegion_t;
  *
  * The array is terminated using a NULL zero sized region definition, and the
@@ -66,6 +67,25 @@
  *
  * Note 0x80000000 is the lower address so appears in the array first.
  *
+ * Each region has its own free list and statistics, and is identified by its
+ * index in the array.  pvPortMalloc() tries each region that does not have
+ * xExplicitOnly set, in array order.  pvPortMallocRegion() only ever allocates
+ * from the region it is given, so memory with special properties - such as an
+ * uncached, DMA coherent block - can be kept for the drivers that need it:
+ *
+ * static uint8_t ucDMAHeap[ 0x2000 ] __attribute__((coherent));
+ *
+ * HeapRegion_t xHeapRegions[] =
+ * {
+ * 	{ ucHeap, sizeof( ucHeap ), pdFALSE },       << Region 0, general purpose.
+ * 	{ ucDMAHeap, sizeof( ucDMAHeap ), pdTRUE },  << Region 1, DMA buffers only.
+ * 	{ NULL, 0, pdFALSE }
+ * };
+ *
+ * pucBuffer = pvPortMallocRegion( 1, xSize );
+ *
+ * At most configHEAP_MAX_REGIONS regions can be defined.
+ *
  */
 #include <stdlib.h>
 
@@ -77,6 +97,10 @@ task.h is included from an application file. */
 #include "FreeRTOS.h"
 #include "task.h"
 
+#if( configUSE_HEAP_PROFILER == 1 )
+	#include "heap_profiler.h"
+#endif
+
 #undef MPU_WRAPPERS_INCLUDED_FROM_API_FILE
 
 #if( configSUPPORT_DYNAMIC_ALLOCATION == 0 )
@@ -97,29 +121,66 @@ typedef struct A_BLOCK_LINK
 	size_t xBlockSize;						/*<< The size of the free block. */
 } BlockLink_t;
 
+/* Each region keeps its own free list, bounded by its own start and end
+markers, so allocations can be directed at a particular region. */
+typedef struct A_HEAP_REGION_STATE
+{
+	BlockLink_t xStart;						/*<< Marks the start of the region's free list. */
+	BlockLink_t *pxEnd;						/*<< Marks the end of the region's free list, and the top of the region. */
+	size_t xTotalBytes;						/*<< Usable bytes in the region once initialised. */
+	size_t xFreeBytesRemaining;
+	size_t xMinimumEverFreeBytesRemaining;
+	uint32_t ulAllocations;
+	uint32_t ulFrees;
+	uint32_t ulFailures;
+	BaseType_t xExplicitOnly;				/*<< pdTRUE if pvPortMalloc() must not use this region. */
+} HeapRegionState_t;
+
 /*-----------------------------------------------------------*/
 
 /*
  * Inserts a block of memory that is being freed into the correct position in
- * the list of free memory blocks.  The block being freed will be merged with
- * the block in front it and/or the block behind it if the memory blocks are
- * adjacent to each other.
+ * the list of free memory blocks of the region it belongs to.  The block being
+ * freed will be merged with the block in front it and/or the block behind it if
+ * the memory blocks are adjacent to each other.
+ */
+static void prvInsertBlockIntoFreeList( HeapRegionState_t *pxRegion, BlockLink_t *pxBlockToInsert );
+
+/*
+ * Takes a block of at least xWantedSize bytes (already adjusted to include the
+ * block header and alignment) from the free list of pxRegion.  Returns NULL if
+ * the region does not contain a large enough free block.
+ */
+static void *prvAllocateFromRegion( HeapRegionState_t *pxRegion, size_t xWantedSize );
+
+/*
+ * Common implementation of pvPortMalloc() and pvPortMallocRegion().  xRegion is
+ * heapANY_REGION to try each region that is not explicit only in turn.
+ */
+static void *prvMalloc( BaseType_t xRegion, size_t xWantedSize, void *pvCallSite );
+
+/*
+ * Returns the region that contains pv, or NULL if pv is not within the heap.
  */
-static void prvInsertBlockIntoFreeList( BlockLink_t *pxBlockToInsert );
+static HeapRegionState_t *prvRegionContaining( const void *pv );
 
 /*-----------------------------------------------------------*/
 
+/* Passed to prvMalloc() by pvPortMalloc(). */
+#define heapANY_REGION	( ( BaseType_t ) -1 )
+
 /* The size of the structure placed at the beginning of each allocated memory
 block must by correctly byte aligned. */
 static const size_t xHeapStructSize	= ( sizeof( BlockLink_t ) + ( ( size_t ) ( portBYTE_ALIGNMENT - 1 ) ) ) & ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
 
-/* Create a couple of list links to mark the start and end of the list. */
-static BlockLink_t xStart, *pxEnd = NULL;
+/* The state of each region passed to vPortDefineHeapRegions(), in the order in
+which they appeared in the array. */
+static HeapRegionState_t xRegions[ configHEAP_MAX_REGIONS ];
+static BaseType_t xDefinedRegions = 0;
 
-/* Keeps track of the number of free bytes remaining, but says nothing about
-fragmentation. */
-static size_t xFreeBytesRemaining = 0U;
-static size_t xMinimumEverFreeBytesRemaining = 0U;
+/* pvPortMalloc() calls that found no general purpose region with a large
+enough free block.  They are not charged to any one region. */
+static uint32_t ulAnyRegionFailures = 0;
 
 /* Gets set to the top bit of an size_t type.  When this bit in the xBlockSize
 member of an BlockLink_t structure is set then the block belongs to the
@@ -131,12 +192,53 @@ static size_t xBlockAllocatedBit = 0;
 
 void *pvPortMalloc( size_t xWantedSize )
 {
-BlockLink_t *pxBlock, *pxPreviousBlock, *pxNewBlockLink;
+	#if( configUSE_HEAP_PROFILER == 1 )
+	{
+		return prvMalloc( heapANY_REGION, xWantedSize, configHEAP_PROFILER_CALL_SITE() );
+	}
+	#else
+	{
+		return prvMalloc( heapANY_REGION, xWantedSize, NULL );
+	}
+	#endif
+}
+/*-----------------------------------------------------------*/
+
+void *pvPortMallocRegion( BaseType_t xRegion, size_t xWantedSize )
+{
+	configASSERT( ( xRegion >= 0 ) && ( xRegion < xDefinedRegions ) );
+
+	if( ( xRegion < 0 ) || ( xRegion >= xDefinedRegions ) )
+	{
+		return NULL;
+	}
+
+	#if( configUSE_HEAP_PROFILER == 1 )
+	{
+		return prvMalloc( xRegion, xWantedSize, configHEAP_PROFILER_CALL_SITE() );
+	}
+	#else
+	{
+		return prvMalloc( xRegion, xWantedSize, NULL );
+	}
+	#endif
+}
+/*-----------------------------------------------------------*/
+
+static void *prvMalloc( BaseType_t xRegion, size_t xWantedSize, void *pvCallSite )
+{
 void *pvReturn = NULL;
+BaseType_t x;
+#if( configUSE_HEAP_PROFILER == 1 )
+	size_t xRequestedSize = xWantedSize;
+	uint32_t ulStartTime = ( uint32_t ) configHEAP_PROFILER_GET_TIMESTAMP();
+#else
+	( void ) pvCallSite;
+#endif
 
 	/* The heap must be initialised before the first call to
 	prvPortMalloc(). */
-	configASSERT( pxEnd );
+	configASSERT( xDefinedRegions > 0 );
 
 	vTaskSuspendAll();
 	{
@@ -169,68 +271,41 @@ void *pvReturn = NULL;
 				mtCOVERAGE_TEST_MARKER();
 			}
 
-			if( ( xWantedSize > 0 ) && ( xWantedSize <= xFreeBytesRemaining ) )
+			if( xWantedSize > 0 )
 			{
-				/* Traverse the list from the start	(lowest address) block until
-				one	of adequate size is found. */
-				pxPreviousBlock = &xStart;
-				pxBlock = xStart.pxNextFreeBlock;
-				while( ( pxBlock->xBlockSize < xWantedSize ) && ( pxBlock->pxNextFreeBlock != NULL ) )
+				if( xRegion == heapANY_REGION )
 				{
-					pxPreviousBlock = pxBlock;
-					pxBlock = pxBlock->pxNextFreeBlock;
-				}
-
-				/* If the end marker was reached then a block of adequate size
-				was	not found. */
-				if( pxBlock != pxEnd )
-				{
-					/* Return the memory space pointed to - jumping over the
-					BlockLink_t structure at its start. */
-					pvReturn = ( void * ) ( ( ( uint8_t * ) pxPreviousBlock->pxNextFreeBlock ) + xHeapStructSize );
-
-					/* This block is being returned for use so must be taken out
-					of the list of free blocks. */
-					pxPreviousBlock->pxNextFreeBlock = pxBlock->pxNextFreeBlock;
-
-					/* If the block is larger than required it can be split into
-					two. */
-					if( ( pxBlock->xBlockSize - xWantedSize ) > heapMINIMUM_BLOCK_SIZE )
+					/* Try the general purpose regions in the order they were
+					defined, which is the lowest address first. */
+					for( x = 0; ( x < xDefinedRegions ) && ( pvReturn == NULL ); x++ )
 					{
-						/* This block is to be split into two.  Create a new
-						block following the number of bytes requested. The void
-						cast is used to prevent byte alignment warnings from the
-						compiler. */
-						pxNewBlockLink = ( void * ) ( ( ( uint8_t * ) pxBlock ) + xWantedSize );
-
-						/* Calculate the sizes of two blocks split from the
-						single block. */
-						pxNewBlockLink->xBlockSize = pxBlock->xBlockSize - xWantedSize;
-						pxBlock->xBlockSize = xWantedSize;
-
-						/* Insert the new block into the list of free blocks. */
-						prvInsertBlockIntoFreeList( ( pxNewBlockLink ) );
+						if( xRegions[ x ].xExplicitOnly == pdFALSE )
+						{
+							pvReturn = prvAllocateFromRegion( &( xRegions[ x ] ), xWantedSize );
+						}
+						else
+						{
+							mtCOVERAGE_TEST_MARKER();
+						}
 					}
-					else
-					{
-						mtCOVERAGE_TEST_MARKER();
-					}
-
-					xFreeBytesRemaining -= pxBlock->xBlockSize;
+				}
+				else
+				{
+					pvReturn = prvAllocateFromRegion( &( xRegions[ xRegion ] ), xWantedSize );
+				}
 
-					if( xFreeBytesRemaining < xMinimumEverFreeBytesRemaining )
+				if( pvReturn == NULL )
+				{
+					/* Charge the failure to the requested region, or count it
+					separately if any region would have done. */
+					if( xRegion == heapANY_REGION )
 					{
-						xMinimumEverFreeBytesRemaining = xFreeBytesRemaining;
+						ulAnyRegionFailures++;
 					}
 					else
 					{
-						mtCOVERAGE_TEST_MARKER();
+						xRegions[ xRegion ].ulFailures++;
 					}
-
-					/* The block is being returned - it is allocated and owned
-					by the application and has no "next" block. */
-					pxBlock->xBlockSize |= xBlockAllocatedBit;
-					pxBlock->pxNextFreeBlock = NULL;
 				}
 				else
 				{
@@ -248,6 +323,12 @@ void *pvReturn = NULL;
 		}
 
 		traceMALLOC( pvReturn, xWantedSize );
+
+		#if( configUSE_HEAP_PROFILER == 1 )
+		{
+			vPortHeapProfilerRecordMalloc( pvReturn, xRequestedSize, pvCallSite, ( uint32_t ) configHEAP_PROFILER_GET_TIMESTAMP() - ulStartTime );
+		}
+		#endif
 	}
 	( void ) xTaskResumeAll();
 
@@ -269,10 +350,94 @@ void *pvReturn = NULL;
 }
 /*-----------------------------------------------------------*/
 
+static void *prvAllocateFromRegion( HeapRegionState_t *pxRegion, size_t xWantedSize )
+{
+BlockLink_t *pxBlock, *pxPreviousBlock, *pxNewBlockLink;
+void *pvReturn = NULL;
+
+	if( xWantedSize <= pxRegion->xFreeBytesRemaining )
+	{
+		/* Traverse the list from the start	(lowest address) block until
+		one	of adequate size is found. */
+		pxPreviousBlock = &( pxRegion->xStart );
+		pxBlock = pxRegion->xStart.pxNextFreeBlock;
+		while( ( pxBlock->xBlockSize < xWantedSize ) && ( pxBlock->pxNextFreeBlock != NULL ) )
+		{
+			pxPreviousBlock = pxBlock;
+			pxBlock = pxBlock->pxNextFreeBlock;
+		}
+
+		/* If the end marker was reached then a block of adequate size
+		was	not found. */
+		if( pxBlock != pxRegion->pxEnd )
+		{
+			/* Return the memory space pointed to - jumping over the
+			BlockLink_t structure at its start. */
+			pvReturn = ( void * ) ( ( ( uint8_t * ) pxPreviousBlock->pxNextFreeBlock ) + xHeapStructSize );
+
+			/* This block is being returned for use so must be taken out
+			of the list of free blocks. */
+			pxPreviousBlock->pxNextFreeBlock = pxBlock->pxNextFreeBlock;
+
+			/* If the block is larger than required it can be split into
+			two. */
+			if( ( pxBlock->xBlockSize - xWantedSize ) > heapMINIMUM_BLOCK_SIZE )
+			{
+				/* This block is to be split into two.  Create a new
+				block following the number of bytes requested. The void
+				cast is used to prevent byte alignment warnings from the
+				compiler. */
+				pxNewBlockLink = ( void * ) ( ( ( uint8_t * ) pxBlock ) + xWantedSize );
+
+				/* Calculate the sizes of two blocks split from the
+				single block. */
+				pxNewBlockLink->xBlockSize = pxBlock->xBlockSize - xWantedSize;
+				pxBlock->xBlockSize = xWantedSize;
+
+				/* Insert the new block into the list of free blocks. */
+				prvInsertBlockIntoFreeList( pxRegion, pxNewBlockLink );
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+
+			pxRegion->xFreeBytesRemaining -= pxBlock->xBlockSize;
+			pxRegion->ulAllocations++;
+
+			if( pxRegion->xFreeBytesRemaining < pxRegion->xMinimumEverFreeBytesRemaining )
+			{
+				pxRegion->xMinimumEverFreeBytesRemaining = pxRegion->xFreeBytesRemaining;
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+
+			/* The block is being returned - it is allocated and owned
+			by the application and has no "next" block. */
+			pxBlock->xBlockSize |= xBlockAllocatedBit;
+			pxBlock->pxNextFreeBlock = NULL;
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	return pvReturn;
+}
+/*-----------------------------------------------------------*/
+
 void vPortFree( void *pv )
 {
 uint8_t *puc = ( uint8_t * ) pv;
 BlockLink_t *pxLink;
+HeapRegionState_t *pxRegion;
 
 	if( pv != NULL )
 	{
@@ -283,11 +448,13 @@ BlockLink_t *pxLink;
 		/* This casting is to keep the compiler from issuing warnings. */
 		pxLink = ( void * ) puc;
 
-		/* Check the block is actually allocated. */
+		/* Check the block is actually allocated, and from this heap. */
+		pxRegion = prvRegionContaining( pxLink );
+		configASSERT( pxRegion != NULL );
 		configASSERT( ( pxLink->xBlockSize & xBlockAllocatedBit ) != 0 );
 		configASSERT( pxLink->pxNextFreeBlock == NULL );
 
-		if( ( pxLink->xBlockSize & xBlockAllocatedBit ) != 0 )
+		if( ( pxRegion != NULL ) && ( ( pxLink->xBlockSize & xBlockAllocatedBit ) != 0 ) )
 		{
 			if( pxLink->pxNextFreeBlock == NULL )
 			{
@@ -298,9 +465,17 @@ BlockLink_t *pxLink;
 				vTaskSuspendAll();
 				{
 					/* Add this block to the list of free blocks. */
-					xFreeBytesRemaining += pxLink->xBlockSize;
+					pxRegion->xFreeBytesRemaining += pxLink->xBlockSize;
+					pxRegion->ulFrees++;
 					traceFREE( pv, pxLink->xBlockSize );
-					prvInsertBlockIntoFreeList( ( ( BlockLink_t * ) pxLink ) );
+
+					#if( configUSE_HEAP_PROFILER == 1 )
+					{
+						vPortHeapProfilerRecordFree( pv );
+					}
+					#endif
+
+					prvInsertBlockIntoFreeList( pxRegion, ( ( BlockLink_t * ) pxLink ) );
 				}
 				( void ) xTaskResumeAll();
 			}
@@ -317,26 +492,116 @@ BlockLink_t *pxLink;
 }
 /*-----------------------------------------------------------*/
 
+static HeapRegionState_t *prvRegionContaining( const void *pv )
+{
+BaseType_t x;
+
+	/* A region runs from its first block, which xStart pointed to when the
+	region was defined, up to its end marker. */
+	for( x = 0; x < xDefinedRegions; x++ )
+	{
+		if( ( ( const uint8_t * ) pv >= ( const uint8_t * ) xRegions[ x ].pxEnd - xRegions[ x ].xTotalBytes ) &&
+			( ( const uint8_t * ) pv < ( const uint8_t * ) xRegions[ x ].pxEnd ) )
+		{
+			return &( xRegions[ x ] );
+		}
+	}
+
+	return NULL;
+}
+/*-----------------------------------------------------------*/
+
 size_t xPortGetFreeHeapSize( void )
 {
-	return xFreeBytesRemaining;
+size_t xTotal = 0;
+BaseType_t x;
+
+	/* Only the regions pvPortMalloc() can use are counted. */
+	for( x = 0; x < xDefinedRegions; x++ )
+	{
+		if( xRegions[ x ].xExplicitOnly == pdFALSE )
+		{
+			xTotal += xRegions[ x ].xFreeBytesRemaining;
+		}
+	}
+
+	return xTotal;
 }
 /*-----------------------------------------------------------*/
 
 size_t xPortGetMinimumEverFreeHeapSize( void )
 {
-	return xMinimumEverFreeBytesRemaining;
+size_t xTotal = 0;
+BaseType_t x;
+
+	/* The sum of the per region minimums, so a lower bound on the true
+	minimum of the sum. */
+	for( x = 0; x < xDefinedRegions; x++ )
+	{
+		if( xRegions[ x ].xExplicitOnly == pdFALSE )
+		{
+			xTotal += xRegions[ x ].xMinimumEverFreeBytesRemaining;
+		}
+	}
+
+	return xTotal;
+}
+/*-----------------------------------------------------------*/
+
+uint32_t ulPortGetHeapMallocFailures( void )
+{
+	return ulAnyRegionFailures;
 }
 /*-----------------------------------------------------------*/
 
-static void prvInsertBlockIntoFreeList( BlockLink_t *pxBlockToInsert )
+BaseType_t xPortGetHeapRegionStats( BaseType_t xRegion, HeapRegionStats_t *pxStats )
+{
+HeapRegionState_t *pxRegion;
+BlockLink_t *pxBlock;
+
+	if( ( xRegion < 0 ) || ( xRegion >= xDefinedRegions ) )
+	{
+		return pdFAIL;
+	}
+
+	pxRegion = &( xRegions[ xRegion ] );
+
+	vTaskSuspendAll();
+	{
+		pxStats->xTotalBytes = pxRegion->xTotalBytes;
+		pxStats->xFreeBytesRemaining = pxRegion->xFreeBytesRemaining;
+		pxStats->xMinimumEverFreeBytesRemaining = pxRegion->xMinimumEverFreeBytesRemaining;
+		pxStats->ulAllocations = pxRegion->ulAllocations;
+		pxStats->ulFrees = pxRegion->ulFrees;
+		pxStats->ulFailures = pxRegion->ulFailures;
+		pxStats->xLargestFreeBlock = 0;
+		pxStats->uxFreeBlocks = 0;
+
+		/* Walk the free list to measure fragmentation. */
+		for( pxBlock = pxRegion->xStart.pxNextFreeBlock; pxBlock != pxRegion->pxEnd; pxBlock = pxBlock->pxNextFreeBlock )
+		{
+			pxStats->uxFreeBlocks++;
+
+			if( pxBlock->xBlockSize > pxStats->xLargestFreeBlock )
+			{
+				pxStats->xLargestFreeBlock = pxBlock->xBlockSize;
+			}
+		}
+	}
+	( void ) xTaskResumeAll();
+
+	return pdPASS;
+}
+/*-----------------------------------------------------------*/
+
+static void prvInsertBlockIntoFreeList( HeapRegionState_t *pxRegion, BlockLink_t *pxBlockToInsert )
 {
 BlockLink_t *pxIterator;
 uint8_t *puc;
 
 	/* Iterate through the list until a block is found that has a higher address
 	than the block being inserted. */
-	for( pxIterator = &xStart; pxIterator->pxNextFreeBlock < pxBlockToInsert; pxIterator = pxIterator->pxNextFreeBlock )
+	for( pxIterator = &( pxRegion->xStart ); pxIterator->pxNextFreeBlock < pxBlockToInsert; pxIterator = pxIterator->pxNextFreeBlock )
 	{
 		/* Nothing to do here, just iterate to the right position. */
 	}
@@ -359,7 +624,7 @@ uint8_t *puc;
 	puc = ( uint8_t * ) pxBlockToInsert;
 	if( ( puc + pxBlockToInsert->xBlockSize ) == ( uint8_t * ) pxIterator->pxNextFreeBlock )
 	{
-		if( pxIterator->pxNextFreeBlock != pxEnd )
+		if( pxIterator->pxNextFreeBlock != pxRegion->pxEnd )
 		{
 			/* Form one big block from the two blocks. */
 			pxBlockToInsert->xBlockSize += pxIterator->pxNextFreeBlock->xBlockSize;
@@ -367,7 +632,7 @@ uint8_t *puc;
 		}
 		else
 		{
-			pxBlockToInsert->pxNextFreeBlock = pxEnd;
+			pxBlockToInsert->pxNextFreeBlock = pxRegion->pxEnd;
 		}
 	}
 	else
@@ -392,20 +657,24 @@ uint8_t *puc;
 
 void vPortDefineHeapRegions( const HeapRegion_t * const pxHeapRegions )
 {
-BlockLink_t *pxFirstFreeBlockInRegion = NULL, *pxPreviousFreeBlock;
+BlockLink_t *pxFirstFreeBlockInRegion;
+HeapRegionState_t *pxRegion;
 size_t xAlignedHeap;
 size_t xTotalRegionSize, xTotalHeapSize = 0;
-BaseType_t xDefinedRegions = 0;
 size_t xAddress;
 const HeapRegion_t *pxHeapRegion;
 
 	/* Can only call once! */
-	configASSERT( pxEnd == NULL );
+	configASSERT( xDefinedRegions == 0 );
 
 	pxHeapRegion = &( pxHeapRegions[ xDefinedRegions ] );
 
 	while( pxHeapRegion->xSizeInBytes > 0 )
 	{
+		/* Each region needs its own state. */
+		configASSERT( xDefinedRegions < configHEAP_MAX_REGIONS );
+		pxRegion = &( xRegions[ xDefinedRegions ] );
+
 		xTotalRegionSize = pxHeapRegion->xSizeInBytes;
 
 		/* Ensure the heap region starts on a correctly aligned boundary. */
@@ -421,50 +690,31 @@ const HeapRegion_t *pxHeapRegion;
 
 		xAlignedHeap = xAddress;
 
-		/* Set xStart if it has not already been set. */
-		if( xDefinedRegions == 0 )
-		{
-			/* xStart is used to hold a pointer to the first item in the list of
-			free blocks.  The void cast is used to prevent compiler warnings. */
-			xStart.pxNextFreeBlock = ( BlockLink_t * ) xAlignedHeap;
-			xStart.xBlockSize = ( size_t ) 0;
-		}
-		else
-		{
-			/* Should only get here if one region has already been added to the
-			heap. */
-			configASSERT( pxEnd != NULL );
-
-			/* Check blocks are passed in with increasing start addresses. */
-			configASSERT( xAddress > ( size_t ) pxEnd );
-		}
-
-		/* Remember the location of the end marker in the previous region, if
-		any. */
-		pxPreviousFreeBlock = pxEnd;
+		/* xStart is used to hold a pointer to the first item in the list of
+		free blocks.  The void cast is used to prevent compiler warnings. */
+		pxRegion->xStart.pxNextFreeBlock = ( BlockLink_t * ) xAlignedHeap;
+		pxRegion->xStart.xBlockSize = ( size_t ) 0;
 
 		/* pxEnd is used to mark the end of the list of free blocks and is
 		inserted at the end of the region space. */
 		xAddress = xAlignedHeap + xTotalRegionSize;
 		xAddress -= xHeapStructSize;
 		xAddress &= ~portBYTE_ALIGNMENT_MASK;
-		pxEnd = ( BlockLink_t * ) xAddress;
-		pxEnd->xBlockSize = 0;
-		pxEnd->pxNextFreeBlock = NULL;
+		pxRegion->pxEnd = ( BlockLink_t * ) xAddress;
+		pxRegion->pxEnd->xBlockSize = 0;
+		pxRegion->pxEnd->pxNextFreeBlock = NULL;
 
 		/* To start with there is a single free block in this region that is
 		sized to take up the entire heap region minus the space taken by the
 		free block structure. */
 		pxFirstFreeBlockInRegion = ( BlockLink_t * ) xAlignedHeap;
 		pxFirstFreeBlockInRegion->xBlockSize = xAddress - ( size_t ) pxFirstFreeBlockInRegion;
-		pxFirstFreeBlockInRegion->pxNextFreeBlock = pxEnd;
+		pxFirstFreeBlockInRegion->pxNextFreeBlock = pxRegion->pxEnd;
 
-		/* If this is not the first region that makes up the entire heap space
-		then link the previous region to this region. */
-		if( pxPreviousFreeBlock != NULL )
-		{
-			pxPreviousFreeBlock->pxNextFreeBlock = pxFirstFreeBlockInRegion;
-		}
+		pxRegion->xTotalBytes = pxFirstFreeBlockInRegion->xBlockSize;
+		pxRegion->xFreeBytesRemaining = pxRegion->xTotalBytes;
+		pxRegion->xMinimumEverFreeBytesRemaining = pxRegion->xTotalBytes;
+		pxRegion->xExplicitOnly = pxHeapRegion->xExplicitOnly;
 
 		xTotalHeapSize += pxFirstFreeBlockInRegion->xBlockSize;
 
@@ -473,9 +723,6 @@ const HeapRegion_t *pxHeapRegion;
 		pxHeapRegion = &( pxHeapRegions[ xDefinedRegions ] );
 	}
 
-	xMinimumEverFreeBytesRemaining = xTotalHeapSize;
-	xFreeBytesRemaining = xTotalHeapSize;
-
 	/* Check something was actually defined before it is accessed. */
 	configASSERT( xTotalHeapSize );
 
@@ -0,0 +1,429 @@
+/*
+ * FreeRTOS Kernel V10.2.0
+ * Copyright (C) 2019 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/*
+ * Allocation profiler used by heap_4.c and heap_5.c when configUSE_HEAP_PROFILER
+ * is set to 1.  See heap_profiler.h for a description of the API.
+ *
+ * Live blocks and call sites are both held in open addressed hash tables so
+ * the cost added to pvPortMalloc() and vPortFree() does not grow with the
+ * number of blocks allocated.  Live blocks are removed with backward shift
+ * deletion so no tombstones are needed.
+ */
+#include <stdio.h>
+#include <string.h>
+
+/* Defining MPU_WRAPPERS_INCLUDED_FROM_API_FILE prevents task.h from redefining
+all the API functions to use the MPU wrappers.  That should only be done when
+task.h is included from an application file. */
+#define MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "heap_profiler.h"
+
+#undef MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#if( configUSE_HEAP_PROFILER == 1 )
+
+#if( ( configHEAP_PROFILER_MAX_SITES & ( configHEAP_PROFILER_MAX_SITES - 1 ) ) != 0 )
+	#error configHEAP_PROFILER_MAX_SITES must be a power of two
+#endif
+
+#if( configHEAP_PROFILER_MAX_SITES > 256 )
+	#error configHEAP_PROFILER_MAX_SITES must not exceed 256
+#endif
+
+#if( ( configHEAP_PROFILER_MAX_LIVE_BLOCKS & ( configHEAP_PROFILER_MAX_LIVE_BLOCKS - 1 ) ) != 0 )
+	#error configHEAP_PROFILER_MAX_LIVE_BLOCKS must be a power of two
+#endif
+
+#if( ( INCLUDE_xTaskGetCurrentTaskHandle != 1 ) && ( configUSE_MUTEXES != 1 ) )
+	#error The heap profiler requires xTaskGetCurrentTaskHandle(), set INCLUDE_xTaskGetCurrentTaskHandle to 1
+#endif
+
+#define heapprofSITE_MASK		( ( UBaseType_t ) configHEAP_PROFILER_MAX_SITES - 1U )
+#define heapprofBLOCK_MASK		( ( UBaseType_t ) configHEAP_PROFILER_MAX_LIVE_BLOCKS - 1U )
+
+/* Fibonacci hashing multiplier, spreads the low bits of aligned addresses. */
+#define heapprofHASH_MULTIPLIER	( 0x9E3779B1UL )
+
+/* One tracked live block. */
+typedef struct xHEAP_PROFILER_BLOCK
+{
+	void *pvAddress;				/* NULL when the slot is empty. */
+	size_t xSize;					/* Size requested by the caller. */
+	uint8_t ucSite;					/* Index into xSites[]. */
+	uint8_t ucSizeClass;			/* floor( log2( xSize ) ). */
+	char cOwner[ configMAX_TASK_NAME_LEN ];	/* Task running when the block was allocated. */
+} HeapProfilerBlock_t;
+
+/*-----------------------------------------------------------*/
+
+static HeapProfilerSite_t xSites[ configHEAP_PROFILER_MAX_SITES ];
+static HeapProfilerBlock_t xBlocks[ configHEAP_PROFILER_MAX_LIVE_BLOCKS ];
+static HeapProfilerStats_t xStats;
+
+/*-----------------------------------------------------------*/
+
+static UBaseType_t prvHash( const void *pv )
+{
+uint32_t ulKey = ( uint32_t ) ( size_t ) pv;
+
+	/* Blocks and call sites are at least 4 byte aligned so the bottom bits
+	carry no information. */
+	return ( UBaseType_t ) ( ( ( ulKey >> 2 ) * heapprofHASH_MULTIPLIER ) >> 16 );
+}
+/*-----------------------------------------------------------*/
+
+static uint8_t prvLog2( uint32_t ulValue )
+{
+uint8_t ucBits = 0;
+
+	while( ( ulValue > 1UL ) && ( ucBits < ( heapprofNUM_SIZE_CLASSES - 1 ) ) )
+	{
+		ulValue >>= 1;
+		ucBits++;
+	}
+
+	return ucBits;
+}
+/*-----------------------------------------------------------*/
+
+static HeapProfilerSite_t *prvFindOrAddSite( void *pvCallSite )
+{
+UBaseType_t uxIndex, uxProbes;
+HeapProfilerSite_t *pxSite;
+
+	uxIndex = prvHash( pvCallSite ) & heapprofSITE_MASK;
+
+	for( uxProbes = 0; uxProbes < ( UBaseType_t ) configHEAP_PROFILER_MAX_SITES; uxProbes++ )
+	{
+		pxSite = &( xSites[ uxIndex ] );
+
+		if( pxSite->pvCallSite == pvCallSite )
+		{
+			return pxSite;
+		}
+		else if( pxSite->pvCallSite == NULL )
+		{
+			pxSite->pvCallSite = pvCallSite;
+			xStats.ulSitesInUse++;
+			return pxSite;
+		}
+		else
+		{
+			uxIndex = ( uxIndex + 1U ) & heapprofSITE_MASK;
+		}
+	}
+
+	/* The site table is full. */
+	return NULL;
+}
+/*-----------------------------------------------------------*/
+
+static void prvCopyOwnerName( char *pcDestination )
+{
+TaskHandle_t xOwner = xTaskGetCurrentTaskHandle();
+const char *pcName;
+UBaseType_t x;
+
+	/* Allocations made before any task exists, when creating the first
+	objects, are attributed to "init". */
+	pcName = ( xOwner != NULL ) ? pcTaskGetName( xOwner ) : "init";
+
+	for( x = 0; x < ( UBaseType_t ) configMAX_TASK_NAME_LEN; x++ )
+	{
+		pcDestination[ x ] = ( pcName[ x ] == ' ' ) ? '_' : pcName[ x ];
+
+		if( pcName[ x ] == 0x00 )
+		{
+			break;
+		}
+	}
+
+	pcDestination[ configMAX_TASK_NAME_LEN - 1 ] = 0x00;
+}
+/*-----------------------------------------------------------*/
+
+void vPortHeapProfilerRecordMalloc( void *pvAddress, size_t xRequestedSize, void *pvCallSite, uint32_t ulLatency )
+{
+HeapProfilerSite_t *pxSite;
+HeapProfilerBlock_t *pxBlock;
+UBaseType_t uxIndex, uxProbes;
+
+	xStats.ulLatencyHistogram[ prvLog2( ulLatency ) ]++;
+
+	if( pvAddress == NULL )
+	{
+		/* Counted even when the call site cannot be tracked. */
+		xStats.ulFailures++;
+	}
+
+	pxSite = prvFindOrAddSite( pvCallSite );
+
+	if( pxSite == NULL )
+	{
+		if( pvAddress != NULL )
+		{
+			xStats.ulUntrackedAllocations++;
+		}
+
+		return;
+	}
+
+	if( pvAddress == NULL )
+	{
+		pxSite->ulFailures++;
+		return;
+	}
+
+	/* Find a free slot for the new block. */
+	uxIndex = prvHash( pvAddress ) & heapprofBLOCK_MASK;
+	pxBlock = NULL;
+
+	for( uxProbes = 0; uxProbes < ( UBaseType_t ) configHEAP_PROFILER_MAX_LIVE_BLOCKS; uxProbes++ )
+	{
+		if( xBlocks[ uxIndex ].pvAddress == NULL )
+		{
+			pxBlock = &( xBlocks[ uxIndex ] );
+			break;
+		}
+
+		uxIndex = ( uxIndex + 1U ) & heapprofBLOCK_MASK;
+	}
+
+	if( pxBlock == NULL )
+	{
+		xStats.ulUntrackedAllocations++;
+		return;
+	}
+
+	pxBlock->pvAddress = pvAddress;
+	pxBlock->xSize = xRequestedSize;
+	pxBlock->ucSite = ( uint8_t ) ( pxSite - xSites );
+	pxBlock->ucSizeClass = prvLog2( ( uint32_t ) xRequestedSize );
+	prvCopyOwnerName( pxBlock->cOwner );
+
+	xStats.ulLiveBlocks++;
+	xStats.ulSizeClassLiveBlocks[ pxBlock->ucSizeClass ]++;
+
+	pxSite->ulAllocations++;
+	pxSite->ulLiveBlocks++;
+	pxSite->xLiveBytes += xRequestedSize;
+
+	if( pxSite->xLiveBytes > pxSite->xPeakLiveBytes )
+	{
+		pxSite->xPeakLiveBytes = pxSite->xLiveBytes;
+	}
+}
+/*-----------------------------------------------------------*/
+
+void vPortHeapProfilerRecordFree( void *pvAddress )
+{
+UBaseType_t uxIndex, uxNext, uxHome, uxProbes;
+HeapProfilerSite_t *pxSite;
+HeapProfilerBlock_t *pxBlock = NULL;
+
+	uxIndex = prvHash( pvAddress ) & heapprofBLOCK_MASK;
+
+	for( uxProbes = 0; uxProbes < ( UBaseType_t ) configHEAP_PROFILER_MAX_LIVE_BLOCKS; uxProbes++ )
+	{
+		if( xBlocks[ uxIndex ].pvAddress == pvAddress )
+		{
+			pxBlock = &( xBlocks[ uxIndex ] );
+			break;
+		}
+		else if( xBlocks[ uxIndex ].pvAddress == NULL )
+		{
+			break;
+		}
+
+		uxIndex = ( uxIndex + 1U ) & heapprofBLOCK_MASK;
+	}
+
+	if( pxBlock == NULL )
+	{
+		/* The block was allocated while a table was full. */
+		return;
+	}
+
+	pxSite = &( xSites[ pxBlock->ucSite ] );
+	pxSite->ulFrees++;
+	pxSite->ulLiveBlocks--;
+	pxSite->xLiveBytes -= pxBlock->xSize;
+
+	xStats.ulLiveBlocks--;
+	xStats.ulSizeClassLiveBlocks[ pxBlock->ucSizeClass ]--;
+
+	/* Remove the entry, shifting back any following entries that would
+	otherwise become unreachable from their home slot. */
+	pxBlock->pvAddress = NULL;
+	uxNext = ( uxIndex + 1U ) & heapprofBLOCK_MASK;
+
+	while( xBlocks[ uxNext ].pvAddress != NULL )
+	{
+		uxHome = prvHash( xBlocks[ uxNext ].pvAddress ) & heapprofBLOCK_MASK;
+
+		/* Can the entry at uxNext be moved into the hole at uxIndex?  It can
+		unless its home slot lies cyclically in ( uxIndex, uxNext ]. */
+		if( ( ( uxNext - uxHome ) & heapprofBLOCK_MASK ) >= ( ( uxNext - uxIndex ) & heapprofBLOCK_MASK ) )
+		{
+			xBlocks[ uxIndex ] = xBlocks[ uxNext ];
+			xBlocks[ uxNext ].pvAddress = NULL;
+			uxIndex = uxNext;
+		}
+
+		uxNext = ( uxNext + 1U ) & heapprofBLOCK_MASK;
+	}
+}
+/*-----------------------------------------------------------*/
+
+void vPortHeapProfilerGetStats( HeapProfilerStats_t *pxStats )
+{
+	vTaskSuspendAll();
+	{
+		*pxStats = xStats;
+	}
+	( void ) xTaskResumeAll();
+}
+/*-----------------------------------------------------------*/
+
+UBaseType_t uxPortHeapProfilerGetSites( HeapProfilerSite_t *pxSites, UBaseType_t uxMaxSites )
+{
+UBaseType_t x, uxCopied = 0;
+
+	vTaskSuspendAll();
+	{
+		for( x = 0; ( x < ( UBaseType_t ) configHEAP_PROFILER_MAX_SITES ) && ( uxCopied < uxMaxSites ); x++ )
+		{
+			if( xSites[ x ].pvCallSite != NULL )
+			{
+				pxSites[ uxCopied ] = xSites[ x ];
+				uxCopied++;
+			}
+		}
+	}
+	( void ) xTaskResumeAll();
+
+	return uxCopied;
+}
+/*-----------------------------------------------------------*/
+
+void vPortHeapProfilerDump( void ( *pvWriteLine )( const char *pcLine ) )
+{
+char cLine[ configHEAP_PROFILER_LINE_LENGTH ];
+HeapProfilerSite_t xSite;
+HeapProfilerBlock_t xBlock;
+HeapProfilerStats_t xStatsCopy;
+void *pvCallSite;
+UBaseType_t x;
+
+	/* pvWriteLine() may block, so it is not called with the scheduler
+	suspended.  Each entry is copied with the scheduler suspended and then
+	formatted and written with the scheduler running. */
+	for( x = 0; x < ( UBaseType_t ) configHEAP_PROFILER_MAX_SITES; x++ )
+	{
+		vTaskSuspendAll();
+		{
+			xSite = xSites[ x ];
+		}
+		( void ) xTaskResumeAll();
+
+		if( xSite.pvCallSite != NULL )
+		{
+			snprintf( cLine, sizeof( cLine ), "site %p %u %u %u %u %u %u", xSite.pvCallSite,
+					  ( unsigned ) xSite.xLiveBytes, ( unsigned ) xSite.xPeakLiveBytes,
+					  ( unsigned ) xSite.ulLiveBlocks, ( unsigned ) xSite.ulAllocations,
+					  ( unsigned ) xSite.ulFrees, ( unsigned ) xSite.ulFailures );
+			pvWriteLine( cLine );
+		}
+	}
+
+	for( x = 0; x < ( UBaseType_t ) configHEAP_PROFILER_MAX_LIVE_BLOCKS; x++ )
+	{
+		vTaskSuspendAll();
+		{
+			xBlock = xBlocks[ x ];
+			pvCallSite = xSites[ xBlock.ucSite ].pvCallSite;
+		}
+		( void ) xTaskResumeAll();
+
+		if( xBlock.pvAddress != NULL )
+		{
+			snprintf( cLine, sizeof( cLine ), "block %p %u %p %s", xBlock.pvAddress,
+					  ( unsigned ) xBlock.xSize, pvCallSite, xBlock.cOwner );
+			pvWriteLine( cLine );
+
+			snprintf( cLine, sizeof( cLine ), "stack %s;%p %u", xBlock.cOwner,
+					  pvCallSite, ( unsigned ) xBlock.xSize );
+			pvWriteLine( cLine );
+		}
+	}
+
+	vPortHeapProfilerGetStats( &xStatsCopy );
+
+	for( x = 0; x < ( UBaseType_t ) heapprofNUM_LATENCY_BUCKETS; x++ )
+	{
+		snprintf( cLine, sizeof( cLine ), "latency %u %u", ( unsigned ) x, ( unsigned ) xStatsCopy.ulLatencyHistogram[ x ] );
+		pvWriteLine( cLine );
+	}
+
+	for( x = 0; x < ( UBaseType_t ) heapprofNUM_SIZE_CLASSES; x++ )
+	{
+		snprintf( cLine, sizeof( cLine ), "class %u %u", ( unsigned ) x, ( unsigned ) xStatsCopy.ulSizeClassLiveBlocks[ x ] );
+		pvWriteLine( cLine );
+	}
+
+	snprintf( cLine, sizeof( cLine ), "totals %u %u %u", ( unsigned ) xStatsCopy.ulLiveBlocks,
+			  ( unsigned ) xStatsCopy.ulUntrackedAllocations, ( unsigned ) xStatsCopy.ulFailures );
+	pvWriteLine( cLine );
+}
+/*-----------------------------------------------------------*/
+
+void vPortHeapProfilerReset( void )
+{
+UBaseType_t x;
+
+	vTaskSuspendAll();
+	{
+		for( x = 0; x < ( UBaseType_t ) configHEAP_PROFILER_MAX_SITES; x++ )
+		{
+			xSites[ x ].ulAllocations = 0;
+			xSites[ x ].ulFrees = 0;
+			xSites[ x ].ulFailures = 0;
+			xSites[ x ].xPeakLiveBytes = xSites[ x ].xLiveBytes;
+		}
+
+		memset( xStats.ulLatencyHistogram, 0x00, sizeof( xStats.ulLatencyHistogram ) );
+		xStats.ulUntrackedAllocations = 0;
+		xStats.ulFailures = 0;
+	}
+	( void ) xTaskResumeAll();
+}
+
+#endif /* configUSE_HEAP_PROFILER */
@@ -128,6 +128,10 @@ typedef struct QueueDefinition 		/* The old naming convention is used to prevent
 		uint8_t ucQueueType;
 	#endif
 
+	#if ( configUSE_QUEUE_STATS == 1 )
+		QueueStats_t xStats;		/*< Contention statistics, see vQueueGetStats(). */
+	#endif
+
 } xQUEUE;
 
 /* The old xQUEUE name is maintained above then typedefed to the new Queue_t
@@ -231,6 +235,61 @@ static void prvInitialiseNewQueue( const UBaseType_t uxQueueLength, const UBaseT
 	 */
 	static UBaseType_t prvGetDisinheritPriorityAfterTimeout( const Queue_t * const pxQueue ) PRIVILEGED_FUNCTION;
 #endif
+
+#if( configUSE_QUEUE_STATS == 1 )
+	/*
+	 * Adds the time since pxTimeOut was set to the queue's wait statistics.
+	 * Called as a call that had to wait returns.
+	 */
+	static void prvRecordWaitTime( Queue_t * const pxQueue, const TimeOut_t * const pxTimeOut ) PRIVILEGED_FUNCTION;
+#endif
+/*-----------------------------------------------------------*/
+
+/*
+ * Macros that update the contention statistics of a queue.  All but
+ * prvStatsEndWait() must be called from within a critical section (or with
+ * interrupts masked in the FromISR functions).
+ */
+#if( configUSE_QUEUE_STATS == 1 )
+
+	#define prvStatsCountSend( pxQueue )											\
+	{																				\
+		( pxQueue )->xStats.ulSends++;												\
+		if( ( pxQueue )->uxMessagesWaiting > ( pxQueue )->xStats.uxHighWaterMark )	\
+		{																			\
+			( pxQueue )->xStats.uxHighWaterMark = ( pxQueue )->uxMessagesWaiting;	\
+		}																			\
+	}
+
+	#define prvStatsCountReceive( pxQueue ) ( ( pxQueue )->xStats.ulReceives++ )
+
+	#define prvStatsCountWait( pxQueue, ulCounter ) ( ( pxQueue )->xStats.ulCounter++ )
+
+	#define prvStatsCountInheritance( pxQueue, xInherited )	\
+	{														\
+		if( ( xInherited ) != pdFALSE )						\
+		{													\
+			( pxQueue )->xStats.ulPriorityInheritances++;	\
+		}													\
+	}
+
+	#define prvStatsEndWait( pxQueue, xEntryTimeSet, xTimeOut )	\
+	{															\
+		if( ( xEntryTimeSet ) != pdFALSE )						\
+		{														\
+			prvRecordWaitTime( ( pxQueue ), &( xTimeOut ) );	\
+		}														\
+	}
+
+#else
+
+	#define prvStatsCountSend( pxQueue )
+	#define prvStatsCountReceive( pxQueue )
+	#define prvStatsCountWait( pxQueue, ulCounter )
+	#define prvStatsCountInheritance( pxQueue, xInherited )
+	#define prvStatsEndWait( pxQueue, xEntryTimeSet, xTimeOut )
+
+#endif /* configUSE_QUEUE_STATS */
 /*-----------------------------------------------------------*/
 
 /*
@@ -464,6 +523,12 @@ static void prvInitialiseNewQueue( const UBaseType_t uxQueueLength, const UBaseT
 	}
 	#endif /* configUSE_QUEUE_SETS */
 
+	#if( configUSE_QUEUE_STATS == 1 )
+	{
+		( void ) memset( ( void * ) &( pxNewQueue->xStats ), 0x00, sizeof( pxNewQueue->xStats ) );
+	}
+	#endif /* configUSE_QUEUE_STATS */
+
 	traceQUEUE_CREATE( pxNewQueue );
 }
 /*-----------------------------------------------------------*/
@@ -871,6 +936,7 @@ Queue_t * const pxQueue = xQueue;
 				}
 				#endif /* configUSE_QUEUE_SETS */
 
+				prvStatsEndWait( pxQueue, xEntryTimeSet, xTimeOut );
 				taskEXIT_CRITICAL();
 				return pdPASS;
 			}
@@ -893,6 +959,7 @@ Queue_t * const pxQueue = xQueue;
 					configure the timeout structure. */
 					vTaskInternalSetTimeOutState( &xTimeOut );
 					xEntryTimeSet = pdTRUE;
+					prvStatsCountWait( pxQueue, ulSendWaits );
 				}
 				else
 				{
@@ -947,6 +1014,7 @@ Queue_t * const pxQueue = xQueue;
 			prvUnlockQueue( pxQueue );
 			( void ) xTaskResumeAll();
 
+			prvStatsEndWait( pxQueue, xEntryTimeSet, xTimeOut );
 			traceQUEUE_SEND_FAILED( pxQueue );
 			return errQUEUE_FULL;
 		}
@@ -1164,6 +1232,7 @@ Queue_t * const pxQueue = xQueue;
 			priority disinheritance is needed.  Simply increase the count of
 			messages (semaphores) available. */
 			pxQueue->uxMessagesWaiting = uxMessagesWaiting + ( UBaseType_t ) 1;
+			prvStatsCountSend( pxQueue );
 
 			/* The event list is not altered if the queue is locked.  This will
 			be done when the queue is unlocked later. */
@@ -1308,6 +1377,7 @@ Queue_t * const pxQueue = xQueue;
 				prvCopyDataFromQueue( pxQueue, pvBuffer );
 				traceQUEUE_RECEIVE( pxQueue );
 				pxQueue->uxMessagesWaiting = uxMessagesWaiting - ( UBaseType_t ) 1;
+				prvStatsCountReceive( pxQueue );
 
 				/* There is now space in the queue, were any tasks waiting to
 				post to the queue?  If so, unblock the highest priority waiting
@@ -1328,6 +1398,7 @@ Queue_t * const pxQueue = xQueue;
 					mtCOVERAGE_TEST_MARKER();
 				}
 
+				prvStatsEndWait( pxQueue, xEntryTimeSet, xTimeOut );
 				taskEXIT_CRITICAL();
 				return pdPASS;
 			}
@@ -1338,6 +1409,7 @@ Queue_t * const pxQueue = xQueue;
 					/* The queue was empty and no block time is specified (or
 					the block time has expired) so leave now. */
 					taskEXIT_CRITICAL();
+					prvStatsEndWait( pxQueue, xEntryTimeSet, xTimeOut );
 					traceQUEUE_RECEIVE_FAILED( pxQueue );
 					return errQUEUE_EMPTY;
 				}
@@ -1347,6 +1419,7 @@ Queue_t * const pxQueue = xQueue;
 					configure the timeout structure. */
 					vTaskInternalSetTimeOutState( &xTimeOut );
 					xEntryTimeSet = pdTRUE;
+					prvStatsCountWait( pxQueue, ulReceiveWaits );
 				}
 				else
 				{
@@ -1399,6 +1472,7 @@ Queue_t * const pxQueue = xQueue;
 
 			if( prvIsQueueEmpty( pxQueue ) != pdFALSE )
 			{
+				prvStatsEndWait( pxQueue, xEntryTimeSet, xTimeOut );
 				traceQUEUE_RECEIVE_FAILED( pxQueue );
 				return errQUEUE_EMPTY;
 			}
@@ -1456,6 +1530,7 @@ Queue_t * const pxQueue = xQueue;
 				/* Semaphores are queues with a data size of zero and where the
 				messages waiting is the semaphore's count.  Reduce the count. */
 				pxQueue->uxMessagesWaiting = uxSemaphoreCount - ( UBaseType_t ) 1;
+				prvStatsCountReceive( pxQueue );
 
 				#if ( configUSE_MUTEXES == 1 )
 				{
@@ -1490,6 +1565,7 @@ Queue_t * const pxQueue = xQueue;
 					mtCOVERAGE_TEST_MARKER();
 				}
 
+				prvStatsEndWait( pxQueue, xEntryTimeSet, xTimeOut );
 				taskEXIT_CRITICAL();
 				return pdPASS;
 			}
@@ -1509,6 +1585,7 @@ Queue_t * const pxQueue = xQueue;
 					/* The semaphore count was 0 and no block time is specified
 					(or the block time has expired) so exit now. */
 					taskEXIT_CRITICAL();
+					prvStatsEndWait( pxQueue, xEntryTimeSet, xTimeOut );
 					traceQUEUE_RECEIVE_FAILED( pxQueue );
 					return errQUEUE_EMPTY;
 				}
@@ -1518,6 +1595,7 @@ Queue_t * const pxQueue = xQueue;
 					so configure the timeout structure ready to block. */
 					vTaskInternalSetTimeOutState( &xTimeOut );
 					xEntryTimeSet = pdTRUE;
+					prvStatsCountWait( pxQueue, ulReceiveWaits );
 				}
 				else
 				{
@@ -1552,6 +1630,7 @@ Queue_t * const pxQueue = xQueue;
 						taskENTER_CRITICAL();
 						{
 							xInheritanceOccurred = xTaskPriorityInherit( pxQueue->u.xSemaphore.xMutexHolder );
+							prvStatsCountInheritance( pxQueue, xInheritanceOccurred );
 						}
 						taskEXIT_CRITICAL();
 					}
@@ -1617,6 +1696,7 @@ Queue_t * const pxQueue = xQueue;
 				}
 				#endif /* configUSE_MUTEXES */
 
+				prvStatsEndWait( pxQueue, xEntryTimeSet, xTimeOut );
 				traceQUEUE_RECEIVE_FAILED( pxQueue );
 				return errQUEUE_EMPTY;
 			}
@@ -1694,6 +1774,7 @@ Queue_t * const pxQueue = xQueue;
 					mtCOVERAGE_TEST_MARKER();
 				}
 
+				prvStatsEndWait( pxQueue, xEntryTimeSet, xTimeOut );
 				taskEXIT_CRITICAL();
 				return pdPASS;
 			}
@@ -1704,6 +1785,7 @@ Queue_t * const pxQueue = xQueue;
 					/* The queue was empty and no block time is specified (or
 					the block time has expired) so leave now. */
 					taskEXIT_CRITICAL();
+					prvStatsEndWait( pxQueue, xEntryTimeSet, xTimeOut );
 					traceQUEUE_PEEK_FAILED( pxQueue );
 					return errQUEUE_EMPTY;
 				}
@@ -1714,6 +1796,7 @@ Queue_t * const pxQueue = xQueue;
 					state. */
 					vTaskInternalSetTimeOutState( &xTimeOut );
 					xEntryTimeSet = pdTRUE;
+					prvStatsCountWait( pxQueue, ulReceiveWaits );
 				}
 				else
 				{
@@ -1766,6 +1849,7 @@ Queue_t * const pxQueue = xQueue;
 
 			if( prvIsQueueEmpty( pxQueue ) != pdFALSE )
 			{
+				prvStatsEndWait( pxQueue, xEntryTimeSet, xTimeOut );
 				traceQUEUE_PEEK_FAILED( pxQueue );
 				return errQUEUE_EMPTY;
 			}
@@ -1816,6 +1900,7 @@ Queue_t * const pxQueue = xQueue;
 
 			prvCopyDataFromQueue( pxQueue, pvBuffer );
 			pxQueue->uxMessagesWaiting = uxMessagesWaiting - ( UBaseType_t ) 1;
+			prvStatsCountReceive( pxQueue );
 
 			/* If the queue is locked the event list will not be modified.
 			Instead update the lock count so the task that unlocks the queue
@@ -2141,6 +2226,7 @@ UBaseType_t uxMessagesWaiting;
 	}
 
 	pxQueue->uxMessagesWaiting = uxMessagesWaiting + ( UBaseType_t ) 1;
+	prvStatsCountSend( pxQueue );
 
 	return xReturn;
 }
@@ -2728,6 +2814,144 @@ Queue_t * const pxQueue = xQueue;
 #endif /* configQUEUE_REGISTRY_SIZE */
 /*-----------------------------------------------------------*/
 
+#if ( configUSE_QUEUE_STATS == 1 )
+
+	static void prvRecordWaitTime( Queue_t * const pxQueue, const TimeOut_t * const pxTimeOut )
+	{
+	const uint32_t ulWaitTicks = ( uint32_t ) ( xTaskGetTickCount() - pxTimeOut->xTimeOnEntering );
+
+		taskENTER_CRITICAL();
+		{
+			pxQueue->xStats.ulTotalWaitTicks += ulWaitTicks;
+
+			if( ulWaitTicks > pxQueue->xStats.ulMaxWaitTicks )
+			{
+				pxQueue->xStats.ulMaxWaitTicks = ulWaitTicks;
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+		taskEXIT_CRITICAL();
+	}
+
+#endif /* configUSE_QUEUE_STATS */
+/*-----------------------------------------------------------*/
+
+#if ( configUSE_QUEUE_STATS == 1 )
+
+	void vQueueGetStats( QueueHandle_t xQueue, QueueStats_t *pxStats )
+	{
+	Queue_t * const pxQueue = xQueue;
+
+		configASSERT( pxQueue );
+		configASSERT( pxStats );
+
+		taskENTER_CRITICAL();
+		{
+			*pxStats = pxQueue->xStats;
+		}
+		taskEXIT_CRITICAL();
+	}
+
+#endif /* configUSE_QUEUE_STATS */
+/*-----------------------------------------------------------*/
+
+#if ( configUSE_QUEUE_STATS == 1 )
+
+	void vQueueResetStats( QueueHandle_t xQueue )
+	{
+	Queue_t * const pxQueue = xQueue;
+
+		configASSERT( pxQueue );
+
+		taskENTER_CRITICAL();
+		{
+			( void ) memset( ( void * ) &( pxQueue->xStats ), 0x00, sizeof( pxQueue->xStats ) );
+
+			/* The high water mark restarts from the current fill level. */
+			pxQueue->xStats.uxHighWaterMark = pxQueue->uxMessagesWaiting;
+		}
+		taskEXIT_CRITICAL();
+	}
+
+#endif /* configUSE_QUEUE_STATS */
+/*-----------------------------------------------------------*/
+
+#if ( ( configUSE_QUEUE_STATS == 1 ) && ( configQUEUE_REGISTRY_SIZE > 0 ) )
+
+	BaseType_t xQueueGetNextRegisteredStats( UBaseType_t *puxIndex, const char **ppcQueueName, QueueStats_t *pxStats ) /*lint !e971 Unqualified char types are allowed for strings and single characters only. */
+	{
+	UBaseType_t ux;
+	BaseType_t xReturn = pdFALSE;
+
+		configASSERT( puxIndex );
+
+		/* As with pcQueueGetName(), nothing here protects against another task
+		adding or removing entries from the registry while it is being
+		walked. */
+		for( ux = *puxIndex; ux < ( UBaseType_t ) configQUEUE_REGISTRY_SIZE; ux++ )
+		{
+			if( xQueueRegistry[ ux ].pcQueueName != NULL )
+			{
+				if( ppcQueueName != NULL )
+				{
+					*ppcQueueName = xQueueRegistry[ ux ].pcQueueName;
+				}
+
+				if( pxStats != NULL )
+				{
+					vQueueGetStats( xQueueRegistry[ ux ].xHandle, pxStats );
+				}
+
+				xReturn = pdTRUE;
+				ux++;
+				break;
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+
+		*puxIndex = ux;
+
+		return xReturn;
+	}
+
+#endif /* ( configUSE_QUEUE_STATS == 1 ) && ( configQUEUE_REGISTRY_SIZE > 0 ) */
+/*-----------------------------------------------------------*/
+
+#if ( ( configUSE_QUEUE_STATS == 1 ) && ( configQUEUE_REGISTRY_SIZE > 0 ) )
+
+	BaseType_t xQueueGetStatsByName( const char *pcQueueName, QueueStats_t *pxStats ) /*lint !e971 Unqualified char types are allowed for strings and single characters only. */
+	{
+	UBaseType_t ux;
+	BaseType_t xReturn = pdFALSE;
+
+		configASSERT( pcQueueName );
+
+		for( ux = ( UBaseType_t ) 0U; ux < ( UBaseType_t ) configQUEUE_REGISTRY_SIZE; ux++ )
+		{
+			if( ( xQueueRegistry[ ux ].pcQueueName != NULL ) && ( strcmp( xQueueRegistry[ ux ].pcQueueName, pcQueueName ) == 0 ) )
+			{
+				vQueueGetStats( xQueueRegistry[ ux ].xHandle, pxStats );
+				xReturn = pdTRUE;
+				break;
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+
+		return xReturn;
+	}
+
+#endif /* ( configUSE_QUEUE_STATS == 1 ) && ( configQUEUE_REGISTRY_SIZE > 0 ) */
+/*-----------------------------------------------------------*/
+
 #if ( configUSE_TIMERS == 1 )
 
 	void vQueueWaitForMessageRestricted( QueueHandle_t xQueue, TickType_t xTicksToWait, const BaseType_t xWaitIndefinitely )
@@ -0,0 +1,399 @@
+/*
+ * FreeRTOS Kernel V10.2.0
+ * Copyright (C) 2019 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+/* Defining MPU_WRAPPERS_INCLUDED_FROM_API_FILE prevents task.h from redefining
+all the API functions to use the MPU wrappers.  That should only be done when
+task.h is included from an application file. */
+#define MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "task_pool.h"
+
+#undef MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#if( INCLUDE_vTaskPrioritySet != 1 )
+	#error INCLUDE_vTaskPrioritySet must be set to 1 in FreeRTOSConfig.h to use task pools
+#endif
+
+#if( INCLUDE_vTaskDelete != 1 )
+	#error INCLUDE_vTaskDelete must be set to 1 in FreeRTOSConfig.h to use task pools
+#endif
+
+#if( configSUPPORT_DYNAMIC_ALLOCATION != 1 )
+	#error configSUPPORT_DYNAMIC_ALLOCATION must be set to 1 in FreeRTOSConfig.h to use task pools
+#endif
+
+/* The item held in the backlog - the job plus the time it was submitted. */
+typedef struct xTASK_POOL_ITEM
+{
+	TaskPoolJob_t xJob;
+	TickType_t xSubmitTime;
+} TaskPoolItem_t;
+
+typedef struct TaskPoolDef_t
+{
+	QueueHandle_t xBacklog;				/*< Jobs waiting for a worker. */
+	const char *pcName;					/*< Given to each worker. */ /*lint !e971 Unqualified char types are allowed for strings and single characters only. */
+	configSTACK_DEPTH_TYPE usStackDepth;
+	UBaseType_t uxPriority;
+	UBaseType_t uxMinWorkers;
+	UBaseType_t uxMaxWorkers;
+	TickType_t xIdleTimeout;
+	UBaseType_t uxIdleWorkers;			/*< Workers not running a job.  Only accessed in a critical section. */
+	UBaseType_t uxPendingJobs;			/*< Jobs submitted but not yet taken by a worker.  Only accessed in a critical section. */
+	TaskPoolStats_t xStats;				/*< Only accessed in a critical section. */
+} TaskPool_t;
+
+/*-----------------------------------------------------------*/
+
+/*
+ * The function run by every worker.
+ */
+static portTASK_FUNCTION_PROTO( prvWorkerTask, pvParameters );
+
+/*
+ * Creates one worker.  The caller must already have counted it in uxWorkers
+ * and uxIdleWorkers.
+ */
+static BaseType_t prvCreateWorker( TaskPool_t *pxPool ) PRIVILEGED_FUNCTION;
+
+/*-----------------------------------------------------------*/
+
+TaskPoolHandle_t xTaskPoolCreate( const char * const pcName, UBaseType_t uxMinWorkers, UBaseType_t uxMaxWorkers, configSTACK_DEPTH_TYPE usStackDepth, UBaseType_t uxPriority, UBaseType_t uxBacklog, TickType_t xIdleTimeout ) /*lint !e971 Unqualified char types are allowed for strings and single characters only. */
+{
+TaskPool_t *pxPool;
+UBaseType_t x;
+
+	/* At least one worker must always exist, otherwise a job could be left in
+	the backlog with no worker to run it. */
+	configASSERT( uxMinWorkers > 0U );
+	configASSERT( uxMaxWorkers >= uxMinWorkers );
+	configASSERT( uxPriority < configMAX_PRIORITIES );
+	configASSERT( uxBacklog > 0U );
+
+	pxPool = ( TaskPool_t * ) pvPortMalloc( sizeof( TaskPool_t ) );
+
+	if( pxPool != NULL )
+	{
+		memset( ( void * ) pxPool, 0x00, sizeof( TaskPool_t ) );
+
+		pxPool->xBacklog = xQueueCreate( uxBacklog, sizeof( TaskPoolItem_t ) );
+
+		if( pxPool->xBacklog != NULL )
+		{
+			pxPool->pcName = pcName;
+			pxPool->usStackDepth = usStackDepth;
+			pxPool->uxPriority = uxPriority;
+			pxPool->uxMinWorkers = uxMinWorkers;
+			pxPool->uxMaxWorkers = uxMaxWorkers;
+			pxPool->xIdleTimeout = xIdleTimeout;
+
+			for( x = 0; x < uxMinWorkers; x++ )
+			{
+				pxPool->xStats.uxWorkers++;
+				pxPool->uxIdleWorkers++;
+
+				if( prvCreateWorker( pxPool ) != pdPASS )
+				{
+					/* Workers that were created cannot be cleaned up safely
+					once running, so a partially created pool is left with the
+					workers it managed to get. */
+					pxPool->xStats.uxWorkers--;
+					pxPool->uxIdleWorkers--;
+					break;
+				}
+			}
+
+			pxPool->xStats.uxPeakWorkers = pxPool->xStats.uxWorkers;
+
+			if( pxPool->xStats.uxWorkers == 0U )
+			{
+				vQueueDelete( pxPool->xBacklog );
+				vPortFree( pxPool );
+				pxPool = NULL;
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+		else
+		{
+			vPortFree( pxPool );
+			pxPool = NULL;
+		}
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	return pxPool;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xTaskPoolSubmit( TaskPoolHandle_t xPool, const TaskPoolJob_t * const pxJob, TickType_t xTicksToWait )
+{
+TaskPool_t *pxPool = xPool;
+TaskPoolItem_t xItem;
+BaseType_t xReturn, xGrow = pdFALSE;
+UBaseType_t uxWaiting;
+
+	configASSERT( pxPool );
+	configASSERT( pxJob );
+	configASSERT( pxJob->pxFunction );
+	configASSERT( ( pxJob->uxPriority == taskpoolPOOL_PRIORITY ) || ( pxJob->uxPriority < configMAX_PRIORITIES ) );
+
+	xItem.xJob = *pxJob;
+	xItem.xSubmitTime = xTaskGetTickCount();
+
+	/* Count the job as pending before posting it.  A worker only takes a job
+	some time after it was posted, so the idle workers that are already
+	promised to pending jobs cannot take this one.  If pending jobs now
+	outnumber the idle workers, and the pool is allowed to grow, reserve a new
+	worker before posting the job. */
+	taskENTER_CRITICAL();
+	{
+		pxPool->uxPendingJobs++;
+
+		if( ( pxPool->uxPendingJobs > pxPool->uxIdleWorkers ) && ( pxPool->xStats.uxWorkers < pxPool->uxMaxWorkers ) )
+		{
+			pxPool->xStats.uxWorkers++;
+			pxPool->uxIdleWorkers++;
+			xGrow = pdTRUE;
+
+			if( pxPool->xStats.uxWorkers > pxPool->xStats.uxPeakWorkers )
+			{
+				pxPool->xStats.uxPeakWorkers = pxPool->xStats.uxWorkers;
+			}
+		}
+	}
+	taskEXIT_CRITICAL();
+
+	if( xGrow != pdFALSE )
+	{
+		if( prvCreateWorker( pxPool ) != pdPASS )
+		{
+			/* Out of heap - the job will wait for an existing worker. */
+			taskENTER_CRITICAL();
+			{
+				pxPool->xStats.uxWorkers--;
+				pxPool->uxIdleWorkers--;
+			}
+			taskEXIT_CRITICAL();
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+
+	if( ( pxJob->uxPriority != taskpoolPOOL_PRIORITY ) && ( pxJob->uxPriority > pxPool->uxPriority ) )
+	{
+		xReturn = xQueueSendToFront( pxPool->xBacklog, &xItem, xTicksToWait );
+	}
+	else
+	{
+		xReturn = xQueueSendToBack( pxPool->xBacklog, &xItem, xTicksToWait );
+	}
+
+	uxWaiting = uxQueueMessagesWaiting( pxPool->xBacklog );
+
+	taskENTER_CRITICAL();
+	{
+		if( xReturn == pdPASS )
+		{
+			pxPool->xStats.ulJobsSubmitted++;
+
+			if( uxWaiting > pxPool->xStats.uxPeakBacklog )
+			{
+				pxPool->xStats.uxPeakBacklog = uxWaiting;
+			}
+		}
+		else
+		{
+			/* A worker reserved for the job, if any, stays idle and retires
+			once the idle time out expires. */
+			pxPool->uxPendingJobs--;
+			pxPool->xStats.ulJobsRejected++;
+		}
+	}
+	taskEXIT_CRITICAL();
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+void vTaskPoolGetStats( TaskPoolHandle_t xPool, TaskPoolStats_t *pxStats )
+{
+TaskPool_t *pxPool = xPool;
+
+	configASSERT( pxPool );
+
+	taskENTER_CRITICAL();
+	{
+		*pxStats = pxPool->xStats;
+	}
+	taskEXIT_CRITICAL();
+}
+/*-----------------------------------------------------------*/
+
+void vTaskPoolResetStats( TaskPoolHandle_t xPool )
+{
+TaskPool_t *pxPool = xPool;
+
+	configASSERT( pxPool );
+
+	taskENTER_CRITICAL();
+	{
+		pxPool->xStats.ulJobsSubmitted = 0;
+		pxPool->xStats.ulJobsCompleted = 0;
+		pxPool->xStats.ulJobsRejected = 0;
+		pxPool->xStats.ulTotalQueueingDelay = 0;
+		pxPool->xStats.ulMaxQueueingDelay = 0;
+		pxPool->xStats.ulTotalServiceTime = 0;
+		pxPool->xStats.ulMaxServiceTime = 0;
+		pxPool->xStats.uxPeakWorkers = pxPool->xStats.uxWorkers;
+		pxPool->xStats.uxPeakBacklog = 0;
+	}
+	taskEXIT_CRITICAL();
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvCreateWorker( TaskPool_t *pxPool )
+{
+	return xTaskCreate( prvWorkerTask, pxPool->pcName, pxPool->usStackDepth, ( void * ) pxPool, pxPool->uxPriority, NULL );
+}
+/*-----------------------------------------------------------*/
+
+static portTASK_FUNCTION( prvWorkerTask, pvParameters )
+{
+TaskPool_t *pxPool = ( TaskPool_t * ) pvParameters;
+TaskPoolItem_t xItem;
+TickType_t xWait, xStartTime, xEndTime, xQueueingDelay, xServiceTime;
+BaseType_t xExit;
+
+	/* A fixed size pool never has workers to retire, so waits forever. */
+	xWait = ( pxPool->uxMinWorkers == pxPool->uxMaxWorkers ) ? portMAX_DELAY : pxPool->xIdleTimeout;
+
+	for( ;; )
+	{
+		if( xQueueReceive( pxPool->xBacklog, &xItem, xWait ) == pdPASS )
+		{
+			taskENTER_CRITICAL();
+			{
+				pxPool->uxPendingJobs--;
+				pxPool->uxIdleWorkers--;
+			}
+			taskEXIT_CRITICAL();
+
+			if( xItem.xJob.uxPriority != taskpoolPOOL_PRIORITY )
+			{
+				vTaskPrioritySet( NULL, xItem.xJob.uxPriority );
+			}
+
+			xStartTime = xTaskGetTickCount();
+			xItem.xJob.pxFunction( xItem.xJob.pvParameters );
+			xEndTime = xTaskGetTickCount();
+
+			if( xItem.xJob.uxPriority != taskpoolPOOL_PRIORITY )
+			{
+				vTaskPrioritySet( NULL, pxPool->uxPriority );
+			}
+
+			xQueueingDelay = xStartTime - xItem.xSubmitTime;
+			xServiceTime = xEndTime - xStartTime;
+
+			taskENTER_CRITICAL();
+			{
+				pxPool->xStats.ulJobsCompleted++;
+				pxPool->xStats.ulTotalQueueingDelay += ( uint32_t ) xQueueingDelay;
+				pxPool->xStats.ulTotalServiceTime += ( uint32_t ) xServiceTime;
+
+				if( ( uint32_t ) xQueueingDelay > pxPool->xStats.ulMaxQueueingDelay )
+				{
+					pxPool->xStats.ulMaxQueueingDelay = ( uint32_t ) xQueueingDelay;
+				}
+
+				if( ( uint32_t ) xServiceTime > pxPool->xStats.ulMaxServiceTime )
+				{
+					pxPool->xStats.ulMaxServiceTime = ( uint32_t ) xServiceTime;
+				}
+			}
+			taskEXIT_CRITICAL();
+
+			if( xItem.xJob.pxCompletionCallback != NULL )
+			{
+				xItem.xJob.pxCompletionCallback( xItem.xJob.pvParameters );
+			}
+
+			#if( configUSE_TASK_NOTIFICATIONS == 1 )
+			{
+				if( xItem.xJob.xTaskToNotify != NULL )
+				{
+					( void ) xTaskNotifyGive( xItem.xJob.xTaskToNotify );
+				}
+			}
+			#endif
+
+			taskENTER_CRITICAL();
+			{
+				pxPool->uxIdleWorkers++;
+			}
+			taskEXIT_CRITICAL();
+		}
+		else
+		{
+			/* Idle for xIdleTimeout - retire if the pool is above its
+			minimum size, unless every other idle worker is needed for the
+			jobs that were submitted meanwhile. */
+			xExit = pdFALSE;
+
+			taskENTER_CRITICAL();
+			{
+				if( ( pxPool->xStats.uxWorkers > pxPool->uxMinWorkers ) && ( pxPool->uxIdleWorkers > pxPool->uxPendingJobs ) )
+				{
+					pxPool->xStats.uxWorkers--;
+					pxPool->uxIdleWorkers--;
+					xExit = pdTRUE;
+				}
+			}
+			taskEXIT_CRITICAL();
+
+			if( xExit != pdFALSE )
+			{
+				vTaskDelete( NULL );
+			}
+		}
+	}
+}
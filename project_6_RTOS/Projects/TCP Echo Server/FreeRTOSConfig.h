@@ -108,6 +108,15 @@
 #define configUSE_COUNTING_SEMAPHORES                   1
 #define configGENERATE_RUN_TIME_STATS                   0
 
+/* Heap allocation profiler, see heap_profiler.h.  The CP0 count register runs
+at half the core clock and is used to time each allocation. */
+#define configUSE_HEAP_PROFILER                         0
+#define configHEAP_PROFILER_GET_TIMESTAMP()             _CP0_GET_COUNT()
+
+/* Per queue/semaphore contention statistics, see vQueueGetStats().  Set
+configQUEUE_REGISTRY_SIZE above 0 to look them up by name. */
+#define configUSE_QUEUE_STATS                           0
+
 /* Co-routine definitions. */
 #define configUSE_CO_ROUTINES 			0
 #define configMAX_CO_ROUTINE_PRIORITIES ( 2 )
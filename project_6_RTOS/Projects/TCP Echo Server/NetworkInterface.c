@@ -381,6 +381,9 @@ BaseType_t xNetworkInterfaceInitialise(void)
         s_hTxDMABufCountSemaphore = xSemaphoreCreateCounting(ipconfigPIC32_TX_DMA_DESCRIPTORS, ipconfigPIC32_TX_DMA_DESCRIPTORS);
         s_hTxDMABufMutex = xSemaphoreCreateMutex();
         configASSERT( g_hLinkUpSemaphore && s_hTxDMABufCountSemaphore && s_hTxDMABufMutex );
+        vQueueAddToRegistry(g_hLinkUpSemaphore, "EthLink");
+        vQueueAddToRegistry(s_hTxDMABufCountSemaphore, "EthTxBuf");
+        vQueueAddToRegistry(s_hTxDMABufMutex, "EthTxMtx");
 
         memset(&s_tStats, 0, sizeof(s_tStats));
         memset((void *) s_tTxDMADescriptors, 0, sizeof(s_tTxDMADescriptors));
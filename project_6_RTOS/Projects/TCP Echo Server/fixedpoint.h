@@ -0,0 +1,70 @@
+/*  fixedpoint.h - Fixed point arithmetic include file
+ *
+ *  Q16.16 and Q1.31 arithmetic for sensor and control code. The PIC32MX has
+ *  no FPU so every float operation is a soft-float library call; these
+ *  routines only use 32 bit integer operations and the 32x32->64 bit
+ *  multiply the core provides in hardware.
+ *
+ *  q16_t - signed Q16.16, range -32768.0 to 32767.99998, step 1/65536
+ *  q31_t - signed Q1.31, range -1.0 to 0.9999999995, step 1/2^31
+ *
+ *  Add, subtract, multiply and divide saturate to the limits of the type
+ *  rather than wrapping.
+ */
+#ifndef __FIXEDPOINT_H__
+    #define __FIXEDPOINT_H__
+
+    #include <stdint.h>
+    #include <stddef.h>
+
+    typedef int32_t q16_t;
+    typedef int32_t q31_t;
+
+    #define Q16_ONE         ((q16_t) 0x00010000)
+    #define Q16_MAX         ((q16_t) 0x7FFFFFFF)
+    #define Q16_MIN         ((q16_t) (-0x7FFFFFFF - 1))
+    #define Q31_MAX         ((q31_t) 0x7FFFFFFF)
+    #define Q31_MIN         ((q31_t) (-0x7FFFFFFF - 1))
+
+    /* Conversions. Q16_CONST and Q31_CONST are for floating point literals
+     * only - the compiler folds them to integer constants so no float code
+     * is generated. */
+    #define Q16_CONST(f)    ((q16_t) ((f) * 65536.0 + (((f) >= 0) ? 0.5 : -0.5)))
+    #define Q31_CONST(f)    ((q31_t) ((f) * 2147483648.0 + (((f) >= 0) ? 0.5 : -0.5)))
+    #define Q16_FROM_INT(i) ((q16_t) ((int32_t) (i) * Q16_ONE))
+    #define Q16_TO_INT(q)   ((int32_t) ((q) >> 16))     /* Rounds towards minus infinity */
+    #define Q16_FRAC(q)     ((uint32_t) (q) & 0xFFFFu)
+
+    /* Largest number of decimal places q16_format() will write */
+    #define Q16_MAX_DECIMALS    4
+
+#endif
+
+/* Function prototypes */
+
+/* Q16.16 arithmetic */
+q16_t q16_add(q16_t a, q16_t b);
+q16_t q16_sub(q16_t a, q16_t b);
+q16_t q16_mul(q16_t a, q16_t b);
+q16_t q16_div(q16_t a, q16_t b);        // exact, uses a 64 bit divide
+q16_t q16_div_fast(q16_t a, q16_t b);   // a * (1/b) by Newton-Raphson, rounded like q16_div()
+q16_t q16_recip(q16_t x);
+
+/* Q1.31 arithmetic */
+q31_t q31_add(q31_t a, q31_t b);
+q31_t q31_sub(q31_t a, q31_t b);
+q31_t q31_mul(q31_t a, q31_t b);
+q31_t q16_to_q31(q16_t x);              // saturates values outside [-1, 1)
+q16_t q31_to_q16(q31_t x);
+
+/* Temperature conversions */
+q16_t q16_mlx90614_to_celsius(uint16_t raw);   // raw RAM reading, 0.02 K per LSB
+q16_t q16_celsius_to_fahrenheit(q16_t celsius);
+q16_t q16_fahrenheit_to_celsius(q16_t fahrenheit);
+
+/* Writes x as a NUL terminated decimal string with the given number of
+ * decimal places (0 to Q16_MAX_DECIMALS), rounded to nearest. Returns the
+ * length written, not counting the NUL, or 0 if buf is too small. */
+size_t q16_format(char *buf, size_t len, q16_t x, unsigned int decimals);
+
+/* End of fixedpoint.h */
@@ -28,13 +28,24 @@
 #include "FreeRTOS.h"
 #include "task.h"
 #include "queue.h"
+#include "task_pool.h"
 
 /* Hardware dependent setting */
 #include "chipKIT_Pro_MX7.h"
 #include "FreeRTOS.h"
 #include "FreeRTOS_IP_Private.h"
+#include "fixedpoint.h"
 
 #define tcpechoSHUTDOWN_DELAY	( pdMS_TO_TICKS( 5000 ) )
+
+/* Connections are served by a pool of worker tasks rather than by a task
+ * created and deleted per connection.  One worker always exists, more are
+ * created while several clients are connected and retire once idle. */
+#define tcpechoMIN_WORKERS          ( 1 )
+#define tcpechoMAX_WORKERS          ( 3 )
+#define tcpechoWORKER_STACK_SIZE    ( 2048 ) /* I've increased the memory allocated to the task as I was encountering stack overflow issues */
+#define tcpechoCONNECTION_BACKLOG   ( 4 )
+#define tcpechoWORKER_IDLE_TIMEOUT  ( pdMS_TO_TICKS( 10000 ) )
 // define setup parameters for OpenADC10
 // Turn module on | ouput in integer | trigger mode auto | enable autosample
 #define PARAM1  ADC_MODULE_ON | ADC_FORMAT_INTG | ADC_CLK_AUTO | ADC_AUTO_SAMPLING_ON
@@ -52,9 +63,12 @@ static void prvSetupHardware( void );
 
 /* Task that waits for incoming TCP connections*/
 static void vCreateTCPServerSocket( void *pvParameters );
-/* Task that echos incoming TCP packets*/
+/* Task pool job that echos incoming TCP packets*/
 static void prvServerConnectionInstance( void *pvParameters );
 
+/* Workers that run prvServerConnectionInstance() for each accepted connection. */
+static TaskPoolHandle_t xConnectionPool = NULL;
+
 /* The MAC address array is not declared const as the MAC address will
 normally be read from an EEPROM and not hard coded (in real deployed
 applications). In this case the MAC Address is hard coded to the value we
@@ -96,7 +110,15 @@ int main( void )
     /*
      * Our RTOS tasks can be created here.
      */
-    int TCP_Port1 = 10000;
+    static int TCP_Port1 = 10000;
+    xConnectionPool = xTaskPoolCreate( "Echo",
+                                       tcpechoMIN_WORKERS,
+                                       tcpechoMAX_WORKERS,
+                                       tcpechoWORKER_STACK_SIZE,
+                                       tskIDLE_PRIORITY,
+                                       tcpechoCONNECTION_BACKLOG,
+                                       tcpechoWORKER_IDLE_TIMEOUT );
+    configASSERT( xConnectionPool != NULL );
     xTaskCreate( vCreateTCPServerSocket, "TCP1", configMINIMAL_STACK_SIZE, (void *)&TCP_Port1, tskIDLE_PRIORITY+1, NULL );
     
     /* Start the RTOS scheduler. */
@@ -191,9 +213,9 @@ void _general_exception_handler( unsigned long ulCause, unsigned long ulStatus )
 /* vCreateTCPServerSocket Function Description *************************
  * SYNTAX:          static void vCreateTCPServerSocket( void *pvParameters );
  * KEYWORDS:        RTOS, Task
- * DESCRIPTION:     Waits for an incoming request for a TCP socket connection 
- *                  to be made. The function then, launches a new task for 
- *                  managing the connection and deletes itself.
+ * DESCRIPTION:     Waits for incoming requests for a TCP socket connection 
+ *                  to be made. Each accepted connection is handed to the
+ *                  connection task pool, which runs it on a worker task.
  * PARAMETER 1:     void pointer - data of unspecified data type sent from
  *                  RTOS scheduler
  * RETURN VALUE:    None (There is no returning from this function)
@@ -210,6 +232,7 @@ static void vCreateTCPServerSocket( void *pvParameters )
     struct freertos_sockaddr xClient, xBindAddress;
     Socket_t xListeningSocket, xConnectedSocket;
     socklen_t xSize = sizeof( xClient );
+    TaskPoolJob_t xJob;
     static const TickType_t xReceiveTimeOut = portMAX_DELAY;
     const BaseType_t xBacklog = 20;
 
@@ -245,27 +268,30 @@ static void vCreateTCPServerSocket( void *pvParameters )
         xConnectedSocket = FreeRTOS_accept( xListeningSocket, &xClient, &xSize );
         configASSERT( xConnectedSocket != FREERTOS_INVALID_SOCKET );
 
-        /* Spawn a RTOS task to handle the connection. */
-        char task_name[25];
-        sprintf(task_name, "EchoServer: %d", listeningPort);
-        xTaskCreate( prvServerConnectionInstance,
-                     task_name,
-                     2048, /* I've increased the memory allocated to the task as I was encountering stack overflow issues */
-                     ( void * ) &xConnectedSocket,
-                     tskIDLE_PRIORITY,
-                     NULL );
-        vTaskDelete( NULL );
+        /* Hand the connection to a worker.  The socket is passed by value
+         * as xConnectedSocket is reused by the next accept(). */
+        xJob.pxFunction = prvServerConnectionInstance;
+        xJob.pvParameters = ( void * ) xConnectedSocket;
+        xJob.uxPriority = taskpoolPOOL_PRIORITY;
+        xJob.pxCompletionCallback = NULL;
+        xJob.xTaskToNotify = NULL;
+
+        if( xTaskPoolSubmit( xConnectionPool, &xJob, 0 ) != pdPASS )
+        {
+            /* Too many connections waiting for a worker - refuse this one. */
+            FreeRTOS_closesocket( xConnectedSocket );
+        }
     }
 }
 
 /* prvServerConnectionInstance Function Description *************************
  * SYNTAX:          static void prvServerConnectionInstance( void *pvParameters );
- * KEYWORDS:        RTOS, Task
+ * KEYWORDS:        RTOS, Task pool, Job
  * DESCRIPTION:     Waits for incoming TCP packets from the given socket, stores
  *                  the input, and then echos it back.
- * PARAMETER 1:     void pointer - data of unspecified data type sent from
- *                  RTOS scheduler
- * RETURN VALUE:    None (There is no returning from this function)
+ * PARAMETER 1:     void pointer - the connected Socket_t, passed by value
+ * RETURN VALUE:    None (returns to the worker once the connection is
+ *                  closed by the client)
  * NOTES:           This function came from a project on GitHub from user
  *                  rjvo called "storage" from the master branch. 
  *                  This project can be found at the following url:
@@ -280,15 +306,15 @@ static void prvServerConnectionInstance( void *pvParameters )
 	static const TickType_t xSendTimeOut = pdMS_TO_TICKS( 5000 );
 	TickType_t xTimeOnShutdown;
 
-	xConnectedSocket = *( Socket_t *) pvParameters;
+	xConnectedSocket = ( Socket_t ) pvParameters;
 	FreeRTOS_setsockopt( xConnectedSocket, 0, FREERTOS_SO_RCVTIMEO, &xReceiveTimeOut, sizeof( xReceiveTimeOut ) );
 	FreeRTOS_setsockopt( xConnectedSocket, 0, FREERTOS_SO_SNDTIMEO, &xSendTimeOut, sizeof( xReceiveTimeOut ) );
     
     // ADC Stuff
     vTaskDelay(pdMS_TO_TICKS(150)); // wait for the first conversion to complete so there will be vaild data in ADC result registers
-    float Values[] = {0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0}; // a place to store 10 readings at a time
+    q16_t Values[] = {0,0,0,0,0,0,0,0,0,0}; // a place to store 10 readings at a time (Q16.16 volts)
     int i = 0;
-    float PeakValue = 0.0;
+    q16_t PeakValue = 0;
 	for( ;; )
 	{
 
@@ -300,7 +326,7 @@ static void prvServerConnectionInstance( void *pvParameters )
         vTaskDelay(pdMS_TO_TICKS(100)); // sleep for a bit
         AD1CON1CLR = 0x0002;         // start Converting
         while (!(AD1CON1 & 0x0001)); // conversion done? */
-        float ADCValue = (Channel2 / 1024) * 3.3; // yes then get ADC value
+        q16_t ADCValue = (q16_t) ((Channel2 * Q16_CONST(3.3)) >> 10); // yes then get ADC value (3.3 V full scale, 10 bits)
         Values[i] = ADCValue;
         i++;
         if(i >= 10)
@@ -318,10 +344,17 @@ static void prvServerConnectionInstance( void *pvParameters )
                 
         }
         
-        char PValbuf[20];
-        sprintf(PValbuf, "Peak Value: %f.2", PeakValue);
-        PValbuf[19] = '\r';
-        FreeRTOS_send(xConnectedSocket, &PValbuf, 20, 0);
+        // Integer only formatting - sprintf("%f") pulls in soft-float printf
+        char PValbuf[24] = "Peak Value: ";
+        size_t len = 12;
+        len += q16_format(&PValbuf[len], sizeof(PValbuf) - len - 2, PeakValue, 2);
+        PValbuf[len++] = '\r';
+        PValbuf[len++] = '\n';
+        if( FreeRTOS_send(xConnectedSocket, PValbuf, len, 0) < 0 )
+        {
+            /* The connection has been closed or reset. */
+            break;
+        }
 
 	}
 	
@@ -339,9 +372,8 @@ static void prvServerConnectionInstance( void *pvParameters )
 	    }
 	} while( ( xTaskGetTickCount() - xTimeOnShutdown ) < tcpechoSHUTDOWN_DELAY );
 
-	/* Finished with the socket and the task. */
+	/* Finished with the socket - the worker goes back to the pool. */
 	FreeRTOS_closesocket( xConnectedSocket );
-	vTaskDelete( NULL );
 }
 
 /* ulApplicationGetNextSequenceNumber Function Description *********************
@@ -0,0 +1,366 @@
+/** @file arpcache.c
+ *
+ * @brief Host side test and benchmark of the ARP cache of FreeRTOS+TCP
+ *
+ * @par
+ * Replays the ARP traffic of a segment with many hosts against the real
+ * FreeRTOS_ARP.c: packets come in from peers picked with a popularity of
+ * about 1/rank, which refresh their entry, now and then with the MAC address
+ * of a replaced network card; packets go out to peers, which look up the
+ * entry and on a miss reserve one for the ARP request, as the IP-task does;
+ * once in a while the cache ages or is cleared. Every hit must give the
+ * peer's current MAC address. With ipconfigUSE_ARP_HASH_TABLE each result is
+ * also checked against a model of the cache, a list in least recently used
+ * order where an entry reserved for an ARP request starts at the oldest end,
+ * and at the end every entry of the model must be found. The report gives
+ * the hit rate of the sends.
+ *
+ * @par
+ * It then times, on a full cache and in random order, the lookup of an
+ * entry (every packet sent), the refresh of one (every packet received) and
+ * the insertion of a new address, which replaces an entry.
+ *
+ * @par
+ * Built by the Makefile in this directory with the hash table (arpcache) and
+ * with the linear cache (arpcache_linear), with the number of entries of the
+ * TCP Echo Server or another one:
+ *
+ *     make arpcache arpcache_linear
+ *     make -B arpcache arpcache_linear ARP_CACHE_ENTRIES=256
+ *     ./arpcache -p 1000
+ *
+ *     -p  simulated peers (default 1000)
+ *     -n  operations replayed (default 3000000)
+ *     -i  calls timed for each operation (default 2000000)
+ *
+ * @par
+ * The exit status is 1 if the cache gave a wrong answer.
+ *
+ * @author
+ * Carlos Santos
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "FreeRTOS_IP.h"
+#include "FreeRTOS_IP_Private.h"
+#include "FreeRTOS_ARP.h"
+
+#define ENTRIES         ipconfigARP_CACHE_ENTRIES
+#define LOCAL_IP        0x0A000001u     /* on 10.0.0.0/8 */
+
+/* A row of the model, which is kept with the newest entry first */
+typedef struct {
+    uint32_t ip;
+    MACAddress_t mac;
+    int valid;
+    int age;
+} model_entry;
+
+static model_entry model[ENTRIES];
+static int model_count;
+static unsigned char *generation;
+static uint32_t rng_state = 1;
+static unsigned long checks, failures;
+
+/* The network settings and local addresses, of FreeRTOS_IP.c and
+ * FreeRTOS_UDP_IP.c */
+NetworkAddressingParameters_t xNetworkAddressing;
+UDPPacketHeader_t xDefaultPartUDPPacketHeader;
+const MACAddress_t xBroadcastMACAddress = { { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff } };
+
+/* The kernel and IP-task functions FreeRTOS_ARP.c calls. There are no
+ * network buffers, so no ARP requests go out and no packets are held. */
+TickType_t xTaskGetTickCount(void) { return 1; }
+NetworkBufferDescriptor_t *pxGetNetworkBufferWithDescriptor(size_t xRequestedSizeBytes, TickType_t xBlockTimeTicks) { (void) xRequestedSizeBytes; (void) xBlockTimeTicks; return NULL; }
+void vReleaseNetworkBufferAndDescriptor(NetworkBufferDescriptor_t * const pxNetworkBuffer) { (void) pxNetworkBuffer; }
+BaseType_t xNetworkInterfaceOutput(NetworkBufferDescriptor_t * const pxNetworkBuffer, BaseType_t xReleaseAfterSend) { (void) pxNetworkBuffer; (void) xReleaseAfterSend; return pdPASS; }
+BaseType_t xSendEventToIPTask(eIPEvent_t eEvent) { (void) eEvent; return pdPASS; }
+void vIPReloadARPPendingTimer(TickType_t xTime) { (void) xTime; }
+void vIPSetARPPendingTimerEnableState(BaseType_t xEnableState) { (void) xEnableState; }
+void vProcessGeneratedUDPPacket(NetworkBufferDescriptor_t * const pxNetworkBuffer) { (void) pxNetworkBuffer; }
+void vTCPWakeUpConnectingSockets(void) { }
+
+static uint32_t rnd(uint32_t n)
+{
+    /* xorshift32 */
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state % n;
+}
+
+static uint32_t peer_ip(int peer)
+{
+    return FreeRTOS_htonl(LOCAL_IP + 1u + (uint32_t) peer);
+}
+
+static void peer_mac(int peer, MACAddress_t *mac)
+{
+    mac->ucBytes[0] = 0x02;
+    mac->ucBytes[1] = generation[peer];
+    mac->ucBytes[2] = (uint8_t) (peer >> 24);
+    mac->ucBytes[3] = (uint8_t) (peer >> 16);
+    mac->ucBytes[4] = (uint8_t) (peer >> 8);
+    mac->ucBytes[5] = (uint8_t) peer;
+}
+
+/* A peer, the lower numbers the more popular ones */
+static int pick_peer(int peers)
+{
+    double a = rnd(1000000) / 1e6, b = rnd(1000000) / 1e6;
+
+    return (int) (peers * a * b);
+}
+
+static void fail(const char *what, unsigned long when)
+{
+    if(failures++ < 10)
+        printf("%s at operation %lu\n", what, when);
+}
+
+static int model_find(uint32_t ip)
+{
+    int i;
+
+    for(i = 0; i < model_count; i++)
+    {
+        if(model[i].ip == ip)
+            return i;
+    }
+    return -1;
+}
+
+static void model_touch(int i)
+{
+    model_entry e = model[i];
+
+    memmove(&model[1], &model[0], i * sizeof(model[0]));
+    model[0] = e;
+}
+
+/* vARPRefreshCacheEntry() */
+static void model_refresh(const MACAddress_t *mac, uint32_t ip)
+{
+    int i = model_find(ip);
+
+    if(i < 0)
+    {
+        if(model_count == ENTRIES)
+            model_count--;
+        i = model_count++;
+        model[i].ip = ip;
+        model[i].valid = 0;
+        model[i].age = ipconfigMAX_ARP_RETRANSMISSIONS;
+    }
+    if(mac != NULL)
+    {
+        model[i].mac = *mac;
+        model[i].valid = 1;
+        model[i].age = ipconfigMAX_ARP_AGE;
+        model_touch(i);
+    }
+}
+
+#if( ipconfigUSE_ARP_HASH_TABLE != 0 )
+
+/* eARPGetCacheEntry() */
+static eARPLookupResult_t model_lookup(uint32_t ip, MACAddress_t *mac)
+{
+    int i = model_find(ip);
+
+    if(i < 0)
+        return eARPCacheMiss;
+    if(!model[i].valid)
+        return eCantSendPacket;
+    *mac = model[i].mac;
+    model_touch(i);
+    return eARPCacheHit;
+}
+
+#endif /* ipconfigUSE_ARP_HASH_TABLE */
+
+/* vARPAgeCache() */
+static void model_age(void)
+{
+    int i, j = 0;
+
+    for(i = 0; i < model_count; i++)
+    {
+        if(--model[i].age > 0)
+            model[j++] = model[i];
+    }
+    model_count = j;
+}
+
+static void replay(int peers, unsigned long operations)
+{
+    unsigned long k, sends = 0, hits = 0;
+    MACAddress_t mac, got, want;
+    eARPLookupResult_t result;
+    uint32_t ip, r;
+    int peer, i;
+
+    for(k = 0; k < operations; k++)
+    {
+        r = rnd(0xFFFFFFFFu);
+        peer = pick_peer(peers);
+        ip = peer_ip(peer);
+
+        if(r % 8 < 3)
+        {
+            /* A packet from the peer, rarely with a new network card */
+            if(r % 65536 < 16)
+                generation[peer]++;
+            peer_mac(peer, &mac);
+            vARPRefreshCacheEntry(&mac, ip);
+            model_refresh(&mac, ip);
+        }
+        else if(r % 8 < 7)
+        {
+            /* A packet to the peer */
+            uint32_t lookup = ip;
+
+            result = eARPGetCacheEntry(&lookup, &got);
+            sends++;
+            checks++;
+            if(result == eARPCacheHit)
+            {
+                hits++;
+                peer_mac(peer, &mac);
+                if(memcmp(&got, &mac, sizeof(mac)) != 0)
+                    fail("a hit gave a MAC address the peer does not have", k);
+            }
+#if( ipconfigUSE_ARP_HASH_TABLE != 0 )
+            if(result != model_lookup(ip, &want) || (result == eARPCacheHit && memcmp(&got, &want, sizeof(got)) != 0))
+                fail("eARPGetCacheEntry() differs from the model", k);
+#endif
+            if(result == eARPCacheMiss)
+            {
+                vARPRefreshCacheEntry(NULL, ip);
+                model_refresh(NULL, ip);
+            }
+        }
+        else if(r % 65536 < 256)
+        {
+            vARPAgeCache();
+            model_age();
+        }
+        else if(r % 1048576 == 0x7FFF)
+        {
+            FreeRTOS_ClearARP();
+            model_count = 0;
+        }
+    }
+
+#if( ipconfigUSE_ARP_HASH_TABLE != 0 )
+    for(i = 0; i < model_count; i++)
+    {
+        ip = model[i].ip;
+        checks++;
+        if(eARPGetCacheEntry(&ip, &got) != (model[i].valid ? eARPCacheHit : eCantSendPacket))
+            fail("an entry of the model was not found", k);
+    }
+#else
+    (void) i;
+    (void) want;
+#endif
+
+    printf("ipconfigUSE_ARP_HASH_TABLE %d, %d entries, %d peers: %lu operations, hit rate %.1f%%\n",
+           ipconfigUSE_ARP_HASH_TABLE, ENTRIES, peers, operations, 100.0 * hits / sends);
+}
+
+static double elapsed_ns(const struct timespec *t0)
+{
+    struct timespec t1;
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return (t1.tv_sec - t0->tv_sec) * 1e9 + (t1.tv_nsec - t0->tv_nsec);
+}
+
+static void benchmark(unsigned long iterations)
+{
+    static uint32_t order[ENTRIES];
+    volatile int sink = 0;
+    struct timespec t0;
+    MACAddress_t mac;
+    unsigned long j;
+    uint32_t base;
+    int i;
+
+    FreeRTOS_ClearARP();
+    memset(&mac, 0x02, sizeof(mac));
+    for(i = 0; i < ENTRIES; i++)
+    {
+        order[i] = peer_ip(i);
+        vARPRefreshCacheEntry(&mac, order[i]);
+    }
+    for(i = ENTRIES - 1; i > 0; i--)
+    {
+        int k = (int) rnd((uint32_t) i + 1);
+        uint32_t t = order[i];
+
+        order[i] = order[k];
+        order[k] = t;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for(j = 0; j < iterations; j++)
+    {
+        uint32_t ip = order[j % ENTRIES];
+
+        sink += eARPGetCacheEntry(&ip, &mac);
+    }
+    printf("lookup:  %.1f ns\n", elapsed_ns(&t0) / iterations);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for(j = 0; j < iterations; j++)
+        vARPRefreshCacheEntry(&mac, order[j % ENTRIES]);
+    printf("refresh: %.1f ns\n", elapsed_ns(&t0) / iterations);
+
+    base = LOCAL_IP + 1u + ENTRIES;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for(j = 0; j < iterations; j++)
+        vARPRefreshCacheEntry(&mac, FreeRTOS_htonl(0x0A000000u | (base + (uint32_t) j) % 0x00FFFFFEu));
+    printf("insert:  %.1f ns\n", elapsed_ns(&t0) / iterations);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long operations = 3000000, iterations = 2000000;
+    int peers = 1000, i;
+
+    for(i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+            peers = atoi(argv[++i]);
+        else if(strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            operations = strtoul(argv[++i], NULL, 0);
+        else if(strcmp(argv[i], "-i") == 0 && i + 1 < argc)
+            iterations = strtoul(argv[++i], NULL, 0);
+        else
+            peers = 0;
+    }
+    if(peers <= 0 || peers > 1000000 || iterations == 0)
+    {
+        fprintf(stderr, "usage: arpcache [-p peers] [-n operations] [-i calls]\n");
+        return 2;
+    }
+
+    generation = calloc((size_t) peers, 1);
+    *ipLOCAL_IP_ADDRESS_POINTER = FreeRTOS_htonl(LOCAL_IP);
+    xNetworkAddressing.ulNetMask = FreeRTOS_htonl(0xFF000000u);
+    xNetworkAddressing.ulBroadcastAddress = FreeRTOS_htonl(0x0AFFFFFFu);
+    FreeRTOS_ClearARP();
+
+    replay(peers, operations);
+    benchmark(iterations);
+    printf("%lu checks, %lu failures\n", checks, failures);
+
+    return failures != 0;
+}
@@ -0,0 +1,346 @@
+/** @file arppending.c
+ *
+ * @brief Host side test of the packets FreeRTOS+TCP holds while it resolves
+ * an address
+ *
+ * @par
+ * Sends UDP packets through the real vProcessGeneratedUDPPacket() and
+ * answers the ARP requests with eARPProcessPacket(), on a simulated clock of
+ * one tick per millisecond. First measures the time to the first byte to a
+ * cold peer: the ARP reply comes after a delay, and if the packet was lost the
+ * application sends it again after its own time-out. With
+ * ipconfigARP_PENDING_PACKETS the packet must leave as soon as the reply is
+ * in, after a single ARP request.
+ *
+ * @par
+ * With ipconfigARP_PENDING_PACKETS it then checks the bound per address and
+ * the total bound, that the held packets of a peer leave in the order they
+ * were sent, that they are dropped after ipconfigARP_PENDING_TIMEOUT_MS and
+ * when the network goes down, that a reply wakes up the connecting TCP sockets
+ * once, and the counters of vARPGetPendingCounters(). Every packet that goes
+ * out must have a correct UDP checksum and the MAC address of the peer, and
+ * every network buffer must be released.
+ *
+ * @par
+ * Built by the Makefile in this directory with the held packets of the TCP
+ * Echo Server (arppending) and without (arppending_off):
+ *
+ *     make arppending arppending_off
+ *     ./arppending -d 50 -r 3000
+ *
+ *     -d  ticks before the ARP reply comes in (default 1)
+ *     -r  ticks before the application sends again (default 1000)
+ *
+ * @par
+ * The exit status is 1 if a check failed.
+ *
+ * @author
+ * Carlos Santos
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "FreeRTOS_IP.h"
+#include "FreeRTOS_IP_Private.h"
+#include "FreeRTOS_ARP.h"
+#include "FreeRTOS_Sockets.h"
+
+#define CORRECT_CRC     0xFFFFu         /* ipCORRECT_CRC of FreeRTOS_IP.c */
+#define LOCAL_IP        0xC0A80002u     /* 192.168.0.2/24 */
+#define PAYLOAD_LENGTH  32
+#define NEVER           ((TickType_t) -1)
+
+static const MACAddress_t peer_mac = { { 0x02, 0x00, 0x00, 0x00, 0x00, 0x42 } };
+
+static TickType_t tick_count, timer_due;
+static BaseType_t timer_active;
+static unsigned long allocated, released, arp_out, udp_out, wake_ups;
+static TickType_t first_byte;
+static uint8_t order[64];
+static int order_count;
+static unsigned long checks, failures;
+
+/* The kernel and IP-task functions the sources call */
+void *pvPortMalloc(size_t xSize) { return malloc(xSize); }
+void vPortFree(void *pv) { free(pv); }
+TickType_t xTaskGetTickCount(void) { return tick_count; }
+void vTCPWakeUpConnectingSockets(void) { wake_ups++; }
+
+/* The ARP timer of the IP-task, with -Wl,--wrap: vARPCheckPendingPackets()
+ * runs in the tick it expires */
+void __wrap_vIPReloadARPPendingTimer(TickType_t xTime)
+{
+    timer_due = tick_count + xTime;
+    timer_active = pdTRUE;
+}
+
+void __wrap_vIPSetARPPendingTimerEnableState(BaseType_t xEnableState)
+{
+    timer_active = xEnableState;
+}
+
+NetworkBufferDescriptor_t *pxGetNetworkBufferWithDescriptor(size_t xRequestedSizeBytes, TickType_t xBlockTimeTicks)
+{
+    NetworkBufferDescriptor_t *buffer = calloc(1, sizeof(*buffer));
+    uint8_t *data = calloc(1, ipconfigNETWORK_MTU + ipSIZE_OF_ETH_HEADER + ipBUFFER_PADDING);
+
+    (void) xBlockTimeTicks;
+    if(buffer == NULL || data == NULL)
+    {
+        perror("arppending");
+        exit(2);
+    }
+    buffer->pucEthernetBuffer = data + ipBUFFER_PADDING;
+    buffer->xDataLength = xRequestedSizeBytes;
+    allocated++;
+    return buffer;
+}
+
+void vReleaseNetworkBufferAndDescriptor(NetworkBufferDescriptor_t * const pxNetworkBuffer)
+{
+    free(pxNetworkBuffer->pucEthernetBuffer - ipBUFFER_PADDING);
+    free(pxNetworkBuffer);
+    released++;
+}
+
+static void fail(const char *what)
+{
+    if(failures++ < 10)
+        printf("%s\n", what);
+}
+
+static void check(int ok, const char *what)
+{
+    checks++;
+    if(!ok)
+        fail(what);
+}
+
+/* The wire: records the ARP requests, and the time, order and correctness of
+ * the UDP packets */
+BaseType_t xNetworkInterfaceOutput(NetworkBufferDescriptor_t * const pxNetworkBuffer, BaseType_t xReleaseAfterSend)
+{
+    uint8_t *frame = pxNetworkBuffer->pucEthernetBuffer;
+    EthernetHeader_t *ethernet = (EthernetHeader_t *) frame;
+
+    if(ethernet->usFrameType == ipARP_FRAME_TYPE)
+        arp_out++;
+    else
+    {
+        udp_out++;
+        if(first_byte == NEVER)
+            first_byte = tick_count;
+        check(memcmp(ethernet->xDestinationAddress.ucBytes, peer_mac.ucBytes, sizeof(peer_mac)) == 0,
+              "a packet went out to the wrong MAC address");
+        check(usGenerateProtocolChecksum(frame, pxNetworkBuffer->xDataLength, pdFALSE) == CORRECT_CRC,
+              "a packet went out with a wrong checksum");
+        if(order_count < (int) sizeof(order))
+            order[order_count++] = frame[ipUDP_PAYLOAD_OFFSET_IPv4];
+    }
+    if(xReleaseAfterSend != pdFALSE)
+        vReleaseNetworkBufferAndDescriptor(pxNetworkBuffer);
+    return pdPASS;
+}
+
+static uint32_t peer_ip(int peer)
+{
+    return FreeRTOS_htonl(LOCAL_IP + 8u + (uint32_t) peer);
+}
+
+/* A packet from a UDP socket with checksums, as FreeRTOS_sendto() passes it
+ * to the IP-task, of which every payload byte is tag */
+static void send_udp(uint32_t ip, uint8_t tag)
+{
+    NetworkBufferDescriptor_t *buffer = pxGetNetworkBufferWithDescriptor(PAYLOAD_LENGTH, 0);
+
+    buffer->usPort = FreeRTOS_htons(7);
+    buffer->usBoundPort = FreeRTOS_htons(5000);
+    buffer->ulIPAddress = ip;
+    memset(buffer->pucEthernetBuffer + ipUDP_PAYLOAD_OFFSET_IPv4, tag, PAYLOAD_LENGTH);
+    buffer->pucEthernetBuffer[ipSOCKET_OPTIONS_OFFSET] = FREERTOS_SO_UDPCKSUM_OUT;
+    vProcessGeneratedUDPPacket(buffer);
+}
+
+static void arp_reply(uint32_t ip)
+{
+    ARPPacket_t packet;
+
+    memset(&packet, 0, sizeof(packet));
+    packet.xARPHeader.usHardwareType = ipARP_HARDWARE_TYPE_ETHERNET;
+    packet.xARPHeader.usProtocolType = ipARP_PROTOCOL_TYPE;
+    packet.xARPHeader.ucHardwareAddressLength = ipMAC_ADDRESS_LENGTH_BYTES;
+    packet.xARPHeader.ucProtocolAddressLength = ipIP_ADDRESS_LENGTH_BYTES;
+    packet.xARPHeader.usOperation = ipARP_REPLY;
+    packet.xARPHeader.xSenderHardwareAddress = peer_mac;
+    memcpy(packet.xARPHeader.ucSenderProtocolAddress, &ip, sizeof(ip));
+    packet.xARPHeader.ulTargetProtocolAddress = *ipLOCAL_IP_ADDRESS_POINTER;
+    eARPProcessPacket(&packet);
+}
+
+static void run_until(TickType_t end)
+{
+    while(tick_count != end)
+    {
+        tick_count++;
+        if(timer_active != pdFALSE && tick_count == timer_due)
+        {
+            timer_active = pdFALSE;
+#if( ipconfigARP_PENDING_PACKETS != 0 )
+            vARPCheckPendingPackets();
+#endif
+        }
+    }
+}
+
+static void reset(void)
+{
+    FreeRTOS_ClearARP();
+    first_byte = NEVER;
+    arp_out = udp_out = 0;
+    order_count = 0;
+}
+
+#if( ipconfigARP_PENDING_PACKETS != 0 )
+
+static ARPPendingCounters_t counters(void)
+{
+    ARPPendingCounters_t c;
+
+    vARPGetPendingCounters(&c);
+    return c;
+}
+
+/* More packets than can be held, to one peer and to several */
+static void test_bounds(void)
+{
+    ARPPendingCounters_t before = counters(), after;
+    int i;
+
+    reset();
+    for(i = 0; i < ipconfigARP_PENDING_PACKETS_PER_ADDRESS + 1; i++)
+        send_udp(peer_ip(1), (uint8_t) (10 + i));
+    for(i = 0; i < ipconfigARP_PENDING_PACKETS; i++)
+        send_udp(peer_ip(2 + i), (uint8_t) (20 + i));
+    after = counters();
+    check(after.ulHeld - before.ulHeld == ipconfigARP_PENDING_PACKETS,
+          "the queue did not fill up");
+    check(after.ulRejected - before.ulRejected == 1 + ipconfigARP_PENDING_PACKETS_PER_ADDRESS,
+          "the packets beyond the bounds were not rejected");
+    check(udp_out == 0, "a packet went out before the ARP reply");
+
+    arp_reply(peer_ip(1));
+    check(order_count == ipconfigARP_PENDING_PACKETS_PER_ADDRESS, "the held packets did not go out");
+    for(i = 0; i < order_count; i++)
+        check(order[i] == 10 + i, "the held packets went out in the wrong order");
+
+    for(i = 0; i < ipconfigARP_PENDING_PACKETS - ipconfigARP_PENDING_PACKETS_PER_ADDRESS; i++)
+        arp_reply(peer_ip(2 + i));
+    after = counters();
+    check(after.ulSent - before.ulSent == ipconfigARP_PENDING_PACKETS, "the held packets were not all sent");
+}
+
+/* No reply comes, or the network goes down */
+static void test_drop(void)
+{
+    ARPPendingCounters_t before = counters(), after;
+
+    reset();
+    send_udp(peer_ip(9), 30);
+    send_udp(peer_ip(9), 31);
+    run_until(tick_count + pdMS_TO_TICKS(ipconfigARP_PENDING_TIMEOUT_MS) - 1);
+    after = counters();
+    check(after.ulDropped == before.ulDropped, "the held packets were dropped early");
+    run_until(tick_count + 1);
+    after = counters();
+    check(after.ulDropped - before.ulDropped == 2, "the held packets were not dropped in time");
+    check(timer_active == pdFALSE, "the timer still runs with no packets held");
+    arp_reply(peer_ip(9));
+    check(udp_out == 0, "a dropped packet went out");
+
+    send_udp(peer_ip(8), 40);
+    FreeRTOS_ClearARP();
+    arp_reply(peer_ip(8));
+    check(udp_out == 0, "a packet went out after the network went down");
+    check(timer_active == pdFALSE, "the timer still runs after the network went down");
+}
+
+/* Two TCP sockets connect to a cold peer */
+static void test_connect(void)
+{
+    unsigned long before = wake_ups;
+    uint32_t ip = peer_ip(7);
+    MACAddress_t mac;
+
+    reset();
+    eARPGetCacheEntry(&ip, &mac);
+    check(xARPHoldPacket(NULL, ip) == pdTRUE, "the first connecting socket was not registered");
+    check(xARPHoldPacket(NULL, ip) == pdFALSE, "the second connecting socket was registered");
+    arp_reply(ip);
+    check(wake_ups == before + 1, "the connecting sockets were not woken up once");
+}
+
+#endif /* ipconfigARP_PENDING_PACKETS */
+
+int main(int argc, char **argv)
+{
+    TickType_t reply_delay = 1, retry = 1000, start;
+    int i;
+
+    for(i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+            reply_delay = (TickType_t) strtoul(argv[++i], NULL, 0);
+        else if(strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+            retry = (TickType_t) strtoul(argv[++i], NULL, 0);
+        else
+            retry = 0;
+    }
+    if(retry == 0 || reply_delay >= retry)
+    {
+        fprintf(stderr, "usage: arppending [-d reply delay] [-r retry]\n");
+        return 2;
+    }
+
+    *ipLOCAL_IP_ADDRESS_POINTER = FreeRTOS_htonl(LOCAL_IP);
+    xNetworkAddressing.ulNetMask = FreeRTOS_htonl(0xFFFFFF00u);
+    xNetworkAddressing.ulBroadcastAddress = FreeRTOS_htonl(LOCAL_IP | 0xFFu);
+
+    reset();
+    tick_count = start = 1000;
+    send_udp(peer_ip(0), 1);
+    run_until(start + reply_delay);
+    arp_reply(peer_ip(0));
+    if(first_byte == NEVER)
+    {
+        run_until(start + retry);
+        send_udp(peer_ip(0), 1);
+    }
+    check(first_byte != NEVER, "the packet to the cold peer never went out");
+    printf("ipconfigARP_PENDING_PACKETS %d: ARP reply after %lu ms, application retry after %lu ms\n",
+           ipconfigARP_PENDING_PACKETS, (unsigned long) reply_delay, (unsigned long) retry);
+    printf("first byte to a cold peer after %lu ms, %lu ARP requests\n",
+           (unsigned long) (first_byte - start), arp_out);
+#if( ipconfigARP_PENDING_PACKETS != 0 )
+    check(first_byte - start == reply_delay, "the packet did not go out with the ARP reply");
+    check(arp_out == 1, "more than one ARP request went out");
+
+    test_bounds();
+    test_drop();
+    test_connect();
+    {
+        ARPPendingCounters_t c = counters();
+
+        printf("held %lu, sent %lu, dropped %lu, rejected %lu\n",
+               (unsigned long) c.ulHeld, (unsigned long) c.ulSent,
+               (unsigned long) c.ulDropped, (unsigned long) c.ulRejected);
+    }
+#endif
+
+    check(allocated == released, "network buffers were not released");
+    printf("%lu network buffers, %lu checks, %lu failures\n", allocated, checks, failures);
+    return failures != 0;
+}
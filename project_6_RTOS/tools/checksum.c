@@ -0,0 +1,167 @@
+/** @file checksum.c
+ *
+ * @brief Host side test and benchmark of the checksum of FreeRTOS+TCP
+ *
+ * @par
+ * Checks usGenerateChecksum() against a byte by byte sum of 16-bit words
+ * for every length from 0 to 4096 bytes at every start offset from 0 to 7,
+ * so that each odd, half word and word alignment of the start and the end is
+ * covered, with a different initial sum for each length. The data are random
+ * bytes, all 0xFF (the most carries) and alternating 0x00 and 0xFF. Lengths
+ * up to 65535, the largest IP packet, check that the 32-bit accumulator folds
+ * in time. It then times the checksum of a packet of the usual sizes: an IP
+ * header, a small, a 576 byte and a full Ethernet frame, a jumbo frame and a
+ * 64 KB datagram.
+ *
+ * @par
+ * Built by the Makefile in this directory with each value of
+ * ipconfigCHECKSUM_ACCUMULATOR_BITS: the original implementation (checksum0)
+ * and the 32-bit (checksum32) and 64-bit (checksum64) accumulators:
+ *
+ *     make checksum0 checksum32 checksum64
+ *     ./checksum32
+ *
+ *     -b  bytes summed per packet size when timing (default 200000000)
+ *
+ * @par
+ * The numbers of a 64-bit host do not carry over to the PIC32MX, a 32-bit
+ * CPU without add-with-carry, for which the TCP Echo Server uses 32.
+ *
+ * @par
+ * The exit status is 1 if any checksum differed from the reference.
+ *
+ * @author
+ * Carlos Santos
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "FreeRTOS_IP.h"
+#include "FreeRTOS_IP_Private.h"
+
+#define MAX_LENGTH      65535
+#define MAX_OFFSET      8
+
+static uint8_t data[MAX_LENGTH + MAX_OFFSET] __attribute__((aligned(64)));
+static uint32_t rng_state = 1;
+static unsigned long checks, failures;
+
+static uint32_t rnd(uint32_t n)
+{
+    /* xorshift32 */
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state % n;
+}
+
+/* The sum as RFC 1071 gives it: 16-bit words in network order, added up
+ * with end around carry. As in the stack, the words are those of the memory,
+ * the byte at an even address is the high one, and the sum is swapped when
+ * the data start at an odd address; the initial sum is added as it is. */
+static uint16_t reference_checksum(uint32_t sum, const uint8_t *p, size_t len)
+{
+    size_t i;
+
+    for(i = 0; i < len; i++)
+    {
+        if(((uintptr_t) (p + i) & 1) == 0)
+            sum += (uint32_t) p[i] << 8;
+        else
+            sum += p[i];
+        sum = (sum & 0xFFFFu) + (sum >> 16);
+    }
+    if((uintptr_t) p & 1)
+        sum = (sum & 0xFFu) << 8 | sum >> 8;
+    return (uint16_t) sum;
+}
+
+static void check(uint32_t sum, int offset, size_t len)
+{
+    uint16_t got = usGenerateChecksum(sum, data + offset, len);
+    uint16_t expected = reference_checksum(sum, data + offset, len);
+
+    checks++;
+    if(got != expected && failures++ < 10)
+        printf("offset %d, length %lu, sum %04lx: got %04x, expected %04x\n",
+               offset, (unsigned long) len, (unsigned long) sum, got, expected);
+}
+
+static void fill(int pattern)
+{
+    size_t i;
+
+    for(i = 0; i < sizeof(data); i++)
+    {
+        if(pattern == 0)
+            data[i] = (uint8_t) rnd(256);
+        else if(pattern == 1)
+            data[i] = 0xFF;
+        else
+            data[i] = (i & 1) ? 0xFF : 0x00;
+    }
+}
+
+static double elapsed_ns(const struct timespec *t0)
+{
+    struct timespec t1;
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return (t1.tv_sec - t0->tv_sec) * 1e9 + (t1.tv_nsec - t0->tv_nsec);
+}
+
+int main(int argc, char **argv)
+{
+    static const size_t sizes[] = { 20, 64, 576, 1460, 9000, 65000 };
+    unsigned long bytes = 200000000, n, j;
+    volatile uint16_t sink = 0;
+    struct timespec t0;
+    int pattern, offset, i;
+    size_t len;
+
+    for(i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+            bytes = strtoul(argv[++i], NULL, 0);
+        else
+            bytes = 0;
+    }
+    if(bytes == 0)
+    {
+        fprintf(stderr, "usage: checksum [-b bytes]\n");
+        return 2;
+    }
+
+    for(pattern = 0; pattern < 3; pattern++)
+    {
+        fill(pattern);
+        for(offset = 0; offset < MAX_OFFSET; offset++)
+        {
+            for(len = 0; len <= 4096; len++)
+                check((uint32_t) (len * 7919u) & 0xFFFFu, offset, len);
+            for(len = 60000; len <= MAX_LENGTH; len += 1 + rnd(97))
+                check(0xFFFFu, offset, len);
+            check(0xFFFFu, offset, MAX_LENGTH);
+        }
+    }
+    printf("ipconfigCHECKSUM_ACCUMULATOR_BITS %d: %lu checks, %lu failures\n",
+           ipconfigCHECKSUM_ACCUMULATOR_BITS, checks, failures);
+
+    fill(0);
+    printf("length   GB/s\n");
+    for(i = 0; i < (int) (sizeof(sizes) / sizeof(sizes[0])); i++)
+    {
+        n = bytes / sizes[i] + 1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        for(j = 0; j < n; j++)
+            sink += usGenerateChecksum(0, data, sizes[i]);
+        printf("%6lu %6.2f\n", (unsigned long) sizes[i], (double) sizes[i] * n / elapsed_ns(&t0));
+    }
+
+    return failures != 0;
+}
@@ -0,0 +1,539 @@
+/** @file dnscache.c
+ *
+ * @brief Host side test of the DNS replies FreeRTOS+TCP accepts, and benchmark
+ * of the cache
+ *
+ * @par
+ * Looks up names with the real FreeRTOS_gethostbyname(), of which the socket
+ * is answered by a simulated DNS server, and feeds replies that come in on a
+ * port without a socket straight to ulDNSHandlePacket(), as the IP-task does.
+ * A reply must only be read when it answers a request of this node: it must
+ * come from the DNS server, carry the identifier of the request and come in on
+ * the port the request was sent from. The test checks that a blocking look-up
+ * ignores a reply of another host, that unsolicited answers and NXDOMAIN
+ * replies, from the server or from another host, neither fill the cache nor
+ * pin a name as non-existent, and that a reply that is not a response, or too
+ * short, is dropped.
+ *
+ * @par
+ * With ipconfigUSE_DNS_CACHE_HASH it also lets vDNSCheckCache() refresh a
+ * name before it expires. Replies to the refresh with the wrong source, the
+ * wrong identifier or the wrong port must be dropped, the right one must renew
+ * the entry, and a replay of it must be dropped as well.
+ *
+ * @par
+ * It then times FreeRTOS_dnslookup() of a cached name, the rejection of a
+ * forged reply, and with every entry of the cache in use, look-ups of each
+ * name in turn and of a name that is not cached. Build it with other values
+ * of ipconfigDNS_CACHE_ENTRIES to find the size from which the hash is faster.
+ *
+ * @par
+ * Built by the Makefile in this directory with the hashed cache of the TCP
+ * Echo Server (dnscache) and the original linear cache (dnscache_linear):
+ *
+ *     make dnscache dnscache_linear
+ *     ./dnscache -i 1000000
+ *     make -B dnscache dnscache_linear ENTRIES=32
+ *
+ *     -i  iterations of each timed operation (default 10000000)
+ *
+ * @par
+ * The exit status is 1 if a check failed.
+ *
+ * @author
+ * Carlos Santos
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "event_groups.h"
+#include "FreeRTOS_IP.h"
+#include "FreeRTOS_IP_Private.h"
+#include "FreeRTOS_Sockets.h"
+#include "FreeRTOS_DNS.h"
+
+#define LOCAL_IP        0xC0A80002u     /* 192.168.0.2/24 */
+#define SERVER_IP       0xC0A80001u     /* the DNS server */
+#define FORGER_IP       0xC0A80066u     /* another host on the link */
+#define DNS_PORT        53
+#define SERVER_TTL      80u             /* refreshed after 70 seconds */
+#define MAX_MESSAGE     512
+
+typedef struct
+{
+    uint32_t ip;
+    uint16_t port;
+    uint16_t id;
+} Request_t;
+
+static TickType_t tick_count;
+static uint32_t server_generation = 1;
+static uint32_t reply_source = SERVER_IP;
+static unsigned long queries, refreshes, allocated, released;
+static Request_t refresh;
+static uint8_t query[MAX_MESSAGE];
+static size_t query_length;
+static uint32_t rng_state = 1;
+static unsigned long checks, failures;
+
+static uint32_t rnd(uint32_t n)
+{
+    /* xorshift32 */
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state % n;
+}
+
+/* The kernel and IP-task functions the sources call */
+void *pvPortMalloc(size_t xSize) { return malloc(xSize); }
+void vPortFree(void *pv) { free(pv); }
+TickType_t xTaskGetTickCount(void) { return tick_count; }
+void vTaskSuspendAll(void) { }
+BaseType_t xTaskResumeAll(void) { return pdFALSE; }
+EventGroupHandle_t xEventGroupCreate(void) { return NULL; }
+void vEventGroupDelete(EventGroupHandle_t xEventGroup) { (void) xEventGroup; }
+EventBits_t xEventGroupSetBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToSet) { (void) xEventGroup; return uxBitsToSet; }
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToWaitFor, const BaseType_t xClearOnExit, const BaseType_t xWaitForAllBits, TickType_t xTicksToWait) { (void) xEventGroup; (void) xClearOnExit; (void) xWaitForAllBits; (void) xTicksToWait; return uxBitsToWaitFor; }
+UBaseType_t uxRand(void) { return rnd(0xFFFFFFFFu); }
+BaseType_t xIsCallingFromIPTask(void) { return pdTRUE; }
+BaseType_t xSendEventStructToIPTask(const IPStackEvent_t *pxEvent, TickType_t xTimeout) { (void) pxEvent; (void) xTimeout; return pdFAIL; }
+FreeRTOS_Socket_t *pxUDPSocketLookup(UBaseType_t uxLocalPort) { (void) uxLocalPort; return NULL; }
+void vIPSetDNSCacheTimerEnableState(BaseType_t xEnableState) { (void) xEnableState; }
+void vIPReloadDNSCacheTimer(uint32_t ulCheckTime) { (void) ulCheckTime; }
+uint32_t FreeRTOS_GetDNSServerAddress(void) { return FreeRTOS_htonl(SERVER_IP); }
+uint32_t FreeRTOS_inet_addr(const char *pcIPAddress) { (void) pcIPAddress; return 0; }
+
+void FreeRTOS_GetAddressConfiguration(uint32_t *pulIPAddress, uint32_t *pulNetMask, uint32_t *pulGatewayAddress, uint32_t *pulDNSServerAddress)
+{
+    (void) pulIPAddress;
+    (void) pulNetMask;
+    (void) pulGatewayAddress;
+    *pulDNSServerAddress = FreeRTOS_htonl(SERVER_IP);
+}
+
+NetworkBufferDescriptor_t *pxGetNetworkBufferWithDescriptor(size_t xRequestedSizeBytes, TickType_t xBlockTimeTicks)
+{
+    NetworkBufferDescriptor_t *buffer = calloc(1, sizeof(*buffer));
+    uint8_t *data = calloc(1, ipconfigNETWORK_MTU + ipSIZE_OF_ETH_HEADER + ipBUFFER_PADDING);
+
+    (void) xBlockTimeTicks;
+    if(buffer == NULL || data == NULL)
+    {
+        perror("dnscache");
+        exit(2);
+    }
+    buffer->pucEthernetBuffer = data + ipBUFFER_PADDING;
+    buffer->xDataLength = xRequestedSizeBytes;
+    allocated++;
+    return buffer;
+}
+
+void vReleaseNetworkBufferAndDescriptor(NetworkBufferDescriptor_t * const pxNetworkBuffer)
+{
+    free(pxNetworkBuffer->pucEthernetBuffer - ipBUFFER_PADDING);
+    free(pxNetworkBuffer);
+    released++;
+}
+
+static void fail(const char *what)
+{
+    if(failures++ < 10)
+        printf("%s\n", what);
+}
+
+static void check(int ok, const char *what)
+{
+    checks++;
+    if(!ok)
+        fail(what);
+}
+
+/* A query as prvCreateDNSMessage() writes it: for an A record of name */
+static size_t make_query(uint8_t *p, const char *name, uint16_t id)
+{
+    size_t n = 12, label;
+    const char *dot;
+
+    memset(p, 0, 12);
+    memcpy(p, &id, 2);
+    p[2] = 0x01;
+    p[5] = 1;
+    for(;;)
+    {
+        dot = strchr(name, '.');
+        label = dot ? (size_t) (dot - name) : strlen(name);
+        p[n++] = (uint8_t) label;
+        memcpy(p + n, name, label);
+        n += label;
+        if(dot == NULL)
+            break;
+        name = dot + 1;
+    }
+    p[n++] = 0;
+    p[n++] = 0; p[n++] = 1;
+    p[n++] = 0; p[n++] = 1;
+    return n;
+}
+
+static void put32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t) (v >> 24);
+    p[1] = (uint8_t) (v >> 16);
+    p[2] = (uint8_t) (v >> 8);
+    p[3] = (uint8_t) v;
+}
+
+/* The DNS server: "hN.test" is 10.<generation>.0.N for SERVER_TTL seconds,
+ * any "nx..." name does not exist, with a SOA record of MINIMUM 20 */
+static size_t make_reply(uint8_t *p, const uint8_t *request, size_t length, int nxdomain)
+{
+    size_t n = length;
+    const uint8_t *name = request + 12;
+
+    memmove(p, request, length);
+    if(name[0] >= 2 && name[1] == 'n' && name[2] == 'x')
+        nxdomain = 1;
+    p[2] = 0x81;
+    p[3] = nxdomain ? 0x83 : 0x80;
+    if(nxdomain)
+    {
+        p[9] = 1;
+        p[n++] = 0xC0; p[n++] = 12;
+        p[n++] = 0; p[n++] = 6;
+        p[n++] = 0; p[n++] = 1;
+        put32(p + n, 3600); n += 4;
+        p[n++] = 0; p[n++] = 22;
+        p[n++] = 0;
+        p[n++] = 0;
+        put32(p + n, 1); n += 4;
+        put32(p + n, 7200); n += 4;
+        put32(p + n, 900); n += 4;
+        put32(p + n, 86400); n += 4;
+        put32(p + n, 20); n += 4;
+    }
+    else
+    {
+        p[7] = 1;
+        p[n++] = 0xC0; p[n++] = 12;
+        p[n++] = 0; p[n++] = 1;
+        p[n++] = 0; p[n++] = 1;
+        put32(p + n, SERVER_TTL); n += 4;
+        p[n++] = 0; p[n++] = 4;
+        p[n++] = 10;
+        p[n++] = (uint8_t) server_generation;
+        p[n++] = 0;
+        p[n++] = (uint8_t) atoi((const char *) name + 2);
+    }
+    return n;
+}
+
+static uint32_t address(int n)
+{
+    return FreeRTOS_htonl(0x0A000000u | server_generation << 16 | (uint32_t) n);
+}
+
+/* The socket of prvGetHostByName(): the server answers each query at once,
+ * from reply_source */
+Socket_t FreeRTOS_socket(BaseType_t xDomain, BaseType_t xType, BaseType_t xProtocol)
+{
+    (void) xDomain;
+    (void) xType;
+    (void) xProtocol;
+    return calloc(1, sizeof(FreeRTOS_Socket_t));
+}
+
+BaseType_t FreeRTOS_bind(Socket_t xSocket, struct freertos_sockaddr *pxAddress, socklen_t xAddressLength)
+{
+    (void) pxAddress;
+    (void) xAddressLength;
+    ((FreeRTOS_Socket_t *) xSocket)->usLocalPort = (uint16_t) (0xC000u | rnd(0x4000u));
+    return 0;
+}
+
+BaseType_t FreeRTOS_setsockopt(Socket_t xSocket, int32_t lLevel, int32_t lOptionName, const void *pvOptionValue, size_t xOptionLength)
+{
+    (void) xSocket;
+    (void) lLevel;
+    (void) lOptionName;
+    (void) pvOptionValue;
+    (void) xOptionLength;
+    return 0;
+}
+
+BaseType_t FreeRTOS_closesocket(Socket_t xSocket)
+{
+    free(xSocket);
+    return 1;
+}
+
+void *FreeRTOS_GetUDPPayloadBuffer(size_t xRequestedSizeBytes, TickType_t xBlockTimeTicks)
+{
+    NetworkBufferDescriptor_t *buffer = pxGetNetworkBufferWithDescriptor(xRequestedSizeBytes + sizeof(UDPPacket_t), xBlockTimeTicks);
+
+    memcpy(buffer->pucEthernetBuffer, &buffer, sizeof(buffer));
+    return buffer->pucEthernetBuffer + ipUDP_PAYLOAD_OFFSET_IPv4;
+}
+
+void FreeRTOS_ReleaseUDPPayloadBuffer(void *pvBuffer)
+{
+    NetworkBufferDescriptor_t *buffer;
+
+    memcpy(&buffer, (const uint8_t *) pvBuffer - ipUDP_PAYLOAD_OFFSET_IPv4, sizeof(buffer));
+    vReleaseNetworkBufferAndDescriptor(buffer);
+}
+
+int32_t FreeRTOS_sendto(Socket_t xSocket, const void *pvBuffer, size_t xTotalDataLength, BaseType_t xFlags, const struct freertos_sockaddr *pxDestinationAddress, socklen_t xDestinationAddressLength)
+{
+    (void) xSocket;
+    (void) xFlags;
+    (void) xDestinationAddressLength;
+    check(pxDestinationAddress->sin_addr == FreeRTOS_htonl(SERVER_IP) && pxDestinationAddress->sin_port == FreeRTOS_htons(DNS_PORT),
+          "a query was not sent to the DNS server");
+    query_length = xTotalDataLength < sizeof(query) ? xTotalDataLength : sizeof(query);
+    memcpy(query, pvBuffer, query_length);
+    queries++;
+    FreeRTOS_ReleaseUDPPayloadBuffer((void *) pvBuffer);
+    return (int32_t) xTotalDataLength;
+}
+
+int32_t FreeRTOS_recvfrom(Socket_t xSocket, void *pvBuffer, size_t xBufferLength, BaseType_t xFlags, struct freertos_sockaddr *pxSourceAddress, socklen_t *pxSourceAddressLength)
+{
+    uint8_t *payload = FreeRTOS_GetUDPPayloadBuffer(MAX_MESSAGE, 0);
+
+    (void) xSocket;
+    (void) xBufferLength;
+    (void) xFlags;
+    (void) pxSourceAddressLength;
+    *(uint8_t **) pvBuffer = payload;
+    pxSourceAddress->sin_addr = FreeRTOS_htonl(reply_source);
+    pxSourceAddress->sin_port = FreeRTOS_htons(DNS_PORT);
+    return (int32_t) make_reply(payload, query, query_length, 0);
+}
+
+/* The refresh requests of vDNSCheckCache(), sent without a socket */
+void vProcessGeneratedUDPPacket(NetworkBufferDescriptor_t * const pxNetworkBuffer)
+{
+    uint8_t *payload = pxNetworkBuffer->pucEthernetBuffer + ipUDP_PAYLOAD_OFFSET_IPv4;
+
+    check(pxNetworkBuffer->ulIPAddress == FreeRTOS_htonl(SERVER_IP) && pxNetworkBuffer->usPort == FreeRTOS_htons(DNS_PORT),
+          "a refresh was not sent to the DNS server");
+    refresh.ip = pxNetworkBuffer->ulIPAddress;
+    refresh.port = pxNetworkBuffer->usBoundPort;
+    memcpy(&refresh.id, payload, sizeof(refresh.id));
+    query_length = pxNetworkBuffer->xDataLength < sizeof(query) ? pxNetworkBuffer->xDataLength : sizeof(query);
+    memcpy(query, payload, query_length);
+    refreshes++;
+    vReleaseNetworkBufferAndDescriptor(pxNetworkBuffer);
+}
+
+/* A UDP packet that came in on a port without a socket, as
+ * prvProcessReceivedUDPPacket() passes it to ulDNSHandlePacket() */
+static uint32_t receive(uint32_t source, uint16_t source_port, uint16_t port, const uint8_t *message, size_t length)
+{
+    NetworkBufferDescriptor_t *buffer = pxGetNetworkBufferWithDescriptor(sizeof(UDPPacket_t) + length, 0);
+    UDPPacket_t *packet = (UDPPacket_t *) buffer->pucEthernetBuffer;
+    uint32_t result;
+
+    packet->xIPHeader.ulSourceIPAddress = FreeRTOS_htonl(source);
+    packet->xIPHeader.ulDestinationIPAddress = FreeRTOS_htonl(LOCAL_IP);
+    packet->xUDPHeader.usSourcePort = FreeRTOS_htons(source_port);
+    packet->xUDPHeader.usDestinationPort = port;
+    memcpy(buffer->pucEthernetBuffer + sizeof(UDPPacket_t), message, length);
+    result = ulDNSHandlePacket(buffer);
+    vReleaseNetworkBufferAndDescriptor(buffer);
+    return result;
+}
+
+/* A reply for name that nobody asked for */
+static uint32_t forge(uint32_t source, const char *name, int nxdomain)
+{
+    uint8_t request[MAX_MESSAGE], reply[MAX_MESSAGE];
+    size_t length = make_query(request, name, (uint16_t) rnd(0x10000u));
+
+    length = make_reply(reply, request, length, nxdomain);
+    return receive(source, DNS_PORT, FreeRTOS_htons((uint16_t) (0xC000u | rnd(0x4000u))), reply, length);
+}
+
+static void test_lookup(void)
+{
+    unsigned long before = queries;
+
+    check(FreeRTOS_gethostbyname("h1.test") == address(1), "a name was not resolved");
+    check(queries - before == 1, "a look-up did not send one query");
+    check(FreeRTOS_gethostbyname("h1.test") == address(1), "a cached name was not resolved");
+    check(FreeRTOS_dnslookup("h1.test") == address(1), "a name was not cached");
+    check(queries - before == 1, "a cached name was asked again");
+}
+
+/* The reply to the socket of a blocking look-up comes from another host */
+static void test_other_host(void)
+{
+    unsigned long before = queries;
+
+    reply_source = FORGER_IP;
+    check(FreeRTOS_gethostbyname("h2.test") == 0, "a reply of another host was accepted");
+    reply_source = SERVER_IP;
+    check(queries - before == ipconfigDNS_REQUEST_ATTEMPTS, "the look-up did not ask again");
+    check(FreeRTOS_dnslookup("h2.test") == 0, "a reply of another host was cached");
+    check(FreeRTOS_gethostbyname("h2.test") == address(2), "the name was not resolved afterwards");
+}
+
+/* Answers that nobody asked for, on a port without a socket */
+static void test_forged(void)
+{
+    uint8_t message[MAX_MESSAGE];
+    size_t length;
+    unsigned long before;
+
+    check(forge(SERVER_IP, "h3.test", 0) == pdFAIL, "an unsolicited answer of the server was read");
+    check(forge(FORGER_IP, "h3.test", 0) == pdFAIL, "an unsolicited answer of another host was read");
+    check(FreeRTOS_dnslookup("h3.test") == 0, "an unsolicited answer was cached");
+
+    check(forge(SERVER_IP, "h1.test", 1) == pdFAIL, "an unsolicited NXDOMAIN of the server was read");
+    check(forge(FORGER_IP, "h1.test", 1) == pdFAIL, "an unsolicited NXDOMAIN of another host was read");
+    check(FreeRTOS_dnslookup("h1.test") == address(1), "an unsolicited NXDOMAIN removed a cached name");
+
+    check(forge(SERVER_IP, "h4.test", 1) == pdFAIL, "an unsolicited NXDOMAIN was read");
+    before = queries;
+    check(FreeRTOS_gethostbyname("h4.test") == address(4), "an unsolicited NXDOMAIN was cached");
+    check(queries - before == 1, "the name was not asked after an unsolicited NXDOMAIN");
+
+    /* A query from port 53 is not a reply, and a truncated message is not
+     * read at all */
+    length = make_query(message, "h5.test", 0x1234);
+    check(receive(SERVER_IP, DNS_PORT, FreeRTOS_htons(0xC123), message, length) == pdFAIL, "a query from port 53 was read");
+    length = make_reply(message, message, length, 0);
+    check(receive(SERVER_IP, DNS_PORT, FreeRTOS_htons(0xC123), message, 11) == pdFAIL, "a truncated reply was read");
+    check(FreeRTOS_dnslookup("h5.test") == 0, "a query or a truncated reply was cached");
+}
+
+#if( ipconfigUSE_DNS_CACHE_HASH != 0 )
+
+/* A refresh of h1.test by vDNSCheckCache(), and the replies to it */
+static void test_refresh(void)
+{
+    uint8_t reply[MAX_MESSAGE];
+    size_t length;
+    uint32_t old = address(1);
+
+    refreshes = 0;
+    tick_count += (SERVER_TTL - SERVER_TTL / 8) * configTICK_RATE_HZ;
+    check(FreeRTOS_dnslookup("h1.test") == old, "the name expired before its refresh");
+    vDNSCheckCache();
+    check(refreshes == 1, "the name was not refreshed");
+    if(refreshes != 1)
+        return;
+    check(refresh.port != FreeRTOS_htons(DNS_PORT) && refresh.port != 0, "the refresh was sent from a wrong port");
+
+    server_generation = 2;
+    length = make_reply(reply, query, query_length, 0);
+    check(receive(FORGER_IP, DNS_PORT, refresh.port, reply, length) == pdFAIL, "a refresh reply of another host was read");
+    reply[0] ^= 0x5A;
+    check(receive(SERVER_IP, DNS_PORT, refresh.port, reply, length) == pdFAIL, "a refresh reply with a wrong identifier was read");
+    reply[0] ^= 0x5A;
+    check(receive(SERVER_IP, DNS_PORT, refresh.port ^ FreeRTOS_htons(1), reply, length) == pdFAIL, "a refresh reply on a wrong port was read");
+    length = make_reply(reply, query, query_length, 1);
+    check(receive(SERVER_IP, DNS_PORT, refresh.port ^ FreeRTOS_htons(1), reply, length) == pdFAIL, "a NXDOMAIN on a wrong port was read");
+    check(FreeRTOS_dnslookup("h1.test") == old, "a forged refresh reply changed the cache");
+
+    length = make_reply(reply, query, query_length, 0);
+    receive(SERVER_IP, DNS_PORT, refresh.port, reply, length);
+    check(FreeRTOS_dnslookup("h1.test") == address(1), "the refresh reply was not read");
+
+    server_generation = 3;
+    length = make_reply(reply, query, query_length, 0);
+    check(receive(SERVER_IP, DNS_PORT, refresh.port, reply, length) == pdFAIL, "a replay of the refresh reply was read");
+    server_generation = 2;
+    tick_count += 2 * SERVER_TTL / 8 * configTICK_RATE_HZ;
+    check(FreeRTOS_dnslookup("h1.test") == address(1), "the refresh did not renew the name");
+}
+
+#endif /* ipconfigUSE_DNS_CACHE_HASH */
+
+static double elapsed_ns(const struct timespec *t0)
+{
+    struct timespec t1;
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return (t1.tv_sec - t0->tv_sec) * 1e9 + (t1.tv_nsec - t0->tv_nsec);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long iterations = 10000000, j;
+    uint8_t reply[MAX_MESSAGE];
+    size_t length;
+    volatile uint32_t sink = 0;
+    struct timespec t0;
+    char names[ipconfigDNS_CACHE_ENTRIES][24];
+    int i, found;
+
+    for(i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-i") == 0 && i + 1 < argc)
+            iterations = strtoul(argv[++i], NULL, 0);
+        else
+            iterations = 0;
+    }
+    if(iterations == 0)
+    {
+        fprintf(stderr, "usage: dnscache [-i iterations]\n");
+        return 2;
+    }
+
+    tick_count = 1000;
+    test_lookup();
+    test_other_host();
+    test_forged();
+#if( ipconfigUSE_DNS_CACHE_HASH != 0 )
+    test_refresh();
+#endif
+    check(allocated == released, "a network buffer was not released");
+    printf("ipconfigUSE_DNS_CACHE_HASH %d: %lu checks, %lu failures\n",
+           ipconfigUSE_DNS_CACHE_HASH, checks, failures);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for(j = 0; j < iterations; j++)
+        sink += FreeRTOS_dnslookup("h1.test");
+    printf("cached look-up  %6.1f ns\n", elapsed_ns(&t0) / iterations);
+
+    length = make_query(reply, "h3.test", 0x1234);
+    length = make_reply(reply, reply, length, 0);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for(j = 0; j < iterations; j++)
+        sink += receive(SERVER_IP, DNS_PORT, FreeRTOS_htons(0xC123), reply, length);
+    printf("forged reply    %6.1f ns\n", elapsed_ns(&t0) / iterations);
+
+    /* "cN.example.com" is 10.<generation>.0.N, like "hN.test" */
+    found = 0;
+    for(i = 0; i < ipconfigDNS_CACHE_ENTRIES; i++)
+    {
+        sprintf(names[i], "c%d.example.com", i + 1);
+        FreeRTOS_gethostbyname(names[i]);
+    }
+    for(i = 0; i < ipconfigDNS_CACHE_ENTRIES; i++)
+        found += FreeRTOS_dnslookup(names[i]) != 0;
+    check(found == ipconfigDNS_CACHE_ENTRIES, "a name of a full cache was not found");
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for(j = 0, i = 0; j < iterations; j++)
+    {
+        sink += FreeRTOS_dnslookup(names[i]);
+        if(++i == ipconfigDNS_CACHE_ENTRIES)
+            i = 0;
+    }
+    printf("full cache      %6.1f ns (%d names)\n", elapsed_ns(&t0) / iterations, ipconfigDNS_CACHE_ENTRIES);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for(j = 0; j < iterations; j++)
+        sink += FreeRTOS_dnslookup("c0.example.com");
+    printf("not cached      %6.1f ns\n", elapsed_ns(&t0) / iterations);
+
+    return failures != 0;
+}
@@ -0,0 +1,425 @@
+/** @file dnscallback.c
+ *
+ * @brief Host side test of the DNS look-ups with a call-back of FreeRTOS+TCP
+ *
+ * @par
+ * Starts look-ups with the real FreeRTOS_gethostbyname_a() from an
+ * application task, and runs the DNS timer of the IP-task on a simulated clock
+ * of one tick per millisecond. With ipconfigDNS_COALESCE_REQUESTS the requests
+ * are sent without a socket, by the IP-task only: the application task must
+ * not send anything nor look in the socket tables, but post eDNSTimerEvent.
+ * All attempts of a look-up must be sent from the same port, with the same
+ * identifier, to the DNS server. Without it the request is sent from a socket
+ * that is closed before the reply comes in.
+ *
+ * @par
+ * The replies come in on a port without a socket and are fed to
+ * ulDNSHandlePacket(), as the IP-task does. A reply from another host, with a
+ * wrong identifier or on a wrong port must be dropped without calling the
+ * call-back, the right one must call it once with the address, and a replay
+ * must be dropped. A look-up without an answer must call the call-back with
+ * zero after its time-out. Every network buffer must be released.
+ *
+ * @par
+ * Built by the Makefile in this directory with the coalesced look-ups of the
+ * TCP Echo Server (dnscallback) and without (dnscallback_single):
+ *
+ *     make dnscallback dnscallback_single
+ *     ./dnscallback
+ *
+ * @par
+ * The exit status is 1 if a check failed.
+ *
+ * @author
+ * Carlos Santos
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "event_groups.h"
+#include "FreeRTOS_IP.h"
+#include "FreeRTOS_IP_Private.h"
+#include "FreeRTOS_Sockets.h"
+#include "FreeRTOS_DNS.h"
+
+#define LOCAL_IP        0xC0A80002u     /* 192.168.0.2/24 */
+#define SERVER_IP       0xC0A80001u     /* the DNS server */
+#define FORGER_IP       0xC0A80066u     /* another host on the link */
+#define DNS_PORT        53
+#define TIMEOUT_MS      10000u
+#define MAX_MESSAGE     512
+
+typedef struct
+{
+    uint16_t port;
+    uint16_t id;
+} Request_t;
+
+static TickType_t tick_count;
+static BaseType_t in_ip_task, dns_timer_active;
+static unsigned long sent, events, allocated, released;
+static Request_t request;
+static BaseType_t ports_differ;
+static uint8_t query[MAX_MESSAGE];
+static size_t query_length;
+static uint32_t answer;
+static unsigned long answers;
+static uint32_t rng_state = 1;
+static unsigned long checks, failures;
+
+static uint32_t rnd(uint32_t n)
+{
+    /* xorshift32 */
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state % n;
+}
+
+static void fail(const char *what)
+{
+    if(failures++ < 10)
+        printf("%s\n", what);
+}
+
+static void check(int ok, const char *what)
+{
+    checks++;
+    if(!ok)
+        fail(what);
+}
+
+/* The kernel and IP-task functions the sources call */
+void *pvPortMalloc(size_t xSize) { return malloc(xSize); }
+void vPortFree(void *pv) { free(pv); }
+TickType_t xTaskGetTickCount(void) { return tick_count; }
+void vTaskSuspendAll(void) { }
+BaseType_t xTaskResumeAll(void) { return pdFALSE; }
+EventGroupHandle_t xEventGroupCreate(void) { return NULL; }
+void vEventGroupDelete(EventGroupHandle_t xEventGroup) { (void) xEventGroup; }
+EventBits_t xEventGroupSetBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToSet) { (void) xEventGroup; return uxBitsToSet; }
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToWaitFor, const BaseType_t xClearOnExit, const BaseType_t xWaitForAllBits, TickType_t xTicksToWait) { (void) xEventGroup; (void) xClearOnExit; (void) xWaitForAllBits; (void) xTicksToWait; return uxBitsToWaitFor; }
+UBaseType_t uxRand(void) { return rnd(0xFFFFFFFFu); }
+BaseType_t xIsCallingFromIPTask(void) { return in_ip_task; }
+BaseType_t xSendEventStructToIPTask(const IPStackEvent_t *pxEvent, TickType_t xTimeout) { (void) pxEvent; (void) xTimeout; return pdFAIL; }
+void vIPSetDNSCacheTimerEnableState(BaseType_t xEnableState) { (void) xEnableState; }
+void vIPReloadDNSCacheTimer(uint32_t ulCheckTime) { (void) ulCheckTime; }
+void vIPReloadDNSTimer(uint32_t ulCheckTime) { (void) ulCheckTime; dns_timer_active = pdTRUE; }
+void vIPSetDnsTimerEnableState(BaseType_t xEnableState) { dns_timer_active = xEnableState; }
+uint32_t FreeRTOS_GetDNSServerAddress(void) { return FreeRTOS_htonl(SERVER_IP); }
+uint32_t FreeRTOS_inet_addr(const char *pcIPAddress) { (void) pcIPAddress; return 0; }
+
+void vTaskSetTimeOutState(TimeOut_t * const pxTimeOut)
+{
+    pxTimeOut->xOverflowCount = 0;
+    pxTimeOut->xTimeOnEntering = tick_count;
+}
+
+BaseType_t xTaskCheckForTimeOut(TimeOut_t * const pxTimeOut, TickType_t * const pxTicksToWait)
+{
+    TickType_t elapsed = tick_count - pxTimeOut->xTimeOnEntering;
+
+    if(elapsed >= *pxTicksToWait)
+    {
+        *pxTicksToWait = 0;
+        return pdTRUE;
+    }
+    *pxTicksToWait -= elapsed;
+    pxTimeOut->xTimeOnEntering = tick_count;
+    return pdFALSE;
+}
+
+/* Only the IP-task owns the socket tables */
+FreeRTOS_Socket_t *pxUDPSocketLookup(UBaseType_t uxLocalPort)
+{
+    (void) uxLocalPort;
+    check(in_ip_task != pdFALSE, "an application task looked in the socket tables");
+    return NULL;
+}
+
+BaseType_t xSendEventToIPTask(eIPEvent_t eEvent)
+{
+    check(eEvent == eDNSTimerEvent, "an unexpected event was sent to the IP-task");
+    events++;
+    return pdPASS;
+}
+
+void FreeRTOS_GetAddressConfiguration(uint32_t *pulIPAddress, uint32_t *pulNetMask, uint32_t *pulGatewayAddress, uint32_t *pulDNSServerAddress)
+{
+    (void) pulIPAddress;
+    (void) pulNetMask;
+    (void) pulGatewayAddress;
+    *pulDNSServerAddress = FreeRTOS_htonl(SERVER_IP);
+}
+
+NetworkBufferDescriptor_t *pxGetNetworkBufferWithDescriptor(size_t xRequestedSizeBytes, TickType_t xBlockTimeTicks)
+{
+    NetworkBufferDescriptor_t *buffer = calloc(1, sizeof(*buffer));
+    uint8_t *data = calloc(1, ipconfigNETWORK_MTU + ipSIZE_OF_ETH_HEADER + ipBUFFER_PADDING);
+
+    (void) xBlockTimeTicks;
+    if(buffer == NULL || data == NULL)
+    {
+        perror("dnscallback");
+        exit(2);
+    }
+    buffer->pucEthernetBuffer = data + ipBUFFER_PADDING;
+    buffer->xDataLength = xRequestedSizeBytes;
+    allocated++;
+    return buffer;
+}
+
+void vReleaseNetworkBufferAndDescriptor(NetworkBufferDescriptor_t * const pxNetworkBuffer)
+{
+    free(pxNetworkBuffer->pucEthernetBuffer - ipBUFFER_PADDING);
+    free(pxNetworkBuffer);
+    released++;
+}
+
+/* Every attempt of a look-up goes to the DNS server, and must come from the
+ * same port with the same identifier as the first */
+static void record(uint16_t port, const uint8_t *payload, size_t length)
+{
+    Request_t r;
+
+    r.port = port;
+    memcpy(&r.id, payload, sizeof(r.id));
+    if(sent != 0 && (r.port != request.port || r.id != request.id))
+        ports_differ = pdTRUE;
+    request = r;
+    query_length = length < sizeof(query) ? length : sizeof(query);
+    memcpy(query, payload, query_length);
+    sent++;
+}
+
+/* The requests sent without a socket */
+void vProcessGeneratedUDPPacket(NetworkBufferDescriptor_t * const pxNetworkBuffer)
+{
+    check(in_ip_task != pdFALSE, "an application task sent a request without a socket");
+    check(pxNetworkBuffer->ulIPAddress == FreeRTOS_htonl(SERVER_IP) && pxNetworkBuffer->usPort == FreeRTOS_htons(DNS_PORT),
+          "a request was not sent to the DNS server");
+    record(pxNetworkBuffer->usBoundPort, pxNetworkBuffer->pucEthernetBuffer + ipUDP_PAYLOAD_OFFSET_IPv4, pxNetworkBuffer->xDataLength);
+    vReleaseNetworkBufferAndDescriptor(pxNetworkBuffer);
+}
+
+/* The socket of prvGetHostByName(), closed before the reply comes in */
+Socket_t FreeRTOS_socket(BaseType_t xDomain, BaseType_t xType, BaseType_t xProtocol)
+{
+    (void) xDomain;
+    (void) xType;
+    (void) xProtocol;
+    return calloc(1, sizeof(FreeRTOS_Socket_t));
+}
+
+BaseType_t FreeRTOS_bind(Socket_t xSocket, struct freertos_sockaddr *pxAddress, socklen_t xAddressLength)
+{
+    (void) pxAddress;
+    (void) xAddressLength;
+    ((FreeRTOS_Socket_t *) xSocket)->usLocalPort = (uint16_t) (0xC000u | rnd(0x4000u));
+    return 0;
+}
+
+BaseType_t FreeRTOS_setsockopt(Socket_t xSocket, int32_t lLevel, int32_t lOptionName, const void *pvOptionValue, size_t xOptionLength)
+{
+    (void) xSocket;
+    (void) lLevel;
+    (void) lOptionName;
+    (void) pvOptionValue;
+    (void) xOptionLength;
+    return 0;
+}
+
+BaseType_t FreeRTOS_closesocket(Socket_t xSocket)
+{
+    free(xSocket);
+    return 1;
+}
+
+void *FreeRTOS_GetUDPPayloadBuffer(size_t xRequestedSizeBytes, TickType_t xBlockTimeTicks)
+{
+    NetworkBufferDescriptor_t *buffer = pxGetNetworkBufferWithDescriptor(xRequestedSizeBytes + sizeof(UDPPacket_t), xBlockTimeTicks);
+
+    memcpy(buffer->pucEthernetBuffer, &buffer, sizeof(buffer));
+    return buffer->pucEthernetBuffer + ipUDP_PAYLOAD_OFFSET_IPv4;
+}
+
+void FreeRTOS_ReleaseUDPPayloadBuffer(void *pvBuffer)
+{
+    NetworkBufferDescriptor_t *buffer;
+
+    memcpy(&buffer, (const uint8_t *) pvBuffer - ipUDP_PAYLOAD_OFFSET_IPv4, sizeof(buffer));
+    vReleaseNetworkBufferAndDescriptor(buffer);
+}
+
+int32_t FreeRTOS_sendto(Socket_t xSocket, const void *pvBuffer, size_t xTotalDataLength, BaseType_t xFlags, const struct freertos_sockaddr *pxDestinationAddress, socklen_t xDestinationAddressLength)
+{
+    (void) xFlags;
+    (void) xDestinationAddressLength;
+    check(pxDestinationAddress->sin_addr == FreeRTOS_htonl(SERVER_IP) && pxDestinationAddress->sin_port == FreeRTOS_htons(DNS_PORT),
+          "a request was not sent to the DNS server");
+    record(FreeRTOS_htons(((FreeRTOS_Socket_t *) xSocket)->usLocalPort), pvBuffer, xTotalDataLength);
+    FreeRTOS_ReleaseUDPPayloadBuffer((void *) pvBuffer);
+    return (int32_t) xTotalDataLength;
+}
+
+int32_t FreeRTOS_recvfrom(Socket_t xSocket, void *pvBuffer, size_t xBufferLength, BaseType_t xFlags, struct freertos_sockaddr *pxSourceAddress, socklen_t *pxSourceAddressLength)
+{
+    (void) xSocket;
+    (void) pvBuffer;
+    (void) xBufferLength;
+    (void) xFlags;
+    (void) pxSourceAddress;
+    (void) pxSourceAddressLength;
+    return 0;
+}
+
+/* The DNS functions of the IP-task */
+extern void vDNSInitialise(void);
+extern void vDNSCheckCallBack(void *pvSearchID);
+
+static void on_reply(const char *pcName, void *pvSearchID, uint32_t ulIPAddress)
+{
+    (void) pcName;
+    (void) pvSearchID;
+    answer = ulIPAddress;
+    answers++;
+}
+
+/* The answer of the DNS server to the last request: 10.0.0.1 for 300 s */
+static size_t make_reply(uint8_t *p, uint32_t address)
+{
+    static const uint8_t record[] = { 0xC0, 12, 0, 1, 0, 1, 0, 0, 0x01, 0x2C, 0, 4 };
+    size_t n = query_length;
+
+    memcpy(p, query, query_length);
+    p[2] = 0x81;
+    p[3] = 0x80;
+    p[7] = 1;
+    memcpy(p + n, record, sizeof(record));
+    n += sizeof(record);
+    memcpy(p + n, &address, sizeof(address));
+    return n + sizeof(address);
+}
+
+/* A UDP packet that came in on a port without a socket, as
+ * prvProcessReceivedUDPPacket() passes it to ulDNSHandlePacket() */
+static uint32_t receive(uint32_t source, uint16_t port, const uint8_t *message, size_t length)
+{
+    NetworkBufferDescriptor_t *buffer = pxGetNetworkBufferWithDescriptor(sizeof(UDPPacket_t) + length, 0);
+    UDPPacket_t *packet = (UDPPacket_t *) buffer->pucEthernetBuffer;
+    uint32_t result;
+
+    packet->xIPHeader.ulSourceIPAddress = FreeRTOS_htonl(source);
+    packet->xIPHeader.ulDestinationIPAddress = FreeRTOS_htonl(LOCAL_IP);
+    packet->xUDPHeader.usSourcePort = FreeRTOS_htons(DNS_PORT);
+    packet->xUDPHeader.usDestinationPort = port;
+    memcpy(buffer->pucEthernetBuffer + sizeof(UDPPacket_t), message, length);
+    in_ip_task = pdTRUE;
+    result = ulDNSHandlePacket(buffer);
+    in_ip_task = pdFALSE;
+    vReleaseNetworkBufferAndDescriptor(buffer);
+    return result;
+}
+
+/* The IP-task: handles the events, and runs the DNS timer for ms ticks */
+static void run_ip_task(TickType_t ms)
+{
+    TickType_t end = tick_count + ms;
+
+    in_ip_task = pdTRUE;
+    do
+    {
+        if(events != 0 || dns_timer_active != pdFALSE)
+        {
+            events = 0;
+            vDNSCheckCallBack(NULL);
+        }
+        if(tick_count != end)
+            tick_count++;
+    } while(tick_count != end);
+    in_ip_task = pdFALSE;
+}
+
+static void start(const char *name)
+{
+    sent = 0;
+    ports_differ = pdFALSE;
+    answers = 0;
+    answer = 0;
+    check(FreeRTOS_gethostbyname_a(name, on_reply, (void *) name, TIMEOUT_MS) == 0, "an unknown name was resolved at once");
+#if( ipconfigDNS_COALESCE_REQUESTS != 0 )
+    check(sent == 0, "an application task sent a request");
+    check(events == 1, "the IP-task was not asked to send the request");
+    run_ip_task(1);
+#endif
+    check(sent >= 1, "the request was not sent");
+}
+
+/* A look-up that is answered after a forged reply of each kind */
+static void test_reply(void)
+{
+    uint8_t reply[MAX_MESSAGE];
+    size_t length;
+    uint32_t address = FreeRTOS_htonl(0x0A000001u), forged = FreeRTOS_htonl(0x06060606u);
+
+    start("h1.test");
+    length = make_reply(reply, forged);
+    check(receive(FORGER_IP, request.port, reply, length) == pdFAIL, "a reply of another host was read");
+    reply[1] ^= 0x5A;
+    check(receive(SERVER_IP, request.port, reply, length) == pdFAIL, "a reply with a wrong identifier was read");
+    reply[1] ^= 0x5A;
+    check(receive(SERVER_IP, request.port ^ FreeRTOS_htons(1), reply, length) == pdFAIL, "a reply on a wrong port was read");
+    check(answers == 0, "a forged reply called the call-back");
+
+    length = make_reply(reply, address);
+    receive(SERVER_IP, request.port, reply, length);
+    check(answers == 1 && answer == address, "the reply did not call the call-back");
+    length = make_reply(reply, forged);
+    check(receive(SERVER_IP, request.port, reply, length) == pdFAIL, "a replay of the reply was read");
+    check(answers == 1, "a replay called the call-back");
+    check(FreeRTOS_dnslookup("h1.test") == address, "the reply was not cached");
+    run_ip_task(1000);
+}
+
+/* A look-up without an answer */
+static void test_timeout(void)
+{
+    uint8_t reply[MAX_MESSAGE];
+    size_t length;
+
+    start("h2.test");
+    run_ip_task(TIMEOUT_MS + 1000);
+#if( ipconfigDNS_COALESCE_REQUESTS != 0 )
+    check(sent == ipconfigDNS_REQUEST_ATTEMPTS, "the IP-task did not repeat the request");
+#endif
+    check(ports_differ == pdFALSE, "the attempts were sent from different ports or with different identifiers");
+    check(answers == 1 && answer == 0, "the call-back was not called after its time-out");
+    check(dns_timer_active == pdFALSE, "the DNS timer kept running");
+    length = make_reply(reply, FreeRTOS_htonl(0x0A000002u));
+    check(receive(SERVER_IP, request.port, reply, length) == pdFAIL, "a late reply was read");
+    check(answers == 1, "a late reply called the call-back");
+}
+
+int main(int argc, char **argv)
+{
+    (void) argv;
+    if(argc > 1)
+    {
+        fprintf(stderr, "usage: dnscallback\n");
+        return 2;
+    }
+
+    vDNSInitialise();
+    tick_count = 1000;
+    test_reply();
+    test_timeout();
+    check(allocated == released, "a network buffer was not released");
+    printf("ipconfigDNS_COALESCE_REQUESTS %d: %lu checks, %lu failures\n",
+           ipconfigDNS_COALESCE_REQUESTS, checks, failures);
+
+    return failures != 0;
+}
@@ -0,0 +1,1053 @@
+/** @file dnsconcurrent.c
+ *
+ * @brief Host side test of concurrent DNS look-ups of one name in FreeRTOS+TCP
+ *
+ * @par
+ * Runs the real FreeRTOS_gethostbyname() and FreeRTOS_gethostbyname_a() from
+ * N + M application tasks at the same moment, all for the same name, next to
+ * an IP-task that handles eDNSTimerEvent, runs the DNS timer and passes the
+ * replies that come in on a port without a socket to ulDNSHandlePacket().
+ * Every task is a thread: vTaskSuspendAll() takes a recursive mutex, an event
+ * group is a condition variable, and the tick is the millisecond of the real
+ * clock. A look-up starts in one of three ways: all callers at once, or one
+ * FreeRTOS_gethostbyname() caller (it then sends the requests from its own
+ * socket) or one call-back caller (the IP-task then sends them without a
+ * socket) first, and the others as soon as its request reached the server.
+ *
+ * @par
+ * The DNS server is a thread of the same process that answers each request
+ * after a delay, and counts the requests it got for each name. A reply goes
+ * to the socket bound to its port when there is one, else to the IP-task, as
+ * prvProcessReceivedUDPPacket() does. With ipconfigDNS_COALESCE_REQUESTS only
+ * one request of a name may reach the server, and every caller must get the
+ * address exactly once: a FreeRTOS_gethostbyname() caller as its return value,
+ * a call-back caller as one call of its call-back. The server does not answer
+ * some names: their callers must get zero exactly once, after the time-outs,
+ * and the server must have seen ipconfigDNS_REQUEST_ATTEMPTS requests. In the
+ * end every request, call-back, event group, socket and network buffer must
+ * have been freed. Prints the mean latency of each caller over the rounds.
+ * Replies without delay (-d 0) make the callers race with the reply: a caller
+ * that attaches to a look-up just before it is answered must get its result
+ * from that reply, one that comes just after it from the cache.
+ *
+ * @par
+ * Built by the Makefile in this directory with the coalesced look-ups of the
+ * TCP Echo Server (dnsconcurrent) and without (dnsconcurrent_single, which
+ * only reports the number of requests), with two attempts of 500 ms:
+ *
+ *     make dnsconcurrent dnsconcurrent_single
+ *     ./dnsconcurrent [-s sync_callers] [-a callback_callers] [-d delay_ms] [-r rounds]
+ *
+ * @par
+ * The exit status is 1 if a check failed.
+ *
+ * @author
+ * Carlos Santos
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "event_groups.h"
+#include "FreeRTOS_IP.h"
+#include "FreeRTOS_IP_Private.h"
+#include "FreeRTOS_Sockets.h"
+#include "FreeRTOS_DNS.h"
+
+#define LOCAL_IP        0xC0A80002u     /* 192.168.0.2/24 */
+#define SERVER_IP       0xC0A80001u     /* the DNS server */
+#define DNS_PORT        53
+#define TIMEOUT_MS      2500u           /* of the call-back callers */
+#define MAX_CALLERS     32
+#define MAX_ROUNDS      50
+#define MAX_MESSAGE     512
+#define HEADER_SIZE     12              /* of a DNS message */
+#define MAX_NAMES       ( 3 * MAX_ROUNDS + 2 )
+#define QUEUE_SIZE      256
+#define SOCKET_QUEUE    4
+
+/* The ways a look-up starts, and whether the server answers it */
+enum { AT_ONCE, SYNC_FIRST, CALLBACK_FIRST };
+
+typedef struct
+{
+    const char *label;
+    int start;
+    BaseType_t answered;
+} Scenario_t;
+
+static const Scenario_t scenarios[] =
+{
+    { "at once", AT_ONCE, pdTRUE },
+    { "sync first", SYNC_FIRST, pdTRUE },
+    { "call-back first", CALLBACK_FIRST, pdTRUE },
+    { "silent, sync first", SYNC_FIRST, pdFALSE },
+    { "silent, call-back first", CALLBACK_FIRST, pdFALSE },
+};
+#define SCENARIOS       ( sizeof(scenarios) / sizeof(scenarios[0]) )
+
+typedef struct
+{
+    pthread_t thread;
+    BaseType_t callback, go;
+    char name[32];
+    uint32_t result;
+    unsigned long results;      /* how often a result was given */
+    unsigned long long start_us, us;
+} Caller_t;
+
+typedef struct
+{
+    char name[32];
+    uint32_t address;           /* zero if the server does not answer */
+    unsigned long requests;
+} Name_t;
+
+typedef struct
+{
+    TickType_t due;
+    uint16_t port;
+    size_t length;
+    uint8_t message[MAX_MESSAGE];
+} Request_t;
+
+typedef struct
+{
+    FreeRTOS_Socket_t socket;   /* first, FreeRTOS_DNS.c reads usLocalPort */
+    BaseType_t open;
+    TickType_t receive_ms;
+    NetworkBufferDescriptor_t *queue[SOCKET_QUEUE];
+    unsigned count;
+    pthread_cond_t ready;
+} HostSocket_t;
+
+typedef struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    EventBits_t bits;
+} EventGroup_t;
+
+static struct timespec epoch;
+static __thread BaseType_t in_ip_task;
+static pthread_mutex_t kernel_lock, count_lock = PTHREAD_MUTEX_INITIALIZER, rng_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned long allocations, frees, allocated, released, groups, groups_deleted, dropped;
+static uint32_t rng_state = 1;
+static unsigned long checks, failures;
+
+/* The callers, and the server */
+static pthread_mutex_t caller_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t caller_wake;
+static Caller_t *runs[SCENARIOS][MAX_ROUNDS];
+static int sync_callers = 4, callback_callers = 4;
+static pthread_mutex_t server_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t server_wake;
+static Name_t names[MAX_NAMES];
+static int name_count;
+static Request_t requests[QUEUE_SIZE];
+static unsigned request_head, request_count;
+static TickType_t delay_ms = 20;
+static BaseType_t stopping;
+
+/* The sockets, and the IP-task with its DNS timer */
+static pthread_mutex_t net_lock = PTHREAD_MUTEX_INITIALIZER;
+static HostSocket_t sockets[2 * MAX_CALLERS];
+static unsigned long sockets_open;
+static pthread_mutex_t ip_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ip_wake;
+static NetworkBufferDescriptor_t *inbox[QUEUE_SIZE];
+static unsigned inbox_head, inbox_count;
+static BaseType_t dns_event, timer_active, timer_expired;
+static TickType_t timer_start, timer_period;
+
+static uint32_t rnd(uint32_t n)
+{
+    uint32_t r;
+
+    /* xorshift32 */
+    pthread_mutex_lock(&rng_lock);
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    r = rng_state % n;
+    pthread_mutex_unlock(&rng_lock);
+    return r;
+}
+
+static void fail(const char *what)
+{
+    if(failures++ < 10)
+        printf("%s\n", what);
+}
+
+static void check(int ok, const char *what)
+{
+    pthread_mutex_lock(&count_lock);
+    checks++;
+    if(!ok)
+        fail(what);
+    pthread_mutex_unlock(&count_lock);
+}
+
+static void count(unsigned long *counter)
+{
+    pthread_mutex_lock(&count_lock);
+    (*counter)++;
+    pthread_mutex_unlock(&count_lock);
+}
+
+static unsigned long long now_us(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (unsigned long long) (t.tv_sec - epoch.tv_sec) * 1000000u + t.tv_nsec / 1000 - epoch.tv_nsec / 1000;
+}
+
+static void init_cond(pthread_cond_t *cond)
+{
+    pthread_condattr_t attr;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+/* Waits on cond until it is signalled or the clock reaches us, returns
+ * ETIMEDOUT in the latter case */
+static int wait_until(pthread_cond_t *cond, pthread_mutex_t *lock, unsigned long long us)
+{
+    struct timespec t;
+
+    us += (unsigned long long) epoch.tv_sec * 1000000u + epoch.tv_nsec / 1000;
+    t.tv_sec = us / 1000000u;
+    t.tv_nsec = (long) (us % 1000000u) * 1000;
+    return pthread_cond_timedwait(cond, lock, &t);
+}
+
+/* The kernel functions the sources call */
+void *pvPortMalloc(size_t xSize) { count(&allocations); return malloc(xSize); }
+void vPortFree(void *pv) { count(&frees); free(pv); }
+TickType_t xTaskGetTickCount(void) { return (TickType_t) (now_us() / 1000u); }
+void vTaskSuspendAll(void) { pthread_mutex_lock(&kernel_lock); }
+BaseType_t xTaskResumeAll(void) { pthread_mutex_unlock(&kernel_lock); return pdFALSE; }
+UBaseType_t uxRand(void) { return rnd(0xFFFFFFFFu); }
+BaseType_t xIsCallingFromIPTask(void) { return in_ip_task; }
+BaseType_t xSendEventStructToIPTask(const IPStackEvent_t *pxEvent, TickType_t xTimeout) { (void) pxEvent; (void) xTimeout; return pdFAIL; }
+void vIPSetDNSCacheTimerEnableState(BaseType_t xEnableState) { (void) xEnableState; }
+void vIPReloadDNSCacheTimer(uint32_t ulCheckTime) { (void) ulCheckTime; }
+uint32_t FreeRTOS_GetDNSServerAddress(void) { return FreeRTOS_htonl(SERVER_IP); }
+uint32_t FreeRTOS_inet_addr(const char *pcIPAddress) { (void) pcIPAddress; return 0; }
+
+void vTaskSetTimeOutState(TimeOut_t * const pxTimeOut)
+{
+    pxTimeOut->xOverflowCount = 0;
+    pxTimeOut->xTimeOnEntering = xTaskGetTickCount();
+}
+
+BaseType_t xTaskCheckForTimeOut(TimeOut_t * const pxTimeOut, TickType_t * const pxTicksToWait)
+{
+    TickType_t now = xTaskGetTickCount(), elapsed = now - pxTimeOut->xTimeOnEntering;
+
+    if(elapsed >= *pxTicksToWait)
+    {
+        *pxTicksToWait = 0;
+        return pdTRUE;
+    }
+    *pxTicksToWait -= elapsed;
+    pxTimeOut->xTimeOnEntering = now;
+    return pdFALSE;
+}
+
+EventGroupHandle_t xEventGroupCreate(void)
+{
+    EventGroup_t *group = calloc(1, sizeof(*group));
+
+    if(group != NULL)
+    {
+        pthread_mutex_init(&group->lock, NULL);
+        init_cond(&group->cond);
+        count(&groups);
+    }
+    return (EventGroupHandle_t) group;
+}
+
+void vEventGroupDelete(EventGroupHandle_t xEventGroup)
+{
+    EventGroup_t *group = (EventGroup_t *) xEventGroup;
+
+    pthread_cond_destroy(&group->cond);
+    pthread_mutex_destroy(&group->lock);
+    free(group);
+    count(&groups_deleted);
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToSet)
+{
+    EventGroup_t *group = (EventGroup_t *) xEventGroup;
+    EventBits_t bits;
+
+    pthread_mutex_lock(&group->lock);
+    bits = group->bits |= uxBitsToSet;
+    pthread_cond_broadcast(&group->cond);
+    pthread_mutex_unlock(&group->lock);
+    return bits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToWaitFor, const BaseType_t xClearOnExit, const BaseType_t xWaitForAllBits, TickType_t xTicksToWait)
+{
+    EventGroup_t *group = (EventGroup_t *) xEventGroup;
+    unsigned long long until = now_us() + (unsigned long long) xTicksToWait * 1000u;
+    EventBits_t bits;
+
+    pthread_mutex_lock(&group->lock);
+    for(;;)
+    {
+        bits = group->bits & uxBitsToWaitFor;
+        if(xWaitForAllBits ? bits == uxBitsToWaitFor : bits != 0)
+        {
+            if(xClearOnExit)
+                group->bits &= ~uxBitsToWaitFor;
+            break;
+        }
+        if(xTicksToWait == portMAX_DELAY)
+            pthread_cond_wait(&group->cond, &group->lock);
+        else if(wait_until(&group->cond, &group->lock, until) == ETIMEDOUT)
+            break;
+    }
+    bits = group->bits;
+    pthread_mutex_unlock(&group->lock);
+    return bits;
+}
+
+NetworkBufferDescriptor_t *pxGetNetworkBufferWithDescriptor(size_t xRequestedSizeBytes, TickType_t xBlockTimeTicks)
+{
+    NetworkBufferDescriptor_t *buffer = calloc(1, sizeof(*buffer));
+    uint8_t *data = calloc(1, ipconfigNETWORK_MTU + ipSIZE_OF_ETH_HEADER + ipBUFFER_PADDING);
+
+    (void) xBlockTimeTicks;
+    if(buffer == NULL || data == NULL)
+    {
+        perror("dnsconcurrent");
+        exit(2);
+    }
+    buffer->pucEthernetBuffer = data + ipBUFFER_PADDING;
+    buffer->xDataLength = xRequestedSizeBytes;
+    /* For FreeRTOS_ReleaseUDPPayloadBuffer() */
+    memcpy(buffer->pucEthernetBuffer, &buffer, sizeof(buffer));
+    count(&allocated);
+    return buffer;
+}
+
+void vReleaseNetworkBufferAndDescriptor(NetworkBufferDescriptor_t * const pxNetworkBuffer)
+{
+    free(pxNetworkBuffer->pucEthernetBuffer - ipBUFFER_PADDING);
+    free(pxNetworkBuffer);
+    count(&released);
+}
+
+void *FreeRTOS_GetUDPPayloadBuffer(size_t xRequestedSizeBytes, TickType_t xBlockTimeTicks)
+{
+    NetworkBufferDescriptor_t *buffer = pxGetNetworkBufferWithDescriptor(xRequestedSizeBytes + sizeof(UDPPacket_t), xBlockTimeTicks);
+
+    return buffer->pucEthernetBuffer + ipUDP_PAYLOAD_OFFSET_IPv4;
+}
+
+void FreeRTOS_ReleaseUDPPayloadBuffer(void *pvBuffer)
+{
+    NetworkBufferDescriptor_t *buffer;
+
+    memcpy(&buffer, (const uint8_t *) pvBuffer - ipUDP_PAYLOAD_OFFSET_IPv4, sizeof(buffer));
+    vReleaseNetworkBufferAndDescriptor(buffer);
+}
+
+void FreeRTOS_GetAddressConfiguration(uint32_t *pulIPAddress, uint32_t *pulNetMask, uint32_t *pulGatewayAddress, uint32_t *pulDNSServerAddress)
+{
+    (void) pulIPAddress;
+    (void) pulNetMask;
+    (void) pulGatewayAddress;
+    *pulDNSServerAddress = FreeRTOS_htonl(SERVER_IP);
+}
+
+/* The DNS server: "a.b" from a request */
+static void request_name(const uint8_t *message, size_t length, char *name, size_t size)
+{
+    size_t i = HEADER_SIZE, n = 0, label;
+
+    while(i < length && message[i] != 0 && n + 1 < size)
+    {
+        label = message[i++];
+        if(n != 0)
+            name[n++] = '.';
+        while(label-- != 0 && i < length && n + 1 < size)
+            name[n++] = (char) message[i++];
+    }
+    name[n] = '\0';
+}
+
+/* Called with server_lock */
+static Name_t *find_name(const char *name)
+{
+    int i;
+
+    for(i = 0; i < name_count; i++)
+    {
+        if(strcmp(names[i].name, name) == 0)
+            return &names[i];
+    }
+    return NULL;
+}
+
+static void add_name(const char *name, uint32_t address)
+{
+    pthread_mutex_lock(&server_lock);
+    strcpy(names[name_count].name, name);
+    names[name_count].address = address;
+    names[name_count].requests = 0;
+    name_count++;
+    pthread_mutex_unlock(&server_lock);
+}
+
+static unsigned long name_requests(const char *name)
+{
+    unsigned long n;
+
+    pthread_mutex_lock(&server_lock);
+    n = find_name(name)->requests;
+    pthread_mutex_unlock(&server_lock);
+    return n;
+}
+
+/* A request that goes on the wire, from port (in network byte order) */
+static void send_request(uint16_t port, const uint8_t *message, size_t length)
+{
+    Request_t *request;
+    Name_t *name;
+    char text[sizeof(name->name)];
+
+    request_name(message, length, text, sizeof(text));
+    pthread_mutex_lock(&server_lock);
+    name = find_name(text);
+    check(name != NULL, "a request was sent for a name that nobody looks up");
+    if(name != NULL)
+        name->requests++;
+    if(request_count < QUEUE_SIZE)
+    {
+        request = &requests[(request_head + request_count++) % QUEUE_SIZE];
+        request->due = xTaskGetTickCount() + delay_ms;
+        request->port = port;
+        request->length = length < MAX_MESSAGE ? length : MAX_MESSAGE;
+        memcpy(request->message, message, request->length);
+    }
+    else
+    {
+        count(&dropped);
+    }
+    pthread_cond_broadcast(&server_wake);
+    pthread_mutex_unlock(&server_lock);
+}
+
+/* The answer to a request: the address for 300 s */
+static size_t make_reply(uint8_t *p, const Request_t *request, uint32_t address)
+{
+    static const uint8_t record[] = { 0xC0, 12, 0, 1, 0, 1, 0, 0, 0x01, 0x2C, 0, 4 };
+    size_t n = request->length;
+
+    memcpy(p, request->message, n);
+    p[2] = 0x81;
+    p[3] = 0x80;
+    p[7] = 1;
+    memcpy(p + n, record, sizeof(record));
+    n += sizeof(record);
+    memcpy(p + n, &address, sizeof(address));
+    return n + sizeof(address);
+}
+
+/* A reply to port goes to the socket bound to it, else to the IP-task */
+static void deliver(const Request_t *request, uint32_t address)
+{
+    NetworkBufferDescriptor_t *buffer = pxGetNetworkBufferWithDescriptor(sizeof(UDPPacket_t) + MAX_MESSAGE + 16, 0);
+    UDPPacket_t *packet = (UDPPacket_t *) buffer->pucEthernetBuffer;
+    HostSocket_t *socket = NULL;
+    size_t i;
+
+    packet->xIPHeader.ulSourceIPAddress = FreeRTOS_htonl(SERVER_IP);
+    packet->xIPHeader.ulDestinationIPAddress = FreeRTOS_htonl(LOCAL_IP);
+    packet->xUDPHeader.usSourcePort = FreeRTOS_htons(DNS_PORT);
+    packet->xUDPHeader.usDestinationPort = request->port;
+    buffer->xDataLength = sizeof(UDPPacket_t) + make_reply(buffer->pucEthernetBuffer + sizeof(UDPPacket_t), request, address);
+
+    pthread_mutex_lock(&net_lock);
+    for(i = 0; i < sizeof(sockets) / sizeof(sockets[0]); i++)
+    {
+        if(sockets[i].open && FreeRTOS_htons(sockets[i].socket.usLocalPort) == request->port)
+            socket = &sockets[i];
+    }
+    if(socket != NULL && socket->count < SOCKET_QUEUE)
+    {
+        socket->queue[socket->count++] = buffer;
+        pthread_cond_broadcast(&socket->ready);
+    }
+    else if(socket == NULL)
+    {
+        pthread_mutex_lock(&ip_lock);
+        if(inbox_count < QUEUE_SIZE)
+        {
+            inbox[(inbox_head + inbox_count++) % QUEUE_SIZE] = buffer;
+            pthread_cond_broadcast(&ip_wake);
+            buffer = NULL;
+        }
+        pthread_mutex_unlock(&ip_lock);
+        if(buffer != NULL)
+        {
+            count(&dropped);
+            vReleaseNetworkBufferAndDescriptor(buffer);
+        }
+    }
+    else
+    {
+        count(&dropped);
+        vReleaseNetworkBufferAndDescriptor(buffer);
+    }
+    pthread_mutex_unlock(&net_lock);
+}
+
+static void *dns_server(void *arg)
+{
+    Request_t request;
+    Name_t *name;
+    uint32_t address;
+    char text[sizeof(name->name)];
+
+    (void) arg;
+    pthread_mutex_lock(&server_lock);
+    for(;;)
+    {
+        if(request_count == 0)
+        {
+            if(stopping)
+                break;
+            pthread_cond_wait(&server_wake, &server_lock);
+            continue;
+        }
+        if((int32_t) (requests[request_head].due - xTaskGetTickCount()) > 0)
+        {
+            wait_until(&server_wake, &server_lock, (unsigned long long) requests[request_head].due * 1000u);
+            continue;
+        }
+        request = requests[request_head];
+        request_head = (request_head + 1) % QUEUE_SIZE;
+        request_count--;
+        request_name(request.message, request.length, text, sizeof(text));
+        name = find_name(text);
+        address = name != NULL ? name->address : 0;
+        pthread_mutex_unlock(&server_lock);
+        if(address != 0)
+            deliver(&request, address);
+        pthread_mutex_lock(&server_lock);
+    }
+    pthread_mutex_unlock(&server_lock);
+    return NULL;
+}
+
+/* The sockets of prvGetHostByName() */
+Socket_t FreeRTOS_socket(BaseType_t xDomain, BaseType_t xType, BaseType_t xProtocol)
+{
+    HostSocket_t *socket = NULL;
+    size_t i;
+
+    (void) xDomain;
+    (void) xType;
+    (void) xProtocol;
+    pthread_mutex_lock(&net_lock);
+    for(i = 0; i < sizeof(sockets) / sizeof(sockets[0]) && socket == NULL; i++)
+    {
+        if(!sockets[i].open)
+        {
+            socket = &sockets[i];
+            socket->open = pdTRUE;
+            socket->socket.usLocalPort = 0;
+            socket->receive_ms = portMAX_DELAY;
+            socket->count = 0;
+            sockets_open++;
+        }
+    }
+    pthread_mutex_unlock(&net_lock);
+    check(socket != NULL, "too many sockets are open");
+    return socket != NULL ? (Socket_t) socket : FREERTOS_INVALID_SOCKET;
+}
+
+/* Called with net_lock */
+static HostSocket_t *bound_socket(uint16_t port)
+{
+    size_t i;
+
+    for(i = 0; i < sizeof(sockets) / sizeof(sockets[0]); i++)
+    {
+        if(sockets[i].open && sockets[i].socket.usLocalPort == port)
+            return &sockets[i];
+    }
+    return NULL;
+}
+
+BaseType_t FreeRTOS_bind(Socket_t xSocket, struct freertos_sockaddr *pxAddress, socklen_t xAddressLength)
+{
+    uint16_t port;
+
+    (void) pxAddress;
+    (void) xAddressLength;
+    pthread_mutex_lock(&net_lock);
+    do
+    {
+        port = (uint16_t) (0xC000u | rnd(0x4000u));
+    } while(bound_socket(port) != NULL);
+    ((HostSocket_t *) xSocket)->socket.usLocalPort = port;
+    pthread_mutex_unlock(&net_lock);
+    return 0;
+}
+
+BaseType_t FreeRTOS_setsockopt(Socket_t xSocket, int32_t lLevel, int32_t lOptionName, const void *pvOptionValue, size_t xOptionLength)
+{
+    (void) lLevel;
+    (void) xOptionLength;
+    if(lOptionName == FREERTOS_SO_RCVTIMEO)
+        ((HostSocket_t *) xSocket)->receive_ms = *(const TickType_t *) pvOptionValue;
+    return 0;
+}
+
+BaseType_t FreeRTOS_closesocket(Socket_t xSocket)
+{
+    HostSocket_t *socket = (HostSocket_t *) xSocket;
+
+    pthread_mutex_lock(&net_lock);
+    while(socket->count != 0)
+        vReleaseNetworkBufferAndDescriptor(socket->queue[--socket->count]);
+    socket->open = pdFALSE;
+    sockets_open--;
+    pthread_mutex_unlock(&net_lock);
+    return 1;
+}
+
+int32_t FreeRTOS_sendto(Socket_t xSocket, const void *pvBuffer, size_t xTotalDataLength, BaseType_t xFlags, const struct freertos_sockaddr *pxDestinationAddress, socklen_t xDestinationAddressLength)
+{
+    (void) xDestinationAddressLength;
+    check(xFlags == FREERTOS_ZERO_COPY, "a request was not sent with zero copy");
+    check(in_ip_task == pdFALSE, "the IP-task sent a request from a socket");
+    check(pxDestinationAddress->sin_addr == FreeRTOS_htonl(SERVER_IP) && pxDestinationAddress->sin_port == FreeRTOS_htons(DNS_PORT),
+          "a request was not sent to the DNS server");
+    send_request(FreeRTOS_htons(((HostSocket_t *) xSocket)->socket.usLocalPort), pvBuffer, xTotalDataLength);
+    FreeRTOS_ReleaseUDPPayloadBuffer((void *) pvBuffer);
+    return (int32_t) xTotalDataLength;
+}
+
+int32_t FreeRTOS_recvfrom(Socket_t xSocket, void *pvBuffer, size_t xBufferLength, BaseType_t xFlags, struct freertos_sockaddr *pxSourceAddress, socklen_t *pxSourceAddressLength)
+{
+    HostSocket_t *socket = (HostSocket_t *) xSocket;
+    unsigned long long until = now_us() + (unsigned long long) socket->receive_ms * 1000u;
+    NetworkBufferDescriptor_t *buffer = NULL;
+    unsigned i;
+
+    (void) xBufferLength;
+    (void) pxSourceAddressLength;
+    check(xFlags == FREERTOS_ZERO_COPY, "a reply was not received with zero copy");
+    pthread_mutex_lock(&net_lock);
+    while(socket->count == 0 && socket->receive_ms != 0)
+    {
+        if(socket->receive_ms == portMAX_DELAY)
+            pthread_cond_wait(&socket->ready, &net_lock);
+        else if(wait_until(&socket->ready, &net_lock, until) == ETIMEDOUT)
+            break;
+    }
+    if(socket->count != 0)
+    {
+        buffer = socket->queue[0];
+        for(i = 1; i < socket->count; i++)
+            socket->queue[i - 1] = socket->queue[i];
+        socket->count--;
+    }
+    pthread_mutex_unlock(&net_lock);
+    if(buffer == NULL)
+        return -pdFREERTOS_ERRNO_EWOULDBLOCK;
+
+    *(uint8_t **) pvBuffer = buffer->pucEthernetBuffer + ipUDP_PAYLOAD_OFFSET_IPv4;
+    pxSourceAddress->sin_addr = FreeRTOS_htonl(SERVER_IP);
+    pxSourceAddress->sin_port = FreeRTOS_htons(DNS_PORT);
+    return (int32_t) (buffer->xDataLength - sizeof(UDPPacket_t));
+}
+
+/* Only the IP-task owns the socket tables, uxLocalPort is in network byte
+ * order */
+FreeRTOS_Socket_t *pxUDPSocketLookup(UBaseType_t uxLocalPort)
+{
+    HostSocket_t *socket;
+
+    check(in_ip_task != pdFALSE, "an application task looked in the socket tables");
+    pthread_mutex_lock(&net_lock);
+    socket = bound_socket(FreeRTOS_ntohs((uint16_t) uxLocalPort));
+    pthread_mutex_unlock(&net_lock);
+    return socket != NULL ? &socket->socket : NULL;
+}
+
+/* The requests sent without a socket */
+void vProcessGeneratedUDPPacket(NetworkBufferDescriptor_t * const pxNetworkBuffer)
+{
+    check(in_ip_task != pdFALSE, "an application task sent a request without a socket");
+    check(pxNetworkBuffer->ulIPAddress == FreeRTOS_htonl(SERVER_IP) && pxNetworkBuffer->usPort == FreeRTOS_htons(DNS_PORT),
+          "a request was not sent to the DNS server");
+    send_request(pxNetworkBuffer->usBoundPort, pxNetworkBuffer->pucEthernetBuffer + ipUDP_PAYLOAD_OFFSET_IPv4, pxNetworkBuffer->xDataLength);
+    vReleaseNetworkBufferAndDescriptor(pxNetworkBuffer);
+}
+
+/* The IP-task and its DNS timer, as prvIPTimerReload() and the handling of
+ * eDNSTimerEvent in prvIPTask() */
+extern void vDNSInitialise(void);
+extern void vDNSCheckCallBack(void *pvSearchID);
+
+void vIPReloadDNSTimer(uint32_t ulCheckTime)
+{
+    pthread_mutex_lock(&ip_lock);
+    timer_active = pdTRUE;
+    timer_start = xTaskGetTickCount();
+    timer_period = ulCheckTime;
+    pthread_cond_broadcast(&ip_wake);
+    pthread_mutex_unlock(&ip_lock);
+}
+
+void vIPSetDnsTimerEnableState(BaseType_t xEnableState)
+{
+    pthread_mutex_lock(&ip_lock);
+    timer_active = xEnableState;
+    pthread_mutex_unlock(&ip_lock);
+}
+
+BaseType_t xSendEventToIPTask(eIPEvent_t eEvent)
+{
+    check(eEvent == eDNSTimerEvent, "an unexpected event was sent to the IP-task");
+    check(in_ip_task == pdFALSE, "the IP-task sent an event to itself");
+    pthread_mutex_lock(&ip_lock);
+    dns_event = pdTRUE;
+    pthread_cond_broadcast(&ip_wake);
+    pthread_mutex_unlock(&ip_lock);
+    return pdPASS;
+}
+
+static void *ip_task(void *arg)
+{
+    NetworkBufferDescriptor_t *buffer;
+
+    (void) arg;
+    in_ip_task = pdTRUE;
+    pthread_mutex_lock(&ip_lock);
+    while(!stopping)
+    {
+        if(inbox_count != 0)
+        {
+            buffer = inbox[inbox_head];
+            inbox_head = (inbox_head + 1) % QUEUE_SIZE;
+            inbox_count--;
+            pthread_mutex_unlock(&ip_lock);
+            /* A UDP packet on a port without a socket, from the DNS port */
+            ulDNSHandlePacket(buffer);
+            vReleaseNetworkBufferAndDescriptor(buffer);
+            pthread_mutex_lock(&ip_lock);
+            continue;
+        }
+        if(dns_event)
+        {
+            dns_event = pdFALSE;
+            if(!timer_active)
+            {
+                timer_active = pdTRUE;
+                timer_start = xTaskGetTickCount();
+                timer_period = pdMS_TO_TICKS(1000u);
+            }
+            timer_expired = pdTRUE;
+        }
+        if(timer_active && (timer_expired || xTaskGetTickCount() - timer_start >= timer_period))
+        {
+            timer_expired = pdFALSE;
+            timer_start = xTaskGetTickCount();
+            pthread_mutex_unlock(&ip_lock);
+            vDNSCheckCallBack(NULL);
+            pthread_mutex_lock(&ip_lock);
+            continue;
+        }
+        if(timer_active)
+            wait_until(&ip_wake, &ip_lock, (unsigned long long) (timer_start + timer_period) * 1000u);
+        else
+            pthread_cond_wait(&ip_wake, &ip_lock);
+    }
+    pthread_mutex_unlock(&ip_lock);
+    return NULL;
+}
+
+/* The callers */
+static void give_result(Caller_t *caller, uint32_t address)
+{
+    pthread_mutex_lock(&caller_lock);
+    if(caller->results++ == 0)
+    {
+        caller->result = address;
+        caller->us = now_us() - caller->start_us;
+        pthread_cond_broadcast(&caller_wake);
+    }
+    pthread_mutex_unlock(&caller_lock);
+}
+
+static void on_reply(const char *pcName, void *pvSearchID, uint32_t ulIPAddress)
+{
+    Caller_t *caller = pvSearchID;
+
+    check(strcmp(pcName, caller->name) == 0, "a call-back was called for another name");
+    give_result(caller, ulIPAddress);
+}
+
+static void *run_caller(void *arg)
+{
+    Caller_t *caller = arg;
+    uint32_t address;
+
+    pthread_mutex_lock(&caller_lock);
+    while(!caller->go)
+        pthread_cond_wait(&caller_wake, &caller_lock);
+    caller->start_us = now_us();
+    pthread_mutex_unlock(&caller_lock);
+
+    if(caller->callback)
+    {
+        /* The call-back is called also when the address is known at once */
+        address = FreeRTOS_gethostbyname_a(caller->name, on_reply, caller, TIMEOUT_MS);
+        pthread_mutex_lock(&caller_lock);
+        check(address == 0 || (caller->results == 1 && caller->result == address),
+              "an address returned at once was not given to the call-back");
+        pthread_mutex_unlock(&caller_lock);
+    }
+    else
+    {
+        give_result(caller, FreeRTOS_gethostbyname(caller->name));
+    }
+    return NULL;
+}
+
+static void release_callers(Caller_t *callers, int from, int to)
+{
+    int i;
+
+    pthread_mutex_lock(&caller_lock);
+    for(i = from; i < to; i++)
+        callers[i].go = pdTRUE;
+    pthread_cond_broadcast(&caller_wake);
+    pthread_mutex_unlock(&caller_lock);
+}
+
+/* Waits until all callers have a result, or the time-outs of the look-up
+ * have passed */
+static void wait_for_results(Caller_t *callers, int n)
+{
+    unsigned long long until = now_us() + (TIMEOUT_MS + (ipconfigDNS_REQUEST_ATTEMPTS + 2) * 1000u) * 1000u;
+    int i, done;
+
+    pthread_mutex_lock(&caller_lock);
+    for(;;)
+    {
+        for(i = 0, done = 0; i < n; i++)
+            done += callers[i].results != 0;
+        if(done == n || wait_until(&caller_wake, &caller_lock, until) == ETIMEDOUT)
+            break;
+    }
+    pthread_mutex_unlock(&caller_lock);
+}
+
+/* One look-up of a new name by all callers */
+static void run(int scenario, int round)
+{
+    const Scenario_t *s = &scenarios[scenario];
+    int n = sync_callers + callback_callers, first = -1, i;
+    Caller_t *callers = calloc(n, sizeof(*callers));
+    uint32_t address = s->answered ? FreeRTOS_htonl(0x0A000000u | (uint32_t) (scenario << 8) | (uint32_t) (round + 1)) : 0;
+    unsigned long long until;
+    char name[32];
+
+    if(callers == NULL)
+    {
+        perror("dnsconcurrent");
+        exit(2);
+    }
+    runs[scenario][round] = callers;
+    sprintf(name, "%c%d.test", 'a' + scenario, round);
+    add_name(name, address);
+
+    for(i = 0; i < n; i++)
+    {
+        callers[i].callback = i >= sync_callers;
+        strcpy(callers[i].name, name);
+        pthread_create(&callers[i].thread, NULL, run_caller, &callers[i]);
+    }
+
+    /* The first one sends the request, the others look up the same name
+     * while it is on the wire */
+    if(s->start == SYNC_FIRST && sync_callers != 0)
+        first = 0;
+    else if(s->start == CALLBACK_FIRST && callback_callers != 0)
+        first = sync_callers;
+    if(first >= 0)
+    {
+        release_callers(callers, first, first + 1);
+        until = now_us() + 1000000u;
+        while(name_requests(name) == 0 && now_us() < until)
+            nanosleep(&(struct timespec) { 0, 100000 }, NULL);
+        check(name_requests(name) != 0, "the first caller did not send a request");
+    }
+    release_callers(callers, 0, n);
+
+    wait_for_results(callers, n);
+    for(i = 0; i < n; i++)
+        pthread_join(callers[i].thread, NULL);
+    for(i = 0; i < n; i++)
+    {
+        check(callers[i].results == 1, s->answered ? "a caller did not get the address exactly once"
+                                                   : "a caller did not get the time-out exactly once");
+        check(callers[i].result == address, s->answered ? "a caller got another address"
+                                                        : "a caller got an address that the server did not give");
+    }
+}
+
+/* Waits until the IP-task has finished the last look-ups and call-backs */
+static void wait_until_idle(void)
+{
+    unsigned long long until = now_us() + (TIMEOUT_MS + 2000u) * 1000u;
+    BaseType_t idle = pdFALSE;
+
+    while(!idle && now_us() < until)
+    {
+        nanosleep(&(struct timespec) { 0, 10000000 }, NULL);
+        pthread_mutex_lock(&server_lock);
+        idle = request_count == 0;
+        pthread_mutex_unlock(&server_lock);
+        pthread_mutex_lock(&ip_lock);
+        idle = idle && inbox_count == 0 && !timer_active;
+        pthread_mutex_unlock(&ip_lock);
+        pthread_mutex_lock(&count_lock);
+        idle = idle && allocations == frees;
+        pthread_mutex_unlock(&count_lock);
+    }
+}
+
+static void report(int scenario, int rounds)
+{
+    int n = sync_callers + callback_callers, i, r;
+    unsigned long requests = 0;
+    double us;
+
+    for(r = 0; r < rounds; r++)
+        requests += name_requests(runs[scenario][r][0].name);
+    printf("%-24s %5.2f requests, ms:", scenarios[scenario].label, (double) requests / rounds);
+    for(i = 0; i < n; i++)
+    {
+        for(r = 0, us = 0; r < rounds; r++)
+            us += runs[scenario][r][i].us;
+        printf("%s%7.1f", i == 0 ? " sync" : i == sync_callers ? "  call-back" : "", us / rounds / 1000);
+    }
+    printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+    pthread_mutexattr_t attr;
+    pthread_t server, ip;
+    int rounds = 10, i, r;
+    size_t s;
+    BaseType_t usage = pdFALSE;
+
+    for(i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+            sync_callers = atoi(argv[++i]);
+        else if(strcmp(argv[i], "-a") == 0 && i + 1 < argc)
+            callback_callers = atoi(argv[++i]);
+        else if(strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+            delay_ms = (TickType_t) atoi(argv[++i]);
+        else if(strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+            rounds = atoi(argv[++i]);
+        else
+            usage = pdTRUE;
+    }
+    if(usage || sync_callers < 0 || callback_callers < 0 || sync_callers + callback_callers == 0 ||
+       sync_callers + callback_callers > MAX_CALLERS || rounds < 1 || rounds > MAX_ROUNDS)
+    {
+        fprintf(stderr, "usage: dnsconcurrent [-s sync_callers] [-a callback_callers] [-d delay_ms] [-r rounds]\n"
+                        "       at most %d callers and %d rounds\n", MAX_CALLERS, MAX_ROUNDS);
+        return 2;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &epoch);
+    epoch.tv_sec -= 1;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&kernel_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+    init_cond(&caller_wake);
+    init_cond(&server_wake);
+    init_cond(&ip_wake);
+    for(s = 0; s < sizeof(sockets) / sizeof(sockets[0]); s++)
+        init_cond(&sockets[s].ready);
+
+    vDNSInitialise();
+    pthread_create(&server, NULL, dns_server, NULL);
+    pthread_create(&ip, NULL, ip_task, NULL);
+
+    printf("ipconfigDNS_COALESCE_REQUESTS %d, %d + %d callers, replies after %lu ms, mean latency of each caller:\n",
+           ipconfigDNS_COALESCE_REQUESTS, sync_callers, callback_callers, (unsigned long) delay_ms);
+    for(s = 0; s < SCENARIOS; s++)
+    {
+        /* A look-up that is not answered takes seconds */
+        for(r = 0; r < (scenarios[s].answered ? rounds : 1); r++)
+            run(s, r);
+        report(s, scenarios[s].answered ? rounds : 1);
+    }
+    wait_until_idle();
+
+    for(s = 0; s < SCENARIOS; s++)
+    {
+        for(r = 0; r < (scenarios[s].answered ? rounds : 1); r++)
+        {
+            for(i = 0; i < sync_callers + callback_callers; i++)
+                check(runs[s][r][i].results == 1, "a call-back was called again after its result");
+#if( ipconfigDNS_COALESCE_REQUESTS != 0 )
+            if(scenarios[s].answered)
+                check(name_requests(runs[s][r][0].name) == 1, "a coalesced look-up sent more than one request");
+            else
+                check(name_requests(runs[s][r][0].name) == ipconfigDNS_REQUEST_ATTEMPTS,
+                      "a coalesced look-up without an answer did not send all attempts once");
+#endif
+            free(runs[s][r]);
+        }
+    }
+    check(dropped == 0, "a request or reply was dropped");
+    check(sockets_open == 0, "a socket was not closed");
+    check(allocations == frees, "a look-up or call-back was not freed");
+    check(groups == groups_deleted, "an event group was not deleted");
+    check(allocated == released, "a network buffer was not released");
+
+    pthread_mutex_lock(&server_lock);
+    pthread_mutex_lock(&ip_lock);
+    stopping = pdTRUE;
+    pthread_cond_broadcast(&server_wake);
+    pthread_cond_broadcast(&ip_wake);
+    pthread_mutex_unlock(&ip_lock);
+    pthread_mutex_unlock(&server_lock);
+    pthread_join(server, NULL);
+    pthread_join(ip, NULL);
+
+    printf("ipconfigDNS_COALESCE_REQUESTS %d: %lu checks, %lu failures\n",
+           ipconfigDNS_COALESCE_REQUESTS, checks, failures);
+
+    return failures != 0;
+}
@@ -0,0 +1,39 @@
+/*
+ * FreeRTOSConfig.h for the host side tests in ../, with the values of the
+ * TCP Echo Server's configuration that FreeRTOS+TCP depends on.  The kernel
+ * itself is not built: each test provides the few kernel functions it calls.
+ */
+
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+#include <assert.h>
+
+#define configUSE_PREEMPTION				1
+#define configUSE_IDLE_HOOK				0
+#define configUSE_TICK_HOOK				0
+#define configTICK_RATE_HZ				( ( TickType_t ) 1000 )
+#define configMAX_PRIORITIES				( 5UL )
+#define configMINIMAL_STACK_SIZE			( 256 )
+#define configTOTAL_HEAP_SIZE				( ( size_t ) 60000 )
+#define configMAX_TASK_NAME_LEN				( 8 )
+#define configUSE_TRACE_FACILITY			0
+#define configUSE_16_BIT_TICKS				0
+#define configUSE_MUTEXES				1
+#define configUSE_COUNTING_SEMAPHORES                   1
+#define configUSE_TIMERS				0
+#define configUSE_CO_ROUTINES 				0
+#define configSUPPORT_DYNAMIC_ALLOCATION		1
+
+#define INCLUDE_vTaskPrioritySet			1
+#define INCLUDE_vTaskDelete				1
+#define INCLUDE_vTaskDelay				1
+#define INCLUDE_xTaskGetCurrentTaskHandle		1
+
+#define configKERNEL_INTERRUPT_PRIORITY			0x01
+#define configMAX_SYSCALL_INTERRUPT_PRIORITY		0x03
+
+/* A failed assertion ends the test. */
+#define configASSERT( x ) assert( x )
+
+#endif /* FREERTOS_CONFIG_H */
@@ -0,0 +1 @@
+/* Empty: the host side tests in ../ have no PHY. */
@@ -0,0 +1 @@
+/* Empty: the host side tests in ../ use no PIC32 peripheral library. */
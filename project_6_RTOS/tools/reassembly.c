@@ -0,0 +1,801 @@
+/** @file reassembly.c
+ *
+ * @brief Host side test and benchmark of the reassembly of fragmented UDP
+ * datagrams by FreeRTOS+TCP
+ *
+ * @par
+ * Runs the real IP-task of FreeRTOS_IP.c on a simulated clock of one tick per
+ * millisecond: the fragments are handed to it the way a driver does, with an
+ * eNetworkRxEvent, and the task runs until it waits for the next event. The
+ * datagrams that come out of the IP layer are compared with the ones the peer
+ * sent. Checks fragments in order, in reverse and in random order, fragments
+ * that overlap and fragments that come in twice, that a datagram with a
+ * corrupted fragment is dropped while the next one gets through, that
+ * malformed fragments are ignored, that a datagram that is too long for
+ * ipconfigIP_REASSEMBLY_MAX_SIZE is dropped, the eviction of the oldest
+ * datagram when all ipconfigIP_REASSEMBLY_MAX_DATAGRAMS are in use, the
+ * time-out, and that the fragments vProcessGeneratedUDPPacket() sends can be
+ * put together again. Every network buffer must be released.
+ *
+ * @par
+ * Built by the Makefile in this directory with the configuration of the TCP
+ * Echo Server (reassembly), and with AddressSanitizer and
+ * UndefinedBehaviorSanitizer (reassembly_asan), where the driver is said to
+ * check the checksums (ipconfigDRIVER_INCLUDED_RX_IP_CHECKSUM) so that the
+ * check of the reassembled datagram is the only one:
+ *
+ *     make reassembly reassembly_asan
+ *     ./reassembly -b 100000
+ *
+ *     -b  datagrams of each size received and sent for the benchmark
+ *         (default 0, no benchmark)
+ *
+ * @par
+ * The exit status is 1 if a check failed.
+ *
+ * @author
+ * Carlos Santos
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "event_groups.h"
+#include "FreeRTOS_IP.h"
+#include "FreeRTOS_IP_Private.h"
+#include "FreeRTOS_ARP.h"
+#include "FreeRTOS_Sockets.h"
+#include "NetworkInterface.h"
+#include "NetworkBufferManagement.h"
+
+#define LOCAL_IP        0xC0A80002u     /* 192.168.0.2/24 */
+#define PEER_IP         0xC0A80009u
+#define OTHER_IP        0xC0A8000Au
+#define PEER_PORT       5000
+#define LOCAL_PORT      7
+#define MAX_FRAGMENT    (ipconfigNETWORK_MTU - ipSIZE_OF_IPv4_HEADER)
+#define MAX_DATA        (ipconfigIP_REASSEMBLY_MAX_SIZE - ipSIZE_OF_UDP_HEADER)
+#define MAX_PIECES      (3 * (ipconfigIP_REASSEMBLY_MAX_SIZE / 8 + 1))
+#define MAX_FRAMES      64
+#define TIMEOUT         pdMS_TO_TICKS(ipconfigIP_REASSEMBLY_TIMEOUT_MS)
+
+static const uint8_t local_ip[4] = { 192, 168, 0, 2 };
+static const uint8_t net_mask[4] = { 255, 255, 255, 0 };
+static const uint8_t gateway[4] = { 192, 168, 0, 1 };
+static const uint8_t local_mac[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+static const MACAddress_t peer_mac = { { 0x02, 0x00, 0x00, 0x00, 0x00, 0x42 } };
+
+static TickType_t tick_count;
+static unsigned long allocated, released, fail_allocation;
+static BaseType_t in_ip_task, link_up;
+static TaskFunction_t ip_task;
+static jmp_buf ip_task_waits;
+static IPStackEvent_t *events;
+static UBaseType_t event_head, event_count, event_length;
+
+/* The datagram the peer sends, from the Ethernet header on, and what reached
+ * the UDP layer */
+static uint8_t datagram[ipIP_PAYLOAD_OFFSET + 0x10000];
+static size_t datagram_length;          /* of the IP payload */
+static uint8_t delivered[0x10000];
+static size_t delivered_length;
+static unsigned long deliveries;
+
+/* The IPv4 frames that went out */
+static uint8_t *frames[MAX_FRAMES];
+static size_t frame_lengths[MAX_FRAMES];
+static int frame_count;
+
+static uint32_t rng_state = 1;
+static unsigned long checks, failures;
+
+static uint32_t rnd(uint32_t n)
+{
+    /* xorshift32 */
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state % n;
+}
+
+static void fail(const char *what)
+{
+    if(failures++ < 10)
+        printf("%s\n", what);
+}
+
+static void check(int ok, const char *what)
+{
+    checks++;
+    if(!ok)
+        fail(what);
+}
+
+/* The kernel functions the sources call */
+void *pvPortMalloc(size_t xSize) { return malloc(xSize); }
+void vPortFree(void *pv) { free(pv); }
+TickType_t xTaskGetTickCount(void) { return tick_count; }
+void vTaskDelay(const TickType_t xTicksToDelay) { tick_count += xTicksToDelay; }
+void vTaskSuspendAll(void) { }
+BaseType_t xTaskResumeAll(void) { return pdFALSE; }
+TaskHandle_t xTaskGetCurrentTaskHandle(void) { return in_ip_task ? (TaskHandle_t) &ip_task : NULL; }
+EventBits_t xEventGroupSetBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToSet) { (void) xEventGroup; return uxBitsToSet; }
+UBaseType_t uxQueueMessagesWaiting(const QueueHandle_t xQueue) { (void) xQueue; return event_count; }
+void vQueueDelete(QueueHandle_t xQueue) { (void) xQueue; }
+
+void vTaskSetTimeOutState(TimeOut_t * const pxTimeOut)
+{
+    pxTimeOut->xOverflowCount = 0;
+    pxTimeOut->xTimeOnEntering = tick_count;
+}
+
+BaseType_t xTaskCheckForTimeOut(TimeOut_t * const pxTimeOut, TickType_t * const pxTicksToWait)
+{
+    TickType_t elapsed = tick_count - pxTimeOut->xTimeOnEntering;
+
+    if(elapsed >= *pxTicksToWait)
+    {
+        *pxTicksToWait = 0;
+        return pdTRUE;
+    }
+    *pxTicksToWait -= elapsed;
+    pxTimeOut->xTimeOnEntering = tick_count;
+    return pdFALSE;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char * const pcName, const configSTACK_DEPTH_TYPE usStackDepth,
+                       void * const pvParameters, UBaseType_t uxPriority, TaskHandle_t * const pxCreatedTask)
+{
+    (void) pcName;
+    (void) usStackDepth;
+    (void) pvParameters;
+    (void) uxPriority;
+    ip_task = pxTaskCode;
+    *pxCreatedTask = (TaskHandle_t) &ip_task;
+    return pdPASS;
+}
+
+/* The network event queue */
+QueueHandle_t xQueueGenericCreate(const UBaseType_t uxQueueLength, const UBaseType_t uxItemSize, const uint8_t ucQueueType)
+{
+    (void) ucQueueType;
+    if(uxItemSize != sizeof(IPStackEvent_t))
+        return NULL;
+    events = calloc(uxQueueLength, sizeof(*events));
+    event_length = uxQueueLength;
+    return (QueueHandle_t) events;
+}
+
+BaseType_t xQueueGenericSend(QueueHandle_t xQueue, const void * const pvItemToQueue, TickType_t xTicksToWait, const BaseType_t xCopyPosition)
+{
+    const IPStackEvent_t *event = pvItemToQueue;
+
+    (void) xQueue;
+    (void) xTicksToWait;
+    (void) xCopyPosition;
+
+    /* prvIPTask() reports the network down each time it is entered, the link
+     * only goes down once */
+    if(event->eEventType == eNetworkDownEvent && link_up != pdFALSE)
+        return pdPASS;
+    if(event_count == event_length)
+        return pdFAIL;
+    events[(event_head + event_count++) % event_length] = *event;
+    return pdPASS;
+}
+
+/* The IP-task waits when the queue is empty: it leaves prvIPTask(), which is
+ * entered again for the next events */
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void * const pvBuffer, TickType_t xTicksToWait)
+{
+    (void) xQueue;
+    (void) xTicksToWait;
+    if(event_count == 0)
+        longjmp(ip_task_waits, 1);
+    *(IPStackEvent_t *) pvBuffer = events[event_head];
+    event_head = (event_head + 1) % event_length;
+    event_count--;
+    return pdTRUE;
+}
+
+static void run_ip_task(void)
+{
+    if(setjmp(ip_task_waits) == 0)
+    {
+        in_ip_task = pdTRUE;
+        ip_task(NULL);
+    }
+    in_ip_task = pdFALSE;
+}
+
+/* The network buffers are allocated with the size asked for, as by
+ * BufferAllocation_2.c, so that the sanitizer sees every overflow */
+NetworkBufferDescriptor_t *pxGetNetworkBufferWithDescriptor(size_t xRequestedSizeBytes, TickType_t xBlockTimeTicks)
+{
+    NetworkBufferDescriptor_t *buffer;
+    uint8_t *data;
+    size_t size = xRequestedSizeBytes < sizeof(TCPPacket_t) ? sizeof(TCPPacket_t) : xRequestedSizeBytes;
+
+    (void) xBlockTimeTicks;
+    if(fail_allocation != 0 && --fail_allocation == 0)
+        return NULL;
+    buffer = calloc(1, sizeof(*buffer));
+    data = calloc(1, size + ipBUFFER_PADDING);
+    if(buffer == NULL || data == NULL)
+    {
+        perror("reassembly");
+        exit(2);
+    }
+    buffer->pucEthernetBuffer = data + ipBUFFER_PADDING;
+    buffer->xDataLength = xRequestedSizeBytes;
+    allocated++;
+    return buffer;
+}
+
+void vReleaseNetworkBufferAndDescriptor(NetworkBufferDescriptor_t * const pxNetworkBuffer)
+{
+    free(pxNetworkBuffer->pucEthernetBuffer - ipBUFFER_PADDING);
+    free(pxNetworkBuffer);
+    released++;
+}
+
+BaseType_t xNetworkBuffersInitialise(void) { return pdPASS; }
+
+/* The driver: the link comes up at once, and the IPv4 frames that go out are
+ * recorded */
+BaseType_t xNetworkInterfaceInitialise(void)
+{
+    link_up = pdTRUE;
+    return pdPASS;
+}
+
+BaseType_t xNetworkInterfaceOutput(NetworkBufferDescriptor_t * const pxNetworkBuffer, BaseType_t xReleaseAfterSend)
+{
+    EthernetHeader_t *ethernet = (EthernetHeader_t *) pxNetworkBuffer->pucEthernetBuffer;
+
+    if(ethernet->usFrameType == ipIPv4_FRAME_TYPE && frame_count < MAX_FRAMES)
+    {
+        frames[frame_count] = malloc(pxNetworkBuffer->xDataLength);
+        if(frames[frame_count] == NULL)
+        {
+            perror("reassembly");
+            exit(2);
+        }
+        memcpy(frames[frame_count], pxNetworkBuffer->pucEthernetBuffer, pxNetworkBuffer->xDataLength);
+        frame_lengths[frame_count++] = pxNetworkBuffer->xDataLength;
+    }
+    if(xReleaseAfterSend != pdFALSE)
+        vReleaseNetworkBufferAndDescriptor(pxNetworkBuffer);
+    return pdPASS;
+}
+
+/* DHCP gives the address at once */
+void vDHCPProcess(BaseType_t xReset)
+{
+    if(xReset != pdFALSE)
+    {
+        FreeRTOS_SetIPAddress(FreeRTOS_htonl(LOCAL_IP));
+        vIPNetworkUpCalls();
+    }
+}
+
+/* The sockets, with -Wl,--wrap: the datagrams that reach the UDP layer are
+ * recorded, xDataLength is the length of their data */
+BaseType_t __wrap_xProcessReceivedUDPPacket(NetworkBufferDescriptor_t *pxNetworkBuffer, uint16_t usPort)
+{
+    (void) usPort;
+    delivered_length = pxNetworkBuffer->xDataLength;
+    memcpy(delivered, pxNetworkBuffer->pucEthernetBuffer + sizeof(UDPPacket_t), delivered_length);
+    deliveries++;
+    vReleaseNetworkBufferAndDescriptor(pxNetworkBuffer);
+    return pdPASS;
+}
+
+BaseType_t vNetworkSocketsInit(void) { return pdTRUE; }
+BaseType_t vSocketBind(FreeRTOS_Socket_t *pxSocket, struct freertos_sockaddr *pxAddress, size_t uxAddressLength, BaseType_t xInternal) { (void) pxSocket; (void) pxAddress; (void) uxAddressLength; (void) xInternal; return 0; }
+void *vSocketClose(FreeRTOS_Socket_t *pxSocket) { (void) pxSocket; return NULL; }
+void vSocketWakeUpUser(FreeRTOS_Socket_t *pxSocket) { (void) pxSocket; }
+TickType_t xTCPTimerCheck(BaseType_t xWillSleep) { (void) xWillSleep; return pdMS_TO_TICKS(1000); }
+BaseType_t xProcessReceivedTCPPacket(NetworkBufferDescriptor_t *pxNetworkBuffer) { (void) pxNetworkBuffer; return pdFAIL; }
+BaseType_t xTCPCheckNewClient(FreeRTOS_Socket_t *pxSocket) { (void) pxSocket; return pdFALSE; }
+void vTCPWakeUpConnectingSockets(void) { }
+void vDNSCheckCache(void) { }
+
+/* An independent one's complement sum */
+static uint32_t sum16(uint32_t sum, const uint8_t *p, size_t n)
+{
+    for(; n > 1; n -= 2, p += 2)
+        sum += (uint32_t) (p[0] << 8 | p[1]);
+    if(n != 0)
+        sum += (uint32_t) p[0] << 8;
+    return sum;
+}
+
+static uint16_t fold(uint32_t sum)
+{
+    while(sum >> 16)
+        sum = (sum & 0xFFFFu) + (sum >> 16);
+    return (uint16_t) sum;
+}
+
+static void set_header_checksum(IPHeader_t *ip)
+{
+    ip->usHeaderChecksum = 0;
+    ip->usHeaderChecksum = FreeRTOS_htons((uint16_t) ~fold(sum16(0, (uint8_t *) ip, ipSIZE_OF_IPv4_HEADER)));
+}
+
+/* The datagram the peer sends: length bytes of data, after the UDP header */
+static void make_datagram(uint16_t id, uint32_t source, size_t length)
+{
+    IPPacket_t *packet = (IPPacket_t *) datagram;
+    UDPHeader_t *udp = (UDPHeader_t *) (datagram + ipIP_PAYLOAD_OFFSET);
+    uint8_t *data = datagram + ipIP_PAYLOAD_OFFSET + ipSIZE_OF_UDP_HEADER;
+    uint32_t sum;
+    size_t i;
+
+    memset(datagram, 0, ipIP_PAYLOAD_OFFSET + ipSIZE_OF_UDP_HEADER);
+    memcpy(packet->xEthernetHeader.xDestinationAddress.ucBytes, local_mac, sizeof(local_mac));
+    memcpy(packet->xEthernetHeader.xSourceAddress.ucBytes, peer_mac.ucBytes, sizeof(peer_mac));
+    packet->xEthernetHeader.usFrameType = ipIPv4_FRAME_TYPE;
+    packet->xIPHeader.ucVersionHeaderLength = 0x45;
+    packet->xIPHeader.ucTimeToLive = 64;
+    packet->xIPHeader.ucProtocol = ipPROTOCOL_UDP;
+    packet->xIPHeader.usIdentification = FreeRTOS_htons(id);
+    packet->xIPHeader.ulSourceIPAddress = FreeRTOS_htonl(source);
+    packet->xIPHeader.ulDestinationIPAddress = FreeRTOS_htonl(LOCAL_IP);
+
+    datagram_length = ipSIZE_OF_UDP_HEADER + length;
+    udp->usSourcePort = FreeRTOS_htons(PEER_PORT);
+    udp->usDestinationPort = FreeRTOS_htons(LOCAL_PORT);
+    udp->usLength = FreeRTOS_htons((uint16_t) datagram_length);
+    for(i = 0; i < length; i++)
+        data[i] = (uint8_t) rnd(256);
+
+    sum = sum16(0, (uint8_t *) &packet->xIPHeader.ulSourceIPAddress, 8) + ipPROTOCOL_UDP + datagram_length;
+    udp->usChecksum = FreeRTOS_htons((uint16_t) ~fold(sum16(sum, (uint8_t *) udp, datagram_length)));
+    if(udp->usChecksum == 0)
+        udp->usChecksum = 0xFFFFu;
+}
+
+/* Hands bytes [first, end) of the IP payload of the datagram to the IP-task,
+ * as a fragment */
+static void queue_fragment(size_t first, size_t end)
+{
+    NetworkBufferDescriptor_t *buffer = pxGetNetworkBufferWithDescriptor(ipIP_PAYLOAD_OFFSET + end - first, 0);
+    IPPacket_t *packet;
+    IPStackEvent_t event;
+    uint16_t offset = (uint16_t) (first >> 3);
+
+    if(buffer == NULL)
+        return;
+    packet = (IPPacket_t *) buffer->pucEthernetBuffer;
+    memcpy(buffer->pucEthernetBuffer, datagram, ipIP_PAYLOAD_OFFSET);
+    memcpy(buffer->pucEthernetBuffer + ipIP_PAYLOAD_OFFSET, datagram + ipIP_PAYLOAD_OFFSET + first, end - first);
+    if(end < datagram_length)
+        offset |= 0x2000u;
+    packet->xIPHeader.usLength = FreeRTOS_htons((uint16_t) (ipSIZE_OF_IPv4_HEADER + end - first));
+    packet->xIPHeader.usFragmentOffset = FreeRTOS_htons(offset);
+    set_header_checksum(&packet->xIPHeader);
+
+    event.eEventType = eNetworkRxEvent;
+    event.pvData = buffer;
+    if(xSendEventStructToIPTask(&event, 0) != pdPASS)
+        vReleaseNetworkBufferAndDescriptor(buffer);
+}
+
+static void fragment(size_t first, size_t end)
+{
+    queue_fragment(first, end);
+    run_ip_task();
+}
+
+/* Cuts the datagram in pieces of at most longest bytes, each a multiple of 8
+ * but the last */
+static int cut(size_t *starts, size_t *ends, size_t longest)
+{
+    size_t first = 0, length;
+    int n = 0;
+
+    while(first < datagram_length)
+    {
+        length = (rnd((uint32_t) (longest / 8)) + 1) * 8;
+        if(first + length > datagram_length)
+            length = datagram_length - first;
+        starts[n] = first;
+        ends[n++] = first + length;
+        first += length;
+    }
+    return n;
+}
+
+static void shuffle(int *order, int n)
+{
+    int i, j, t;
+
+    for(i = n - 1; i > 0; i--)
+    {
+        j = (int) rnd((uint32_t) i + 1);
+        t = order[i];
+        order[i] = order[j];
+        order[j] = t;
+    }
+}
+
+static int delivered_intact(void)
+{
+    return delivered_length == datagram_length - ipSIZE_OF_UDP_HEADER &&
+           memcmp(delivered, datagram + ipIP_PAYLOAD_OFFSET + ipSIZE_OF_UDP_HEADER, delivered_length) == 0;
+}
+
+/* The network buffers the IP-task holds, one for each datagram it is
+ * reassembling */
+static unsigned long held(void)
+{
+    return allocated - released;
+}
+
+/* Lets every datagram that is being reassembled time out */
+static void expire(void)
+{
+    tick_count += TIMEOUT;
+    run_ip_task();
+}
+
+static size_t starts[MAX_PIECES], ends[MAX_PIECES];
+static int order[MAX_PIECES];
+
+static void test_order(void)
+{
+    unsigned long before;
+    uint16_t id;
+    int n, i;
+
+    /* A datagram that is not fragmented takes the normal path */
+    make_datagram(1, PEER_IP, 100);
+    before = deliveries;
+    fragment(0, datagram_length);
+    check(deliveries == before + 1 && delivered_intact(), "a datagram that is not fragmented was lost");
+
+    for(id = 0; id < 2000; id++)
+    {
+        make_datagram(id, PEER_IP, 1 + rnd(MAX_DATA));
+        n = cut(starts, ends, MAX_FRAGMENT);
+        for(i = 0; i < n; i++)
+            order[i] = id % 3 == 0 ? i : id % 3 == 1 ? n - 1 - i : i;
+        if(id % 3 == 2)
+            shuffle(order, n);
+        before = deliveries;
+        for(i = 0; i < n; i++)
+            fragment(starts[order[i]], ends[order[i]]);
+        check(deliveries == before + 1 && delivered_intact(), "fragments in order, in reverse or shuffled were not put together");
+        check(held() == 0, "a complete datagram holds a network buffer");
+    }
+}
+
+/* Three cuts of the same datagram, mixed, some fragments twice */
+static void test_overlap(void)
+{
+    unsigned long before;
+    uint16_t id;
+    int n, i, j;
+
+    for(id = 0; id < 2000; id++)
+    {
+        make_datagram((uint16_t) (10000 + id), PEER_IP, 1 + rnd(MAX_DATA));
+        for(n = 0, j = 0; j < 3; j++)
+            n += cut(starts + n, ends + n, 8 + 8 * rnd(MAX_FRAGMENT / 8));
+        for(i = 0; i < n; i++)
+            order[i] = i;
+        shuffle(order, n);
+        before = deliveries;
+        for(i = 0; i < n && deliveries == before; i++)
+        {
+            fragment(starts[order[i]], ends[order[i]]);
+            if(deliveries == before && rnd(4) == 0)
+                fragment(starts[order[i]], ends[order[i]]);
+        }
+        check(deliveries == before + 1 && delivered_intact(), "overlapping or duplicate fragments were not put together");
+
+        /* The fragments that come late start the datagram again, whatever
+         * is complete again must have the same contents */
+        for(; i < n; i++)
+            fragment(starts[order[i]], ends[order[i]]);
+        check(delivered_intact(), "late fragments delivered something else");
+        expire();
+        check(held() == 0, "a network buffer was held after the time-out");
+    }
+}
+
+/* A fragment of which a bit changed on the way: the UDP checksum of the
+ * datagram is wrong, it must be dropped, and the next datagram must get
+ * through */
+static void test_corrupt(void)
+{
+    static const size_t positions[] = { 0, 6, 7, 1000, MAX_FRAGMENT, MAX_FRAGMENT + 1, 2 * MAX_FRAGMENT + 5 };
+    unsigned long before;
+    size_t i, position;
+
+    for(i = 0; i < sizeof(positions) / sizeof(positions[0]); i++)
+    {
+        make_datagram((uint16_t) (20000 + i), PEER_IP, 3000);
+        position = positions[i] < datagram_length ? positions[i] : datagram_length - 1;
+        datagram[ipIP_PAYLOAD_OFFSET + position] ^= 0x10;
+        before = deliveries;
+        fragment(MAX_FRAGMENT, 2 * MAX_FRAGMENT);
+        fragment(2 * MAX_FRAGMENT, datagram_length);
+        fragment(0, MAX_FRAGMENT);
+        check(deliveries == before, "a datagram with a corrupted fragment was delivered");
+        check(held() == 0, "a datagram with a corrupted fragment holds a network buffer");
+
+        datagram[ipIP_PAYLOAD_OFFSET + position] ^= 0x10;
+        datagram[ipSIZE_OF_ETH_HEADER + 5] ^= 0x01;      /* the identification */
+        fragment(0, MAX_FRAGMENT);
+        fragment(2 * MAX_FRAGMENT, datagram_length);
+        fragment(MAX_FRAGMENT, 2 * MAX_FRAGMENT);
+        check(deliveries == before + 1 && delivered_intact(), "the datagram after a corrupted one was lost");
+    }
+}
+
+static void test_malformed(void)
+{
+    unsigned long before;
+
+    /* Only the last fragment may have a length that is not a multiple of 8 */
+    make_datagram(30000, PEER_IP, 3000);
+    before = deliveries;
+    fragment(0, 1001);
+    check(held() == 0, "a fragment of odd length was accepted");
+    fragment(0, MAX_FRAGMENT);
+    fragment(MAX_FRAGMENT, datagram_length);
+    check(deliveries == before + 1 && delivered_intact(), "the fragments after one of odd length were not put together");
+
+    /* Two last fragments that do not agree on the length */
+    make_datagram(30001, PEER_IP, 3000);
+    fragment(MAX_FRAGMENT, datagram_length);
+    datagram_length = 2000;
+    fragment(MAX_FRAGMENT, datagram_length);
+    check(held() == 0, "a datagram with two different ends was kept");
+
+    /* Longer than ipconfigIP_REASSEMBLY_MAX_SIZE */
+    make_datagram(30002, PEER_IP, MAX_DATA + 1);
+    before = deliveries;
+    fragment(0, MAX_FRAGMENT);
+    fragment(ipconfigIP_REASSEMBLY_MAX_SIZE, datagram_length);
+    expire();
+    check(deliveries == before && held() == 0, "a datagram that is too long was kept");
+
+    /* No network buffer for the datagram */
+    make_datagram(30003, PEER_IP, 3000);
+    fail_allocation = 2;
+    fragment(0, MAX_FRAGMENT);
+    check(fail_allocation == 0 && held() == 0, "a fragment without a network buffer was kept");
+}
+
+/* Two datagrams with the same identification from two hosts, then a third
+ * one evicts the oldest, and what remains times out */
+static void test_eviction(void)
+{
+    static uint8_t first[sizeof(datagram)], second[sizeof(datagram)];
+    size_t first_length, second_length;
+    TickType_t third_start, restart;
+    unsigned long before;
+
+    make_datagram(40000, PEER_IP, 2500);
+    memcpy(first, datagram, sizeof(datagram));
+    first_length = datagram_length;
+    make_datagram(40000, OTHER_IP, 2500);
+    memcpy(second, datagram, sizeof(datagram));
+    second_length = datagram_length;
+
+    before = deliveries;
+    memcpy(datagram, first, sizeof(datagram));
+    datagram_length = first_length;
+    fragment(0, MAX_FRAGMENT);
+    tick_count += 1;
+    memcpy(datagram, second, sizeof(datagram));
+    datagram_length = second_length;
+    fragment(MAX_FRAGMENT, datagram_length);
+    check(held() == 2, "two datagrams from two hosts were mixed up");
+
+    tick_count += 10;
+    third_start = tick_count;
+    make_datagram(40001, PEER_IP, 2500);
+    fragment(0, MAX_FRAGMENT);
+    check(held() == 2, "more datagrams than ipconfigIP_REASSEMBLY_MAX_DATAGRAMS");
+
+    memcpy(datagram, second, sizeof(datagram));
+    datagram_length = second_length;
+    fragment(0, MAX_FRAGMENT);
+    check(deliveries == before + 1 && delivered_intact(), "the datagram that was not evicted was lost");
+
+    /* The evicted datagram starts again */
+    tick_count += 5;
+    restart = tick_count;
+    memcpy(datagram, first, sizeof(datagram));
+    datagram_length = first_length;
+    fragment(MAX_FRAGMENT, datagram_length);
+    check(deliveries == before + 1 && held() == 2, "an evicted datagram was completed");
+
+    tick_count = third_start + TIMEOUT - 1;
+    run_ip_task();
+    check(held() == 2, "a datagram timed out early");
+    tick_count = third_start + TIMEOUT;
+    run_ip_task();
+    check(held() == 1, "the oldest datagram did not time out");
+    tick_count = restart + TIMEOUT - 1;
+    run_ip_task();
+    check(held() == 1, "the newest datagram timed out early");
+    tick_count = restart + TIMEOUT;
+    run_ip_task();
+    check(held() == 0, "the newest datagram did not time out");
+}
+
+static void clear_frames(void)
+{
+    while(frame_count > 0)
+        free(frames[--frame_count]);
+}
+
+/* Sends length bytes through vProcessGeneratedUDPPacket(), the frames end up
+ * in frames[] */
+static void send_datagram(const uint8_t *data, size_t length, BaseType_t checksum)
+{
+    NetworkBufferDescriptor_t *buffer = pxGetNetworkBufferWithDescriptor(sizeof(UDPPacket_t) + length, 0);
+
+    memcpy(buffer->pucEthernetBuffer + sizeof(UDPPacket_t), data, length);
+    buffer->xDataLength = length;
+    buffer->usPort = FreeRTOS_htons(LOCAL_PORT);
+    buffer->usBoundPort = FreeRTOS_htons(PEER_PORT);
+    buffer->ulIPAddress = FreeRTOS_htonl(PEER_IP);
+    buffer->pucEthernetBuffer[ipSOCKET_OPTIONS_OFFSET] = checksum != pdFALSE ? FREERTOS_SO_UDPCKSUM_OUT : 0;
+    vProcessGeneratedUDPPacket(buffer);
+}
+
+/* The fragments that go out, turned around, must give the same datagram */
+static void test_round_trip(void)
+{
+    static uint8_t data[MAX_DATA];
+    unsigned long before;
+    size_t length, i;
+    int round, j;
+
+    for(round = 0; round < 500; round++)
+    {
+        length = 1 + rnd(MAX_DATA);
+        for(i = 0; i < length; i++)
+            data[i] = (uint8_t) rnd(256);
+        vARPRefreshCacheEntry(&peer_mac, FreeRTOS_htonl(PEER_IP));
+        send_datagram(data, length, (BaseType_t) (round & 1));
+        check(frame_count == (int) ((length + ipSIZE_OF_UDP_HEADER + MAX_FRAGMENT - 1) / MAX_FRAGMENT),
+              "a datagram went out in the wrong number of fragments");
+
+        for(j = 0; j < frame_count; j++)
+            order[j] = j;
+        shuffle(order, frame_count);
+        before = deliveries;
+        for(j = 0; j < frame_count; j++)
+        {
+            NetworkBufferDescriptor_t *buffer = pxGetNetworkBufferWithDescriptor(frame_lengths[order[j]], 0);
+            IPPacket_t *packet = (IPPacket_t *) buffer->pucEthernetBuffer;
+            IPStackEvent_t event = { eNetworkRxEvent, buffer };
+
+            memcpy(buffer->pucEthernetBuffer, frames[order[j]], frame_lengths[order[j]]);
+            packet->xIPHeader.ulSourceIPAddress = FreeRTOS_htonl(PEER_IP);
+            packet->xIPHeader.ulDestinationIPAddress = FreeRTOS_htonl(LOCAL_IP);
+            set_header_checksum(&packet->xIPHeader);
+            if(xSendEventStructToIPTask(&event, 0) != pdPASS)
+                vReleaseNetworkBufferAndDescriptor(buffer);
+            run_ip_task();
+        }
+        clear_frames();
+        check(deliveries == before + 1 && delivered_length == length && memcmp(delivered, data, length) == 0,
+              "the fragments that went out could not be put together");
+        check(held() == 0, "a network buffer was held after a round trip");
+    }
+}
+
+static double elapsed_ns(const struct timespec *t0)
+{
+    struct timespec t1;
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return (t1.tv_sec - t0->tv_sec) * 1e9 + (t1.tv_nsec - t0->tv_nsec);
+}
+
+/* Datagrams of one, two and three frames, the largest that can be
+ * reassembled: received with the fragments in order and in reverse, and
+ * sent */
+static void benchmark(unsigned long rounds)
+{
+    static const size_t sizes[] = { MAX_FRAGMENT - ipSIZE_OF_UDP_HEADER, 2 * MAX_FRAGMENT - ipSIZE_OF_UDP_HEADER, MAX_DATA };
+    static uint8_t data[MAX_DATA];
+    struct timespec t0;
+    unsigned long j;
+    size_t s, length;
+    int n, i, reverse;
+    double ns;
+
+    for(s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        length = sizes[s] < MAX_DATA ? sizes[s] : MAX_DATA;
+        make_datagram(1, PEER_IP, length);
+        for(n = 0; (size_t) n * MAX_FRAGMENT < datagram_length; n++)
+        {
+            starts[n] = (size_t) n * MAX_FRAGMENT;
+            ends[n] = starts[n] + MAX_FRAGMENT < datagram_length ? starts[n] + MAX_FRAGMENT : datagram_length;
+        }
+        for(reverse = 0; reverse < (n > 1 ? 2 : 1); reverse++)
+        {
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            for(j = 0; j < rounds; j++)
+            {
+                for(i = 0; i < n; i++)
+                    queue_fragment(starts[reverse ? n - 1 - i : i], ends[reverse ? n - 1 - i : i]);
+                run_ip_task();
+            }
+            ns = elapsed_ns(&t0) / rounds;
+            printf("receive %4zu bytes, %d frame(s)%s %7.1f ns %7.1f MB/s\n",
+                   length, n, reverse ? ", reversed" : "          ", ns, length * 1e3 / ns);
+        }
+
+        memcpy(data, datagram + ipIP_PAYLOAD_OFFSET + ipSIZE_OF_UDP_HEADER, length);
+        vARPRefreshCacheEntry(&peer_mac, FreeRTOS_htonl(PEER_IP));
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        for(j = 0; j < rounds; j++)
+        {
+            send_datagram(data, length, pdTRUE);
+            clear_frames();
+        }
+        ns = elapsed_ns(&t0) / rounds;
+        printf("send    %4zu bytes, %d frame(s)           %7.1f ns %7.1f MB/s\n", length, n, ns, length * 1e3 / ns);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long rounds = 0;
+    int i;
+
+    for(i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+            rounds = strtoul(argv[++i], NULL, 0);
+        else
+            break;
+    }
+    if(i < argc)
+    {
+        fprintf(stderr, "usage: reassembly [-b datagrams]\n");
+        return 2;
+    }
+
+    tick_count = 1000;
+    if(FreeRTOS_IPInit(local_ip, net_mask, gateway, gateway, local_mac) != pdPASS || ip_task == NULL)
+    {
+        fprintf(stderr, "reassembly: FreeRTOS_IPInit() failed\n");
+        return 2;
+    }
+    run_ip_task();
+    check(FreeRTOS_IsNetworkUp() != pdFALSE, "the network did not come up");
+
+    test_order();
+    test_overlap();
+    test_corrupt();
+    test_malformed();
+    test_eviction();
+    test_round_trip();
+    check(allocated == released, "a network buffer was not released");
+    printf("ipconfigIP_REASSEMBLY_MAX_SIZE %d, ipconfigDRIVER_INCLUDED_RX_IP_CHECKSUM %d: %lu checks, %lu failures\n",
+           ipconfigIP_REASSEMBLY_MAX_SIZE, ipconfigDRIVER_INCLUDED_RX_IP_CHECKSUM, checks, failures);
+
+    if(rounds != 0)
+        benchmark(rounds);
+
+    return failures != 0;
+}
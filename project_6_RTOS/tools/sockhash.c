@@ -0,0 +1,290 @@
+/** @file sockhash.c
+ *
+ * @brief Host side test and benchmark of the socket lookup of FreeRTOS+TCP
+ *
+ * @par
+ * Binds a listening socket with a number of child connections on port 7,
+ * 20 client sockets and 10 UDP sockets through the real vSocketBind(), and
+ * checks pxTCPSocketLookup() and pxUDPSocketLookup() against a walk of the
+ * bound socket lists, the way the stack looked sockets up before
+ * ipconfigUSE_SOCKET_HASH. The queries mix connected peers, listening
+ * ports, unknown peers of a listening port and ports nobody is bound to,
+ * while child sockets are closed and reopened in between. It then times the
+ * lookups, the per packet cost in the IP-task.
+ *
+ * @par
+ * Built by the Makefile in this directory twice, with the hash tables
+ * (sockhash) and with the list walk (sockhash_list):
+ *
+ *     make sockhash sockhash_list
+ *     ./sockhash -n 300
+ *
+ *     -n  child connections of the listening socket (default 300)
+ *     -i  lookups timed (default 2000000)
+ *
+ * @par
+ * The exit status is 1 if any lookup returned a different socket than the
+ * list walk.
+ *
+ * @author
+ * Carlos Santos
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "list.h"
+#include "FreeRTOS_IP.h"
+#include "FreeRTOS_Sockets.h"
+#include "FreeRTOS_IP_Private.h"
+
+#define ECHO_PORT       7
+#define CLIENTS         20
+#define UDP_SOCKETS     10
+#define MAX_CHILDREN    5000
+#define QUERIES         200000
+
+extern List_t xBoundTCPSocketsList;
+
+static FreeRTOS_Socket_t *children[MAX_CHILDREN];
+static int child_count;
+static uint32_t rng_state = 1;
+static unsigned long failures;
+
+/* The kernel and IP-task functions FreeRTOS_Sockets.c calls */
+void *pvPortMalloc(size_t xSize) { return malloc(xSize); }
+void vPortFree(void *pv) { free(pv); }
+void vTaskSuspendAll(void) { }
+BaseType_t xTaskResumeAll(void) { return pdFALSE; }
+void vEventGroupDelete(EventGroupHandle_t xEventGroup) { (void) xEventGroup; }
+void vReleaseNetworkBufferAndDescriptor(NetworkBufferDescriptor_t * const pxBuffer) { (void) pxBuffer; }
+void vTCPWindowDestroy(TCPWindow_t *pxWindow) { (void) pxWindow; }
+BaseType_t xIPIsNetworkTaskReady(void) { return pdTRUE; }
+
+static uint32_t rnd(uint32_t n)
+{
+    /* xorshift32 */
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state % n;
+}
+
+/* ipconfigRAND32(), for the automatic port numbers */
+UBaseType_t uxRand(void)
+{
+    return rnd(0xFFFFFFFFu) + 1;
+}
+
+static FreeRTOS_Socket_t *new_socket(uint8_t protocol)
+{
+    FreeRTOS_Socket_t *s = calloc(1, sizeof(*s));
+
+    if(s == NULL)
+    {
+        perror("sockhash");
+        exit(2);
+    }
+    s->ucProtocol = protocol;
+    vListInitialiseItem(&s->xBoundSocketListItem);
+    listSET_LIST_ITEM_OWNER(&s->xBoundSocketListItem, s);
+    return s;
+}
+
+static FreeRTOS_Socket_t *bind_socket(uint8_t protocol, uint16_t port, BaseType_t internal)
+{
+    FreeRTOS_Socket_t *s = new_socket(protocol);
+    struct freertos_sockaddr addr;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_port = FreeRTOS_htons(port);
+    if(vSocketBind(s, &addr, sizeof(addr), internal) != 0)
+    {
+        free(s);
+        return NULL;
+    }
+    return s;
+}
+
+/* A child socket of the listening socket, as prvHandleListen() makes it */
+static FreeRTOS_Socket_t *open_child(uint32_t remote_ip, uint16_t remote_port)
+{
+    FreeRTOS_Socket_t *s = bind_socket(FREERTOS_IPPROTO_TCP, ECHO_PORT, pdTRUE);
+
+    s->u.xTCP.ulRemoteIP = remote_ip;
+    s->u.xTCP.usRemotePort = remote_port;
+    s->u.xTCP.ucTCPState = eESTABLISHED;
+#if( ipconfigUSE_SOCKET_HASH == 1 )
+    vSocketHashAddConnection(s);
+#endif
+    return s;
+}
+
+/* pxTCPSocketLookup() as it was before ipconfigUSE_SOCKET_HASH */
+static FreeRTOS_Socket_t *reference_lookup(UBaseType_t local_port, uint32_t remote_ip, UBaseType_t remote_port)
+{
+    const MiniListItem_t *end = (const MiniListItem_t *) listGET_END_MARKER(&xBoundTCPSocketsList);
+    const ListItem_t *item;
+    FreeRTOS_Socket_t *listening = NULL;
+
+    for(item = listGET_NEXT(end); item != (const ListItem_t *) end; item = listGET_NEXT(item))
+    {
+        FreeRTOS_Socket_t *s = listGET_LIST_ITEM_OWNER(item);
+
+        if(s->usLocalPort != (uint16_t) local_port)
+            continue;
+        if(s->u.xTCP.ucTCPState == eTCP_LISTEN)
+            listening = s;
+        else if(s->u.xTCP.usRemotePort == (uint16_t) remote_port && s->u.xTCP.ulRemoteIP == remote_ip)
+            return s;
+    }
+    return listening;
+}
+
+static void check(const char *what, FreeRTOS_Socket_t *got, FreeRTOS_Socket_t *expected)
+{
+    if(got == expected)
+        return;
+    if(failures++ < 10)
+        printf("%s: got socket %p, expected %p\n", what, (void *) got, (void *) expected);
+}
+
+static double elapsed_ns(const struct timespec *t0)
+{
+    struct timespec t1;
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return (t1.tv_sec - t0->tv_sec) * 1e9 + (t1.tv_nsec - t0->tv_nsec);
+}
+
+int main(int argc, char **argv)
+{
+    FreeRTOS_Socket_t *listener, *clients[CLIENTS], *udp[UDP_SOCKETS];
+    unsigned long iterations = 2000000, j;
+    volatile uintptr_t sink = 0;
+    struct timespec t0;
+    int i, k;
+
+    child_count = 300;
+    for(i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            child_count = atoi(argv[++i]);
+        else if(strcmp(argv[i], "-i") == 0 && i + 1 < argc)
+            iterations = strtoul(argv[++i], NULL, 0);
+        else
+            child_count = 0;
+    }
+    if(child_count <= 0 || child_count > MAX_CHILDREN || iterations == 0)
+    {
+        fprintf(stderr, "usage: sockhash [-n children] [-i lookups]\n");
+        return 2;
+    }
+
+    vNetworkSocketsInit();
+    listener = bind_socket(FREERTOS_IPPROTO_TCP, ECHO_PORT, pdFALSE);
+    listener->u.xTCP.ucTCPState = eTCP_LISTEN;
+    for(i = 0; i < CLIENTS; i++)
+    {
+        /* Port 0: an automatic port, as for FreeRTOS_connect() */
+        clients[i] = bind_socket(FREERTOS_IPPROTO_TCP, 0, pdFALSE);
+        clients[i]->u.xTCP.ulRemoteIP = 0xC0A80001u;
+        clients[i]->u.xTCP.usRemotePort = (uint16_t) (80 + i);
+        clients[i]->u.xTCP.ucTCPState = eESTABLISHED;
+    }
+    for(i = 0; i < UDP_SOCKETS; i++)
+        udp[i] = bind_socket(FREERTOS_IPPROTO_UDP, (uint16_t) (5000 + i * 37), pdFALSE);
+    if(bind_socket(FREERTOS_IPPROTO_UDP, 5000, pdFALSE) != NULL)
+        check("second bind of UDP port 5000", udp[0], NULL);
+    for(i = 0; i < child_count; i++)
+        children[i] = open_child(0x0A000000u + (uint32_t) (i % 7), (uint16_t) (40000 + i));
+
+    for(k = 0; k < QUERIES; k++)
+    {
+        UBaseType_t local_port, remote_port;
+        uint32_t remote_ip;
+
+        switch(rnd(4))
+        {
+            case 0:     /* a connected child, or one closed since */
+                i = (int) rnd((uint32_t) child_count);
+                if(children[i] == NULL)
+                    continue;
+                local_port = ECHO_PORT;
+                remote_ip = children[i]->u.xTCP.ulRemoteIP;
+                remote_port = children[i]->u.xTCP.usRemotePort;
+                break;
+            case 1:     /* a client, its peer or another one */
+                i = (int) rnd(CLIENTS);
+                local_port = clients[i]->usLocalPort;
+                remote_ip = 0xC0A80001u;
+                remote_port = 80 + rnd(CLIENTS + 5);
+                break;
+            case 2:     /* new and known peers of the listening port */
+                local_port = ECHO_PORT;
+                remote_ip = 0x0A000000u + rnd(9);
+                remote_port = 40000 + rnd((uint32_t) child_count + 10);
+                break;
+            default:    /* mostly nobody */
+                local_port = rnd(0x10000);
+                remote_ip = rnd(3);
+                remote_port = rnd(0x10000);
+                break;
+        }
+        check("pxTCPSocketLookup", pxTCPSocketLookup(0, local_port, remote_ip, remote_port),
+              reference_lookup(local_port, remote_ip, remote_port));
+
+        if(k % 1000 == 0)
+        {
+            /* Close a child, or reopen one to another peer */
+            i = (int) rnd((uint32_t) child_count);
+            if(children[i] != NULL)
+            {
+                vSocketClose(children[i]);
+                children[i] = NULL;
+            }
+            else
+                children[i] = open_child(0x0A000000u + rnd(7), (uint16_t) rnd(0x10000));
+        }
+    }
+
+    for(i = 0; i < UDP_SOCKETS; i++)
+        check("pxUDPSocketLookup", pxUDPSocketLookup(FreeRTOS_htons(5000 + i * 37)), udp[i]);
+    check("pxUDPSocketLookup of an unbound port", pxUDPSocketLookup(FreeRTOS_htons(4999)), NULL);
+    vSocketClose(udp[3]);
+    check("pxUDPSocketLookup of a closed socket", pxUDPSocketLookup(FreeRTOS_htons(5000 + 3 * 37)), NULL);
+    udp[3] = bind_socket(FREERTOS_IPPROTO_UDP, 5000 + 3 * 37, pdFALSE);
+    check("pxUDPSocketLookup of a rebound port", pxUDPSocketLookup(FreeRTOS_htons(5000 + 3 * 37)), udp[3]);
+
+    printf("ipconfigUSE_SOCKET_HASH %d, %d children: %d queries, %lu failures\n",
+           ipconfigUSE_SOCKET_HASH, child_count, QUERIES, failures);
+
+    /* Time the lookups with every child connected */
+    for(i = 0; i < child_count; i++)
+    {
+        if(children[i] == NULL)
+            children[i] = open_child(0x0A000000u + (uint32_t) (i % 7), (uint16_t) (40000 + i));
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for(j = 0; j < iterations; j++)
+    {
+        FreeRTOS_Socket_t *s = children[rnd((uint32_t) child_count)];
+
+        sink += (uintptr_t) pxTCPSocketLookup(0, ECHO_PORT, s->u.xTCP.ulRemoteIP, s->u.xTCP.usRemotePort);
+    }
+    printf("TCP lookup: %.1f ns per packet\n", elapsed_ns(&t0) / iterations);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for(j = 0; j < iterations; j++)
+        sink += (uintptr_t) pxUDPSocketLookup(FreeRTOS_htons(5000 + rnd(UDP_SOCKETS) * 37));
+    printf("UDP lookup: %.1f ns per packet\n", elapsed_ns(&t0) / iterations);
+
+    vSocketClose(listener);
+    check("pxTCPSocketLookup after the listening socket closed", pxTCPSocketLookup(0, ECHO_PORT, 1, 1), NULL);
+
+    return failures != 0;
+}
@@ -0,0 +1,433 @@
+/** @file taskpool.c
+ *
+ * @brief Host side test of the task pool of the kernel
+ *
+ * @par
+ * Runs the real xTaskPoolSubmit() and workers of task_pool.c with the
+ * scheduling of the TCP Echo Server, where the acceptor runs above the pool:
+ * jobs are submitted back to back, and the workers only run when the test
+ * lets them. A worker runs until it waits on an empty backlog, or until its
+ * job blocks, which it then does for good. Two blocking jobs submitted before
+ * any worker ran must get a worker each, while jobs that come one at a time
+ * reuse the idle worker. The pool must never grow above its maximum, must
+ * undo what it counted for a job that found the backlog full or a worker that
+ * could not be created, and a worker that times out may only retire if the
+ * other idle workers are enough for the jobs waiting. Also checks the
+ * priorities the jobs run at, the completion call-backs and notifications,
+ * and the statistics.
+ *
+ * @par
+ * Built by the Makefile in this directory:
+ *
+ *     make taskpool
+ *     ./taskpool
+ *
+ * @par
+ * The exit status is 1 if a check failed.
+ *
+ * @author
+ * Carlos Santos
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "task_pool.h"
+
+#define MIN_WORKERS     1
+#define MAX_WORKERS     3
+#define BACKLOG         4
+#define IDLE_TIMEOUT    10000
+#define POOL_PRIORITY   tskIDLE_PRIORITY
+#define MAX_TASKS       16
+
+/* What a worker did when the test got control back */
+enum { WAITING = 1, BLOCKED, DELETED };
+
+typedef struct
+{
+    TaskFunction_t function;
+    void *parameters;
+    UBaseType_t priority;
+    BaseType_t deleted;
+    unsigned long notified;
+} Task_t;
+
+typedef struct
+{
+    uint8_t *items;
+    UBaseType_t length, size, head, count;
+} Queue_t;
+
+static TickType_t tick_count;
+static Task_t tasks[MAX_TASKS];
+static int task_count, current = -1;
+static BaseType_t fail_create, time_out;
+static jmp_buf worker_waits;
+
+/* The jobs that ran, by the worker that ran them */
+static int ran_on[8], job_priority[8], callbacks[8], order[8], runs;
+static TickType_t service_time;
+static unsigned long checks, failures;
+
+static void fail(const char *what)
+{
+    if(failures++ < 10)
+        printf("%s\n", what);
+}
+
+static void check(int ok, const char *what)
+{
+    checks++;
+    if(!ok)
+        fail(what);
+}
+
+/* The kernel functions the sources call */
+void *pvPortMalloc(size_t xSize) { return malloc(xSize); }
+void vPortFree(void *pv) { free(pv); }
+TickType_t xTaskGetTickCount(void) { return tick_count; }
+
+BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char * const pcName, const configSTACK_DEPTH_TYPE usStackDepth,
+                       void * const pvParameters, UBaseType_t uxPriority, TaskHandle_t * const pxCreatedTask)
+{
+    (void) pcName;
+    (void) usStackDepth;
+    if(fail_create || task_count == MAX_TASKS)
+        return errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;
+    memset(&tasks[task_count], 0, sizeof(tasks[task_count]));
+    tasks[task_count].function = pxTaskCode;
+    tasks[task_count].parameters = pvParameters;
+    tasks[task_count].priority = uxPriority;
+    if(pxCreatedTask != NULL)
+        *pxCreatedTask = (TaskHandle_t) &tasks[task_count];
+    task_count++;
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t xTaskToDelete)
+{
+    check(xTaskToDelete == NULL, "a worker deleted another task");
+    tasks[current].deleted = pdTRUE;
+    longjmp(worker_waits, DELETED);
+}
+
+void vTaskPrioritySet(TaskHandle_t xTask, UBaseType_t uxNewPriority)
+{
+    check(xTask == NULL, "a worker changed the priority of another task");
+    tasks[current].priority = uxNewPriority;
+}
+
+BaseType_t xTaskGenericNotify(TaskHandle_t xTaskToNotify, uint32_t ulValue, eNotifyAction eAction, uint32_t *pulPreviousNotificationValue)
+{
+    (void) ulValue;
+    (void) pulPreviousNotificationValue;
+    check(eAction == eIncrement, "a job was notified without xTaskNotifyGive()");
+    ((Task_t *) xTaskToNotify)->notified++;
+    return pdPASS;
+}
+
+/* The backlog */
+QueueHandle_t xQueueGenericCreate(const UBaseType_t uxQueueLength, const UBaseType_t uxItemSize, const uint8_t ucQueueType)
+{
+    Queue_t *queue = calloc(1, sizeof(*queue));
+
+    (void) ucQueueType;
+    queue->items = calloc(uxQueueLength, uxItemSize);
+    queue->length = uxQueueLength;
+    queue->size = uxItemSize;
+    return (QueueHandle_t) queue;
+}
+
+void vQueueDelete(QueueHandle_t xQueue)
+{
+    Queue_t *queue = (Queue_t *) xQueue;
+
+    free(queue->items);
+    free(queue);
+}
+
+UBaseType_t uxQueueMessagesWaiting(const QueueHandle_t xQueue)
+{
+    return ((Queue_t *) xQueue)->count;
+}
+
+/* The submitter runs above the workers, so a full backlog stays full however
+ * long it waits */
+BaseType_t xQueueGenericSend(QueueHandle_t xQueue, const void * const pvItemToQueue, TickType_t xTicksToWait, const BaseType_t xCopyPosition)
+{
+    Queue_t *queue = (Queue_t *) xQueue;
+    UBaseType_t slot;
+
+    (void) xTicksToWait;
+    if(queue->count == queue->length)
+        return errQUEUE_FULL;
+    if(xCopyPosition == queueSEND_TO_FRONT)
+        slot = queue->head = (queue->head + queue->length - 1) % queue->length;
+    else
+        slot = (queue->head + queue->count) % queue->length;
+    memcpy(queue->items + slot * queue->size, pvItemToQueue, queue->size);
+    queue->count++;
+    return pdPASS;
+}
+
+/* A worker waits when the backlog is empty: it leaves the task function, and
+ * is entered again the next time it runs.  With time_out set its time-out
+ * expires, even with jobs in the backlog: they were submitted after it
+ * expired, before the worker ran again. */
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void * const pvBuffer, TickType_t xTicksToWait)
+{
+    Queue_t *queue = (Queue_t *) xQueue;
+
+    if(time_out && xTicksToWait != portMAX_DELAY)
+    {
+        time_out = pdFALSE;
+        return pdFAIL;
+    }
+    if(queue->count == 0)
+        longjmp(worker_waits, WAITING);
+    memcpy(pvBuffer, queue->items + queue->head * queue->size, queue->size);
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    return pdPASS;
+}
+
+/* Runs worker n until it waits, its job blocks, or it deletes itself */
+static int run_worker(int n)
+{
+    int how;
+
+    if(n >= task_count || tasks[n].deleted)
+    {
+        fail("a worker that does not exist was run");
+        return 0;
+    }
+    how = setjmp(worker_waits);
+    if(how == 0)
+    {
+        current = n;
+        tasks[n].function(tasks[n].parameters);
+    }
+    current = -1;
+    return how;
+}
+
+static void job(void *pvParameters)
+{
+    int n = (int) (intptr_t) pvParameters;
+
+    ran_on[n] = current;
+    order[n] = runs++;
+    job_priority[n] = (int) tasks[current].priority;
+    tick_count += service_time;
+}
+
+/* Serves a connection: never returns while the test runs */
+static void blocking_job(void *pvParameters)
+{
+    int n = (int) (intptr_t) pvParameters;
+
+    ran_on[n] = current;
+    order[n] = runs++;
+    longjmp(worker_waits, BLOCKED);
+}
+
+static void completed(void *pvParameters)
+{
+    callbacks[(int) (intptr_t) pvParameters]++;
+}
+
+static BaseType_t submit(TaskPoolHandle_t pool, TaskPoolFunction_t function, int n, UBaseType_t priority)
+{
+    TaskPoolJob_t job = { function, (void *) (intptr_t) n, priority, completed, NULL };
+
+    return xTaskPoolSubmit(pool, &job, 0);
+}
+
+static TaskPoolHandle_t create(UBaseType_t min, UBaseType_t max, UBaseType_t backlog)
+{
+    int i;
+
+    task_count = 0;
+    for(i = 0; i < 8; i++)
+    {
+        ran_on[i] = -1;
+        job_priority[i] = -1;
+        callbacks[i] = 0;
+    }
+    return xTaskPoolCreate("Echo", min, max, 2048, POOL_PRIORITY, backlog, IDLE_TIMEOUT);
+}
+
+static UBaseType_t workers(TaskPoolHandle_t pool)
+{
+    TaskPoolStats_t stats;
+    UBaseType_t running = 0;
+    int i;
+
+    for(i = 0; i < task_count; i++)
+        running += !tasks[i].deleted;
+    vTaskPoolGetStats(pool, &stats);
+    check(stats.uxWorkers == running, "the pool counts workers that do not exist");
+    return stats.uxWorkers;
+}
+
+/* The echo server accepts two connections before the worker it has runs */
+static void test_back_to_back(void)
+{
+    TaskPoolHandle_t pool = create(MIN_WORKERS, MAX_WORKERS, BACKLOG);
+    TaskPoolStats_t stats;
+
+    check(run_worker(0) == WAITING, "the first worker does not wait for a job");
+    check(submit(pool, blocking_job, 0, taskpoolPOOL_PRIORITY) == pdPASS, "a job was rejected");
+    check(workers(pool) == 1, "the pool grew while a worker was idle");
+    check(submit(pool, blocking_job, 1, taskpoolPOOL_PRIORITY) == pdPASS, "a job was rejected");
+    check(workers(pool) == 2, "two jobs submitted back to back share one worker");
+
+    check(run_worker(0) == BLOCKED, "the first job did not run");
+    check(run_worker(1) == BLOCKED, "the second job did not get the new worker");
+    check(ran_on[0] == 0 && ran_on[1] == 1, "the jobs ran on the wrong workers");
+
+    check(submit(pool, blocking_job, 2, taskpoolPOOL_PRIORITY) == pdPASS, "a job was rejected");
+    check(workers(pool) == 3, "the pool did not grow while every worker was busy");
+    check(submit(pool, blocking_job, 3, taskpoolPOOL_PRIORITY) == pdPASS, "a job was rejected");
+    check(workers(pool) == MAX_WORKERS, "the pool grew above its maximum");
+    check(run_worker(2) == BLOCKED && ran_on[2] == 2, "the third job did not get the third worker");
+    check(ran_on[3] == -1, "a job ran without a worker");
+
+    vTaskPoolGetStats(pool, &stats);
+    check(stats.ulJobsSubmitted == 4 && stats.uxPeakWorkers == MAX_WORKERS && stats.uxPeakBacklog == 2,
+          "the statistics are wrong after the blocking jobs");
+}
+
+/* Jobs that come one at a time all run on the worker the pool starts with */
+static void test_one_at_a_time(void)
+{
+    TaskPoolHandle_t pool = create(MIN_WORKERS, MAX_WORKERS, BACKLOG);
+    TaskPoolJob_t notify = { job, (void *) 3, taskpoolPOOL_PRIORITY, NULL, NULL };
+    TaskPoolStats_t stats;
+    int i;
+
+    tasks[MAX_TASKS - 1].notified = 0;
+    notify.xTaskToNotify = (TaskHandle_t) &tasks[MAX_TASKS - 1];
+    service_time = 5;
+    for(i = 0; i < 3; i++)
+    {
+        check(submit(pool, job, i, i == 2 ? POOL_PRIORITY + 2 : taskpoolPOOL_PRIORITY) == pdPASS, "a job was rejected");
+        tick_count += 10;
+        check(run_worker(0) == WAITING, "the worker does not wait for the next job");
+        check(workers(pool) == 1, "the pool grew although its worker was idle");
+        check(ran_on[i] == 0 && callbacks[i] == 1, "a job did not run once on the worker");
+    }
+    check(job_priority[0] == POOL_PRIORITY && job_priority[2] == POOL_PRIORITY + 2, "a job ran at the wrong priority");
+    check(tasks[0].priority == POOL_PRIORITY, "the worker did not go back to the priority of the pool");
+
+    check(xTaskPoolSubmit(pool, &notify, 0) == pdPASS, "a job was rejected");
+    check(run_worker(0) == WAITING && tasks[MAX_TASKS - 1].notified == 1, "the task waiting for the job was not notified");
+
+    vTaskPoolGetStats(pool, &stats);
+    check(stats.ulJobsCompleted == 4 && stats.ulMaxQueueingDelay == 10 && stats.ulTotalQueueingDelay == 30
+          && stats.ulMaxServiceTime == 5 && stats.ulTotalServiceTime == 20,
+          "the statistics are wrong after the short jobs");
+    service_time = 0;
+}
+
+/* A job above the priority of the pool goes ahead of the others */
+static void test_priority(void)
+{
+    TaskPoolHandle_t pool = create(1, 1, BACKLOG);
+
+    check(submit(pool, job, 0, taskpoolPOOL_PRIORITY) == pdPASS, "a job was rejected");
+    check(submit(pool, job, 1, POOL_PRIORITY + 1) == pdPASS, "a job was rejected");
+    check(submit(pool, blocking_job, 2, taskpoolPOOL_PRIORITY) == pdPASS, "a job was rejected");
+    check(workers(pool) == 1, "a fixed size pool grew");
+    check(run_worker(0) == BLOCKED, "the blocking job did not run");
+    check(job_priority[1] == POOL_PRIORITY + 1 && job_priority[0] == POOL_PRIORITY, "a job ran at the wrong priority");
+    check(ran_on[0] == 0 && ran_on[1] == 0 && callbacks[1] == 1 && callbacks[0] == 1, "the jobs did not run");
+    check(order[1] < order[0] && order[0] < order[2], "the job above the priority of the pool did not go first");
+}
+
+/* What was counted for a job that is rejected, or for a worker that could not
+ * be created, is given back */
+static void test_failures(void)
+{
+    TaskPoolHandle_t pool = create(1, 2, 1);
+    TaskPoolStats_t stats;
+
+    check(submit(pool, blocking_job, 0, taskpoolPOOL_PRIORITY) == pdPASS, "a job was rejected");
+    check(submit(pool, blocking_job, 1, taskpoolPOOL_PRIORITY) == errQUEUE_FULL, "a job was accepted into a full backlog");
+    check(workers(pool) == 2, "no worker was reserved for the rejected job");
+    check(run_worker(0) == BLOCKED && ran_on[0] == 0, "the first job did not run");
+    check(submit(pool, blocking_job, 2, taskpoolPOOL_PRIORITY) == pdPASS, "a job was rejected");
+    check(workers(pool) == 2, "the pool grew although the worker of the rejected job was idle");
+    check(run_worker(1) == BLOCKED && ran_on[2] == 1, "the job did not get the worker of the rejected job");
+    vTaskPoolGetStats(pool, &stats);
+    check(stats.ulJobsRejected == 1 && stats.ulJobsSubmitted == 2, "the rejected job was not counted");
+
+    pool = create(1, 2, BACKLOG);
+    fail_create = pdTRUE;
+    check(submit(pool, blocking_job, 0, taskpoolPOOL_PRIORITY) == pdPASS, "a job was rejected");
+    check(submit(pool, blocking_job, 1, taskpoolPOOL_PRIORITY) == pdPASS, "a job was rejected");
+    check(workers(pool) == 1, "a worker that could not be created was counted");
+    fail_create = pdFALSE;
+    check(submit(pool, blocking_job, 2, taskpoolPOOL_PRIORITY) == pdPASS, "a job was rejected");
+    check(workers(pool) == 2, "the pool did not grow once it could");
+    check(run_worker(0) == BLOCKED && run_worker(1) == BLOCKED && ran_on[0] == 0 && ran_on[1] == 1,
+          "the jobs did not run on both workers");
+}
+
+/* A worker may only retire if the other idle workers are enough for the jobs
+ * waiting */
+static void test_retire(void)
+{
+    TaskPoolHandle_t pool = create(MIN_WORKERS, MAX_WORKERS, BACKLOG);
+    int i;
+
+    for(i = 0; i < 3; i++)
+        check(submit(pool, job, i, taskpoolPOOL_PRIORITY) == pdPASS, "a job was rejected");
+    check(workers(pool) == 3, "the pool did not grow for three jobs");
+    for(i = 0; i < 3; i++)
+        check(run_worker(i) == WAITING && callbacks[i] == 1, "a job did not run");
+
+    /* Two jobs for three idle workers, and all three time out before either
+     * job is taken */
+    check(submit(pool, job, 3, taskpoolPOOL_PRIORITY) == pdPASS && submit(pool, job, 4, taskpoolPOOL_PRIORITY) == pdPASS,
+          "a job was rejected");
+    check(workers(pool) == 3, "the pool grew although workers were idle");
+    time_out = pdTRUE;
+    check(run_worker(2) == DELETED, "a spare worker did not retire");
+    check(workers(pool) == 2, "a retired worker is still counted");
+    time_out = pdTRUE;
+    check(run_worker(1) == WAITING && !tasks[1].deleted, "a worker retired although a job needed it");
+    check(ran_on[3] == 1 && ran_on[4] == 1, "the jobs did not run on the worker that stayed");
+
+    time_out = pdTRUE;
+    check(run_worker(1) == DELETED, "an idle worker above the minimum did not retire");
+    time_out = pdTRUE;
+    check(run_worker(0) == WAITING && !tasks[0].deleted, "the pool went below its minimum");
+    check(workers(pool) == MIN_WORKERS, "the pool did not shrink to its minimum");
+}
+
+int main(int argc, char **argv)
+{
+    (void) argv;
+    if(argc > 1)
+    {
+        fprintf(stderr, "usage: taskpool\n");
+        return 2;
+    }
+
+    tick_count = 1000;
+    test_back_to_back();
+    test_one_at_a_time();
+    test_priority();
+    test_failures();
+    test_retire();
+    printf("task pool: %lu checks, %lu failures\n", checks, failures);
+
+    return failures != 0;
+}
@@ -0,0 +1,289 @@
+/** @file tcptimer.c
+ *
+ * @brief Host side test and benchmark of the TCP time-outs of FreeRTOS+TCP
+ *
+ * @par
+ * First checks that a listening socket hears of a new connection: a child
+ * socket goes through the real vTCPStateChange() to eESTABLISHED, and the
+ * listening socket must get eSOCKET_ACCEPT in its event group and, with
+ * ipconfigUSE_TCP_TIMER_WHEEL, be queued for the next xTCPTimerCheck() like
+ * every socket of which the events have changed.
+ *
+ * @par
+ * Then runs xTCPTimerCheck() the way the IP-task does, sleeping for the time
+ * it returns, over a number of bound sockets: most of them idle keep-alive
+ * connections with a 20 s time-out, a few active ones with time-outs of 5 to
+ * 200 ms. Now and then the IP-task wakes up early, as it does for a packet,
+ * and a random socket is kicked with a time-out of 1 tick, as the API calls
+ * do. The tick count wraps during the run. xTCPSocketCheck() is replaced by
+ * one that records when each socket is checked and sets its next time-out.
+ * The report gives the checks that came early or late and the time per pass.
+ *
+ * @par
+ * Built by the Makefile in this directory with the timing wheel (tcptimer)
+ * and with the list walk (tcptimer_list):
+ *
+ *     make tcptimer tcptimer_list
+ *     ./tcptimer -n 1000
+ *
+ *     -n  bound sockets (default 1000)
+ *     -a  active sockets among them (default 8)
+ *     -t  ticks to run (default 600000)
+ *
+ * @par
+ * The exit status is 1 if the listening socket was not woken up, or if a
+ * socket was checked late. The list walk checks some sockets a tick early,
+ * the timing wheel may not.
+ *
+ * @author
+ * Carlos Santos
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "list.h"
+#include "event_groups.h"
+#include "FreeRTOS_IP.h"
+#include "FreeRTOS_Sockets.h"
+#include "FreeRTOS_IP_Private.h"
+
+#define MAX_SOCKETS     20000
+#define IDLE_PERIOD     20000   /* ticks */
+
+static FreeRTOS_Socket_t *sockets[MAX_SOCKETS];
+static TickType_t period[MAX_SOCKETS], due[MAX_SOCKETS];
+static char kicked[MAX_SOCKETS];
+static unsigned long checks, early, late, max_late, failures;
+static TickType_t tick_count;
+static uint32_t rng_state = 1;
+
+/* An event group is the bits set in it */
+typedef struct {
+    EventBits_t bits;
+} test_event_group;
+
+/* The kernel and IP-task functions the sources call */
+void *pvPortMalloc(size_t xSize) { return malloc(xSize); }
+void vPortFree(void *pv) { free(pv); }
+void vTaskSuspendAll(void) { }
+BaseType_t xTaskResumeAll(void) { return pdFALSE; }
+void vTaskEnterCritical(void) { }
+void vTaskExitCritical(void) { }
+TickType_t xTaskGetTickCount(void) { return tick_count; }
+void vEventGroupDelete(EventGroupHandle_t xEventGroup) { (void) xEventGroup; }
+void vReleaseNetworkBufferAndDescriptor(NetworkBufferDescriptor_t * const pxBuffer) { (void) pxBuffer; }
+void vTCPWindowDestroy(TCPWindow_t *pxWindow) { (void) pxWindow; }
+BaseType_t xIPIsNetworkTaskReady(void) { return pdTRUE; }
+BaseType_t xSendEventToIPTask(eIPEvent_t eEvent) { (void) eEvent; return pdPASS; }
+BaseType_t xSendEventStructToIPTask(const IPStackEvent_t *pxEvent, TickType_t uxTimeout) { (void) pxEvent; (void) uxTimeout; return pdPASS; }
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToSet)
+{
+    test_event_group *group = (test_event_group *) xEventGroup;
+
+    group->bits |= uxBitsToSet;
+    return group->bits;
+}
+
+static uint32_t rnd(uint32_t n)
+{
+    /* xorshift32 */
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state % n;
+}
+
+/* ipconfigRAND32(), for the automatic port numbers */
+UBaseType_t uxRand(void)
+{
+    return rnd(0xFFFFFFFFu) + 1;
+}
+
+/* Stands in for the real xTCPSocketCheck(), with -Wl,--wrap: records how
+ * far off the time-out of the socket was, and sets the next one. */
+BaseType_t __wrap_xTCPSocketCheck(FreeRTOS_Socket_t *pxSocket)
+{
+    int i = (int) pxSocket->usLocalPort - 1000;
+    int32_t off = (int32_t) (tick_count - due[i]);
+
+    checks++;
+    if(kicked[i])
+    {
+        kicked[i] = 0;
+        off = 0;
+    }
+    if(off < 0)
+        early++;
+    else if(off > 0)
+    {
+        late++;
+        if((unsigned long) off > max_late)
+            max_late = (unsigned long) off;
+    }
+    pxSocket->u.xTCP.usTimeout = (uint16_t) period[i];
+    due[i] = tick_count + period[i];
+    ipTCP_TIMER_SOCKET_CHANGED(pxSocket);
+    return 0;
+}
+
+static FreeRTOS_Socket_t *bind_tcp_socket(uint16_t port, BaseType_t internal)
+{
+    FreeRTOS_Socket_t *s = calloc(1, sizeof(*s));
+    struct freertos_sockaddr addr;
+
+    if(s == NULL)
+    {
+        perror("tcptimer");
+        exit(2);
+    }
+    s->ucProtocol = FREERTOS_IPPROTO_TCP;
+    vListInitialiseItem(&s->xBoundSocketListItem);
+    listSET_LIST_ITEM_OWNER(&s->xBoundSocketListItem, s);
+#if( ipconfigUSE_TCP_TIMER_WHEEL == 1 )
+    vListInitialiseItem(&s->u.xTCP.xTimerListItem);
+    listSET_LIST_ITEM_OWNER(&s->u.xTCP.xTimerListItem, s);
+    vListInitialiseItem(&s->u.xTCP.xTimerChangedItem);
+    listSET_LIST_ITEM_OWNER(&s->u.xTCP.xTimerChangedItem, s);
+#endif
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_port = FreeRTOS_htons(port);
+    if(vSocketBind(s, &addr, sizeof(addr), internal) != 0)
+    {
+        fprintf(stderr, "tcptimer: cannot bind port %u\n", port);
+        exit(2);
+    }
+    return s;
+}
+
+static void fail(const char *what)
+{
+    failures++;
+    printf("%s\n", what);
+}
+
+/* A connection to a listening socket is established: the listening socket
+ * must be woken up, with or without a timing wheel. */
+static void test_accept(void)
+{
+    static test_event_group listener_group;
+    FreeRTOS_Socket_t *listener, *child;
+
+    listener = bind_tcp_socket(7, pdFALSE);
+    listener->u.xTCP.ucTCPState = eTCP_LISTEN;
+    listener->xEventGroup = (EventGroupHandle_t) &listener_group;
+
+    /* The IP-task has nothing to do for the listening socket */
+    xTCPTimerCheck(pdTRUE);
+
+    /* The child socket as prvHandleListen() creates it */
+    child = bind_tcp_socket(7, pdTRUE);
+    child->u.xTCP.ucTCPState = eSYN_RECEIVED;
+    child->u.xTCP.pxPeerSocket = listener;
+    child->u.xTCP.bits.bPassQueued = pdTRUE_UNSIGNED;
+    child->u.xTCP.ulRemoteIP = 0x0A000001u;
+    child->u.xTCP.usRemotePort = 40000;
+
+    listener_group.bits = 0;
+    vTCPStateChange(child, eESTABLISHED);
+#if( ipconfigUSE_TCP_TIMER_WHEEL == 1 )
+    if(listLIST_ITEM_CONTAINER(&listener->u.xTCP.xTimerChangedItem) == NULL)
+        fail("the listening socket was not queued for xTCPTimerCheck()");
+#endif
+    xTCPTimerCheck(pdTRUE);
+    if((listener_group.bits & eSOCKET_ACCEPT) == 0)
+        fail("the listening socket did not get eSOCKET_ACCEPT");
+    if(listener->u.xTCP.pxPeerSocket != child || child->u.xTCP.bits.bPassAccept == pdFALSE_UNSIGNED)
+        fail("the child socket cannot be accepted");
+
+    vSocketClose(child);
+    vSocketClose(listener);
+}
+
+int main(int argc, char **argv)
+{
+    int count = 1000, active = 8, i;
+    TickType_t ticks = 600000, end, sleep;
+    unsigned long passes = 0, kicks = 0;
+    struct timespec t0, t1;
+    double ns;
+
+    for(i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            count = atoi(argv[++i]);
+        else if(strcmp(argv[i], "-a") == 0 && i + 1 < argc)
+            active = atoi(argv[++i]);
+        else if(strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+            ticks = (TickType_t) strtoul(argv[++i], NULL, 0);
+        else
+            count = 0;
+    }
+    if(count <= 0 || count > MAX_SOCKETS || active < 0 || active > count)
+    {
+        fprintf(stderr, "usage: tcptimer [-n sockets] [-a active] [-t ticks]\n");
+        return 2;
+    }
+
+    /* Wrap during the run */
+    tick_count = 0xFFFF0000u;
+    end = tick_count + ticks;
+
+    vNetworkSocketsInit();
+    test_accept();
+
+    for(i = 0; i < count; i++)
+    {
+        sockets[i] = bind_tcp_socket((uint16_t) (1000 + i), pdTRUE);
+        sockets[i]->u.xTCP.ucTCPState = eESTABLISHED;
+        period[i] = (i < active) ? 5 + rnd(195) : IDLE_PERIOD;
+        sockets[i]->u.xTCP.usTimeout = (uint16_t) (1 + rnd(period[i]));
+        due[i] = tick_count + sockets[i]->u.xTCP.usTimeout;
+        ipTCP_TIMER_SOCKET_CHANGED(sockets[i]);
+    }
+
+    /* The time-outs were set in the tick of the last pass, the one in
+     * test_accept(), and run from the next tick on */
+    tick_count++;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    while((int32_t) (end - tick_count) > 0)
+    {
+        sleep = xTCPTimerCheck(pdTRUE);
+        passes++;
+        if(sleep == 0)
+            sleep = 1;
+        if(rnd(50) == 0)
+            sleep = 1 + rnd(sleep);     /* a packet came in */
+        tick_count += sleep;
+        if(rnd(100) == 0)
+        {
+            i = (int) rnd((uint32_t) count);
+            kicks++;
+            sockets[i]->u.xTCP.usTimeout = 1u;
+            kicked[i] = 1;
+            ipTCP_TIMER_SOCKET_CHANGED(sockets[i]);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+
+    printf("ipconfigUSE_TCP_TIMER_WHEEL %d, %d sockets (%d active), %lu ticks\n",
+           ipconfigUSE_TCP_TIMER_WHEEL, count, active, (unsigned long) ticks);
+    printf("%lu passes, %lu checks, %lu kicks: %lu early, %lu late (at most %lu ticks)\n",
+           passes, checks, kicks, early, late, max_late);
+    printf("%.0f ns per pass\n", ns / passes);
+
+    if(late != 0)
+        fail("sockets were checked late");
+#if( ipconfigUSE_TCP_TIMER_WHEEL == 1 )
+    if(early != 0)
+        fail("sockets were checked early");
+#endif
+    return failures != 0;
+}
@@ -0,0 +1,486 @@
+/** @file tcpwin.c
+ *
+ * @brief Host side test and benchmark of the TCP sliding windows of
+ * FreeRTOS+TCP
+ *
+ * @par
+ * Runs the receiving and the sending side of FreeRTOS_TCP_WIN.c against a
+ * simulated peer. On the receiving side the peer sends within the window and
+ * segments are lost, reordered and duplicated; every return value of
+ * lTCPWindowRxCheck() is checked against a model of the data received, and
+ * so is every SACK option: its blocks may only hold received data, must not
+ * overlap and must be as long as the data allows, the first one must hold
+ * the segment that just came in, and with ipconfigTCP_SACK_BLOCKS above 1
+ * each block must be a different run of received data. On the
+ * sending side segments are lost, and the peer acknowledges and SACKs what it
+ * got. The sequence numbers wrap through 0. With
+ * ipconfigTCP_WIN_USE_SEGMENT_TREE the segment trees must stay balanced and
+ * ordered, and hold the segments of the lists. After each run every segment
+ * descriptor must be back in the pool.
+ *
+ * @par
+ * The results of all calls are summed in a digest, which must be the same
+ * with and without the tree.
+ *
+ * @par
+ * Built by the Makefile in this directory with the segment tree (tcpwin) and
+ * with the lists (tcpwin_linear), with a pool of 512 segment descriptors:
+ *
+ *     make tcpwin tcpwin_linear
+ *     ./tcpwin -b 200000
+ *
+ *     -b  segments for each benchmark (default 0, no benchmark)
+ *     -d  only print the digest
+ *
+ * @par
+ * The exit status is 1 if a check failed.
+ *
+ * @author
+ * Carlos Santos
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "list.h"
+#include "FreeRTOS_IP.h"
+#include "FreeRTOS_TCP_WIN.h"
+
+#define MSS             1460u
+#define MAX_SEGMENTS    4096
+#define SLOTS           8192
+#define PER_SLOT        8
+
+static TickType_t tick_count;
+static TCPWindow_t window;
+static uint64_t digest = 1469598103934665603ULL;
+static unsigned long sack_options, sack_blocks;
+static uint32_t rng_state = 1;
+static unsigned long checks, failures;
+
+/* What the receiver got, what the peer got from the sender, and the segments
+ * on their way to the receiver, by time slot */
+static uint8_t received[MAX_SEGMENTS], peer[MAX_SEGMENTS];
+static int16_t in_flight[SLOTS][PER_SLOT];
+static uint8_t in_flight_count[SLOTS];
+
+static uint32_t rnd(uint32_t n)
+{
+    /* xorshift32 */
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state % n;
+}
+
+static void fail(const char *what)
+{
+    if(failures++ < 10)
+        printf("%s\n", what);
+}
+
+static void check(int ok, const char *what)
+{
+    checks++;
+    if(!ok)
+        fail(what);
+}
+
+/* The kernel functions the sources call */
+void *pvPortMalloc(size_t xSize) { return malloc(xSize); }
+void vPortFree(void *pv) { free(pv); }
+TickType_t xTaskGetTickCount(void) { return tick_count; }
+
+/* FNV-1a */
+static void mix(uint32_t value)
+{
+    digest ^= value;
+    digest *= 1099511628211ULL;
+}
+
+static int before(uint32_t a, uint32_t b)
+{
+    return (int32_t) (a - b) < 0;
+}
+
+#if( ipconfigTCP_WIN_USE_SEGMENT_TREE != 0 )
+
+static int check_tree(const TCPSegment_t *segment, UBaseType_t *count, const TCPSegment_t **previous)
+{
+    int left, right;
+
+    if(segment == NULL)
+        return 0;
+    left = check_tree(segment->pxLeft, count, previous);
+    if(*previous != NULL)
+        check(before((*previous)->ulSequenceNumber, segment->ulSequenceNumber), "a segment tree is out of order");
+    *previous = segment;
+    (*count)++;
+    right = check_tree(segment->pxRight, count, previous);
+    check(left - right <= 1 && right - left <= 1, "a segment tree is out of balance");
+    check(segment->ucHeight == (left > right ? left : right) + 1, "a segment has the wrong height");
+    return segment->ucHeight;
+}
+
+static int in_tree(const TCPSegment_t *node, const TCPSegment_t *segment)
+{
+    while(node != NULL && node != segment)
+        node = before(segment->ulSequenceNumber, node->ulSequenceNumber) ? node->pxLeft : node->pxRight;
+    return node != NULL;
+}
+
+/* The send tree holds the segments of the list that are not acknowledged */
+static void check_trees(void)
+{
+    const TCPSegment_t *previous = NULL, *segment;
+    const ListItem_t *item;
+    UBaseType_t count = 0, waiting = 0;
+
+    check_tree(window.pxRxTree, &count, &previous);
+    check(count == listCURRENT_LIST_LENGTH(&window.xRxSegments), "the receive tree and list differ");
+    previous = NULL;
+    count = 0;
+    check_tree(window.pxTxTree, &count, &previous);
+    for(item = listGET_HEAD_ENTRY(&window.xTxSegments); item != listGET_END_MARKER(&window.xTxSegments); item = listGET_NEXT(item))
+    {
+        segment = listGET_LIST_ITEM_OWNER(item);
+        if(segment->u.bits.bAcked == pdFALSE_UNSIGNED)
+        {
+            waiting++;
+            check(in_tree(window.pxTxTree, segment), "an unacknowledged segment is not in the send tree");
+        }
+    }
+    check(count == waiting, "the send tree and list differ");
+}
+
+#else
+
+static void check_trees(void) { }
+
+#endif /* ipconfigTCP_WIN_USE_SEGMENT_TREE */
+
+static void new_window(uint32_t isn)
+{
+    memset(&window, 0, sizeof(window));
+    vTCPWindowCreate(&window, 1u << 20, 1u << 20, isn, isn, MSS);
+    window.usMSS = MSS;
+}
+
+/* Every segment descriptor must be back in the pool: a new window can take
+ * them all */
+static void check_pool(void)
+{
+    int count = 0;
+
+    new_window(0);
+    while(count <= ipconfigTCP_WIN_SEG_COUNT && lTCPWindowTxAdd(&window, MSS, count * (int32_t) MSS, 1 << 24) != 0)
+        count++;
+    vTCPWindowDestroy(&window);
+    check(count == ipconfigTCP_WIN_SEG_COUNT, "a segment descriptor was not returned to the pool");
+}
+
+/* The SACK option of the window, after the segment index came in (-1 for
+ * none) */
+static void check_sack(uint32_t base, int index, int expected)
+{
+    const uint8_t *option = (const uint8_t *) window.ulOptionsData;
+    uint32_t current = (window.rx.ulCurrentSequenceNumber - base) / MSS;
+    uint32_t first[4], last[4];
+    int blocks, runs, i, j;
+
+    if(window.ucOptionLength == 0)
+    {
+        check(!expected, "a SACK option is missing");
+        return;
+    }
+    check(option[0] == 1 && option[1] == 1 && option[2] == 5 && option[3] == window.ucOptionLength - 2,
+          "a SACK option is malformed");
+    blocks = (window.ucOptionLength - 4) / 8;
+    if(blocks < 1 || blocks > ipconfigTCP_SACK_BLOCKS)
+    {
+        fail("a SACK option has the wrong number of blocks");
+        return;
+    }
+    sack_options++;
+    sack_blocks += blocks;
+    for(i = 0; i < blocks; i++)
+    {
+        uint32_t from = FreeRTOS_ntohl(window.ulOptionsData[1 + 2 * i]) - base;
+        uint32_t to = FreeRTOS_ntohl(window.ulOptionsData[2 + 2 * i]) - base;
+
+        check(from % MSS == 0 && to % MSS == 0 && to > from && to / MSS < MAX_SEGMENTS, "a SACK block is not made of segments");
+        first[i] = from / MSS;
+        last[i] = to / MSS;
+        if(last[i] >= MAX_SEGMENTS || first[i] >= last[i])
+            return;
+        check(first[i] > current, "a SACK block holds data that was acknowledged");
+        for(j = (int) first[i]; j < (int) last[i]; j++)
+            check(received[j], "a SACK block holds data that was not received");
+#if( ipconfigTCP_WIN_USE_SEGMENT_TREE != 0 )
+        check(!received[first[i] - 1], "a SACK block could start earlier");
+#endif
+        check(!received[last[i]], "a SACK block could end later");
+        for(j = 0; j < i; j++)
+            check(last[j] < first[i] || last[i] < first[j], "two SACK blocks overlap");
+    }
+    if(index >= 0)
+        check(first[0] <= (uint32_t) index && (uint32_t) index < last[0], "the first SACK block does not hold the segment received");
+#if( ipconfigTCP_SACK_BLOCKS > 1 )
+    for(runs = 0, j = (int) current + 1; j < MAX_SEGMENTS - 1; j++)
+        if(received[j] && !received[j - 1])
+            runs++;
+    check(blocks <= runs, "a SACK option has more blocks than runs of received data");
+#else
+    (void) runs;
+#endif
+}
+
+static void send_later(uint32_t slot, int index)
+{
+    while(in_flight_count[slot % SLOTS] == PER_SLOT)
+        slot++;
+    in_flight[slot % SLOTS][in_flight_count[slot % SLOTS]++] = (int16_t) index;
+}
+
+/* The peer sends segments within the window, loss percent of them are lost
+ * and sent again later, the others arrive up to depth slots late, dup
+ * percent of them twice */
+static void receive_run(uint32_t seed, int segments, int window_segments, int loss, int depth, int dup, int checking)
+{
+    uint32_t base = 0xFFFFF000u + seed * 7919u;
+    uint32_t slot = 0, current;
+    int next = 0, done = 0, index, i, j;
+    int32_t result;
+
+    rng_state = seed;
+    memset(received, 0, sizeof(received));
+    memset(in_flight_count, 0, sizeof(in_flight_count));
+    new_window(base);
+    while(done < segments)
+    {
+        current = (window.rx.ulCurrentSequenceNumber - base) / MSS;
+        while(next < segments && next < (int) current + window_segments && rnd(4) != 0)
+        {
+            if((int) rnd(100) < loss)
+                send_later(slot + 3 * depth + 1 + rnd(8), next);
+            else
+                send_later(slot + (depth ? rnd(depth + 1) : 0), next);
+            if((int) rnd(100) < dup)
+                send_later(slot + 1 + rnd(depth + 2), next);
+            next++;
+        }
+        for(i = 0; i < in_flight_count[slot % SLOTS]; i++)
+        {
+            index = in_flight[slot % SLOTS][i];
+            result = lTCPWindowRxCheck(&window, base + (uint32_t) index * MSS, MSS, (uint32_t) window_segments * MSS);
+            mix((uint32_t) result);
+            mix(window.ulUserDataLength);
+            mix(window.rx.ulCurrentSequenceNumber);
+            mix(listCURRENT_LIST_LENGTH(&window.xRxSegments));
+            if(result >= 0)
+                received[index] = 1;
+            if(checking)
+            {
+                current = (window.rx.ulCurrentSequenceNumber - base) / MSS;
+                for(j = 0; j < (int) current; j++)
+                    received[j] = 1;
+                check_trees();
+                if(result > 0)
+                    check_sack(base, index, 1);
+                else if(result == 0)
+                    check_sack(base, -1, 0);
+                else if(window.ucOptionLength != 0)
+                    check_sack(base, index, 1);
+            }
+            if(result < 0 && !received[index] && !before(base + (uint32_t) index * MSS, window.rx.ulCurrentSequenceNumber))
+            {
+                /* No segment descriptor for it: the peer sends it again */
+                send_later(slot + 5, index);
+            }
+        }
+        in_flight_count[slot % SLOTS] = 0;
+        slot++;
+        done = (int) ((window.rx.ulCurrentSequenceNumber - base) / MSS);
+        if(slot > 200000)
+        {
+            fail("the receiver did not get all data");
+            break;
+        }
+    }
+    check(listCURRENT_LIST_LENGTH(&window.xRxSegments) == 0, "received segments were left in the window");
+    vTCPWindowDestroy(&window);
+}
+
+/* The application adds segments within the window, loss percent of those
+ * sent are lost, the peer acknowledges the others and SACKs what it holds
+ * beyond the acknowledged data */
+static void send_run(uint32_t seed, int segments, int window_segments, int loss, int checking)
+{
+    uint32_t base = 0xFFFFE000u + seed * 104729u;
+    uint32_t length, sequence;
+    int added = 0, acknowledged = 0, rounds = 0, index, ack, from, to;
+    int32_t position, result;
+
+    rng_state = seed;
+    memset(peer, 0, sizeof(peer));
+    new_window(base);
+    window.lSRTT = 50;
+    while(acknowledged < segments && rounds++ < 100000)
+    {
+        while(added < segments && added < acknowledged + window_segments)
+        {
+            result = lTCPWindowTxAdd(&window, MSS, (int32_t) ((added * MSS) % (1u << 24)), 1 << 24);
+            mix((uint32_t) result);
+            if(result == 0)
+                break;
+            added++;
+        }
+        while((length = ulTCPWindowTxGet(&window, (uint32_t) window_segments * MSS, &position)) != 0)
+        {
+            sequence = window.ulOurSequenceNumber;
+            index = (int) ((sequence - base) / MSS);
+            mix(length);
+            mix(sequence);
+            if((int) rnd(100) < loss)
+                continue;
+            peer[index] = 1;
+            for(ack = 0; peer[ack]; ack++)
+                ;
+            if(index > ack)
+            {
+                for(from = index; peer[from - 1]; from--)
+                    ;
+                for(to = index + 1; peer[to]; to++)
+                    ;
+                mix(ulTCPWindowTxSack(&window, base + (uint32_t) from * MSS, base + (uint32_t) to * MSS));
+            }
+            mix(ulTCPWindowTxAck(&window, base + (uint32_t) ack * MSS));
+            acknowledged = (int) ((window.tx.ulCurrentSequenceNumber - base) / MSS);
+            if(checking)
+                check_trees();
+        }
+        tick_count += 10;
+    }
+    check(acknowledged == segments, "the peer did not get all data");
+    check(xTCPWindowTxDone(&window) != pdFALSE, "the send window is not empty");
+    vTCPWindowDestroy(&window);
+}
+
+static double elapsed_ns(const struct timespec *t0)
+{
+    struct timespec t1;
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return (t1.tv_sec - t0->tv_sec) * 1e9 + (t1.tv_nsec - t0->tv_nsec);
+}
+
+/* Windows of 16, 64 and 200 segments in which the first segment is lost */
+static void benchmark(unsigned long segments)
+{
+    static const int sizes[] = { 16, 64, 200 };
+    struct timespec t0;
+    unsigned long calls, k, rounds;
+    uint32_t start;
+    int32_t position;
+    size_t w;
+    int size, i;
+
+    for(w = 0; w < sizeof(sizes) / sizeof(sizes[0]); w++)
+    {
+        size = sizes[w];
+        rounds = segments / size;
+
+        /* The first segment of every window arrives last */
+        new_window(1000);
+        calls = 0;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        for(k = 0; k < rounds; k++)
+        {
+            start = window.rx.ulCurrentSequenceNumber;
+            for(i = 1; i < size; i++, calls++)
+                lTCPWindowRxCheck(&window, start + (uint32_t) i * MSS, MSS, (uint32_t) size * MSS);
+            lTCPWindowRxCheck(&window, start, MSS, (uint32_t) size * MSS);
+            calls++;
+        }
+        printf("receive, window %3d, first lost  %7.1f ns per segment\n", size, elapsed_ns(&t0) / calls);
+        vTCPWindowDestroy(&window);
+
+        /* 2% lost, up to 8 segments late */
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        receive_run(7, 3000, size, 2, 8, 0, 0);
+        printf("receive, window %3d, 2%% lost     %7.1f ns per segment\n", size, elapsed_ns(&t0) / 3000);
+
+        /* The first segment is lost, the peer SACKs every other one, then
+         * acknowledges the window when the first comes again */
+        new_window(1000);
+        calls = 0;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        for(k = 0; k < rounds; k++)
+        {
+            start = window.tx.ulCurrentSequenceNumber;
+            for(i = 0; i < size; i++)
+                lTCPWindowTxAdd(&window, MSS, 0, 1 << 24);
+            while(ulTCPWindowTxGet(&window, (uint32_t) size * MSS, &position) != 0)
+                ;
+            for(i = 1; i < size; i++, calls++)
+                ulTCPWindowTxSack(&window, start + MSS, start + (uint32_t) (i + 1) * MSS);
+            ulTCPWindowTxAck(&window, start + (uint32_t) size * MSS);
+            calls++;
+            window.xSize.ulTxWindowLength = 1u << 20;
+        }
+        printf("send,    window %3d, first lost  %7.1f ns per ACK\n", size, elapsed_ns(&t0) / calls);
+        vTCPWindowDestroy(&window);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long segments = 0;
+    int digest_only = 0, i;
+    uint32_t run;
+
+    for(i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+            segments = strtoul(argv[++i], NULL, 0);
+        else if(strcmp(argv[i], "-d") == 0)
+            digest_only = 1;
+        else
+            break;
+    }
+    if(i < argc)
+    {
+        fprintf(stderr, "usage: tcpwin [-b segments] [-d]\n");
+        return 2;
+    }
+
+    for(run = 1; run <= 300; run++)
+    {
+        receive_run(run, 400 + (run % 5) * 200, 4 + (run * 37) % 120, run % 15, (run * 7) % 12, run % 4, 1);
+        check_pool();
+    }
+    for(run = 1; run <= 300; run++)
+    {
+        send_run(run, 300 + (run % 4) * 150, 2 + (run * 13) % 60, run % 12, 1);
+        check_pool();
+    }
+
+    if(digest_only)
+    {
+        printf("%016llx\n", (unsigned long long) digest);
+        return failures != 0;
+    }
+    printf("ipconfigTCP_WIN_USE_SEGMENT_TREE %d, ipconfigTCP_SACK_BLOCKS %d: digest %016llx\n",
+           ipconfigTCP_WIN_USE_SEGMENT_TREE, ipconfigTCP_SACK_BLOCKS, (unsigned long long) digest);
+    printf("%lu SACK options, %.2f blocks on average, %lu checks, %lu failures\n",
+           sack_options, sack_options ? (double) sack_blocks / sack_options : 0.0, checks, failures);
+
+    if(segments != 0)
+        benchmark(segments);
+
+    return failures != 0;
+}
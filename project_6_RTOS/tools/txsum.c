@@ -0,0 +1,378 @@
+/** @file txsum.c
+ *
+ * @brief Host side test and loopback benchmark of the TCP transmit checksum
+ *
+ * @par
+ * With ipconfigUSE_CHECKSUM_COPY, prvTCPPrepareSend() sums the payload while
+ * it copies it out of the txStream and prvTCPReturnPacket() only adds the
+ * headers. This first checks usGenerateChecksumCopy() against memcpy() and
+ * usGenerateChecksum() for source and destination offsets 0 to 7 and lengths
+ * up to 1600 and 70000 bytes, with guard bytes around the copy, and
+ * uxStreamBufferGetChecksum() against uxStreamBufferGet() for reads that wrap
+ * around the end of the stream at every position.
+ *
+ * @par
+ * Then it sends a byte stream through an established connection the way the
+ * IP-task does: the data are added to the txStream, xTCPSocketCheck() sends
+ * what the window allows, and xNetworkInterfaceOutput() checks each frame's
+ * TCP checksum with usGenerateProtocolChecksum() and its payload against the
+ * stream, after which the segments are acknowledged. The same without the
+ * checks, timed per payload byte for a few segment sizes, is the loopback
+ * benchmark.
+ *
+ * @par
+ * Built by the Makefile in this directory with the fused copy (txsum) and
+ * with the copy followed by a separate checksum pass (txsum_separate):
+ *
+ *     make txsum txsum_separate
+ *     ./txsum -b 100000000
+ *
+ *     -b  bytes sent per segment size (default 100000000)
+ *
+ * @par
+ * On a 64-bit host, where memcpy() is vectorised and the second pass reads
+ * from the cache, the separate passes can be the faster ones. The fused copy
+ * is meant for the PIC32MX, which has no data cache and copies word by word.
+ *
+ * @par
+ * The exit status is 1 if any sum, copy or frame was wrong.
+ *
+ * @author
+ * Carlos Santos
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "list.h"
+#include "event_groups.h"
+#include "FreeRTOS_IP.h"
+#include "FreeRTOS_Sockets.h"
+#include "FreeRTOS_IP_Private.h"
+#include "FreeRTOS_ARP.h"
+#include "FreeRTOS_Stream_Buffer.h"
+
+#define SOURCE_LENGTH   65521   /* a prime, the stream does not repeat in step with the txStream */
+#define STREAM_LENGTH   65536
+#define CHECKED_BYTES   2000000
+#define LOCAL_IP        0x0A000002u
+#define REMOTE_IP       0x0A000001u
+#define CORRECT_CRC     0xFFFFu /* ipCORRECT_CRC of FreeRTOS_IP.c */
+
+static uint8_t source[2 * SOURCE_LENGTH] __attribute__((aligned(64)));
+static uint32_t rng_state = 1;
+static unsigned long checks, failures;
+
+/* What xNetworkInterfaceOutput() saw of the connection */
+static FreeRTOS_Socket_t *sender;
+static uint32_t first_sequence, next_sequence;
+static unsigned long frames;
+static int verify;              /* not while timing */
+
+/* The kernel and IP-task functions the sources call */
+const BaseType_t xBufferAllocFixedSize = pdFALSE;
+void *pvPortMalloc(size_t xSize) { return malloc(xSize); }
+void vPortFree(void *pv) { free(pv); }
+void vTaskSuspendAll(void) { }
+BaseType_t xTaskResumeAll(void) { return pdFALSE; }
+void vTaskEnterCritical(void) { }
+void vTaskExitCritical(void) { }
+TickType_t xTaskGetTickCount(void) { return 0; }
+TaskHandle_t xTaskGetCurrentTaskHandle(void) { return NULL; }
+UBaseType_t uxQueueMessagesWaiting(const QueueHandle_t xQueue) { (void) xQueue; return 0; }
+BaseType_t xQueueGenericSend(QueueHandle_t xQueue, const void * const pvItemToQueue, TickType_t xTicksToWait, const BaseType_t xCopyPosition)
+{
+    (void) xQueue; (void) pvItemToQueue; (void) xTicksToWait; (void) xCopyPosition;
+    return pdPASS;
+}
+EventBits_t xEventGroupSetBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToSet) { (void) xEventGroup; return uxBitsToSet; }
+void vEventGroupDelete(EventGroupHandle_t xEventGroup) { (void) xEventGroup; }
+
+/* The local MAC and IP address, of FreeRTOS_UDP_IP.c */
+UDPPacketHeader_t xDefaultPartUDPPacketHeader;
+
+/* For a socket that connects, which this one does not */
+eARPLookupResult_t eARPGetCacheEntry(uint32_t *pulIPAddress, MACAddress_t * const pxMACAddress) { (void) pulIPAddress; (void) pxMACAddress; return eCantSendPacket; }
+void FreeRTOS_OutputARPRequest(uint32_t ulIPAddress) { (void) ulIPAddress; }
+BaseType_t xARPHoldPacket(NetworkBufferDescriptor_t * const pxNetworkBuffer, uint32_t ulIPAddress) { (void) pxNetworkBuffer; (void) ulIPAddress; return pdFALSE; }
+uint32_t ulApplicationGetNextSequenceNumber(uint32_t ulSourceAddress, uint16_t usSourcePort, uint32_t ulDestinationAddress, uint16_t usDestinationPort)
+{
+    (void) ulSourceAddress; (void) usSourcePort; (void) ulDestinationAddress; (void) usDestinationPort;
+    return 0;
+}
+
+static uint32_t rnd(uint32_t n)
+{
+    /* xorshift32 */
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state % n;
+}
+
+UBaseType_t uxRand(void)
+{
+    return rnd(0xFFFFFFFFu) + 1;
+}
+
+/* Network buffers as BufferAllocation_2.c gives them: the Ethernet header
+ * starts ipBUFFER_PADDING bytes into the allocation, 2 bytes past a word. */
+NetworkBufferDescriptor_t *pxGetNetworkBufferWithDescriptor(size_t xRequestedSizeBytes, TickType_t xBlockTimeTicks)
+{
+    NetworkBufferDescriptor_t *buffer = calloc(1, sizeof(*buffer));
+    uint8_t *data = malloc(xRequestedSizeBytes + ipBUFFER_PADDING);
+
+    (void) xBlockTimeTicks;
+    if(buffer == NULL || data == NULL)
+    {
+        perror("txsum");
+        exit(2);
+    }
+    buffer->pucEthernetBuffer = data + ipBUFFER_PADDING;
+    buffer->xDataLength = xRequestedSizeBytes;
+    return buffer;
+}
+
+void vReleaseNetworkBufferAndDescriptor(NetworkBufferDescriptor_t * const pxNetworkBuffer)
+{
+    free(pxNetworkBuffer->pucEthernetBuffer - ipBUFFER_PADDING);
+    free(pxNetworkBuffer);
+}
+
+static void fail(const char *what, unsigned long a, unsigned long b)
+{
+    if(failures++ < 10)
+        printf("%s (%lu, %lu)\n", what, a, b);
+}
+
+/* The peer: checks the frame and takes in the payload */
+BaseType_t xNetworkInterfaceOutput(NetworkBufferDescriptor_t * const pxNetworkBuffer, BaseType_t bReleaseAfterSend)
+{
+    const TCPPacket_t *packet = (const TCPPacket_t *) pxNetworkBuffer->pucEthernetBuffer;
+    size_t header = ipSIZE_OF_ETH_HEADER + ipSIZE_OF_IPv4_HEADER + ((packet->xTCPHeader.ucTCPOffset & 0xF0u) >> 2);
+    size_t length = ipSIZE_OF_ETH_HEADER + FreeRTOS_ntohs(packet->xIPHeader.usLength) - header;
+    uint32_t sequence = FreeRTOS_ntohl(packet->xTCPHeader.ulSequenceNumber);
+    size_t position = (sequence - first_sequence) % SOURCE_LENGTH;
+
+    if(verify)
+    {
+        frames++;
+        checks++;
+        if(usGenerateProtocolChecksum(pxNetworkBuffer->pucEthernetBuffer, pxNetworkBuffer->xDataLength, pdFALSE) != CORRECT_CRC)
+            fail("frame with a wrong TCP checksum", frames, (unsigned long) length);
+        if(sequence != next_sequence)
+            fail("frame out of sequence", (unsigned long) sequence, (unsigned long) next_sequence);
+        if(memcmp(pxNetworkBuffer->pucEthernetBuffer + header, source + position, length) != 0)
+            fail("frame with wrong data", frames, (unsigned long) length);
+    }
+    next_sequence = sequence + (uint32_t) length;
+
+    if(bReleaseAfterSend != pdFALSE)
+        vReleaseNetworkBufferAndDescriptor(pxNetworkBuffer);
+    return pdPASS;
+}
+
+#if( ipconfigUSE_CHECKSUM_COPY != 0 )
+
+static uint8_t copy[80000] __attribute__((aligned(64))), expected[80000] __attribute__((aligned(64)));
+
+static void test_copy(void)
+{
+    static const size_t big[] = { 65535, 70000 };
+    int b, s, d;
+    size_t len;
+
+    for(s = 0; s < 8; s++)
+    {
+        for(d = 0; d < 8; d++)
+        {
+            for(len = 0; len < 1600; len += (len < 100) ? 1 : 1 + rnd(7))
+            {
+                uint32_t sum = rnd(0x10000);
+                uint16_t got;
+
+                /* The sum is that of the target, where the bytes end up */
+                memset(copy, 0xA5, len + 16);
+                got = usGenerateChecksumCopy(sum, copy + d, source + s, len);
+                checks++;
+                if(got != usGenerateChecksum(sum, copy + d, len))
+                    fail("usGenerateChecksumCopy() sum", (unsigned long) len, (unsigned long) got);
+                if(memcmp(copy + d, source + s, len) != 0 || copy[d + len] != 0xA5 || (d > 0 && copy[d - 1] != 0xA5))
+                    fail("usGenerateChecksumCopy() copy", (unsigned long) len, (unsigned long) d);
+            }
+        }
+    }
+
+    /* All carries, more than a 32-bit accumulator takes in one block */
+    memset(expected, 0xFF, sizeof(expected));
+    for(b = 0; b < 2; b++)
+    {
+        uint16_t got = usGenerateChecksumCopy(0xFFFFu, copy + 1, expected + 3, big[b]);
+
+        checks++;
+        if(got != usGenerateChecksum(0xFFFFu, copy + 1, big[b]) || memcmp(copy + 1, expected + 3, big[b]) != 0)
+            fail("usGenerateChecksumCopy() of 0xFF bytes", (unsigned long) big[b], 0);
+    }
+}
+
+static void test_stream(void)
+{
+    StreamBuffer_t *stream = malloc(sizeof(*stream) - sizeof(stream->ucArray) + STREAM_LENGTH);
+    int k;
+
+    memset(stream, 0, sizeof(*stream) - sizeof(stream->ucArray));
+    stream->LENGTH = STREAM_LENGTH;
+    memcpy(stream->ucArray, source, STREAM_LENGTH);
+
+    for(k = 0; k < 300000; k++)
+    {
+        size_t tail = (k & 1) ? STREAM_LENGTH - 1 - rnd(1600) : rnd(STREAM_LENGTH);
+        size_t size = rnd(STREAM_LENGTH), offset = rnd(3000), count = rnd(1600), got, want;
+        int d = (int) rnd(4);
+        uint16_t sum;
+
+        stream->uxTail = tail;
+        stream->uxHead = stream->uxMid = stream->uxFront = (tail + size) % STREAM_LENGTH;
+        want = uxStreamBufferGet(stream, offset, expected + d, count, pdTRUE);
+        got = uxStreamBufferGetChecksum(stream, offset, copy + d, count, &sum);
+        checks++;
+        if(got != want || memcmp(copy + d, expected + d, got) != 0)
+            fail("uxStreamBufferGetChecksum() copy", (unsigned long) tail, (unsigned long) offset);
+        else if(sum != usGenerateChecksum(0, expected + d, got))
+            fail("uxStreamBufferGetChecksum() sum", (unsigned long) tail, (unsigned long) offset);
+    }
+    free(stream);
+}
+
+#endif /* ipconfigUSE_CHECKSUM_COPY */
+
+/* An established connection, as prvHandleListen() and prvTCPCreateWindow()
+ * leave it, of which xPacket holds the last packet from the peer */
+static FreeRTOS_Socket_t *open_connection(uint16_t mss)
+{
+    FreeRTOS_Socket_t *s = calloc(1, sizeof(*s));
+    TCPPacket_t *packet = (TCPPacket_t *) s->u.xTCP.xPacket.u.ucLastPacket;
+
+    s->ucProtocol = FREERTOS_IPPROTO_TCP;
+    vListInitialiseItem(&s->xBoundSocketListItem);
+#if( ipconfigUSE_TCP_TIMER_WHEEL == 1 )
+    vListInitialiseItem(&s->u.xTCP.xTimerListItem);
+    listSET_LIST_ITEM_OWNER(&s->u.xTCP.xTimerListItem, s);
+    vListInitialiseItem(&s->u.xTCP.xTimerChangedItem);
+    listSET_LIST_ITEM_OWNER(&s->u.xTCP.xTimerChangedItem, s);
+#endif
+    s->usLocalPort = 7;
+    s->u.xTCP.ucTCPState = eESTABLISHED;
+    s->u.xTCP.ulRemoteIP = REMOTE_IP;
+    s->u.xTCP.usRemotePort = 40000;
+    s->u.xTCP.usInitMSS = s->u.xTCP.usCurMSS = mss;
+    s->u.xTCP.uxRxStreamSize = s->u.xTCP.uxTxStreamSize = STREAM_LENGTH;
+    s->u.xTCP.ulRxCurWinSize = STREAM_LENGTH;
+    s->u.xTCP.ulWindowSize = 0xFFFFu;
+    vTCPWindowCreate(&s->u.xTCP.xTCPWindow, STREAM_LENGTH, STREAM_LENGTH, 1000, first_sequence, mss);
+
+    packet->xEthernetHeader.usFrameType = ipIPv4_FRAME_TYPE;
+    packet->xIPHeader.ucVersionHeaderLength = 0x45;
+    packet->xIPHeader.ucProtocol = ipPROTOCOL_TCP;
+    packet->xIPHeader.ulSourceIPAddress = FreeRTOS_htonl(REMOTE_IP);
+    packet->xIPHeader.ulDestinationIPAddress = FreeRTOS_htonl(LOCAL_IP);
+    packet->xTCPHeader.usSourcePort = FreeRTOS_htons(40000);
+    packet->xTCPHeader.usDestinationPort = FreeRTOS_htons(7);
+    packet->xTCPHeader.ucTCPOffset = 0x50;
+
+    s->u.xTCP.txStream = malloc(sizeof(StreamBuffer_t) - sizeof(s->u.xTCP.txStream->ucArray) + STREAM_LENGTH);
+    memset(s->u.xTCP.txStream, 0, sizeof(StreamBuffer_t) - sizeof(s->u.xTCP.txStream->ucArray));
+    s->u.xTCP.txStream->LENGTH = STREAM_LENGTH;
+    return s;
+}
+
+/* Sends 'bytes' with segments of 'mss' bytes, returns ns per byte */
+static double send_stream(uint16_t mss, unsigned long bytes)
+{
+    unsigned long added = 0;
+    struct timespec t0, t1;
+    uint32_t acked;
+
+    first_sequence = rnd(0xFFFFFFFFu);
+    next_sequence = first_sequence;
+    sender = open_connection(mss);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    while(next_sequence - first_sequence < bytes)
+    {
+        /* FreeRTOS_send() */
+        size_t space = uxStreamBufferGetSpace(sender->u.xTCP.txStream);
+        size_t position = added % SOURCE_LENGTH;
+
+        if(space > bytes - added)
+            space = bytes - added;
+        added += uxStreamBufferAdd(sender->u.xTCP.txStream, 0, source + position, space);
+
+        /* The IP-task */
+        xTCPSocketCheck(sender);
+
+        /* The peer acknowledges all, prvTCPHandleState() lets it go */
+        acked = ulTCPWindowTxAck(&sender->u.xTCP.xTCPWindow, next_sequence);
+        if(acked > 0)
+            uxStreamBufferGet(sender->u.xTCP.txStream, 0, NULL, acked, pdFALSE);
+        else if(next_sequence - first_sequence < bytes)
+        {
+            fail("the connection stalled", (unsigned long) (next_sequence - first_sequence), bytes);
+            break;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    vSocketClose(sender);
+    return ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / bytes;
+}
+
+int main(int argc, char **argv)
+{
+    static const uint16_t sizes[] = { 64, 536, 1460 };
+    unsigned long bytes = 100000000;
+    int i;
+
+    for(i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+            bytes = strtoul(argv[++i], NULL, 0);
+        else
+            bytes = 0;
+    }
+    if(bytes == 0)
+    {
+        fprintf(stderr, "usage: txsum [-b bytes]\n");
+        return 2;
+    }
+
+    /* The stream, twice, so it can be compared past its end */
+    for(i = 0; i < SOURCE_LENGTH; i++)
+        source[i] = source[i + SOURCE_LENGTH] = (uint8_t) rnd(256);
+    *ipLOCAL_IP_ADDRESS_POINTER = FreeRTOS_htonl(LOCAL_IP);
+    vNetworkSocketsInit();
+
+#if( ipconfigUSE_CHECKSUM_COPY != 0 )
+    test_copy();
+    test_stream();
+#endif
+
+    printf("ipconfigUSE_CHECKSUM_COPY %d\n", ipconfigUSE_CHECKSUM_COPY);
+    printf("segment   GB/s of payload\n");
+    for(i = 0; i < (int) (sizeof(sizes) / sizeof(sizes[0])); i++)
+    {
+        /* Every frame checked, then timed without the checks */
+        verify = 1;
+        send_stream(sizes[i], CHECKED_BYTES);
+        verify = 0;
+        printf("%7u %7.2f\n", sizes[i], 1 / send_stream(sizes[i], bytes));
+    }
+    printf("%lu frames, %lu checks, %lu failures\n", frames, checks, failures);
+
+    return failures != 0;
+}